@@ -17,6 +17,17 @@ enum EMeshOptimizationLevel
 	OL_Max		// maximum level of quality (slow)
 };
 
+/// Triangle and vertex reordering done by the mesh compiler after importing
+/// (independent of the Assimp post-processing selected by EMeshOptimizationLevel).
+enum EVertexCacheOptimization
+{
+	VCO_None,
+	VCO_Tipsify,	// fast
+	VCO_Forsyth,	// slower, usually the best ACMR
+	VCO_TipsifyAndOverdraw,	// Tipsify, then the outer clusters are drawn first to reduce overdraw
+};
+mxDECLARE_ENUM( EVertexCacheOptimization, U8, VertexCacheOptimizationT );
+
 struct MeshImportSettings: CStruct
 {
 	const TbVertexFormat*	vertex_format;
@@ -31,6 +42,17 @@ struct MeshImportSettings: CStruct
 	//
 	EMeshOptimizationLevel	mesh_optimization_level;
 
+	/// reorder the triangles for the post-transform vertex cache and the vertices for vertex fetch?
+	VertexCacheOptimizationT	vertex_cache_optimization;
+
+	/// split the submeshes into clusters (meshlets) with culling data?
+	bool	build_clusters;
+
+	/// compile a simplified version of the mesh (e.g. for a separate LoD mesh asset);
+	/// 0 = no simplification, each LOD has about 'lod_triangle_reduction' of the triangles of the previous LOD
+	U32		lod_index;
+	F32		lod_triangle_reduction;
+
 
 	/// useful if some models fail to import, because they don't have UV data:
 	/// "Failed to compute tangents; need UV data in channel0"
@@ -28,11 +28,22 @@
 namespace Meshok
 {
 
+mxBEGIN_REFLECT_ENUM( VertexCacheOptimizationT )
+	mxREFLECT_ENUM_ITEM( None, VCO_None ),
+	mxREFLECT_ENUM_ITEM( Tipsify, VCO_Tipsify ),
+	mxREFLECT_ENUM_ITEM( Forsyth, VCO_Forsyth ),
+	mxREFLECT_ENUM_ITEM( TipsifyAndOverdraw, VCO_TipsifyAndOverdraw ),
+mxEND_REFLECT_ENUM
+
 mxDEFINE_CLASS( MeshImportSettings );
 mxBEGIN_REFLECTION( MeshImportSettings )
 	mxMEMBER_FIELD_OF_TYPE( vertex_format, T_DeduceTypeInfo<TbMetaClass*>() ),
 	mxMEMBER_FIELD( normalize_to_unit_cube ),
 	mxMEMBER_FIELD( flip_winding_order ),
+	mxMEMBER_FIELD( vertex_cache_optimization ),
+	mxMEMBER_FIELD( build_clusters ),
+	mxMEMBER_FIELD( lod_index ),
+	mxMEMBER_FIELD( lod_triangle_reduction ),
 mxEND_REFLECTION
 MeshImportSettings::MeshImportSettings()
 {
@@ -41,6 +52,10 @@ MeshImportSettings::MeshImportSettings()
 	pretransform = nil;
 	flip_winding_order = false;
 	mesh_optimization_level = OL_None;
+	vertex_cache_optimization = VCO_None;
+	build_clusters = false;
+	lod_index = 0;
+	lod_triangle_reduction = 0.5f;
 	force_regenerate_UVs = false;
 	force_ignore_uvs = false;
 }
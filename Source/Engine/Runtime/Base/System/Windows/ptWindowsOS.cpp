@@ -718,6 +718,8 @@ static void DetectCPU( PtSystemInfo & sysInfo )
 		*((INT32*)sysInfo.cpu.vendor + 1) = cpuInfo[3];
 		*((INT32*)sysInfo.cpu.vendor + 2) = cpuInfo[2];
 
+		const INT32 nIds = cpuInfo[0];	// the highest valid function ID
+
 		/*
 		----------------------------------------------------------------------------------
 		When the InfoType argument is 1, the following table describes the output.
@@ -911,6 +913,25 @@ static void DetectCPU( PtSystemInfo & sysInfo )
 		bool bAES = (cpuInfo[2] & (1UL << 25)) || false;	// AES support (Intel)
 		bool bAVX = (cpuInfo[2] & (1UL << 28)) || false;	// 256-bit AVX (Intel)
 
+		// AVX registers can only be used if the OS saves them on context switches.
+		const bool bOSXSAVE = (cpuInfo[2] & (1UL << 27)) || false;
+		const UINT64 nEnabledXSaveFeatures = bOSXSAVE ? _xgetbv( 0 ) : 0;
+		const bool bOSSavesYMM = (nEnabledXSaveFeatures & 0x06) == 0x06;	// XMM and YMM state
+		const bool bOSSavesZMM = (nEnabledXSaveFeatures & 0xE6) == 0xE6;	// XMM, YMM, opmask and ZMM state
+
+		bAVX = bAVX && bOSSavesYMM;
+
+		// Structured Extended Feature Flags (EAX = 7, ECX = 0).
+		bool bAVX2 = false;
+		bool bAVX512F = false;
+		if( nIds >= 7 )
+		{
+			INT32 extendedFeatures[4] = { 0 };
+			__cpuidex( extendedFeatures, 7, 0 );
+			bAVX2 = ((extendedFeatures[1] & (1UL << 5)) != 0) && bOSSavesYMM;
+			bAVX512F = ((extendedFeatures[1] & (1UL << 16)) != 0) && bOSSavesZMM;
+		}
+
 
 		__cpuid( cpuInfo, CPUID_EXTENDED_FEATURES );
 
@@ -986,6 +1007,8 @@ static void DetectCPU( PtSystemInfo & sysInfo )
 		sysInfo.cpu.has_POPCNT		= bPOPCNT;
 		sysInfo.cpu.has_AES			= bAES;
 		sysInfo.cpu.has_AVX			= bAVX;
+		sysInfo.cpu.has_AVX2		= bAVX2;
+		sysInfo.cpu.has_AVX512F		= bAVX512F;
 
 		// With the AMD chipset, all multi-core AMD CPUs set bit 28
 		// of the feature information bits to indicate
@@ -282,6 +282,8 @@ struct mxCpuInfo
 	bool	has_POPCNT;	// POPCNT
 	bool	has_AES;	// AES support (Intel)
 	bool	has_AVX;	// 256-bit AVX (Intel)
+	bool	has_AVX2;	// 256-bit integer AVX (requires OS support for YMM registers)
+	bool	has_AVX512F;// 512-bit AVX-512 Foundation (requires OS support for ZMM registers)
 };
 
 UINT mxGetNumCpuCores();	// shortcut for convenience
@@ -169,6 +169,82 @@ done:
 #undef BX_RADIXSORT_BIT_MASK
 
 
+/// Stable LSD radix sort of structures by their 64-bit keys in ascending order (e.g. draw items by sort keys).
+/// 8 bits per pass, the histograms of all passes are built in a single pass over the items,
+/// the passes where all keys have the same digit (e.g. the view id) are skipped.
+/// GetKey is a functor: uint64_t operator()( const Ty& item ) const.
+/// Returns the buffer with the sorted items (either _items or _tempItems).
+template< typename Ty, class GetKey >
+Ty* RadixSort64_AscendingOrder( Ty* __restrict _items, Ty* __restrict _tempItems, const uint32_t _size, const GetKey& getKey )
+{
+	enum
+	{
+		RADIX_BITS = 8,
+		NUM_PASSES = 64 / RADIX_BITS,
+		HISTOGRAM_SIZE = 1 << RADIX_BITS,
+		DIGIT_MASK = HISTOGRAM_SIZE - 1
+	};
+
+	uint32_t histograms[NUM_PASSES][HISTOGRAM_SIZE];
+	memset(histograms, 0, sizeof(histograms));
+
+	bool alreadySorted = true;
+	{
+		uint64_t prevKey = 0;
+		for (uint32_t ii = 0; ii < _size; ++ii)
+		{
+			const uint64_t key = getKey(_items[ii]);
+			for (uint32_t pass = 0; pass < NUM_PASSES; ++pass)
+			{
+				++histograms[pass][(key >> (pass * RADIX_BITS)) & DIGIT_MASK];
+			}
+			alreadySorted &= (prevKey <= key);
+			prevKey = key;
+		}
+	}
+
+	if (alreadySorted)
+	{
+		return _items;
+	}
+
+	Ty* __restrict src = _items;
+	Ty* __restrict dst = _tempItems;
+
+	for (uint32_t pass = 0; pass < NUM_PASSES; ++pass)
+	{
+		uint32_t* histogram = histograms[pass];
+		const uint32_t shift = pass * RADIX_BITS;
+
+		// all keys have the same digit - the order doesn't change
+		if (histogram[(getKey(src[0]) >> shift) & DIGIT_MASK] == _size)
+		{
+			continue;
+		}
+
+		uint32_t offset = 0;
+		for (uint32_t ii = 0; ii < HISTOGRAM_SIZE; ++ii)
+		{
+			const uint32_t count = histogram[ii];
+			histogram[ii] = offset;
+			offset += count;
+		}
+
+		for (uint32_t ii = 0; ii < _size; ++ii)
+		{
+			const uint32_t dest = histogram[(getKey(src[ii]) >> shift) & DIGIT_MASK]++;
+			dst[dest] = src[ii];
+		}
+
+		Ty* swapItems = src;
+		src = dst;
+		dst = swapItems;
+	}
+
+	return src;
+}
+
+
 
 mxSTOLEN("Zeux");
 /*
@@ -151,6 +151,12 @@ void mxUtil_StartLogging( ALog* logger )
 	if( cpuInfo.has_AVX ) {
 		logger->PrintF( LL_Info, "	AVX");
 	}
+	if( cpuInfo.has_AVX2 ) {
+		logger->PrintF( LL_Info, "	AVX2");
+	}
+	if( cpuInfo.has_AVX512F ) {
+		logger->PrintF( LL_Info, "	AVX-512F");
+	}
 
 
 	if( cpuInfo.has_HTT ) {
@@ -0,0 +1,1032 @@
+/*
+=============================================================================
+	The null back-end, see backend_null.h.
+=============================================================================
+*/
+#include <GlobalEngineConfig.h>
+#include <Base/Base.h>
+
+#include <GPU/Public/graphics_device.h>
+
+#include "backend_null.h"
+
+
+namespace NGpu
+{
+
+/// to avoid flooding the log when something is broken every frame
+enum { MAX_LOGGED_VALIDATION_ERRORS = 32 };
+
+BackendNull::BackendNull( AllocatorI & allocator )
+	: _allocator( allocator )
+{
+	_framebuffer_handle.SetNil();
+	mxZERO_OUT(_frame_stats);
+	mxZERO_OUT(_last_frame_stats);
+	_last_frame_stats_lock.Initialize();
+	_num_validation_errors = 0;
+}
+
+BackendNull::~BackendNull()
+{
+	_last_frame_stats_lock.Shutdown();
+}
+
+ERet BackendNull::Initialize(
+	const CreationInfo& settings
+	, Capabilities &caps_
+	, PlatformData &platform_data_
+	)
+{
+	DEVOUT("Graphics: using the null back-end");
+
+	caps_.supports_RGB_float_render_target = true;
+
+	mxZERO_OUT(platform_data_);
+
+	// the back buffer
+	_framebuffer_handle = settings.framebuffer_handle;
+	_color_targets.onCreate( settings.framebuffer_handle.id, 0 );
+
+	// the D3D11 back-end creates pooled uniform buffers on these handles
+	for( UINT slot = 0; slot < LLGL_MAX_BOUND_UNIFORM_BUFFERS; slot++ )
+	{
+		for( UINT bin_index = 0; bin_index < UniformBufferPoolHandles::NUM_SIZE_BINS; bin_index++ )
+		{
+			const HBuffer buffer_handle = settings.uniform_buffer_pool_handles.handles[ slot ][ bin_index ];
+			_buffers.onCreate(
+				buffer_handle.id
+				, UniformBufferPoolHandles::getBufferSizeByBinIndex( bin_index )
+				);
+		}
+	}
+
+	return ALL_OK;
+}
+
+void BackendNull::Shutdown()
+{
+	if( _framebuffer_handle.IsValid() )
+	{
+		_color_targets.onDelete( _framebuffer_handle.id );
+		_framebuffer_handle.SetNil();
+	}
+
+	const U32 num_leaked_resources
+		= _depth_stencil_states.num_alive
+		+ _rasterizer_states.num_alive
+		+ _sampler_states.num_alive
+		+ _blend_states.num_alive
+		+ _color_targets.num_alive
+		+ _depth_targets.num_alive
+		+ _input_layouts.num_alive
+		+ _textures.num_alive
+		+ _shaders.num_alive
+		+ _programs.num_alive
+		;	// pooled uniform buffers are never deleted by the front-end
+	if( num_leaked_resources ) {
+		DEVOUT("Null back-end: %u resources were not deleted", num_leaked_resources);
+	}
+
+	if( _num_validation_errors ) {
+		ptWARN("Null back-end: %u validation errors", _num_validation_errors);
+	}
+}
+
+bool BackendNull::isDeviceRemoved() const
+{
+	return false;
+}
+
+void BackendNull::onValidationError( const char* message, const unsigned handle_value )
+{
+	if( _num_validation_errors++ < MAX_LOGGED_VALIDATION_ERRORS ) {
+		ptWARN("Null back-end: %s (handle: %u)", message, handle_value);
+	}
+}
+
+bool BackendNull::isShaderInputAlive( const HShaderInput handle ) const
+{
+	const UINT type = handle.id & ((1 << SRT_NumBits)-1);
+	const UINT index = ((UINT)handle.id >> SRT_NumBits);
+
+	switch( type )
+	{
+	case SRT_Buffer:		return _buffers.isAlive( index );
+	case SRT_Texture:		return _textures.isAlive( index );
+	case SRT_ColorSurface:	return _color_targets.isAlive( index );
+	case SRT_DepthSurface:	return _depth_targets.isAlive( index );
+	}
+	return false;
+}
+
+bool BackendNull::isShaderOutputAlive( const HShaderOutput handle ) const
+{
+	const UINT type = handle.id & ((1 << SRT_NumBits)-1);
+	const UINT index = ((UINT)handle.id >> SRT_NumBits);
+
+	switch( type )
+	{
+	case SRT_Buffer:		return _buffers.isAlive( index );
+	case SRT_Texture:		return _textures.isAlive( index );
+	case SRT_ColorSurface:	return _color_targets.isAlive( index );
+	}
+	return false;	// depth targets cannot have UAVs
+}
+
+#pragma region "Create/Delete"
+
+void BackendNull::createColorTarget(
+	const unsigned index
+	, const NwColorTargetDescription& description
+	, const char* debug_name
+	)
+{
+	const U32 size = estimateTextureSize(
+		(NwDataFormat::Enum) description.format
+		, description.width, description.height, 1
+		, largest( description.numMips, (U8)1 )
+		);
+	if( !_color_targets.onCreate( index, size ) ) {
+		onValidationError( "color target already exists", index );
+	}
+}
+
+void BackendNull::deleteColorTarget( const unsigned index )
+{
+	if( !_color_targets.onDelete( index ) ) {
+		onValidationError( "deleting non-existent color target", index );
+	}
+}
+
+void BackendNull::createDepthTarget(
+	const unsigned index
+	, const NwDepthTargetDescription& description
+	, const char* debug_name
+	)
+{
+	const U32 size = estimateTextureSize(
+		(NwDataFormat::Enum) description.format
+		, description.width, description.height
+		);
+	if( !_depth_targets.onCreate( index, size ) ) {
+		onValidationError( "depth target already exists", index );
+	}
+}
+
+void BackendNull::deleteDepthTarget( const unsigned index )
+{
+	if( !_depth_targets.onDelete( index ) ) {
+		onValidationError( "deleting non-existent depth target", index );
+	}
+}
+
+void BackendNull::createTexture(
+	const unsigned index
+	, const Memory* initial_data
+	, const GrTextureCreationFlagsT flags
+	, const char* debug_name
+	)
+{
+	// the texture file (e.g. DDS) is not parsed, its size is close enough
+	if( !_textures.onCreate( index, initial_data ? initial_data->size : 0 ) ) {
+		onValidationError( "texture already exists", index );
+	}
+}
+
+void BackendNull::createTexture2D(
+	const unsigned index
+	, const NwTexture2DDescription& description
+	, const Memory* initial_data
+	, const char* debug_name
+	)
+{
+	if( !_textures.onCreate( index, description.CalcRawSize() ) ) {
+		onValidationError( "texture already exists", index );
+	}
+}
+
+void BackendNull::createTexture3D(
+	const unsigned index
+	, const NwTexture3DDescription& description
+	, const Memory* initial_data
+	, const char* debug_name
+	)
+{
+	if( !_textures.onCreate( index, description.CalcRawSize() ) ) {
+		onValidationError( "texture already exists", index );
+	}
+}
+
+void BackendNull::deleteTexture( const unsigned index )
+{
+	if( !_textures.onDelete( index ) ) {
+		onValidationError( "deleting non-existent texture", index );
+	}
+}
+
+void BackendNull::createDepthStencilState(
+	const unsigned index
+	, const NwDepthStencilDescription& description
+	, const char* debug_name
+	)
+{
+	if( !_depth_stencil_states.onCreate( index, 0 ) ) {
+		onValidationError( "depth-stencil state already exists", index );
+	}
+}
+
+void BackendNull::deleteDepthStencilState( const unsigned index )
+{
+	if( !_depth_stencil_states.onDelete( index ) ) {
+		onValidationError( "deleting non-existent depth-stencil state", index );
+	}
+}
+
+void BackendNull::createRasterizerState(
+	const unsigned index
+	, const NwRasterizerDescription& description
+	, const char* debug_name
+	)
+{
+	if( !_rasterizer_states.onCreate( index, 0 ) ) {
+		onValidationError( "rasterizer state already exists", index );
+	}
+}
+
+void BackendNull::deleteRasterizerState( const unsigned index )
+{
+	if( !_rasterizer_states.onDelete( index ) ) {
+		onValidationError( "deleting non-existent rasterizer state", index );
+	}
+}
+
+void BackendNull::createSamplerState(
+	const unsigned index
+	, const NwSamplerDescription& description
+	, const char* debug_name
+	)
+{
+	if( !_sampler_states.onCreate( index, 0 ) ) {
+		onValidationError( "sampler state already exists", index );
+	}
+}
+
+void BackendNull::deleteSamplerState( const unsigned index )
+{
+	if( !_sampler_states.onDelete( index ) ) {
+		onValidationError( "deleting non-existent sampler state", index );
+	}
+}
+
+void BackendNull::createBlendState(
+	const unsigned index
+	, const NwBlendDescription& description
+	, const char* debug_name
+	)
+{
+	if( !_blend_states.onCreate( index, 0 ) ) {
+		onValidationError( "blend state already exists", index );
+	}
+}
+
+void BackendNull::deleteBlendState( const unsigned index )
+{
+	if( !_blend_states.onDelete( index ) ) {
+		onValidationError( "deleting non-existent blend state", index );
+	}
+}
+
+void BackendNull::createInputLayout(
+	const unsigned index
+	, const NwVertexDescription& description
+	, const char* debug_name
+	)
+{
+	if( !_input_layouts.onCreate( index, 0 ) ) {
+		onValidationError( "input layout already exists", index );
+	}
+}
+
+void BackendNull::deleteInputLayout( const unsigned index )
+{
+	if( !_input_layouts.onDelete( index ) ) {
+		onValidationError( "deleting non-existent input layout", index );
+	}
+}
+
+ERet BackendNull::createBuffer(
+	const unsigned index
+	, const NwBufferDescription& description
+	, const Memory* initial_data
+	, const char* debug_name
+	)
+{
+	if( initial_data && initial_data->size > description.size ) {
+		onValidationError( "initial data is bigger than the buffer", index );
+	}
+	if( !_buffers.onCreate( index, description.size ) ) {
+		onValidationError( "buffer already exists", index );
+		return ERR_INVALID_PARAMETER;
+	}
+	return ALL_OK;
+}
+
+void BackendNull::deleteBuffer( const unsigned index )
+{
+	if( !_buffers.onDelete( index ) ) {
+		onValidationError( "deleting non-existent buffer", index );
+	}
+}
+
+void BackendNull::createShader( const unsigned index, const Memory* shader_binary )
+{
+	if( !_shaders.onCreate( index, shader_binary->size ) ) {
+		onValidationError( "shader already exists", index );
+	}
+}
+
+void BackendNull::deleteShader( const unsigned index )
+{
+	if( !_shaders.onDelete( index ) ) {
+		onValidationError( "deleting non-existent shader", index );
+	}
+}
+
+void BackendNull::createProgram( const unsigned index, const NwProgramDescription& description )
+{
+	for( UINT i = 0; i < mxCOUNT_OF(description.shaders); i++ )
+	{
+		const HShader shader_handle = description.shaders[i];
+		if( shader_handle.IsValid() && !_shaders.isAlive( shader_handle.id ) ) {
+			onValidationError( "program uses non-existent shader", shader_handle.id );
+		}
+	}
+	if( !_programs.onCreate( index, 0 ) ) {
+		onValidationError( "program already exists", index );
+	}
+}
+
+void BackendNull::deleteProgram( const unsigned index )
+{
+	if( !_programs.onDelete( index ) ) {
+		onValidationError( "deleting non-existent program", index );
+	}
+}
+
+#pragma endregion
+
+void BackendNull::updateBuffer( const unsigned index, const void* data, const unsigned size )
+{
+	if( !_buffers.isAlive( index ) ) {
+		onValidationError( "updating non-existent buffer", index );
+	} else if( size > _buffers.sizes[ index ] ) {
+		onValidationError( "buffer update overflows the buffer", index );
+	}
+	_frame_stats.num_buffer_updates++;
+	_frame_stats.num_uploaded_bytes += size;
+}
+
+void BackendNull::UpdateTexture( const unsigned index, const NwTextureRegion& region, const Memory* new_contents )
+{
+	if( !_textures.isAlive( index ) ) {
+		onValidationError( "updating non-existent texture", index );
+	}
+	_frame_stats.num_uploaded_bytes += new_contents->size;
+}
+
+///
+/// Mirrors the state tracking in the D3D11 back-end (D3D11State)
+/// to count the state changes the GPU would have seen.
+///
+struct NullBackendState
+{
+	HProgram		program;
+	HInputLayout	input_layout;
+	HBuffer			VB;
+	HBuffer			IB;
+	NwRenderState32	render_state;
+
+	HBuffer			CBs[LLGL_MAX_BOUND_UNIFORM_BUFFERS];
+	HSamplerState	SSs[LLGL_MAX_BOUND_SHADER_SAMPLERS];
+	HShaderInput	SRs[LLGL_MAX_BOUND_SHADER_TEXTURES];
+	HShaderOutput	UAVs[LLGL_MAX_BOUND_OUTPUT_BUFFERS];
+
+public:
+	NullBackendState()
+	{
+		program.SetNil();
+		input_layout.SetNil();
+		VB.SetNil();
+		IB.SetNil();
+		render_state.setDefaults();
+
+		for( UINT i = 0; i < mxCOUNT_OF(CBs); i++ ) { CBs[i].SetNil(); }
+		for( UINT i = 0; i < mxCOUNT_OF(SSs); i++ ) { SSs[i].SetNil(); }
+		for( UINT i = 0; i < mxCOUNT_OF(SRs); i++ ) { SRs[i].SetNil(); }
+		for( UINT i = 0; i < mxCOUNT_OF(UAVs); i++ ) { UAVs[i].SetNil(); }
+	}
+};
+
+template< typename HANDLE, UINT NUM_SLOTS >
+static inline
+bool bindToSlot( HANDLE (&slots)[NUM_SLOTS], const U32 slot, const HANDLE handle, NullBackendStats &stats )
+{
+	if( slots[ slot ] != handle )
+	{
+		slots[ slot ] = handle;
+		stats.num_resource_bindings++;
+		return true;
+	}
+	stats.num_redundant_bindings++;
+	return false;
+}
+
+void BackendNull::renderFrame( Frame & frame, const RunTimeSettings& settings )
+{
+	mxZERO_OUT(_frame_stats);
+
+	// same as in the D3D11 back-end
+	frame.transient_vertex_buffer.Flush( this );
+	frame.transient_index_buffer.Flush( this );
+
+	NwRenderContext & main_context = frame.main_context;
+
+	const NwRenderContext::SortItem* __restrict	items = main_context._sort_items.raw();
+	const U32									num_items = main_context._sort_items.num();
+	const char* __restrict						command_buffer_start = main_context._command_buffer.getStart();
+
+	U32 currentViewId = ~0;
+
+	NullBackendState	current_state;
+
+	for( U32 i = 0; i < num_items; i++ )
+	{
+		const NwRenderContext::SortItem& item = items[ i ];
+
+		U32 viewId;
+		DecodeSortKey( item.sortkey, viewId );
+
+		if( viewId != currentViewId )
+		{
+			mxASSERT(viewId < LLGL_MAX_VIEWS);
+			const ViewState& view_state = frame.view_states[ viewId ];
+
+			for( UINT iRT = 0; iRT < view_state.target_count; iRT++ )
+			{
+				if( !_color_targets.isAlive( view_state.color_targets[ iRT ].id ) ) {
+					onValidationError( "view uses non-existent color target", view_state.color_targets[ iRT ].id );
+				}
+			}
+			if( view_state.depth_target.IsValid() && !_depth_targets.isAlive( view_state.depth_target.id ) ) {
+				onValidationError( "view uses non-existent depth target", view_state.depth_target.id );
+			}
+
+			// bind default shader resources
+			const ShaderInputs& default_inputs = frame.view_inputs[ viewId ];
+			TCopyStaticArray( current_state.CBs, default_inputs.CBs );
+			TCopyStaticArray( current_state.SSs, default_inputs.SSs );
+			TCopyStaticArray( current_state.SRs, default_inputs.SRs );
+
+			_frame_stats.num_view_changes++;
+			_frame_stats.num_render_target_changes++;
+
+			currentViewId = viewId;
+		}
+
+		const char* command_list_start = (char*) mxAddByteOffset( command_buffer_start, item.start );
+		const char* command_list_end = mxAddByteOffset( command_list_start, item.size );
+		const char* current_command = command_list_start;
+
+		do
+		{
+			const RenderCommand* command_header = (RenderCommand*) current_command;
+			mxASSERT(CommandBuffer::IsProperlyAligned( command_header ));
+
+			U32					input_slot;
+			U32					resource_handle_value;
+			const ECommandType	command_type = command_header->decode(
+				&input_slot, &resource_handle_value
+				);
+
+			_frame_stats.num_commands++;
+
+			switch( command_type )
+			{
+			case CMD_DRAW:
+				{
+					const Cmd_Draw& draw_cmd = *(Cmd_Draw*) current_command;
+					const U32 instance_count = resource_handle_value;
+
+					if( !_programs.isAlive( draw_cmd.program.id ) ) {
+						onValidationError( "drawing with non-existent program", draw_cmd.program.id );
+					}
+					if( draw_cmd.input_layout.IsValid() && !_input_layouts.isAlive( draw_cmd.input_layout.id ) ) {
+						onValidationError( "drawing with non-existent input layout", draw_cmd.input_layout.id );
+					}
+					if( draw_cmd.VB.IsValid() && !_buffers.isAlive( draw_cmd.VB.id ) ) {
+						onValidationError( "drawing with non-existent vertex buffer", draw_cmd.VB.id );
+					}
+					if( draw_cmd.IB.IsValid() && !_buffers.isAlive( draw_cmd.IB.id ) ) {
+						onValidationError( "drawing with non-existent index buffer", draw_cmd.IB.id );
+					}
+
+					if( current_state.program != draw_cmd.program ) {
+						current_state.program = draw_cmd.program;
+						_frame_stats.num_program_changes++;
+					}
+					if( current_state.input_layout != draw_cmd.input_layout ) {
+						current_state.input_layout = draw_cmd.input_layout;
+						_frame_stats.num_input_layout_changes++;
+					}
+					if( current_state.VB != draw_cmd.VB ) {
+						current_state.VB = draw_cmd.VB;
+						_frame_stats.num_vertex_buffer_changes++;
+					}
+					if( current_state.IB != draw_cmd.IB ) {
+						current_state.IB = draw_cmd.IB;
+						_frame_stats.num_index_buffer_changes++;
+					}
+
+					const U32 num_vertices = draw_cmd.IB.IsValid() ? draw_cmd.index_count : draw_cmd.vertex_count;
+					const U32 num_instances = largest( instance_count, 1u );
+
+					_frame_stats.num_draw_calls++;
+					_frame_stats.num_instanced_draw_calls += (instance_count > 0);
+					_frame_stats.num_vertices += U64(num_vertices) * num_instances;
+
+					frame.perf_counters.c_draw_calls++;
+					frame.perf_counters.c_vertices += draw_cmd.vertex_count;
+					if( draw_cmd.primitive_topology == NwTopology::TriangleList ) {
+						frame.perf_counters.c_triangles += num_vertices / 3u * num_instances;
+					}
+
+					current_command += sizeof(Cmd_Draw);
+				} break;
+
+			case CMD_DISPATCH_CS:
+				{
+					const Cmd_DispatchCS& cmd_DispatchCS = *(Cmd_DispatchCS*) current_command;
+					if( !_programs.isAlive( cmd_DispatchCS.program.id ) ) {
+						onValidationError( "dispatching non-existent program", cmd_DispatchCS.program.id );
+					}
+					if( current_state.program != cmd_DispatchCS.program ) {
+						current_state.program = cmd_DispatchCS.program;
+						_frame_stats.num_program_changes++;
+					}
+					_frame_stats.num_dispatches++;
+					current_command += sizeof(Cmd_DispatchCS);
+				} break;
+
+#pragma region "Set* Commands"
+
+			case CMD_SET_CBUFFER:
+				{
+					const HBuffer handle( resource_handle_value );
+					mxASSERT(input_slot < LLGL_MAX_BOUND_UNIFORM_BUFFERS);
+					if( handle.IsValid() && !_buffers.isAlive( handle.id ) ) {
+						onValidationError( "binding non-existent constant buffer", handle.id );
+					}
+					bindToSlot( current_state.CBs, input_slot, handle, _frame_stats );
+					current_command += sizeof(Cmd_BindResource);
+				} break;
+
+			case CMD_SET_RESOURCE :
+				{
+					const HShaderInput handle( resource_handle_value );
+					mxASSERT(input_slot < LLGL_MAX_BOUND_SHADER_TEXTURES);
+					if( handle.IsValid() && !isShaderInputAlive( handle ) ) {
+						onValidationError( "binding non-existent shader resource", handle.id );
+					}
+					bindToSlot( current_state.SRs, input_slot, handle, _frame_stats );
+					current_command += sizeof(Cmd_BindResource);
+				} break;
+
+			case CMD_SET_SAMPLER :
+				{
+					const HSamplerState handle( resource_handle_value );
+					mxASSERT(input_slot < LLGL_MAX_BOUND_SHADER_SAMPLERS);
+					if( handle.IsValid() && !_sampler_states.isAlive( handle.id ) ) {
+						onValidationError( "binding non-existent sampler state", handle.id );
+					}
+					bindToSlot( current_state.SSs, input_slot, handle, _frame_stats );
+					current_command += sizeof(Cmd_BindResource);
+				} break;
+
+			case CMD_SET_UAV :
+				{
+					const HShaderOutput handle( resource_handle_value );
+					mxASSERT(input_slot < LLGL_MAX_BOUND_OUTPUT_BUFFERS);
+					if( handle.IsValid() && !isShaderOutputAlive( handle ) ) {
+						onValidationError( "binding non-existent UAV", handle.id );
+					}
+					bindToSlot( current_state.UAVs, input_slot, handle, _frame_stats );
+					current_command += sizeof(Cmd_BindResource);
+				} break;
+
+			case CMD_SET_RENDER_TARGETS:
+				{
+					const Cmd_SetRenderTargets& cmd = *(Cmd_SetRenderTargets*) current_command;
+					const RenderTargets& render_targets = cmd.render_targets;
+
+					for( UINT iRT = 0; iRT < render_targets.target_count; iRT++ )
+					{
+						if( !_color_targets.isAlive( render_targets.color_targets[ iRT ].id ) ) {
+							onValidationError( "binding non-existent color target", render_targets.color_targets[ iRT ].id );
+						}
+					}
+					if( render_targets.depth_target.IsValid() && !_depth_targets.isAlive( render_targets.depth_target.id ) ) {
+						onValidationError( "binding non-existent depth target", render_targets.depth_target.id );
+					}
+
+					_frame_stats.num_render_target_changes++;
+					current_command += sizeof(Cmd_SetRenderTargets);
+				} break;
+
+			case CMD_SET_VIEWPORT:
+				current_command += sizeof(Cmd_SetViewport);
+				break;
+
+			case CMD_SET_SCISSOR :
+				current_command += sizeof(Cmd_SetScissor);
+				break;
+
+			case CMD_SET_RENDER_STATE :
+				{
+					const Cmd_SetRenderState& cmd = *(Cmd_SetRenderState*) current_command;
+
+					// zero handles mean default states
+					if( cmd.blend_state.id && !_blend_states.isAlive( cmd.blend_state.id ) ) {
+						onValidationError( "non-existent blend state", cmd.blend_state.id );
+					}
+					if( cmd.rasterizer_state.id && !_rasterizer_states.isAlive( cmd.rasterizer_state.id ) ) {
+						onValidationError( "non-existent rasterizer state", cmd.rasterizer_state.id );
+					}
+					if( cmd.depth_stencil_state.id && !_depth_stencil_states.isAlive( cmd.depth_stencil_state.id ) ) {
+						onValidationError( "non-existent depth-stencil state", cmd.depth_stencil_state.id );
+					}
+
+					if( current_state.render_state.u != cmd.u ) {
+						current_state.render_state.u = cmd.u;
+						_frame_stats.num_render_state_changes++;
+					}
+					current_command += sizeof(Cmd_SetRenderState);
+				} break;
+
+#pragma endregion
+
+#pragma region "Update* Commands"
+
+			case CMD_UPDATE_BUFFER_OLD :
+				{
+					const GfxCommand_UpdateBuffer_OLD* cmd_UpdateBuffer = (GfxCommand_UpdateBuffer_OLD*) current_command;
+					const Memory *	new_contents = cmd_UpdateBuffer->new_contents;
+
+					this->updateBuffer( resource_handle_value, new_contents->getDataPtr(), new_contents->size );
+
+					current_command += sizeof(GfxCommand_UpdateBuffer_OLD) + cmd_UpdateBuffer->bytes_to_skip_after_this_command;
+
+					if( !memoryFollowsCommand( new_contents, cmd_UpdateBuffer ) )
+					{
+						NGpu::releaseMemory( new_contents );
+					}
+				} break;
+
+			case CMD_UPDATE_BUFFER :
+				{
+					const Cmd_UpdateBuffer* update_buffer_cmd = (Cmd_UpdateBuffer*) current_command;
+
+					this->updateBuffer( resource_handle_value, update_buffer_cmd->data, update_buffer_cmd->size );
+
+					current_command += sizeof(*update_buffer_cmd);
+
+					if( update_buffer_cmd->deallocator ) {
+						update_buffer_cmd->deallocator->Deallocate( (void*) update_buffer_cmd->data );
+					}
+				} break;
+
+			case CMD_BIND_CONSTANTS:
+				{
+					const Cmd_BindConstants& cmd = *(Cmd_BindConstants*) current_command;
+					mxASSERT(input_slot < LLGL_MAX_BOUND_UNIFORM_BUFFERS);
+
+					if( cmd.size > UniformBufferPoolHandles::MAX_POOLED_CB_SIZE ) {
+						onValidationError( "constants don't fit into pooled uniform buffers", cmd.size );
+					}
+
+					// the D3D11 back-end uploads the data into a pooled buffer and binds it
+					current_state.CBs[ input_slot ].SetNil();
+					_frame_stats.num_resource_bindings++;
+					_frame_stats.num_buffer_updates++;
+					_frame_stats.num_uploaded_bytes += cmd.size;
+
+					current_command = (char*) cmd.GetNextCommandPtr();
+				} break;
+
+			case CMD_BIND_PUSH_CONSTANTS:
+				{
+					const Cmd_BindPushConstants& cmd = *(Cmd_BindPushConstants*) current_command;
+					const HBuffer buffer_handle( resource_handle_value );
+					mxASSERT(input_slot < LLGL_MAX_BOUND_UNIFORM_BUFFERS);
+
+					if( buffer_handle.IsValid() )
+					{
+						this->updateBuffer( buffer_handle.id, cmd.GetConstantsData()._data, cmd.size_of_push_constants );
+						bindToSlot( current_state.CBs, input_slot, buffer_handle, _frame_stats );
+					}
+					else
+					{
+						current_state.CBs[ input_slot ].SetNil();
+						_frame_stats.num_resource_bindings++;
+						_frame_stats.num_buffer_updates++;
+						_frame_stats.num_uploaded_bytes += cmd.size_of_push_constants;
+					}
+
+					current_command = (char*) cmd.GetNextCommandPtr();
+				} break;
+
+			case CMD_UPDATE_TEXTURE :
+				{
+					// not implemented in the D3D11 back-end yet
+					const Cmd_UpdateTexture& cmd_UpdateTexture = *(Cmd_UpdateTexture*) current_command;
+					if( !_textures.isAlive( resource_handle_value ) ) {
+						onValidationError( "updating non-existent texture", resource_handle_value );
+					}
+					if( cmd_UpdateTexture.deallocator ) {
+						cmd_UpdateTexture.deallocator->Deallocate( (void*) cmd_UpdateTexture.data );
+					}
+					current_command += sizeof(Cmd_UpdateTexture);
+				} break;
+
+#pragma endregion
+
+			case CMD_GENERATE_MIPS :
+				{
+					const HShaderInput handle( resource_handle_value );
+					if( !isShaderInputAlive( handle ) ) {
+						onValidationError( "generating mips of non-existent resource", handle.id );
+					}
+					current_command += sizeof(Cmd_GenerateMips);
+				} break;
+
+			case CMD_CLEAR_RENDER_TARGETS :
+				{
+					const Cmd_ClearRenderTargets& cmd = *(Cmd_ClearRenderTargets*) current_command;
+					for( UINT iRT = 0; iRT < cmd.target_count; iRT++ )
+					{
+						if( !_color_targets.isAlive( cmd.color_targets[ iRT ].id ) ) {
+							onValidationError( "clearing non-existent color target", cmd.color_targets[ iRT ].id );
+						}
+					}
+					current_command += sizeof(Cmd_ClearRenderTargets);
+				} break;
+
+			case CMD_CLEAR_DEPTH_STENCIL_VIEW :
+				{
+					const Cmd_ClearDepthStencilView& cmd = *(Cmd_ClearDepthStencilView*) current_command;
+					if( !_depth_targets.isAlive( cmd.depth_target.id ) ) {
+						onValidationError( "clearing non-existent depth target", cmd.depth_target.id );
+					}
+					current_command += sizeof(Cmd_ClearDepthStencilView);
+				} break;
+
+			case CMD_COPY_TEXTURE:
+				{
+					const Cmd_CopyTexture& cmd = *(Cmd_CopyTexture*) current_command;
+					if( !_textures.isAlive( cmd.src_texture_handle.id ) || !_textures.isAlive( cmd.dst_texture_handle.id ) ) {
+						onValidationError( "copying non-existent texture", cmd.src_texture_handle.id );
+					}
+					current_command += sizeof(Cmd_CopyTexture);
+				} break;
+
+			case CMD_COPY_RESOURCE:
+				{
+					const Cmd_CopyResource& cmd = *(Cmd_CopyResource*) current_command;
+					if( !_buffers.isAlive( cmd.source.id ) || !_buffers.isAlive( cmd.destination.id ) ) {
+						onValidationError( "copying non-existent buffer", cmd.source.id );
+					}
+					current_command += sizeof(Cmd_CopyResource);
+				} break;
+
+			case CMD_MAP_READ:
+				{
+					// there is no data to read back, the callback is not called
+					// (the D3D11 back-end doesn't call it either if the data is not ready yet)
+					const Cmd_MapRead& cmd = *(Cmd_MapRead*) current_command;
+					if( !_buffers.isAlive( cmd.buffer.id ) ) {
+						onValidationError( "reading non-existent buffer", cmd.buffer.id );
+					}
+					current_command += sizeof(Cmd_MapRead);
+				} break;
+
+			case CMD_PUSH_MARKER :
+				{
+					const Cmd_PushMarker& cmd_PushMarker = *(Cmd_PushMarker*) current_command;
+					current_command += sizeof(Cmd_PushMarker) + cmd_PushMarker.skip;
+				} break;
+
+			case CMD_POP_MARKER :
+				current_command += sizeof(Cmd_PopMarker);
+				break;
+
+			case CMD_SET_MARKER :
+				{
+					const Cmd_SetMarker& cmd_SetMarker = *(Cmd_SetMarker*) current_command;
+					current_command += sizeof(Cmd_SetMarker) + cmd_SetMarker.skip;
+				} break;
+
+			case CMD_DBG_PRINT :
+				{
+					const Cmd_DbgPrint& cmd_DbgPrint = *(Cmd_DbgPrint*) current_command;
+					current_command += sizeof(Cmd_DbgPrint) + cmd_DbgPrint.skip;
+				} break;
+
+			case CMD_NOP :
+				{
+					const Cmd_NOP& cmd_NOP = *(Cmd_NOP*) current_command;
+					current_command += sizeof(Cmd_NOP) + cmd_NOP.bytes_to_skip_after_this_command;
+				} break;
+
+			default:
+				// the size of the command is unknown - skip the rest of the command list
+				onValidationError( "unknown command", command_type );
+				current_command = command_list_end;
+			}//switch( command_type )
+		}
+		while( current_command < command_list_end );
+	}//For each command list.
+
+	//
+	_frame_stats.buffer_memory = _buffers.total_size;
+	_frame_stats.texture_memory = _textures.total_size;
+	_frame_stats.render_target_memory = _color_targets.total_size + _depth_targets.total_size;
+	_frame_stats.num_live_resources
+		= _depth_stencil_states.num_alive
+		+ _rasterizer_states.num_alive
+		+ _sampler_states.num_alive
+		+ _blend_states.num_alive
+		+ _color_targets.num_alive
+		+ _depth_targets.num_alive
+		+ _input_layouts.num_alive
+		+ _buffers.num_alive
+		+ _textures.num_alive
+		+ _shaders.num_alive
+		+ _programs.num_alive
+		;
+	_frame_stats.num_validation_errors = _num_validation_errors;
+
+	{
+		SpinWait::Lock	scopedLock( _last_frame_stats_lock );
+		_last_frame_stats = _frame_stats;
+	}
+}
+
+void BackendNull::getLastFrameStats( NullBackendStats *stats_ )
+{
+	SpinWait::Lock	scopedLock( _last_frame_stats_lock );
+	*stats_ = _last_frame_stats;
+}
+
+#if MX_DEVELOPER
+
+namespace
+{
+	enum { TEST_VERTEX_BUFFER_SIZE = 1024 };
+
+	ERet renderTestFrames(
+		const HProgram program_handle
+		, const HBuffer vertex_buffer_handle
+		, const U32 num_frames
+		, const U32 num_draws_per_frame
+		)
+	{
+		HInputLayout	nil_input_layout;
+		nil_input_layout.SetNil();
+
+		HBuffer	nil_index_buffer;
+		nil_index_buffer.SetNil();
+
+		for( U32 iFrame = 0; iFrame < num_frames; iFrame++ )
+		{
+			NwRenderContext & render_context = getMainRenderContext();
+
+			for( U32 iDraw = 0; iDraw < num_draws_per_frame; iDraw++ )
+			{
+				RenderCommandWriter	cmd_writer( render_context );
+
+				Cmd_Draw	draw_command;
+				draw_command.program = program_handle;
+				draw_command.SetMeshState(
+					nil_input_layout
+					, vertex_buffer_handle
+					, nil_index_buffer
+					, NwTopology::TriangleList
+					, false
+					);
+				draw_command.vertex_count = 3;
+
+				mxDO(cmd_writer.Draw( draw_command ));
+
+				cmd_writer.SubmitCommandsWithSortKey(
+					buildSortKey( 0, program_handle, iDraw )
+					nwDBG_CMD_SRCFILE_STRING
+					);
+			}
+
+			mxDO(NextFrame());
+		}
+
+		return ALL_OK;
+	}
+
+	ERet checkTestFrameStats(
+		const NullBackendStats& stats
+		, const U32 num_draws_per_frame
+		)
+	{
+		ptPRINT("Null back-end: %u commands, %u draw calls, %u program changes, %u live resources, %u bytes of buffers",
+			stats.num_commands, stats.num_draw_calls, stats.num_program_changes, stats.num_live_resources, (U32) stats.buffer_memory
+			);
+
+		mxENSURE(stats.num_draw_calls == num_draws_per_frame, ERR_UNKNOWN_ERROR,
+			"expected %u draw calls, got %u", num_draws_per_frame, stats.num_draw_calls
+			);
+		mxENSURE(stats.num_vertices == U64(num_draws_per_frame) * 3, ERR_UNKNOWN_ERROR,
+			"wrong vertex count: %u", (U32) stats.num_vertices
+			);
+		mxENSURE(stats.num_program_changes == (num_draws_per_frame > 0), ERR_UNKNOWN_ERROR,
+			"the draw calls use the same program, but got %u program changes", stats.num_program_changes
+			);
+		mxENSURE(stats.buffer_memory >= TEST_VERTEX_BUFFER_SIZE, ERR_UNKNOWN_ERROR,
+			"the test vertex buffer is not counted"
+			);
+		mxENSURE(stats.num_validation_errors == 0, ERR_VALIDATION_FAILED,
+			"%u validation errors", stats.num_validation_errors
+			);
+		return ALL_OK;
+	}
+}//namespace
+
+ERet UnitTest_NullBackend(
+	const U32 num_frames
+	, const U32 num_draws_per_frame
+	)
+{
+	mxENSURE(!isInitialized(), ERR_INVALID_FUNCTION_CALL,
+		"the test initializes the graphics system with the null back-end"
+		);
+	mxENSURE(num_frames > 0, ERR_INVALID_PARAMETER, "");
+
+	Settings	settings;
+	settings.use_null_backend = true;
+	mxDO(Initialize( settings ));
+
+	//
+	const U32	dummy_bytecode[4] = { 0 };
+
+	NwProgramDescription	program_description;
+	program_description.shaders[ NwShaderType::Vertex ] = CreateShader( copy( dummy_bytecode, sizeof(dummy_bytecode) ) );
+	program_description.shaders[ NwShaderType::Pixel ] = CreateShader( copy( dummy_bytecode, sizeof(dummy_bytecode) ) );
+	HProgram	program_handle = CreateProgram( program_description );
+
+	NwBufferDescription	buffer_description(_InitDefault);
+	buffer_description.type = Buffer_Vertex;
+	buffer_description.size = TEST_VERTEX_BUFFER_SIZE;
+	const HBuffer	vertex_buffer_handle = CreateBuffer( buffer_description, nil, "NullBackendTestVB" );
+
+	//
+	ERet result = renderTestFrames( program_handle, vertex_buffer_handle, num_frames, num_draws_per_frame );
+
+	NullBackendStats	stats;
+	if( mxSUCCEDED(result) )
+	{
+		getNullBackendStats( &stats );
+		result = checkTestFrameStats( stats, num_draws_per_frame );
+	}
+
+	//
+	DeleteBuffer( vertex_buffer_handle );
+	DeleteProgram( program_handle );
+	DeleteShader( program_description.shaders[ NwShaderType::Vertex ] );
+	DeleteShader( program_description.shaders[ NwShaderType::Pixel ] );
+
+	if( mxSUCCEDED(result) )
+	{
+		// the deletion commands must not refer to dead resources
+		result = NextFrame();
+		getNullBackendStats( &stats );
+		mxASSERT(stats.num_validation_errors == 0);
+		if( stats.num_validation_errors ) {
+			ptERROR("%u validation errors after deleting the resources", stats.num_validation_errors);
+			result = ERR_VALIDATION_FAILED;
+		}
+	}
+
+	Shutdown();
+
+	return result;
+}
+
+#endif // MX_DEVELOPER
+
+}//namespace NGpu
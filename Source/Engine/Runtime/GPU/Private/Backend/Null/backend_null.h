@@ -0,0 +1,226 @@
+/*
+=============================================================================
+	The null back-end: executes the frame commands without a GPU.
+	Used for benchmarking/testing the CPU side of the renderer
+	(the front-end, command encoding and sorting, scene rendering)
+	in headless environments, e.g. on build servers.
+=============================================================================
+*/
+#pragma once
+
+#include <GPU/Private/Frontend/frontend.h>
+#include <GPU/Private/Backend/backend.h>
+
+
+namespace NGpu
+{
+	///
+	/// Keeps track of created resource handles and their (would-be) sizes in GPU memory.
+	///
+	template< UINT MAX_RESOURCES >
+	struct TResourceTableNull
+	{
+		U32		sizes[ MAX_RESOURCES ];	//!< estimated sizes in GPU memory, in bytes
+		bool	alive[ MAX_RESOURCES ];
+		U64		total_size;
+		U32		num_alive;
+
+	public:
+		TResourceTableNull()
+		{
+			mxZERO_OUT(*this);
+		}
+
+		bool isAlive( const unsigned index ) const
+		{
+			return index < MAX_RESOURCES && alive[ index ];
+		}
+
+		/// returns false if the index is out of range or the resource already exists
+		bool onCreate( const unsigned index, const U32 size )
+		{
+			if( index >= MAX_RESOURCES || alive[ index ] ) {
+				return false;
+			}
+			sizes[ index ] = size;
+			alive[ index ] = true;
+			total_size += size;
+			num_alive++;
+			return true;
+		}
+
+		/// returns false if the resource doesn't exist
+		bool onDelete( const unsigned index )
+		{
+			if( !isAlive( index ) ) {
+				return false;
+			}
+			total_size -= sizes[ index ];
+			sizes[ index ] = 0;
+			alive[ index ] = false;
+			num_alive--;
+			return true;
+		}
+	};
+
+	///
+	/// Doesn't render anything, but validates resource handles in the command stream,
+	/// tracks the would-be GPU memory usage and counts draw calls and state changes.
+	///
+	struct BackendNull: AGraphicsBackend
+	{
+		TResourceTableNull< LLGL_MAX_DEPTH_STENCIL_STATES >	_depth_stencil_states;
+		TResourceTableNull< LLGL_MAX_RASTERIZER_STATES >	_rasterizer_states;
+		TResourceTableNull< LLGL_MAX_SAMPLER_STATES >		_sampler_states;
+		TResourceTableNull< LLGL_MAX_BLEND_STATES >			_blend_states;
+
+		TResourceTableNull< LLGL_MAX_COLOR_TARGETS >	_color_targets;
+		TResourceTableNull< LLGL_MAX_DEPTH_TARGETS >	_depth_targets;
+
+		TResourceTableNull< LLGL_MAX_INPUT_LAYOUTS >	_input_layouts;
+
+		TResourceTableNull< LLGL_MAX_BUFFERS >		_buffers;
+		TResourceTableNull< LLGL_MAX_TEXTURES >		_textures;
+
+		TResourceTableNull< LLGL_MAX_SHADERS >		_shaders;
+		TResourceTableNull< LLGL_MAX_PROGRAMS >		_programs;
+
+		/// the back buffer, not counted in render target memory
+		HColorTarget	_framebuffer_handle;
+
+		NullBackendStats	_frame_stats;		//!< being collected
+		NullBackendStats	_last_frame_stats;	//!< for reading on the main thread
+		SpinWait			_last_frame_stats_lock;	//!< written on the render thread, read on the main thread
+
+		U32		_num_validation_errors;
+
+		AllocatorI &	_allocator;
+
+	public:
+		BackendNull( AllocatorI & allocator );
+		~BackendNull();
+
+		//
+		// AGraphicsBackend
+		//
+
+		virtual ERet Initialize(
+			const CreationInfo& settings
+			, Capabilities &caps_
+			, PlatformData &platform_data_
+			) override;
+
+		virtual void Shutdown() override;
+
+		virtual bool isDeviceRemoved() const override;
+
+		//
+		virtual void createColorTarget(
+			const unsigned index
+			, const NwColorTargetDescription& description
+			, const char* debug_name
+			) override;
+		virtual void deleteColorTarget( const unsigned index ) override;
+
+		virtual void createDepthTarget(
+			const unsigned index
+			, const NwDepthTargetDescription& description
+			, const char* debug_name
+			) override;
+		virtual void deleteDepthTarget( const unsigned index ) override;
+
+		//
+		virtual void createTexture(
+			const unsigned index
+			, const Memory* initial_data
+			, const GrTextureCreationFlagsT flags
+			, const char* debug_name
+			) override;
+
+		virtual void createTexture2D(
+			const unsigned index
+			, const NwTexture2DDescription& description
+			, const Memory* initial_data
+			, const char* debug_name
+			) override;
+
+		virtual void createTexture3D(
+			const unsigned index
+			, const NwTexture3DDescription& description
+			, const Memory* initial_data
+			, const char* debug_name
+			) override;
+
+		virtual void deleteTexture( const unsigned index ) override;
+
+		//
+		virtual void createDepthStencilState(
+			const unsigned index
+			, const NwDepthStencilDescription& description
+			, const char* debug_name
+			) override;
+		virtual void deleteDepthStencilState( const unsigned index ) override;
+
+		virtual void createRasterizerState(
+			const unsigned index
+			, const NwRasterizerDescription& description
+			, const char* debug_name
+			) override;
+		virtual void deleteRasterizerState( const unsigned index ) override;
+
+		virtual void createSamplerState(
+			const unsigned index
+			, const NwSamplerDescription& description
+			, const char* debug_name
+			) override;
+		virtual void deleteSamplerState( const unsigned index ) override;
+
+		virtual void createBlendState(
+			const unsigned index
+			, const NwBlendDescription& description
+			, const char* debug_name
+			) override;
+		virtual void deleteBlendState( const unsigned index ) override;
+
+		//
+		virtual void createInputLayout(
+			const unsigned index
+			, const NwVertexDescription& description
+			, const char* debug_name
+			) override;
+		virtual void deleteInputLayout( const unsigned index ) override;
+
+		virtual ERet createBuffer(
+			const unsigned index
+			, const NwBufferDescription& description
+			, const Memory* initial_data
+			, const char* debug_name
+			) override;
+		virtual void deleteBuffer( const unsigned index ) override;
+
+		//
+		virtual void createShader( const unsigned index, const Memory* shader_binary ) override;
+		virtual void deleteShader( const unsigned index ) override;
+
+		virtual void createProgram( const unsigned index, const NwProgramDescription& description ) override;
+		virtual void deleteProgram( const unsigned index ) override;
+
+		//
+		virtual void updateBuffer( const unsigned index, const void* data, const unsigned size ) override;
+		virtual void UpdateTexture( const unsigned index, const NwTextureRegion& region, const Memory* new_contents ) override;
+
+		//
+		virtual void renderFrame( Frame & frame, const RunTimeSettings& settings ) override;
+
+	public:
+		/// thread-safe: returns a copy of the stats of the last rendered frame
+		void getLastFrameStats( NullBackendStats *stats_ );
+
+	private:
+		void onValidationError( const char* message, const unsigned handle_value );
+
+		bool isShaderInputAlive( const HShaderInput handle ) const;
+		bool isShaderOutputAlive( const HShaderOutput handle ) const;
+	};
+
+}//namespace NGpu
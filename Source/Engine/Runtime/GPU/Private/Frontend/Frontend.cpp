@@ -21,6 +21,8 @@
 	#include <GPU/Private/Backend/opengl/backend_opengl4.h>
 #endif
 
+#include <GPU/Private/Backend/Null/backend_null.h>
+
 #define DBG_CODE(...)	(__VA_ARGS__)
 
 
@@ -175,10 +177,12 @@ public:
 
 	ERet init( const Settings& settings )
 	{
+		// construct all frames first so that releaseMemory() is safe if init() fails
 		for( int i = 0; i < NUM_BUFFERED_FRAMES; i++ ) {
-			Frame &frame = ((Frame*) frames_data) [i];
-			new( &frame ) Frame( object_allocator );
-			mxDO(frame.init());
+			new( &((Frame*) frames_data) [i] ) Frame( object_allocator );
+		}
+		for( int i = 0; i < NUM_BUFFERED_FRAMES; i++ ) {
+			mxDO(((Frame*) frames_data) [i].init());
 		}
 
 		frame_to_submit = & ((Frame*) frames_data) [0];
@@ -186,21 +190,31 @@ public:
 
 		num_rendered_frames = 0;
 
+		if( settings.use_null_backend )
+		{
+			runtime_settings.width = settings.null_backend_resolution.width;
+			runtime_settings.height = settings.null_backend_resolution.height;
+			runtime_settings.device = settings.device;
+		}
+		else
+		{
 #if (mxPLATFORM == mxPLATFORM_WINDOWS)
-		HWND hWnd = (HWND) settings.window_handle;
+			HWND hWnd = (HWND) settings.window_handle;
 
-		RECT rect;
-		::GetClientRect(hWnd, &rect);
+			RECT rect;
+			::GetClientRect(hWnd, &rect);
 
-		const UINT width = rect.right - rect.left;
-		const UINT height = rect.bottom - rect.top;
+			const UINT width = rect.right - rect.left;
+			const UINT height = rect.bottom - rect.top;
 
-		runtime_settings.width = width;
-		runtime_settings.height = height;
-		runtime_settings.device = settings.device;
+			runtime_settings.width = width;
+			runtime_settings.height = height;
+			runtime_settings.device = settings.device;
 #else
-#		error Unsupported platform!
+			ptERROR("Only the null back-end is supported on this platform!");
+			return ERR_UNSUPPORTED_FEATURE;
 #endif
+		}
 
 		//
 		mxZERO_OUT(device_caps);
@@ -239,6 +253,7 @@ private:
 
 static GraphicsFrontEnd *	s_frontend = nil;
 static AGraphicsBackend *	s_backend = nil;
+static BackendNull *		s_null_backend = nil;	// only for reading stats
 
 Settings::Settings()
 {
@@ -246,6 +261,10 @@ Settings::Settings()
 
 	create_debug_device = false;
 
+	use_null_backend = false;
+	null_backend_resolution.width = 1280;
+	null_backend_resolution.height = 720;
+
 	max_gfx_cmds = 4096;
 	cmd_buf_size = mxMiB(24);
 
@@ -266,31 +285,66 @@ Frame& getFrameToSubmit()
 	return *s_frontend->frame_to_submit;
 }
 
-ERet Initialize( const Settings& settings )
+static ERet initFrontEndAndCreateBackEnd( const Settings& settings, AllocatorI & object_allocator )
 {
-	chkRET_X_IF_NIL(settings.window_handle, ERR_NULL_POINTER_PASSED);
+	mxDO(s_frontend->init( settings ));
 
-	AllocatorI &	object_allocator = (settings.object_allocator != nil)
-		? *settings.object_allocator : MemoryHeaps::graphics();
+	//
 
-	AllocatorI &	scratch_allocator = (settings.scratch_allocator != nil)
-		? *settings.scratch_allocator : MemoryHeaps::temporary();
+	mxDO(s_frontend->postInit( settings ));
 
-	//
-	s_frontend = mxNEW( object_allocator, GraphicsFrontEnd, object_allocator, scratch_allocator );
 
-	mxDO(s_frontend->init( settings ));
+	// Start a thread dedicated to rendering.
+
 
 	//
+	if( settings.use_null_backend )
+	{
+		s_null_backend = mxNEW( object_allocator, BackendNull, object_allocator );
+		chkRET_X_IF_NIL(s_null_backend, ERR_OUT_OF_MEMORY);
+		s_backend = s_null_backend;
+	}
+	else
+	{
+#if (LLGL_Driver == LLGL_Driver_Direct3D_11)
+		s_backend = mxNEW( object_allocator, BackendD3D11, object_allocator );
+		chkRET_X_IF_NIL(s_backend, ERR_OUT_OF_MEMORY);
+#else
+		return ERR_UNSUPPORTED_FEATURE;
+#endif
+	}
 
-	mxDO(s_frontend->postInit( settings ));
+	return ALL_OK;
+}
 
+ERet Initialize( const Settings& settings )
+{
+	if( !settings.use_null_backend ) {
+		chkRET_X_IF_NIL(settings.window_handle, ERR_NULL_POINTER_PASSED);
+	}
 
-	// Start a thread dedicated to rendering.
+	AllocatorI &	object_allocator = (settings.object_allocator != nil)
+		? *settings.object_allocator : MemoryHeaps::graphics();
 
+	AllocatorI &	scratch_allocator = (settings.scratch_allocator != nil)
+		? *settings.scratch_allocator : MemoryHeaps::temporary();
 
 	//
-	s_backend = mxNEW( object_allocator, BackendD3D11, object_allocator );
+	s_frontend = mxNEW( object_allocator, GraphicsFrontEnd, object_allocator, scratch_allocator );
+	chkRET_X_IF_NIL(s_frontend, ERR_OUT_OF_MEMORY);
+
+	const ERet ret = initFrontEndAndCreateBackEnd( settings, object_allocator );
+	if( mxFAILED(ret) )
+	{
+		// the back-end has not been initialized yet - just free the memory
+		for( int i = 0; i < NUM_BUFFERED_FRAMES; i++ ) {
+			((Frame*) s_frontend->frames_data) [i].releaseTransientBuffers();
+		}
+		mxDELETE_AND_NIL( s_backend, object_allocator );
+		s_null_backend = nil;
+		mxDELETE_AND_NIL( s_frontend, object_allocator );
+		return ret;
+	}
 
 	addCommandToInitializeBackEnd( settings );
 
@@ -440,6 +494,7 @@ void Shutdown()
 	checkHandleLeaks();
 
 	mxDELETE_AND_NIL( s_backend, s_frontend->object_allocator );
+	s_null_backend = nil;
 	mxDELETE_AND_NIL( s_frontend, s_frontend->object_allocator );
 }
 
@@ -1735,6 +1790,15 @@ void getFrontEndStats( FrontEndStats* front_end_stats_ )
 	front_end_stats_->num_created_programs = s_frontend->program_handles.getNumHandles();
 }
 
+bool getNullBackendStats( NullBackendStats *null_backend_stats_ )
+{
+	if( !s_null_backend ) {
+		return false;
+	}
+	s_null_backend->getLastFrameStats( null_backend_stats_ );
+	return true;
+}
+
 const Capabilities getCapabilities()
 {
 	mxASSERT(s_frontend->num_rendered_frames > 0);
@@ -56,6 +56,13 @@ namespace NGpu
 		/// D3D11_CREATE_DEVICE_DEBUG
 		bool	create_debug_device;
 
+		/// Don't create a window/device: the frame commands are validated and counted by the null back-end
+		/// (for benchmarking the CPU side of the renderer in headless environments).
+		bool	use_null_backend;
+
+		/// the back buffer size of the null back-end (the window size is used otherwise)
+		NwResolution	null_backend_resolution;
+
 		DeviceSettings	device;
 
 		// hints to minimize memory (re-)allocations
@@ -361,6 +368,52 @@ namespace NGpu
 	};
 	void getFrontEndStats( FrontEndStats* front_end_stats_ );
 
+	/// Collected by the null back-end (see Settings::use_null_backend).
+	struct NullBackendStats
+	{
+		// the last rendered frame:
+
+		U32	num_commands;
+		U32	num_draw_calls;
+		U32	num_instanced_draw_calls;
+		U32	num_dispatches;
+		U64	num_vertices;		//!< the number of vertices/indices times the number of instances
+		U32	num_view_changes;
+		U32	num_program_changes;
+		U32	num_input_layout_changes;
+		U32	num_vertex_buffer_changes;
+		U32	num_index_buffer_changes;
+		U32	num_render_state_changes;
+		U32	num_render_target_changes;
+		U32	num_resource_bindings;	//!< CB/SRV/sampler/UAV bindings that changed the bound resource
+		U32	num_redundant_bindings;	//!< the resource was already bound to the slot
+		U32	num_buffer_updates;		//!< including CMD_BIND_CONSTANTS and transient buffer uploads
+		U64	num_uploaded_bytes;
+
+		// would-be GPU memory (at the end of the last frame):
+
+		U64	buffer_memory;
+		U64	texture_memory;
+		U64	render_target_memory;	//!< color and depth targets, excluding the back buffer
+		U32	num_live_resources;
+
+		// accumulated since initialization:
+
+		U32	num_validation_errors;	//!< e.g. using deleted or never created resources
+	};
+
+	/// Returns false if the null back-end is not used.
+	bool getNullBackendStats( NullBackendStats *null_backend_stats_ );
+
+#if MX_DEVELOPER
+	/// Initializes the graphics system with the null back-end (it must not be initialized yet),
+	/// renders a few frames with dummy draw calls, checks the NullBackendStats and shuts down.
+	ERet UnitTest_NullBackend(
+		const U32 num_frames = 8
+		, const U32 num_draws_per_frame = 100
+		);
+#endif // MX_DEVELOPER
+
 	/// Renderer statistics data.
 	///
 	/// @attention C99 equivalent is `bgfx_stats_t`.
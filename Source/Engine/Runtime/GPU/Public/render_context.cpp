@@ -1,6 +1,7 @@
 #include <Base/Base.h>
 #pragma hdrstop
 #include <algorithm>	// std::sortkey(), std::stable_sort()
+#include <Base/Template/Algorithm/RadixSort.h>
 #include <GPU/Public/render_context.h>
 
 
@@ -10,6 +11,7 @@ namespace NGpu
 NwRenderContext::NwRenderContext( AllocatorI & _allocator )
 	: _sort_items( _allocator )
 	, _command_buffer( _allocator )
+	, _sort_items_temp( _allocator )
 {
 }
 
@@ -39,16 +41,69 @@ void NwRenderContext::reset()
 
 void NwRenderContext::Sort()
 {
-	struct Predicate
+	struct GetSortKey
 	{
-		static inline bool Compare( const SortItem& a, const SortItem& b )
+		mxFORCEINLINE U64 operator()( const SortItem& item ) const
 		{
-			return a.sortkey < b.sortkey;
+			return item.sortkey;
 		}
 	};
 
-	std::sort( _sort_items.begin(), _sort_items.end(), Predicate::Compare );
-	//std::stable_sort( _sort_items.begin(), _sort_items.end(), Predicate::Compare );
+	const U32 num_items = _sort_items.num();
+	if( num_items < 2 ) {
+		return;
+	}
+
+	if(mxFAILED( _sort_items_temp.setNum( num_items ) ))
+	{
+		struct Predicate
+		{
+			static inline bool Compare( const SortItem& a, const SortItem& b )
+			{
+				return a.sortkey < b.sortkey;
+			}
+		};
+		std::stable_sort( _sort_items.begin(), _sort_items.end(), Predicate::Compare );
+		return;
+	}
+
+	const SortItem* sorted_items = RadixSort64_AscendingOrder(
+		_sort_items.raw(), _sort_items_temp.raw(), num_items, GetSortKey()
+		);
+	if( sorted_items != _sort_items.raw() ) {
+		memcpy( _sort_items.raw(), sorted_items, num_items * sizeof(sorted_items[0]) );
+	}
+}
+
+ERet NwRenderContext::Append( const NwRenderContext& other )
+{
+	const U32 num_items_to_append = other._sort_items.num();
+	const U32 command_data_size = other._command_buffer.currentOffset();
+
+	if( !num_items_to_append ) {
+		return ALL_OK;
+	}
+
+	// keep the alignment of the data inside the copied commands
+	void *	copied_commands;
+	mxDO(_command_buffer.AllocateSpace( &copied_commands, command_data_size, EFFICIENT_ALIGNMENT - 1 ));
+	memcpy( copied_commands, other._command_buffer.getStart(), command_data_size );
+
+	const U32 start_offset = mxGetByteOffset32( _command_buffer.getStart(), copied_commands );
+
+	const U32 old_num_items = _sort_items.num();
+	mxDO(_sort_items.setNum( old_num_items + num_items_to_append ));
+
+	SortItem * dst_items = _sort_items.raw() + old_num_items;
+	const SortItem * src_items = other._sort_items.raw();
+
+	for( U32 i = 0; i < num_items_to_append; i++ )
+	{
+		dst_items[i] = src_items[i];
+		dst_items[i].start += start_offset;
+	}
+
+	return ALL_OK;
 }
 
 ERet NwRenderContext::Submit(
@@ -39,6 +39,9 @@ namespace NGpu
 		DynamicArray< SortItem >	_sort_items;//!< keys for sorting commands
 		CommandBuffer				_command_buffer;
 
+		/// scratch memory for the radix sort, kept between frames
+		DynamicArray< SortItem >	_sort_items_temp;
+
 	public:
 		NwRenderContext( AllocatorI & _allocator );
 
@@ -56,9 +59,17 @@ namespace NGpu
 			const char* debug_linenum = nil
 		);
 
+		/// Appends the commands recorded into another context (e.g. on a worker thread).
+		/// The commands are copied, the other context can be reset afterwards.
+		/// NOTE: the commands must not point into their command buffer
+		/// (e.g. CMD_UPDATE_BUFFER_OLD with the data following the command, see CommandBufferWriter::allocateUpdateBufferCommandWithData()),
+		/// use CMD_BIND_PUSH_CONSTANTS (the data is addressed by relative offsets) or external memory instead.
+		ERet Append( const NwRenderContext& other );
+
 		/// the sorter cannot reorder commands between sequences
 		//void nextSequence();
 
+		/// Sorts the commands by their keys (LSD radix sort, stable: the commands with equal keys keep the submission order).
 		void Sort();
 
 	public:
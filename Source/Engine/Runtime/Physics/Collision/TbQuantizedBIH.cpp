@@ -2,6 +2,9 @@
 #include <Base/Base.h>
 #pragma hdrstop
 
+#include <algorithm>	// std::sort()
+
+#include <Base/Math/Random.h>
 #include <Graphics/Public/graphics_utilities.h>
 
 #include <Utility/MeshLib/TriMesh.h>
@@ -506,6 +509,436 @@ mxBUG("commented out, because some collsions are missed");
 	}//while node stack is not empty
 }
 
+/*
+-----------------------------------------------------------------------------
+	Batched triangle queries
+-----------------------------------------------------------------------------
+*/
+namespace
+{
+	/// the number of triangles gathered from leaves before they are decoded and tested
+	enum { TRIANGLE_BATCH_SIZE = 8 };
+
+	/// decodes 4 quantized vertex positions into SoA form (x,y,z in [0..1])
+	static mxFORCEINLINE
+	void DecodeVertices4( const U32 quantized_vertices[4]
+		, Vector4 &x_, Vector4 &y_, Vector4 &z_
+		)
+	{
+		// (11;11;10)
+		const __m128i packed = _mm_load_si128( (const __m128i*) quantized_vertices );
+		const __m128i mask11 = _mm_set1_epi32( TQuantize<11>::MaxInteger );
+
+		const __m128i ix = _mm_and_si128( packed, mask11 );
+		const __m128i iy = _mm_and_si128( _mm_srli_epi32( packed, 11 ), mask11 );
+		const __m128i iz = _mm_srli_epi32( packed, 22 );
+
+		// must match TQuantize<>::DecodeUNorm() exactly
+		x_ = _mm_mul_ps( _mm_cvtepi32_ps( ix ), _mm_set1_ps( 1.0f / TQuantize<11>::MaxInteger ) );
+		y_ = _mm_mul_ps( _mm_cvtepi32_ps( iy ), _mm_set1_ps( 1.0f / TQuantize<11>::MaxInteger ) );
+		z_ = _mm_mul_ps( _mm_cvtepi32_ps( iz ), _mm_set1_ps( 1.0f / TQuantize<10>::MaxInteger ) );
+	}
+
+	/// extracts bits [shift .. shift+num_bits) of four 64-bit integers into 4 32-bit lanes
+	static mxFORCEINLINE
+	__m128i ExtractBitfield4_U64( const __m128i lo, const __m128i hi
+		, const int shift, const U64 mask
+		)
+	{
+		const __m128i mask64 = _mm_set1_epi64x( mask );
+		const __m128i a = _mm_and_si128( _mm_srli_epi64( lo, shift ), mask64 );
+		const __m128i b = _mm_and_si128( _mm_srli_epi64( hi, shift ), mask64 );
+		// all fields are < 2^22, so the low 32-bit halves hold the values
+		return _mm_castps_si128( _mm_shuffle_ps(
+			_mm_castsi128_ps( a ), _mm_castsi128_ps( b ), _MM_SHUFFLE(2,0,2,0)
+			) );
+	}
+
+	static mxFORCEINLINE
+	void DecodeVertices4( const U64 quantized_vertices[4]
+		, Vector4 &x_, Vector4 &y_, Vector4 &z_
+		)
+	{
+		// (21;21;22)
+		const __m128i lo = _mm_load_si128( (const __m128i*) quantized_vertices );
+		const __m128i hi = _mm_load_si128( (const __m128i*) quantized_vertices + 1 );
+
+		const __m128i ix = ExtractBitfield4_U64( lo, hi,  0, TQuantize<21>::MaxInteger );
+		const __m128i iy = ExtractBitfield4_U64( lo, hi, 21, TQuantize<21>::MaxInteger );
+		const __m128i iz = ExtractBitfield4_U64( lo, hi, 42, TQuantize<22>::MaxInteger );
+
+		x_ = _mm_mul_ps( _mm_cvtepi32_ps( ix ), _mm_set1_ps( 1.0f / TQuantize<21>::MaxInteger ) );
+		y_ = _mm_mul_ps( _mm_cvtepi32_ps( iy ), _mm_set1_ps( 1.0f / TQuantize<21>::MaxInteger ) );
+		z_ = _mm_mul_ps( _mm_cvtepi32_ps( iz ), _mm_set1_ps( 1.0f / TQuantize<22>::MaxInteger ) );
+	}
+
+	static mxFORCEINLINE
+	Vector4 AbsV( Vec4Arg0 v )
+	{
+		return _mm_andnot_ps( _mm_set1_ps( -0.0f ), v );
+	}
+
+	/// returns the mask of lanes where the projections [min(p0,p1,p2) .. max(p0,p1,p2)]
+	/// are disjoint from [-r .. +r], i.e. the axis is a separating axis
+	static mxFORCEINLINE
+	Vector4 IsSeparatingAxis( Vec4Arg0 p0, Vec4Arg0 p1, Vec4Arg0 p2, Vec4Arg0 r )
+	{
+		const Vector4 min_p = _mm_min_ps( _mm_min_ps( p0, p1 ), p2 );
+		const Vector4 max_p = _mm_max_ps( _mm_max_ps( p0, p1 ), p2 );
+		return _mm_or_ps(
+			_mm_cmpgt_ps( min_p, r ),
+			_mm_cmplt_ps( max_p, _mm_sub_ps( _mm_setzero_ps(), r ) )
+			);
+	}
+
+	/// Triangle-vs-AABB overlap test using the Separating Axis Theorem, 4 triangles at once.
+	/// Based on "Fast 3D Triangle-Box Overlap Testing" by Tomas Akenine-Moller.
+	/// The vertices must be relative to the box center.
+	/// Returns a 4-bit mask of triangles which may overlap the box.
+	static mxFORCEINLINE
+	int TrianglesOverlapBox4(
+		const Vector4 vx[3], const Vector4 vy[3], const Vector4 vz[3]
+		, Vec4Arg0 hx, Vec4Arg0 hy, Vec4Arg0 hz	// box half-size, padded by epsilon
+		)
+	{
+		// 1) the box face normals (tests the triangle's AABB against the box)
+		Vector4 separated = IsSeparatingAxis( vx[0], vx[1], vx[2], hx );
+		separated = _mm_or_ps( separated, IsSeparatingAxis( vy[0], vy[1], vy[2], hy ) );
+		separated = _mm_or_ps( separated, IsSeparatingAxis( vz[0], vz[1], vz[2], hz ) );
+
+		// triangle edges
+		Vector4 ex[3], ey[3], ez[3];
+		for( int i = 0; i < 3; i++ )
+		{
+			const int next = (i + 1) % 3;
+			ex[i] = _mm_sub_ps( vx[next], vx[i] );
+			ey[i] = _mm_sub_ps( vy[next], vy[i] );
+			ez[i] = _mm_sub_ps( vz[next], vz[i] );
+		}
+
+		// 2) the triangle's normal
+		{
+			const Vector4 nx = _mm_sub_ps( _mm_mul_ps( ey[0], ez[1] ), _mm_mul_ps( ez[0], ey[1] ) );
+			const Vector4 ny = _mm_sub_ps( _mm_mul_ps( ez[0], ex[1] ), _mm_mul_ps( ex[0], ez[1] ) );
+			const Vector4 nz = _mm_sub_ps( _mm_mul_ps( ex[0], ey[1] ), _mm_mul_ps( ey[0], ex[1] ) );
+
+			const Vector4 d = _mm_add_ps( _mm_add_ps(
+				_mm_mul_ps( nx, vx[0] ), _mm_mul_ps( ny, vy[0] ) ), _mm_mul_ps( nz, vz[0] )
+				);
+			const Vector4 r = _mm_add_ps( _mm_add_ps(
+				_mm_mul_ps( AbsV( nx ), hx ), _mm_mul_ps( AbsV( ny ), hy ) ), _mm_mul_ps( AbsV( nz ), hz )
+				);
+			separated = _mm_or_ps( separated, _mm_cmpgt_ps( AbsV( d ), r ) );
+		}
+
+		// 3) the cross products of the triangle edges with the box axes
+		for( int i = 0; i < 3; i++ )
+		{
+			const Vector4 abs_ex = AbsV( ex[i] );
+			const Vector4 abs_ey = AbsV( ey[i] );
+			const Vector4 abs_ez = AbsV( ez[i] );
+
+			// edge x (1,0,0) = (0, ez, -ey)
+			{
+				const Vector4 p0 = _mm_sub_ps( _mm_mul_ps( ez[i], vy[0] ), _mm_mul_ps( ey[i], vz[0] ) );
+				const Vector4 p1 = _mm_sub_ps( _mm_mul_ps( ez[i], vy[1] ), _mm_mul_ps( ey[i], vz[1] ) );
+				const Vector4 p2 = _mm_sub_ps( _mm_mul_ps( ez[i], vy[2] ), _mm_mul_ps( ey[i], vz[2] ) );
+				const Vector4 r = _mm_add_ps( _mm_mul_ps( abs_ez, hy ), _mm_mul_ps( abs_ey, hz ) );
+				separated = _mm_or_ps( separated, IsSeparatingAxis( p0, p1, p2, r ) );
+			}
+			// edge x (0,1,0) = (-ez, 0, ex)
+			{
+				const Vector4 p0 = _mm_sub_ps( _mm_mul_ps( ex[i], vz[0] ), _mm_mul_ps( ez[i], vx[0] ) );
+				const Vector4 p1 = _mm_sub_ps( _mm_mul_ps( ex[i], vz[1] ), _mm_mul_ps( ez[i], vx[1] ) );
+				const Vector4 p2 = _mm_sub_ps( _mm_mul_ps( ex[i], vz[2] ), _mm_mul_ps( ez[i], vx[2] ) );
+				const Vector4 r = _mm_add_ps( _mm_mul_ps( abs_ez, hx ), _mm_mul_ps( abs_ex, hz ) );
+				separated = _mm_or_ps( separated, IsSeparatingAxis( p0, p1, p2, r ) );
+			}
+			// edge x (0,0,1) = (ey, -ex, 0)
+			{
+				const Vector4 p0 = _mm_sub_ps( _mm_mul_ps( ey[i], vx[0] ), _mm_mul_ps( ex[i], vy[0] ) );
+				const Vector4 p1 = _mm_sub_ps( _mm_mul_ps( ey[i], vx[1] ), _mm_mul_ps( ex[i], vy[1] ) );
+				const Vector4 p2 = _mm_sub_ps( _mm_mul_ps( ey[i], vx[2] ), _mm_mul_ps( ex[i], vy[2] ) );
+				const Vector4 r = _mm_add_ps( _mm_mul_ps( abs_ey, hx ), _mm_mul_ps( abs_ex, hy ) );
+				separated = _mm_or_ps( separated, IsSeparatingAxis( p0, p1, p2, r ) );
+			}
+		}
+
+		return ~_mm_movemask_ps( separated ) & 0xF;
+	}
+
+	/// Collects triangles from the visited leaves, decodes them in batches
+	/// and passes the triangles overlapping the query box to Bullet.
+	class TriangleBatcher
+	{
+		const NwBIH::QTri *		_tris;
+		const NwBIH::QVert *	_verts;
+		btTriangleCallback *	_callback;
+		const float				_uniform_scale_local_to_world;
+
+		// the query box in BIH local space [0..1]
+		Vector4		_box_center[3];
+		Vector4		_box_half_size[3];
+
+		UINT		_num_pending;
+		U32			_pending_triangles[ TRIANGLE_BATCH_SIZE ];
+
+		// quantized positions of the pending triangles' vertices: [vertex][triangle]
+		mxPREALIGN(16) NwBIH::QVert	_quantized_vertices[3][ TRIANGLE_BATCH_SIZE ];
+
+	public:
+		TriangleBatcher( const NwBIH& bih
+			, btTriangleCallback* callback
+			, const float uniform_scale_local_to_world
+			, const btVector3& local_aabb_min
+			, const btVector3& local_aabb_max
+			)
+			: _tris( bih._triangles.begin() )
+			, _verts( bih._vertices.begin() )
+			, _callback( callback )
+			, _uniform_scale_local_to_world( uniform_scale_local_to_world )
+			, _num_pending( 0 )
+		{
+			// compensate for rounding errors: the test must be conservative
+			const float EPSILON = 1e-5f;
+
+			for( int axis = 0; axis < 3; axis++ )
+			{
+				const float center = ( local_aabb_min[axis] + local_aabb_max[axis] ) * 0.5f;
+				const float half_size = ( local_aabb_max[axis] - local_aabb_min[axis] ) * 0.5f;
+				_box_center[axis] = _mm_set1_ps( center );
+				_box_half_size[axis] = _mm_set1_ps( half_size + EPSILON );
+			}
+		}
+
+		~TriangleBatcher()
+		{
+			mxASSERT2( !_num_pending, "Flush() must be called" );
+		}
+
+		mxFORCEINLINE void AddTriangle( const U32 triangle_index )
+		{
+			_pending_triangles[ _num_pending++ ] = triangle_index;
+			if( _num_pending == TRIANGLE_BATCH_SIZE ) {
+				this->Flush();
+			}
+		}
+
+		mxFORCEINLINE void AddTriangles( const UINT first_triangle_index, const UINT triangle_count )
+		{
+			for( UINT i = 0; i < triangle_count; i++ ) {
+				this->AddTriangle( first_triangle_index + i );
+			}
+		}
+
+		void Flush()
+		{
+			const UINT num_triangles = _num_pending;
+			if( !num_triangles ) {
+				return;
+			}
+			_num_pending = 0;
+
+			// Gather quantized vertices; unused lanes replicate the last triangle and are masked out below.
+			for( UINT i = 0; i < TRIANGLE_BATCH_SIZE; i++ )
+			{
+				const U32 triangle_index = _pending_triangles[ smallest( i, num_triangles - 1 ) ];
+				const NwBIH::QTri tri = _tris[ triangle_index ];
+
+				_quantized_vertices[0][i] = _verts[ (tri >> 43) & ((1<<21) - 1) ];
+				_quantized_vertices[1][i] = _verts[ (tri >> 22) & ((1<<21) - 1) ];
+				_quantized_vertices[2][i] = _verts[ (tri >>  0) & ((1<<22) - 1) ];
+			}
+
+			const U32 valid_lanes_mask = (1u << num_triangles) - 1;
+
+			for( UINT base = 0; base < TRIANGLE_BATCH_SIZE; base += 4 )
+			{
+				if( base >= num_triangles ) {
+					break;
+				}
+
+				Vector4	vx[3], vy[3], vz[3];	// decoded positions, in [0..1]
+				Vector4	rx[3], ry[3], rz[3];	// relative to the box center
+
+				for( int k = 0; k < 3; k++ )
+				{
+					DecodeVertices4( &_quantized_vertices[k][base], vx[k], vy[k], vz[k] );
+					rx[k] = _mm_sub_ps( vx[k], _box_center[0] );
+					ry[k] = _mm_sub_ps( vy[k], _box_center[1] );
+					rz[k] = _mm_sub_ps( vz[k], _box_center[2] );
+				}
+
+				U32 overlap_mask = TrianglesOverlapBox4(
+					rx, ry, rz
+					, _box_half_size[0], _box_half_size[1], _box_half_size[2]
+					);
+				overlap_mask &= ( valid_lanes_mask >> base );
+
+				if( !overlap_mask ) {
+					continue;
+				}
+
+				Vector4f	px[3], py[3], pz[3];
+				for( int k = 0; k < 3; k++ )
+				{
+					const Vector4 scale = _mm_set1_ps( _uniform_scale_local_to_world );
+					px[k].v = _mm_mul_ps( vx[k], scale );
+					py[k].v = _mm_mul_ps( vy[k], scale );
+					pz[k].v = _mm_mul_ps( vz[k], scale );
+				}
+
+				while( overlap_mask )
+				{
+					const U32 lane = TakeNextTrailingBit32( overlap_mask );
+
+					btVector3	faceverts[3] = {
+						btVector3( px[0].f[lane], py[0].f[lane], pz[0].f[lane] ),
+						btVector3( px[1].f[lane], py[1].f[lane], pz[1].f[lane] ),
+						btVector3( px[2].f[lane], py[2].f[lane], pz[2].f[lane] ),
+					};
+
+					_callback->processTriangle(
+						faceverts
+						, 0 /*partId*/
+						, _pending_triangles[ base + lane ] /*triangleIndex*/
+						);
+				}
+			}
+		}
+	};
+
+	/// Calls the functor for each leaf overlapping the query box.
+	template< class FUNCTOR >
+	static mxFORCEINLINE
+	void ForEachLeafOverlappingBox( const NwBIH::Node* nodes
+		, const AABBq& quantized_query_aabb
+		, const AABBq& quantized_root_aabb
+		, FUNCTOR & functor
+		)
+	{
+		struct BIHTraversal
+		{
+			U32		node_index;	// 4
+			AABBq	node_aabb;	// 24
+		};
+
+		BIHTraversal todo_stack[64];
+
+		todo_stack[0].node_aabb = quantized_root_aabb;
+		todo_stack[0].node_index = 0;
+
+		int	iStackTop = 0;
+
+		while( iStackTop >= 0 )
+		{
+			const BIHTraversal& item = todo_stack[ iStackTop-- ];
+			const U32 node_index = item.node_index;
+
+			const NwBIH::Node& node = nodes[ node_index ];
+
+			if( IS_INTERNAL_NODE( node ) )
+			{
+				const U32 axis_and_right_child_index = node.inner.axis_and_right_child_index;
+				const int axis = (axis_and_right_child_index >> 30) - 1;
+
+				// copy before pushing, because the item can be overwritten
+				AABBq	left_child_aabb_q = item.node_aabb;
+				AABBq	right_child_aabb_q = item.node_aabb;
+
+				left_child_aabb_q.max_corner[axis] = node.inner.split[0];
+				right_child_aabb_q.min_corner[axis] = node.inner.split[1];
+
+				if( quantizedAABBsIntersectOrTouch( left_child_aabb_q, quantized_query_aabb ) )
+				{
+					++iStackTop;
+					todo_stack[ iStackTop ].node_aabb = left_child_aabb_q;
+					todo_stack[ iStackTop ].node_index = node_index + 1;	// the left child is stored right after the node
+				}
+
+				if( quantizedAABBsIntersectOrTouch( right_child_aabb_q, quantized_query_aabb ) )
+				{
+					++iStackTop;
+					todo_stack[ iStackTop ].node_aabb = right_child_aabb_q;
+					todo_stack[ iStackTop ].node_index = axis_and_right_child_index & NwBIH::Node::RIGHT_CHILD_INDEX_MASK;
+				}
+			}
+			else
+			{
+				functor.AddTriangles( node.leaf.first_triangle_index, node.leaf.triangle_count );
+			}
+		}
+	}
+
+}//namespace
+
+void NwBIH::ProcessTrianglesIntersectingBox_Batched( btTriangleCallback* callback
+	, const btVector3& local_aabb_min
+	, const btVector3& local_aabb_max
+	, const AABBf& bih_bounds_local_space
+	, float uniform_scale_local_to_world
+	) const
+{
+	const AABBf tested_box_in_bih_local_space = AABBf::make(
+		fromBulletVec(local_aabb_min), fromBulletVec(local_aabb_max)
+		);
+
+	TriangleBatcher	batcher( *this
+		, callback
+		, uniform_scale_local_to_world
+		, local_aabb_min, local_aabb_max
+		);
+
+	ForEachLeafOverlappingBox( _nodes.begin()
+		, quantizeLocalAABB( tested_box_in_bih_local_space )
+		, quantizeLocalAABB( bih_bounds_local_space )
+		, batcher
+		);
+
+	batcher.Flush();
+}
+
+void NwBIH::WalkTreeAgainstRay_Batched(
+	btTriangleCallback* triangle_callback
+	, const btVector3& raySource, const btVector3& rayTarget
+	, const btVector3& aabbMin, const btVector3& aabbMax
+	, const AABBf& bih_bounds_local_space
+	, const float uniform_scale_world_to_local
+	) const
+{
+	// the AABB of the swept box
+	btVector3 rayAabbMin = raySource;
+	btVector3 rayAabbMax = raySource;
+	rayAabbMin.setMin(rayTarget);
+	rayAabbMax.setMax(rayTarget);
+
+	rayAabbMin += aabbMin;
+	rayAabbMax += aabbMax;
+
+	const btVector3 swept_box_min_local = rayAabbMin * uniform_scale_world_to_local;
+	const btVector3 swept_box_max_local = rayAabbMax * uniform_scale_world_to_local;
+
+	const AABBf query_aabb_in_bih_local_space = AABBf::make(
+		fromBulletVec(swept_box_min_local), fromBulletVec(swept_box_max_local)
+		);
+
+	// the triangles are culled against the swept box:
+	// a triangle outside the swept volume cannot be hit by the convex cast
+	TriangleBatcher	batcher( *this
+		, triangle_callback
+		, 1 / uniform_scale_world_to_local
+		, swept_box_min_local, swept_box_max_local
+		);
+
+	ForEachLeafOverlappingBox( _nodes.begin()
+		, quantizeLocalAABB( query_aabb_in_bih_local_space )
+		, quantizeLocalAABB( bih_bounds_local_space )
+		, batcher
+		);
+
+	batcher.Flush();
+}
+
 ERet NwBIH::ExtractVerticesAndTriangles(
 	TArray<V3f>		&vertices_,
 	TArray<UInt3>	&triangles_,
@@ -1120,3 +1553,360 @@ ERet NwBIHBuilder::SaveToBlob( NwBlob &blob_ )
 
 	return ALL_OK;
 }
+
+
+/*
+-----------------------------------------------------------------------------
+	UNIT TESTS
+-----------------------------------------------------------------------------
+*/
+#if MX_DEVELOPER
+
+namespace
+{
+	/// counts submitted triangles and checks that their vertices were decoded correctly
+	struct CheckingTriangleCallback: btTriangleCallback
+	{
+		const NwBIH &	bih;
+		const float		uniform_scale_local_to_world;
+		UINT			num_triangles;
+
+	public:
+		CheckingTriangleCallback( const NwBIH& bih, const float uniform_scale_local_to_world )
+			: bih( bih )
+			, uniform_scale_local_to_world( uniform_scale_local_to_world )
+			, num_triangles( 0 )
+		{}
+
+		virtual void processTriangle( btVector3* triangle, int partId, int triangleIndex ) override
+		{
+#if MX_DEBUG
+			btVector3	expected_vertices[3];
+			bih.GetTriangleVerticesForBullet( triangleIndex, expected_vertices, uniform_scale_local_to_world );
+			for( int i = 0; i < 3; i++ ) {
+				mxASSERT( triangle[i] == expected_vertices[i] );
+			}
+#endif
+			++num_triangles;
+		}
+	};
+
+	/// collects the indices of the triangles reported by a query
+	struct CollectingTriangleCallback: btTriangleCallback
+	{
+		DynamicArray< U32 >	triangle_indices;
+
+	public:
+		CollectingTriangleCallback( AllocatorI & allocator )
+			: triangle_indices( allocator )
+		{}
+
+		virtual void processTriangle( btVector3* triangle, int partId, int triangleIndex ) override
+		{
+			// the capacity is reserved for all triangles, each triangle is reported once
+			triangle_indices.AddFastUnsafe( triangleIndex );
+		}
+
+		void SortIndices()
+		{
+			std::sort( triangle_indices.raw(), triangle_indices.raw() + triangle_indices.num() );
+		}
+	};
+
+	/// the test used by the batched queries, applied to a single triangle
+	bool TriangleOverlapsLocalBox( const NwBIH& bih
+		, const U32 triangle_index
+		, const btVector3& local_aabb_min
+		, const btVector3& local_aabb_max
+		)
+	{
+		struct FlagCallback: btTriangleCallback
+		{
+			bool	was_called;
+			FlagCallback() : was_called( false ) {}
+			virtual void processTriangle( btVector3*, int, int ) override { was_called = true; }
+		} callback;
+
+		TriangleBatcher	batcher( bih, &callback, 1.0f, local_aabb_min, local_aabb_max );
+		batcher.AddTriangle( triangle_index );
+		batcher.Flush();
+
+		return callback.was_called;
+	}
+
+	/// Keeps the triangles returned by the scalar traversal which pass the SAT test,
+	/// i.e. the triangles that the batched queries must return.
+	ERet FilterExpectedTriangles( CollectingTriangleCallback & scalar_candidates
+		, const NwBIH& bih
+		, const btVector3& local_aabb_min
+		, const btVector3& local_aabb_max
+		)
+	{
+		UINT num_expected = 0;
+		for( UINT i = 0; i < scalar_candidates.triangle_indices.num(); i++ )
+		{
+			const U32 triangle_index = scalar_candidates.triangle_indices[i];
+			if( TriangleOverlapsLocalBox( bih, triangle_index, local_aabb_min, local_aabb_max ) ) {
+				scalar_candidates.triangle_indices[ num_expected++ ] = triangle_index;
+			}
+		}
+		mxDO(scalar_candidates.triangle_indices.setNum( num_expected ));
+		scalar_candidates.SortIndices();
+		return ALL_OK;
+	}
+
+	/// checks that the query returned exactly the expected triangles (the arrays must be sorted)
+	ERet CheckSameTriangles( const char* query_name
+		, const CollectingTriangleCallback& expected
+		, const CollectingTriangleCallback& returned
+		)
+	{
+		mxENSURE( returned.triangle_indices.num() == expected.triangle_indices.num(), ERR_UNKNOWN_ERROR,
+			"%s: the batched query returned %u triangles, the scalar one - %u"
+			, query_name, returned.triangle_indices.num(), expected.triangle_indices.num()
+			);
+		for( UINT i = 0; i < expected.triangle_indices.num(); i++ )
+		{
+			mxENSURE( returned.triangle_indices[i] == expected.triangle_indices[i], ERR_UNKNOWN_ERROR,
+				"%s: the batched query returned triangle %u, the scalar one - %u"
+				, query_name, returned.triangle_indices[i], expected.triangle_indices[i]
+				);
+		}
+		return ALL_OK;
+	}
+
+	/// a heightfield in the unit cube
+	struct TerrainHeightfieldMesh: NwBIHBuilder::TriangleMeshI
+	{
+		// must have power-of-two sizes
+		struct Vertex { V3f pos; F32 pad; };
+		struct Triangle { UInt3 indices; U32 pad; };
+
+		Vertex *	vertices;
+		Triangle *	triangles;
+		UINT		num_vertices;
+		UINT		num_triangles;
+
+	public:
+		virtual const StridedTrianglesT GetTriangles() const override
+		{
+			StridedTrianglesT	result;
+			result.start = &triangles[0].indices;
+			result.stride_log2 = TLog2< sizeof(Triangle) >::value;
+			result.count = num_triangles;
+			return result;
+		}
+		virtual const StridedPositionsT GetVertexPositions() const override
+		{
+			StridedPositionsT	result;
+			result.start = &vertices[0].pos;
+			result.stride_log2 = TLog2< sizeof(Vertex) >::value;
+			result.count = num_vertices;
+			return result;
+		}
+
+		static float HeightAt( float x, float z )
+		{
+			return 0.5f
+				+ 0.15f * mmSin( x * 9.0f ) * mmCos( z * 7.0f )
+				+ 0.05f * mmSin( (x + z) * 31.0f )
+				;
+		}
+	};
+}//namespace
+
+ERet Benchmark_BIH_CharacterSweepsOverTerrain(
+	AllocatorI & scratch
+	, const UINT num_sweeps
+	)
+{
+	// 128 x 128 quads, 32K triangles
+	const UINT GRID_RES = 128;
+	const UINT NUM_VERTS = (GRID_RES + 1) * (GRID_RES + 1);
+	const UINT NUM_TRIS = GRID_RES * GRID_RES * 2;
+
+	// the size of the terrain chunk, in meters
+	const float CHUNK_SIZE = 64.0f;
+
+	TerrainHeightfieldMesh	mesh;
+	mesh.num_vertices = NUM_VERTS;
+	mesh.num_triangles = NUM_TRIS;
+	mxTRY_ALLOC_SCOPED( mesh.vertices, NUM_VERTS, scratch );
+	mxTRY_ALLOC_SCOPED( mesh.triangles, NUM_TRIS, scratch );
+
+	for( UINT iZ = 0; iZ <= GRID_RES; iZ++ )
+	{
+		for( UINT iX = 0; iX <= GRID_RES; iX++ )
+		{
+			const float x = float(iX) / GRID_RES;
+			const float z = float(iZ) / GRID_RES;
+			mesh.vertices[ iZ * (GRID_RES + 1) + iX ].pos = CV3f( x, TerrainHeightfieldMesh::HeightAt( x, z ), z );
+		}
+	}
+
+	UINT num_tris = 0;
+	for( UINT iZ = 0; iZ < GRID_RES; iZ++ )
+	{
+		for( UINT iX = 0; iX < GRID_RES; iX++ )
+		{
+			const U32 i00 = iZ * (GRID_RES + 1) + iX;
+			const U32 i01 = i00 + 1;
+			const U32 i10 = i00 + (GRID_RES + 1);
+			const U32 i11 = i10 + 1;
+			mesh.triangles[ num_tris++ ].indices = UInt3( i00, i10, i11 );
+			mesh.triangles[ num_tris++ ].indices = UInt3( i00, i11, i01 );
+		}
+	}
+
+	//
+	NwBIHBuilder	bih_builder( scratch );
+	mxDO(bih_builder.Build( mesh, NwBIHBuilder::Options(), scratch ));
+
+	NwBlob	bih_blob( scratch );
+	mxDO(bih_builder.SaveToBlob( bih_blob ));
+
+	const NwBIH& bih = *(const NwBIH*) bih_blob.raw();
+	const AABBf bih_bounds = { CV3f(0), CV3f(1) };
+
+	//
+	const float scale_local_to_world = CHUNK_SIZE;
+	const float scale_world_to_local = 1 / CHUNK_SIZE;
+
+	// character's bounding box half-size, in meters
+	const btVector3 character_half_size( 0.4f, 0.9f, 0.4f );
+
+	CheckingTriangleCallback	scalar_box_callback( bih, scale_local_to_world );
+	CheckingTriangleCallback	batched_box_callback( bih, scale_local_to_world );
+	CheckingTriangleCallback	scalar_sweep_callback( bih, scale_local_to_world );
+	CheckingTriangleCallback	batched_sweep_callback( bih, scale_local_to_world );
+
+	// for checking that the batched queries return the same sets of triangles
+	CollectingTriangleCallback	expected_triangles( scratch );
+	CollectingTriangleCallback	batched_box_triangles( scratch );
+	CollectingTriangleCallback	batched_sweep_triangles( scratch );
+	mxDO(expected_triangles.triangle_indices.reserve( NUM_TRIS ));
+	mxDO(batched_box_triangles.triangle_indices.reserve( NUM_TRIS ));
+	mxDO(batched_sweep_triangles.triangle_indices.reserve( NUM_TRIS ));
+
+	U64	scalar_box_microseconds = 0;
+	U64	batched_box_microseconds = 0;
+	U64	scalar_sweep_microseconds = 0;
+	U64	batched_sweep_microseconds = 0;
+
+	NwRandom	rng( 12345 );
+
+	for( UINT iSweep = 0; iSweep < num_sweeps; iSweep++ )
+	{
+		// start slightly above the ground and move horizontally with gravity, ~1 frame at a run
+		const float x = rng.GetRandomFloatInRange( 0.05f, 0.95f );
+		const float z = rng.GetRandomFloatInRange( 0.05f, 0.95f );
+		const float ground_height = TerrainHeightfieldMesh::HeightAt( x, z ) * CHUNK_SIZE;
+
+		const btVector3 start( x * CHUNK_SIZE, ground_height + character_half_size.y() + 0.05f, z * CHUNK_SIZE );
+		const btVector3 motion(
+			rng.GetRandomFloatMinus1Plus1() * 0.5f,
+			-0.2f,
+			rng.GetRandomFloatMinus1Plus1() * 0.5f
+			);
+		const btVector3 end = start + motion;
+
+		// the swept box, the same for both kinds of queries
+		btVector3 world_aabb_min = start - character_half_size;
+		btVector3 world_aabb_max = start + character_half_size;
+		world_aabb_min.setMin( end - character_half_size );
+		world_aabb_max.setMax( end + character_half_size );
+
+		const btVector3 local_aabb_min = world_aabb_min * scale_world_to_local;
+		const btVector3 local_aabb_max = world_aabb_max * scale_world_to_local;
+
+		// 1) box queries (btConvexConcaveCollisionAlgorithm)
+		{
+			U64 start_time = mxGetTimeInMicroseconds();
+			bih.ProcessTrianglesIntersectingBox( &scalar_box_callback
+				, world_aabb_min, world_aabb_max
+				, local_aabb_min, local_aabb_max
+				, bih_bounds
+				, scale_local_to_world
+				, CV3f(0)
+				);
+			scalar_box_microseconds += mxGetTimeInMicroseconds() - start_time;
+
+			start_time = mxGetTimeInMicroseconds();
+			bih.ProcessTrianglesIntersectingBox_Batched( &batched_box_callback
+				, local_aabb_min, local_aabb_max
+				, bih_bounds
+				, scale_local_to_world
+				);
+			batched_box_microseconds += mxGetTimeInMicroseconds() - start_time;
+		}
+
+		// 2) convex casts (kinematic character controller)
+		{
+			U64 start_time = mxGetTimeInMicroseconds();
+			bih.WalkTreeAgainstRay( &scalar_sweep_callback
+				, start, end
+				, -character_half_size, character_half_size
+				, bih_bounds
+				, scale_world_to_local
+				);
+			scalar_sweep_microseconds += mxGetTimeInMicroseconds() - start_time;
+
+			start_time = mxGetTimeInMicroseconds();
+			bih.WalkTreeAgainstRay_Batched( &batched_sweep_callback
+				, start, end
+				, -character_half_size, character_half_size
+				, bih_bounds
+				, scale_world_to_local
+				);
+			batched_sweep_microseconds += mxGetTimeInMicroseconds() - start_time;
+		}
+
+		// 3) (not timed) the batched queries must return exactly the triangles
+		// found by the scalar traversal (all triangles in the leaves overlapping the swept box)
+		// which pass the SAT test
+		{
+			expected_triangles.triangle_indices.RemoveAll();
+			batched_box_triangles.triangle_indices.RemoveAll();
+			batched_sweep_triangles.triangle_indices.RemoveAll();
+
+			bih.WalkTreeAgainstRay( &expected_triangles
+				, start, end
+				, -character_half_size, character_half_size
+				, bih_bounds
+				, scale_world_to_local
+				);
+			mxDO(FilterExpectedTriangles( expected_triangles, bih, local_aabb_min, local_aabb_max ));
+
+			bih.ProcessTrianglesIntersectingBox_Batched( &batched_box_triangles
+				, local_aabb_min, local_aabb_max
+				, bih_bounds
+				, scale_local_to_world
+				);
+			batched_box_triangles.SortIndices();
+			mxDO(CheckSameTriangles( "Box query", expected_triangles, batched_box_triangles ));
+
+			bih.WalkTreeAgainstRay_Batched( &batched_sweep_triangles
+				, start, end
+				, -character_half_size, character_half_size
+				, bih_bounds
+				, scale_world_to_local
+				);
+			batched_sweep_triangles.SortIndices();
+			mxDO(CheckSameTriangles( "Convex cast", expected_triangles, batched_sweep_triangles ));
+		}
+	}
+
+	ptPRINT("BIH: %u tris, %u sweeps:\n"
+		"Box query: scalar: %u tris in %u usec, batched: %u tris in %u usec\n"
+		"Convex cast: scalar: %u tris in %u usec, batched: %u tris in %u usec",
+		NUM_TRIS, num_sweeps,
+		scalar_box_callback.num_triangles, (UINT) scalar_box_microseconds,
+		batched_box_callback.num_triangles, (UINT) batched_box_microseconds,
+		scalar_sweep_callback.num_triangles, (UINT) scalar_sweep_microseconds,
+		batched_sweep_callback.num_triangles, (UINT) batched_sweep_microseconds
+		);
+
+	return ALL_OK;
+}
+
+#endif // MX_DEVELOPER
@@ -28,6 +28,12 @@
 #endif
 
 
+/// 1 - decode quantized vertices and perform SAT triangle-vs-box tests
+/// in SIMD batches before calling btTriangleCallback (recommended),
+/// 0 - decode and submit triangles one by one (reference path)
+#define nwBIH_USE_BATCHED_TRIANGLE_TESTS	(1)
+
+
 
 class btTriangleCallback;
 
@@ -137,6 +143,17 @@ public:
 		, const V3f& minimum_corner_in_world_space	// for debugging only
 	) const;
 
+	/// Batched version of ProcessTrianglesIntersectingBox():
+	/// decodes vertices of triangles in overlapping leaves 4 at a time
+	/// and runs a separating-axis test against the query box
+	/// before passing the surviving triangles to the callback.
+	void ProcessTrianglesIntersectingBox_Batched( btTriangleCallback* callback
+		, const btVector3& local_aabb_min
+		, const btVector3& local_aabb_max
+		, const AABBf& bih_bounds_local_space	//
+		, float uniform_scale_local_to_world	// must be >= 1
+		) const;
+
 	mxFORCEINLINE
 	void GetTriangleVerticesForBullet(
 		const int triangle_index
@@ -176,6 +193,16 @@ public:
 		, const float uniform_scale_world_to_local
 		) const;
 
+	/// Batched version of WalkTreeAgainstRay():
+	/// rejects triangles not touching the swept box with a SIMD SAT test.
+	void WalkTreeAgainstRay_Batched(
+		btTriangleCallback* triangle_callback
+		, const btVector3& raySource, const btVector3& rayTarget
+		, const btVector3& aabbMin, const btVector3& aabbMax
+		, const AABBf& bih_bounds_local_space	//
+		, const float uniform_scale_world_to_local
+		) const;
+
 	ERet ExtractVerticesAndTriangles(
 		TArray<V3f>		&vertices_,
 		TArray<UInt3>	&triangles_,
@@ -238,3 +265,21 @@ public:	// Serialization:
 
 	ERet SaveToBlob( NwBlob &blob_ );
 };
+
+
+/*
+-----------------------------------------------------------------------------
+	UNIT TESTS
+-----------------------------------------------------------------------------
+*/
+
+#if MX_DEVELOPER
+
+/// Builds a BIH over a procedural heightfield and compares the scalar and batched queries
+/// on short box sweeps, similar to what a character controller does each frame.
+ERet Benchmark_BIH_CharacterSweepsOverTerrain(
+	AllocatorI & scratch
+	, const UINT num_sweeps = 10000
+	);
+
+#endif // MX_DEVELOPER
@@ -127,6 +127,16 @@ void NwBIHCollisionShape::processAllTriangles(
 	scaledAabbMax[3] = 0.f;
 
 
+#if nwBIH_USE_BATCHED_TRIANGLE_TESTS
+
+	this->GetBIH().ProcessTrianglesIntersectingBox_Batched( callback
+		, scaledAabbMin, scaledAabbMax
+		, _bounding_box_in_local_space
+		, _uniform_scale_local_to_world
+		);
+
+#else
+
 	this->GetBIH().ProcessTrianglesIntersectingBox( callback
 		, aabbMin, aabbMax
 		, scaledAabbMin, scaledAabbMax
@@ -134,6 +144,8 @@ void NwBIHCollisionShape::processAllTriangles(
 		, _uniform_scale_local_to_world
 		, _min_corner_pos_in_world_space
 		);
+
+#endif
 }
 
 void NwBIHCollisionShape::performConvexcast(
@@ -180,6 +192,21 @@ void NwBIHCollisionShape::performConvexcast(
 
 	const NwBIH& bih = this->GetBIH();
 
+#if nwBIH_USE_BATCHED_TRIANGLE_TESTS
+
+	// the triangles are inflated by the collision margin in btTriangleConvexcastCallback
+	const btVector3 margin( m_collisionMargin, m_collisionMargin, m_collisionMargin );
+
+	bih.WalkTreeAgainstRay_Batched(
+		triangle_callback
+		, raySource, rayTarget
+		, aabbMin - margin, aabbMax + margin
+		, _bounding_box_in_local_space
+		, 1 / _uniform_scale_local_to_world
+		);
+
+#else
+
 	MyNodeOverlapCallback myNodeCallback(triangle_callback, bih, _uniform_scale_local_to_world);
 
 	bih.WalkTreeAgainstRay(
@@ -190,6 +217,8 @@ void NwBIHCollisionShape::performConvexcast(
 		, _bounding_box_in_local_space
 		, 1 / _uniform_scale_local_to_world
 		);
+
+#endif
 }
 
 //////////////////////////////////////////////////////////////////////////
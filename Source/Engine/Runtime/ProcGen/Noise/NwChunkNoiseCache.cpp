@@ -0,0 +1,478 @@
+// Reusing the coarse octaves of fractal noise between levels of detail of chunked terrain.
+#include <Base/Base.h>
+#pragma hdrstop
+
+#include <Core/Util/ScopedTimer.h>
+
+#include <ProcGen/Noise/NwChunkNoiseCache.h>
+
+
+namespace Noise
+{
+
+NwChunkNoiseCache::NwChunkNoiseCache( AllocatorI & allocator )
+	: _entries( allocator )
+	, _cached_values( allocator )
+	, _entry_by_key( allocator )
+{
+	_lru_head = INDEX_NONE;
+	_lru_tail = INDEX_NONE;
+	_num_used_entries = 0;
+	_free_list_head = INDEX_NONE;
+	_num_values_per_chunk = 0;
+	_fractal = nil;
+	_perlin_noise = nil;
+}
+
+NwChunkNoiseCache::~NwChunkNoiseCache()
+{
+	this->shutdown();
+}
+
+ERet NwChunkNoiseCache::initialize(
+	const NwChunkNoiseSettings& settings
+	, const NwTerrainNoise2D& fractal
+	, const NwPerlinNoise& perlin_noise
+	)
+{
+	mxENSURE( settings.resolution >= 3 && (settings.resolution - 1) % 2 == 0, ERR_INVALID_PARAMETER,
+		"chunk resolution must be odd, got %u", settings.resolution );
+
+	_settings = settings;
+	_num_values_per_chunk = settings.resolution * settings.resolution * settings.resolution;
+
+	_fractal = &fractal;
+	_perlin_noise = &perlin_noise;
+
+	const size_t bytes_per_entry = _num_values_per_chunk * sizeof(Real) + sizeof(Entry);
+	const U32 capacity = U32( settings.memory_budget_in_bytes / bytes_per_entry );
+
+	mxDO(_entries.setNum( capacity ));
+	mxDO(_cached_values.setNum( capacity * _num_values_per_chunk ));
+
+	mxDO(_entry_by_key.Initialize(
+		HashMapUtil::CalcHashTableSize( capacity ),
+		capacity
+		));
+
+	this->clear();
+
+	return ALL_OK;
+}
+
+void NwChunkNoiseCache::shutdown()
+{
+	_entry_by_key.Clear();
+	_cached_values.clear();
+	_entries.clear();
+
+	_lru_head = INDEX_NONE;
+	_lru_tail = INDEX_NONE;
+	_num_used_entries = 0;
+	_free_list_head = INDEX_NONE;
+
+	_fractal = nil;
+	_perlin_noise = nil;
+}
+
+void NwChunkNoiseCache::clear()
+{
+	_entry_by_key.RemoveAll();
+
+	// the entries are only linked when used
+	_lru_head = INDEX_NONE;
+	_lru_tail = INDEX_NONE;
+	_num_used_entries = 0;
+	_free_list_head = INDEX_NONE;
+
+	this->resetStats();
+}
+
+void NwChunkNoiseCache::resetStats()
+{
+	_stats = NwChunkNoiseStats();
+
+	for( U32 lod = 0; lod < NwChunkNoiseStats::MAX_LODS; lod++ ) {
+		_stats.lods[ lod ].num_octaves = _fractal ? this->getNumOctaves( lod ) : 0;
+	}
+}
+
+void NwChunkNoiseCache::getChunkGrid( const NwChunkNoiseKey& key, NwNoiseGrid &grid_ ) const
+{
+	const Real chunk_size = _settings.lod0_chunk_size * Real( 1u << key.lod );
+
+	grid_.origin[0] = Real( key.x ) * chunk_size;
+	grid_.origin[1] = Real( key.y ) * chunk_size;
+	grid_.origin[2] = Real( key.z ) * chunk_size;
+	grid_.spacing = chunk_size / Real( _settings.resolution - 1 );
+	grid_.size[0] = _settings.resolution;
+	grid_.size[1] = _settings.resolution;
+	grid_.size[2] = _settings.resolution;
+}
+
+U32 NwChunkNoiseCache::getNumOctaves( const U32 lod ) const
+{
+	const Real chunk_size = _settings.lod0_chunk_size * Real( 1u << lod );
+	const Real spacing = chunk_size / Real( _settings.resolution - 1 );
+	return _fractal->calculateNumberOfNoiseOctaves( spacing );
+}
+
+U32 NwChunkNoiseCache::getNumCachedOctaves( const U32 lod ) const
+{
+	const U32 num_octaves = this->getNumOctaves( lod );
+	return num_octaves > _settings.num_unshared_octaves
+		? num_octaves - _settings.num_unshared_octaves
+		: 0
+		;
+}
+
+ERet NwChunkNoiseCache::generateChunk(
+	const NwChunkNoiseKey& key
+	, Real * values_
+	, const ENoiseGridISA isa
+	)
+{
+	mxASSERT_PTR( _fractal );
+	mxASSERT( key.lod < NwChunkNoiseStats::MAX_LODS );
+
+	NwNoiseGrid	grid;
+	this->getChunkGrid( key, grid );
+
+	const U32 num_octaves = this->getNumOctaves( key.lod );
+
+	NwChunkNoiseStats::LoD &lod_stats = _stats.lods[ key.lod ];
+	lod_stats.num_chunks_generated++;
+
+	// the values contain the sum of octaves [0, first_octave)
+	U32	first_octave = 0;
+
+	const U32* cached_entry_index = _entry_by_key.FindValue( key );
+	if( cached_entry_index )
+	{
+		const U32 entry_index = *cached_entry_index;
+		const Entry& entry = _entries[ entry_index ];
+
+		memcpy( values_, _cached_values.raw() + entry_index * _num_values_per_chunk, _num_values_per_chunk * sizeof(Real) );
+		first_octave = entry.num_cached_octaves;
+
+		this->unlinkEntry( entry_index );
+		this->linkEntryAtHead( entry_index );
+
+		lod_stats.num_cache_hits++;
+		lod_stats.num_octaves_saved += first_octave;
+	}
+	else
+	{
+		const U32* parent_entry_index = ( key.lod + 1 < NwChunkNoiseStats::MAX_LODS )
+			? _entry_by_key.FindValue( key.getParent() )
+			: nil
+			;
+		if( parent_entry_index )
+		{
+			const U32 entry_index = *parent_entry_index;
+
+			// upsample before allocating the new entry which could evict the parent
+			this->upsampleFromParent( key, _cached_values.raw() + entry_index * _num_values_per_chunk, values_ );
+			first_octave = _entries[ entry_index ].num_cached_octaves;
+
+			this->unlinkEntry( entry_index );
+			this->linkEntryAtHead( entry_index );
+
+			lod_stats.num_parent_reuses++;
+			lod_stats.num_octaves_saved += first_octave;
+		}
+		else
+		{
+			memset( values_, 0, _num_values_per_chunk * sizeof(Real) );
+		}
+
+		// compute the octaves which will be shared with the children and cache them
+		const U32 num_cached_octaves = largest( this->getNumCachedOctaves( key.lod ), first_octave );
+
+		accumulateRidgedNoise3D_Grid( *_fractal, *_perlin_noise, first_octave, num_cached_octaves, grid, values_, isa );
+		lod_stats.num_octaves_evaluated += num_cached_octaves - first_octave;
+
+		const U32 new_entry_index = this->allocateEntry( key );
+		if( new_entry_index != INDEX_NONE )
+		{
+			memcpy( _cached_values.raw() + new_entry_index * _num_values_per_chunk, values_, _num_values_per_chunk * sizeof(Real) );
+			_entries[ new_entry_index ].num_cached_octaves = num_cached_octaves;
+		}
+
+		first_octave = num_cached_octaves;
+	}
+
+	// compute the finest octaves which are never cached
+	const U32 end_octave = largest( num_octaves, first_octave );
+	accumulateRidgedNoise3D_Grid( *_fractal, *_perlin_noise, first_octave, end_octave, grid, values_, isa );
+	lod_stats.num_octaves_evaluated += end_octave - first_octave;
+
+	const Real result_scale = _fractal->_result_scale;
+	for( U32 i = 0; i < _num_values_per_chunk; i++ ) {
+		values_[i] *= result_scale;
+	}
+
+	return ALL_OK;
+}
+
+void NwChunkNoiseCache::upsampleFromParent(
+	const NwChunkNoiseKey& key
+	, const Real* parent_values
+	, Real * values_
+	) const
+{
+	const U32 resolution = _settings.resolution;
+	const U32 half = ( resolution - 1 ) / 2;
+
+	// the first sample of the child in the parent grid
+	const U32 start_x = ( key.x & 1 ) * half;
+	const U32 start_y = ( key.y & 1 ) * half;
+	const U32 start_z = ( key.z & 1 ) * half;
+
+	// the even samples of the child coincide with the samples of the parent,
+	// the odd samples are in the middle between them (the same sample is taken twice on even axes)
+	for( U32 iz = 0; iz < resolution; iz++ )
+	{
+		const U32 z0 = start_z + ( iz >> 1 );
+		const U32 z1 = z0 + ( iz & 1 );
+
+		for( U32 iy = 0; iy < resolution; iy++ )
+		{
+			const U32 y0 = start_y + ( iy >> 1 );
+			const U32 y1 = y0 + ( iy & 1 );
+
+			const Real* row00 = parent_values + ( z0 * resolution + y0 ) * resolution;
+			const Real* row10 = parent_values + ( z0 * resolution + y1 ) * resolution;
+			const Real* row01 = parent_values + ( z1 * resolution + y0 ) * resolution;
+			const Real* row11 = parent_values + ( z1 * resolution + y1 ) * resolution;
+
+			Real * row_values = values_ + ( iz * resolution + iy ) * resolution;
+
+			for( U32 ix = 0; ix < resolution; ix++ )
+			{
+				const U32 x0 = start_x + ( ix >> 1 );
+				const U32 x1 = x0 + ( ix & 1 );
+
+				row_values[ ix ] = Real(0.125) * (
+					( row00[ x0 ] + row00[ x1 ] ) + ( row10[ x0 ] + row10[ x1 ] ) +
+					( row01[ x0 ] + row01[ x1 ] ) + ( row11[ x0 ] + row11[ x1 ] )
+					);
+			}
+		}
+	}
+}
+
+U32 NwChunkNoiseCache::allocateEntry( const NwChunkNoiseKey& key )
+{
+	const U32 capacity = _entries.num();
+	if( !capacity ) {
+		return INDEX_NONE;
+	}
+
+	U32	entry_index;
+
+	if( _free_list_head != INDEX_NONE )
+	{
+		entry_index = _free_list_head;
+		_free_list_head = _entries[ entry_index ].next;
+	}
+	else if( _num_used_entries < capacity )
+	{
+		// the entries are never removed individually, so the used ones are always the first ones
+		entry_index = _num_used_entries++;
+	}
+	else
+	{
+		entry_index = _lru_tail;
+		this->unlinkEntry( entry_index );
+		_entry_by_key.Remove( _entries[ entry_index ].key );
+		_stats.num_evictions++;
+	}
+
+	if( mxFAILED(_entry_by_key.Insert( key, entry_index )) )
+	{
+		// keep the entry for the next call, it must not be handed out while another key uses it
+		_entries[ entry_index ].next = _free_list_head;
+		_free_list_head = entry_index;
+		return INDEX_NONE;
+	}
+
+	_entries[ entry_index ].key = key;
+	_entries[ entry_index ].num_cached_octaves = 0;
+	this->linkEntryAtHead( entry_index );
+
+	return entry_index;
+}
+
+void NwChunkNoiseCache::unlinkEntry( const U32 entry_index )
+{
+	Entry &entry = _entries[ entry_index ];
+
+	if( entry.prev != INDEX_NONE ) {
+		_entries[ entry.prev ].next = entry.next;
+	} else {
+		_lru_head = entry.next;
+	}
+
+	if( entry.next != INDEX_NONE ) {
+		_entries[ entry.next ].prev = entry.prev;
+	} else {
+		_lru_tail = entry.prev;
+	}
+
+	entry.prev = INDEX_NONE;
+	entry.next = INDEX_NONE;
+}
+
+void NwChunkNoiseCache::linkEntryAtHead( const U32 entry_index )
+{
+	Entry &entry = _entries[ entry_index ];
+
+	entry.prev = INDEX_NONE;
+	entry.next = _lru_head;
+
+	if( _lru_head != INDEX_NONE ) {
+		_entries[ _lru_head ].prev = entry_index;
+	} else {
+		_lru_tail = entry_index;
+	}
+	_lru_head = entry_index;
+}
+
+/*
+-----------------------------------------------------------------------------
+	UNIT TESTS
+-----------------------------------------------------------------------------
+*/
+#if MX_DEVELOPER
+
+namespace
+{
+	/// the chunks of an octree refined around the point, from the root down to LoD 0
+	void collectChunksAroundPoint(
+		const Real point[3]
+		, const Real lod0_chunk_size
+		, const U32 num_lods
+		, DynamicArray< NwChunkNoiseKey > &chunks_
+		)
+	{
+		for( int lod = int(num_lods) - 1; lod >= 0; lod-- )
+		{
+			// the chunk at the next coarser LoD containing the point is split into 8 children
+			const Real parent_size = lod0_chunk_size * Real( 2u << lod );
+			const I32 parent_x = (I32) floor( point[0] / parent_size );
+			const I32 parent_y = (I32) floor( point[1] / parent_size );
+			const I32 parent_z = (I32) floor( point[2] / parent_size );
+
+			for( U32 i = 0; i < 8; i++ )
+			{
+				chunks_.add( NwChunkNoiseKey::make(
+					parent_x * 2 + ( i & 1 ),
+					parent_y * 2 + ( ( i >> 1 ) & 1 ),
+					parent_z * 2 + ( ( i >> 2 ) & 1 ),
+					lod
+					) );
+			}
+		}
+	}
+}//namespace
+
+ERet Benchmark_ChunkNoiseCache(
+	AllocatorI & scratchpad
+	, const U32 num_lods
+	)
+{
+	mxENSURE( num_lods < NwChunkNoiseStats::MAX_LODS, ERR_INVALID_PARAMETER, "too many LoDs: %u", num_lods );
+
+	NwPerlinNoise	perlin_noise( 1337 );
+
+	NwTerrainNoise2D	fractal;
+	fractal._coarsest_frequency = 0.0173;
+	fractal._max_octaves = 16;
+
+	NwChunkNoiseSettings	settings;
+
+	NwChunkNoiseCache	cache( scratchpad );
+	mxDO(cache.initialize( settings, fractal, perlin_noise ));
+
+	// crosses the origin to test negative chunk coordinates
+	const Real point[3] = { -13.7, 5.3, 2.1 };
+
+	DynamicArray< NwChunkNoiseKey >	chunks( scratchpad );
+	collectChunksAroundPoint( point, settings.lod0_chunk_size, num_lods, chunks );
+
+	const U32 num_values_per_chunk = settings.resolution * settings.resolution * settings.resolution;
+
+	Real *	reference_values;
+	mxTRY_ALLOC_SCOPED( reference_values, num_values_per_chunk, scratchpad );
+	Real *	values;
+	mxTRY_ALLOC_SCOPED( values, num_values_per_chunk, scratchpad );
+
+	ptPRINT("Chunk noise cache: %u chunks of %u^3 samples, %u LoDs, %u chunks fit into the cache",
+		chunks.num(), settings.resolution, num_lods, cache.getCapacity());
+
+	U64	direct_usec = 0;
+	U64	cached_usec = 0;
+	Real	max_error[ NwChunkNoiseStats::MAX_LODS ] = { 0 };
+
+	ScopedTimer	timer;
+
+	for( U32 i = 0; i < chunks.num(); i++ )
+	{
+		const NwChunkNoiseKey& key = chunks[i];
+
+		NwNoiseGrid	grid;
+		cache.getChunkGrid( key, grid );
+
+		timer.Reset();
+		evaluateRidgedNoise3D_Grid( fractal, perlin_noise, cache.getNumOctaves( key.lod ), grid, reference_values );
+		direct_usec += timer.ElapsedMicroseconds();
+
+		timer.Reset();
+		mxDO(cache.generateChunk( key, values ));
+		cached_usec += timer.ElapsedMicroseconds();
+
+		for( U32 k = 0; k < num_values_per_chunk; k++ ) {
+			max_error[ key.lod ] = largest( max_error[ key.lod ], fabs( values[k] - reference_values[k] ) );
+		}
+	}
+
+	ptPRINT("	direct: %u usec, cached: %u usec (%.2fx)",
+		(U32) direct_usec, (U32) cached_usec,
+		cached_usec ? float(direct_usec) / cached_usec : 0.0f);
+
+	const NwChunkNoiseStats& stats = cache.getStats();
+	for( int lod = int(num_lods) - 1; lod >= 0; lod-- )
+	{
+		const NwChunkNoiseStats::LoD& lod_stats = stats.lods[ lod ];
+		const U64 total_octaves = lod_stats.num_octaves_evaluated + lod_stats.num_octaves_saved;
+		ptPRINT("	LoD %d: %u octaves, %u chunks, %u from parent, octaves evaluated: %u, saved: %u (%.1f%%), max error: %g",
+			lod, lod_stats.num_octaves, lod_stats.num_chunks_generated, lod_stats.num_parent_reuses,
+			(U32) lod_stats.num_octaves_evaluated, (U32) lod_stats.num_octaves_saved,
+			total_octaves ? 100.0f * lod_stats.num_octaves_saved / total_octaves : 0.0f,
+			max_error[ lod ]
+			);
+	}
+
+	// the chunks of the root LoD have no parents and must be exact
+	mxENSURE( max_error[ num_lods - 1 ] == 0, ERR_UNKNOWN_ERROR, "the chunks without parents must not be approximated" );
+
+	// generating the same chunks again must hit the cache
+	cache.resetStats();
+	for( U32 i = 0; i < chunks.num(); i++ ) {
+		mxDO(cache.generateChunk( chunks[i], values ));
+	}
+	U32	num_cache_hits = 0;
+	for( U32 lod = 0; lod < num_lods; lod++ ) {
+		num_cache_hits += cache.getStats().lods[ lod ].num_cache_hits;
+	}
+	ptPRINT("	regenerated %u chunks, cache hits: %u", chunks.num(), num_cache_hits);
+
+	mxENSURE( num_cache_hits == chunks.num(), ERR_UNKNOWN_ERROR, "all chunks should be cached" );
+
+	return ALL_OK;
+}
+
+#endif // MX_DEVELOPER
+
+}//namespace Noise
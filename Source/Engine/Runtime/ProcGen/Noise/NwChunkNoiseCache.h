@@ -0,0 +1,204 @@
+// Reusing the coarse octaves of fractal noise between levels of detail of chunked terrain.
+#pragma once
+
+#include <Base/Template/Containers/HashMap/THashMap.h>
+#include <ProcGen/Noise/NwNoiseGrid.h>
+
+
+namespace Noise
+{
+
+/// A chunk in the octree of chunks.
+/// The chunk at 'lod' covers the cube [xyz, xyz + 1) * (lod0_chunk_size << lod),
+/// its parent is (xyz >> 1, lod + 1).
+struct NwChunkNoiseKey
+{
+	I32	x, y, z;
+	U32	lod;
+
+public:
+	bool operator == ( const NwChunkNoiseKey& other ) const
+	{
+		return x == other.x && y == other.y && z == other.z && lod == other.lod;
+	}
+
+	NwChunkNoiseKey getParent() const
+	{
+		const NwChunkNoiseKey parent = { x >> 1, y >> 1, z >> 1, lod + 1 };
+		return parent;
+	}
+
+	static NwChunkNoiseKey make( I32 x, I32 y, I32 z, U32 lod )
+	{
+		const NwChunkNoiseKey key = { x, y, z, lod };
+		return key;
+	}
+};
+
+struct NwChunkNoiseKeyHash
+{
+	static inline U32 ComputeHash32( const NwChunkNoiseKey& key )
+	{
+		// large primes as in spatial hashing
+		return U32( key.x ) * 73856093u ^ U32( key.y ) * 19349663u ^ U32( key.z ) * 83492791u ^ key.lod * 2654435761u;
+	}
+};
+
+struct NwChunkNoiseSettings
+{
+	/// the size of chunks at LoD 0, in world units
+	Real	lod0_chunk_size;
+
+	/// the number of samples along each axis of a chunk (incl. the samples on the far sides),
+	/// (resolution - 1) must be even so that the samples of a parent land on the samples of its children
+	U32		resolution;
+
+	/// the number of finest octaves of a chunk which are not reused by its children:
+	/// the highest octaves are close to the sampling rate of the parent and cannot be interpolated well,
+	/// each additional unshared octave roughly halves the interpolation error (the ridges have creases)
+	U32		num_unshared_octaves;
+
+	/// the cached octaves are evicted in the least-recently-used order when this budget is exceeded
+	size_t	memory_budget_in_bytes;
+
+public:
+	NwChunkNoiseSettings()
+	{
+		lod0_chunk_size = 32;
+		resolution = 33;
+		num_unshared_octaves = 1;
+		memory_budget_in_bytes = mxMiB(64);
+	}
+};
+
+/// how much work was done (or saved) at each LoD
+struct NwChunkNoiseStats
+{
+	enum { MAX_LODS = 16 };
+
+	struct LoD
+	{
+		U32	num_chunks_generated;
+		U32	num_cache_hits;		//!< the chunk itself was cached (e.g. generated again after edits)
+		U32	num_parent_reuses;	//!< the coarse octaves were interpolated from the parent chunk
+		U32	num_octaves;		//!< the number of octaves used for this LoD
+		U64	num_octaves_evaluated;	//!< the total number of octaves computed for all chunks
+		U64	num_octaves_saved;		//!< the total number of octaves taken from the cache
+	};
+	LoD	lods[ MAX_LODS ];
+
+	U32	num_evictions;
+
+public:
+	NwChunkNoiseStats()
+	{
+		mxZERO_OUT(*this);
+	}
+};
+
+///
+///	Generates NwTerrainNoise2D::evaluateRidged3D() on the sample grids of chunks.
+///	The number of octaves depends on the LoD (see NwTerrainNoise2D::calculateNumberOfNoiseOctaves()).
+///	The unscaled sum of the coarse octaves of each chunk is cached;
+///	children upsample it (trilinearly) from their parent and compute only the finer octaves.
+///	The results are approximate: the coarse octaves are interpolated
+///	(see NwChunkNoiseSettings::num_unshared_octaves for trading speed for accuracy),
+///	the chunks without cached parents are exact.
+///
+class NwChunkNoiseCache: NonCopyable
+{
+	struct Entry
+	{
+		NwChunkNoiseKey	key;
+		U32		num_cached_octaves;	//!< the cached values are the sum of octaves [0, num_cached_octaves)
+		U32		prev;	//!< towards the most recently used entry
+		U32		next;	//!< towards the least recently used entry (or the next free entry)
+	};
+
+	DynamicArray< Entry >	_entries;
+	DynamicArray< Real >	_cached_values;	//!< resolution^3 values per entry
+
+	THashMap< NwChunkNoiseKey, U32, NwChunkNoiseKeyHash >	_entry_by_key;
+
+	U32		_lru_head;	//!< the most recently used entry
+	U32		_lru_tail;	//!< the least recently used entry
+
+	/// the entries [0, _num_used_entries) have been used since clear(),
+	/// some of them can be in the free list (if they couldn't be added to _entry_by_key)
+	U32		_num_used_entries;
+	U32		_free_list_head;
+
+	NwChunkNoiseSettings	_settings;
+	U32		_num_values_per_chunk;
+
+	const NwTerrainNoise2D *	_fractal;
+	const NwPerlinNoise *		_perlin_noise;
+
+	NwChunkNoiseStats	_stats;
+
+public:
+	NwChunkNoiseCache( AllocatorI & allocator );
+	~NwChunkNoiseCache();
+
+	ERet initialize(
+		const NwChunkNoiseSettings& settings
+		, const NwTerrainNoise2D& fractal	//!< must not be changed while the cache is used (or call clear())
+		, const NwPerlinNoise& perlin_noise
+		);
+	void shutdown();
+
+	/// Must be called after changing the noise parameters.
+	void clear();
+
+	/// Computes the noise at the resolution^3 samples of the chunk.
+	/// The chunks should be generated from coarse to fine LoDs to benefit from caching.
+	ERet generateChunk(
+		const NwChunkNoiseKey& key
+		, Real * values_	//!< resolution^3 values in X-major order
+		, const ENoiseGridISA isa = getBestNoiseGridISA()
+		);
+
+	/// Returns the sample positions of the chunk.
+	void getChunkGrid( const NwChunkNoiseKey& key, NwNoiseGrid &grid_ ) const;
+
+	/// Returns the number of octaves computed for chunks at the given LoD.
+	U32 getNumOctaves( const U32 lod ) const;
+
+	U32 getCapacity() const { return _entries.num(); }
+	U32 getNumCachedChunks() const { return _entry_by_key.NumEntries(); }
+
+	const NwChunkNoiseStats& getStats() const { return _stats; }
+	void resetStats();
+
+private:
+	U32 getNumCachedOctaves( const U32 lod ) const;
+
+	void upsampleFromParent( const NwChunkNoiseKey& key, const Real* parent_values, Real * values_ ) const;
+
+	U32 allocateEntry( const NwChunkNoiseKey& key );
+
+	void unlinkEntry( const U32 entry_index );
+	void linkEntryAtHead( const U32 entry_index );
+};
+
+}//namespace Noise
+
+/*
+-----------------------------------------------------------------------------
+	UNIT TESTS
+-----------------------------------------------------------------------------
+*/
+
+#if MX_DEVELOPER
+
+namespace Noise
+{
+	/// Generates an octree of chunks around a point from coarse to fine LoDs, with and without the cache,
+	/// prints the speedup, the maximum error and the number of octaves saved at each LoD.
+	ERet Benchmark_ChunkNoiseCache(
+		AllocatorI & scratchpad
+		, const U32 num_lods = 5
+		);
+}//namespace Noise
+
+#endif // MX_DEVELOPER
@@ -150,23 +150,17 @@ NwPerlinNoise::RealT NwPerlinNoise::_projectOntoRandomGradient2D(
 	, unsigned offset
 	) const
 {
-	// A series of primes for the hash function
-	const unsigned NOISE_HASH_X = 1213;
-	const unsigned NOISE_HASH_Y = 6203;
-	const unsigned NOISE_HASH_SEED = 1039;
-	const unsigned NOISE_HASH_SHIFT = 13;
-
 	// Hash the lattice indices to get a gradient vector index
 	unsigned index
-		= NOISE_HASH_X * unsigned(ix)
-		+ NOISE_HASH_Y * unsigned(iy)
-		+ NOISE_HASH_SEED + offset
+		= HASH_X * unsigned(ix)
+		+ HASH_Y * unsigned(iy)
+		+ HASH_SEED + offset
 		;
-	index ^= (index >> NOISE_HASH_SHIFT);
+	index ^= (index >> HASH_SHIFT);
 
 	//index = index % mxCOUNT_OF(_random_gradients);
-	mxSTATIC_ASSERT(mxCOUNT_OF(_random_gradients) == 0x100);
-	index &= 0xFF;
+	mxSTATIC_ASSERT(mxCOUNT_OF(_random_gradients) == HASH_MASK + 1);
+	index &= HASH_MASK;
 
 	// Lookup the gradient vector
 	const Vec3T& random_gradient = _random_gradients[ index ];
@@ -184,25 +178,18 @@ NwPerlinNoise::RealT NwPerlinNoise::_projectOntoRandomGradient3D(
 	, unsigned offset
 	) const
 {
-	// A series of primes for the hash function
-	const unsigned NOISE_HASH_X = 1213;
-	const unsigned NOISE_HASH_Y = 6203;
-	const unsigned NOISE_HASH_Z = 5237;
-	const unsigned NOISE_HASH_SEED = 1039;
-	const unsigned NOISE_HASH_SHIFT = 13;
-
 	// Hash the lattice indices to get a gradient vector index
 	unsigned index
-		= NOISE_HASH_X * unsigned(ix)
-		+ NOISE_HASH_Y * unsigned(iy)
-		+ NOISE_HASH_Z * unsigned(iz)
-		+ NOISE_HASH_SEED + offset
+		= HASH_X * unsigned(ix)
+		+ HASH_Y * unsigned(iy)
+		+ HASH_Z * unsigned(iz)
+		+ HASH_SEED + offset
 		;
-	index ^= (index >> NOISE_HASH_SHIFT);
+	index ^= (index >> HASH_SHIFT);
 
 	//index = index % mxCOUNT_OF(_random_gradients);
-	mxSTATIC_ASSERT(mxCOUNT_OF(_random_gradients) == 0x100);
-	index &= 0xFF;
+	mxSTATIC_ASSERT(mxCOUNT_OF(_random_gradients) == HASH_MASK + 1);
+	index &= HASH_MASK;
 
 	// Lookup the gradient vector
 	const Vec3T& random_gradient = _random_gradients[ index ];
@@ -290,6 +277,38 @@ Real NwTerrainNoise2D::evaluate2D(
 	return sum * _result_scale;
 }
 
+Real NwTerrainNoise2D::evaluateRidged3D(
+	const Real x, const Real y, const Real z
+	, const NwPerlinNoise& perlin_noise
+	, const unsigned int num_octaves
+	) const
+{
+	Real sum = 0;
+	Real amplitude = Real(1);
+
+	Real frequency = _coarsest_frequency;
+
+	for( unsigned int i = 0; i < num_octaves; i++ )
+	{
+		Real n = perlin_noise.evalulate3D(
+			x * frequency,
+			y * frequency,
+			z * frequency
+			);
+
+		// create the ridges and make them sharper
+		n = Real(1) - fabs( n );
+		n *= n;
+
+		sum += amplitude * n;
+
+		amplitude *= _gain;
+		frequency *= _lacunarity;
+	}
+
+	return sum * _result_scale;
+}
+
 int NwTerrainNoise2D::calculateNumberOfNoiseOctaves(
 	const Real voxel_size
 	) const
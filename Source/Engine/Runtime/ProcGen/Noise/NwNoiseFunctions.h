@@ -33,11 +33,26 @@ class NwPerlinNoise: NonCopyable
 	/// 3D Normalized gradients table
 	Vec3T	_random_gradients[256];
 
+public:
+	/// A series of primes for hashing lattice indices into the table of gradients
+	enum HashConstants
+	{
+		HASH_X = 1213,
+		HASH_Y = 6203,
+		HASH_Z = 5237,
+		HASH_SEED = 1039,
+		HASH_SHIFT = 13,
+		HASH_MASK = 0xFF,
+	};
+
 public:
 	NwPerlinNoise( int seed = 1337 );
 
 	void setSeed( int seed );
 
+	/// for bulk evaluation, see NwNoiseGrid.h
+	const Vec3T* getGradients() const { return _random_gradients; }
+
 	RealT evalulate2D(
 		const RealT x, const RealT y
 		, unsigned offset = 0
@@ -115,6 +130,13 @@ public:
 		, const FastNoise& perlin
 		) const;
 
+	/// the same ridged fractal as evaluate2D(), but made of 3D noise
+	Real evaluateRidged3D(
+		const Real x, const Real y, const Real z
+		, const NwPerlinNoise& perlin_noise
+		, const unsigned int num_octaves
+		) const;
+
 public:
 	int calculateNumberOfNoiseOctaves(
 		const Real voxel_size
@@ -0,0 +1,662 @@
+// Bulk evaluation of fractal noise on regular grids.
+#include <Base/Base.h>
+#pragma hdrstop
+
+#include <immintrin.h>
+
+#include <Base/Math/Interpolate.h>
+#include <Core/Util/ScopedTimer.h>
+
+#include <ProcGen/Noise/NwNoiseGrid.h>
+
+/// MSVC allows using AVX intrinsics without /arch:AVX, other compilers need the target to be enabled.
+/// The vectorized code works with doubles, like the scalar code.
+#if ( defined(__AVX2__) || (defined(_MSC_VER) && _MSC_VER >= 1700) ) && nwNOISE_CFG_USE_DOUBLES
+	#define NOISE_GRID_WITH_AVX2	(1)
+#else
+	#define NOISE_GRID_WITH_AVX2	(0)
+#endif
+
+
+namespace Noise
+{
+
+namespace
+{
+	/// the maximum number of octaves, the finer octaves are below the precision of Real anyway
+	enum { MAX_GRID_OCTAVES = 32 };
+
+	/// the frequencies and amplitudes of the octaves, computed in the same order as in NwTerrainNoise2D
+	struct OctaveWeights
+	{
+		Real	frequencies[ MAX_GRID_OCTAVES ];
+		Real	amplitudes[ MAX_GRID_OCTAVES ];
+	public:
+		OctaveWeights( const NwTerrainNoise2D& fractal, const unsigned int num_octaves )
+		{
+			Real amplitude = Real(1);
+			Real frequency = fractal._coarsest_frequency;
+			for( unsigned int i = 0; i < num_octaves; i++ )
+			{
+				frequencies[i] = frequency;
+				amplitudes[i] = amplitude;
+				amplitude *= fractal._gain;
+				frequency *= fractal._lacunarity;
+			}
+		}
+	};
+
+	/// the position of a coordinate inside its lattice cell, computed exactly as in NwPerlinNoise
+	struct LatticeAxis
+	{
+		int		i0;	//!< the lower lattice index
+		Real	d0;	//!< the distance from the lower lattice point
+		Real	d1;	//!< the distance from the upper lattice point (negative)
+		Real	t;	//!< the interpolation weight
+	};
+
+	static mxFORCEINLINE void getLatticeAxis( const Real x, LatticeAxis &axis_ )
+	{
+		axis_.i0 = (int) floor( x );
+		axis_.d0 = x - axis_.i0;
+		axis_.d1 = axis_.d0 - Real(1);
+		axis_.t = interpHermite( axis_.d0 );
+	}
+
+	/// everything that doesn't change along a row of a 2D grid
+	struct RowOctave2D
+	{
+		LatticeAxis	y;
+		unsigned	hash_y[2];	//!< the hashed parts of the lower and upper lattice rows (incl. the seed)
+	};
+
+	/// everything that doesn't change along a row of a 3D grid
+	struct RowOctave3D
+	{
+		LatticeAxis	y;
+		LatticeAxis	z;
+		unsigned	hash_yz[4];	//!< (y0,z0), (y1,z0), (y0,z1), (y1,z1), incl. the seed
+	};
+
+	static void getRowOctave2D( const Real y, RowOctave2D &row_ )
+	{
+		getLatticeAxis( y, row_.y );
+		const unsigned iy0 = unsigned( row_.y.i0 );
+		row_.hash_y[0] = NwPerlinNoise::HASH_Y * iy0 + NwPerlinNoise::HASH_SEED;
+		row_.hash_y[1] = NwPerlinNoise::HASH_Y * (iy0 + 1) + NwPerlinNoise::HASH_SEED;
+	}
+
+	static void getRowOctave3D( const Real y, const Real z, RowOctave3D &row_ )
+	{
+		getLatticeAxis( y, row_.y );
+		getLatticeAxis( z, row_.z );
+		const unsigned hash_y0 = NwPerlinNoise::HASH_Y * unsigned( row_.y.i0 );
+		const unsigned hash_y1 = NwPerlinNoise::HASH_Y * unsigned( row_.y.i0 + 1 );
+		const unsigned hash_z0 = NwPerlinNoise::HASH_Z * unsigned( row_.z.i0 ) + NwPerlinNoise::HASH_SEED;
+		const unsigned hash_z1 = NwPerlinNoise::HASH_Z * unsigned( row_.z.i0 + 1 ) + NwPerlinNoise::HASH_SEED;
+		row_.hash_yz[0] = hash_y0 + hash_z0;
+		row_.hash_yz[1] = hash_y1 + hash_z0;
+		row_.hash_yz[2] = hash_y0 + hash_z1;
+		row_.hash_yz[3] = hash_y1 + hash_z1;
+	}
+
+#if NOISE_GRID_WITH_AVX2
+
+	/*
+	-----------------------------------------------------------------------------
+		AVX2: 4 points along X at once.
+		The operations are done in the same order as in the scalar code
+		(and without FMA) to get bit-exact results.
+	-----------------------------------------------------------------------------
+	*/
+	struct Noise_AVX2
+	{
+		static mxFORCEINLINE __m256d Splat( const Real x ) { return _mm256_set1_pd( x ); }
+
+		/// t * t * (3 - 2 * t)
+		static mxFORCEINLINE __m256d Hermite( const __m256d& t )
+		{
+			return _mm256_mul_pd( _mm256_mul_pd( t, t ), _mm256_sub_pd( Splat( 3 ), _mm256_mul_pd( Splat( 2 ), t ) ) );
+		}
+
+		/// a + (b - a) * t
+		static mxFORCEINLINE __m256d Lerp( const __m256d& a, const __m256d& b, const __m256d& t )
+		{
+			return _mm256_add_pd( a, _mm256_mul_pd( _mm256_sub_pd( b, a ), t ) );
+		}
+
+		/// (1 - |n|)^2
+		static mxFORCEINLINE __m256d Ridge( const __m256d& n )
+		{
+			const __m256d abs_n = _mm256_andnot_pd( Splat( -0.0 ), n );
+			const __m256d ridge = _mm256_sub_pd( Splat( 1 ), abs_n );
+			return _mm256_mul_pd( ridge, ridge );
+		}
+
+		/// returns the offsets of the gradients (in doubles) in the table
+		static mxFORCEINLINE __m128i HashLattice( const __m128i& hash_x, const unsigned hash_yz )
+		{
+			__m128i index = _mm_add_epi32( hash_x, _mm_set1_epi32( hash_yz ) );
+			index = _mm_xor_si128( index, _mm_srli_epi32( index, NwPerlinNoise::HASH_SHIFT ) );
+			index = _mm_and_si128( index, _mm_set1_epi32( NwPerlinNoise::HASH_MASK ) );
+			// each gradient takes 3 doubles
+			return _mm_add_epi32( _mm_slli_epi32( index, 1 ), index );
+		}
+
+		static mxFORCEINLINE __m256d ProjectOntoGradient2D(
+			const Real* gradients, const __m128i& offsets,
+			const __m256d& dx, const __m256d& dy
+			)
+		{
+			const __m256d gx = _mm256_i32gather_pd( gradients + 0, offsets, 8 );
+			const __m256d gy = _mm256_i32gather_pd( gradients + 1, offsets, 8 );
+			return _mm256_add_pd( _mm256_mul_pd( gx, dx ), _mm256_mul_pd( gy, dy ) );
+		}
+
+		static mxFORCEINLINE __m256d ProjectOntoGradient3D(
+			const Real* gradients, const __m128i& offsets,
+			const __m256d& dx, const __m256d& dy, const __m256d& dz
+			)
+		{
+			const __m256d gx = _mm256_i32gather_pd( gradients + 0, offsets, 8 );
+			const __m256d gy = _mm256_i32gather_pd( gradients + 1, offsets, 8 );
+			const __m256d gz = _mm256_i32gather_pd( gradients + 2, offsets, 8 );
+			return _mm256_add_pd( _mm256_add_pd( _mm256_mul_pd( gx, dx ), _mm256_mul_pd( gy, dy ) ), _mm256_mul_pd( gz, dz ) );
+		}
+
+		/// the lattice cells of 4 coordinates
+		struct LatticeAxis4
+		{
+			__m128i	hash_x0;	//!< HASH_X * x0
+			__m128i	hash_x1;	//!< HASH_X * (x0 + 1)
+			__m256d	d0;
+			__m256d	d1;
+			__m256d	t;
+		};
+
+		static mxFORCEINLINE void GetLatticeAxis( const __m256d& x, LatticeAxis4 &axis_ )
+		{
+			const __m128i i0 = _mm256_cvttpd_epi32( _mm256_floor_pd( x ) );
+			axis_.hash_x0 = _mm_mullo_epi32( i0, _mm_set1_epi32( NwPerlinNoise::HASH_X ) );
+			axis_.hash_x1 = _mm_add_epi32( axis_.hash_x0, _mm_set1_epi32( NwPerlinNoise::HASH_X ) );
+			axis_.d0 = _mm256_sub_pd( x, _mm256_cvtepi32_pd( i0 ) );
+			axis_.d1 = _mm256_sub_pd( axis_.d0, Splat( 1 ) );
+			axis_.t = Hermite( axis_.d0 );
+		}
+
+		/// the same as NwPerlinNoise::evalulate2D()
+		static mxFORCEINLINE __m256d Perlin2D( const Real* gradients, const __m256d& x, const RowOctave2D& row )
+		{
+			LatticeAxis4	ax;
+			GetLatticeAxis( x, ax );
+
+			const __m256d dy0 = Splat( row.y.d0 );
+			const __m256d dy1 = Splat( row.y.d1 );
+
+			const __m256d g00 = ProjectOntoGradient2D( gradients, HashLattice( ax.hash_x0, row.hash_y[0] ), ax.d0, dy0 );
+			const __m256d g10 = ProjectOntoGradient2D( gradients, HashLattice( ax.hash_x1, row.hash_y[0] ), ax.d1, dy0 );
+			const __m256d g01 = ProjectOntoGradient2D( gradients, HashLattice( ax.hash_x0, row.hash_y[1] ), ax.d0, dy1 );
+			const __m256d g11 = ProjectOntoGradient2D( gradients, HashLattice( ax.hash_x1, row.hash_y[1] ), ax.d1, dy1 );
+
+			return Lerp( Lerp( g00, g10, ax.t ), Lerp( g01, g11, ax.t ), Splat( row.y.t ) );
+		}
+
+		/// the same as NwPerlinNoise::evalulate3D()
+		static mxFORCEINLINE __m256d Perlin3D( const Real* gradients, const __m256d& x, const RowOctave3D& row )
+		{
+			LatticeAxis4	ax;
+			GetLatticeAxis( x, ax );
+
+			const __m256d dy0 = Splat( row.y.d0 );
+			const __m256d dy1 = Splat( row.y.d1 );
+			const __m256d dz0 = Splat( row.z.d0 );
+			const __m256d dz1 = Splat( row.z.d1 );
+
+			const __m256d g0 = ProjectOntoGradient3D( gradients, HashLattice( ax.hash_x0, row.hash_yz[0] ), ax.d0, dy0, dz0 );
+			const __m256d g1 = ProjectOntoGradient3D( gradients, HashLattice( ax.hash_x1, row.hash_yz[0] ), ax.d1, dy0, dz0 );
+			const __m256d g2 = ProjectOntoGradient3D( gradients, HashLattice( ax.hash_x0, row.hash_yz[1] ), ax.d0, dy1, dz0 );
+			const __m256d g3 = ProjectOntoGradient3D( gradients, HashLattice( ax.hash_x1, row.hash_yz[1] ), ax.d1, dy1, dz0 );
+			const __m256d g4 = ProjectOntoGradient3D( gradients, HashLattice( ax.hash_x0, row.hash_yz[2] ), ax.d0, dy0, dz1 );
+			const __m256d g5 = ProjectOntoGradient3D( gradients, HashLattice( ax.hash_x1, row.hash_yz[2] ), ax.d1, dy0, dz1 );
+			const __m256d g6 = ProjectOntoGradient3D( gradients, HashLattice( ax.hash_x0, row.hash_yz[3] ), ax.d0, dy1, dz1 );
+			const __m256d g7 = ProjectOntoGradient3D( gradients, HashLattice( ax.hash_x1, row.hash_yz[3] ), ax.d1, dy1, dz1 );
+
+			const __m256d gx0 = Lerp( g0, g1, ax.t );
+			const __m256d gx1 = Lerp( g2, g3, ax.t );
+			const __m256d gx2 = Lerp( g4, g5, ax.t );
+			const __m256d gx3 = Lerp( g6, g7, ax.t );
+
+			const __m256d ty = Splat( row.y.t );
+			return Lerp( Lerp( gx0, gx1, ty ), Lerp( gx2, gx3, ty ), Splat( row.z.t ) );
+		}
+
+		/// FIXED_OCTAVES lets the compiler unroll the octave loop, 0 means that the number of octaves is only known at runtime
+		template< unsigned FIXED_OCTAVES, class ROW_OCTAVE >
+		static void EvaluateRow(
+			const Real* gradients
+			, const ROW_OCTAVE* row_octaves
+			, const OctaveWeights& weights
+			, const unsigned num_octaves
+			, const Real x_origin
+			, const Real spacing
+			, const U32 num_points	//!< must be a multiple of 4
+			, const Real result_scale
+			, Real * values_
+			)
+		{
+			const unsigned octave_count = FIXED_OCTAVES ? FIXED_OCTAVES : num_octaves;
+
+			for( U32 i = 0; i < num_points; i += 4 )
+			{
+				const __m256d lattice_x = _mm256_set_pd( Real(i + 3), Real(i + 2), Real(i + 1), Real(i) );
+				const __m256d x = _mm256_add_pd( Splat( x_origin ), _mm256_mul_pd( lattice_x, Splat( spacing ) ) );
+
+				__m256d	sum = _mm256_setzero_pd();
+				for( unsigned octave = 0; octave < octave_count; octave++ )
+				{
+					const __m256d n = Ridge( Perlin( gradients, _mm256_mul_pd( x, Splat( weights.frequencies[ octave ] ) ), row_octaves[ octave ] ) );
+					sum = _mm256_add_pd( sum, _mm256_mul_pd( Splat( weights.amplitudes[ octave ] ), n ) );
+				}
+
+				_mm256_storeu_pd( values_ + i, _mm256_mul_pd( sum, Splat( result_scale ) ) );
+			}
+		}
+
+		static mxFORCEINLINE __m256d Perlin( const Real* gradients, const __m256d& x, const RowOctave2D& row ) {
+			return Perlin2D( gradients, x, row );
+		}
+		static mxFORCEINLINE __m256d Perlin( const Real* gradients, const __m256d& x, const RowOctave3D& row ) {
+			return Perlin3D( gradients, x, row );
+		}
+
+		template< class ROW_OCTAVE >
+		static void EvaluateRowWithAnyOctaves(
+			const Real* gradients
+			, const ROW_OCTAVE* row_octaves
+			, const OctaveWeights& weights
+			, const unsigned num_octaves
+			, const Real x_origin
+			, const Real spacing
+			, const U32 num_points
+			, const Real result_scale
+			, Real * values_
+			)
+		{
+			switch( num_octaves )
+			{
+#define NOISE_GRID_CASE( N )\
+			case N: EvaluateRow< N >( gradients, row_octaves, weights, num_octaves, x_origin, spacing, num_points, result_scale, values_ ); break;
+			NOISE_GRID_CASE( 1 );
+			NOISE_GRID_CASE( 2 );
+			NOISE_GRID_CASE( 3 );
+			NOISE_GRID_CASE( 4 );
+			NOISE_GRID_CASE( 5 );
+			NOISE_GRID_CASE( 6 );
+			NOISE_GRID_CASE( 7 );
+			NOISE_GRID_CASE( 8 );
+#undef NOISE_GRID_CASE
+			default:
+				EvaluateRow< 0 >( gradients, row_octaves, weights, num_octaves, x_origin, spacing, num_points, result_scale, values_ );
+			}
+		}
+
+		/// adds the octaves [first_octave, end_octave) to the values (without scaling)
+		template< class ROW_OCTAVE >
+		static void AccumulateRow(
+			const Real* gradients
+			, const ROW_OCTAVE* row_octaves
+			, const OctaveWeights& weights
+			, const unsigned first_octave
+			, const unsigned end_octave
+			, const Real x_origin
+			, const Real spacing
+			, const U32 num_points	//!< must be a multiple of 4
+			, Real * values_
+			)
+		{
+			for( U32 i = 0; i < num_points; i += 4 )
+			{
+				const __m256d lattice_x = _mm256_set_pd( Real(i + 3), Real(i + 2), Real(i + 1), Real(i) );
+				const __m256d x = _mm256_add_pd( Splat( x_origin ), _mm256_mul_pd( lattice_x, Splat( spacing ) ) );
+
+				__m256d	sum = _mm256_loadu_pd( values_ + i );
+				for( unsigned octave = first_octave; octave < end_octave; octave++ )
+				{
+					const __m256d n = Ridge( Perlin( gradients, _mm256_mul_pd( x, Splat( weights.frequencies[ octave ] ) ), row_octaves[ octave ] ) );
+					sum = _mm256_add_pd( sum, _mm256_mul_pd( Splat( weights.amplitudes[ octave ] ), n ) );
+				}
+
+				_mm256_storeu_pd( values_ + i, sum );
+			}
+		}
+	};
+
+#endif // NOISE_GRID_WITH_AVX2
+
+}//namespace
+
+ENoiseGridISA getBestNoiseGridISA()
+{
+	static int s_best_isa = -1;
+	if( s_best_isa < 0 )
+	{
+		PtSystemInfo	sysInfo;
+		mxGetSystemInfo( sysInfo );
+
+		s_best_isa = ( NOISE_GRID_WITH_AVX2 && sysInfo.cpu.has_AVX2 )
+			? NoiseGridISA_AVX2
+			: NoiseGridISA_Scalar
+			;
+	}
+	return (ENoiseGridISA) s_best_isa;
+}
+
+void evaluateTerrainNoise2D_Grid(
+	const NwTerrainNoise2D& fractal
+	, const NwPerlinNoise& perlin_noise
+	, const unsigned int requested_num_octaves
+	, const NwNoiseGrid& grid
+	, Real * values_
+	, const ENoiseGridISA isa
+	)
+{
+	// the octave arrays below have a fixed size
+	const unsigned int num_octaves = smallest( requested_num_octaves, (unsigned int) MAX_GRID_OCTAVES );
+
+	const U32 size_x = grid.size[0];
+
+	// the points which don't fill a whole SIMD register are evaluated with the scalar code
+	U32	num_vectorized_points = 0;
+
+#if NOISE_GRID_WITH_AVX2
+	const OctaveWeights	weights( fractal, num_octaves );
+	const Real* gradients = &perlin_noise.getGradients()[0].x;
+	mxSTATIC_ASSERT( sizeof(perlin_noise.getGradients()[0]) == sizeof(Real) * 3 );
+
+	if( isa == NoiseGridISA_AVX2 ) {
+		num_vectorized_points = size_x & ~3u;
+	}
+#endif
+
+	for( U32 iy = 0; iy < grid.size[1]; iy++ )
+	{
+		const Real y = grid.origin[1] + Real(iy) * grid.spacing;
+		Real * row_values = values_ + iy * size_x;
+
+#if NOISE_GRID_WITH_AVX2
+		if( num_vectorized_points )
+		{
+			RowOctave2D	row_octaves[ MAX_GRID_OCTAVES ];
+			for( unsigned octave = 0; octave < num_octaves; octave++ ) {
+				getRowOctave2D( y * weights.frequencies[ octave ], row_octaves[ octave ] );
+			}
+
+			Noise_AVX2::EvaluateRowWithAnyOctaves(
+				gradients, row_octaves, weights, num_octaves,
+				grid.origin[0], grid.spacing, num_vectorized_points, fractal._result_scale,
+				row_values
+				);
+		}
+#endif
+
+		for( U32 ix = num_vectorized_points; ix < size_x; ix++ )
+		{
+			const Real x = grid.origin[0] + Real(ix) * grid.spacing;
+			row_values[ ix ] = fractal.evaluate2D( x, y, perlin_noise, num_octaves );
+		}
+	}
+}
+
+void evaluateRidgedNoise3D_Grid(
+	const NwTerrainNoise2D& fractal
+	, const NwPerlinNoise& perlin_noise
+	, const unsigned int requested_num_octaves
+	, const NwNoiseGrid& grid
+	, Real * values_
+	, const ENoiseGridISA isa
+	)
+{
+	// the octave arrays below have a fixed size
+	const unsigned int num_octaves = smallest( requested_num_octaves, (unsigned int) MAX_GRID_OCTAVES );
+
+	const U32 size_x = grid.size[0];
+
+	U32	num_vectorized_points = 0;
+
+#if NOISE_GRID_WITH_AVX2
+	const OctaveWeights	weights( fractal, num_octaves );
+	const Real* gradients = &perlin_noise.getGradients()[0].x;
+
+	if( isa == NoiseGridISA_AVX2 ) {
+		num_vectorized_points = size_x & ~3u;
+	}
+#endif
+
+	for( U32 iz = 0; iz < grid.size[2]; iz++ )
+	{
+		const Real z = grid.origin[2] + Real(iz) * grid.spacing;
+
+		for( U32 iy = 0; iy < grid.size[1]; iy++ )
+		{
+			const Real y = grid.origin[1] + Real(iy) * grid.spacing;
+			Real * row_values = values_ + (iz * grid.size[1] + iy) * size_x;
+
+#if NOISE_GRID_WITH_AVX2
+			if( num_vectorized_points )
+			{
+				RowOctave3D	row_octaves[ MAX_GRID_OCTAVES ];
+				for( unsigned octave = 0; octave < num_octaves; octave++ ) {
+					getRowOctave3D( y * weights.frequencies[ octave ], z * weights.frequencies[ octave ], row_octaves[ octave ] );
+				}
+
+				Noise_AVX2::EvaluateRowWithAnyOctaves(
+					gradients, row_octaves, weights, num_octaves,
+					grid.origin[0], grid.spacing, num_vectorized_points, fractal._result_scale,
+					row_values
+					);
+			}
+#endif
+
+			for( U32 ix = num_vectorized_points; ix < size_x; ix++ )
+			{
+				const Real x = grid.origin[0] + Real(ix) * grid.spacing;
+				row_values[ ix ] = fractal.evaluateRidged3D( x, y, z, perlin_noise, num_octaves );
+			}
+		}
+	}
+}
+
+void accumulateRidgedNoise3D_Grid(
+	const NwTerrainNoise2D& fractal
+	, const NwPerlinNoise& perlin_noise
+	, const unsigned int first_octave
+	, const unsigned int requested_end_octave
+	, const NwNoiseGrid& grid
+	, Real * values_
+	, const ENoiseGridISA isa
+	)
+{
+	// the octave arrays below have a fixed size
+	const unsigned int end_octave = smallest( requested_end_octave, (unsigned int) MAX_GRID_OCTAVES );
+	if( first_octave >= end_octave ) {
+		return;
+	}
+
+	const U32 size_x = grid.size[0];
+
+	const OctaveWeights	weights( fractal, end_octave );
+
+	U32	num_vectorized_points = 0;
+
+#if NOISE_GRID_WITH_AVX2
+	const Real* gradients = &perlin_noise.getGradients()[0].x;
+
+	if( isa == NoiseGridISA_AVX2 ) {
+		num_vectorized_points = size_x & ~3u;
+	}
+#endif
+
+	for( U32 iz = 0; iz < grid.size[2]; iz++ )
+	{
+		const Real z = grid.origin[2] + Real(iz) * grid.spacing;
+
+		for( U32 iy = 0; iy < grid.size[1]; iy++ )
+		{
+			const Real y = grid.origin[1] + Real(iy) * grid.spacing;
+			Real * row_values = values_ + (iz * grid.size[1] + iy) * size_x;
+
+#if NOISE_GRID_WITH_AVX2
+			if( num_vectorized_points )
+			{
+				RowOctave3D	row_octaves[ MAX_GRID_OCTAVES ];
+				for( unsigned octave = first_octave; octave < end_octave; octave++ ) {
+					getRowOctave3D( y * weights.frequencies[ octave ], z * weights.frequencies[ octave ], row_octaves[ octave ] );
+				}
+
+				Noise_AVX2::AccumulateRow(
+					gradients, row_octaves, weights, first_octave, end_octave,
+					grid.origin[0], grid.spacing, num_vectorized_points,
+					row_values
+					);
+			}
+#endif
+
+			for( U32 ix = num_vectorized_points; ix < size_x; ix++ )
+			{
+				const Real x = grid.origin[0] + Real(ix) * grid.spacing;
+
+				Real sum = row_values[ ix ];
+				for( unsigned octave = first_octave; octave < end_octave; octave++ )
+				{
+					const Real frequency = weights.frequencies[ octave ];
+					Real n = perlin_noise.evalulate3D( x * frequency, y * frequency, z * frequency );
+					n = Real(1) - fabs( n );
+					n *= n;
+					sum += weights.amplitudes[ octave ] * n;
+				}
+				row_values[ ix ] = sum;
+			}
+		}
+	}
+}
+
+/*
+-----------------------------------------------------------------------------
+	UNIT TESTS
+-----------------------------------------------------------------------------
+*/
+#if MX_DEVELOPER
+
+namespace
+{
+	struct GridBenchmarkResult
+	{
+		U64	scalar_usec;
+		U64	vectorized_usec;
+		U32	num_mismatches;
+	};
+
+	template< class EVALUATE_GRID >
+	ERet benchmarkGrid(
+		EVALUATE_GRID evaluate_grid
+		, const NwTerrainNoise2D& fractal
+		, const NwPerlinNoise& perlin_noise
+		, const unsigned int num_octaves
+		, const NwNoiseGrid& grid
+		, const U32 num_points
+		, AllocatorI & scratchpad
+		, GridBenchmarkResult &result_
+		)
+	{
+		Real *	reference_values;
+		mxTRY_ALLOC_SCOPED( reference_values, num_points, scratchpad );
+		Real *	values;
+		mxTRY_ALLOC_SCOPED( values, num_points, scratchpad );
+
+		ScopedTimer	timer;
+		evaluate_grid( fractal, perlin_noise, num_octaves, grid, reference_values, NoiseGridISA_Scalar );
+		result_.scalar_usec = timer.ElapsedMicroseconds();
+
+		timer.Reset();
+		evaluate_grid( fractal, perlin_noise, num_octaves, grid, values, getBestNoiseGridISA() );
+		result_.vectorized_usec = timer.ElapsedMicroseconds();
+
+		result_.num_mismatches = 0;
+		for( U32 i = 0; i < num_points; i++ ) {
+			result_.num_mismatches += ( values[i] != reference_values[i] );
+		}
+
+		return ALL_OK;
+	}
+
+	float getMegaSamplesPerSecond( const U32 num_points, const U64 usec )
+	{
+		return usec ? float(num_points) / usec : 0.0f;
+	}
+}//namespace
+
+ERet Benchmark_NoiseGrid(
+	AllocatorI & scratchpad
+	, const U32 chunk_resolution
+	, const U32 max_octaves
+	)
+{
+	mxASSERT( max_octaves <= MAX_GRID_OCTAVES );
+
+	NwPerlinNoise	perlin_noise( 1337 );
+
+	NwTerrainNoise2D	fractal;
+	fractal._coarsest_frequency = 0.0173;
+
+	// a chunk with a non-power-of-two size (to test the scalar remainder) crossing the origin (to test negative lattice indices)
+	NwNoiseGrid	grid_3d;
+	grid_3d.origin[0] = -13.7;
+	grid_3d.origin[1] = -5.3;
+	grid_3d.origin[2] = 2.1;
+	grid_3d.spacing = 1.37;
+	grid_3d.size[0] = chunk_resolution + 1;
+	grid_3d.size[1] = chunk_resolution + 1;
+	grid_3d.size[2] = chunk_resolution + 1;
+
+	// a heightmap for 8x8 chunks
+	NwNoiseGrid	grid_2d = grid_3d;
+	grid_2d.size[0] = chunk_resolution * 8 + 1;
+	grid_2d.size[1] = chunk_resolution * 8 + 1;
+	grid_2d.size[2] = 1;
+
+	const U32 num_points_2d = grid_2d.size[0] * grid_2d.size[1];
+	const U32 num_points_3d = grid_3d.size[0] * grid_3d.size[1] * grid_3d.size[2];
+
+	ptPRINT("Noise grid: %ux%u 2D and %ux%ux%u 3D samples, vectorized: %s",
+		grid_2d.size[0], grid_2d.size[1], grid_3d.size[0], grid_3d.size[1], grid_3d.size[2],
+		getBestNoiseGridISA() == NoiseGridISA_AVX2 ? "AVX2" : "no");
+
+	for( U32 num_octaves = 1; num_octaves <= max_octaves; num_octaves++ )
+	{
+		GridBenchmarkResult	result_2d;
+		mxDO(benchmarkGrid( &evaluateTerrainNoise2D_Grid, fractal, perlin_noise, num_octaves, grid_2d, num_points_2d, scratchpad, result_2d ));
+
+		GridBenchmarkResult	result_3d;
+		mxDO(benchmarkGrid( &evaluateRidgedNoise3D_Grid, fractal, perlin_noise, num_octaves, grid_3d, num_points_3d, scratchpad, result_3d ));
+
+		ptPRINT("	%u octaves: 2D: %.2f -> %.2f Msamples/sec (%.2fx), 3D: %.2f -> %.2f Msamples/sec (%.2fx), mismatches: %u",
+			num_octaves,
+			getMegaSamplesPerSecond( num_points_2d, result_2d.scalar_usec ),
+			getMegaSamplesPerSecond( num_points_2d, result_2d.vectorized_usec ),
+			result_2d.vectorized_usec ? float(result_2d.scalar_usec) / result_2d.vectorized_usec : 0.0f,
+			getMegaSamplesPerSecond( num_points_3d, result_3d.scalar_usec ),
+			getMegaSamplesPerSecond( num_points_3d, result_3d.vectorized_usec ),
+			result_3d.vectorized_usec ? float(result_3d.scalar_usec) / result_3d.vectorized_usec : 0.0f,
+			result_2d.num_mismatches + result_3d.num_mismatches
+			);
+
+		mxENSURE( result_2d.num_mismatches + result_3d.num_mismatches == 0, ERR_UNKNOWN_ERROR,
+			"vectorized noise differs from the scalar noise (%u octaves)", num_octaves );
+	}
+
+	return ALL_OK;
+}
+
+#endif // MX_DEVELOPER
+
+}//namespace Noise
@@ -0,0 +1,86 @@
+// Bulk evaluation of fractal noise on regular grids (e.g. for generating terrain chunks).
+#pragma once
+
+#include <ProcGen/Noise/NwNoiseFunctions.h>
+
+
+namespace Noise
+{
+
+/// A regular grid of sample points: position( x, y, z ) = origin + (x, y, z) * spacing.
+/// The samples are stored in X-major order (X changes fastest).
+struct NwNoiseGrid
+{
+	Real	origin[3];
+	Real	spacing;
+	U32		size[3];	//!< the number of samples along each axis, size[2] is ignored by 2D functions
+};
+
+/// The instruction sets used for evaluating noise on grids.
+enum ENoiseGridISA
+{
+	NoiseGridISA_Scalar,	//!< calls the scalar functions for each point
+	NoiseGridISA_AVX2,		//!< 4 points at once, vectorized gradient lookups
+	NoiseGridISA_COUNT
+};
+
+/// Returns AVX2 if both the compiler and the CPU support it.
+ENoiseGridISA getBestNoiseGridISA();
+
+/// Evaluates NwTerrainNoise2D::evaluate2D() at each point of the 2D grid.
+/// Gives exactly the same results as the scalar function (num_octaves is clamped to 32).
+void evaluateTerrainNoise2D_Grid(
+	const NwTerrainNoise2D& fractal
+	, const NwPerlinNoise& perlin_noise
+	, const unsigned int num_octaves
+	, const NwNoiseGrid& grid
+	, Real * values_	//!< size[0] * size[1] values
+	, const ENoiseGridISA isa = getBestNoiseGridISA()
+	);
+
+/// Evaluates NwTerrainNoise2D::evaluateRidged3D() at each point of the 3D grid.
+/// Gives exactly the same results as the scalar function (num_octaves is clamped to 32).
+void evaluateRidgedNoise3D_Grid(
+	const NwTerrainNoise2D& fractal
+	, const NwPerlinNoise& perlin_noise
+	, const unsigned int num_octaves
+	, const NwNoiseGrid& grid
+	, Real * values_	//!< size[0] * size[1] * size[2] values
+	, const ENoiseGridISA isa = getBestNoiseGridISA()
+	);
+
+/// Adds the octaves [first_octave, end_octave) of NwTerrainNoise2D::evaluateRidged3D() to the values at each point of the 3D grid.
+/// The sum is not multiplied by _result_scale (so that the coarse octaves can be computed once and reused).
+/// end_octave is clamped to 32.
+void accumulateRidgedNoise3D_Grid(
+	const NwTerrainNoise2D& fractal
+	, const NwPerlinNoise& perlin_noise
+	, const unsigned int first_octave
+	, const unsigned int end_octave
+	, const NwNoiseGrid& grid
+	, Real * values_	//!< size[0] * size[1] * size[2] values
+	, const ENoiseGridISA isa = getBestNoiseGridISA()
+	);
+
+}//namespace Noise
+
+/*
+-----------------------------------------------------------------------------
+	UNIT TESTS
+-----------------------------------------------------------------------------
+*/
+
+#if MX_DEVELOPER
+
+namespace Noise
+{
+	/// Evaluates 2D and 3D ridged fractal noise on chunk-sized grids for each number of octaves,
+	/// checks that the results are the same as with the scalar functions and prints the number of samples per second.
+	ERet Benchmark_NoiseGrid(
+		AllocatorI & scratchpad
+		, const U32 chunk_resolution = 32	//!< 3D grids have chunk_resolution^3 points
+		, const U32 max_octaves = 8
+		);
+}//namespace Noise
+
+#endif // MX_DEVELOPER
@@ -44,6 +44,9 @@ enum ERendererConstants
 	// must be synced with MAX_BONES_LIMIT in shaders!
 	nwRENDERER_MAX_BONES = 128,	// 128 joints in "maledict" MD5 mesh
 
+	// must be synced with MAX_INSTANCES_PER_BATCH in shaders!
+	nwRENDERER_MAX_INSTANCES_PER_BATCH = 256,	// 256 x float4x4 = 16 KiB of instance data
+
 	// to avoid redundant dynamic memory allocations;
 	// the size should be tuned for the most common scenario
 	nwRENDERER_NUM_RESERVED_SUBMESHES = 4,
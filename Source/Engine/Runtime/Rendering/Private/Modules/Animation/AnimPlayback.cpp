@@ -580,7 +580,11 @@ void NwAnimPlayer::UpdateOncePerFrame(
 			{
 				if(mxUNLIKELY(nil == active_anim.sampling_cache))
 				{
-					_AllocateSamplingCache(active_anim);
+					// out of memory - don't sample this anim until a cache is available
+					if(mxFAILED(_AllocateSamplingCache(active_anim)))
+					{
+						continue;
+					}
 				}
 
 				//
@@ -595,6 +599,7 @@ void NwAnimPlayer::UpdateOncePerFrame(
 				playing_anim.blend_weight	= active_anim.current_blend_weight;
 				playing_anim.prev_time_ratio = playback_ctrl._previous_time_ratio;
 				playing_anim.curr_time_ratio = playback_ctrl._time_ratio;
+				playing_anim.shared_pose_index = INDEX_NONE;
 			}
 
 //#if MX_DEVELOPER
@@ -605,7 +610,7 @@ void NwAnimPlayer::UpdateOncePerFrame(
 //			}
 //#endif
 		}
-		else
+		else if(active_anim.sampling_cache)
 		{
 			_ReleaseSamplingCache(active_anim);
 		}
@@ -668,10 +673,11 @@ ERet NwAnimPlayer::_AllocateSamplingCache(
 	)
 {
 	mxASSERT(nil == playing_anim.sampling_cache);
-	mxOPTIMIZE("num bones")
+	// the cache is only used for sampling this anim
 	playing_anim.sampling_cache = NwAnimationSystem::Get().AllocateSamplingCache(
-		nwRENDERER_MAX_BONES
+		playing_anim.anim->ozz_animation.num_tracks()
 		);
+	chkRET_X_IF_NIL(playing_anim.sampling_cache, ERR_OUT_OF_MEMORY);
 	return ALL_OK;
 }
 
@@ -813,107 +819,301 @@ void UpdateModelJointMatrices(
 }
 
 
-ERet ComputeJointMatricesJob::Run( const NwThreadContext& context, int start, int end )
+namespace
 {
-	AllocatorI &	local_scratchpad = *context.heap;	// thread-local allocator
-	AllocatorI &	global_scratchpad = MemoryHeaps::jobs();	// global thread-safe allocator
-
-	const int num_playing_anims = anim_update_output.anims_count;
-	mxASSERT(num_playing_anims > 0);
-
-	//
-	const ozz::animation::Skeleton&	ozz_skeleton = anim_model._skinned_mesh->ozz_skeleton;
-
-	const int num_joints		= ozz_skeleton.num_joints();
-	const int num_soa_joints	= ozz_skeleton.num_soa_joints();
-
-	//
 	enum Constants
 	{
-		MAX_BLENDED_ANIMS = mxCOUNT_OF(anim_update_output.playing_anims),
+		MAX_BLENDED_ANIMS = NwAnimPlayer::MAX_SIMULTANEOUS_ANIMS,
 		SSE2_ALIGNMENT = 16,
 		ROOT_JOINT = 0
 	};
-	
-	TScopedPtr< ozz::math::SoaTransform >	locals_per_each_anim[ MAX_BLENDED_ANIMS ];
-	for(UINT i = 0; i < mxCOUNT_OF(locals_per_each_anim); i++ ) {
-		new(&locals_per_each_anim[i]) TScopedPtr< ozz::math::SoaTransform >(local_scratchpad);
-	}
 
-	// Prepares blending layers.
-	ozz::animation::BlendingJob::Layer	ozz_blend_layers[MAX_BLENDED_ANIMS];
-
-	//
-	for( int i = 0; i < num_playing_anims; i++ )
+	/// Samples all playing animations and blends them into the given local transforms.
+	static
+	ERet SampleAndBlendAnimations(
+		ozz::math::SoaTransform * output_locals
+		, V3f &blended_root_joint_pos_in_model_space_
+		, const NwAnimatedModel& anim_model
+		, const NwAnimPlayer::UpdateOutput& anim_update_output
+		, AllocatorI & local_scratchpad
+		)
 	{
-		NwPlayingAnim& playing_anim = anim_update_output.playing_anims[ i ];
-		mxASSERT(playing_anim.blend_weight > 0);
+		const int num_playing_anims = anim_update_output.anims_count;
+		mxASSERT(num_playing_anims > 0);
 
-		// Buffer of local transforms as sampled from animation.
-		ozz::math::SoaTransform *	locals;
-		mxDO(nwAllocArray( locals, num_soa_joints, local_scratchpad, SSE2_ALIGNMENT ));
+		const ozz::animation::Skeleton&	ozz_skeleton = anim_model._skinned_mesh->ozz_skeleton;
+		const int num_soa_joints	= ozz_skeleton.num_soa_joints();
 
-		new(&locals_per_each_anim[ i ]) TScopedPtr< ozz::math::SoaTransform >(
-			local_scratchpad, locals
-			);
+		//
+		const bool should_use_blending = num_playing_anims > 1;
+
+		TScopedPtr< ozz::math::SoaTransform >	locals_per_each_anim[ MAX_BLENDED_ANIMS ];
+		for(UINT i = 0; i < mxCOUNT_OF(locals_per_each_anim); i++ ) {
+			new(&locals_per_each_anim[i]) TScopedPtr< ozz::math::SoaTransform >(local_scratchpad);
+		}
+
+		// Prepares blending layers.
+		ozz::animation::BlendingJob::Layer	ozz_blend_layers[MAX_BLENDED_ANIMS];
+
+		//
+		for( int i = 0; i < num_playing_anims; i++ )
+		{
+			const NwPlayingAnim& playing_anim = anim_update_output.playing_anims[ i ];
+			mxASSERT(playing_anim.blend_weight > 0);
+
+			// Crowds: use the pose sampled by another model playing the same clip at the same time.
+			if( playing_anim.shared_pose_index != INDEX_NONE )
+			{
+				const ozz::math::SoaTransform* shared_locals = NwAnimationSystem::Get().GetSharedPose(
+					playing_anim.shared_pose_index
+					);
+				if( shared_locals )
+				{
+					if( !should_use_blending ) {
+						memcpy( output_locals, shared_locals, sizeof(output_locals[0]) * num_soa_joints );
+					}
+
+					ozz_blend_layers[i].transform	= ozz::Range< const ozz::math::SoaTransform >(
+						shared_locals,
+						shared_locals + num_soa_joints
+						);
+					ozz_blend_layers[i].weight		= playing_anim.blend_weight;
+					continue;
+				}
+				// fall back to sampling the anim
+			}
+
+			// Buffer of local transforms as sampled from animation.
+			ozz::math::SoaTransform *	locals;
+
+			if( !should_use_blending )
+			{
+				// Fast path - no blending needed, sample directly into the output.
+				locals = output_locals;
+			}
+			else
+			{
+				mxDO(nwAllocArray( locals, num_soa_joints, local_scratchpad, SSE2_ALIGNMENT ));
+
+				new(&locals_per_each_anim[ i ]) TScopedPtr< ozz::math::SoaTransform >(
+					local_scratchpad, locals
+					);
+			}
+
+			ozz::Range< ozz::math::SoaTransform >	locals_ozz_range(
+				locals,
+				locals + num_soa_joints
+				);
+
+			//
+			ozz::animation::SamplingJob	ozz_sampling_job;
+			ozz_sampling_job.animation	= &playing_anim.anim_clip->ozz_animation;
+			ozz_sampling_job.cache		= &playing_anim.sampling_cache->ozz_sampling_cache;
+			ozz_sampling_job.ratio		= playing_anim.curr_time_ratio;
+			ozz_sampling_job.output		= locals_ozz_range;
+
+			mxENSURE(ozz_sampling_job.Run(), ERR_UNKNOWN_ERROR, "");
+
+			//
+			ozz_blend_layers[i].transform	= locals_ozz_range;
+			ozz_blend_layers[i].weight		= playing_anim.blend_weight;
+		}//
 
-		ozz::Range< ozz::math::SoaTransform >	locals_ozz_range(
-			locals,
-			locals + num_soa_joints
-			);
 
 		//
-		ozz::animation::SamplingJob	ozz_sampling_job;
-		ozz_sampling_job.animation	= &playing_anim.anim_clip->ozz_animation;
-		ozz_sampling_job.cache		= &playing_anim.sampling_cache->ozz_sampling_cache;
-		ozz_sampling_job.ratio		= playing_anim.curr_time_ratio;
-		ozz_sampling_job.output		= locals_ozz_range;
+		if( should_use_blending )
+		{
+			//
+			// Blends animations.
+			// Blends the local spaces transforms computed by sampling all animations
+			// (1st stage just above), and outputs the result to the local space
+			// transform buffer output_locals
+
+			// Setups blending job.
+			ozz::animation::BlendingJob ozz_blending_job;
+			ozz_blending_job.threshold = 0.1f;
+			ozz_blending_job.layers = ozz::Range< const ozz::animation::BlendingJob::Layer >(
+				ozz_blend_layers,
+				num_playing_anims
+				);
+			ozz_blending_job.bind_pose = ozz_skeleton.joint_bind_poses();
+			ozz_blending_job.output = ozz::Range< ozz::math::SoaTransform >(
+				output_locals,
+				output_locals + num_soa_joints
+				);
+
+			// Blends.
+			mxENSURE(ozz_blending_job.Run(), ERR_UNKNOWN_ERROR, "");
+		}
 
-		mxENSURE(ozz_sampling_job.Run(), ERR_UNKNOWN_ERROR, "");
+
+		// root motion
 
 		//
-		ozz_blend_layers[i].transform	= locals_ozz_range;
-		ozz_blend_layers[i].weight		= playing_anim.blend_weight;
-	}//
+		V3f	blended_root_joint_pos_in_model_space = CV3f(0);
+
+		for( int iAnim = 0; iAnim < num_playing_anims; iAnim++ )
+		{
+			const NwPlayingAnim& playing_anim = anim_update_output.playing_anims[ iAnim ];
+
+			const ozz::math::SoaFloat3& soa_trans = ozz_blend_layers[ iAnim ].transform.begin[ROOT_JOINT].translation;
 
+			const V3f root_joint_pos_in_model_space = CV3f(
+				soa_trans.x.m128_f32[0],
+				soa_trans.y.m128_f32[0],
+				soa_trans.z.m128_f32[0]
+			);
+
+			blended_root_joint_pos_in_model_space
+				+= root_joint_pos_in_model_space * playing_anim.blend_weight
+				;
+		}
+
+		blended_root_joint_pos_in_model_space_ = blended_root_joint_pos_in_model_space;
+
+		return ALL_OK;
+	}
+
+	/// Interpolates between two poses, four joints at a time.
+	static
+	void InterpolateSoaPoses(
+		ozz::math::SoaTransform * __restrict result
+		, const ozz::math::SoaTransform * __restrict pose_a
+		, const ozz::math::SoaTransform * __restrict pose_b
+		, const int num_soa_joints
+		, const float01_t alpha
+		)
+	{
+		const ozz::math::SimdFloat4 simd_alpha = ozz::math::simd_float4::Load1( alpha );
 
+		for( int i = 0; i < num_soa_joints; i++ )
+		{
+			const ozz::math::SoaTransform& a = pose_a[i];
+			const ozz::math::SoaTransform& b = pose_b[i];
+
+			// negate opposed quaternions to interpolate along the shortest path (like ozz::animation::BlendingJob)
+			const ozz::math::SimdFloat4 dot
+				= a.rotation.x * b.rotation.x
+				+ a.rotation.y * b.rotation.y
+				+ a.rotation.z * b.rotation.z
+				+ a.rotation.w * b.rotation.w
+				;
+			const ozz::math::SimdInt4 sign = ozz::math::Sign( dot );
+
+			const ozz::math::SoaQuaternion b_rotation = {
+				ozz::math::Xor( b.rotation.x, sign ),
+				ozz::math::Xor( b.rotation.y, sign ),
+				ozz::math::Xor( b.rotation.z, sign ),
+				ozz::math::Xor( b.rotation.w, sign )
+			};
+
+			result[i].translation	= ozz::math::Lerp( a.translation, b.translation, simd_alpha );
+			result[i].rotation		= ozz::math::NLerp( a.rotation, b_rotation, simd_alpha );
+			result[i].scale			= ozz::math::Lerp( a.scale, b.scale, simd_alpha );
+		}
+	}
+}//namespace
+
+ERet ComputeJointMatrices(
+	NwAnimatedModel & anim_model
+	, const NwAnimPlayer::UpdateOutput& anim_update_output
+	, AllocatorI & local_scratchpad	// thread-local allocator
+	)
+{
 	//
-	const bool should_use_blending = num_playing_anims > 1;
+	const ozz::animation::Skeleton&	ozz_skeleton = anim_model._skinned_mesh->ozz_skeleton;
 
-	/// Buffer of local transforms which stores the blending result.
-	TScopedPtr< ozz::math::SoaTransform >	blended_locals( local_scratchpad );
-	mxDO(nwAllocArray( blended_locals.ptr, num_soa_joints, blended_locals.allocator, SSE2_ALIGNMENT ));
+	const int num_joints		= ozz_skeleton.num_joints();
+	const int num_soa_joints	= ozz_skeleton.num_soa_joints();
+
+	NwAnimLodState &	anim_lod = anim_model.anim_lod;
+
+	/// Buffer of local transforms for sampling without LoD and for interpolation.
+	TScopedPtr< ozz::math::SoaTransform >	scratch_locals( local_scratchpad );
+
+	/// The local transforms from which the model space matrices are computed.
+	const ozz::math::SoaTransform *	pose_locals = nil;
+
+	V3f	blended_root_joint_pos_in_model_space = CV3f(0);
 
 	//
-	if( !should_use_blending )
+	if( anim_lod.shouldSampleThisFrame() )
 	{
-		// Fast path - no blending needed.
+		ozz::math::SoaTransform *	sampled_locals;
+
+		if( anim_lod.sampled_locals[0] )
+		{
+			// the latest pose becomes the previous one
+			TSwap( anim_lod.sampled_locals[0], anim_lod.sampled_locals[1] );
+			sampled_locals = anim_lod.sampled_locals[1];
+		}
+		else
+		{
+			mxDO(nwAllocArray( scratch_locals.ptr, num_soa_joints, scratch_locals.allocator, SSE2_ALIGNMENT ));
+			sampled_locals = scratch_locals.ptr;
+		}
+
+		mxDO(SampleAndBlendAnimations(
+			sampled_locals
+			, blended_root_joint_pos_in_model_space
+			, anim_model
+			, anim_update_output
+			, local_scratchpad
+			));
+
+		if( anim_lod.sampled_locals[0] )
+		{
+			anim_lod.sampled_root_joint_pos[0] = anim_lod.sampled_root_joint_pos[1];
+			anim_lod.sampled_root_joint_pos[1] = blended_root_joint_pos_in_model_space;
+
+			if( !anim_lod.has_sampled_pose )
+			{
+				memcpy( anim_lod.sampled_locals[0], sampled_locals, sizeof(sampled_locals[0]) * num_soa_joints );
+				anim_lod.sampled_root_joint_pos[0] = blended_root_joint_pos_in_model_space;
+				anim_lod.has_sampled_pose = true;
+			}
+		}
+
+		pose_locals = sampled_locals;
 	}
-	else
+
+	// Animation LoD: interpolate between the two last sampled poses
+	// (lagging behind by up to update_interval frames).
+	if( anim_lod.has_sampled_pose && anim_lod.update_interval > 1 )
 	{
-		//
-		// Blends animations.
-		// Blends the local spaces transforms computed by sampling all animations
-		// (1st stage just above), and outputs the result to the local space
-		// transform buffer blended_locals_
-
-		// Setups blending job.
-		ozz::animation::BlendingJob ozz_blending_job;
-		ozz_blending_job.threshold = 0.1f;
-		ozz_blending_job.layers = ozz::Range< const ozz::animation::BlendingJob::Layer >(
-			ozz_blend_layers,
-			num_playing_anims
-			);
-		ozz_blending_job.bind_pose = ozz_skeleton.joint_bind_poses();
-		ozz_blending_job.output = ozz::Range< ozz::math::SoaTransform >(
-			blended_locals.ptr,
-			blended_locals.ptr + num_soa_joints
-			);
+		const float01_t alpha = float( anim_lod.frames_since_sampling + 1 ) / float( anim_lod.update_interval );
+
+		if( alpha < 1.0f )
+		{
+			if( !scratch_locals.ptr ) {
+				mxDO(nwAllocArray( scratch_locals.ptr, num_soa_joints, scratch_locals.allocator, SSE2_ALIGNMENT ));
+			}
+
+			InterpolateSoaPoses(
+				scratch_locals.ptr
+				, anim_lod.sampled_locals[0]
+				, anim_lod.sampled_locals[1]
+				, num_soa_joints
+				, alpha
+				);
 
-		// Blends.
-		mxENSURE(ozz_blending_job.Run(), ERR_UNKNOWN_ERROR, "");
+			pose_locals = scratch_locals.ptr;
+
+			blended_root_joint_pos_in_model_space = V3_Lerp(
+				anim_lod.sampled_root_joint_pos[0]
+				, anim_lod.sampled_root_joint_pos[1]
+				, alpha
+				);
+		}
+		else
+		{
+			pose_locals = anim_lod.sampled_locals[1];
+			blended_root_joint_pos_in_model_space = anim_lod.sampled_root_joint_pos[1];
+		}
 	}
 
+	mxASSERT_PTR(pose_locals);
+
 
 	/// Buffer of model space matrices. These are computed by the local-to-model
 	/// job after the blending stage.
@@ -926,21 +1126,10 @@ ERet ComputeJointMatricesJob::Run( const NwThreadContext& context, int start, in
 	{
 		ozz_local_to_model_job.skeleton = &ozz_skeleton;
 
-		if( !should_use_blending )
-		{
-			ozz::math::SoaTransform *	locals = locals_per_each_anim[0].ptr;
-			ozz_local_to_model_job.input = ozz::Range< ozz::math::SoaTransform >(
-				locals,
-				locals + num_soa_joints
-				);
-		}
-		else
-		{
-			ozz_local_to_model_job.input = ozz::Range< ozz::math::SoaTransform >(
-				blended_locals.ptr,
-				blended_locals.ptr + num_soa_joints
+		ozz_local_to_model_job.input = ozz::Range< const ozz::math::SoaTransform >(
+			pose_locals,
+			pose_locals + num_soa_joints
 			);
-		}
 
 		ozz_local_to_model_job.output = ozz::Range< ozz::math::Float4x4 >(
 			models.ptr,
@@ -964,30 +1153,6 @@ ERet ComputeJointMatricesJob::Run( const NwThreadContext& context, int start, in
 
 	// root motion
 
-	//anim_model.job_result.root_joint_offset
-	//	= (V3f&) models.ptr[ 0 ].cols[3]// * anim_update_output.playing_anims[0].blend_weight
-	//	;
-
-	//
-	V3f	blended_root_joint_pos_in_model_space = CV3f(0);
-
-	for( int iAnim = 0; iAnim < num_playing_anims; iAnim++ )
-	{
-		const NwPlayingAnim& playing_anim = anim_update_output.playing_anims[ iAnim ];
-
-		const ozz::math::SoaFloat3& soa_trans = locals_per_each_anim[ iAnim ].ptr[ROOT_JOINT].translation;
-
-		const V3f root_joint_pos_in_model_space = CV3f(
-			soa_trans.x.m128_f32[0],
-			soa_trans.y.m128_f32[0],
-			soa_trans.z.m128_f32[0]
-		);
-
-		blended_root_joint_pos_in_model_space
-			+= root_joint_pos_in_model_space * playing_anim.blend_weight
-			;
-	}
-
 	anim_model.job_result.blended_root_joint_pos_in_model_space
 		= blended_root_joint_pos_in_model_space
 		;
@@ -1008,6 +1173,36 @@ ERet ComputeJointMatricesJob::Run( const NwThreadContext& context, int start, in
 	return ALL_OK;
 }
 
+ERet ComputeJointMatricesJob::Run( const NwThreadContext& context, int start, int end )
+{
+	return ComputeJointMatrices(
+		anim_model
+		, anim_update_output
+		, *context.heap	// thread-local allocator
+		);
+}
+
+ERet ComputeJointMatricesBatchJob::Run( const NwThreadContext& context, int start, int end )
+{
+	for( int batch_index = start; batch_index < end; batch_index++ )
+	{
+		const U32 first_model = batch_index * MODELS_PER_BATCH;
+		const U32 last_model = smallest( first_model + MODELS_PER_BATCH, num_models );
+
+		for( U32 i = first_model; i < last_model; i++ )
+		{
+			NwAnimatedModel & anim_model = *models[i];
+
+			mxDO(ComputeJointMatrices(
+				anim_model
+				, anim_model.anim_update_output
+				, *context.heap
+				));
+		}
+	}
+	return ALL_OK;
+}
+
 }//namespace AnimJobs
 
 }//namespace Rendering
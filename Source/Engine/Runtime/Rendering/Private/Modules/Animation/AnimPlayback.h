@@ -179,6 +179,10 @@ struct NwPlayingAnim
 
 	float01_t	prev_time_ratio;
 	float01_t	curr_time_ratio;
+
+	/// index of the pose shared with other models (see NwAnimationSystem::RequestSharedPose())
+	/// or INDEX_NONE if the anim must be sampled by this model
+	U32			shared_pose_index;
 };
 
 /// plays and blends animations
@@ -371,6 +375,14 @@ struct NwAnimatedModel;
 
 namespace AnimJobs
 {
+	/// Samples and blends the animations (or interpolates the last sampled poses, see NwAnimLodState),
+	/// computes the model-space joint matrices and the skinning matrices.
+	ERet ComputeJointMatrices(
+		NwAnimatedModel & anim_model
+		, const NwAnimPlayer::UpdateOutput& anim_update_output
+		, AllocatorI & scratchpad
+		);
+
 	///
 	struct ComputeJointMatricesJob
 	{
@@ -391,6 +403,32 @@ namespace AnimJobs
 	};
 	mxSTATIC_ASSERT(sizeof(ComputeJointMatricesJob) <= sizeof(NwJobData));
 
+	/// computes the joint matrices of several models per job,
+	/// using the update output stored in the models
+	struct ComputeJointMatricesBatchJob
+	{
+		NwAnimatedModel *const *	models;
+		U32							num_models;
+
+	public:
+		enum { MODELS_PER_BATCH = 16 };
+
+		ComputeJointMatricesBatchJob(
+			NwAnimatedModel *const * models
+			, const U32 num_models
+			)
+			: models(models)
+			, num_models(num_models)
+		{}
+
+		static U32 NumBatches( const U32 num_models ) {
+			return ( num_models + MODELS_PER_BATCH - 1 ) / MODELS_PER_BATCH;
+		}
+
+		ERet Run( const NwThreadContext& context, int start, int end );
+	};
+	mxSTATIC_ASSERT(sizeof(ComputeJointMatricesBatchJob) <= sizeof(NwJobData));
+
 }//namespace AnimJobs
 
 }//namespace Rendering
@@ -2,7 +2,10 @@
 #pragma hdrstop
 
 #include <Core/Client.h>	// NwTime
+#include <Core/Memory/MemoryHeaps.h>
+#include <Core/Util/ScopedTimer.h>
 #include <Rendering/Private/Modules/Animation/AnimatedModel.h>
+#include <Rendering/Private/Modules/Animation/_AnimationSystem.h>
 
 namespace Rendering
 {
@@ -130,6 +133,8 @@ ERet Create(
 	mxDO(new_render_model->joint_matrices.setNum( num_joints ));
 	Arrays::setAll( new_render_model->joint_matrices, g_MM_Identity );
 
+	// the two last sampled poses for animation LoD are allocated by AdvanceAnimations() when needed
+
 	//
 	new_anim_model->_skinned_mesh = skinned_model;
 
@@ -154,6 +159,17 @@ void Destroy(
 		"Did you forget to call RemoveFromWorld()?"
 		);
 
+	// the buffers are swapped after sampling
+	const NwAnimLodState& anim_lod = anim_model->anim_lod;
+	if( anim_lod.sampled_locals[0] )
+	{
+		MemoryHeaps::animation().Deallocate(
+			( anim_lod.sampled_locals[0] < anim_lod.sampled_locals[1] )
+			? anim_lod.sampled_locals[0]
+			: anim_lod.sampled_locals[1]
+			);
+	}
+
 	//
 	clump.delete_(anim_model->render_model._ptr);
 
@@ -186,83 +202,165 @@ void RemoveFromWorld(
 		);*/
 }
 
-/// Updates current animation time and skeleton pose.
 static
-bool RunAndBlendAnimations(
+U8 GetAnimUpdateInterval(
+	const NwAnimatedModel& anim_model
+	, const NwAnimLodSettings& lod_settings
+	)
+{
+	const V3f model_position = M44_getTranslation( anim_model.render_model->local_to_world );
+	const float distance_squared = ( model_position - lod_settings.camera_position ).lengthSquared();
+
+	if( distance_squared > squaref( lod_settings.quarter_rate_distance ) ) {
+		return 4;
+	}
+	if( distance_squared > squaref( lod_settings.half_rate_distance ) ) {
+		return 2;
+	}
+	return 1;
+}
+
+/// Allocates the two last sampled poses, the first time the model is animated with LoD.
+static
+ERet AllocateLodPoses(
+	NwAnimLodState & anim_lod
+	, const ozz::animation::Skeleton& ozz_skeleton
+	)
+{
+	const int num_soa_joints = ozz_skeleton.num_soa_joints();
+
+	mxDO(nwAllocArray( anim_lod.sampled_locals[0], num_soa_joints * 2, MemoryHeaps::animation(), 16 ));
+	anim_lod.sampled_locals[1] = anim_lod.sampled_locals[0] + num_soa_joints;
+
+	return ALL_OK;
+}
+
+/// Updates current animation time, selects the animation LoD and emits anim events.
+/// Returns true if the skeleton pose must be updated.
+static
+bool AdvanceAnimations(
 	NwAnimatedModel & anim_model
 	, float delta_seconds
-	, NwClump & clump
-	, NwJobSchedulerI& task_scheduler
+	, const NwAnimLodSettings* lod_settings
 )
 {
-	// Update and sample all animations to their respective local space transform buffers.
-
 	NwAnimPlayer& anim_player = anim_model.anim_player;
 
 	//
-	NwAnimPlayer::UpdateOutput anim_update_output;
+	NwAnimPlayer::UpdateOutput &	anim_update_output = anim_model.anim_update_output;
 
 	anim_player.UpdateOncePerFrame(
 		delta_seconds
 		, anim_update_output
 		);
 
-	if(mxLIKELY(anim_update_output.anims_count))
+	if(mxUNLIKELY(!anim_update_output.anims_count))
 	{
-		// Launch parallel jobs.
-		NwJobData	anim_job_data;
+		return false;
+	}
 
-		task_scheduler.AddJob(
-			new(&anim_job_data) AnimJobs::ComputeJointMatricesJob(
-			anim_model
-			, anim_update_output
-			)
-			, JobPriority_High
-			);
+	// Select the animation LoD.
+	{
+		NwAnimLodState & anim_lod = anim_model.anim_lod;
 
-		// Emit anim events.
+		U8 update_interval = lod_settings
+			? GetAnimUpdateInterval( anim_model, *lod_settings )
+			: 1
+			;
+
+		// models which are always sampled every frame don't need the LoD poses
+		if( update_interval > 1 && !anim_lod.sampled_locals[0] )
 		{
-			NwAnimEventList::AnimEventCallback* anim_events_callback = anim_model.anim_events_callback;
-			void * anim_events_callback_data = anim_model.anim_events_callback_data;
+			if( mxFAILED(AllocateLodPoses( anim_lod, anim_model._skinned_mesh->ozz_skeleton )) ) {
+				update_interval = 1;
+			}
+		}
 
-			mxASSERT_PTR(anim_events_callback);
-			mxASSERT_PTR(anim_events_callback_data);
+		anim_lod.update_interval = update_interval;
+		anim_lod.frames_since_sampling = ( anim_lod.frames_since_sampling + 1 < update_interval )
+			? anim_lod.frames_since_sampling + 1
+			: 0
+			;
 
-			NwAnimEventList_::ProcessAnimEventsWithCallback(
-				anim_update_output.playing_anims
-				, anim_update_output.anims_count
-				, anim_events_callback
-				, anim_events_callback_data
-				);
+		// Crowds: share the sampled poses between the models playing the same clips at the same time.
+		if( anim_lod.shouldSampleThisFrame() )
+		{
+			NwAnimationSystem& anim_system = NwAnimationSystem::Get();
+			const ozz::animation::Skeleton& ozz_skeleton = anim_model._skinned_mesh->ozz_skeleton;
+
+			for( UINT i = 0; i < anim_update_output.anims_count; i++ )
+			{
+				NwPlayingAnim &playing_anim = anim_update_output.playing_anims[ i ];
+				playing_anim.shared_pose_index = anim_system.RequestSharedPose(
+					playing_anim
+					, ozz_skeleton
+					);
+			}
 		}
 	}
 
+	// Emit anim events.
+	{
+		NwAnimEventList::AnimEventCallback* anim_events_callback = anim_model.anim_events_callback;
+		void * anim_events_callback_data = anim_model.anim_events_callback_data;
+
+		mxASSERT_PTR(anim_events_callback);
+		mxASSERT_PTR(anim_events_callback_data);
+
+		NwAnimEventList_::ProcessAnimEventsWithCallback(
+			anim_update_output.playing_anims
+			, anim_update_output.anims_count
+			, anim_events_callback
+			, anim_events_callback_data
+			);
+	}
+
 	return true;
 }
 
+/// Launches parallel jobs for computing the joint matrices.
 static
-void UpdateInstance(
-					NwAnimatedModel & anim_model
-					, const NwTime& args
-					, NwClump & clump
-					, NwJobSchedulerI& task_scheduler
-					)
+JobID LaunchAnimationJobs(
+	const DynamicArray< NwAnimatedModel* >& models_to_animate
+	, NwJobSchedulerI& task_scheduler
+	)
 {
-	RunAndBlendAnimations(
-		anim_model
-		, args.real.delta_seconds
-		, clump
-		, task_scheduler
-		);
+	// allocate memory for the shared poses requested by AdvanceAnimations()
+	NwAnimationSystem::Get().EndPoseSharing();
+
+	const JobID anim_jobs_group = task_scheduler.beginGroup();
+
+	if( const U32 num_models = models_to_animate.num() )
+	{
+		JobID	h_anim_job;
+		nwCREATE_JOB(h_anim_job
+			, task_scheduler
+			, -1, AnimJobs::ComputeJointMatricesBatchJob::NumBatches( num_models )
+			, JobPriority_High
+			, AnimJobs::ComputeJointMatricesBatchJob
+			, models_to_animate.raw()
+			, num_models
+			);
+		(void) h_anim_job;
+	}
+
+	task_scheduler.endGroup();
+
+	return anim_jobs_group;
 }
 
 JobID UpdateInstances(
 					  NwClump & clump
 					  , const NwTime& args
 					  , NwJobSchedulerI& task_scheduler
+					  , const NwAnimLodSettings* lod_settings /*= nil*/
 					  )
 {
-	const JobID anim_jobs_group = task_scheduler.beginGroup();
+	NwAnimationSystem& anim_system = NwAnimationSystem::Get();
+	anim_system.BeginPoseSharing();
+
+	DynamicArray< NwAnimatedModel* > &	models_to_animate = anim_system.models_to_animate;
+	models_to_animate.RemoveAll();
 
 	NwClump::Iterator< NwAnimatedModel >	it( clump );
 	while( it.IsValid() )
@@ -271,22 +369,311 @@ JobID UpdateInstances(
 
 		if(!anim_model.is_paused)
 		{
-			UpdateInstance(
+			if( AdvanceAnimations(
 				anim_model
-				, args
-				, clump
-				, task_scheduler
-				);
+				, args.real.delta_seconds
+				, lod_settings
+				) )
+			{
+				models_to_animate.add( &anim_model );
+			}
 		}
 
 		it.MoveToNext();
 	}
 
-	task_scheduler.endGroup();
+	return LaunchAnimationJobs(
+		models_to_animate
+		, task_scheduler
+		);
+}
 
-	return anim_jobs_group;
+JobID UpdateModels(
+	NwAnimatedModel *const * models
+	, const U32 num_models
+	, const SecondsF delta_seconds
+	, NwJobSchedulerI& task_scheduler
+	, const NwAnimLodSettings* lod_settings /*= nil*/
+	)
+{
+	NwAnimationSystem& anim_system = NwAnimationSystem::Get();
+	anim_system.BeginPoseSharing();
+
+	DynamicArray< NwAnimatedModel* > &	models_to_animate = anim_system.models_to_animate;
+	models_to_animate.RemoveAll();
+
+	for( U32 i = 0; i < num_models; i++ )
+	{
+		NwAnimatedModel & anim_model = *models[i];
+
+		if( !anim_model.is_paused && AdvanceAnimations(
+			anim_model
+			, delta_seconds
+			, lod_settings
+			) )
+		{
+			models_to_animate.add( &anim_model );
+		}
+	}
+
+	return LaunchAnimationJobs(
+		models_to_animate
+		, task_scheduler
+		);
 }
 
 }//namespace
 
 }//namespace Rendering
+
+/*
+-----------------------------------------------------------------------------
+	UNIT TESTS
+-----------------------------------------------------------------------------
+*/
+
+#if MX_DEVELOPER
+
+namespace Rendering
+{
+namespace NwAnimatedModel_
+{
+
+static
+void IgnoreAnimEvent(
+	const NwAnimEvent& anim_event
+	, void * user_data
+	)
+{
+}
+
+/// returns the average time per frame, in microseconds
+static
+U64 AnimateModelsForBenchmark(
+	const DynamicArray< NwAnimatedModel* >& models
+	, const U32 num_frames
+	, NwJobSchedulerI& task_scheduler
+	, const bool use_batched_jobs
+	, const NwAnimLodSettings* lod_settings
+	)
+{
+	const SecondsF delta_seconds = 1.0f / 60.0f;
+
+	ScopedTimer	timer;
+
+	for( U32 iFrame = 0; iFrame < num_frames; iFrame++ )
+	{
+		if( use_batched_jobs )
+		{
+			const JobID anim_jobs_group = UpdateModels(
+				models.raw()
+				, models.num()
+				, delta_seconds
+				, task_scheduler
+				, lod_settings
+				);
+			task_scheduler.waitFor( anim_jobs_group );
+		}
+		else
+		{
+			// one job per model, as before batching
+			NwAnimationSystem::Get().BeginPoseSharing();
+
+			for( U32 i = 0; i < models.num(); i++ ) {
+				AdvanceAnimations( *models[i], delta_seconds, lod_settings );
+			}
+
+			NwAnimationSystem::Get().EndPoseSharing();
+
+			const JobID anim_jobs_group = task_scheduler.beginGroup();
+
+			for( U32 i = 0; i < models.num(); i++ )
+			{
+				NwAnimatedModel & anim_model = *models[i];
+
+				if( anim_model.anim_update_output.anims_count )
+				{
+					NwJobData	anim_job_data;
+
+					task_scheduler.AddJob(
+						new(&anim_job_data) AnimJobs::ComputeJointMatricesJob(
+						anim_model
+						, anim_model.anim_update_output
+						)
+						, JobPriority_High
+						);
+				}
+			}
+
+			task_scheduler.endGroup();
+			task_scheduler.waitFor( anim_jobs_group );
+		}
+	}
+
+	return timer.ElapsedMicroseconds() / num_frames;
+}
+
+static
+ERet RunAnimationUpdateBenchmark(
+	const DynamicArray< NwAnimatedModel* >& models
+	, NwJobSchedulerI& task_scheduler
+	)
+{
+	enum { NUM_FRAMES = 100 };
+
+	// the models are placed up to 100 meters away from the camera
+	NwAnimLodSettings	lod_settings;
+	lod_settings.camera_position = CV3f(0);
+
+	const U64 per_model_jobs_usec = AnimateModelsForBenchmark( models, NUM_FRAMES, task_scheduler, false, nil );
+	const U64 batched_jobs_usec = AnimateModelsForBenchmark( models, NUM_FRAMES, task_scheduler, true, nil );
+	const U64 batched_jobs_with_lod_usec = AnimateModelsForBenchmark( models, NUM_FRAMES, task_scheduler, true, &lod_settings );
+
+	ptPRINT("Animation update: %u models, per frame: %.3f ms (one job per model) -> %.3f ms (batched) -> %.3f ms (batched, with LoD)",
+		models.num(),
+		per_model_jobs_usec * 1e-3f,
+		batched_jobs_usec * 1e-3f,
+		batched_jobs_with_lod_usec * 1e-3f
+		);
+
+	return ALL_OK;
+}
+
+/// the models start playing the anim at num_start_times different times
+static
+ERet CreateBenchmarkModels(
+	DynamicArray< NwAnimatedModel* > &models_
+	, const U32 num_models
+	, const U32 num_start_times
+	, const TResPtr< NwSkinnedMesh >& skinned_mesh
+	, const NameHash32 anim_name_hash
+	, NwClump & clump
+	)
+{
+	mxASSERT(num_start_times > 0);
+	mxDO(models_.reserve( num_models ));
+
+	for( U32 i = 0; i < num_models; i++ )
+	{
+		NwAnimatedModel *	new_anim_model;
+		mxDO(Create(
+			new_anim_model
+			, clump
+			, skinned_mesh
+			, &IgnoreAnimEvent
+			));
+		models_.add( new_anim_model );
+
+		// evenly distribute the models within 100 meters from the camera
+		new_anim_model->render_model->local_to_world = M44_buildTranslationMatrix(
+			CV3f( 100.0f * i / num_models, 0, 0 )
+			);
+
+		mxDO(new_anim_model->PlayAnim(
+			anim_name_hash
+			, NwPlayAnimParams()
+			, PlayAnimFlags::Looped
+			, NwStartAnimParams().SetStartTimeRatio( float( i % num_start_times ) / num_start_times )
+			));
+	}
+
+	return ALL_OK;
+}
+
+static
+void DestroyBenchmarkModels(
+	DynamicArray< NwAnimatedModel* > &models
+	, NwClump & clump
+	)
+{
+	for( U32 i = 0; i < models.num(); i++ ) {
+		Destroy( models[i], clump );
+	}
+	models.RemoveAll();
+}
+
+ERet Benchmark_AnimationUpdate(
+	const TResPtr< NwSkinnedMesh >& skinned_mesh
+	, const NameHash32 anim_name_hash
+	, NwClump & clump
+	, NwJobSchedulerI& task_scheduler
+	, const U32 num_models
+	)
+{
+	DynamicArray< NwAnimatedModel* >	models( MemoryHeaps::animation() );
+
+	ERet result = CreateBenchmarkModels(
+		models
+		, num_models
+		, num_models
+		, skinned_mesh
+		, anim_name_hash
+		, clump
+		);
+
+	if( mxSUCCEDED(result) )
+	{
+		result = RunAnimationUpdateBenchmark( models, task_scheduler );
+	}
+
+	DestroyBenchmarkModels( models, clump );
+
+	return result;
+}
+
+ERet Benchmark_SharedPoses(
+	const TResPtr< NwSkinnedMesh >& skinned_mesh
+	, const NameHash32 anim_name_hash
+	, NwClump & clump
+	, NwJobSchedulerI& task_scheduler
+	, const U32 num_models
+	, const U32 num_start_times
+	)
+{
+	enum { NUM_FRAMES = 100 };
+
+	NwAnimationSystem& anim_system = NwAnimationSystem::Get();
+	const bool was_pose_sharing_enabled = anim_system.IsPoseSharingEnabled();
+
+	DynamicArray< NwAnimatedModel* >	models( MemoryHeaps::animation() );
+
+	ERet result = CreateBenchmarkModels(
+		models
+		, num_models
+		, num_start_times
+		, skinned_mesh
+		, anim_name_hash
+		, clump
+		);
+
+	if( mxSUCCEDED(result) )
+	{
+		anim_system.EnablePoseSharing( false );
+		const U64 without_sharing_usec = AnimateModelsForBenchmark( models, NUM_FRAMES, task_scheduler, true, nil );
+
+		anim_system.EnablePoseSharing( true );
+		const U64 with_sharing_usec = AnimateModelsForBenchmark( models, NUM_FRAMES, task_scheduler, true, nil );
+
+		const NwPoseSharingStats& stats = anim_system.GetPoseSharingStats();
+
+		ptPRINT("Shared poses: %u models, %u start times, per frame: %.3f ms -> %.3f ms,"
+			" sampled poses: %u -> %u, pose buffer: %u bytes, sampling caches: %u",
+			models.num(), num_start_times,
+			without_sharing_usec * 1e-3f,
+			with_sharing_usec * 1e-3f,
+			stats.num_requested_poses, stats.num_shared_poses,
+			stats.pose_buffer_size, stats.num_sampling_caches
+			);
+	}
+
+	anim_system.EnablePoseSharing( was_pose_sharing_enabled );
+
+	DestroyBenchmarkModels( models, clump );
+
+	return result;
+}
+
+}//namespace NwAnimatedModel_
+}//namespace Rendering
+
+#endif // MX_DEVELOPER
@@ -23,6 +23,56 @@ mxALIGN_BY_CACHELINE struct NwAnimationJobResult
 	M44f	barrel_joint_mat_local;
 };
 
+/// Animation level of detail:
+/// the animations of distant models are sampled at a lower rate
+/// and the two most recently sampled poses are interpolated in between.
+struct NwAnimLodSettings
+{
+	V3f		camera_position;
+
+	/// the animations of models farther than these distances are sampled every 2nd / 4th frame
+	float	half_rate_distance;
+	float	quarter_rate_distance;
+
+public:
+	NwAnimLodSettings()
+	{
+		camera_position = CV3f(0);
+		half_rate_distance = 20;
+		quarter_rate_distance = 50;
+	}
+};
+
+/// Used by the animation jobs, see NwAnimLodSettings.
+struct NwAnimLodState
+{
+	/// the previous [0] and the latest [1] sampled poses (local joint transforms),
+	/// nil until the animations are sampled at a lower rate for the first time
+	ozz::math::SoaTransform *	sampled_locals[2];
+
+	/// the root joint positions in the sampled poses, for root motion
+	V3f		sampled_root_joint_pos[2];
+
+	/// the animations are sampled every N-th frame (1 = every frame)
+	U8		update_interval;
+	U8		frames_since_sampling;
+
+	/// false if sampled_locals[] haven't been initialized yet
+	bool	has_sampled_pose;
+
+public:
+	NwAnimLodState()
+	{
+		mxZERO_OUT(*this);
+		update_interval = 1;
+	}
+
+	bool shouldSampleThisFrame() const
+	{
+		return frames_since_sampling == 0 || !has_sampled_pose;
+	}
+};
+
 ///
 struct NwAnimatedModel: CStruct, NonCopyable
 {
@@ -50,6 +100,12 @@ struct NwAnimatedModel: CStruct, NonCopyable
 	//
 	int		barrel_joint_index;
 
+	// written on the main thread, read by jobs
+	NwAnimPlayer::UpdateOutput	anim_update_output;
+
+	// updated by jobs
+	NwAnimLodState			anim_lod;
+
 	// written by jobs!
 	NwAnimationJobResult	job_result;
 
@@ -109,12 +165,61 @@ namespace NwAnimatedModel_
 		, SpatialDatabaseI* spatial_database
 		);
 
-	//
+	/// Advances the animations of all (non-paused) animated models in the clump
+	/// and launches jobs for computing their joint matrices.
+	/// NOTE: wait for the returned job before calling this function again.
 	JobID UpdateInstances(
 		NwClump & clump
 		, const NwTime& args
 		, NwJobSchedulerI& task_scheduler
+		, const NwAnimLodSettings* lod_settings = nil	// nil == update all models every frame
+		);
+
+	/// Advances the animations of the given models and launches batched jobs for computing their joint matrices.
+	/// NOTE: the models must not be destroyed until the returned job is finished.
+	JobID UpdateModels(
+		NwAnimatedModel *const * models
+		, const U32 num_models
+		, const SecondsF delta_seconds
+		, NwJobSchedulerI& task_scheduler
+		, const NwAnimLodSettings* lod_settings = nil
 		);
 }//namespace
 
+/*
+-----------------------------------------------------------------------------
+	UNIT TESTS
+-----------------------------------------------------------------------------
+*/
+
+#if MX_DEVELOPER
+
+namespace NwAnimatedModel_
+{
+	/// Creates 1000 (by default) models with the given looped animation, placed at increasing distances from the camera,
+	/// animates them for 100 frames with one job per model, with batched jobs and with batched jobs and animation LoD,
+	/// and prints the average update times.
+	ERet Benchmark_AnimationUpdate(
+		const TResPtr< NwSkinnedMesh >& skinned_mesh
+		, const NameHash32 anim_name_hash
+		, NwClump & clump
+		, NwJobSchedulerI& task_scheduler
+		, const U32 num_models = 1000
+		);
+
+	/// Creates 500 (by default) models playing the given looped animation from a few different start times
+	/// (like a crowd), animates them with and without pose sharing and prints the update times
+	/// and the number of sampled poses per frame.
+	ERet Benchmark_SharedPoses(
+		const TResPtr< NwSkinnedMesh >& skinned_mesh
+		, const NameHash32 anim_name_hash
+		, NwClump & clump
+		, NwJobSchedulerI& task_scheduler
+		, const U32 num_models = 500
+		, const U32 num_start_times = 8
+		);
+}//namespace
+
+#endif // MX_DEVELOPER
+
 }//namespace Rendering
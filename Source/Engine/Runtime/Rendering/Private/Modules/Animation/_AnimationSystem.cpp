@@ -62,7 +62,18 @@ void _set_Custom_Allocator_for_Ozz_Animation_Library()
 
 
 NwAnimationSystem::NwAnimationSystem()
+	: _shared_pose_indices( MemoryHeaps::animation() )
+	, _shared_poses( MemoryHeaps::animation() )
+	, models_to_animate( MemoryHeaps::animation() )
 {
+	_share_poses = false;
+	_pose_sharing_samples_per_second = 30;
+
+	_shared_pose_buffer = nil;
+	_shared_pose_buffer_capacity = 0;
+	_shared_pose_buffer_size = 0;
+
+	mxZERO_OUT(_pose_sharing_stats);
 }
 
 NwAnimationSystem::~NwAnimationSystem()
@@ -80,12 +91,25 @@ ERet NwAnimationSystem::SetUp()
 
 	_set_Custom_Allocator_for_Ozz_Animation_Library();
 
+	mxDO(_shared_pose_indices.Initialize( 256, 256 ));
+
 	return ALL_OK;
 }
 
 void NwAnimationSystem::ShutDown()
 {
 	mxASSERT(sampling_cache_pool.NumValidItems() == 0);
+	models_to_animate.clear();
+
+	_shared_pose_indices.Clear();
+	_shared_poses.clear();
+
+	if( _shared_pose_buffer ) {
+		MemoryHeaps::animation().Deallocate( _shared_pose_buffer );
+		_shared_pose_buffer = nil;
+	}
+	_shared_pose_buffer_capacity = 0;
+	_shared_pose_buffer_size = 0;
 }
 
 NwAnimSamplingCache* NwAnimationSystem::AllocateSamplingCache(
@@ -94,7 +118,7 @@ NwAnimSamplingCache* NwAnimationSystem::AllocateSamplingCache(
 {
 	NwAnimSamplingCache * new_sampling_cache = sampling_cache_pool.New<NwAnimSamplingCache>();
 	chkRET_NIL_IF_NIL(new_sampling_cache);
-	new_sampling_cache->ozz_sampling_cache.Resize(nwRENDERER_MAX_BONES);
+	new_sampling_cache->ozz_sampling_cache.Resize(num_joints_in_skeleton);
 	return new_sampling_cache;
 }
 
@@ -105,4 +129,150 @@ void NwAnimationSystem::ReleaseSamplingCache(
 	sampling_cache_pool.Delete( sampling_cache );
 }
 
+void NwAnimationSystem::EnablePoseSharing(
+	const bool enable
+	, const U32 samples_per_second /*= 30*/
+	)
+{
+	mxASSERT(samples_per_second > 0);
+	_share_poses = enable;
+	_pose_sharing_samples_per_second = largest( samples_per_second, 1 );
+}
+
+void NwAnimationSystem::BeginPoseSharing()
+{
+	_shared_pose_indices.RemoveAll();
+	_shared_poses.RemoveAll();
+	_shared_pose_buffer_size = 0;
+
+	mxZERO_OUT(_pose_sharing_stats);
+}
+
+U32 NwAnimationSystem::RequestSharedPose(
+	const NwPlayingAnim& playing_anim
+	, const ozz::animation::Skeleton& skeleton
+	)
+{
+	if( !_share_poses ) {
+		return INDEX_NONE;
+	}
+
+	const ozz::animation::Animation& ozz_animation = playing_anim.anim_clip->ozz_animation;
+
+	// Snap the time to the nearest sample so that models playing the clip
+	// at almost the same time can share the pose.
+	const U32 num_samples = largest(
+		U32( ozz_animation.duration() * _pose_sharing_samples_per_second ),
+		1
+		);
+	const U32 quantized_time = U32( playing_anim.curr_time_ratio * num_samples + 0.5f );
+
+	NwSharedAnimPoseKey	key;
+	key.anim_clip = playing_anim.anim_clip;
+	key.skeleton = &skeleton;
+	key.quantized_time = quantized_time;
+
+	_pose_sharing_stats.num_requested_poses++;
+
+	const U32* existing_pose_index = _shared_pose_indices.FindValue( key );
+	if( existing_pose_index ) {
+		return *existing_pose_index;
+	}
+
+	NwSharedAnimPose	new_pose;
+	new_pose.anim_clip = playing_anim.anim_clip;
+	new_pose.sampling_cache = playing_anim.sampling_cache;
+	new_pose.time_ratio = smallest( float(quantized_time) / float(num_samples), 1.0f );
+	new_pose.first_soa_joint = _shared_pose_buffer_size;
+	new_pose.num_soa_joints = skeleton.num_soa_joints();
+	new_pose.state = NwSharedAnimPose::NOT_SAMPLED;
+
+	const U32 new_pose_index = _shared_poses.num();
+	if( mxFAILED(_shared_poses.add( new_pose ))
+		|| mxFAILED(_shared_pose_indices.Insert( key, new_pose_index )) )
+	{
+		return INDEX_NONE;
+	}
+
+	_shared_pose_buffer_size += new_pose.num_soa_joints;
+
+	_pose_sharing_stats.num_shared_poses++;
+
+	return new_pose_index;
+}
+
+ERet NwAnimationSystem::EndPoseSharing()
+{
+	// the pose buffer cannot be reallocated while the animation jobs are running
+	if( _shared_pose_buffer_size > _shared_pose_buffer_capacity )
+	{
+		AllocatorI & allocator = MemoryHeaps::animation();
+
+		if( _shared_pose_buffer ) {
+			allocator.Deallocate( _shared_pose_buffer );
+			_shared_pose_buffer = nil;
+			_shared_pose_buffer_capacity = 0;
+		}
+
+		const U32 new_capacity = NextPowerOfTwo( largest( _shared_pose_buffer_size, 2 ) );
+
+		mxDO(nwAllocArray( _shared_pose_buffer, new_capacity, allocator, 16 ));
+		_shared_pose_buffer_capacity = new_capacity;
+	}
+
+	_pose_sharing_stats.pose_buffer_size = _shared_pose_buffer_capacity * sizeof(_shared_pose_buffer[0]);
+	_pose_sharing_stats.num_sampling_caches = sampling_cache_pool.NumValidItems();
+
+	return ALL_OK;
+}
+
+const ozz::math::SoaTransform* NwAnimationSystem::GetSharedPose(
+	const U32 shared_pose_index
+	)
+{
+	NwSharedAnimPose & shared_pose = _shared_poses[ shared_pose_index ];
+
+	// the pose buffer could not be allocated
+	if( shared_pose.first_soa_joint + shared_pose.num_soa_joints > _shared_pose_buffer_capacity ) {
+		return nil;
+	}
+
+	ozz::math::SoaTransform * pose_locals = _shared_pose_buffer + shared_pose.first_soa_joint;
+
+	if( AtomicCAS( &shared_pose.state, NwSharedAnimPose::NOT_SAMPLED, NwSharedAnimPose::BEING_SAMPLED ) )
+	{
+		// we are the first - sample the pose for everyone else
+		ozz::animation::SamplingJob	ozz_sampling_job;
+		ozz_sampling_job.animation	= &shared_pose.anim_clip->ozz_animation;
+		ozz_sampling_job.cache		= &shared_pose.sampling_cache->ozz_sampling_cache;
+		ozz_sampling_job.ratio		= shared_pose.time_ratio;
+		ozz_sampling_job.output		= ozz::Range< ozz::math::SoaTransform >(
+			pose_locals,
+			pose_locals + shared_pose.num_soa_joints
+			);
+
+		const bool sampled_ok = ozz_sampling_job.Run();
+
+		AtomicExchange(
+			&shared_pose.state,
+			sampled_ok ? NwSharedAnimPose::SAMPLED : NwSharedAnimPose::FAILED
+			);
+
+		return sampled_ok ? pose_locals : nil;
+	}
+
+	// wait until another thread samples the pose
+	for(;;)
+	{
+		const AtomicInt state = AtomicLoad( shared_pose.state );
+		if( state == NwSharedAnimPose::SAMPLED ) {
+			return pose_locals;
+		}
+		if( state == NwSharedAnimPose::FAILED ) {
+			return nil;
+		}
+		YieldHardwareThread();
+	}
+}
+
 }//namespace Rendering
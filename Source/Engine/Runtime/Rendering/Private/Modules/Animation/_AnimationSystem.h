@@ -3,6 +3,7 @@
 
 //
 #include <Base/Template/Containers/Dictionary/TSortedMap.h>
+#include <Base/Template/Containers/HashMap/THashMap.h>
 //
 #include <Core/Assets/AssetReference.h>	// TResPtr<>
 #include <Core/Tasking/TaskSchedulerInterface.h>
@@ -16,10 +17,89 @@
 
 namespace Rendering
 {
+struct NwAnimatedModel;
+
+/// Identifies a pose sampled from an animation clip at a quantized time.
+struct NwSharedAnimPoseKey
+{
+	const NwAnimClip *					anim_clip;
+	const ozz::animation::Skeleton *	skeleton;
+	U32									quantized_time;	//!< index of the sample
+
+public:
+	bool operator == ( const NwSharedAnimPoseKey& other ) const
+	{
+		return anim_clip == other.anim_clip
+			&& skeleton == other.skeleton
+			&& quantized_time == other.quantized_time
+			;
+	}
+};
+
+/// A pose sampled from an animation clip at a quantized time;
+/// shared by all models playing the clip at that time (e.g. a crowd playing the same idle animation).
+/// Valid only during the frame.
+struct NwSharedAnimPose
+{
+	const NwAnimClip *		anim_clip;
+	NwAnimSamplingCache *	sampling_cache;	//!< of the first model which requested the pose
+	float01_t				time_ratio;		//!< quantized
+	U32						first_soa_joint;	//!< in the pose buffer
+	U32						num_soa_joints;
+	AtomicInt				state;			//!< EState
+
+	enum EState
+	{
+		NOT_SAMPLED,
+		BEING_SAMPLED,
+		SAMPLED,
+		FAILED,
+	};
+};
+
+///
+struct NwPoseSharingStats
+{
+	U32		num_requested_poses;	//!< the number of sampling jobs without pose sharing
+	U32		num_shared_poses;		//!< the number of sampling jobs with pose sharing
+	U32		pose_buffer_size;		//!< in bytes
+	U32		num_sampling_caches;
+};
+
 class NwAnimationSystem: public TGlobal< NwAnimationSystem >
 {
 	FreeListAllocator	sampling_cache_pool;
 
+	// pose sharing
+
+	bool	_share_poses;
+	U32		_pose_sharing_samples_per_second;
+
+	struct SharedAnimPoseKeyHash
+	{
+		static inline U32 ComputeHash32( const NwSharedAnimPoseKey& key )
+		{
+			return mxPointerHash( key.anim_clip )
+				^ mxPointerHash( key.skeleton )
+				^ ( key.quantized_time * 2654435761u )
+				;
+		}
+	};
+
+	THashMap< NwSharedAnimPoseKey, U32, SharedAnimPoseKeyHash >	_shared_pose_indices;
+	DynamicArray< NwSharedAnimPose >	_shared_poses;
+
+	/// sampled local joint transforms of all shared poses
+	ozz::math::SoaTransform *	_shared_pose_buffer;
+	U32							_shared_pose_buffer_capacity;	//!< in SoA joints
+	U32							_shared_pose_buffer_size;		//!< in SoA joints
+
+	NwPoseSharingStats			_pose_sharing_stats;
+
+public:
+	/// the models whose joint matrices are being computed by the animation jobs
+	DynamicArray< NwAnimatedModel* >	models_to_animate;
+
 public:
 	NwAnimationSystem();
 	~NwAnimationSystem();
@@ -35,6 +115,37 @@ public:
 	void ReleaseSamplingCache(
 		NwAnimSamplingCache* sampling_cache
 		);
+
+public:	// Pose sharing
+
+	/// When enabled, the animations are sampled at fixed times (e.g. 30 samples per second)
+	/// and models playing the same clip at the same time share the sampled pose.
+	void EnablePoseSharing(
+		const bool enable
+		, const U32 samples_per_second = 30
+		);
+
+	bool IsPoseSharingEnabled() const { return _share_poses; }
+
+	/// Must be called on the main thread before requesting the poses.
+	void BeginPoseSharing();
+
+	/// Called on the main thread, returns the index of the shared pose or INDEX_NONE.
+	U32 RequestSharedPose(
+		const NwPlayingAnim& playing_anim
+		, const ozz::animation::Skeleton& skeleton
+		);
+
+	/// Must be called on the main thread before launching the animation jobs.
+	ERet EndPoseSharing();
+
+	/// Called from the animation jobs:
+	/// the first caller samples the pose, the others wait for it.
+	const ozz::math::SoaTransform* GetSharedPose(
+		const U32 shared_pose_index
+		);
+
+	const NwPoseSharingStats& GetPoseSharingStats() const { return _pose_sharing_stats; }
 };
 
 }//namespace Rendering
@@ -0,0 +1,682 @@
+#include <Base/Base.h>
+#pragma hdrstop
+
+#include <Base/Math/Random.h>
+
+#include <Core/Memory/MemoryHeaps.h>
+#include <Core/Tasking/TaskSchedulerInterface.h>	// threadLocalHeap()
+#include <Core/Util/ScopedTimer.h>
+
+#include <GPU/Public/graphics_device.h>
+
+#include <Rendering/Private/Modules/Particles/ParticleSimulation.h>
+
+
+namespace Rendering
+{
+namespace
+{
+	enum Constants
+	{
+		SSE_ALIGNMENT = 16,
+	};
+}
+
+NwParticleEmitter::NwParticleEmitter()
+{
+	mxZERO_OUT(particles);
+
+	settings.acceleration = CV3f(0);
+	settings.drag = 0;
+	settings.size_growth = 0;
+	settings.color = CV3f(1);
+
+	_memory = nil;
+	_allocator = nil;
+}
+
+NwParticleEmitter::~NwParticleEmitter()
+{
+	this->Shutdown();
+}
+
+ERet NwParticleEmitter::Initialize(
+	const U32 max_particles
+	, AllocatorI & allocator
+	)
+{
+	mxASSERT(nil == _memory);
+
+	const U32 capacity = AlignUp( largest( max_particles, 4 ), 4 );
+	const size_t stream_size = capacity * sizeof(float);
+
+	_memory = allocator.Allocate( stream_size * NwParticleStreams::NUM_STREAMS, SSE_ALIGNMENT );
+	mxENSURE(_memory, ERR_OUT_OF_MEMORY, "");
+
+	// zero the padding so that SIMD code doesn't read garbage
+	memset( _memory, 0, stream_size * NwParticleStreams::NUM_STREAMS );
+
+	_allocator = &allocator;
+
+	float * streams = (float*) _memory;
+
+	particles.position_x		= streams + capacity * 0;
+	particles.position_y		= streams + capacity * 1;
+	particles.position_z		= streams + capacity * 2;
+	particles.velocity_x		= streams + capacity * 3;
+	particles.velocity_y		= streams + capacity * 4;
+	particles.velocity_z		= streams + capacity * 5;
+	particles.life01			= streams + capacity * 6;
+	particles.inv_lifespan_sec	= streams + capacity * 7;
+	particles.size				= streams + capacity * 8;
+
+	particles.num_alive = 0;
+	particles.capacity = capacity;
+
+	return ALL_OK;
+}
+
+void NwParticleEmitter::Shutdown()
+{
+	if( _memory )
+	{
+		_allocator->Deallocate( _memory );
+		_memory = nil;
+		_allocator = nil;
+	}
+	mxZERO_OUT(particles);
+}
+
+bool NwParticleEmitter::Emit(
+	const V3f& position
+	, const V3f& velocity
+	, const SecondsF lifespan
+	, const float size
+	)
+{
+	NwParticleStreams & p = particles;
+
+	if( p.num_alive >= p.capacity ) {
+		return false;
+	}
+
+	const U32 i = p.num_alive++;
+
+	p.position_x[i] = position.x;
+	p.position_y[i] = position.y;
+	p.position_z[i] = position.z;
+
+	p.velocity_x[i] = velocity.x;
+	p.velocity_y[i] = velocity.y;
+	p.velocity_z[i] = velocity.z;
+
+	p.life01[i] = 0;
+	p.inv_lifespan_sec[i] = (lifespan > 0)
+		? (1.0f / lifespan)
+		: 1e6f	// dies in the next update
+		;
+
+	p.size[i] = size;
+
+	return true;
+}
+
+void NwParticleEmitter::Simulate(
+	const SecondsF delta_seconds
+	)
+{
+	NwParticleStreams & p = particles;
+
+	const U32 num_particles = p.num_alive;
+
+	const __m128 dt = _mm_set1_ps( delta_seconds );
+
+	const __m128 delta_velocity_x = _mm_set1_ps( settings.acceleration.x * delta_seconds );
+	const __m128 delta_velocity_y = _mm_set1_ps( settings.acceleration.y * delta_seconds );
+	const __m128 delta_velocity_z = _mm_set1_ps( settings.acceleration.z * delta_seconds );
+
+	const __m128 damping = _mm_set1_ps( maxf( 1.0f - settings.drag * delta_seconds, 0.0f ) );
+	const __m128 delta_size = _mm_set1_ps( settings.size_growth * delta_seconds );
+
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps( 1.0f );
+
+	// the number of particles which survived, they are moved down to close the gaps
+	U32 num_written = 0;
+
+	for( U32 i = 0; i < num_particles; i += 4 )
+	{
+		// integrate
+		const __m128 velocity_x = _mm_mul_ps( _mm_add_ps( _mm_load_ps( p.velocity_x + i ), delta_velocity_x ), damping );
+		const __m128 velocity_y = _mm_mul_ps( _mm_add_ps( _mm_load_ps( p.velocity_y + i ), delta_velocity_y ), damping );
+		const __m128 velocity_z = _mm_mul_ps( _mm_add_ps( _mm_load_ps( p.velocity_z + i ), delta_velocity_z ), damping );
+
+		const __m128 position_x = _mm_add_ps( _mm_load_ps( p.position_x + i ), _mm_mul_ps( velocity_x, dt ) );
+		const __m128 position_y = _mm_add_ps( _mm_load_ps( p.position_y + i ), _mm_mul_ps( velocity_y, dt ) );
+		const __m128 position_z = _mm_add_ps( _mm_load_ps( p.position_z + i ), _mm_mul_ps( velocity_z, dt ) );
+
+		// age
+		const __m128 inv_lifespan = _mm_load_ps( p.inv_lifespan_sec + i );
+		const __m128 life = _mm_add_ps( _mm_load_ps( p.life01 + i ), _mm_mul_ps( inv_lifespan, dt ) );
+
+		const __m128 size = _mm_max_ps( _mm_add_ps( _mm_load_ps( p.size + i ), delta_size ), zero );
+
+		// kill
+		int alive_mask = _mm_movemask_ps( _mm_cmplt_ps( life, one ) );
+
+		// the lanes past the last particle are dead
+		const U32 num_remaining = num_particles - i;
+		if( num_remaining < 4 ) {
+			alive_mask &= (1 << num_remaining) - 1;
+		}
+
+		if( alive_mask == 0xF && num_written == i )
+		{
+			// Fast path - no particles died so far.
+			_mm_store_ps( p.position_x + i, position_x );
+			_mm_store_ps( p.position_y + i, position_y );
+			_mm_store_ps( p.position_z + i, position_z );
+			_mm_store_ps( p.velocity_x + i, velocity_x );
+			_mm_store_ps( p.velocity_y + i, velocity_y );
+			_mm_store_ps( p.velocity_z + i, velocity_z );
+			_mm_store_ps( p.life01 + i, life );
+			_mm_store_ps( p.size + i, size );
+			num_written += 4;
+		}
+		else if( alive_mask )
+		{
+			// Stable compaction: move the surviving particles down, keeping their order.
+			// The destination never overtakes the source, because num_written <= i.
+			float	lanes[ NwParticleStreams::NUM_STREAMS ][4];
+			_mm_storeu_ps( lanes[0], position_x );
+			_mm_storeu_ps( lanes[1], position_y );
+			_mm_storeu_ps( lanes[2], position_z );
+			_mm_storeu_ps( lanes[3], velocity_x );
+			_mm_storeu_ps( lanes[4], velocity_y );
+			_mm_storeu_ps( lanes[5], velocity_z );
+			_mm_storeu_ps( lanes[6], life );
+			_mm_storeu_ps( lanes[7], inv_lifespan );
+			_mm_storeu_ps( lanes[8], size );
+
+			for( U32 lane = 0; lane < 4; lane++ )
+			{
+				if( alive_mask & (1 << lane) )
+				{
+					const U32 dst = num_written++;
+					p.position_x[ dst ] = lanes[0][ lane ];
+					p.position_y[ dst ] = lanes[1][ lane ];
+					p.position_z[ dst ] = lanes[2][ lane ];
+					p.velocity_x[ dst ] = lanes[3][ lane ];
+					p.velocity_y[ dst ] = lanes[4][ lane ];
+					p.velocity_z[ dst ] = lanes[5][ lane ];
+					p.life01[ dst ] = lanes[6][ lane ];
+					p.inv_lifespan_sec[ dst ] = lanes[7][ lane ];
+					p.size[ dst ] = lanes[8][ lane ];
+				}
+			}
+		}
+	}
+
+	p.num_alive = num_written;
+}
+
+void NwParticleEmitter::WriteVertices(
+	ParticleVertex * vertices_
+	) const
+{
+	const NwParticleStreams & p = particles;
+
+	const U32 num_particles = p.num_alive;
+	const U32 num_particles_rounded_down = num_particles & ~3;
+
+	const __m128 color_and_life_row = _mm_setr_ps( settings.color.x, settings.color.y, settings.color.z, 0 );
+	const __m128 color_mask = _mm_castsi128_ps( _mm_setr_epi32( -1, -1, -1, 0 ) );
+
+	U32 i = 0;
+
+	for( ; i < num_particles_rounded_down; i += 4 )
+	{
+		// transpose four particles into four vertices
+		__m128 row0 = _mm_load_ps( p.position_x + i );
+		__m128 row1 = _mm_load_ps( p.position_y + i );
+		__m128 row2 = _mm_load_ps( p.position_z + i );
+		__m128 row3 = _mm_load_ps( p.size + i );
+		_MM_TRANSPOSE4_PS( row0, row1, row2, row3 );
+
+		const __m128 life = _mm_load_ps( p.life01 + i );
+
+		ParticleVertex * dst = vertices_ + i;
+
+		_mm_storeu_ps( &dst[0].position_and_size.x, row0 );
+		_mm_storeu_ps( &dst[1].position_and_size.x, row1 );
+		_mm_storeu_ps( &dst[2].position_and_size.x, row2 );
+		_mm_storeu_ps( &dst[3].position_and_size.x, row3 );
+
+		// (color.x, color.y, color.z, life)
+		_mm_storeu_ps( &dst[0].color_and_life.x, _mm_or_ps( _mm_and_ps( color_mask, color_and_life_row ), _mm_andnot_ps( color_mask, _mm_shuffle_ps( life, life, _MM_SHUFFLE(0,0,0,0) ) ) ) );
+		_mm_storeu_ps( &dst[1].color_and_life.x, _mm_or_ps( _mm_and_ps( color_mask, color_and_life_row ), _mm_andnot_ps( color_mask, _mm_shuffle_ps( life, life, _MM_SHUFFLE(1,1,1,1) ) ) ) );
+		_mm_storeu_ps( &dst[2].color_and_life.x, _mm_or_ps( _mm_and_ps( color_mask, color_and_life_row ), _mm_andnot_ps( color_mask, _mm_shuffle_ps( life, life, _MM_SHUFFLE(2,2,2,2) ) ) ) );
+		_mm_storeu_ps( &dst[3].color_and_life.x, _mm_or_ps( _mm_and_ps( color_mask, color_and_life_row ), _mm_andnot_ps( color_mask, _mm_shuffle_ps( life, life, _MM_SHUFFLE(3,3,3,3) ) ) ) );
+	}
+
+	// the remaining particles
+	for( ; i < num_particles; i++ )
+	{
+		ParticleVertex & dst = vertices_[ i ];
+		dst.position_and_size = V4f::set( p.position_x[i], p.position_y[i], p.position_z[i], p.size[i] );
+		dst.color_and_life = V4f::set( settings.color, p.life01[i] );
+	}
+}
+
+
+namespace ParticleJobs
+{
+
+ERet SimulateEmittersJob::Run( const NwThreadContext& context, int start, int end )
+{
+	for( int i = start; i < end; i++ )
+	{
+		emitters[i]->Simulate( delta_seconds );
+	}
+	return ALL_OK;
+}
+
+ERet WriteVerticesJob::Run( const NwThreadContext& context, int start, int end )
+{
+	for( int i = start; i < end; i++ )
+	{
+		emitters[i]->WriteVertices( vertices + first_vertex_per_emitter[i] );
+	}
+	return ALL_OK;
+}
+
+}//namespace ParticleJobs
+
+
+namespace NwParticleSimulation_
+{
+
+JobID SimulateEmitters(
+	NwParticleEmitter *const * emitters
+	, const U32 num_emitters
+	, const SecondsF delta_seconds
+	, NwJobSchedulerI& task_scheduler
+	)
+{
+	const JobID simulation_jobs_group = task_scheduler.beginGroup();
+
+	if( num_emitters )
+	{
+		JobID	h_simulation_job;
+		nwCREATE_JOB(h_simulation_job
+			, task_scheduler
+			, -1, num_emitters
+			, JobPriority_High
+			, ParticleJobs::SimulateEmittersJob
+			, emitters
+			, delta_seconds
+			);
+		(void) h_simulation_job;
+	}
+
+	task_scheduler.endGroup();
+
+	return simulation_jobs_group;
+}
+
+U32 CountAliveParticles(
+	const NwParticleEmitter *const * emitters
+	, const U32 num_emitters
+	)
+{
+	U32 num_alive_particles = 0;
+	for( U32 i = 0; i < num_emitters; i++ ) {
+		num_alive_particles += emitters[i]->particles.num_alive;
+	}
+	return num_alive_particles;
+}
+
+ERet WriteVertices(
+	ParticleVertex * vertices_
+	, const NwParticleEmitter *const * emitters
+	, const U32 num_emitters
+	, NwJobSchedulerI& task_scheduler
+	)
+{
+	if( !num_emitters ) {
+		return ALL_OK;
+	}
+
+	TScopedPtr< U32 >	first_vertex_per_emitter( threadLocalHeap() );
+	mxDO(nwAllocArray( first_vertex_per_emitter.ptr, num_emitters, first_vertex_per_emitter.allocator ));
+
+	U32 num_vertices = 0;
+	for( U32 i = 0; i < num_emitters; i++ ) {
+		first_vertex_per_emitter.ptr[i] = num_vertices;
+		num_vertices += emitters[i]->particles.num_alive;
+	}
+
+	const JobID write_jobs_group = task_scheduler.beginGroup();
+	{
+		JobID	h_write_job;
+		nwCREATE_JOB(h_write_job
+			, task_scheduler
+			, -1, num_emitters
+			, JobPriority_High
+			, ParticleJobs::WriteVerticesJob
+			, vertices_
+			, emitters
+			, first_vertex_per_emitter.ptr
+			);
+		(void) h_write_job;
+	}
+	task_scheduler.endGroup();
+
+	// the offsets must stay alive until the jobs finish
+	task_scheduler.waitFor( write_jobs_group );
+
+	return ALL_OK;
+}
+
+ERet WriteVerticesToTransientBuffer(
+	NwTransientBuffer &vertex_buffer_
+	, U32 &num_vertices_
+	, const NwParticleEmitter *const * emitters
+	, const U32 num_emitters
+	, NwJobSchedulerI& task_scheduler
+	)
+{
+	num_vertices_ = CountAliveParticles( emitters, num_emitters );
+	if( !num_vertices_ ) {
+		return ALL_OK;
+	}
+
+	mxDO(NGpu::allocateTransientVertexBuffer(
+		vertex_buffer_
+		, num_vertices_, sizeof(ParticleVertex)
+		));
+
+	return WriteVertices(
+		(ParticleVertex*) vertex_buffer_.data
+		, emitters
+		, num_emitters
+		, task_scheduler
+		);
+}
+
+}//namespace NwParticleSimulation_
+
+}//namespace Rendering
+
+/*
+-----------------------------------------------------------------------------
+	UNIT TESTS
+-----------------------------------------------------------------------------
+*/
+
+#if MX_DEVELOPER
+
+namespace Rendering
+{
+namespace NwParticleSimulation_
+{
+
+/// the layout used by RrExplosionsSystem and BurningFireSystem
+struct ParticleAoS
+{
+	V3f			position;
+	V3f			velocity;
+	float01_t	life01;
+	float		inv_lifespan_sec;
+	float		size;
+};
+
+/// the same update as NwParticleEmitter::Simulate(), but on AoS records with swap-with-last removal
+static
+void SimulateParticlesAoS(
+	ParticleAoS * particles
+	, U32 & num_particles_
+	, const NwParticleEmitterSettings& settings
+	, const SecondsF delta_seconds
+	)
+{
+	const V3f delta_velocity = settings.acceleration * delta_seconds;
+	const float damping = maxf( 1.0f - settings.drag * delta_seconds, 0.0f );
+	const float delta_size = settings.size_growth * delta_seconds;
+
+	U32 num_alive = num_particles_;
+	U32 i = 0;
+
+	while( i < num_alive )
+	{
+		ParticleAoS & particle = particles[ i ];
+
+		const float updated_life = particle.life01 + particle.inv_lifespan_sec * delta_seconds;
+
+		if( updated_life < 1 )
+		{
+			particle.velocity = ( particle.velocity + delta_velocity ) * damping;
+			particle.position += particle.velocity * delta_seconds;
+			particle.life01 = updated_life;
+			particle.size = maxf( particle.size + delta_size, 0.0f );
+			++i;
+		}
+		else
+		{
+			TSwap( particle, particles[ --num_alive ] );
+		}
+	}
+
+	num_particles_ = num_alive;
+}
+
+/// restores the initial state of the emitters before each timed variant
+static
+void ResetEmitters(
+	NwParticleEmitter *const * emitters
+	, const U32 num_emitters
+	, const ParticleAoS* initial_particles
+	, const float* initial_lifespans
+	, const U32 particles_per_emitter
+	)
+{
+	for( U32 iEmitter = 0; iEmitter < num_emitters; iEmitter++ )
+	{
+		NwParticleEmitter & emitter = *emitters[ iEmitter ];
+		emitter.particles.num_alive = 0;
+
+		const U32 first_particle = iEmitter * particles_per_emitter;
+		for( U32 i = first_particle; i < first_particle + particles_per_emitter; i++ )
+		{
+			const ParticleAoS & particle = initial_particles[ i ];
+			emitter.Emit( particle.position, particle.velocity, initial_lifespans[ i ], particle.size );
+		}
+	}
+}
+
+ERet Benchmark_ParticleSimulation(
+	NwJobSchedulerI& task_scheduler
+	, const U32 num_particles
+	, const U32 num_emitters
+	)
+{
+	enum { NUM_FRAMES = 100 };
+
+	mxASSERT(num_emitters > 0);
+
+	const SecondsF delta_seconds = 1.0f / 60.0f;
+	const U32 particles_per_emitter = num_particles / num_emitters;
+	const U32 total_particles = particles_per_emitter * num_emitters;
+
+	AllocatorI & allocator = MemoryHeaps::process();
+
+	NwParticleEmitterSettings	settings;
+	settings.acceleration = CV3f( 0, 0, -9.8f );
+	settings.drag = 0.1f;
+	settings.size_growth = 0.05f;
+	settings.color = CV3f(1);
+
+	//
+	TScopedPtr< NwParticleEmitter* >	emitters( allocator );
+	mxDO(nwAllocArray( emitters.ptr, num_emitters, allocator ));
+	memset( emitters.ptr, 0, sizeof(emitters.ptr[0]) * num_emitters );
+
+	// each variant starts from the same particles
+	TScopedPtr< ParticleAoS >	initial_particles( allocator );
+	mxDO(nwAllocArray( initial_particles.ptr, total_particles, allocator ));
+
+	TScopedPtr< float >	initial_lifespans( allocator );
+	mxDO(nwAllocArray( initial_lifespans.ptr, total_particles, allocator ));
+
+	TScopedPtr< ParticleAoS >	particles_aos( allocator );
+	mxDO(nwAllocArray( particles_aos.ptr, total_particles, allocator ));
+
+	TScopedPtr< U32 >	num_particles_aos( allocator );
+	mxDO(nwAllocArray( num_particles_aos.ptr, num_emitters, allocator ));
+
+	ERet result = ALL_OK;
+
+	NwRandom	rng( 12345 );
+
+	// some particles die during the benchmark
+	for( U32 i = 0; i < total_particles; i++ )
+	{
+		const float lifespan = rng.GetRandomFloatInRange( 0.5f, 10.0f );
+
+		ParticleAoS & particle = initial_particles.ptr[ i ];
+		particle.position = CV3f( rng.GetRandomFloatInRange( -10, 10 ), rng.GetRandomFloatInRange( -10, 10 ), 0 );
+		particle.velocity = CV3f( rng.GetRandomFloatInRange( -1, 1 ), rng.GetRandomFloatInRange( -1, 1 ), rng.GetRandomFloatInRange( 0, 5 ) );
+		particle.life01 = 0;
+		particle.inv_lifespan_sec = 1.0f / lifespan;	// the same as in NwParticleEmitter::Emit()
+		particle.size = 0.1f;
+
+		initial_lifespans.ptr[ i ] = lifespan;
+	}
+
+	for( U32 iEmitter = 0; iEmitter < num_emitters; iEmitter++ )
+	{
+		emitters.ptr[ iEmitter ] = mxNEW( allocator, NwParticleEmitter );
+		if( !emitters.ptr[ iEmitter ] ) {
+			result = ERR_OUT_OF_MEMORY;
+			break;
+		}
+
+		NwParticleEmitter & emitter = *emitters.ptr[ iEmitter ];
+		result = emitter.Initialize( particles_per_emitter, allocator );
+		if( mxFAILED(result) ) {
+			break;
+		}
+		emitter.settings = settings;
+	}
+
+	U32 num_alive_particles_aos = 0;
+	U32 num_alive_particles_soa_serial = 0;
+	U32 num_alive_particles = 0;
+
+	if( mxSUCCEDED(result) )
+	{
+		// AoS, serial
+		memcpy( particles_aos.ptr, initial_particles.ptr, sizeof(particles_aos.ptr[0]) * total_particles );
+		for( U32 iEmitter = 0; iEmitter < num_emitters; iEmitter++ ) {
+			num_particles_aos.ptr[ iEmitter ] = particles_per_emitter;
+		}
+
+		U64 aos_serial_usec;
+		{
+			ScopedTimer	timer;
+			for( U32 iFrame = 0; iFrame < NUM_FRAMES; iFrame++ ) {
+				for( U32 iEmitter = 0; iEmitter < num_emitters; iEmitter++ ) {
+					SimulateParticlesAoS(
+						particles_aos.ptr + iEmitter * particles_per_emitter
+						, num_particles_aos.ptr[ iEmitter ]
+						, settings
+						, delta_seconds
+						);
+				}
+			}
+			aos_serial_usec = timer.ElapsedMicroseconds() / NUM_FRAMES;
+		}
+
+		for( U32 iEmitter = 0; iEmitter < num_emitters; iEmitter++ ) {
+			num_alive_particles_aos += num_particles_aos.ptr[ iEmitter ];
+		}
+
+		// SoA, serial
+		ResetEmitters( emitters.ptr, num_emitters, initial_particles.ptr, initial_lifespans.ptr, particles_per_emitter );
+
+		U64 soa_serial_usec;
+		{
+			ScopedTimer	timer;
+			for( U32 iFrame = 0; iFrame < NUM_FRAMES; iFrame++ ) {
+				for( U32 iEmitter = 0; iEmitter < num_emitters; iEmitter++ ) {
+					emitters.ptr[ iEmitter ]->Simulate( delta_seconds );
+				}
+			}
+			soa_serial_usec = timer.ElapsedMicroseconds() / NUM_FRAMES;
+		}
+
+		num_alive_particles_soa_serial = CountAliveParticles( emitters.ptr, num_emitters );
+
+		// SoA, in parallel
+		ResetEmitters( emitters.ptr, num_emitters, initial_particles.ptr, initial_lifespans.ptr, particles_per_emitter );
+
+		U64 soa_parallel_usec;
+		{
+			ScopedTimer	timer;
+			for( U32 iFrame = 0; iFrame < NUM_FRAMES; iFrame++ ) {
+				const JobID simulation_jobs_group = SimulateEmitters(
+					emitters.ptr
+					, num_emitters
+					, delta_seconds
+					, task_scheduler
+					);
+				task_scheduler.waitFor( simulation_jobs_group );
+			}
+			soa_parallel_usec = timer.ElapsedMicroseconds() / NUM_FRAMES;
+		}
+
+		num_alive_particles = CountAliveParticles( emitters.ptr, num_emitters );
+
+		// vertex writing, in parallel
+		U64 write_vertices_usec = 0;
+		{
+			TScopedPtr< ParticleVertex >	vertices( allocator );
+			result = nwAllocArray( vertices.ptr, largest( num_alive_particles, 1 ), allocator );
+			if( mxSUCCEDED(result) )
+			{
+				ScopedTimer	timer;
+				result = WriteVertices( vertices.ptr, emitters.ptr, num_emitters, task_scheduler );
+				write_vertices_usec = timer.ElapsedMicroseconds();
+			}
+		}
+
+		ptPRINT("Particle simulation: %u particles in %u emitters, per frame: %.3f ms (AoS) -> %.3f ms (SoA) -> %.3f ms (SoA, jobs);"
+			" writing %u vertices (alive after %u frames): %.3f ms",
+			total_particles, num_emitters,
+			aos_serial_usec * 1e-3f,
+			soa_serial_usec * 1e-3f,
+			soa_parallel_usec * 1e-3f,
+			num_alive_particles, NUM_FRAMES, write_vertices_usec * 1e-3f
+			);
+	}
+
+	for( U32 iEmitter = 0; iEmitter < num_emitters; iEmitter++ ) {
+		mxDELETE( emitters.ptr[ iEmitter ], allocator );
+	}
+
+	mxDO(result);
+
+	// all variants must kill the same particles
+	mxENSURE( num_alive_particles_aos == num_alive_particles_soa_serial && num_alive_particles_aos == num_alive_particles
+		, ERR_UNKNOWN_ERROR
+		, "alive particles: %u (AoS), %u (SoA), %u (SoA, jobs)"
+		, num_alive_particles_aos, num_alive_particles_soa_serial, num_alive_particles
+		);
+
+	return ALL_OK;
+}
+
+}//namespace NwParticleSimulation_
+}//namespace Rendering
+
+#endif // MX_DEVELOPER
@@ -0,0 +1,191 @@
+// Data-oriented CPU particle simulation.
+// Particle attributes are stored in separate streams (SoA) and updated four particles at a time.
+#pragma once
+
+#include <Core/Tasking/TaskSchedulerInterface.h>
+#include <Rendering/Public/Globals.h>
+#include <Rendering/Public/Core/VertexFormats.h>
+
+
+namespace Rendering
+{
+/// Particle attributes stored as separate streams for SIMD processing.
+/// All streams have the same capacity, which is a multiple of 4.
+struct NwParticleStreams
+{
+	float *	position_x;
+	float *	position_y;
+	float *	position_z;
+
+	float *	velocity_x;
+	float *	velocity_y;
+	float *	velocity_z;
+
+	float *	life01;	//!< 0..1, dead if >= 1
+	float *	inv_lifespan_sec;
+
+	float *	size;	//!< radius in world space
+
+	U32		num_alive;
+	U32		capacity;
+
+	enum { NUM_STREAMS = 9 };
+};
+
+///
+struct NwParticleEmitterSettings
+{
+	V3f		acceleration;	//!< e.g. gravity, in meters per second squared
+	float	drag;			//!< velocity damping, per second
+	float	size_growth;	//!< in meters per second, can be negative
+	V3f		color;			//!< passed to the shader
+};
+
+/// Simulates a set of particles with the same settings.
+/// The particles are kept in the order they were emitted.
+struct NwParticleEmitter: NonCopyable
+{
+	NwParticleStreams			particles;
+	NwParticleEmitterSettings	settings;
+
+	void *			_memory;	//!< all streams are allocated in one block
+	AllocatorI *	_allocator;
+
+public:
+	NwParticleEmitter();
+	~NwParticleEmitter();
+
+	ERet Initialize(
+		const U32 max_particles
+		, AllocatorI & allocator
+		);
+
+	void Shutdown();
+
+	/// returns false if the emitter is full
+	bool Emit(
+		const V3f& position
+		, const V3f& velocity
+		, const SecondsF lifespan
+		, const float size
+		);
+
+	/// Integrates positions and velocities, ages the particles
+	/// and removes the dead ones, preserving the order of the remaining particles.
+	void Simulate(
+		const SecondsF delta_seconds
+		);
+
+	/// Writes num_alive vertices, the destination doesn't have to be aligned.
+	void WriteVertices(
+		ParticleVertex * vertices_
+		) const;
+};
+
+
+namespace NwParticleSimulation_
+{
+	/// Simulates the emitters in parallel, returns the job group to wait on.
+	JobID SimulateEmitters(
+		NwParticleEmitter *const * emitters
+		, const U32 num_emitters
+		, const SecondsF delta_seconds
+		, NwJobSchedulerI& task_scheduler
+		);
+
+	U32 CountAliveParticles(
+		const NwParticleEmitter *const * emitters
+		, const U32 num_emitters
+		);
+
+	/// Allocates a transient vertex buffer and writes the particles of all emitters into it in parallel.
+	ERet WriteVerticesToTransientBuffer(
+		NwTransientBuffer &vertex_buffer_
+		, U32 &num_vertices_
+		, const NwParticleEmitter *const * emitters
+		, const U32 num_emitters
+		, NwJobSchedulerI& task_scheduler
+		);
+
+	/// Writes the particles of all emitters into the given memory in parallel.
+	ERet WriteVertices(
+		ParticleVertex * vertices_
+		, const NwParticleEmitter *const * emitters
+		, const U32 num_emitters
+		, NwJobSchedulerI& task_scheduler
+		);
+
+}//namespace NwParticleSimulation_
+
+
+namespace ParticleJobs
+{
+	struct SimulateEmittersJob
+	{
+		NwParticleEmitter *const *	emitters;
+		SecondsF					delta_seconds;
+
+	public:
+		SimulateEmittersJob(
+			NwParticleEmitter *const * emitters
+			, const SecondsF delta_seconds
+			)
+			: emitters(emitters)
+			, delta_seconds(delta_seconds)
+		{}
+
+		ERet Run( const NwThreadContext& context, int start, int end );
+	};
+	mxSTATIC_ASSERT(sizeof(SimulateEmittersJob) <= sizeof(NwJobData));
+
+	struct WriteVerticesJob
+	{
+		ParticleVertex *					vertices;
+		const NwParticleEmitter *const *	emitters;
+		const U32 *							first_vertex_per_emitter;
+
+	public:
+		WriteVerticesJob(
+			ParticleVertex * vertices
+			, const NwParticleEmitter *const * emitters
+			, const U32 * first_vertex_per_emitter
+			)
+			: vertices(vertices)
+			, emitters(emitters)
+			, first_vertex_per_emitter(first_vertex_per_emitter)
+		{}
+
+		ERet Run( const NwThreadContext& context, int start, int end );
+	};
+	mxSTATIC_ASSERT(sizeof(WriteVerticesJob) <= sizeof(NwJobData));
+
+}//namespace ParticleJobs
+
+}//namespace Rendering
+
+
+/*
+-----------------------------------------------------------------------------
+	UNIT TESTS
+-----------------------------------------------------------------------------
+*/
+
+#if MX_DEVELOPER
+
+namespace Rendering
+{
+namespace NwParticleSimulation_
+{
+	/// Simulates 1M (by default) particles in 64 emitters for 100 frames:
+	/// AoS records updated serially (as in RrExplosionsSystem), SoA streams updated serially and in parallel,
+	/// each variant starting from the same particles; prints the average update times
+	/// and checks that all variants end with the same number of alive particles.
+	ERet Benchmark_ParticleSimulation(
+		NwJobSchedulerI& task_scheduler
+		, const U32 num_particles = 1000000
+		, const U32 num_emitters = 64
+		);
+}//namespace
+}//namespace Rendering
+
+#endif // MX_DEVELOPER
@@ -0,0 +1,972 @@
+#include <Base/Base.h>
+#pragma hdrstop
+
+#include <Base/Math/Random.h>
+#include <Base/Template/Algorithm/RadixSort.h>
+
+#include <Core/Memory/MemoryHeaps.h>
+#include <Core/Tasking/TaskSchedulerInterface.h>	// threadLocalHeap()
+#include <Core/Util/ScopedTimer.h>
+
+#include <GPU/Public/graphics_device.h>
+
+#include <Rendering/Private/Modules/VoxelGI/vxgi_brick_pool.h>
+
+
+namespace Rendering
+{
+namespace VXGI
+{
+
+BrickFreeList::BrickFreeList()
+{
+	_head = EMPTY;
+	_next = nil;
+}
+
+void BrickFreeList::Reset( AtomicInt * next_storage, const U32 num_slots )
+{
+	mxASSERT( num_slots < EMPTY );
+
+	_next = next_storage;
+
+	for( U32 i = 0; i < num_slots; i++ ) {
+		_next[ i ] = ( i + 1 < num_slots ) ? ( i + 1 ) : EMPTY;
+	}
+
+	_head = num_slots ? 0 : EMPTY;
+}
+
+U32 BrickFreeList::Pop()
+{
+	for(;;)
+	{
+		const U32 old_head = (U32) AtomicLoad( _head );
+		const U32 top_slot = old_head & 0xFFFF;
+		if( top_slot == EMPTY ) {
+			return EMPTY;
+		}
+
+		// may be stale if another thread popped the slot in the meantime - then the tag won't match
+		const U32 next_slot = (U32) AtomicLoad( _next[ top_slot ] );
+		const U32 new_tag = ( ( old_head >> 16 ) + 1 ) & 0xFFFF;
+		const U32 new_head = ( new_tag << 16 ) | next_slot;
+
+		if( AtomicCAS( &_head, old_head, new_head ) ) {
+			return top_slot;
+		}
+		YieldHardwareThread();
+	}
+}
+
+void BrickFreeList::Push( const U32 slot_index )
+{
+	mxASSERT( slot_index < EMPTY );
+
+	for(;;)
+	{
+		const U32 old_head = (U32) AtomicLoad( _head );
+
+		// the slot is owned by this thread until the CAS succeeds,
+		// but Pop() can still be reading the stale link
+		AtomicExchange( &_next[ slot_index ], old_head & 0xFFFF );
+
+		const U32 new_tag = ( ( old_head >> 16 ) + 1 ) & 0xFFFF;
+		const U32 new_head = ( new_tag << 16 ) | slot_index;
+
+		if( AtomicCAS( &_head, old_head, new_head ) ) {
+			return;
+		}
+		YieldHardwareThread();
+	}
+}
+
+
+namespace
+{
+	struct VoxelizedBrick
+	{
+		SDFValue *				sdf_values;
+		const NGpu::Memory *	gpu_memory;	//!< nil if the voxels are written into the CPU copy
+		U64		key;
+		U32		slot_index;
+	};
+
+	struct VoxelizeBricksJob
+	{
+		VoxelizedBrick *				bricks;
+		BrickPool::VoxelizeBrickFun *	voxelize_brick;
+		void *							user_data;
+		U32								brick_dim;
+
+	public:
+		VoxelizeBricksJob(
+			VoxelizedBrick * bricks
+			, BrickPool::VoxelizeBrickFun * voxelize_brick
+			, void * user_data
+			, const U32 brick_dim
+			)
+			: bricks(bricks)
+			, voxelize_brick(voxelize_brick)
+			, user_data(user_data)
+			, brick_dim(brick_dim)
+		{}
+
+		ERet Run( const NwThreadContext& context, int start, int end )
+		{
+			for( int i = start; i < end; i++ )
+			{
+				const VoxelizedBrick& brick = bricks[i];
+				(*voxelize_brick)( brick.sdf_values, brick_dim, brick.key, user_data );
+			}
+			return ALL_OK;
+		}
+	};
+
+	struct IdentitySortKey
+	{
+		mxFORCEINLINE uint64_t operator() ( const U64& key ) const { return key; }
+	};
+}//namespace
+
+
+BrickPool::BrickPool( AllocatorI & allocator )
+	: _allocator( allocator )
+{
+	_slot_states = nil;
+	_slot_free_list_next = nil;
+	_slot_last_used_frames = nil;
+	_slot_dirty_flags = nil;
+	_slot_keys = nil;
+
+	_dirty_slots = nil;
+	_num_dirty_slots = 0;
+
+	_num_resident_bricks = 0;
+	_num_failed_allocations = 0;
+
+	_current_frame = 0;
+	_bricks_per_atlas_side = 0;
+
+	_cpu_voxels = nil;
+	_h_atlas_tex3d.SetNil();
+
+	_memory = nil;
+
+	mxZERO_OUT(_stats);
+}
+
+BrickPool::~BrickPool()
+{
+	this->Shutdown();
+}
+
+ERet BrickPool::Initialize( const Config& cfg )
+{
+	mxASSERT(nil == _memory);
+
+	mxENSURE( cfg.max_resident_bricks > 0 && cfg.max_resident_bricks < BrickFreeList::EMPTY
+		, ERR_INVALID_PARAMETER, "the brick budget must be in [1..65534]" );
+	mxENSURE( cfg.brick_dim > 0, ERR_INVALID_PARAMETER, "" );
+	mxENSURE( cfg.max_bricks_to_voxelize_per_batch > 0, ERR_INVALID_PARAMETER, "" );
+	mxENSURE( cfg.create_atlas_texture || cfg.keep_cpu_copy
+		, ERR_INVALID_PARAMETER, "there's nowhere to store the voxels" );
+
+	_cfg = cfg;
+
+	const U32 max_slots = cfg.max_resident_bricks;
+
+	// the atlas is a cube of bricks
+	U32 bricks_per_atlas_side = 1;
+	while( ToCube( bricks_per_atlas_side ) < max_slots ) {
+		bricks_per_atlas_side++;
+	}
+	_bricks_per_atlas_side = bricks_per_atlas_side;
+
+	const U32 atlas_resolution = this->GetAtlasResolution();
+	mxENSURE( atlas_resolution <= 2048
+		, ERR_INVALID_PARAMETER, "the brick atlas is too big: %u^3", atlas_resolution );
+
+	// per-slot data
+	{
+		const size_t keys_size = sizeof(_slot_keys[0]) * max_slots;
+		const size_t atomics_size = sizeof(AtomicInt) * max_slots;
+		const size_t dirty_slots_size = sizeof(_dirty_slots[0]) * max_slots;
+
+		const size_t total_size = keys_size + atomics_size * 4 + dirty_slots_size;
+
+		_memory = _allocator.Allocate( total_size, EFFICIENT_ALIGNMENT );
+		mxENSURE( _memory, ERR_OUT_OF_MEMORY, "" );
+
+		char * ptr = (char*) _memory;
+
+		_slot_keys = (U64*) ptr;				ptr += keys_size;
+		_slot_states = (AtomicInt*) ptr;		ptr += atomics_size;
+		_slot_free_list_next = (AtomicInt*) ptr;	ptr += atomics_size;
+		_slot_last_used_frames = (AtomicInt*) ptr;	ptr += atomics_size;
+		_slot_dirty_flags = (AtomicInt*) ptr;	ptr += atomics_size;
+		_dirty_slots = (U32*) ptr;
+
+		memset( _memory, 0, total_size );
+	}
+
+	_free_list.Reset( _slot_free_list_next, max_slots );
+
+	_num_dirty_slots = 0;
+	_num_resident_bricks = 0;
+	_num_failed_allocations = 0;
+	_current_frame = 1;
+
+	mxZERO_OUT(_stats);
+
+	if( cfg.keep_cpu_copy )
+	{
+		mxDO(nwAllocArray(
+			_cpu_voxels
+			, max_slots * this->NumVoxelsInBrick()
+			, _allocator
+			));
+	}
+
+	if( cfg.create_atlas_texture )
+	{
+		NwTexture3DDescription	brick_atlas_texture_description;
+		{
+#if VXGI_DISTANCE_FIELD_FORMAT_USED == VXGI_DISTANCE_FIELD_FORMAT_FLOAT
+			brick_atlas_texture_description.format		= NwDataFormat::R32F;
+#elif VXGI_DISTANCE_FIELD_FORMAT_USED == VXGI_DISTANCE_FIELD_FORMAT_UNORM16
+			brick_atlas_texture_description.format		= NwDataFormat::R16_UNORM;
+#elif VXGI_DISTANCE_FIELD_FORMAT_USED == VXGI_DISTANCE_FIELD_FORMAT_UNORM8
+			brick_atlas_texture_description.format		= NwDataFormat::R8_UNORM;
+#else
+#	error Unknown SDF format!
+#endif
+			brick_atlas_texture_description.width		= atlas_resolution;
+			brick_atlas_texture_description.height		= atlas_resolution;
+			brick_atlas_texture_description.depth		= atlas_resolution;
+			brick_atlas_texture_description.numMips		= 1;
+			// Leave default flags, because the texture will be updated via UpdateSubresource().
+		}
+
+		DBGOUT("Creating brick pool atlas: res=%u^3, %u bricks of %u^3, size=%u",
+			atlas_resolution, max_slots, cfg.brick_dim, brick_atlas_texture_description.CalcRawSize()
+			);
+
+		_h_atlas_tex3d = NGpu::createTexture3D(
+			brick_atlas_texture_description
+			, nil
+			IF_DEVELOPER, "BrickPoolAtlas"
+			);
+	}
+
+	return ALL_OK;
+}
+
+void BrickPool::Shutdown()
+{
+	if( _h_atlas_tex3d.IsValid() )
+	{
+		NGpu::DeleteTexture( _h_atlas_tex3d );
+		_h_atlas_tex3d.SetNil();
+	}
+
+	if( _cpu_voxels )
+	{
+		_allocator.Deallocate( _cpu_voxels );
+		_cpu_voxels = nil;
+	}
+
+	if( _memory )
+	{
+		_allocator.Deallocate( _memory );
+		_memory = nil;
+	}
+
+	_slot_states = nil;
+	_slot_free_list_next = nil;
+	_slot_last_used_frames = nil;
+	_slot_dirty_flags = nil;
+	_slot_keys = nil;
+	_dirty_slots = nil;
+}
+
+ERet BrickPool::AllocBrick(
+	PooledBrickHandle &new_brick_handle_
+	, const U64 brick_key
+	)
+{
+	const U32 slot_index = _free_list.Pop();
+	if( slot_index == BrickFreeList::EMPTY )
+	{
+		AtomicIncrement( &_num_failed_allocations );
+		return ERR_OUT_OF_MEMORY;
+	}
+
+	// the slot is owned by this thread until it's marked as resident
+	const AtomicInt free_state = AtomicLoad( _slot_states[ slot_index ] );
+	mxASSERT( !( free_state & SLOT_RESIDENT_BIT ) );
+
+	const U32 generation = (U32)free_state >> SLOT_GENERATION_SHIFT;
+
+	_slot_keys[ slot_index ] = brick_key;
+	_slot_last_used_frames[ slot_index ] = _current_frame;
+
+	AtomicExchange( &_slot_states[ slot_index ], free_state | SLOT_RESIDENT_BIT );
+	AtomicIncrement( &_num_resident_bricks );
+
+	new_brick_handle_.id = ( generation << 16 ) | slot_index;
+
+	this->MarkBrickDirty( new_brick_handle_ );
+
+	return ALL_OK;
+}
+
+bool BrickPool::FreeBrick(
+	const PooledBrickHandle brick_handle
+	)
+{
+	const U32 slot_index = brick_handle.id & 0xFFFF;
+	const U32 generation = brick_handle.id >> 16;
+
+	if( slot_index >= _cfg.max_resident_bricks ) {
+		return false;
+	}
+
+	return _TryReleaseSlot( slot_index, generation );
+}
+
+bool BrickPool::_TryReleaseSlot( const U32 slot_index, const U32 generation )
+{
+	const AtomicInt resident_state = ( generation << SLOT_GENERATION_SHIFT ) | SLOT_RESIDENT_BIT;
+	const AtomicInt released_state = ( ( generation + 1 ) & 0xFFFF ) << SLOT_GENERATION_SHIFT;
+
+	// only one thread can free or evict the brick
+	if( !AtomicCAS( &_slot_states[ slot_index ], resident_state, released_state ) ) {
+		return false;
+	}
+
+	AtomicDecrement( &_num_resident_bricks );
+
+	// the slot can still be in the dirty list, it will be skipped
+	_free_list.Push( slot_index );
+
+	return true;
+}
+
+U32 BrickPool::_GetResidentSlotIndex( const PooledBrickHandle brick_handle ) const
+{
+	const U32 slot_index = brick_handle.id & 0xFFFF;
+	const U32 generation = brick_handle.id >> 16;
+
+	if( slot_index >= _cfg.max_resident_bricks ) {
+		return INDEX_NONE;
+	}
+
+	const AtomicInt resident_state = ( generation << SLOT_GENERATION_SHIFT ) | SLOT_RESIDENT_BIT;
+
+	return ( AtomicLoad( _slot_states[ slot_index ] ) == resident_state ) ? slot_index : INDEX_NONE;
+}
+
+bool BrickPool::IsBrickResident(
+	const PooledBrickHandle brick_handle
+	) const
+{
+	return _GetResidentSlotIndex( brick_handle ) != INDEX_NONE;
+}
+
+void BrickPool::TouchBrick(
+	const PooledBrickHandle brick_handle
+	)
+{
+	const U32 slot_index = _GetResidentSlotIndex( brick_handle );
+	if( slot_index != INDEX_NONE ) {
+		// all writers store the same value, no need for interlocked operations
+		_slot_last_used_frames[ slot_index ] = _current_frame;
+	}
+}
+
+bool BrickPool::MarkBrickDirty(
+	const PooledBrickHandle brick_handle
+	)
+{
+	const U32 slot_index = _GetResidentSlotIndex( brick_handle );
+	if( slot_index == INDEX_NONE ) {
+		return false;
+	}
+
+	_QueueDirtySlot( slot_index );
+
+	return true;
+}
+
+void BrickPool::_QueueDirtySlot( const U32 slot_index )
+{
+	// queue the slot only once; the dirty list refers to slots, not bricks,
+	// so it can never hold more items than there are slots
+	if( AtomicCAS( &_slot_dirty_flags[ slot_index ], 0, 1 ) )
+	{
+		const U32 dirty_list_index = AtomicIncrement( &_num_dirty_slots ) - 1;
+		mxASSERT( dirty_list_index < _cfg.max_resident_bricks );
+		_dirty_slots[ dirty_list_index ] = slot_index;
+	}
+}
+
+U64 BrickPool::GetBrickKey(
+	const PooledBrickHandle brick_handle
+	) const
+{
+	const U32 slot_index = brick_handle.id & 0xFFFF;
+	mxASSERT( slot_index < _cfg.max_resident_bricks );
+	return _slot_keys[ slot_index ];
+}
+
+UShort3 BrickPool::GetBrickOffsetInAtlas(
+	const PooledBrickHandle brick_handle
+	) const
+{
+	const U32 slot_index = brick_handle.id & 0xFFFF;
+	mxASSERT( slot_index < _cfg.max_resident_bricks );
+
+	const U32 n = _bricks_per_atlas_side;
+	const U32 brick_dim = _cfg.brick_dim;
+
+	return UShort3::set(
+		( slot_index % n ) * brick_dim,
+		( ( slot_index / n ) % n ) * brick_dim,
+		( slot_index / ( n * n ) ) * brick_dim
+		);
+}
+
+const SDFValue* BrickPool::GetBrickVoxels(
+	const PooledBrickHandle brick_handle
+	) const
+{
+	const U32 slot_index = brick_handle.id & 0xFFFF;
+	mxASSERT( slot_index < _cfg.max_resident_bricks );
+	return _cpu_voxels ? _cpu_voxels + slot_index * this->NumVoxelsInBrick() : nil;
+}
+
+void BrickPool::BeginFrame()
+{
+	++_current_frame;
+
+	_stats.num_resident_bricks = AtomicLoad( _num_resident_bricks );
+	_stats.num_dirty_bricks = AtomicLoad( _num_dirty_slots );
+	_stats.num_failed_allocations = AtomicLoad( _num_failed_allocations );
+}
+
+U32 BrickPool::EvictLeastRecentlyUsed(
+	const U32 min_free_bricks
+	)
+{
+	const U32 max_slots = _cfg.max_resident_bricks;
+	const U32 num_resident_bricks = AtomicLoad( _num_resident_bricks );
+	const U32 num_free_bricks = max_slots - num_resident_bricks;
+
+	const U32 target_num_free_bricks = smallest( min_free_bricks, max_slots );
+	if( num_free_bricks >= target_num_free_bricks ) {
+		return 0;
+	}
+
+	// sort the bricks which were not used in this frame by the time of last use
+
+	TScopedPtr< U64 >	sort_keys( threadLocalHeap() );
+	if(mxFAILED(nwAllocArray( sort_keys.ptr, num_resident_bricks * 2, sort_keys.allocator ))) {
+		return 0;
+	}
+
+	U32 num_candidates = 0;
+
+	for( U32 slot_index = 0; slot_index < max_slots; slot_index++ )
+	{
+		const U32 last_used_frame = _slot_last_used_frames[ slot_index ];
+		if( ( _slot_states[ slot_index ] & SLOT_RESIDENT_BIT ) && last_used_frame != _current_frame )
+		{
+			sort_keys.ptr[ num_candidates++ ] = ( U64(last_used_frame) << 32 ) | slot_index;
+		}
+	}
+
+	if( !num_candidates ) {
+		return 0;
+	}
+
+	const U64* sorted_keys = RadixSort64_AscendingOrder(
+		sort_keys.ptr
+		, sort_keys.ptr + num_resident_bricks
+		, num_candidates
+		, IdentitySortKey()
+		);
+
+	const U32 num_bricks_to_evict = smallest( target_num_free_bricks - num_free_bricks, num_candidates );
+
+	U32 num_evicted_bricks = 0;
+
+	for( U32 i = 0; i < num_bricks_to_evict; i++ )
+	{
+		const U32 slot_index = U32( sorted_keys[i] );
+		const U32 generation = U32( _slot_states[ slot_index ] ) >> SLOT_GENERATION_SHIFT;
+		num_evicted_bricks += _TryReleaseSlot( slot_index, generation );
+	}
+
+	_stats.num_evicted_bricks += num_evicted_bricks;
+
+	return num_evicted_bricks;
+}
+
+ERet BrickPool::VoxelizeDirtyBricks(
+	VoxelizeBrickFun * voxelize_brick
+	, void * user_data
+	, NwJobSchedulerI& task_scheduler
+	)
+{
+	mxENSURE( voxelize_brick, ERR_NULL_POINTER_PASSED, "" );
+
+	const U32 num_dirty_slots = AtomicLoad( _num_dirty_slots );
+	if( !num_dirty_slots ) {
+		return ALL_OK;
+	}
+
+	const U32 max_bricks_in_batch = smallest( num_dirty_slots, (U32) _cfg.max_bricks_to_voxelize_per_batch );
+
+	TScopedPtr< VoxelizedBrick >	bricks( threadLocalHeap() );
+	mxDO(nwAllocArray( bricks.ptr, max_bricks_in_batch, bricks.allocator ));
+
+	const U32 num_voxels_in_brick = this->NumVoxelsInBrick();
+	const U32 brick_size_in_bytes = num_voxels_in_brick * sizeof(SDFValue);
+
+	const bool upload_to_atlas = _h_atlas_tex3d.IsValid();
+
+	// without the CPU copy and the atlas, the voxels are discarded after voxelization
+	TScopedPtr< SDFValue >	scratch_voxels( threadLocalHeap() );
+	if( !_cpu_voxels && !upload_to_atlas ) {
+		mxDO(nwAllocArray( scratch_voxels.ptr, max_bricks_in_batch * num_voxels_in_brick, scratch_voxels.allocator ));
+	}
+
+	// collect the bricks to voxelize
+
+	U32 num_consumed_slots = 0;
+	U32 num_bricks = 0;
+
+	for( ; num_consumed_slots < max_bricks_in_batch; num_consumed_slots++ )
+	{
+		const U32 slot_index = _dirty_slots[ num_consumed_slots ];
+
+		// skip the bricks that were freed after being marked dirty
+		if( _slot_states[ slot_index ] & SLOT_RESIDENT_BIT )
+		{
+			VoxelizedBrick & brick = bricks.ptr[ num_bricks ];
+			brick.key = _slot_keys[ slot_index ];
+			brick.slot_index = slot_index;
+
+			if( _cpu_voxels )
+			{
+				brick.sdf_values = _cpu_voxels + slot_index * num_voxels_in_brick;
+				brick.gpu_memory = nil;
+			}
+			else if( !upload_to_atlas )
+			{
+				brick.sdf_values = scratch_voxels.ptr + num_bricks * num_voxels_in_brick;
+				brick.gpu_memory = nil;
+			}
+			else
+			{
+				// write the voxels directly into the memory for updating the texture
+				// (it's released by NGpu::UpdateTexture(), so it's allocated only if the brick will be uploaded)
+				brick.gpu_memory = NGpu::Allocate( brick_size_in_bytes );
+				if( !brick.gpu_memory ) {
+					// the remaining bricks stay dirty
+					break;
+				}
+				brick.sdf_values = (SDFValue*) brick.gpu_memory->data;
+			}
+
+			num_bricks++;
+		}
+
+		_slot_dirty_flags[ slot_index ] = 0;
+	}
+
+	memmove(
+		_dirty_slots
+		, _dirty_slots + num_consumed_slots
+		, sizeof(_dirty_slots[0]) * ( num_dirty_slots - num_consumed_slots )
+		);
+	_num_dirty_slots = num_dirty_slots - num_consumed_slots;
+
+	if( !num_bricks ) {
+		return ALL_OK;
+	}
+
+	// voxelize on worker threads
+
+	const JobID voxelization_jobs_group = task_scheduler.beginGroup();
+	{
+		JobID	h_voxelization_job;
+		nwCREATE_JOB(h_voxelization_job
+			, task_scheduler
+			, -1, num_bricks
+			, JobPriority_Normal
+			, VoxelizeBricksJob
+			, bricks.ptr
+			, voxelize_brick
+			, user_data
+			, _cfg.brick_dim
+			);
+		(void) h_voxelization_job;
+	}
+	task_scheduler.endGroup();
+
+	task_scheduler.waitFor( voxelization_jobs_group );
+
+	// upload on the main thread
+
+	if( upload_to_atlas )
+	{
+		for( U32 i = 0; i < num_bricks; i++ )
+		{
+			const VoxelizedBrick& brick = bricks.ptr[i];
+
+			const NGpu::Memory* volume_texture_data = brick.gpu_memory;
+			if( !volume_texture_data )
+			{
+				volume_texture_data = NGpu::Allocate( brick_size_in_bytes );
+				if( !volume_texture_data )
+				{
+					// only the bricks with a CPU copy get here, so no upload memory is pending;
+					// the remaining bricks will be uploaded by the next batch
+					for( U32 k = i; k < num_bricks; k++ ) {
+						_QueueDirtySlot( bricks.ptr[k].slot_index );
+					}
+					break;
+				}
+				memcpy( volume_texture_data->data, brick.sdf_values, brick_size_in_bytes );
+			}
+
+			PooledBrickHandle	brick_handle;
+			brick_handle.id = brick.slot_index;	// the generation doesn't matter here
+
+			const UShort3 offset_in_atlas = this->GetBrickOffsetInAtlas( brick_handle );
+
+			NwTextureRegion	texture_update_region;
+			{
+				texture_update_region.x	= offset_in_atlas.x;
+				texture_update_region.y	= offset_in_atlas.y;
+				texture_update_region.z	= offset_in_atlas.z;
+				texture_update_region.width		= _cfg.brick_dim;
+				texture_update_region.height	= _cfg.brick_dim;
+				texture_update_region.depth		= _cfg.brick_dim;
+				texture_update_region.arraySlice = 0;
+				texture_update_region.mipMapLevel	= 0;
+			}
+
+			NGpu::UpdateTexture(
+				_h_atlas_tex3d
+				, texture_update_region
+				, volume_texture_data
+				);
+		}
+	}
+
+	_stats.num_voxelized_bricks += num_bricks;
+
+	return ALL_OK;
+}
+
+}//namespace VXGI
+}//namespace Rendering
+
+
+/*
+-----------------------------------------------------------------------------
+	UNIT TESTS
+-----------------------------------------------------------------------------
+*/
+
+#if MX_DEVELOPER
+
+namespace Rendering
+{
+namespace VXGI
+{
+namespace
+{
+	/// a few concurrent jobs are enough to exhaust the pool
+	enum { MAX_BRICKS_HELD_PER_JOB = 1024 };
+
+	/// Randomly allocates, touches, marks dirty and frees bricks,
+	/// checks that no slot is owned by two jobs at the same time.
+	struct BrickPoolChurnJob
+	{
+		BrickPool *		pool;
+		AtomicInt *		slot_owners;	//!< [max_resident_bricks] 0 or job index + 1
+		AtomicInt *		num_errors;
+		AtomicInt *		num_successful_allocations;
+		U32				num_operations;
+
+	public:
+		BrickPoolChurnJob(
+			BrickPool * pool
+			, AtomicInt * slot_owners
+			, AtomicInt * num_errors
+			, AtomicInt * num_successful_allocations
+			, const U32 num_operations
+			)
+			: pool(pool)
+			, slot_owners(slot_owners)
+			, num_errors(num_errors)
+			, num_successful_allocations(num_successful_allocations)
+			, num_operations(num_operations)
+		{}
+
+		ERet Run( const NwThreadContext& context, int start, int end )
+		{
+			for( int job_index = start; job_index < end; job_index++ )
+			{
+				this->Churn( job_index );
+			}
+			return ALL_OK;
+		}
+
+		void Churn( const int job_index )
+		{
+			PooledBrickHandle	held_bricks[ MAX_BRICKS_HELD_PER_JOB ];
+			U32 num_held_bricks = 0;
+			U32 num_allocations = 0;
+			U32 num_errors_in_job = 0;
+
+			const AtomicInt owner_id = job_index + 1;
+
+			NwRandom	rng( job_index + 1 );
+
+			for( U32 i = 0; i < num_operations; i++ )
+			{
+				const int op = rng.RandomInt( 3 );	// [0..2]
+
+				if( num_held_bricks < MAX_BRICKS_HELD_PER_JOB && ( op < 2 || !num_held_bricks ) )
+				{
+					PooledBrickHandle	new_brick;
+					if( mxSUCCEDED( pool->AllocBrick( new_brick, ( U64(job_index) << 32 ) | i ) ) )
+					{
+						const U32 slot_index = new_brick.id & 0xFFFF;
+						num_errors_in_job += !AtomicCAS( &slot_owners[ slot_index ], 0, owner_id );
+						held_bricks[ num_held_bricks++ ] = new_brick;
+						num_allocations++;
+					}
+				}
+				else if( op == 2 && num_held_bricks )
+				{
+					const PooledBrickHandle brick = held_bricks[ rng.RandomInt( num_held_bricks ) ];
+					pool->TouchBrick( brick );
+					num_errors_in_job += !pool->MarkBrickDirty( brick );
+				}
+				else
+				{
+					const U32 index = rng.RandomInt( num_held_bricks );
+					const PooledBrickHandle brick = held_bricks[ index ];
+					held_bricks[ index ] = held_bricks[ --num_held_bricks ];
+
+					const U32 slot_index = brick.id & 0xFFFF;
+					num_errors_in_job += !AtomicCAS( &slot_owners[ slot_index ], owner_id, 0 );
+					num_errors_in_job += !pool->FreeBrick( brick );
+					// a stale handle must not free the slot again
+					num_errors_in_job += pool->FreeBrick( brick );
+				}
+			}
+
+			while( num_held_bricks )
+			{
+				const PooledBrickHandle brick = held_bricks[ --num_held_bricks ];
+				AtomicExchange( &slot_owners[ brick.id & 0xFFFF ], 0 );
+				num_errors_in_job += !pool->FreeBrick( brick );
+			}
+
+			AtomicAdd( *num_errors, num_errors_in_job );
+			AtomicAdd( *num_successful_allocations, num_allocations );
+		}
+	};
+
+	static SDFValue MakeTestVoxelValue( const U64 brick_key, const U32 voxel_index )
+	{
+		return SDFValue( ( brick_key * 31 + voxel_index ) & 0xFF );
+	}
+
+	static void VoxelizeTestBrick(
+		SDFValue * sdf_values_
+		, const U32 brick_dim
+		, const U64 brick_key
+		, void * user_data
+		)
+	{
+		const U32 num_voxels = ToCube( brick_dim );
+		for( U32 i = 0; i < num_voxels; i++ ) {
+			sdf_values_[i] = MakeTestVoxelValue( brick_key, i );
+		}
+	}
+
+}//namespace
+
+ERet Benchmark_BrickPoolChurn(
+	NwJobSchedulerI& task_scheduler
+	, const U32 num_jobs
+	, const U32 num_operations_per_job
+	)
+{
+	AllocatorI & allocator = MemoryHeaps::process();
+
+	BrickPool::Config	cfg;
+	cfg.max_resident_bricks = 4096;
+	cfg.brick_dim = 8;
+	cfg.max_bricks_to_voxelize_per_batch = 1024;
+	cfg.create_atlas_texture = false;
+	cfg.keep_cpu_copy = true;
+
+	BrickPool	pool( allocator );
+	mxDO(pool.Initialize( cfg ));
+
+	// 1) concurrent allocation churn
+
+	TScopedPtr< AtomicInt >	slot_owners( allocator );
+	mxDO(nwAllocArray( slot_owners.ptr, cfg.max_resident_bricks, allocator ));
+	memset( slot_owners.ptr, 0, sizeof(slot_owners.ptr[0]) * cfg.max_resident_bricks );
+
+	AtomicInt	num_errors = 0;
+	AtomicInt	num_successful_allocations = 0;
+
+	U64 churn_usec;
+	{
+		ScopedTimer	timer;
+
+		const JobID churn_jobs_group = task_scheduler.beginGroup();
+		{
+			JobID	h_churn_job;
+			nwCREATE_JOB(h_churn_job
+				, task_scheduler
+				, -1, num_jobs
+				, JobPriority_Normal
+				, BrickPoolChurnJob
+				, &pool
+				, slot_owners.ptr
+				, &num_errors
+				, &num_successful_allocations
+				, num_operations_per_job
+				);
+			(void) h_churn_job;
+		}
+		task_scheduler.endGroup();
+		task_scheduler.waitFor( churn_jobs_group );
+
+		churn_usec = timer.ElapsedMicroseconds();
+	}
+
+	pool.BeginFrame();
+
+	mxENSURE( num_errors == 0, ERR_UNKNOWN_ERROR, "brick pool churn: %d errors", num_errors );
+	mxENSURE( pool.GetStats().num_resident_bricks == 0, ERR_UNKNOWN_ERROR, "leaked bricks" );
+
+	// all slots must be back in the free list
+	{
+		DynamicArray< PooledBrickHandle >	bricks( allocator );
+		mxDO(bricks.setNum( cfg.max_resident_bricks ));
+
+		for( U32 i = 0; i < cfg.max_resident_bricks; i++ ) {
+			mxDO(pool.AllocBrick( bricks[i], i ));
+		}
+		PooledBrickHandle	extra_brick;
+		mxENSURE( pool.AllocBrick( extra_brick, 0 ) == ERR_OUT_OF_MEMORY, ERR_UNKNOWN_ERROR, "the pool is over budget" );
+
+		for( U32 i = 0; i < cfg.max_resident_bricks; i++ ) {
+			mxENSURE( pool.FreeBrick( bricks[i] ), ERR_UNKNOWN_ERROR, "" );
+		}
+	}
+
+	// 2) LRU eviction and batched voxelization, over several frames
+
+	enum { NUM_FRAMES = 32 };
+	enum { NUM_NEW_BRICKS_PER_FRAME = 512 };
+	enum { MIN_FREE_BRICKS = NUM_NEW_BRICKS_PER_FRAME };
+
+	DynamicArray< PooledBrickHandle >	live_bricks( allocator );
+	mxDO(live_bricks.reserve( NUM_FRAMES * NUM_NEW_BRICKS_PER_FRAME ));
+
+	U64 evict_usec = 0;
+	U64 voxelize_usec = 0;
+	U64 next_brick_key = 0;
+
+	for( U32 iFrame = 0; iFrame < NUM_FRAMES; iFrame++ )
+	{
+		pool.BeginFrame();
+
+		// keep the bricks created in the previous frame alive
+		const U32 num_live_bricks = live_bricks.num();
+		const U32 first_recent_brick = num_live_bricks > NUM_NEW_BRICKS_PER_FRAME ? num_live_bricks - NUM_NEW_BRICKS_PER_FRAME : 0;
+		for( U32 i = first_recent_brick; i < num_live_bricks; i++ ) {
+			pool.TouchBrick( live_bricks[i] );
+		}
+
+		{
+			ScopedTimer	timer;
+			pool.EvictLeastRecentlyUsed( MIN_FREE_BRICKS );
+			evict_usec += timer.ElapsedMicroseconds();
+		}
+
+		// the recently used bricks must survive
+		for( U32 i = first_recent_brick; i < num_live_bricks; i++ ) {
+			mxENSURE( pool.IsBrickResident( live_bricks[i] ), ERR_UNKNOWN_ERROR, "a recently used brick was evicted" );
+		}
+
+		for( U32 i = 0; i < NUM_NEW_BRICKS_PER_FRAME; i++ )
+		{
+			PooledBrickHandle	new_brick;
+			mxDO(pool.AllocBrick( new_brick, next_brick_key++ ));
+			mxDO(live_bricks.add( new_brick ));
+		}
+
+		{
+			ScopedTimer	timer;
+			mxDO(pool.VoxelizeDirtyBricks( &VoxelizeTestBrick, nil, task_scheduler ));
+			voxelize_usec += timer.ElapsedMicroseconds();
+		}
+	}
+
+	pool.BeginFrame();
+
+	// check the voxels of the resident bricks
+	U32 num_resident_bricks = 0;
+	for( U32 i = 0; i < live_bricks.num(); i++ )
+	{
+		const PooledBrickHandle brick = live_bricks[i];
+		if( pool.IsBrickResident( brick ) )
+		{
+			const SDFValue* voxels = pool.GetBrickVoxels( brick );
+			const U64 brick_key = pool.GetBrickKey( brick );
+			for( U32 v = 0; v < pool.NumVoxelsInBrick(); v++ ) {
+				mxENSURE( voxels[v] == MakeTestVoxelValue( brick_key, v ), ERR_UNKNOWN_ERROR, "wrong voxels" );
+			}
+			num_resident_bricks++;
+		}
+	}
+
+	const BrickPool::Stats& stats = pool.GetStats();
+	mxENSURE( num_resident_bricks == stats.num_resident_bricks, ERR_UNKNOWN_ERROR, "" );
+	mxENSURE( num_resident_bricks <= cfg.max_resident_bricks, ERR_UNKNOWN_ERROR, "" );
+
+	const U32 num_operations = num_jobs * num_operations_per_job;
+
+	ptPRINT("Brick pool churn: %u jobs, %u operations (%u allocations): %.3f ms (%.1f M ops/sec), 0 errors;"
+		" per frame: eviction: %.3f ms, voxelization of %u bricks: %.3f ms; %u bricks evicted, %u resident",
+		num_jobs, num_operations, (U32)num_successful_allocations,
+		churn_usec * 1e-3f, num_operations / largest( (F32)churn_usec, 1.0f ),
+		evict_usec * 1e-3f / NUM_FRAMES,
+		(U32)NUM_NEW_BRICKS_PER_FRAME, voxelize_usec * 1e-3f / NUM_FRAMES,
+		stats.num_evicted_bricks, stats.num_resident_bricks
+		);
+
+	pool.Shutdown();
+
+	return ALL_OK;
+}
+
+}//namespace VXGI
+}//namespace Rendering
+
+#endif // MX_DEVELOPER
@@ -0,0 +1,251 @@
+// A pool of fixed-size SDF bricks which stay within a memory budget:
+// bricks are allocated and freed from any thread via a lock-free free list,
+// the least recently used bricks are evicted when the pool runs low on free slots,
+// and dirty bricks are voxelized in batches on worker threads.
+#pragma once
+
+#include <Core/Tasking/TaskSchedulerInterface.h>
+
+#include <Rendering/Private/Modules/VoxelGI/vxgi_brickmap.h>	// SDFValue
+
+
+namespace Rendering
+{
+namespace VXGI
+{
+
+/// (generation << 16) | slot index; becomes invalid when the brick is freed or evicted
+mxDECLARE_32BIT_HANDLE(PooledBrickHandle);
+
+
+/// Lock-free LIFO list of free slot indices (Treiber stack).
+/// The head packs the index of the top slot (low 16 bits) and a tag (high 16 bits)
+/// which is incremented on every push and pop to avoid the ABA problem.
+struct BrickFreeList
+{
+	AtomicInt	_head;
+	AtomicInt *	_next;	//!< [max_slots] the next free slot index, only valid for free slots
+
+	enum { EMPTY = 0xFFFF };
+
+public:
+	BrickFreeList();
+
+	/// pushes all slots, so that slot 0 is popped first
+	void Reset( AtomicInt * next_storage, const U32 num_slots );
+
+	/// returns EMPTY if there are no free slots
+	U32 Pop();
+
+	void Push( const U32 slot_index );
+};
+
+
+/// Manages residency of fixed-size bricks in a 3D atlas texture.
+///
+/// Threading:
+/// AllocBrick(), FreeBrick(), TouchBrick(), MarkBrickDirty() and IsBrickResident()
+/// can be called concurrently from any thread.
+/// BeginFrame(), EvictLeastRecentlyUsed() and VoxelizeDirtyBricks() must be called
+/// from the main thread when no other thread is using the pool.
+class BrickPool: NonCopyable
+{
+public:
+	struct Config
+	{
+		/// the memory budget, in bricks (slot indices are 16-bit)
+		U16		max_resident_bricks;
+
+		/// the number of voxels along each side of a brick
+		U16		brick_dim;
+
+		/// the number of bricks voxelized by VoxelizeDirtyBricks(),
+		/// the remaining bricks stay dirty until the next call
+		U16		max_bricks_to_voxelize_per_batch;
+
+		/// false for CPU-only use (e.g. in tests)
+		bool	create_atlas_texture;
+
+		/// keep the voxels of all resident bricks in system memory (e.g. for collision queries)
+		bool	keep_cpu_copy;
+
+	public:
+		Config()
+		{
+			max_resident_bricks = 4096;	// a 128^3 atlas with 8^3 bricks
+			brick_dim = 8;
+			max_bricks_to_voxelize_per_batch = 256;
+			create_atlas_texture = true;
+			keep_cpu_copy = false;
+		}
+	};
+
+	/// Fills the SDF values of a brick (x varies fastest), called on worker threads.
+	typedef void VoxelizeBrickFun(
+		SDFValue * sdf_values_
+		, const U32 brick_dim
+		, const U64 brick_key
+		, void * user_data
+		);
+
+	struct Stats
+	{
+		U32		num_resident_bricks;
+		U32		num_dirty_bricks;
+		U32		num_evicted_bricks;		//!< total
+		U32		num_voxelized_bricks;	//!< total
+		U32		num_failed_allocations;	//!< total, when the pool was full
+	};
+
+public:
+	BrickPool( AllocatorI & allocator );
+	~BrickPool();
+
+	ERet Initialize( const Config& cfg );
+	void Shutdown();
+
+	/// Takes a free slot and marks it dirty.
+	/// The key describes the brick contents and is passed to the voxelization callback.
+	/// Returns ERR_OUT_OF_MEMORY if the budget is exhausted.
+	ERet AllocBrick(
+		PooledBrickHandle &new_brick_handle_
+		, const U64 brick_key
+		);
+
+	/// Returns false if the brick was already freed or evicted.
+	bool FreeBrick(
+		const PooledBrickHandle brick_handle
+		);
+
+	bool IsBrickResident(
+		const PooledBrickHandle brick_handle
+		) const;
+
+	/// Marks the brick as used in the current frame, so that it won't be evicted soon.
+	void TouchBrick(
+		const PooledBrickHandle brick_handle
+		);
+
+	/// The brick will be re-voxelized by VoxelizeDirtyBricks().
+	/// Returns false if the brick is not resident.
+	bool MarkBrickDirty(
+		const PooledBrickHandle brick_handle
+		);
+
+	U64 GetBrickKey(
+		const PooledBrickHandle brick_handle
+		) const;
+
+	/// Returns the brick's offset in the atlas texture, in voxels.
+	UShort3 GetBrickOffsetInAtlas(
+		const PooledBrickHandle brick_handle
+		) const;
+
+	/// Returns nil if keep_cpu_copy is off.
+	const SDFValue* GetBrickVoxels(
+		const PooledBrickHandle brick_handle
+		) const;
+
+public:	// Main thread.
+
+	void BeginFrame();
+
+	/// Frees the least recently used bricks until at least min_free_bricks slots are free.
+	/// The bricks used in the current frame are never evicted.
+	/// Returns the number of evicted bricks.
+	U32 EvictLeastRecentlyUsed(
+		const U32 min_free_bricks
+		);
+
+	/// Voxelizes up to max_bricks_to_voxelize_per_batch dirty bricks on worker threads
+	/// and uploads them into the atlas texture.
+	ERet VoxelizeDirtyBricks(
+		VoxelizeBrickFun * voxelize_brick
+		, void * user_data
+		, NwJobSchedulerI& task_scheduler
+		);
+
+	const Stats& GetStats() const { return _stats; }
+
+	HTexture GetAtlasTexture() const { return _h_atlas_tex3d; }
+
+	U32 GetAtlasResolution() const { return _bricks_per_atlas_side * _cfg.brick_dim; }
+
+	U32 NumVoxelsInBrick() const { return ToCube( (U32)_cfg.brick_dim ); }
+
+private:
+	enum ESlotState
+	{
+		SLOT_RESIDENT_BIT = 1,
+		SLOT_GENERATION_SHIFT = 1,
+	};
+
+	U32 _GetResidentSlotIndex( const PooledBrickHandle brick_handle ) const;
+
+	bool _TryReleaseSlot( const U32 slot_index, const U32 generation );
+
+	/// Adds the slot to the dirty list, unless it's already there.
+	void _QueueDirtySlot( const U32 slot_index );
+
+private:
+	BrickFreeList	_free_list;
+
+	// per-slot data
+
+	/// (generation << 1) | SLOT_RESIDENT_BIT, the generation is incremented on release
+	AtomicInt *		_slot_states;
+	AtomicInt *		_slot_free_list_next;
+	AtomicInt *		_slot_last_used_frames;
+	AtomicInt *		_slot_dirty_flags;
+	U64 *			_slot_keys;
+
+	/// slot indices, each slot is queued at most once (guarded by its dirty flag)
+	U32 *			_dirty_slots;
+	AtomicInt		_num_dirty_slots;
+
+	AtomicInt		_num_resident_bricks;
+	AtomicInt		_num_failed_allocations;
+
+	U32				_current_frame;
+
+	U32				_bricks_per_atlas_side;
+
+	SDFValue *		_cpu_voxels;	//!< optional
+
+	HTexture		_h_atlas_tex3d;	//!< optional
+
+	void *			_memory;	//!< per-slot arrays are allocated in one block
+	AllocatorI &	_allocator;
+
+	Config			_cfg;
+	Stats			_stats;
+};
+
+}//namespace VXGI
+}//namespace Rendering
+
+
+/*
+-----------------------------------------------------------------------------
+	UNIT TESTS
+-----------------------------------------------------------------------------
+*/
+
+#if MX_DEVELOPER
+
+namespace Rendering
+{
+namespace VXGI
+{
+	/// CPU-only (no GPU resources are created):
+	/// stresses concurrent allocation churn on worker threads and checks that no slot is handed out twice,
+	/// then checks LRU eviction and batched voxelization and prints the timings.
+	ERet Benchmark_BrickPoolChurn(
+		NwJobSchedulerI& task_scheduler
+		, const U32 num_jobs = 64
+		, const U32 num_operations_per_job = 100000
+		);
+}//namespace VXGI
+}//namespace Rendering
+
+#endif // MX_DEVELOPER
@@ -0,0 +1,626 @@
+// CPU occlusion culling with a software depth buffer.
+#include <Base/Base.h>
+#pragma hdrstop
+
+#include <emmintrin.h>	// SSE 2
+
+#include <Base/Math/BoundingVolumes/ViewFrustum.h>
+#include <Base/Math/Random.h>
+#include <Core/Tasking/TaskSchedulerInterface.h>
+#include <Core/Util/ScopedTimer.h>
+
+#include <Rendering/Public/Scene/SpatialDatabase.h>
+#include <Rendering/Public/Scene/OcclusionBuffer.h>
+
+
+namespace Rendering
+{
+namespace
+{
+	/// the 12 triangles of a box, the corners are indexed by the bits (X = 1, Y = 2, Z = 4)
+	static const U32 s_box_indices[36] =
+	{
+		0, 2, 1,	1, 2, 3,	// -Z
+		4, 5, 6,	5, 7, 6,	// +Z
+		0, 1, 4,	1, 5, 4,	// -Y
+		2, 6, 3,	3, 6, 7,	// +Y
+		0, 4, 2,	2, 4, 6,	// -X
+		1, 3, 5,	3, 7, 5,	// +X
+	};
+
+	static mxFORCEINLINE
+	void getBoxCorners( const AABBf& aabb, V3f corners_[8] )
+	{
+		for( UINT i = 0; i < 8; i++ )
+		{
+			corners_[i] = V3f::set(
+				( i & 1 ) ? aabb.max_corner.x : aabb.min_corner.x,
+				( i & 2 ) ? aabb.max_corner.y : aabb.min_corner.y,
+				( i & 4 ) ? aabb.max_corner.z : aabb.min_corner.z
+				);
+		}
+	}
+
+	/// rasterizes one band of tiles per job
+	class RasterizeBandsJob: NonCopyable
+	{
+		NwOcclusionBuffer &	_buffer;
+
+	public:
+		RasterizeBandsJob( NwOcclusionBuffer & buffer )
+			: _buffer( buffer )
+		{
+		}
+
+		ERet Run( const NwThreadContext& context, int start, int end )
+		{
+			for( int band_index = start; band_index < end; band_index++ )
+			{
+				_buffer.RasterizeBand( band_index );
+			}
+			return ALL_OK;
+		}
+	};
+}//namespace
+
+NwOcclusionBuffer::NwOcclusionBuffer( AllocatorI & allocator )
+	: _depth( allocator )
+	, _tile_min_depth( allocator )
+	, _triangles( allocator )
+{
+	_view_projection_matrix = M44_Identity();
+	_width = 0;
+	_height = 0;
+	_num_tiles_x = 0;
+	_num_tiles_y = 0;
+	_near_clip = 0;
+}
+
+NwOcclusionBuffer::~NwOcclusionBuffer()
+{
+}
+
+ERet NwOcclusionBuffer::Initialize( const NwOcclusionBufferSettings& settings )
+{
+	mxENSURE( settings.width > 0 && settings.height > 0
+		&& settings.width % TILE_SIZE == 0 && settings.height % TILE_SIZE == 0
+		, ERR_INVALID_PARAMETER
+		, "the resolution (%ux%u) must be a multiple of %u", settings.width, settings.height, TILE_SIZE
+		);
+	mxENSURE( settings.near_clip > 0, ERR_INVALID_PARAMETER, "" );
+
+	_width = settings.width;
+	_height = settings.height;
+	_num_tiles_x = settings.width / TILE_SIZE;
+	_num_tiles_y = settings.height / TILE_SIZE;
+	_near_clip = settings.near_clip;
+
+	mxDO(_depth.setNum( _width * _height ));
+	mxDO(_tile_min_depth.setNum( _num_tiles_x * _num_tiles_y ));
+
+	BeginFrame( M44_Identity() );
+
+	return ALL_OK;
+}
+
+void NwOcclusionBuffer::Shutdown()
+{
+	_depth.clear();
+	_tile_min_depth.clear();
+	_triangles.clear();
+}
+
+void NwOcclusionBuffer::BeginFrame( const M44f& view_projection_matrix )
+{
+	_view_projection_matrix = view_projection_matrix;
+
+	// the pixels and the tiles of the depth buffer are cleared in RasterizeOccluders()
+	_triangles.RemoveAll();
+
+	_stats = NwOcclusionStats();
+}
+
+ERet NwOcclusionBuffer::AddOccluderMesh(
+	const V3f* positions
+	, const U32 num_vertices
+	, const U32* indices
+	, const U32 num_indices
+	, const M44f& local_to_world_matrix
+	)
+{
+	mxASSERT( num_indices % 3 == 0 );
+
+	const M44f local_to_clip_matrix = M44_Multiply( local_to_world_matrix, _view_projection_matrix );
+
+	V4f *	clip_positions;
+	mxTRY_ALLOC_SCOPED( clip_positions, num_vertices, MemoryHeaps::temporary() );
+
+	for( U32 i = 0; i < num_vertices; i++ )
+	{
+		clip_positions[i] = M44_Transform3( local_to_clip_matrix, V4f::set( positions[i], 1.0f ) );
+	}
+
+	for( U32 i = 0; i < num_indices; i += 3 )
+	{
+		mxASSERT( indices[i] < num_vertices && indices[i+1] < num_vertices && indices[i+2] < num_vertices );
+		mxDO(addTriangle( clip_positions[ indices[i] ], clip_positions[ indices[i+1] ], clip_positions[ indices[i+2] ] ));
+	}
+
+	_stats.num_occluders++;
+	_stats.num_triangles_submitted += num_indices / 3;
+
+	return ALL_OK;
+}
+
+ERet NwOcclusionBuffer::AddOccluderBox( const AABBf& aabb )
+{
+	V3f		corners[8];
+	getBoxCorners( aabb, corners );
+
+	V4f		clip_positions[8];
+	for( UINT i = 0; i < 8; i++ )
+	{
+		clip_positions[i] = M44_Transform3( _view_projection_matrix, V4f::set( corners[i], 1.0f ) );
+	}
+
+	for( UINT i = 0; i < mxCOUNT_OF(s_box_indices); i += 3 )
+	{
+		mxDO(addTriangle(
+			clip_positions[ s_box_indices[i] ], clip_positions[ s_box_indices[i+1] ], clip_positions[ s_box_indices[i+2] ]
+			));
+	}
+
+	_stats.num_occluders++;
+	_stats.num_triangles_submitted += mxCOUNT_OF(s_box_indices) / 3;
+
+	return ALL_OK;
+}
+
+ERet NwOcclusionBuffer::addTriangle( const V4f& a, const V4f& b, const V4f& c )
+{
+	// skipping occluders is always conservative
+	if( a.w < _near_clip || b.w < _near_clip || c.w < _near_clip ) {
+		return ALL_OK;
+	}
+
+	const V4f* clip_positions[3] = { &a, &b, &c };
+
+	F32		x[3], y[3], z[3];
+	for( UINT i = 0; i < 3; i++ )
+	{
+		const V4f& p = *clip_positions[i];
+		const F32 inv_w = 1.0f / p.w;
+		x[i] = ( p.x * inv_w * 0.5f + 0.5f ) * _width;
+		y[i] = ( 0.5f - p.y * inv_w * 0.5f ) * _height;
+		z[i] = inv_w;
+	}
+
+	// the range of the pixels whose centers can be inside the triangle
+	const I32 min_x = largest( (I32) ceilf( smallest( smallest( x[0], x[1] ), x[2] ) - 0.5f ), 0 );
+	const I32 min_y = largest( (I32) ceilf( smallest( smallest( y[0], y[1] ), y[2] ) - 0.5f ), 0 );
+	const I32 max_x = smallest( (I32) floorf( largest( largest( x[0], x[1] ), x[2] ) - 0.5f ), (I32) _width - 1 );
+	const I32 max_y = smallest( (I32) floorf( largest( largest( y[0], y[1] ), y[2] ) - 0.5f ), (I32) _height - 1 );
+
+	if( min_x > max_x || min_y > max_y ) {
+		return ALL_OK;
+	}
+
+	// twice the signed area, the triangles of both windings are rasterized
+	const F32 area = ( x[1] - x[0] ) * ( y[2] - y[0] ) - ( x[2] - x[0] ) * ( y[1] - y[0] );
+	if( area == 0.0f ) {
+		return ALL_OK;
+	}
+	const F32 sign = ( area > 0.0f ) ? 1.0f : -1.0f;
+
+	ScreenTriangle	triangle;
+
+	for( UINT i = 0; i < 3; i++ )
+	{
+		const UINT j = ( i + 1 ) % 3;
+		// the edge function is positive on the side of the remaining vertex
+		triangle.edges[i][0] = ( y[i] - y[j] ) * sign;
+		triangle.edges[i][1] = ( x[j] - x[i] ) * sign;
+		triangle.edges[i][2] = ( x[i] * y[j] - x[j] * y[i] ) * sign;
+
+		// inner-conservative coverage: the edge is moved inwards by half a pixel
+		// (along the axis of the biggest slope), so that the pixel is written
+		// only if its whole square is inside the triangle
+		triangle.edges[i][2] -= 0.5f * ( mmAbs( triangle.edges[i][0] ) + mmAbs( triangle.edges[i][1] ) );
+	}
+
+	// 1/W is linear in screen space
+	const F32 inv_area = 1.0f / area;
+	const F32 depth_dx = ( ( z[1] - z[0] ) * ( y[2] - y[0] ) - ( z[2] - z[0] ) * ( y[1] - y[0] ) ) * inv_area;
+	const F32 depth_dy = ( ( z[2] - z[0] ) * ( x[1] - x[0] ) - ( z[1] - z[0] ) * ( x[2] - x[0] ) ) * inv_area;
+	triangle.depth_plane[0] = depth_dx;
+	triangle.depth_plane[1] = depth_dy;
+	// the depth written at the pixel center is the farthest depth of the triangle over the whole pixel
+	triangle.depth_plane[2] = z[0] - depth_dx * x[0] - depth_dy * y[0]
+		- 0.5f * ( mmAbs( depth_dx ) + mmAbs( depth_dy ) );
+
+	triangle.min_x = min_x;
+	triangle.min_y = min_y;
+	triangle.max_x = max_x;
+	triangle.max_y = max_y;
+
+	mxDO(_triangles.add( triangle ));
+
+	_stats.num_triangles_rasterized++;
+
+	return ALL_OK;
+}
+
+ERet NwOcclusionBuffer::RasterizeOccluders( NwJobSchedulerI & job_scheduler )
+{
+	ScopedTimer	timer;
+
+	JobID	h_job_rasterize_bands;
+	nwCREATE_JOB(h_job_rasterize_bands
+		, job_scheduler
+		, -1, _num_tiles_y
+		, JobPriority_High
+		, RasterizeBandsJob
+		, *this
+		);
+
+	job_scheduler.waitFor( h_job_rasterize_bands );
+
+	_stats.rasterization_usec = timer.ElapsedMicroseconds();
+
+	return ALL_OK;
+}
+
+void NwOcclusionBuffer::RasterizeBand( const U32 band_index )
+{
+	const I32 band_min_y = band_index * TILE_SIZE;
+	const I32 band_max_y = band_min_y + TILE_SIZE - 1;
+
+	F32 * band_depth = _depth.raw() + band_min_y * _width;
+
+	// clear to the far plane
+	for( U32 i = 0; i < _width * TILE_SIZE; i++ ) {
+		band_depth[i] = 0.0f;
+	}
+
+	const __m128 lane_offsets = _mm_setr_ps( 0.5f, 1.5f, 2.5f, 3.5f );
+	const __m128 zero = _mm_setzero_ps();
+
+	for( U32 iTriangle = 0; iTriangle < _triangles.num(); iTriangle++ )
+	{
+		const ScreenTriangle& triangle = _triangles[ iTriangle ];
+		if( triangle.max_y < band_min_y || triangle.min_y > band_max_y ) {
+			continue;
+		}
+
+		const I32 min_y = largest( triangle.min_y, band_min_y );
+		const I32 max_y = smallest( triangle.max_y, band_max_y );
+		const I32 min_x = triangle.min_x & ~3;	// the rows are processed 4 pixels at once
+
+		const __m128 edge0_A = _mm_set1_ps( triangle.edges[0][0] );
+		const __m128 edge1_A = _mm_set1_ps( triangle.edges[1][0] );
+		const __m128 edge2_A = _mm_set1_ps( triangle.edges[2][0] );
+		const __m128 depth_A = _mm_set1_ps( triangle.depth_plane[0] );
+
+		for( I32 y = min_y; y <= max_y; y++ )
+		{
+			const F32 pixel_center_y = y + 0.5f;
+
+			// the edge functions and the depth at the start of the row
+			const __m128 edge0_row = _mm_set1_ps( triangle.edges[0][1] * pixel_center_y + triangle.edges[0][2] );
+			const __m128 edge1_row = _mm_set1_ps( triangle.edges[1][1] * pixel_center_y + triangle.edges[1][2] );
+			const __m128 edge2_row = _mm_set1_ps( triangle.edges[2][1] * pixel_center_y + triangle.edges[2][2] );
+			const __m128 depth_row = _mm_set1_ps( triangle.depth_plane[1] * pixel_center_y + triangle.depth_plane[2] );
+
+			F32 * row_depth = _depth.raw() + y * _width;
+
+			for( I32 x = min_x; x <= triangle.max_x; x += 4 )
+			{
+				const __m128 pixel_center_x = _mm_add_ps( _mm_set1_ps( (F32) x ), lane_offsets );
+
+				const __m128 edge0 = _mm_add_ps( _mm_mul_ps( edge0_A, pixel_center_x ), edge0_row );
+				const __m128 edge1 = _mm_add_ps( _mm_mul_ps( edge1_A, pixel_center_x ), edge1_row );
+				const __m128 edge2 = _mm_add_ps( _mm_mul_ps( edge2_A, pixel_center_x ), edge2_row );
+
+				const __m128 inside = _mm_and_ps(
+					_mm_cmpge_ps( edge0, zero ),
+					_mm_and_ps( _mm_cmpge_ps( edge1, zero ), _mm_cmpge_ps( edge2, zero ) )
+					);
+
+				const __m128 depth = _mm_add_ps( _mm_mul_ps( depth_A, pixel_center_x ), depth_row );
+
+				// keep the closest occluder (the biggest 1/W)
+				const __m128 old_depth = _mm_loadu_ps( row_depth + x );
+				const __m128 new_depth = _mm_max_ps( old_depth, depth );
+				_mm_storeu_ps( row_depth + x, _mm_or_ps( _mm_and_ps( inside, new_depth ), _mm_andnot_ps( inside, old_depth ) ) );
+			}
+		}
+	}
+
+	// the farthest depth in each tile
+	F32 * tile_min_depth = _tile_min_depth.raw() + band_index * _num_tiles_x;
+
+	for( U32 tile_x = 0; tile_x < _num_tiles_x; tile_x++ )
+	{
+		__m128 min_depth = _mm_set1_ps( BIG_NUMBER );
+		for( U32 y = 0; y < TILE_SIZE; y++ )
+		{
+			const F32 * tile_row = band_depth + y * _width + tile_x * TILE_SIZE;
+			for( U32 x = 0; x < TILE_SIZE; x += 4 ) {
+				min_depth = _mm_min_ps( min_depth, _mm_loadu_ps( tile_row + x ) );
+			}
+		}
+		F32 lanes[4];
+		_mm_storeu_ps( lanes, min_depth );
+		tile_min_depth[ tile_x ] = smallest( smallest( lanes[0], lanes[1] ), smallest( lanes[2], lanes[3] ) );
+	}
+}
+
+bool NwOcclusionBuffer::IsBoxVisible( const AABBf& aabb ) const
+{
+	V3f		corners[8];
+	getBoxCorners( aabb, corners );
+
+	F32	min_x = +BIG_NUMBER, min_y = +BIG_NUMBER;
+	F32	max_x = -BIG_NUMBER, max_y = -BIG_NUMBER;
+	F32	max_depth = 0;	// the closest point of the box
+
+	for( UINT i = 0; i < 8; i++ )
+	{
+		const V4f p = M44_Transform3( _view_projection_matrix, V4f::set( corners[i], 1.0f ) );
+
+		// the box crosses the near plane
+		if( p.w < _near_clip ) {
+			return true;
+		}
+
+		const F32 inv_w = 1.0f / p.w;
+		const F32 x = ( p.x * inv_w * 0.5f + 0.5f ) * _width;
+		const F32 y = ( 0.5f - p.y * inv_w * 0.5f ) * _height;
+
+		min_x = smallest( min_x, x );
+		min_y = smallest( min_y, y );
+		max_x = largest( max_x, x );
+		max_y = largest( max_y, y );
+		max_depth = largest( max_depth, inv_w );
+	}
+
+	// all pixels touched by the screen-space bounding rectangle
+	const I32 first_x = largest( (I32) floorf( min_x ), 0 );
+	const I32 first_y = largest( (I32) floorf( min_y ), 0 );
+	const I32 last_x = smallest( (I32) floorf( max_x ), (I32) _width - 1 );
+	const I32 last_y = smallest( (I32) floorf( max_y ), (I32) _height - 1 );
+
+	// outside the screen, should have been rejected by frustum culling
+	if( first_x > last_x || first_y > last_y ) {
+		return true;
+	}
+
+	for( I32 tile_y = first_y / TILE_SIZE; tile_y <= last_y / TILE_SIZE; tile_y++ )
+	{
+		for( I32 tile_x = first_x / TILE_SIZE; tile_x <= last_x / TILE_SIZE; tile_x++ )
+		{
+			// the whole tile is closer than the box
+			if( _tile_min_depth[ tile_y * _num_tiles_x + tile_x ] > max_depth ) {
+				continue;
+			}
+
+			const I32 x0 = largest( first_x, tile_x * TILE_SIZE );
+			const I32 y0 = largest( first_y, tile_y * TILE_SIZE );
+			const I32 x1 = smallest( last_x, tile_x * TILE_SIZE + TILE_SIZE - 1 );
+			const I32 y1 = smallest( last_y, tile_y * TILE_SIZE + TILE_SIZE - 1 );
+
+			for( I32 y = y0; y <= y1; y++ )
+			{
+				const F32 * row_depth = _depth.raw() + y * _width;
+				for( I32 x = x0; x <= x1; x++ )
+				{
+					if( row_depth[x] <= max_depth ) {
+						return true;
+					}
+				}
+			}
+		}
+	}
+
+	return false;
+}
+
+}//namespace Rendering
+
+/*
+-----------------------------------------------------------------------------
+	UNIT TESTS
+-----------------------------------------------------------------------------
+*/
+
+#if MX_DEVELOPER
+
+namespace Rendering
+{
+namespace
+{
+	struct BenchmarkCity
+	{
+		enum { NUM_BLOCKS = 24 };
+
+		AABBf	buildings[ NUM_BLOCKS * NUM_BLOCKS ];
+
+		static F32 blockSize() { return 40.0f; }
+		static F32 citySize() { return NUM_BLOCKS * blockSize(); }
+
+		void generate( NwRandom & rng )
+		{
+			// Z is up, the streets are 16 units wide
+			for( UINT y = 0; y < NUM_BLOCKS; y++ )
+			{
+				for( UINT x = 0; x < NUM_BLOCKS; x++ )
+				{
+					const V3f mins = V3f::set( x * blockSize() + 8.0f, y * blockSize() + 8.0f, 0.0f );
+					const F32 height = rng.GetRandomFloatInRange( 15.0f, 80.0f );
+					buildings[ y * NUM_BLOCKS + x ] = AABBf::make( mins, mins + V3f::set( 24.0f, 24.0f, height ) );
+				}
+			}
+		}
+
+		/// returns true if the segment hits any building
+		bool isSegmentBlocked( const V3f& start, const V3f& end ) const
+		{
+			const V3f direction = end - start;
+			for( UINT i = 0; i < mxCOUNT_OF(buildings); i++ )
+			{
+				const AABBf& building = buildings[i];
+				F32 t_min = 0.0f, t_max = 1.0f;
+				bool missed = false;
+				for( UINT axis = 0; axis < 3 && !missed; axis++ )
+				{
+					if( direction[axis] == 0.0f ) {
+						missed = start[axis] < building.min_corner[axis] || start[axis] > building.max_corner[axis];
+						continue;
+					}
+					F32 t0 = ( building.min_corner[axis] - start[axis] ) / direction[axis];
+					F32 t1 = ( building.max_corner[axis] - start[axis] ) / direction[axis];
+					if( t0 > t1 ) TSwap( t0, t1 );
+					t_min = largest( t_min, t0 );
+					t_max = smallest( t_max, t1 );
+					missed = t_min > t_max;
+				}
+				if( !missed ) {
+					return true;
+				}
+			}
+			return false;
+		}
+	};
+}//namespace
+
+ERet Benchmark_OcclusionCulling(
+	NwJobSchedulerI & job_scheduler
+	, AllocatorI & allocator
+	, const U32 num_entities
+	)
+{
+	NwRandom	rng( 777 );
+
+	BenchmarkCity *	city;
+	mxTRY_ALLOC_SCOPED( city, 1, allocator );
+	city->generate( rng );
+
+	// the camera is in a street, looking along it
+	const V3f eye_position = V3f::set( BenchmarkCity::blockSize() * 2 + 4.0f, 2.0f, 1.7f );
+	const V3f look_direction = V3_Normalized( V3f::set( 0.3f, 1.0f, 0.0f ) );
+	const V3f up_direction = V3f::set( 0, 0, 1 );
+	const V3f right_direction = V3_Normalized( V3_Cross( look_direction, up_direction ) );
+
+	const F32 half_FoV_Y = DEG2RAD(30);
+	const F32 aspect_ratio = 2.0f;
+	const F32 near_clip = 0.1f;
+
+	M44f	projection_matrix, inverse_projection_matrix;
+	M44_ProjectionAndInverse_D3D_ReverseDepth_InfiniteFarPlane(
+		&projection_matrix, &inverse_projection_matrix
+		, half_FoV_Y * 2.0f, aspect_ratio, near_clip
+		);
+	const M44f view_matrix = M44_BuildView( right_direction, look_direction, up_direction, eye_position );
+	const M44f view_projection_matrix = M44_Multiply( view_matrix, projection_matrix );
+
+	ViewFrustum	view_frustum;
+	view_frustum.extractFrustumPlanes_Generic(
+		eye_position, right_direction, look_direction, up_direction
+		, half_FoV_Y, aspect_ratio, near_clip, BenchmarkCity::citySize() * 2
+		);
+
+	// small entities in the streets and on the roofs
+	SpatialDatabaseI* database = SpatialDatabaseI::CreateHierarchicalDatabase( allocator );
+	mxENSURE( database, ERR_OUT_OF_MEMORY, "" );
+
+	AABBf *	entity_boxes;
+	mxTRY_ALLOC_SCOPED( entity_boxes, num_entities, allocator );
+
+	for( U32 i = 0; i < num_entities; i++ )
+	{
+		const V3f center = V3f::set(
+			rng.GetRandomFloat01() * BenchmarkCity::citySize(),
+			rng.GetRandomFloat01() * BenchmarkCity::citySize(),
+			rng.GetRandomFloatInRange( 0.0f, 90.0f )
+			);
+		entity_boxes[i] = AABBf::fromSphere( center, rng.GetRandomFloatInRange( 0.2f, 2.0f ) );
+
+		// fake pointers to entities, never dereferenced
+		const void* entity = (const void*) ( size_t( i + 1 ) * 16 );
+		database->AddEntity( entity, RE_MeshInstance, AABBd::fromOther( entity_boxes[i] ) );
+	}
+
+	NwOcclusionBuffer	occlusion_buffer( allocator );
+	mxDO(occlusion_buffer.Initialize( NwOcclusionBufferSettings() ));
+
+	RenderEntityList	visible_entities( allocator );
+
+	ScopedTimer	timer;
+	mxDO(database->GetEntitiesIntersectingViewFrustum( visible_entities, view_frustum ));
+	const U64 frustum_culling_usec = timer.ElapsedMicroseconds();
+	const U32 num_in_frustum = visible_entities.count[ RE_MeshInstance ];
+
+	// the buildings in the frustum are the occluders
+	timer.Reset();
+	occlusion_buffer.BeginFrame( view_projection_matrix );
+	for( UINT i = 0; i < mxCOUNT_OF(city->buildings); i++ )
+	{
+		if( view_frustum.IntersectsAABB( city->buildings[i] ) ) {
+			mxDO(occlusion_buffer.AddOccluderBox( city->buildings[i] ));
+		}
+	}
+	const U64 setup_usec = timer.ElapsedMicroseconds();
+
+	mxDO(occlusion_buffer.RasterizeOccluders( job_scheduler ));
+
+	timer.Reset();
+	mxDO(database->GetEntitiesVisibleFromView( visible_entities, view_frustum, occlusion_buffer ));
+	const U64 occlusion_culling_usec = timer.ElapsedMicroseconds();
+	const U32 num_visible = visible_entities.count[ RE_MeshInstance ];
+
+	// check the culled entities: the rays from the eye to their corners must hit the buildings
+	U32 num_checked = 0;
+	U32 num_wrongly_culled = 0;
+	for( U32 i = 0; i < num_entities && num_checked < 1000; i++ )
+	{
+		const AABBf& box = entity_boxes[i];
+		if( !view_frustum.IntersectsAABB( box ) || occlusion_buffer.IsBoxVisible( box ) ) {
+			continue;
+		}
+		++num_checked;
+
+		V3f		corners[8];
+		getBoxCorners( box, corners );
+		for( UINT iCorner = 0; iCorner < 8; iCorner++ )
+		{
+			if( !city->isSegmentBlocked( eye_position, corners[ iCorner ] ) ) {
+				++num_wrongly_culled;
+				break;
+			}
+		}
+	}
+
+	const NwOcclusionStats& stats = occlusion_buffer.GetStats();
+
+	ptPRINT("Occlusion culling: %ux%u depth buffer, %u occluders, %u/%u triangles rasterized",
+		occlusion_buffer.GetWidth(), occlusion_buffer.GetHeight(),
+		stats.num_occluders, stats.num_triangles_rasterized, stats.num_triangles_submitted);
+	ptPRINT("	%u entities: %u in frustum (%.3f ms), %u visible, %u occluded (%.1f%%)",
+		num_entities, num_in_frustum, frustum_culling_usec * 1e-3f,
+		num_visible, num_in_frustum - num_visible, num_in_frustum ? 100.0f * ( num_in_frustum - num_visible ) / num_in_frustum : 0.0f);
+	ptPRINT("	occluder setup: %.3f ms, rasterization: %.3f ms, frustum + occlusion culling: %.3f ms",
+		setup_usec * 1e-3f, stats.rasterization_usec * 1e-3f, occlusion_culling_usec * 1e-3f);
+	ptPRINT("	checked %u culled entities by ray casting",
+		num_checked);
+
+	SpatialDatabaseI::Destroy( database );
+
+	mxENSURE( num_wrongly_culled == 0, ERR_UNKNOWN_ERROR,
+		"%u of %u culled entities have visible corners", num_wrongly_culled, num_checked );
+
+	return ALL_OK;
+}
+
+}//namespace Rendering
+
+#endif // MX_DEVELOPER
@@ -40,6 +40,7 @@ struct GlobalUniformBufferBindings
 	GlobalUniformBufferBinding	per_model;
 	GlobalUniformBufferBinding	lighting;	//!< global lighting parameters (e.g. sun/sky light)
 	GlobalUniformBufferBinding	skinning_data;
+	GlobalUniformBufferBinding	model_instances;	//!< world matrices for instanced draw calls
 	GlobalUniformBufferBinding	voxel_terrain;	//!< materials for rendering a voxel terrain
 };
 
@@ -559,6 +559,10 @@ ERet CreateGraphicsResources(
 		data._global_uniforms.skinning_data.handle = nwCREATE_GLOBAL_CONSTANT_BUFFER(G_SkinningData);
 		data._global_uniforms.skinning_data.slot = G_SkinningData_Index;
 
+		//
+		data._global_uniforms.model_instances.handle = nwCREATE_GLOBAL_CONSTANT_BUFFER(G_ModelInstances);
+		data._global_uniforms.model_instances.slot = G_ModelInstances_Index;
+
 		//
 		data._global_uniforms.voxel_terrain.handle = nwCREATE_GLOBAL_CONSTANT_BUFFER(G_VoxelTerrain);
 		data._global_uniforms.voxel_terrain.slot = G_VoxelTerrain_Index;
@@ -258,6 +258,7 @@ void DestroyGraphicsResources( RenderSystemData& data, const ClumpList& _clumps
 	NGraphics::DestroyGlobalConstantBuffer(data._global_uniforms.per_model.handle);
 	NGraphics::DestroyGlobalConstantBuffer(data._global_uniforms.lighting.handle);
 	NGraphics::DestroyGlobalConstantBuffer(data._global_uniforms.skinning_data.handle);
+	NGraphics::DestroyGlobalConstantBuffer(data._global_uniforms.model_instances.handle);
 	NGraphics::DestroyGlobalConstantBuffer(data._global_uniforms.voxel_terrain.handle);
 
 	//NGraphics::DestroyGlobalConstantBuffer(data._cb_instance_matrices);		data._cb_instance_matrices.SetNil();
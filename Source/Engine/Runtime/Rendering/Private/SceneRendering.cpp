@@ -1,6 +1,12 @@
 #include <Base/Base.h>
 #pragma hdrstop
 
+#include <algorithm>	// std::sort()
+
+#include <Base/Math/Random.h>
+#include <Core/Tasking/TaskSchedulerInterface.h>
+#include <Core/Util/ScopedTimer.h>
+
 #include <Rendering/Public/Globals.h>
 #include <Rendering/Public/Scene/SpatialDatabase.h>
 #include <Rendering/Private/ShaderInterop.h>
@@ -65,6 +71,232 @@ void RenderVisibleObjects(
 }
 
 
+/*
+-----------------------------------------------------------------------------
+	NwParallelCommandRecorder
+-----------------------------------------------------------------------------
+*/
+NwParallelCommandRecorder::NwParallelCommandRecorder( AllocatorI & allocator )
+	: _allocator( allocator )
+{
+	mxZERO_OUT_ARRAY(_contexts);
+	_num_batches = 0;
+}
+
+NwParallelCommandRecorder::~NwParallelCommandRecorder()
+{
+	this->Shutdown();
+}
+
+ERet NwParallelCommandRecorder::Initialize(
+	const U32 num_batches
+	, const U32 num_sort_items_per_batch
+	, const U32 command_buffer_size_per_batch
+	)
+{
+	mxENSURE( num_batches > 0 && num_batches <= MAX_BATCHES, ERR_INVALID_PARAMETER,
+		"the number of batches must be in [1..%u]", MAX_BATCHES );
+
+	this->Shutdown();
+
+	for( U32 i = 0; i < num_batches; i++ )
+	{
+		NGpu::NwRenderContext* render_context = mxNEW( _allocator, NGpu::NwRenderContext, _allocator );
+		mxENSURE( render_context, ERR_OUT_OF_MEMORY, "" );
+
+		_contexts[ _num_batches++ ] = render_context;
+		_results[ i ] = ALL_OK;
+
+		mxDO(render_context->reserve( num_sort_items_per_batch, command_buffer_size_per_batch ));
+	}
+
+	return ALL_OK;
+}
+
+void NwParallelCommandRecorder::Shutdown()
+{
+	for( U32 i = 0; i < _num_batches; i++ )
+	{
+		mxDELETE( _contexts[i], _allocator );
+		_contexts[i] = nil;
+	}
+	_num_batches = 0;
+}
+
+void NwParallelCommandRecorder::RecordBatch(
+	const U32 batch_index
+	, const RenderEntityList& visible_objects
+	, const U32 cascade_index
+	, const CubeMLf& voxel_cascade_bounds
+	, const NwCameraView& scene_view
+	, const RenderCallbacks& render_callbacks
+	, const RenderPath& render_path
+	, const RrGlobalSettings& renderer_settings
+	)
+{
+	mxASSERT( batch_index < _num_batches );
+	NGpu::NwRenderContext & render_context = *_contexts[ batch_index ];
+	render_context.reset();
+
+	_results[ batch_index ] = ALL_OK;
+
+	// the range of the batch in the list of visible objects without the gaps between the entity types
+	U32 total_count = 0;
+	for( UINT entity_type = 0; entity_type < RE_MAX; entity_type++ ) {
+		total_count += visible_objects.count[ entity_type ];
+	}
+
+	const U32 batch_start = U32( U64( total_count ) * batch_index / _num_batches );
+	const U32 batch_end = U32( U64( total_count ) * ( batch_index + 1 ) / _num_batches );
+
+	const RenderEntityBase*const*const objects = visible_objects.ptrs.raw();
+
+	U32 type_start = 0;
+	for( UINT entity_type = 0; entity_type < RE_MAX; entity_type++ )
+	{
+		const U32 type_end = type_start + visible_objects.count[ entity_type ];
+
+		const U32 first = largest( type_start, batch_start );
+		const U32 last = smallest( type_end, batch_end );
+
+		RenderCallback * render_callback = render_callbacks.code[ entity_type ];
+
+		if( first < last && render_callback )
+		{
+			const RenderEntityBase*const*const entities_to_draw
+				= objects + visible_objects.offset[ entity_type ] + ( first - type_start );
+
+			RenderCallbackParameters	parameters(
+				TSpan< const RenderEntityBase* >(
+					(const RenderEntityBase**)entities_to_draw
+					, last - first
+				)
+				, cascade_index
+				, voxel_cascade_bounds
+				, scene_view
+				, render_path
+				, render_context
+				, renderer_settings
+				, render_callbacks.data[ entity_type ]
+				);
+
+			const ERet result = (*render_callback)( parameters );
+			if( mxFAILED( result ) ) {
+				_results[ batch_index ] = result;
+				return;
+			}
+		}
+
+		type_start = type_end;
+	}
+}
+
+ERet NwParallelCommandRecorder::MergeBatches( NGpu::NwRenderContext & render_context )
+{
+	for( U32 i = 0; i < _num_batches; i++ )
+	{
+		mxDO(_results[i]);
+		mxDO(render_context.Append( *_contexts[i] ));
+	}
+	return ALL_OK;
+}
+
+namespace
+{
+	class RecordBatchesJob: NonCopyable
+	{
+		NwParallelCommandRecorder &	_recorder;
+
+		const RenderEntityList &	_visible_objects;
+		const U32					_cascade_index;
+		const CubeMLf				_voxel_cascade_bounds;
+		const NwCameraView &		_scene_view;
+		const RenderCallbacks &		_render_callbacks;
+		const RenderPath &			_render_path;
+		const RrGlobalSettings &	_renderer_settings;
+
+	public:
+		RecordBatchesJob(
+			NwParallelCommandRecorder & recorder
+			, const RenderEntityList& visible_objects
+			, const U32 cascade_index
+			, const CubeMLf& voxel_cascade_bounds
+			, const NwCameraView& scene_view
+			, const RenderCallbacks& render_callbacks
+			, const RenderPath& render_path
+			, const RrGlobalSettings& renderer_settings
+			)
+			: _recorder( recorder )
+			, _visible_objects( visible_objects )
+			, _cascade_index( cascade_index )
+			, _voxel_cascade_bounds( voxel_cascade_bounds )
+			, _scene_view( scene_view )
+			, _render_callbacks( render_callbacks )
+			, _render_path( render_path )
+			, _renderer_settings( renderer_settings )
+		{
+		}
+
+		ERet Run( const NwThreadContext& context, int start, int end )
+		{
+			for( int batch_index = start; batch_index < end; batch_index++ )
+			{
+				_recorder.RecordBatch(
+					batch_index
+					, _visible_objects
+					, _cascade_index
+					, _voxel_cascade_bounds
+					, _scene_view
+					, _render_callbacks
+					, _render_path
+					, _renderer_settings
+					);
+			}
+			return ALL_OK;
+		}
+	};
+}//namespace
+
+ERet RenderVisibleObjectsInParallel(
+	const RenderEntityList& visible_objects
+	, const U32 cascade_index
+	, const CubeMLf& voxel_cascade_bounds
+
+	, const NwCameraView& scene_view
+
+	, const RenderCallbacks& render_callbacks
+	, const RenderPath& render_path
+	, const RrGlobalSettings& renderer_settings
+
+	, NwParallelCommandRecorder & recorder
+	, NwJobSchedulerI & job_scheduler
+	, NGpu::NwRenderContext & render_context
+	)
+{
+	mxASSERT( recorder.NumBatches() > 0 );
+
+	JobID	h_job_record_batches;
+	nwCREATE_JOB(h_job_record_batches
+		, job_scheduler
+		, -1, recorder.NumBatches()
+		, JobPriority_High
+		, RecordBatchesJob
+		, recorder
+		, visible_objects
+		, cascade_index
+		, voxel_cascade_bounds
+		, scene_view
+		, render_callbacks
+		, render_path
+		, renderer_settings
+		);
+
+	job_scheduler.waitFor( h_job_record_batches );
+
+	return recorder.MergeBatches( render_context );
+}
+
+
 
 ERet ViewState_From_ScenePass(
 							  NGpu::ViewState &viewState
@@ -394,53 +626,335 @@ ERet submitModelWithCustomTransform(
 }
 
 
-ERet renderMeshInstances(
-	const RenderCallbackParameters& parameters
-	)
+namespace
 {
-	tbPROFILE_FUNCTION;
-UNDONE;
-#if 0
-	GL::NwRenderContext & render_context = parameters.render_context;
+	static bool _CanBeInstanced( const MeshInstance& model )
+	{
+		// skinned models cannot be instanced: the skinning matrices are bound to the same slot
+		if( !( model._flags & MF_UseInstancing ) || model.joint_matrices.num() ) {
+			return false;
+		}
+		// the shaders must read the world matrices from the instance data
+		for( UINT i = 0; i < model.materials.num(); i++ )
+		{
+			if( !model.materials[i]->supportsInstancing() ) {
+				return false;
+			}
+		}
+		return true;
+	}
 
-	//
-	const ScenePassInfo scene_pass_info = parameters.render_path->getPassInfo( ScenePasses::FillGBuffer );
-	const TbPassMaskT	allowed_passes_mask = BIT(scene_pass_info.filter_index);
+	/// the distance from the camera, used for sorting instanced batches front-to-back
+	static F32 _GetModelDepth( const MeshInstance& model, const NwCameraView& scene_view )
+	{
+		return Plane_PointDistance(
+			scene_view.near_clipping_plane,
+			M44_getTranslation( model.transform->getLocalToWorld4x4Matrix() )
+			);
+	}
 
-	//
-	const NwCameraView& scene_view = parameters.camera;
+	/// non-negative floats keep their order when compared as integers
+	static U32 _DepthToSortKeyBits( const F32 depth )
+	{
+		_flint	u;
+		u.f = largest( depth, 0.0f );
+		return u.i;
+	}
 
-	//const NwFloatingOrigin	floating_origin = *parameters.floating_origin;
+	struct InstancedModel
+	{
+		const MeshInstance *	model;
+		F32						depth;	//!< distance to the near clipping plane
+	};
 
-	//
-	const MeshInstance*const*const mesh_instances = (const MeshInstance**) parameters.objects;
+	/// orders the models by their meshes, then by their materials, so that models which can be batched are adjacent,
+	/// and then front-to-back, so that each batch contains models at similar depths
+	static bool _LessByMeshAndMaterials( const MeshInstance* a, const MeshInstance* b )
+	{
+		if( a->mesh._ptr != b->mesh._ptr ) {
+			return a->mesh._ptr < b->mesh._ptr;
+		}
+		// the meshes are the same, so are the numbers of submeshes
+		for( UINT i = 0; i < a->materials.num(); i++ )
+		{
+			if( a->materials[i] != b->materials[i] ) {
+				return a->materials[i] < b->materials[i];
+			}
+		}
+		return false;
+	}
 
-	//
-	for( int i = 0; i < parameters.count; i++ )
+	static bool _LessByMeshMaterialsAndDepth( const InstancedModel& a, const InstancedModel& b )
 	{
-		const MeshInstance& mesh_instance = *(mesh_instances[ i ]);
+		if( _LessByMeshAndMaterials( a.model, b.model ) ) {
+			return true;
+		}
+		if( _LessByMeshAndMaterials( b.model, a.model ) ) {
+			return false;
+		}
+		return a.depth < b.depth;
+	}
 
-		const V3f	min_corner_pos_relative_to_floating_origin = floating_origin.getRelativePosition(
-			V3d::fromXYZ( mesh_instance.transform->local_to_world.GetTranslation() )
-			);
+	static bool _HaveSameMeshAndMaterials( const MeshInstance& a, const MeshInstance& b )
+	{
+		return !_LessByMeshAndMaterials( &a, &b ) && !_LessByMeshAndMaterials( &b, &a );
+	}
 
-		M44f relative_local_to_world_matrix = mesh_instance.transform->local_to_world;
-		relative_local_to_world_matrix.setTranslation( min_corner_pos_relative_to_floating_origin );
+	/// returns the number of draw calls needed to render one instance of the model
+	static U32 _CountDrawCallsPerModel( const MeshInstance& model, const TbPassMaskT allowed_passes_mask )
+	{
+		U32	num_draw_calls = 0;
+		for( UINT submesh_index = 0; submesh_index < model.mesh->submeshes.num(); submesh_index++ )
+		{
+			const TSpan< const MaterialPass > passes = model.materials[ submesh_index ]->passes;
+			for( UINT pass_index = 0; pass_index < passes._count; pass_index++ )
+			{
+				num_draw_calls += ( BIT(passes._data[ pass_index ].filter_index) & allowed_passes_mask ) ? 1 : 0;
+			}
+		}
+		return num_draw_calls;
+	}
+
+	/// Submits one instanced draw call per submesh and material pass.
+	/// All models must have the same mesh and materials and be sorted front-to-back.
+	/// Each command list starts with binding the instance data and ends with the draw call
+	/// (Benchmark_InstancedSubmission() relies on this).
+	static ERet _SubmitInstancedBatch(
+		const InstancedModel* models
+		, const UINT num_models
+		, M44f * instance_world_matrices	// scratch memory, must hold nwRENDERER_MAX_INSTANCES_PER_BATCH matrices
+		, NGpu::NwRenderContext & render_context
+		, const TbPassMaskT allowed_passes_mask
+		)
+	{
+		mxASSERT(num_models > 0 && num_models <= nwRENDERER_MAX_INSTANCES_PER_BATCH);
+
+		const Rendering::RenderSystemData& render_system = *Rendering::Globals::g_data;
+
+		// The transforms are copied into the command buffer for each draw call,
+		// because the sorted draw calls cannot rely on the constant buffer contents left by other draw calls.
+		// NOTE: the constants are copied from scratch memory, not from the command buffer which may be reallocated.
+		for( UINT i = 0; i < num_models; i++ ) {
+			instance_world_matrices[i] = M44_Transpose( models[i].model->transform->getLocalToWorld4x4Matrix() );
+		}
+		const U32 instance_data_size = sizeof(instance_world_matrices[0]) * num_models;
+
+		// the batch is drawn when its nearest model would be drawn
+		const U32 sort_key_from_depth = _DepthToSortKeyBits( models[0].depth );
 
 		//
-		Rendering::submitModelWithCustomTransform(
-			mesh_instance
-			, relative_local_to_world_matrix
-			, scene_view
-			, render_context
-			, allowed_passes_mask
+		const MeshInstance& first_model = *models[0].model;
+		const NwMesh& mesh = *first_model.mesh;
+
+		NGpu::Cmd_Draw	dip;
+
+		SetMeshState(
+			dip
+			, mesh
 			);
 
-	}//For each visible terrain chunk.
-#endif
+		dip.SetInstanceCount( (U16) num_models );
+
+		//
+		const Submesh* submeshes = mesh.submeshes.raw();
+		const UINT num_submeshes = mesh.submeshes.num();
+
+		for( UINT submesh_index = 0; submesh_index < num_submeshes; submesh_index++ )
+		{
+			const Submesh& submesh = submeshes[ submesh_index ];
+
+			const Material& material = *first_model.materials[ submesh_index ];
+			mxASSERT(material.supportsInstancing());
+
+			const TSpan< const MaterialPass > passes = material.passes;
+			//
+			for( UINT pass_index = 0; pass_index < passes._count; pass_index++ )
+			{
+				const MaterialPass& pass = passes._data[ pass_index ];
+
+				if( BIT(pass.filter_index) & allowed_passes_mask )
+				{
+					// a separate command list for each draw call
+					NGpu::RenderCommandWriter	cmd_writer( render_context );
+
+					mxDO(NGpu::Commands::BindCBufferDataCopy(
+						instance_world_matrices
+						, instance_data_size
+						, render_context._command_buffer
+						, render_system._global_uniforms.model_instances.slot
+						, render_system._global_uniforms.model_instances.handle
+
+						, (MX_DEVELOPER ? "cb_model_instances" : nil)
+						));
+
+					mxDO(material.command_buffer.PushCopyInto(
+						render_context._command_buffer
+						));
+
+					// the program variant which reads the world matrices from G_ModelInstances
+					const HProgram instanced_program = material.instanced_programs[ pass_index ];
+					dip.program = instanced_program;
+
+					//
+					dip.base_vertex = 0;
+					dip.vertex_count = 0;
+					dip.start_index = submesh.start_index;
+					dip.index_count = submesh.index_count;
+
+					IF_DEBUG dip.src_loc = GFX_SRCFILE_STRING;
+
+					//
+					cmd_writer.SetRenderState(
+						pass.render_state
+						);
+
+					//
+					NGpu::Commands::Draw(
+						dip
+						, render_context._command_buffer
+						);
+
+					cmd_writer.SubmitCommandsWithSortKey(
+						NGpu::buildSortKey(
+							pass.draw_order,
+							instanced_program,
+							sort_key_from_depth
+						) + NGpu::FIRST_SORT_KEY
+
+						nwDBG_CMD_SRCFILE_STRING
+					);
+				}//If pass is allowed
+			}//For each pass.
+		}//For each submesh.
+
+		return ALL_OK;
+	}
+}//namespace
+
+ERet submitModelsWithInstancing(
+	const TSpan< const MeshInstance* >& models
+	, const NwCameraView& scene_view
+	, NGpu::NwRenderContext & render_context
+	, AllocatorI & scratchpad
+	, const TbPassMaskT allowed_passes_mask
+	, NwInstancingStats *stats_ /*= nil*/
+	)
+{
+	ScopedTimer	timer;
+
+	NwInstancingStats	stats;
+	mxZERO_OUT(stats);
+	stats.num_models = models._count;
+
+	// Submit the models which cannot be instanced as usual
+	// and gather the rest for sorting.
+	DynamicArray< InstancedModel >	models_to_instance( scratchpad );
+	mxDO(models_to_instance.reserve( models._count ));
+
+	for( UINT i = 0; i < models._count; i++ )
+	{
+		const MeshInstance& model = *models._data[i];
+
+		if( _CanBeInstanced( model ) )
+		{
+			InstancedModel	instanced_model;
+			instanced_model.model = &model;
+			instanced_model.depth = _GetModelDepth( model, scene_view );
+			models_to_instance.AddFastUnsafe( instanced_model );
+		}
+		else
+		{
+			mxDO(submitModel(
+				model
+				, scene_view
+				, render_context
+				, allowed_passes_mask
+				));
+
+			const U32 num_draw_calls = _CountDrawCallsPerModel( model, allowed_passes_mask );
+			stats.num_draw_calls += num_draw_calls;
+			stats.num_draw_calls_without_instancing += num_draw_calls;
+		}
+	}
+
+	// Group the models by (mesh, materials); different LoDs use different meshes, so they end up in different batches.
+	std::sort( models_to_instance.begin(), models_to_instance.end(), &_LessByMeshMaterialsAndDepth );
+
+	DynamicArray< M44f >	instance_world_matrices( scratchpad );
+	if( models_to_instance.num() )
+	{
+		mxDO(instance_world_matrices.setNum( nwRENDERER_MAX_INSTANCES_PER_BATCH ));
+	}
+
+	const InstancedModel* sorted_models = models_to_instance.raw();
+	const UINT num_sorted_models = models_to_instance.num();
+
+	UINT group_start = 0;
+	while( group_start < num_sorted_models )
+	{
+		const MeshInstance& first_model = *sorted_models[ group_start ].model;
+
+		UINT group_end = group_start + 1;
+		while( group_end < num_sorted_models && _HaveSameMeshAndMaterials( first_model, *sorted_models[ group_end ].model ) ) {
+			group_end++;
+		}
+
+		const U32 num_draw_calls_per_model = _CountDrawCallsPerModel( first_model, allowed_passes_mask );
+
+		// split large groups into batches which fit into the instance constant buffer
+		for( UINT batch_start = group_start; batch_start < group_end; batch_start += nwRENDERER_MAX_INSTANCES_PER_BATCH )
+		{
+			const UINT batch_size = smallest( group_end - batch_start, (UINT)nwRENDERER_MAX_INSTANCES_PER_BATCH );
+
+			mxDO(_SubmitInstancedBatch(
+				sorted_models + batch_start
+				, batch_size
+				, instance_world_matrices.raw()
+				, render_context
+				, allowed_passes_mask
+				));
+
+			stats.num_batches++;
+			stats.num_draw_calls += num_draw_calls_per_model;
+		}
+
+		stats.num_instanced_models += group_end - group_start;
+		stats.num_draw_calls_without_instancing += num_draw_calls_per_model * ( group_end - group_start );
+
+		group_start = group_end;
+	}
+
+	stats.submit_time_usec = timer.ElapsedMicroseconds();
+
+	if( stats_ ) {
+		*stats_ = stats;
+	}
+
 	return ALL_OK;
 }
 
+
+ERet renderMeshInstances(
+	const RenderCallbackParameters& parameters
+	)
+{
+	tbPROFILE_FUNCTION;
+
+	// the models with the same mesh and materials are batched,
+	// the others (e.g. skinned models) are submitted one by one
+	const TSpan< const MeshInstance* > mesh_instances(
+		(const MeshInstance**) parameters.entities._data
+		, parameters.entities._count
+		);
+
+	return submitModelsWithInstancing(
+		mesh_instances
+		, parameters.scene_view
+		, parameters.render_context
+		, MemoryHeaps::temporary()
+		);
+}
+
 ERet SubmitEntities(
 	const NwCameraView& scene_view
 	, const RenderEntityList& visible_entities
@@ -482,3 +996,394 @@ ERet SubmitEntities(
 }
 
 }//namespace Rendering
+
+/*
+-----------------------------------------------------------------------------
+	UNIT TESTS
+-----------------------------------------------------------------------------
+*/
+
+#if MX_DEVELOPER
+
+namespace Rendering
+{
+namespace
+{
+	/// records the per-object constants and a draw command for each entity (like _SubmitMeshWithInstanceData())
+	static ERet recordBenchmarkDrawItems( const RenderCallbackParameters& parameters )
+	{
+		NGpu::NwRenderContext & render_context = parameters.render_context;
+
+		for( UINT i = 0; i < parameters.entities._count; i++ )
+		{
+			// the fake entity pointers encode the entity indices
+			const U32 entity_index = U32( size_t( parameters.entities._data[i] ) / 16 );
+
+			NGpu::RenderCommandWriter	cmd_writer( render_context );
+
+			M44f	local_to_world_matrix = M44_Identity();
+			local_to_world_matrix.v3 = V4f::set( F32( entity_index ), 0, 0, 1 );
+			mxDO(render_context._command_buffer.WriteCopy( &local_to_world_matrix, sizeof(local_to_world_matrix), 15 ));
+
+			NGpu::Cmd_Draw	dip;
+			dip.program.id = entity_index % 64;
+			dip.index_count = 36;
+			mxDO(NGpu::Commands::Draw( dip, render_context._command_buffer ));
+
+			// sort by the program, then by the depth
+			const U32 depth_bits = ( entity_index * 2654435761u ) >> 8;
+			cmd_writer.SubmitCommandsWithSortKey( NGpu::buildSortKey( dip.program, depth_bits ) );
+		}
+
+		return ALL_OK;
+	}
+
+	static bool haveSameSortKeys( const NGpu::NwRenderContext& a, const NGpu::NwRenderContext& b )
+	{
+		if( a._sort_items.num() != b._sort_items.num() ) {
+			return false;
+		}
+		for( U32 i = 0; i < a._sort_items.num(); i++ )
+		{
+			if( a._sort_items[i].sortkey != b._sort_items[i].sortkey ) {
+				return false;
+			}
+		}
+		return true;
+	}
+}//namespace
+
+ERet Benchmark_ParallelCommandRecording(
+	NwJobSchedulerI & job_scheduler
+	, AllocatorI & allocator
+	, const U32 num_batches
+	)
+{
+	enum { MAX_DRAW_ITEMS = 200000, BYTES_PER_DRAW_ITEM = 256 };
+
+	RenderCallbacks	render_callbacks;
+	render_callbacks.code[ RE_MeshInstance ] = &recordBenchmarkDrawItems;
+
+	// the data is not used by the benchmark callback
+	const NwCameraView		scene_view;
+	const RenderPath		render_path;
+	const RrGlobalSettings	renderer_settings;
+
+	NGpu::NwRenderContext	single_threaded_context( allocator );
+	mxDO(single_threaded_context.reserve( MAX_DRAW_ITEMS, MAX_DRAW_ITEMS * BYTES_PER_DRAW_ITEM ));
+
+	NGpu::NwRenderContext	merged_context( allocator );
+	mxDO(merged_context.reserve( MAX_DRAW_ITEMS, MAX_DRAW_ITEMS * BYTES_PER_DRAW_ITEM ));
+
+	NwParallelCommandRecorder	recorder( allocator );
+	mxDO(recorder.Initialize(
+		num_batches
+		, MAX_DRAW_ITEMS / num_batches + 1
+		, ( MAX_DRAW_ITEMS / num_batches + 1 ) * BYTES_PER_DRAW_ITEM
+		));
+
+	DynamicArray< NGpu::NwRenderContext::SortItem >	items_sorted_by_std_sort( allocator );
+
+	ptPRINT("Command recording: %u batches", num_batches);
+
+	const U32 draw_item_counts[] = { 50000, 100000, 200000 };
+
+	for( UINT iTest = 0; iTest < mxCOUNT_OF(draw_item_counts); iTest++ )
+	{
+		const U32 num_draw_items = draw_item_counts[ iTest ];
+
+		RenderEntityList	visible_objects( allocator );
+		mxDO(visible_objects.ptrs.setNum( num_draw_items ));
+		for( U32 i = 0; i < num_draw_items; i++ ) {
+			visible_objects.ptrs[i] = (const RenderEntityBase*) ( size_t( i ) * 16 );
+		}
+		visible_objects.count[ RE_MeshInstance ] = num_draw_items;
+
+		// single-threaded recording
+		single_threaded_context.reset();
+
+		ScopedTimer	timer;
+		RenderVisibleObjects(
+			visible_objects, 0, CubeMLf::fromCenterRadius(CV3f(0), 0)
+			, scene_view, render_callbacks, render_path, renderer_settings
+			, single_threaded_context
+			);
+		const U64 single_threaded_recording_usec = timer.ElapsedMicroseconds();
+
+		// the comparison sort, used before
+		mxDO(Arrays::Copy( items_sorted_by_std_sort, single_threaded_context._sort_items ));
+		timer.Reset();
+		std::sort( items_sorted_by_std_sort.begin(), items_sorted_by_std_sort.end(),
+			[]( const NGpu::NwRenderContext::SortItem& a, const NGpu::NwRenderContext::SortItem& b ) {
+				return a.sortkey < b.sortkey;
+			});
+		const U64 std_sort_usec = timer.ElapsedMicroseconds();
+
+		timer.Reset();
+		single_threaded_context.Sort();
+		const U64 radix_sort_usec = timer.ElapsedMicroseconds();
+
+		// parallel recording
+		merged_context.reset();
+
+		timer.Reset();
+		mxDO(RenderVisibleObjectsInParallel(
+			visible_objects, 0, CubeMLf::fromCenterRadius(CV3f(0), 0)
+			, scene_view, render_callbacks, render_path, renderer_settings
+			, recorder, job_scheduler
+			, merged_context
+			));
+		const U64 parallel_recording_usec = timer.ElapsedMicroseconds();
+
+		timer.Reset();
+		merged_context.Sort();
+		const U64 merged_radix_sort_usec = timer.ElapsedMicroseconds();
+
+		for( U32 i = 0; i < num_draw_items; i++ )
+		{
+			mxENSURE( items_sorted_by_std_sort[i].sortkey == single_threaded_context._sort_items[i].sortkey
+				, ERR_UNKNOWN_ERROR, "the radix sort results differ from std::sort() at %u", i );
+		}
+		mxENSURE( haveSameSortKeys( single_threaded_context, merged_context )
+			, ERR_UNKNOWN_ERROR, "the parallel recording results differ" );
+
+		ptPRINT("	%u draw items: recording: %.3f ms -> %.3f ms (parallel), sorting: %.3f ms (std::sort) -> %.3f ms (radix), total: %.3f ms -> %.3f ms",
+			num_draw_items,
+			single_threaded_recording_usec * 1e-3f, parallel_recording_usec * 1e-3f,
+			std_sort_usec * 1e-3f, radix_sort_usec * 1e-3f,
+			( single_threaded_recording_usec + std_sort_usec ) * 1e-3f,
+			( parallel_recording_usec + merged_radix_sort_usec ) * 1e-3f
+			);
+	}
+
+	return ALL_OK;
+}
+
+namespace
+{
+	static bool _LessByMatrixBits( const M44f& a, const M44f& b )
+	{
+		return memcmp( &a, &b, sizeof(a) ) < 0;
+	}
+
+	/// Decodes the recorded instanced draw calls as the GPU would see them
+	/// and checks that each model is drawn exactly once per submesh and pass, with its own world matrix,
+	/// using the instanced shader programs, and that the batches are sorted by the nearest model.
+	static ERet validateInstancedDrawCalls(
+		const TSpan< const MeshInstance* >& models
+		, const NwCameraView& scene_view
+		, const NGpu::NwRenderContext& render_context
+		, AllocatorI & allocator
+		)
+	{
+		const Rendering::RenderSystemData& render_system = *Rendering::Globals::g_data;
+
+		// the world matrices as uploaded into G_ModelInstances (transposed)
+		DynamicArray< M44f >	expected_matrices( allocator );
+		DynamicArray< M44f >	drawn_matrices( allocator );
+
+		for( UINT i = 0; i < models._count; i++ )
+		{
+			const MeshInstance& model = *models._data[i];
+			const U32 num_draw_calls = _CountDrawCallsPerModel( model, ~0 );
+			for( UINT iDrawCall = 0; iDrawCall < num_draw_calls; iDrawCall++ ) {
+				mxDO(expected_matrices.add( M44_Transpose( model.transform->getLocalToWorld4x4Matrix() ) ));
+			}
+		}
+		mxDO(drawn_matrices.reserve( expected_matrices.num() ));
+
+		const char* command_buffer_start = render_context._command_buffer.getStart();
+
+		for( UINT iItem = 0; iItem < render_context._sort_items.num(); iItem++ )
+		{
+			const NGpu::NwRenderContext::SortItem& item = render_context._sort_items[ iItem ];
+			const char* command_list_start = command_buffer_start + item.start;
+
+			// the command list starts with binding the instance data...
+			U32	input_slot, resource_handle;
+
+			const NGpu::Cmd_BindPushConstants& bind_instances_cmd = *(NGpu::Cmd_BindPushConstants*) command_list_start;
+			mxENSURE( bind_instances_cmd.decode( &input_slot, &resource_handle ) == NGpu::CMD_BIND_PUSH_CONSTANTS
+				&& input_slot == render_system._global_uniforms.model_instances.slot
+				, ERR_UNKNOWN_ERROR, "draw call #%u doesn't bind the instance data", iItem );
+
+			const TSpan< BYTE > instance_data = bind_instances_cmd.GetConstantsData();
+			const M44f* instance_matrices = (M44f*) instance_data._data;
+			const U32 num_instances = instance_data._count / sizeof(M44f);
+
+			// ...and ends with the draw call
+			const NGpu::Cmd_Draw& draw_cmd = *(NGpu::Cmd_Draw*) ( command_list_start + item.size - sizeof(NGpu::Cmd_Draw) );
+			mxENSURE( draw_cmd.decode( &input_slot, &resource_handle ) == NGpu::CMD_DRAW
+				, ERR_UNKNOWN_ERROR, "command list #%u doesn't end with a draw call", iItem );
+
+			const U32 instance_count = resource_handle;
+			mxENSURE( num_instances > 0 && num_instances <= nwRENDERER_MAX_INSTANCES_PER_BATCH
+				&& instance_count == num_instances
+				, ERR_UNKNOWN_ERROR, "draw call #%u: %u instances, but %u matrices", iItem, instance_count, num_instances );
+
+			// the shader must read the world matrices from the instance data
+			bool uses_instanced_program = false;
+			const MeshInstance& first_model = *models._data[0];
+			for( UINT iMaterial = 0; iMaterial < first_model.materials.num(); iMaterial++ )
+			{
+				const Material& material = *first_model.materials[ iMaterial ];
+				for( UINT iPass = 0; iPass < material.instanced_programs.num(); iPass++ ) {
+					uses_instanced_program |= ( draw_cmd.program == material.instanced_programs[ iPass ] );
+				}
+			}
+			mxENSURE( uses_instanced_program, ERR_UNKNOWN_ERROR, "draw call #%u doesn't use an instanced program", iItem );
+
+			// the batch is sorted by its nearest model
+			F32 nearest_depth = BIG_NUMBER;
+			for( UINT i = 0; i < num_instances; i++ )
+			{
+				const M44f local_to_world_matrix = M44_Transpose( instance_matrices[i] );
+				const F32 depth = Plane_PointDistance( scene_view.near_clipping_plane, M44_getTranslation( local_to_world_matrix ) );
+				nearest_depth = smallest( nearest_depth, depth );
+
+				mxDO(drawn_matrices.add( instance_matrices[i] ));
+			}
+			mxENSURE( U32( item.sortkey - NGpu::FIRST_SORT_KEY ) == _DepthToSortKeyBits( nearest_depth )
+				, ERR_UNKNOWN_ERROR, "draw call #%u is not sorted by depth", iItem );
+		}
+
+		// every model must be drawn with its own transform, once per submesh and pass
+		mxENSURE( drawn_matrices.num() == expected_matrices.num()
+			, ERR_UNKNOWN_ERROR, "drawn %u instances, expected %u", drawn_matrices.num(), expected_matrices.num() );
+
+		std::sort( expected_matrices.begin(), expected_matrices.end(), &_LessByMatrixBits );
+		std::sort( drawn_matrices.begin(), drawn_matrices.end(), &_LessByMatrixBits );
+
+		mxENSURE( 0 == memcmp( expected_matrices.raw(), drawn_matrices.raw(), expected_matrices.num() * sizeof(M44f) )
+			, ERR_UNKNOWN_ERROR, "the instances are drawn with wrong transforms" );
+
+		return ALL_OK;
+	}
+
+	static ERet runInstancedSubmissionTests(
+		const TSpan< const MeshInstance* >& models
+		, const NwCameraView& scene_view
+		, NGpu::NwRenderContext & render_context
+		, AllocatorI & allocator
+		)
+	{
+		const U32 model_counts[] = { 1000, 10000, 40000 };
+
+		for( UINT iTest = 0; iTest < mxCOUNT_OF(model_counts); iTest++ )
+		{
+			const TSpan< const MeshInstance* > models_to_draw( models._data, smallest( model_counts[ iTest ], models._count ) );
+
+			// one draw call per model (and per submesh and pass)
+			render_context.reset();
+
+			ScopedTimer	timer;
+			for( UINT i = 0; i < models_to_draw._count; i++ )
+			{
+				mxDO(submitModel( *models_to_draw._data[i], scene_view, render_context ));
+			}
+			const U64 submit_time_usec = timer.ElapsedMicroseconds();
+			const U32 num_draw_calls = render_context._sort_items.num();
+
+			// instanced draw calls
+			render_context.reset();
+
+			NwInstancingStats	stats;
+			mxDO(submitModelsWithInstancing(
+				models_to_draw
+				, scene_view
+				, render_context
+				, allocator
+				, ~0
+				, &stats
+				));
+
+			mxENSURE( stats.num_draw_calls == render_context._sort_items.num()
+				&& stats.num_draw_calls_without_instancing == num_draw_calls
+				&& stats.num_instanced_models == models_to_draw._count
+				, ERR_UNKNOWN_ERROR, "the instancing stats are wrong" );
+
+			mxDO(validateInstancedDrawCalls(
+				models_to_draw
+				, scene_view
+				, render_context
+				, allocator
+				));
+
+			ptPRINT("	%u models: draw calls: %u -> %u (%u batches), submit time: %.3f ms -> %.3f ms",
+				models_to_draw._count,
+				num_draw_calls, stats.num_draw_calls, stats.num_batches,
+				submit_time_usec * 1e-3f, stats.submit_time_usec * 1e-3f
+				);
+		}
+
+		return ALL_OK;
+	}
+}//namespace
+
+ERet Benchmark_InstancedSubmission(
+	NwMesh & mesh
+	, const TSpan< Material* const >& submesh_materials
+	, const NwCameraView& scene_view
+	, AllocatorI & allocator
+	)
+{
+	enum { MAX_MODELS = 40000, BYTES_PER_DRAW_CALL = 512 };
+
+	mxENSURE( submesh_materials._count == mesh.submeshes.num()
+		, ERR_INVALID_PARAMETER, "need a material for each submesh" );
+
+	for( UINT i = 0; i < submesh_materials._count; i++ )
+	{
+		mxENSURE( submesh_materials._data[i]->supportsInstancing()
+			, ERR_INVALID_PARAMETER, "the materials must support instancing (e.g. use 'model.fx')" );
+	}
+
+	DynamicArray< RrTransform >		transforms( allocator );
+	mxDO(transforms.setNum( MAX_MODELS ));
+
+	DynamicArray< MeshInstance* >	models( allocator );
+	mxDO(models.reserve( MAX_MODELS ));
+
+	NwRandom	rng( 12345 );
+
+	for( UINT i = 0; i < MAX_MODELS; i++ )
+	{
+		M44f	local_to_world_matrix = M44_Identity();
+		local_to_world_matrix.v3 = V4f::set(
+			rng.GetRandomFloatInRange( -500, +500 ),
+			rng.GetRandomFloatInRange( -500, +500 ),
+			rng.GetRandomFloatInRange( -500, +500 ),
+			1
+			);
+		transforms[i].setLocalToWorldMatrix( local_to_world_matrix );
+
+		MeshInstance* model = mxNEW( allocator, MeshInstance );
+		model->mesh = &mesh;
+		model->transform = &transforms[i];
+		model->_flags = MF_UseInstancing;
+		mxDO(Arrays::Copy( model->materials, submesh_materials ));
+		models.AddFastUnsafe( model );
+	}
+
+	NGpu::NwRenderContext	render_context( allocator );
+	mxDO(render_context.reserve( MAX_MODELS * 4, MAX_MODELS * 4 * BYTES_PER_DRAW_CALL ));
+
+	ptPRINT("Instanced submission: %u submeshes", mesh.submeshes.num());
+
+	const ERet result = runInstancedSubmissionTests(
+		TSpan< const MeshInstance* >( (const MeshInstance**) models.raw(), models.num() )
+		, scene_view
+		, render_context
+		, allocator
+		);
+
+	for( UINT i = 0; i < models.num(); i++ ) {
+		mxDELETE( models[i], allocator );
+	}
+
+	return result;
+}
+
+}//namespace Rendering
+
+#endif // MX_DEVELOPER
@@ -5,6 +5,7 @@
 #include <Rendering/Public/Core/RenderPipeline.h>
 #include <Rendering/Public/Scene/SceneRenderer.h>
 
+class NwJobSchedulerI;
 
 namespace Rendering
 {
@@ -131,6 +132,107 @@ void RenderVisibleObjects(
 	, NGpu::NwRenderContext & render_context
 	);
 
+///
+/// Render contexts for recording draw commands on worker threads, one context per batch of entities.
+/// The contexts are kept between frames to avoid reallocating command buffers.
+///
+class NwParallelCommandRecorder: NonCopyable
+{
+public:
+	enum { MAX_BATCHES = 64 };
+
+private:
+	NGpu::NwRenderContext *	_contexts[ MAX_BATCHES ];
+	ERet					_results[ MAX_BATCHES ];	//!< the results of the render callbacks in each batch
+	U32						_num_batches;
+	AllocatorI &			_allocator;
+
+public:
+	NwParallelCommandRecorder( AllocatorI & allocator );
+	~NwParallelCommandRecorder();
+
+	/// the number of batches should be a small multiple of the number of worker threads
+	ERet Initialize(
+		const U32 num_batches
+		, const U32 num_sort_items_per_batch
+		, const U32 command_buffer_size_per_batch
+		);
+
+	void Shutdown();
+
+	U32 NumBatches() const { return _num_batches; }
+
+public:	// Internal
+	/// called from worker threads, the result is stored for MergeBatches()
+	void RecordBatch(
+		const U32 batch_index
+		, const RenderEntityList& visible_objects
+		, const U32 cascade_index
+		, const CubeMLf& voxel_cascade_bounds
+		, const NwCameraView& scene_view
+		, const RenderCallbacks& render_callbacks
+		, const RenderPath& render_path
+		, const RrGlobalSettings& renderer_settings
+		);
+
+	/// appends the recorded batches in order and returns the first error
+	ERet MergeBatches( NGpu::NwRenderContext & render_context );
+};
+
+/// The same as RenderVisibleObjects(), but the visible objects are split into batches
+/// which are recorded into separate render contexts on worker threads
+/// and then appended to the given context (in order, so the result doesn't depend on threading).
+/// NOTE: the render callbacks must be thread-safe and write only into the given render context.
+ERet RenderVisibleObjectsInParallel(
+	const RenderEntityList& visible_objects
+	, const U32 cascade_index
+	, const CubeMLf& voxel_cascade_bounds
+
+	, const NwCameraView& scene_view
+
+	, const RenderCallbacks& render_callbacks
+	, const RenderPath& render_path
+	, const RrGlobalSettings& renderer_settings
+
+	, NwParallelCommandRecorder & recorder
+	, NwJobSchedulerI & job_scheduler
+	, NGpu::NwRenderContext & render_context
+	);
+
 ERet ViewState_From_ScenePass( NGpu::ViewState &viewState, const ScenePassData& passData, const NwViewport& viewport );
 
 }//namespace Rendering
+
+/*
+-----------------------------------------------------------------------------
+	UNIT TESTS
+-----------------------------------------------------------------------------
+*/
+
+#if MX_DEVELOPER
+
+namespace Rendering
+{
+	/// Records synthetic draw items (per-object constants + draw command) for 50K, 100K and 200K entities
+	/// on one thread and with NwParallelCommandRecorder, sorts them with std::sort() and NwRenderContext::Sort(),
+	/// prints the recording and sorting times and checks that the sorted keys are identical.
+	ERet Benchmark_ParallelCommandRecording(
+		NwJobSchedulerI & job_scheduler
+		, AllocatorI & allocator
+		, const U32 num_batches = 16
+		);
+
+	/// Submits 1K, 10K and 40K copies of the given mesh, scattered randomly, one draw call per model
+	/// and with submitModelsWithInstancing(), prints the draw call counts and submission times.
+	/// Decodes the recorded instanced draw calls and checks the bound instance transforms,
+	/// the instanced shader programs and the front-to-back sort keys.
+	/// NOTE: the renderer must be initialized and the materials must support instancing.
+	ERet Benchmark_InstancedSubmission(
+		NwMesh & mesh
+		, const TSpan< Material* const >& submesh_materials
+		, const NwCameraView& scene_view
+		, AllocatorI & allocator
+		);
+}//namespace Rendering
+
+#endif // MX_DEVELOPER
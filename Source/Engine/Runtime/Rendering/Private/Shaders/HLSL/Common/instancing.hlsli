@@ -0,0 +1,27 @@
+// transforms for instanced draw calls: the world matrices are taken from G_ModelInstances
+// instead of the per-object constants (G_PerObject)
+#ifndef NW_INSTANCING_HLSLI
+#define NW_INSTANCING_HLSLI
+
+#include <Shared/nw_shared_globals.h>
+
+/// returns the local-to-world matrix of the instance being drawn
+row_major float4x4 GetInstanceWorldMatrix( in uint instance_id )
+{
+	return g_model_instance_matrices[ instance_id ];
+}
+
+/// Transforms the position from local to world space.
+float4 Instance_Pos_Local_To_World( in row_major float4x4 world_matrix, in float4 local_position )
+{
+	return mul( world_matrix, local_position );
+}
+
+/// Transforms the direction from local to view space.
+float3 Instance_Dir_Local_To_View( in row_major float4x4 world_matrix, in float3 local_direction )
+{
+	const float3 world_direction = mul( (float3x3)world_matrix, local_direction );
+	return normalize(mul( (float3x3)g_view_matrix, world_direction ));
+}
+
+#endif // NW_INSTANCING_HLSLI
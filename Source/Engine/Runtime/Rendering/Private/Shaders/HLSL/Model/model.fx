@@ -18,6 +18,12 @@ feature ENABLE_NORMAL_MAP
 	default = 0
 }
 
+// the world matrix is read from G_ModelInstances, see submitModelsWithInstancing()
+feature USE_INSTANCING
+{
+	default = 0
+}
+
 //
 
 samplers
@@ -33,6 +39,7 @@ samplers
 
 #include <Shared/nw_shared_globals.h>
 #include <Common/transform.hlsli>
+#include <Common/instancing.hlsli>
 
 #include "_VS.h"	// DrawVertex
 #include "_PS.h"
@@ -67,10 +74,21 @@ struct VS_Out
 */
 void main_VS(
 			 in DrawVertex vertex_in,	// idDrawVert
+#if USE_INSTANCING
+			 in uint instance_id: SV_InstanceID,
+#endif
 			 out VS_Out vertex_out_
 			 )
 {
+#if USE_INSTANCING
+	const row_major float4x4 world_matrix = GetInstanceWorldMatrix( instance_id );
+
+	vertex_out_.position = Transform_Position_World_To_Clip(
+		Instance_Pos_Local_To_World( world_matrix, float4( vertex_in.position, 1 ) )
+		);
+#else
 	vertex_out_.position = Pos_Local_To_Clip( float4( vertex_in.position, 1 ) );
+#endif
 	
 	//
 	vertex_out_.texCoord = vertex_in.texCoord;
@@ -79,8 +97,13 @@ void main_VS(
 	const float3 local_normal = UnpackVertexNormal( vertex_in.normal );
 	const float3 local_tangent = -UnpackVertexNormal( vertex_in.tangent );
 	
+#if USE_INSTANCING
+	vertex_out_.normal_in_view_space = Instance_Dir_Local_To_View( world_matrix, local_normal );
+	vertex_out_.tangent_in_view_space = Instance_Dir_Local_To_View( world_matrix, local_tangent );
+#else
 	vertex_out_.normal_in_view_space = Dir_Local_To_View( local_normal ).xyz;
 	vertex_out_.tangent_in_view_space = Dir_Local_To_View( local_tangent ).xyz;
+#endif
 	vertex_out_.bitangent_in_view_space = cross(
 		vertex_out_.tangent_in_view_space,
 		vertex_out_.normal_in_view_space
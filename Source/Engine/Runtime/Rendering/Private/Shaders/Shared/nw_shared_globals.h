@@ -198,6 +198,19 @@ DECLARE_CBUFFER( G_SkinningData, 4 )
 
 //===========================================================
 
+// must be synced with nwRENDERER_MAX_INSTANCES_PER_BATCH in app code!
+#define MAX_INSTANCES_PER_BATCH	(256)
+
+/// World matrices of the models in an instanced draw call (indexed by SV_InstanceID),
+/// read by the shaders with the USE_INSTANCING feature (see Common/instancing.hlsli).
+/// Shares the slot with skinning data: skinned models are never instanced.
+DECLARE_CBUFFER( G_ModelInstances, 4 )
+{
+	row_major float4x4	g_model_instance_matrices[MAX_INSTANCES_PER_BATCH];
+};
+
+//===========================================================
+
 /// this constant buffer should be updated very rarely
 DECLARE_CBUFFER( G_VoxelTerrain, 7 )
 {
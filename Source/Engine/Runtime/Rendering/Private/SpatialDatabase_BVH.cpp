@@ -0,0 +1,1107 @@
+// Hierarchical Visibility Culling
+#include <bx/string.h>
+#include <Base/Base.h>
+#pragma hdrstop
+
+#include <algorithm>	// std::nth_element()
+#include <immintrin.h>
+
+#include <Base/Math/BoundingVolumes/ViewFrustum.h>
+#include <Base/Math/Random.h>
+#include <Core/Tasking/TaskSchedulerInterface.h>
+#include <Core/Util/ScopedTimer.h>
+
+#include <Rendering/Public/Settings.h>
+#include <Rendering/Public/Globals.h>
+#include <Rendering/Public/Scene/Entity.h>
+#include <Rendering/Public/Scene/SpatialDatabase.h>
+#include <Rendering/Public/Scene/OcclusionBuffer.h>
+#include <Rendering/Private/SpatialDatabase_Private.h>
+
+
+/// MSVC allows using AVX intrinsics without /arch:AVX, other compilers need the target to be enabled.
+#if defined(__AVX__) || (defined(_MSC_VER) && _MSC_VER >= 1700)
+	#define SPATIAL_DATABASE_WITH_AVX	(1)
+#else
+	#define SPATIAL_DATABASE_WITH_AVX	(0)
+#endif
+
+namespace Rendering
+{
+namespace
+{
+enum
+{
+	/// the number of bounding boxes tested at once
+	PACKET_SIZE = 8,
+
+	/// the subtree is split until it has no more entities
+	MAX_ENTITIES_IN_LEAF = PACKET_SIZE * 4,
+
+	/// the entities added or moved out of their leaves are tested without the hierarchy,
+	/// the hierarchy is rebuilt when there are too many of them (or too many removed entities)
+	MIN_UNSORTED_ENTITIES_FOR_REBUILD = 256,
+
+	/// the balanced tree of 2^32 entities is not deeper
+	MAX_TREE_DEPTH = 64,
+
+	ALL_CLIP_PLANES_MASK = (1 << VF_CLIP_PLANES) - 1,
+};
+
+/// the bounding boxes (relative to the floating origin) of 8 entities in SoA layout,
+/// the empty lanes have inside-out boxes which are always culled
+struct EntityPacket
+{
+	F32				mins[3][PACKET_SIZE];
+	F32				maxs[3][PACKET_SIZE];
+	TaggedPointer	pointers[PACKET_SIZE];	//!< nil in empty lanes
+	U32				handles[PACKET_SIZE];	//!< INDEX_NONE in empty lanes
+};
+
+/// a node of the bounding volume hierarchy, the nodes are stored in depth-first order
+struct Node
+{
+	AABBf	bounds;			//!< the bounds of the entities in the subtree when the tree was built
+	U32		first_packet;	//!< the packets of all entities in the subtree are contiguous
+	U32		num_packets;
+	U32		second_child;	//!< the first child immediately follows its parent; 0 if this is a leaf
+};
+
+struct EntityRecord
+{
+	AABBf			relative_bounds;	//!< relative to the floating origin
+	TaggedPointer	pointer;			//!< nil if the handle is free
+	U32				location;			//!< packet index * PACKET_SIZE + lane; or the next free handle if this handle is free
+};
+
+/// the visible entities are sorted by their types (counting/bucket sort)
+struct EntityListWriter
+{
+	const RenderEntityBase **	dst_buffer;
+	U32		write_offsets[RE_MAX];	//!< offset of the first entity of the given type
+	U32		written_count[RE_MAX];	//!< the number of written entities of the given type
+
+public:
+	ERet begin( RenderEntityList &visible_entities_, const U32 (&object_counts)[RE_MAX], const U32 total_count )
+	{
+		// reserve space for max number of objects
+		mxDO(visible_entities_.ptrs.setNum( total_count ));
+		dst_buffer = visible_entities_.ptrs.raw();
+
+		Build_Offset_Table_1D( object_counts, write_offsets );
+		mxZERO_OUT_ARRAY( written_count );
+		return ALL_OK;
+	}
+
+	mxFORCEINLINE void write( const TaggedPointer& tagged_pointer )
+	{
+		const RenderEntityBase *entity_pointer;
+		ERenderEntity entity_type;
+		decodeTaggedPointer( tagged_pointer, &entity_pointer, &entity_type );
+
+		const UINT dest_index = write_offsets[ entity_type ] + written_count[ entity_type ]++;
+		dst_buffer[ dest_index ] = entity_pointer;
+	}
+
+	/// writes the entities in the given lanes of the packet
+	mxFORCEINLINE void writeLanes( const EntityPacket& packet, U32 lane_mask )
+	{
+		while( lane_mask )
+		{
+			const U32 lane = TakeNextTrailingBit32( lane_mask );
+			write( packet.pointers[ lane ] );
+		}
+	}
+
+	/// writes all entities in the packets (e.g. the packets of a node inside the frustum)
+	void writePackets( const EntityPacket* packets, const U32 num_packets )
+	{
+		for( U32 iPacket = 0; iPacket < num_packets; iPacket++ )
+		{
+			const EntityPacket& packet = packets[ iPacket ];
+			for( U32 lane = 0; lane < PACKET_SIZE; lane++ )
+			{
+				if( packet.pointers[ lane ].u ) {
+					write( packet.pointers[ lane ] );
+				}
+			}
+		}
+	}
+
+	void end( RenderEntityList &visible_entities_ ) const
+	{
+		TCopyStaticArray( visible_entities_.count, written_count );
+		TCopyStaticArray( visible_entities_.offset, write_offsets );
+	}
+};
+
+///
+/// Returns false if the box is outside the frustum,
+/// otherwise clears the bits of the planes which the box is completely in front of
+/// (the children of this node need not be tested against them).
+///
+static mxFORCEINLINE
+bool testNodeAgainstFrustum( const AABBf& aabb, const ViewFrustum& view_frustum, U32 &plane_mask_ )
+{
+	U32 plane_mask = plane_mask_;
+	while( plane_mask )
+	{
+		const U32 iPlane = TakeNextTrailingBit32( plane_mask );
+
+		// the same as in ViewFrustum::Classify()
+		const UINT nV = view_frustum.signs[ iPlane ];
+
+		const CV3f nVertex(
+			( nV & 1 ) ? aabb.min_corner.x : aabb.max_corner.x,
+			( nV & 2 ) ? aabb.min_corner.y : aabb.max_corner.y,
+			( nV & 4 ) ? aabb.min_corner.z : aabb.max_corner.z
+			);
+		const CV3f pVertex(
+			( nV & 1 ) ? aabb.max_corner.x : aabb.min_corner.x,
+			( nV & 2 ) ? aabb.max_corner.y : aabb.min_corner.y,
+			( nV & 4 ) ? aabb.max_corner.z : aabb.min_corner.z
+			);
+
+		if( Plane_PointDistance( view_frustum.planes[ iPlane ], pVertex ) < 0.0f ) {
+			return false;
+		}
+		if( Plane_PointDistance( view_frustum.planes[ iPlane ], nVertex ) > 0.0f ) {
+			plane_mask_ &= ~( 1u << iPlane );
+		}
+	}
+	return true;
+}
+
+/// Returns the mask of lanes which are not outside the given planes.
+static U32 testPacketAgainstFrustum_Scalar( const EntityPacket& packet, const ViewFrustum& view_frustum, U32 plane_mask )
+{
+	U32 outside_mask = 0;
+	while( plane_mask )
+	{
+		const U32 iPlane = TakeNextTrailingBit32( plane_mask );
+
+		const V4f& plane = view_frustum.planes[ iPlane ];
+		const UINT nV = view_frustum.signs[ iPlane ];
+
+		// the positive vertices of all boxes
+		const F32* px = ( nV & 1 ) ? packet.maxs[0] : packet.mins[0];
+		const F32* py = ( nV & 2 ) ? packet.maxs[1] : packet.mins[1];
+		const F32* pz = ( nV & 4 ) ? packet.maxs[2] : packet.mins[2];
+
+		for( U32 lane = 0; lane < PACKET_SIZE; lane++ )
+		{
+			const float distance = plane.x * px[lane] + plane.y * py[lane] + plane.z * pz[lane] + plane.w;
+			outside_mask |= U32( distance < 0.0f ) << lane;
+		}
+	}
+	return ~outside_mask & ( ( 1u << PACKET_SIZE ) - 1 );
+}
+
+#if SPATIAL_DATABASE_WITH_AVX
+
+/// Tests 8 boxes against each plane at once.
+static U32 testPacketAgainstFrustum_AVX( const EntityPacket& packet, const ViewFrustum& view_frustum, U32 plane_mask )
+{
+	const __m256 zero = _mm256_setzero_ps();
+	__m256 outside = zero;
+
+	while( plane_mask )
+	{
+		const U32 iPlane = TakeNextTrailingBit32( plane_mask );
+
+		const V4f& plane = view_frustum.planes[ iPlane ];
+		const UINT nV = view_frustum.signs[ iPlane ];
+
+		const __m256 px = _mm256_loadu_ps( ( nV & 1 ) ? packet.maxs[0] : packet.mins[0] );
+		const __m256 py = _mm256_loadu_ps( ( nV & 2 ) ? packet.maxs[1] : packet.mins[1] );
+		const __m256 pz = _mm256_loadu_ps( ( nV & 4 ) ? packet.maxs[2] : packet.mins[2] );
+
+		// the same order of operations as in the scalar code (no FMA), so that the results are identical
+		__m256 distance = _mm256_mul_ps( _mm256_set1_ps( plane.x ), px );
+		distance = _mm256_add_ps( distance, _mm256_mul_ps( _mm256_set1_ps( plane.y ), py ) );
+		distance = _mm256_add_ps( distance, _mm256_mul_ps( _mm256_set1_ps( plane.z ), pz ) );
+		distance = _mm256_add_ps( distance, _mm256_set1_ps( plane.w ) );
+
+		outside = _mm256_or_ps( outside, _mm256_cmp_ps( distance, zero, _CMP_LT_OQ ) );
+	}
+	return ~U32( _mm256_movemask_ps( outside ) ) & ( ( 1u << PACKET_SIZE ) - 1 );
+}
+
+#endif // SPATIAL_DATABASE_WITH_AVX
+
+/// Returns the mask of lanes intersecting the box (incl. touching).
+static U32 testPacketAgainstBox( const EntityPacket& packet, const AABBf& aabb )
+{
+	U32 intersecting_mask = 0;
+	for( U32 lane = 0; lane < PACKET_SIZE; lane++ )
+	{
+		const bool intersects =
+			packet.mins[0][lane] <= aabb.max_corner.x && packet.mins[1][lane] <= aabb.max_corner.y && packet.mins[2][lane] <= aabb.max_corner.z
+			&& packet.maxs[0][lane] >= aabb.min_corner.x && packet.maxs[1][lane] >= aabb.min_corner.y && packet.maxs[2][lane] >= aabb.min_corner.z
+			;
+		intersecting_mask |= U32( intersects ) << lane;
+	}
+	return intersecting_mask;
+}
+
+/// Returns the lanes (from the given mask) whose boxes are not hidden by the occluders.
+static U32 testPacketAgainstOcclusionBuffer( const EntityPacket& packet, U32 lane_mask, const NwOcclusionBuffer& occlusion_buffer )
+{
+	U32 visible_mask = 0;
+	while( lane_mask )
+	{
+		const U32 lane = TakeNextTrailingBit32( lane_mask );
+
+		// the empty lanes pass the frustum test if no planes are tested
+		if( !packet.pointers[ lane ].u ) {
+			continue;
+		}
+
+		const AABBf aabb = AABBf::make(
+			CV3f( packet.mins[0][lane], packet.mins[1][lane], packet.mins[2][lane] ),
+			CV3f( packet.maxs[0][lane], packet.maxs[1][lane], packet.maxs[2][lane] )
+			);
+		visible_mask |= U32( occlusion_buffer.IsBoxVisible( aabb ) ) << lane;
+	}
+	return visible_mask;
+}
+
+struct BuildPrimitive
+{
+	AABBf	bounds;	//!< copied for faster access
+	U32		handle;
+};
+
+///
+struct SpatialDatabase_BVH: SpatialDatabaseI
+{
+mxREMOVE_THIS
+NwFloatingOrigin	_floating_origin;
+
+	/// the total number of entities of the given type
+	U32				_object_counts[RE_MAX];
+	U32				_num_live_entities;
+
+	/// indexed by entity handles
+	DynamicArray< EntityRecord >	_entities;
+	U32				_first_free_handle;
+
+	/// the bounding volume hierarchy, the root is the first node
+	DynamicArray< Node >			_nodes;
+
+	/// [0, _num_tree_packets) - the packets in the leaves of the tree,
+	/// then the unsorted packets of the entities added after the tree was built
+	DynamicArray< EntityPacket >	_packets;
+
+	/// the leaf of each packet in the tree, for checking if the updated bounds still fit into the leaf
+	DynamicArray< U32 >				_leaf_of_packet;
+
+	U32				_num_tree_packets;
+	U32				_num_unsorted_entities;	//!< in the packets after the tree, without empty lanes
+	U32				_num_removed_from_tree;	//!< the number of empty lanes in the tree
+
+	bool			_use_AVX;
+
+	AllocatorI &			_storage;
+
+public:
+	SpatialDatabase_BVH( AllocatorI & storage )
+		: _entities( storage )
+		, _nodes( storage )
+		, _packets( storage )
+		, _leaf_of_packet( storage )
+		, _storage( storage )
+	{
+		mxZERO_OUT_ARRAY(_object_counts);
+		_num_live_entities = 0;
+		_first_free_handle = INDEX_NONE;
+		_num_tree_packets = 0;
+		_num_unsorted_entities = 0;
+		_num_removed_from_tree = 0;
+
+		PtSystemInfo	sysInfo;
+		mxGetSystemInfo( sysInfo );
+		_use_AVX = SPATIAL_DATABASE_WITH_AVX && sysInfo.cpu.has_AVX;
+	}
+
+	bool isValidHandle( const HRenderEntity handle ) const
+	{
+		return handle.id < _entities.num() && _entities[ handle.id ].pointer.u != 0;
+	}
+
+	virtual bool ContainsEntity( const HRenderEntity entity_handle ) const override
+	{
+		return isValidHandle( entity_handle );
+	}
+
+	virtual HRenderEntity AddEntity(
+		const void* new_entity,
+		ERenderEntity entity_type,
+		const AABBd& aabb_in_world_space
+		) override
+	{
+		mxASSERT2(IS_16_BYTE_ALIGNED(new_entity), "need space to pack entity type into lowest bits of pointer");
+		mxASSERT_PTR(new_entity);
+
+		U32 new_handle = _first_free_handle;
+		if( new_handle != INDEX_NONE )
+		{
+			_first_free_handle = _entities[ new_handle ].location;
+		}
+		else
+		{
+			new_handle = _entities.num();
+			if( mxFAILED(_entities.setNum( new_handle + 1 )) ) {
+				return HRenderEntity::MakeNilHandle();
+			}
+		}
+
+		EntityRecord &record = _entities[ new_handle ];
+		record.relative_bounds = _floating_origin.getRelativeAABB( aabb_in_world_space );
+		record.pointer = encodeTaggedPointer( new_entity, entity_type );
+
+		if( mxFAILED(addUnsortedEntity( new_handle )) )
+		{
+			record.pointer.u = 0;
+			record.location = _first_free_handle;
+			_first_free_handle = new_handle;
+			return HRenderEntity::MakeNilHandle();
+		}
+
+		++_object_counts[ entity_type ];
+		++_num_live_entities;
+
+		rebuildIfNeeded();
+
+		return HRenderEntity( new_handle );
+	}
+
+	virtual void RemoveEntity(
+		const HRenderEntity entity_handle
+		) override
+	{
+		mxASSERT(isValidHandle(entity_handle));
+
+		EntityRecord &record = _entities[ entity_handle.id ];
+
+		const RenderEntityBase *entity_pointer;
+		ERenderEntity entity_type;
+		decodeTaggedPointer( record.pointer, &entity_pointer, &entity_type );
+
+		--_object_counts[ entity_type ];
+		--_num_live_entities;
+
+		removeFromPacket( record.location );
+
+		record.pointer.u = 0;
+		record.location = _first_free_handle;
+		_first_free_handle = entity_handle.id;
+
+		rebuildIfNeeded();
+	}
+
+	virtual void UpdateEntityBounds(
+		const HRenderEntity entity_handle,
+		const AABBd& bounding_box_in_world_space
+	) override
+	{
+		mxASSERT(isValidHandle(entity_handle));
+
+		EntityRecord &record = _entities[ entity_handle.id ];
+		record.relative_bounds = _floating_origin.getRelativeAABB( bounding_box_in_world_space );
+
+		const U32 packet_index = record.location / PACKET_SIZE;
+
+		// the tree is never refitted: the entity stays in its leaf only while it fits into the leaf's bounds
+		if( packet_index < _num_tree_packets
+			&& !_nodes[ _leaf_of_packet[ packet_index ] ].bounds.contains( record.relative_bounds ) )
+		{
+			const U32 old_location = record.location;
+			if( mxFAILED(addUnsortedEntity( entity_handle.id )) ) {
+				return;
+			}
+			removeFromPacket( old_location );
+			rebuildIfNeeded();
+			return;
+		}
+
+		setLane( record.location, record );
+	}
+
+public:	// Query
+
+	virtual ERet GetEntitiesIntersectingViewFrustum(
+		RenderEntityList &visible_entities_
+		, const ViewFrustum& view_frustum
+	) const override
+	{
+		return cullHierarchy( visible_entities_, view_frustum, nil );
+	}
+
+	virtual ERet GetEntitiesVisibleFromView(
+		RenderEntityList &visible_entities_
+		, const ViewFrustum& view_frustum
+		, const NwOcclusionBuffer& occlusion_buffer
+	) const override
+	{
+		return cullHierarchy( visible_entities_, view_frustum, &occlusion_buffer );
+	}
+
+	virtual ERet GetEntitiesIntersectingBox(
+		RenderEntityList &visible_entities_
+		, const AABBf& aabb
+	) const override
+	{
+		EntityListWriter	writer;
+		mxDO(writer.begin( visible_entities_, _object_counts, _num_live_entities ));
+
+		const EntityPacket* packets = _packets.raw();
+
+		if( _nodes.num() )
+		{
+			U32		stack[ MAX_TREE_DEPTH ];
+			U32		stack_size = 0;
+
+			stack[ stack_size++ ] = 0;
+
+			while( stack_size )
+			{
+				const U32 node_index = stack[ --stack_size ];
+				const Node& node = _nodes[ node_index ];
+
+				if( !aabb.intersects( node.bounds ) ) {
+					continue;
+				}
+
+				if( aabb.contains( node.bounds ) )
+				{
+					writer.writePackets( packets + node.first_packet, node.num_packets );
+				}
+				else if( !node.second_child )
+				{
+					for( U32 i = 0; i < node.num_packets; i++ )
+					{
+						const EntityPacket& packet = packets[ node.first_packet + i ];
+						writer.writeLanes( packet, testPacketAgainstBox( packet, aabb ) );
+					}
+				}
+				else
+				{
+					mxASSERT( stack_size + 2 <= mxCOUNT_OF(stack) );
+					stack[ stack_size++ ] = node.second_child;
+					stack[ stack_size++ ] = node_index + 1;
+				}
+			}
+		}
+
+		for( U32 i = _num_tree_packets; i < _packets.num(); i++ )
+		{
+			const EntityPacket& packet = packets[ i ];
+			writer.writeLanes( packet, testPacketAgainstBox( packet, aabb ) );
+		}
+
+		writer.end( visible_entities_ );
+
+		return ALL_OK;
+	}
+
+	virtual ERet GetEntitiesIntersectingViewFrustums(
+		RenderEntityList * visible_entities_[]
+		, const ViewFrustum* view_frustums
+		, const U32 num_views
+		, NwJobSchedulerI & job_scheduler
+	) const override
+	{
+		/// culls one view per job, the queries don't modify the database
+		class CullViewsJob: NonCopyable
+		{
+			const SpatialDatabase_BVH &	_database;
+			RenderEntityList **			_visible_entities;
+			const ViewFrustum *			_view_frustums;
+
+		public:
+			CullViewsJob(
+				const SpatialDatabase_BVH& database
+				, RenderEntityList ** visible_entities
+				, const ViewFrustum* view_frustums
+				)
+				: _database( database )
+				, _visible_entities( visible_entities )
+				, _view_frustums( view_frustums )
+			{
+			}
+
+			ERet Run( const NwThreadContext& context, int start, int end )
+			{
+				for( int iView = start; iView < end; iView++ )
+				{
+					mxDO(_database.GetEntitiesIntersectingViewFrustum( *_visible_entities[ iView ], _view_frustums[ iView ] ));
+				}
+				return ALL_OK;
+			}
+		};
+
+		JobID	h_job_cull_views;
+		nwCREATE_JOB(h_job_cull_views
+			, job_scheduler
+			, -1, num_views
+			, JobPriority_High
+			, CullViewsJob
+			, *this, visible_entities_, view_frustums
+			);
+
+		job_scheduler.waitFor( h_job_cull_views );
+
+		return ALL_OK;
+	}
+
+	virtual void GetStats(Stats &stats_) const override
+	{
+		stats_.total_object_count = _num_live_entities;
+	}
+
+	virtual AllocatorI& GetStorage() const override
+	{
+		return _storage;
+	}
+
+	virtual void DebugDraw( ADebugDraw & renderer
+		, const NwView3D& main_camera_view
+		, int flags /*= ~0*/
+		) const override
+	{
+		tbPROFILE_FUNCTION;
+
+		renderer.PushState();
+
+		// enable depth testing
+		NwRenderState * renderState = nil;
+		Resources::Load(renderState, MakeAssetID("default"));
+		if( renderState ) {
+			renderer.SetStates( *renderState );
+		}
+
+		if( flags & DebugDrawFlags::DrawBoundingBoxes )
+		{
+			for( UINT i = 0; i < _entities.num(); i++ )
+			{
+				if( _entities[i].pointer.u ) {
+					renderer.DrawAABB( _entities[i].relative_bounds, RGBAf::GREEN );
+				}
+			}
+		}
+
+		if( flags & DebugDrawFlags::DrawHierarchy )
+		{
+			for( UINT i = 0; i < _nodes.num(); i++ )
+			{
+				if( !_nodes[i].second_child ) {
+					renderer.DrawAABB( _nodes[i].bounds, RGBAf::YELLOW );
+				}
+			}
+		}
+
+		renderer.PopState();
+	}
+
+private:
+	/// hierarchical frustum culling, optionally followed by occlusion culling of the nodes and the entities
+	ERet cullHierarchy(
+		RenderEntityList &visible_entities_
+		, const ViewFrustum& view_frustum
+		, const NwOcclusionBuffer* occlusion_buffer
+		) const
+	{
+		EntityListWriter	writer;
+		mxDO(writer.begin( visible_entities_, _object_counts, _num_live_entities ));
+
+		const EntityPacket* packets = _packets.raw();
+
+		if( _nodes.num() )
+		{
+			struct StackEntry
+			{
+				U32	node_index;
+				U32	plane_mask;	//!< the planes which intersect the parent node
+			};
+			StackEntry	stack[ MAX_TREE_DEPTH ];
+			U32			stack_size = 0;
+
+			stack[ stack_size++ ] = { 0, ALL_CLIP_PLANES_MASK };
+
+			while( stack_size )
+			{
+				const StackEntry entry = stack[ --stack_size ];
+				const Node& node = _nodes[ entry.node_index ];
+
+				U32 plane_mask = entry.plane_mask;
+				if( !testNodeAgainstFrustum( node.bounds, view_frustum, plane_mask ) ) {
+					continue;
+				}
+
+				if( occlusion_buffer && !occlusion_buffer->IsBoxVisible( node.bounds ) ) {
+					continue;
+				}
+
+				if( !plane_mask && !occlusion_buffer )
+				{
+					// the subtree is completely inside the frustum
+					writer.writePackets( packets + node.first_packet, node.num_packets );
+				}
+				else if( !node.second_child )
+				{
+					testPackets( packets + node.first_packet, node.num_packets, view_frustum, plane_mask, occlusion_buffer, writer );
+				}
+				else
+				{
+					mxASSERT( stack_size + 2 <= mxCOUNT_OF(stack) );
+					stack[ stack_size++ ] = { node.second_child, plane_mask };
+					stack[ stack_size++ ] = { entry.node_index + 1, plane_mask };
+				}
+			}
+		}
+
+		// the entities outside the hierarchy
+		testPackets( packets + _num_tree_packets, _packets.num() - _num_tree_packets, view_frustum, ALL_CLIP_PLANES_MASK, occlusion_buffer, writer );
+
+		writer.end( visible_entities_ );
+
+		return ALL_OK;
+	}
+
+	void testPackets(
+		const EntityPacket* packets
+		, const U32 num_packets
+		, const ViewFrustum& view_frustum
+		, const U32 plane_mask
+		, const NwOcclusionBuffer* occlusion_buffer
+		, EntityListWriter & writer
+		) const
+	{
+		if( occlusion_buffer )
+		{
+			for( U32 i = 0; i < num_packets; i++ )
+			{
+#if SPATIAL_DATABASE_WITH_AVX
+				const U32 lanes_in_frustum = _use_AVX
+					? testPacketAgainstFrustum_AVX( packets[i], view_frustum, plane_mask )
+					: testPacketAgainstFrustum_Scalar( packets[i], view_frustum, plane_mask );
+#else
+				const U32 lanes_in_frustum = testPacketAgainstFrustum_Scalar( packets[i], view_frustum, plane_mask );
+#endif // SPATIAL_DATABASE_WITH_AVX
+				writer.writeLanes( packets[i], testPacketAgainstOcclusionBuffer( packets[i], lanes_in_frustum, *occlusion_buffer ) );
+			}
+			return;
+		}
+
+#if SPATIAL_DATABASE_WITH_AVX
+		if( _use_AVX )
+		{
+			for( U32 i = 0; i < num_packets; i++ ) {
+				writer.writeLanes( packets[i], testPacketAgainstFrustum_AVX( packets[i], view_frustum, plane_mask ) );
+			}
+			return;
+		}
+#endif // SPATIAL_DATABASE_WITH_AVX
+
+		for( U32 i = 0; i < num_packets; i++ ) {
+			writer.writeLanes( packets[i], testPacketAgainstFrustum_Scalar( packets[i], view_frustum, plane_mask ) );
+		}
+	}
+
+	void setLane( const U32 location, const EntityRecord& record )
+	{
+		EntityPacket &packet = _packets[ location / PACKET_SIZE ];
+		const U32 lane = location % PACKET_SIZE;
+
+		packet.mins[0][lane] = record.relative_bounds.min_corner.x;
+		packet.mins[1][lane] = record.relative_bounds.min_corner.y;
+		packet.mins[2][lane] = record.relative_bounds.min_corner.z;
+		packet.maxs[0][lane] = record.relative_bounds.max_corner.x;
+		packet.maxs[1][lane] = record.relative_bounds.max_corner.y;
+		packet.maxs[2][lane] = record.relative_bounds.max_corner.z;
+		packet.pointers[lane] = record.pointer;
+	}
+
+	void clearLane( const U32 location )
+	{
+		EntityPacket &packet = _packets[ location / PACKET_SIZE ];
+		const U32 lane = location % PACKET_SIZE;
+
+		// inside-out boxes are culled by any plane
+		for( UINT axis = 0; axis < 3; axis++ )
+		{
+			packet.mins[axis][lane] = +AABBf::MaxBoundsExtents();
+			packet.maxs[axis][lane] = -AABBf::MaxBoundsExtents();
+		}
+		packet.pointers[lane].u = 0;
+		packet.handles[lane] = INDEX_NONE;
+	}
+
+	ERet addEmptyPacket()
+	{
+		mxDO(_packets.setNum( _packets.num() + 1 ));
+		const U32 first_location = ( _packets.num() - 1 ) * PACKET_SIZE;
+		for( U32 lane = 0; lane < PACKET_SIZE; lane++ ) {
+			clearLane( first_location + lane );
+		}
+		return ALL_OK;
+	}
+
+	/// appends the entity to the packets outside the tree
+	ERet addUnsortedEntity( const U32 handle )
+	{
+		const U32 location = _num_tree_packets * PACKET_SIZE + _num_unsorted_entities;
+		if( location / PACKET_SIZE == _packets.num() ) {
+			mxDO(addEmptyPacket());
+		}
+
+		EntityRecord &record = _entities[ handle ];
+		record.location = location;
+
+		setLane( location, record );
+		_packets[ location / PACKET_SIZE ].handles[ location % PACKET_SIZE ] = handle;
+
+		++_num_unsorted_entities;
+		return ALL_OK;
+	}
+
+	void removeFromPacket( const U32 location )
+	{
+		if( location < _num_tree_packets * PACKET_SIZE )
+		{
+			// leave a hole in the leaf
+			clearLane( location );
+			++_num_removed_from_tree;
+			return;
+		}
+
+		// keep the unsorted entities packed: move the last one into the hole
+		const U32 last_location = _num_tree_packets * PACKET_SIZE + _num_unsorted_entities - 1;
+		if( location != last_location )
+		{
+			const U32 moved_handle = _packets[ last_location / PACKET_SIZE ].handles[ last_location % PACKET_SIZE ];
+			EntityRecord &moved_record = _entities[ moved_handle ];
+			moved_record.location = location;
+			setLane( location, moved_record );
+			_packets[ location / PACKET_SIZE ].handles[ location % PACKET_SIZE ] = moved_handle;
+		}
+		clearLane( last_location );
+		--_num_unsorted_entities;
+
+		if( last_location % PACKET_SIZE == 0 ) {
+			_packets.setNum( _packets.num() - 1 );
+		}
+	}
+
+	void rebuildIfNeeded()
+	{
+		const U32 num_unsorted = _num_unsorted_entities + _num_removed_from_tree;
+		if( num_unsorted > largest( (U32) MIN_UNSORTED_ENTITIES_FOR_REBUILD, _num_live_entities / 4 ) )
+		{
+			if( mxFAILED(rebuild()) ) {
+				ptWARN("Failed to rebuild the spatial database of %u entities", _num_live_entities);
+			}
+		}
+	}
+
+	ERet rebuild()
+	{
+		BuildPrimitive *	primitives;
+		mxTRY_ALLOC_SCOPED( primitives, largest( _num_live_entities, 1u ), _storage );
+
+		U32 num_primitives = 0;
+		for( U32 handle = 0; handle < _entities.num(); handle++ )
+		{
+			const EntityRecord& record = _entities[ handle ];
+			if( record.pointer.u )
+			{
+				BuildPrimitive &primitive = primitives[ num_primitives++ ];
+				primitive.bounds = record.relative_bounds;
+				primitive.handle = handle;
+			}
+		}
+		mxASSERT( num_primitives == _num_live_entities );
+
+		const U32 max_leaves = ( num_primitives / ( MAX_ENTITIES_IN_LEAF / 2 ) ) + 1;
+		const U32 max_packets = ( num_primitives / PACKET_SIZE ) + max_leaves;
+
+		_nodes.RemoveAll();
+		_packets.RemoveAll();
+		_leaf_of_packet.RemoveAll();
+		mxDO(_nodes.reserve( max_leaves * 2 ));
+		mxDO(_packets.reserve( max_packets ));
+		mxDO(_leaf_of_packet.reserve( max_packets ));
+
+		_num_tree_packets = 0;
+		_num_unsorted_entities = 0;
+		_num_removed_from_tree = 0;
+
+		if( num_primitives )
+		{
+			AABBf	center_bounds;
+			center_bounds.clear();
+			for( U32 i = 0; i < num_primitives; i++ ) {
+				center_bounds.addPoint( primitives[i].bounds.center() );
+			}
+			mxDO(buildSubtree( primitives, num_primitives, center_bounds ));
+		}
+
+		_num_tree_packets = _packets.num();
+
+		return ALL_OK;
+	}
+
+	/// splits at the median of the longest axis of the centers (the tree is balanced)
+	ERet buildSubtree(
+		BuildPrimitive* primitives
+		, const U32 num_primitives
+		, const AABBf& center_bounds	//!< contains the centers of the primitives, need not be tight
+		)
+	{
+		const U32 node_index = _nodes.num();
+		mxDO(_nodes.setNum( node_index + 1 ));
+
+		AABBf	bounds;
+		bounds.clear();
+
+		const U32 first_packet = _packets.num();
+		U32 second_child = 0;
+
+		const EAxis split_axis = center_bounds.LongestAxis();
+		const bool all_centers_equal = center_bounds.min_corner[ split_axis ] == center_bounds.max_corner[ split_axis ];
+
+		if( num_primitives <= MAX_ENTITIES_IN_LEAF || all_centers_equal )
+		{
+			for( U32 i = 0; i < num_primitives; i++ )
+			{
+				if( i % PACKET_SIZE == 0 )
+				{
+					mxDO(addEmptyPacket());
+					mxDO(_leaf_of_packet.add( node_index ));
+				}
+				const U32 location = ( _packets.num() - 1 ) * PACKET_SIZE + i % PACKET_SIZE;
+
+				bounds.ExpandToIncludeAABB( primitives[i].bounds );
+
+				const U32 handle = primitives[i].handle;
+				EntityRecord &record = _entities[ handle ];
+				record.location = location;
+				setLane( location, record );
+				_packets[ location / PACKET_SIZE ].handles[ location % PACKET_SIZE ] = handle;
+			}
+		}
+		else
+		{
+			// split at a multiple of the packet size to fill the packets in the leaves
+			U32 num_left = ( ( num_primitives / 2 ) + PACKET_SIZE - 1 ) & ~( PACKET_SIZE - 1 );
+			if( num_left >= num_primitives ) {
+				num_left = num_primitives / 2;
+			}
+
+			std::nth_element( primitives, primitives + num_left, primitives + num_primitives,
+				[split_axis]( const BuildPrimitive& a, const BuildPrimitive& b ) {
+					// compare the doubled centers
+					return a.bounds.min_corner[ split_axis ] + a.bounds.max_corner[ split_axis ]
+						< b.bounds.min_corner[ split_axis ] + b.bounds.max_corner[ split_axis ];
+				}
+			);
+
+			const BuildPrimitive& median = primitives[ num_left ];
+			const float split_position = ( median.bounds.min_corner[ split_axis ] + median.bounds.max_corner[ split_axis ] ) * 0.5f;
+
+			AABBf	left_center_bounds = center_bounds;
+			AABBf	right_center_bounds = center_bounds;
+			left_center_bounds.max_corner[ split_axis ] = split_position;
+			right_center_bounds.min_corner[ split_axis ] = split_position;
+
+			mxDO(buildSubtree( primitives, num_left, left_center_bounds ));
+			second_child = _nodes.num();
+			mxDO(buildSubtree( primitives + num_left, num_primitives - num_left, right_center_bounds ));
+
+			// the bounds are computed bottom-up
+			bounds = AABBf::getUnion( _nodes[ node_index + 1 ].bounds, _nodes[ second_child ].bounds );
+		}
+
+		Node &node = _nodes[ node_index ];
+		node.bounds = bounds;
+		node.first_packet = first_packet;
+		node.num_packets = _packets.num() - first_packet;
+		node.second_child = second_child;
+
+		return ALL_OK;
+	}
+};
+}//namespace
+
+SpatialDatabaseI* SpatialDatabaseI::CreateHierarchicalDatabase( AllocatorI & storage )
+{
+	return mxNEW( storage, SpatialDatabase_BVH, storage );
+}
+
+}//namespace Rendering
+
+/*
+-----------------------------------------------------------------------------
+	UNIT TESTS
+-----------------------------------------------------------------------------
+*/
+
+#if MX_DEVELOPER
+
+namespace Rendering
+{
+namespace
+{
+	enum { NUM_BENCHMARK_VIEWS = 4 };
+
+	/// the number of visible entities and the sum of their pointers for comparing the results
+	struct CullingResult
+	{
+		U32		num_visible;
+		size_t	checksum;
+	};
+
+	CullingResult summarize( const RenderEntityList& list )
+	{
+		CullingResult	result = { 0, 0 };
+		for( UINT type = 0; type < RE_MAX; type++ )
+		{
+			for( UINT i = 0; i < list.count[type]; i++ ) {
+				result.checksum += size_t( list.getObjectAt( (ERenderEntity) type, i ) ) + type;
+			}
+			result.num_visible += list.count[type];
+		}
+		return result;
+	}
+
+	/// the old way: testing each box
+	CullingResult cullBruteforce( const AABBf* boxes, const U32 num_boxes, const ViewFrustum& view_frustum )
+	{
+		CullingResult	result = { 0, 0 };
+		for( U32 i = 0; i < num_boxes; i++ )
+		{
+			if( view_frustum.IntersectsAABB( boxes[i] ) )
+			{
+				const U32 type = i % ( RE_MAX - 1 ) + 1;
+				result.checksum += size_t( i + 1 ) * 16 + type;
+				++result.num_visible;
+			}
+		}
+		return result;
+	}
+}//namespace
+
+ERet Benchmark_SpatialDatabase(
+	NwJobSchedulerI & job_scheduler
+	, AllocatorI & allocator
+	, const U32 max_entities
+	)
+{
+	const float WORLD_SIZE = 4000.0f;
+
+	// the cameras of shadow cascades look in different directions
+	ViewFrustum	view_frustums[ NUM_BENCHMARK_VIEWS ];
+	for( UINT iView = 0; iView < NUM_BENCHMARK_VIEWS; iView++ )
+	{
+		const float angle = iView * mxPI * 0.5f;
+		const V3f forward = V3f::set( sinf( angle ), 0, cosf( angle ) );
+		const V3f right = V3f::set( cosf( angle ), 0, -sinf( angle ) );
+		view_frustums[ iView ].extractFrustumPlanes_Generic(
+			CV3f(0), right, forward, V3f::set( 0, 1, 0 )
+			, DEG2RAD(30), 16.0f / 9.0f, 0.1f, WORLD_SIZE
+			);
+	}
+
+	ptPRINT("Spatial database: culling %u views, AVX: %s",
+		NUM_BENCHMARK_VIEWS, SPATIAL_DATABASE_WITH_AVX ? "yes" : "no");
+
+	for( U32 num_entities = 10000; num_entities <= max_entities; num_entities *= 10 )
+	{
+		AABBf *	boxes;
+		mxTRY_ALLOC_SCOPED( boxes, num_entities, allocator );
+
+		SpatialDatabaseI* database = SpatialDatabaseI::CreateHierarchicalDatabase( allocator );
+		mxENSURE( database, ERR_OUT_OF_MEMORY, "" );
+
+		NwRandom	rng( 12345 );
+
+		ScopedTimer	timer;
+
+		for( U32 i = 0; i < num_entities; i++ )
+		{
+			const V3f center = V3f::set(
+				rng.GetRandomFloatMinus1Plus1(), rng.GetRandomFloatMinus1Plus1(), rng.GetRandomFloatMinus1Plus1()
+				) * ( WORLD_SIZE * 0.5f );
+			const float radius = rng.GetRandomFloatInRange( 0.5f, 10.0f );
+			boxes[i] = AABBf::fromSphere( center, radius );
+
+			const AABBd box_in_world_space = AABBd::fromOther( boxes[i] );
+
+			// fake pointers to entities, never dereferenced
+			const void* entity = (const void*) ( size_t( i + 1 ) * 16 );
+			database->AddEntity( entity, ERenderEntity( i % ( RE_MAX - 1 ) + 1 ), box_in_world_space );
+		}
+		const U64 build_usec = timer.ElapsedMicroseconds();
+
+		RenderEntityList	lists_storage[ NUM_BENCHMARK_VIEWS ] = {
+			RenderEntityList( allocator ), RenderEntityList( allocator ),
+			RenderEntityList( allocator ), RenderEntityList( allocator ),
+		};
+		RenderEntityList *	lists[ NUM_BENCHMARK_VIEWS ];
+		for( UINT iView = 0; iView < NUM_BENCHMARK_VIEWS; iView++ ) {
+			lists[ iView ] = &lists_storage[ iView ];
+		}
+
+		CullingResult	reference_results[ NUM_BENCHMARK_VIEWS ];
+
+		timer.Reset();
+		for( UINT iView = 0; iView < NUM_BENCHMARK_VIEWS; iView++ ) {
+			reference_results[ iView ] = cullBruteforce( boxes, num_entities, view_frustums[ iView ] );
+		}
+		const U64 bruteforce_usec = timer.ElapsedMicroseconds();
+
+		timer.Reset();
+		for( UINT iView = 0; iView < NUM_BENCHMARK_VIEWS; iView++ ) {
+			mxDO(database->GetEntitiesIntersectingViewFrustum( *lists[ iView ], view_frustums[ iView ] ));
+		}
+		const U64 hierarchical_usec = timer.ElapsedMicroseconds();
+
+		U32 num_mismatches = 0;
+		U32 num_visible = 0;
+		for( UINT iView = 0; iView < NUM_BENCHMARK_VIEWS; iView++ )
+		{
+			const CullingResult result = summarize( *lists[ iView ] );
+			num_mismatches += ( result.num_visible != reference_results[ iView ].num_visible )
+				|| ( result.checksum != reference_results[ iView ].checksum );
+			num_visible += result.num_visible;
+		}
+
+		// the lists are already allocated
+		timer.Reset();
+		mxDO(database->GetEntitiesIntersectingViewFrustums( lists, view_frustums, NUM_BENCHMARK_VIEWS, job_scheduler ));
+		const U64 parallel_usec = timer.ElapsedMicroseconds();
+
+		for( UINT iView = 0; iView < NUM_BENCHMARK_VIEWS; iView++ )
+		{
+			const CullingResult result = summarize( *lists[ iView ] );
+			num_mismatches += ( result.num_visible != reference_results[ iView ].num_visible )
+				|| ( result.checksum != reference_results[ iView ].checksum );
+		}
+
+		ptPRINT("	%u entities: built in %u usec, %u visible; per-box: %u usec, hierarchical: %u usec (%.2fx), parallel: %u usec; mismatches: %u",
+			num_entities, (U32) build_usec, num_visible,
+			(U32) bruteforce_usec, (U32) hierarchical_usec, hierarchical_usec ? float(bruteforce_usec) / hierarchical_usec : 0.0f,
+			(U32) parallel_usec, num_mismatches);
+
+		SpatialDatabaseI::Destroy( database );
+
+		mxENSURE( num_mismatches == 0, ERR_UNKNOWN_ERROR, "the hierarchical culling results differ" );
+	}
+
+	return ALL_OK;
+}
+
+}//namespace Rendering
+
+#endif // MX_DEVELOPER
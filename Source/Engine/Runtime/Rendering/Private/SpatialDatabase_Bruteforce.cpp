@@ -10,6 +10,8 @@
 #include <Rendering/Public/Globals.h>
 #include <Rendering/Public/Scene/Entity.h>
 #include <Rendering/Public/Scene/SpatialDatabase.h>
+#include <Rendering/Public/Scene/OcclusionBuffer.h>
+#include <Rendering/Private/SpatialDatabase_Private.h>
 
 
 #define DBG_LOG	(0)
@@ -18,30 +20,6 @@ namespace Rendering
 {
 namespace
 {
-union TaggedPointer
-{
-	const void *p;
-	size_t		u;
-};
-
-static mxFORCEINLINE
-TaggedPointer encodeTaggedPointer( const void* new_entity, ERenderEntity entity_type )
-{
-	TaggedPointer	result;
-	result.p = new_entity;
-	result.u |= entity_type;
-	return result;
-}
-
-static mxFORCEINLINE
-void decodeTaggedPointer( const TaggedPointer& tagged_pointer
-						, const RenderEntityBase **entity_pointer_, ERenderEntity *entity_type_ )
-{
-	mxSTATIC_ASSERT(RE_MAX < 16);
-	*entity_pointer_	= (RenderEntityBase*) (size_t(tagged_pointer.p) & ~0xF);	// zero out the 4 lowest bits
-	*entity_type_		= ERenderEntity( tagged_pointer.u & 0xF );	// extract the 4 lowest bits
-}
-
 ///
 struct SpatialDatabase_Bruteforce: SpatialDatabaseI
 {
@@ -87,7 +65,7 @@ public:
 
 	bool isValidHandle( const HRenderEntity handle ) const
 	{
-		return _handle_alloc.IsValid( handle.id );
+		return handle.id < MAX_OBJECTS && _handle_alloc.IsValid( (U16) handle.id );
 	}
 
 	virtual bool ContainsEntity( const HRenderEntity entity_handle ) const override
@@ -166,7 +144,7 @@ public:
 
 
 		//
-		_handle_alloc.free( entity_handle.id );
+		_handle_alloc.free( (U16) entity_handle.id );
 	}
 
 	virtual void UpdateEntityBounds(
@@ -176,7 +154,7 @@ public:
 	{
 		mxASSERT(isValidHandle(entity_handle));
 
-		const UINT object_index = getObjectIndexFromHandle( entity_handle.id );
+		const UINT object_index = getObjectIndexFromHandle( (U16) entity_handle.id );
 
 		_bounding_boxes_in_world_space[ object_index ] = bounding_box_in_world_space;
 
@@ -193,6 +171,26 @@ public:
 		RenderEntityList &visible_entities_
 		, const ViewFrustum& view_frustum
 	) const override
+	{
+		return cullEntities( visible_entities_, view_frustum, nil );
+	}
+
+	///
+	virtual ERet GetEntitiesVisibleFromView(
+		RenderEntityList &visible_entities_
+		, const ViewFrustum& view_frustum
+		, const NwOcclusionBuffer& occlusion_buffer
+	) const override
+	{
+		return cullEntities( visible_entities_, view_frustum, &occlusion_buffer );
+	}
+
+	/// the occlusion test is skipped if occlusion_buffer is nil
+	ERet cullEntities(
+		RenderEntityList &visible_entities_
+		, const ViewFrustum& view_frustum
+		, const NwOcclusionBuffer* occlusion_buffer
+	) const
 	{
 		const UINT num_objects_to_test = _handle_alloc.getNumHandles();
 		//const UINT num_objects_to_test = Calculate_Sum_1D( _object_counts );
@@ -217,7 +215,8 @@ public:
 		{
 			const AABBf& bounding_box = bounding_boxes_to_test[ i ];
 
-			if( view_frustum.IntersectsAABB( bounding_box ) )
+			if( view_frustum.IntersectsAABB( bounding_box )
+				&& ( !occlusion_buffer || occlusion_buffer->IsBoxVisible( bounding_box ) ) )
 			{
 				const TaggedPointer& tagged_pointer = object_pointers[ i ];
 
@@ -253,7 +252,6 @@ public:
 		return ALL_OK;
 	}
 
-	///
 	virtual ERet GetEntitiesIntersectingBox(
 		RenderEntityList &visible_entities_
 		, const AABBf& aabb
@@ -374,6 +372,11 @@ public:
 		stats_.total_object_count = _handle_alloc.getNumHandles();
 	}
 
+	virtual AllocatorI& GetStorage() const override
+	{
+		return _storage;
+	}
+
 	virtual void DebugDraw( ADebugDraw & renderer
 		, const NwView3D& main_camera_view
 		, int flags /*= ~0*/
@@ -414,8 +417,22 @@ SpatialDatabaseI* SpatialDatabaseI::CreateSimpleDatabase( AllocatorI & storage )
 
 void SpatialDatabaseI::Destroy( SpatialDatabaseI * o )
 {
-	SpatialDatabase_Bruteforce* culler = static_cast< SpatialDatabase_Bruteforce* >( o );
-	mxDELETE( o, culler->_storage );
+	AllocatorI &	storage = o->GetStorage();
+	mxDELETE( o, storage );
+}
+
+ERet SpatialDatabaseI::GetEntitiesIntersectingViewFrustums(
+	RenderEntityList * visible_entities_[]
+	, const ViewFrustum* view_frustums
+	, const U32 num_views
+	, NwJobSchedulerI & job_scheduler
+	) const
+{
+	for( U32 i = 0; i < num_views; i++ )
+	{
+		mxDO(GetEntitiesIntersectingViewFrustum( *visible_entities_[i], view_frustums[i] ));
+	}
+	return ALL_OK;
 }
 
 }//namespace Rendering
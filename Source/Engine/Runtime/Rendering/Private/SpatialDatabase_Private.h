@@ -0,0 +1,38 @@
+// Helpers shared by the implementations of SpatialDatabaseI.
+#pragma once
+
+#include <Rendering/Public/Scene/Entity.h>
+
+
+namespace Rendering
+{
+namespace
+{
+/// a pointer to an entity with its type stored in the lowest bits
+/// (the entities must be 16-byte aligned)
+union TaggedPointer
+{
+	const void *p;
+	size_t		u;
+};
+
+static mxFORCEINLINE
+TaggedPointer encodeTaggedPointer( const void* new_entity, ERenderEntity entity_type )
+{
+	TaggedPointer	result;
+	result.p = new_entity;
+	result.u |= entity_type;
+	return result;
+}
+
+static mxFORCEINLINE
+void decodeTaggedPointer( const TaggedPointer& tagged_pointer
+						, const RenderEntityBase **entity_pointer_, ERenderEntity *entity_type_ )
+{
+	mxSTATIC_ASSERT(RE_MAX < 16);
+	*entity_pointer_	= (RenderEntityBase*) (size_t(tagged_pointer.p) & ~0xF);	// zero out the 4 lowest bits
+	*entity_type_		= ERenderEntity( tagged_pointer.u & 0xF );	// extract the 4 lowest bits
+}
+
+}//namespace
+}//namespace Rendering
@@ -203,6 +203,11 @@ ERet MaterialLoader::load( NwResource * instance, const TbAssetLoadContext& cont
 	const TSpan< MaterialPass > material_passes = Arrays::GetSpan( material_data->passes );
 	mxASSERT(!material_passes.IsEmpty());
 
+	// Programs for instanced draw calls, if the effect has them.
+	const NwShaderFeatureBitMask instancing_feature_mask = effect->findFeatureMask( mxHASH_STR("USE_INSTANCING") );
+
+	TFixedArray< HProgram, rrMAX_MATERIAL_PASSES >	instanced_programs;
+
 	for(UINT material_pass_index = 0;
 		material_pass_index < material_passes._count;
 		material_pass_index++)
@@ -223,6 +228,13 @@ ERet MaterialLoader::load( NwResource * instance, const TbAssetLoadContext& cont
 
 		const UINT default_program_index = material_pass.program.id;
 		material_pass.program = effect_pass.program_handles[ default_program_index ];
+
+		if( instancing_feature_mask && !instanced_programs.isFull() )
+		{
+			instanced_programs.add(
+				effect_pass.program_handles[ default_program_index | instancing_feature_mask ]
+				);
+		}
 	}
 
 	//
@@ -230,6 +242,12 @@ ERet MaterialLoader::load( NwResource * instance, const TbAssetLoadContext& cont
 
 	material_->passes = material_passes;
 
+	// all passes must be instanced, otherwise the material is drawn without instancing
+	material_->instanced_programs.setEmpty();
+	if( instanced_programs.num() == material_passes._count ) {
+		material_->instanced_programs = instanced_programs;
+	}
+
 	material_->command_buffer.InitializeWithReferenceTo(
 		material_command_buffer
 		);
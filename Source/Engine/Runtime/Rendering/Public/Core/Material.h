@@ -4,6 +4,7 @@
 #pragma once
 
 #include <Base/Template/Containers/Array/TInplaceArray.h>	// TInplaceArray<>
+#include <Base/Template/Containers/Array/TFixedArray.h>
 
 #include <Core/Assets/AssetManagement.h>
 #include <Core/ObjectModel/Clump.h>
@@ -12,6 +13,7 @@
 #include <Graphics/Public/graphics_utilities.h>
 #include <Graphics/Public/graphics_shader_system.h>
 
+#include <Rendering/BuildConfig.h>
 #include <Rendering/Public/Core/RenderPipeline.h>
 #include <Rendering/Public/Core/Material.h>
 
@@ -52,6 +54,10 @@ public:
 	/// A pointer to the corresponding shader effect, must always be valid
 	TPtr< NwShaderEffect >		effect;
 
+	/// The programs of the passes with the USE_INSTANCING shader feature enabled,
+	/// empty if the effect doesn't support instanced drawing.
+	TFixedArray< HProgram, rrMAX_MATERIAL_PASSES >	instanced_programs;
+
 
 
 	/// loaded as a single memory blob
@@ -101,6 +107,9 @@ public:
 		, HShaderInput handle
 		);
 
+	/// true if the material can be drawn with instanced draw calls (see submitModelsWithInstancing())
+	bool supportsInstancing() const { return passes._count > 0 && instanced_programs.num() == passes._count; }
+
 public:
 	static AssetID getDefaultAssetId();
 	static Material* getFallbackMaterial();
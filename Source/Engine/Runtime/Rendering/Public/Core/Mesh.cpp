@@ -47,7 +47,8 @@ mxEND_REFLECTION
 //tbPRINT_SIZE_OF(NwMesh);
 
 NwMesh::NwMesh()
-	: raw_vertex_data(MemoryHeaps::renderer())
+	: clusters(MemoryHeaps::renderer())
+	, raw_vertex_data(MemoryHeaps::renderer())
 	, raw_index_data(MemoryHeaps::renderer())
 {
 	vertex_format = nil;
@@ -158,6 +159,15 @@ ERet NwMesh::LoadFromStream(
 		new_mesh_.default_materials_ids[i] = material_id;
 	}
 
+	// Read clusters.
+	if( header.flags & MESH_HAS_CLUSTERS )
+	{
+		U32	cluster_count;
+		mxDO(stream.Get( cluster_count ));
+		mxDO(new_mesh_.clusters.setNum( cluster_count ));
+		mxDO(stream.Read( new_mesh_.clusters.raw(), new_mesh_.clusters.rawSize() ));
+	}
+
 	//
 mxOPTIMIZE("use default/immutable VB&IB for skinned characters, use dynamic for voxel terrain");
 
@@ -181,6 +191,8 @@ ERet NwMesh::CompileMesh(
 	AWriter &stream
 	, const TbRawMeshData& raw_mesh_data
 	, AllocatorI & scratchpad
+	, const MeshCluster* clusters
+	, const U32 num_clusters
 	)
 {
 	mxENSURE(
@@ -216,6 +228,7 @@ ERet NwMesh::CompileMesh(
 		header.topology			= raw_mesh_data.topology;
 
 		header.flags			= raw_mesh_data.indexData.is32bit() ? MESH_USES_32BIT_IB : 0;
+		header.flags			|= num_clusters ? MESH_HAS_CLUSTERS : 0;
 	}
 	mxDO(stream.Put( header ));
 
@@ -262,6 +275,14 @@ ERet NwMesh::CompileMesh(
 			));
 	}
 
+	// Write clusters.
+
+	if( num_clusters )
+	{
+		mxDO(stream.Put( num_clusters ));
+		mxDO(stream.Write( clusters, num_clusters * sizeof(clusters[0]) ));
+	}
+
 	return ALL_OK;
 }
 
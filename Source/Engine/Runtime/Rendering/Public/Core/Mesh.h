@@ -38,10 +38,31 @@ public:
 };
 mxSTATIC_ASSERT_ISPOW2(sizeof(Submesh));
 
+/// A small cluster of adjacent triangles (a 'meshlet') with bounds for CPU-side culling.
+/// The triangles of each cluster are contiguous in the index buffer.
+struct MeshCluster
+{
+	/// bounding sphere
+	V3f		center;
+	F32		radius;
+
+	/// normal cone: the cluster is back-facing if dot( normalize( cone_apex - eye ), cone_axis ) >= cone_cutoff
+	V3f		cone_apex;
+	F32		cone_cutoff;	//!< sine of the cone's half-angle; > 1 if the cluster cannot be back-face culled
+	V3f		cone_axis;
+
+	U32		start_index;	//!< offset of the first index
+	U32		index_count;
+	U16		vertex_count;	//!< the number of unique vertices
+	U16		submesh_index;
+};
+ASSERT_SIZEOF(MeshCluster, 56);
+
 ///
 enum EMeshFlags {
 	MESH_USES_32BIT_IB	= BIT(0),	//!< Is the mesh using a 32-bit index buffer?
 	MESH_USES_CLOD		= BIT(1),	//!< Continuous Level-Of-Detail (with geomorphing) or Discrete Level-Of-Detail?
+	MESH_HAS_CLUSTERS	= BIT(2),	//!< Is the mesh split into clusters with culling data?
 };
 mxDECLARE_FLAGS( EMeshFlags, U32, FDrawCallFlags );
 
@@ -96,6 +117,9 @@ public:
 
 	//Vector4		vertex_scale;	//!< for unpacking vertex positions in shaders (usually = 'dequantize * object_scale')
 
+	/// [optional] triangle clusters for culling, sorted by submesh
+	DynamicArray< MeshCluster >	clusters;
+
 	// only if the mesh is loaded with KeepMeshDataInRAM flag
 	NwBlob	raw_vertex_data;
 	NwBlob	raw_index_data;
@@ -129,6 +153,8 @@ public:	// Loading
 		AWriter &stream
 		, const TbRawMeshData& raw_mesh_data
 		, AllocatorI & scratchpad
+		, const MeshCluster* clusters = nil	//!< [optional] start indices must be relative to the whole mesh
+		, const U32 num_clusters = 0
 		);
 
 
@@ -0,0 +1,69 @@
+/*
+=============================================================================
+	CPU culling of mesh clusters (meshlets).
+=============================================================================
+*/
+#include <Base/Base.h>
+#pragma hdrstop
+
+#include <Rendering/Public/Core/MeshClusterCulling.h>
+
+
+namespace Rendering
+{
+
+U32 CullMeshClusters(
+	const MeshCluster* clusters
+	, const U32 num_clusters
+	, const ViewFrustum& local_frustum
+	, const V3f& local_eye_position
+	, U32 *visible_cluster_indices_
+	, MeshClusterCullingStats *stats_
+	)
+{
+	const V4f* planes = local_frustum.planes;
+
+	U32	num_visible = 0;
+	U32	num_outside_frustum = 0;
+
+	for( U32 i = 0; i < num_clusters; i++ )
+	{
+		const MeshCluster& cluster = clusters[i];
+
+		// NOTE: the frustum planes face inward
+		FASTBOOL	inside = 1;
+		for( UINT iPlane = 0; iPlane < VF_NUM_PLANES; iPlane++ )
+		{
+			const V4f& plane = planes[ iPlane ];
+			const F32 distance
+				= plane.x * cluster.center.x
+				+ plane.y * cluster.center.y
+				+ plane.z * cluster.center.z
+				+ plane.w
+				;
+			inside &= ( distance + cluster.radius > 0.0f );
+		}
+
+		if( !inside ) {
+			num_outside_frustum++;
+			continue;
+		}
+
+		// cone_cutoff > 1 disables back-face culling
+		const bool backfacing = IsMeshClusterBackFacing( cluster, local_eye_position );
+
+		visible_cluster_indices_[ num_visible ] = i;
+		num_visible += !backfacing;
+	}
+
+	if( stats_ )
+	{
+		stats_->num_tested += num_clusters;
+		stats_->num_outside_frustum += num_outside_frustum;
+		stats_->num_backfacing += num_clusters - num_outside_frustum - num_visible;
+	}
+
+	return num_visible;
+}
+
+}//namespace Rendering
@@ -0,0 +1,46 @@
+/*
+	CPU culling of mesh clusters (meshlets).
+*/
+#pragma once
+
+#include <Base/Math/BoundingVolumes/ViewFrustum.h>
+#include <Rendering/Public/Core/Mesh.h>
+
+
+namespace Rendering
+{
+
+struct MeshClusterCullingStats
+{
+	U32	num_tested;
+	U32	num_outside_frustum;
+	U32	num_backfacing;
+};
+
+/// Tests the bounding spheres against the frustum and the normal cones against the eye position,
+/// writes the indices of potentially visible clusters and returns their number.
+/// The frustum and the eye position must be in the mesh's local space
+/// (e.g. build the frustum from the combined world-view-projection matrix).
+U32 CullMeshClusters(
+	const MeshCluster* clusters
+	, const U32 num_clusters
+	, const ViewFrustum& local_frustum
+	, const V3f& local_eye_position
+	, U32 *visible_cluster_indices_	//!< must be able to hold 'num_clusters' items
+	, MeshClusterCullingStats *stats_ = nil	//!< [optional] accumulated
+	);
+
+/// Only back-face culling, e.g. for selecting shadow casters facing the light.
+/// The eye position can be far away for directional lights.
+mxFORCEINLINE bool IsMeshClusterBackFacing(
+	const MeshCluster& cluster
+	, const V3f& local_eye_position
+	)
+{
+	const V3f to_apex = cluster.cone_apex - local_eye_position;
+	// dot( normalize( to_apex ), axis ) >= cutoff, without the square root
+	const F32 d = V3_Dot( to_apex, cluster.cone_axis );
+	return d >= 0 && d * d >= cluster.cone_cutoff * cluster.cone_cutoff * V3_Dot( to_apex, to_apex );
+}
+
+}//namespace Rendering
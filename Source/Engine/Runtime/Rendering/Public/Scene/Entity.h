@@ -43,7 +43,8 @@ enum ERenderEntity
 	RE_MAX
 };
 
-mxDECLARE_16BIT_HANDLE(HRenderEntity);
+/// 32-bit to allow more than 64K entities (see SpatialDatabaseI::CreateHierarchicalDatabase())
+mxDECLARE_32BIT_HANDLE(HRenderEntity);
 
 
 
@@ -20,6 +20,7 @@ namespace Rendering
 mxBEGIN_FLAGS( BModelFlags )
 	//mxREFLECT_BIT( Visible, EModelFlags::MF_Visible ),
 	mxREFLECT_BIT( Unused, EModelFlags::MF_Unused ),
+	mxREFLECT_BIT( UseInstancing, EModelFlags::MF_UseInstancing ),
 mxEND_FLAGS
 
 mxBEGIN_STRUCT(BoneMatrix)
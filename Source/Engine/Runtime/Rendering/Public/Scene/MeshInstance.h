@@ -17,7 +17,12 @@ namespace Rendering
 /// Model behaviour.
 enum EModelFlags
 {
-	MF_Unused = BIT(0)
+	MF_Unused = BIT(0),
+
+	/// Similar models can be drawn with a single instanced draw call
+	/// if all their materials support instancing (the USE_INSTANCING shader feature),
+	/// see submitModelsWithInstancing().
+	MF_UseInstancing = BIT(1),
 };
 mxDECLARE_FLAGS( EModelFlags, U32, BModelFlags );
 
@@ -95,6 +100,31 @@ namespace Rendering
 		, const TbPassMaskT allowed_passes_mask = ~0
 		);
 
+	/// Collected by submitModelsWithInstancing().
+	struct NwInstancingStats
+	{
+		U32	num_models;
+		U32	num_instanced_models;	//!< models drawn with instanced draw calls
+		U32	num_batches;			//!< instanced batches of models with the same mesh and materials
+		U32	num_draw_calls;
+		U32	num_draw_calls_without_instancing;	//!< for comparison
+		U64	submit_time_usec;		//!< CPU time spent in submitModelsWithInstancing()
+	};
+
+	/// Groups the models with the MF_UseInstancing flag by their mesh and materials
+	/// and submits one instanced draw call per group (and per submesh and material pass);
+	/// the other models are submitted individually.
+	/// NOTE: the mesh LoDs must be separate meshes.
+	ERet submitModelsWithInstancing(
+		const TSpan< const MeshInstance* >& models
+		, const NwCameraView& scene_view
+		, NGpu::NwRenderContext & render_context
+		, AllocatorI & scratchpad
+		, const TbPassMaskT allowed_passes_mask = ~0
+		, NwInstancingStats *stats_ = nil
+		);
+
+	/// the render callback for RE_MeshInstance, uses submitModelsWithInstancing()
 	ERet renderMeshInstances(
 		const RenderCallbackParameters& parameters
 		);
@@ -0,0 +1,161 @@
+/*
+=============================================================================
+	File:	OcclusionBuffer.h
+	Desc:	CPU occlusion culling: selected occluders are rasterized
+			into a small software depth buffer, the bounding boxes of entities
+			are tested against its hierarchical (per-tile) version.
+=============================================================================
+*/
+#pragma once
+
+#include <Rendering/BuildConfig.h>
+#include <Rendering/ForwardDecls.h>
+
+class NwJobSchedulerI;
+
+
+namespace Rendering {
+
+///
+struct NwOcclusionBufferSettings
+{
+	/// the resolution of the depth buffer, must be a multiple of NwOcclusionBuffer::TILE_SIZE
+	U32		width;
+	U32		height;
+
+	/// the occluder triangles crossing the near plane are skipped (instead of clipping them)
+	F32		near_clip;
+
+public:
+	NwOcclusionBufferSettings()
+	{
+		width = 256;
+		height = 128;
+		near_clip = 0.1f;
+	}
+};
+
+///
+struct NwOcclusionStats
+{
+	U32		num_occluders;
+	U32		num_triangles_submitted;
+	U32		num_triangles_rasterized;	//!< after skipping the triangles which are degenerate, off-screen or crossing the near plane
+	U32		rasterization_usec;
+
+public:
+	NwOcclusionStats()
+	{
+		mxZERO_OUT(*this);
+	}
+};
+
+///
+///	A low-resolution depth buffer storing 1/W (0 = infinitely far, bigger values are closer).
+///	The occluders are added on the main thread, then rasterized on worker threads,
+///	one horizontal band of tiles per job (the bands don't overlap, no synchronization is needed).
+///	Each tile keeps the farthest depth of its pixels,
+///	so that most boxes are rejected without reading individual pixels.
+///	The occluders are rasterized with inner-conservative coverage: only the pixels fully covered by a triangle
+///	are written, with the farthest depth of the triangle over the pixel, so that no visible box is ever culled.
+///
+///	Usage (each frame):
+///		BeginFrame( view_projection_matrix ) -> AddOccluder*() -> RasterizeOccluders() -> IsBoxVisible()
+///
+class NwOcclusionBuffer: NonCopyable
+{
+public:
+	enum { TILE_SIZE = 8 };
+
+	/// a triangle in screen space with precomputed edge functions and depth plane
+	struct ScreenTriangle
+	{
+		F32		edges[3][3];	//!< A*x + B*y + C >= 0 inside the triangle
+		F32		depth_plane[3];	//!< 1/W = A*x + B*y + C
+		I32		min_x, min_y;	//!< the range of pixels to rasterize, inclusive
+		I32		max_x, max_y;
+	};
+
+private:
+	DynamicArray< F32 >				_depth;			//!< width * height, row-major
+	DynamicArray< F32 >				_tile_min_depth;//!< the farthest depth in each tile
+	DynamicArray< ScreenTriangle >	_triangles;
+
+	M44f	_view_projection_matrix;
+
+	U32		_width;
+	U32		_height;
+	U32		_num_tiles_x;
+	U32		_num_tiles_y;
+	F32		_near_clip;
+
+	NwOcclusionStats	_stats;
+
+public:
+	NwOcclusionBuffer( AllocatorI & allocator );
+	~NwOcclusionBuffer();
+
+	ERet Initialize( const NwOcclusionBufferSettings& settings );
+	void Shutdown();
+
+	/// Clears the depth buffer and the list of occluders.
+	/// The matrix transforms positions relative to the floating origin (the same space as in SpatialDatabaseI)
+	/// into Direct3D clip space (W must be the distance along the view direction).
+	void BeginFrame( const M44f& view_projection_matrix );
+
+	/// Adds an occluder mesh, e.g. a simplified version of a big building or a terrain chunk.
+	ERet AddOccluderMesh(
+		const V3f* positions
+		, const U32 num_vertices
+		, const U32* indices
+		, const U32 num_indices
+		, const M44f& local_to_world_matrix
+		);
+
+	/// Adds a solid box, the box must be inside the real geometry of the occluder.
+	ERet AddOccluderBox( const AABBf& aabb );
+
+	/// Rasterizes the occluders and builds the tile depths.
+	ERet RasterizeOccluders( NwJobSchedulerI & job_scheduler );
+
+	/// Returns false if the box is completely hidden behind the occluders.
+	/// Thread-safe (after RasterizeOccluders() has been called).
+	bool IsBoxVisible( const AABBf& aabb ) const;
+
+	const NwOcclusionStats& GetStats() const { return _stats; }
+
+	U32 GetWidth() const { return _width; }
+	U32 GetHeight() const { return _height; }
+	const F32* GetDepthBuffer() const { return _depth.raw(); }
+
+public:	// Internal
+	void RasterizeBand( const U32 band_index );
+
+private:
+	ERet addTriangle( const V4f& a, const V4f& b, const V4f& c );
+};
+
+}//namespace Rendering
+
+/*
+-----------------------------------------------------------------------------
+	UNIT TESTS
+-----------------------------------------------------------------------------
+*/
+
+#if MX_DEVELOPER
+
+namespace Rendering
+{
+	/// Renders a city of box-shaped buildings from the street level,
+	/// culls the random entities between them with and without occlusion culling,
+	/// prints the culled-object counts and the costs, checks the culled entities by ray casting
+	/// (fails if any of them is visible).
+	ERet Benchmark_OcclusionCulling(
+		NwJobSchedulerI & job_scheduler
+		, AllocatorI & allocator
+		, const U32 num_entities = 100000
+		);
+}//namespace Rendering
+
+#endif // MX_DEVELOPER
@@ -12,9 +12,12 @@
 #include <Rendering/Public/Scene/CameraView.h>
 #include <Rendering/Public/Scene/Entity.h>
 
+class NwJobSchedulerI;
 
 namespace Rendering {
 
+class NwOcclusionBuffer;
+
 ///
 struct RenderEntityList
 {
@@ -96,6 +99,24 @@ public:	// Query
 		, const AABBf& aabb
 	) const = 0;
 
+	/// Frustum culling followed by occlusion culling:
+	/// skips the entities hidden behind the occluders rasterized into the given buffer.
+	virtual ERet GetEntitiesVisibleFromView(
+		RenderEntityList &visible_entities_
+		, const ViewFrustum& view_frustum
+		, const NwOcclusionBuffer& occlusion_buffer
+	) const = 0;
+
+	/// Culls several views at once (e.g. the main view and shadow cascades).
+	/// The default implementation culls the views one after another.
+	/// NOTE: the allocators of the lists must be thread-safe if the views are culled in parallel.
+	virtual ERet GetEntitiesIntersectingViewFrustums(
+		RenderEntityList * visible_entities_[]	//!< one list per view
+		, const ViewFrustum* view_frustums
+		, const U32 num_views
+		, NwJobSchedulerI & job_scheduler
+	) const;
+
 
 	struct Stats
 	{
@@ -110,6 +131,9 @@ public:	// Debugging
 		enum Enum
 		{
 			DrawBoundingBoxes = BIT(0),
+
+			/// Draws the leaves of the hierarchy (if any).
+			DrawHierarchy = BIT(1),
 		};
 	};
 
@@ -124,14 +148,46 @@ public:	// Convenience.
 
 
 public:
+	/// Tests all entities against the view frustum, supports up to 8K entities.
 	static SpatialDatabaseI* CreateSimpleDatabase(
 		AllocatorI & storage
 		//, const U32 max_object_count
 		);
+
+	/// A bounding volume hierarchy over SoA packets of bounding boxes, tested 8 at once.
+	/// Supports millions of entities, culls multiple views in parallel.
+	static SpatialDatabaseI* CreateHierarchicalDatabase(
+		AllocatorI & storage
+		);
+
 	static void Destroy( SpatialDatabaseI* spatial_database );
 
+	/// the allocator used for creating this database
+	virtual AllocatorI& GetStorage() const = 0;
+
 //protected:
 	virtual ~SpatialDatabaseI() {}
 };
 
 }//namespace Rendering
+
+/*
+-----------------------------------------------------------------------------
+	UNIT TESTS
+-----------------------------------------------------------------------------
+*/
+
+#if MX_DEVELOPER
+
+namespace Rendering
+{
+	/// Culls 10K, 100K, ... random boxes with CreateHierarchicalDatabase() and by testing each box,
+	/// prints timings (incl. culling 4 shadow cascades in parallel) and checks that the results are the same.
+	ERet Benchmark_SpatialDatabase(
+		NwJobSchedulerI & job_scheduler
+		, AllocatorI & allocator
+		, const U32 max_entities = 1000000
+		);
+}//namespace Rendering
+
+#endif // MX_DEVELOPER
@@ -0,0 +1,740 @@
+// Flat IR for BlobTrees with lots of edits.
+#include "Base/Base.h"
+#pragma hdrstop
+#include <algorithm>
+#include <Base/Math/Random.h>
+#include <Core/Util/ScopedTimer.h>
+#include <Implicit/BlobProgram.h>
+
+namespace implicit {
+
+namespace
+{
+	/// the maximum number of edits in a BVH leaf
+	enum { MAX_EDITS_PER_LEAF = 4 };
+
+	/// the BVH is split at the median, so its depth never exceeds log2(number of edits)
+	enum { MAX_BVH_DEPTH = 64 };
+
+	const U32 NO_CACHE_SLOT = ~0u;
+
+	static mxFORCEINLINE U32 hashWords( const U32* words, const U32 count, U32 hash )
+	{
+		// FNV-1a
+		for( U32 i = 0; i < count; i++ ) {
+			hash = (hash ^ words[i]) * 16777619u;
+		}
+		return hash;
+	}
+
+	static bool isBounded( const AABBf& bounds )
+	{
+		for( int axis = 0; axis < 3; axis++ )
+		{
+			// also false for NaNs
+			if( !( bounds.min_corner[axis] > -FLT_MAX && bounds.max_corner[axis] < FLT_MAX ) ) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/// Compiles nodes into instructions, identical instructions are merged (hash-consing),
+	/// so that shared and duplicated subtrees are compiled into the same values.
+	class BlobProgramBuilder
+	{
+		BlobProgram &		_program;
+		DynamicArray< U32 >	_hashTable;	//!< open addressing, value index + 1 or 0 for empty slots
+		U32					_numHashedValues;
+
+	public:
+		BlobProgramBuilder( BlobProgram & program_, AllocatorI & scratchpad )
+			: _program( program_ ), _hashTable( scratchpad )
+		{
+			_numHashedValues = 0;
+		}
+
+		ERet initialize( const U32 expected_number_of_values )
+		{
+			U32	table_size = 64;
+			while( table_size < expected_number_of_values * 2 ) {
+				table_size *= 2;
+			}
+			mxDO(_hashTable.setNum( table_size ));
+			Arrays::setAll( _hashTable, 0u );
+			return ALL_OK;
+		}
+
+		ERet compileValue_recursive( const Node* node, U32 &value_ )
+		{
+			const NodeType node_type = node->type;
+
+			if( node_type < NT_FIRST_PRIM_TYPE )
+			{
+				U32	left_value, right_value;
+				mxDO(compileValue_recursive( node->binary.left_operand, left_value ));
+				mxDO(compileValue_recursive( node->binary.right_operand, right_value ));
+
+				// union and intersection are commutative, so a canonical order of operands exposes more shared values
+				if( node_type != NT_DIFFERENCE && left_value > right_value ) {
+					TSwap( left_value, right_value );
+				}
+
+				const ProgramInstruction	instruction = { node_type, { left_value, right_value } };
+				const U32 hash = hashWords( (const U32*) &instruction, sizeof(instruction) / sizeof(U32), 2166136261u );
+
+				U32	slot;
+				if( findValue( instruction, nil, hash, slot, value_ ) ) {
+					return ALL_OK;
+				}
+
+				const AABBf& left_bounds = _program.valueBounds[ left_value ];
+				const AABBf& right_bounds = _program.valueBounds[ right_value ];
+				AABBf	bounds;
+				switch( node_type )
+				{
+				case NT_UNION:
+					bounds = AABBf::getUnion( left_bounds, right_bounds );
+					break;
+				case NT_DIFFERENCE:
+					bounds = left_bounds;
+					break;
+				case NT_INTERSECTION:
+					bounds = AABBf::getIntersection( left_bounds, right_bounds );
+					break;
+					mxDEFAULT_UNREACHABLE(;);
+				}
+
+				return addValue( instruction, bounds, slot, value_ );
+			}
+			else
+			{
+				SIMDf	params[ MAX_PRIMITIVE_PARAMS ];
+				AABBf	bounds;
+				const U32 num_params = compilePrimitive( *node, params, bounds );
+
+				ProgramInstruction	instruction = { node_type, { 0, num_params } };
+				const U32 hash = hashWords( (const U32*) params, num_params * sizeof(params[0]) / sizeof(U32), node_type );
+
+				U32	slot;
+				if( findValue( instruction, params, hash, slot, value_ ) ) {
+					return ALL_OK;
+				}
+
+				instruction.operands[0] = _program.params.num();
+				for( U32 i = 0; i < num_params; i++ ) {
+					mxDO(_program.params.add( params[i] ));
+				}
+
+				return addValue( instruction, bounds, slot, value_ );
+			}
+		}
+
+	private:
+		/// returns true if the same instruction was found, otherwise returns the slot for inserting the new value
+		bool findValue(
+			const ProgramInstruction& instruction,
+			const SIMDf* primitive_params,	//!< nil for operators
+			const U32 hash,
+			U32 &slot_,
+			U32 &value_
+			) const
+		{
+			const U32 mask = _hashTable.num() - 1;
+			for( U32 slot = hash & mask;; slot = (slot + 1) & mask )
+			{
+				const U32 entry = _hashTable[ slot ];
+				if( !entry ) {
+					slot_ = slot;
+					return false;
+				}
+
+				const U32 value = entry - 1;
+				const ProgramInstruction& existing = _program.instructions[ value ];
+				if( existing.type != instruction.type ) {
+					continue;
+				}
+
+				const bool is_same = primitive_params
+					? ( existing.operands[1] == instruction.operands[1]
+					&& !memcmp( &_program.params[ existing.operands[0] ], primitive_params, instruction.operands[1] * sizeof(SIMDf) ) )
+					: ( existing.operands[0] == instruction.operands[0] && existing.operands[1] == instruction.operands[1] );
+
+				if( is_same ) {
+					value_ = value;
+					return true;
+				}
+			}
+		}
+
+		ERet addValue( const ProgramInstruction& instruction, const AABBf& bounds, const U32 slot, U32 &value_ )
+		{
+			value_ = _program.instructions.num();
+			mxDO(_program.instructions.add( instruction ));
+			mxDO(_program.valueBounds.add( bounds ));
+
+			_hashTable[ slot ] = value_ + 1;
+
+			// keep the load factor below 1/2
+			if( ++_numHashedValues * 2 > _hashTable.num() ) {
+				mxDO(rehash( _hashTable.num() * 2 ));
+			}
+			return ALL_OK;
+		}
+
+		ERet rehash( const U32 new_table_size )
+		{
+			mxDO(_hashTable.setNum( new_table_size ));
+			Arrays::setAll( _hashTable, 0u );
+
+			const U32 mask = new_table_size - 1;
+			const U32 num_values = _program.instructions.num();
+			for( U32 value = 0; value < num_values; value++ )
+			{
+				const ProgramInstruction& instruction = _program.instructions[ value ];
+				const U32 hash = ( instruction.type < NT_FIRST_PRIM_TYPE )
+					? hashWords( (const U32*) &instruction, sizeof(instruction) / sizeof(U32), 2166136261u )
+					: hashWords( (const U32*) &_program.params[ instruction.operands[0] ], instruction.operands[1] * sizeof(SIMDf) / sizeof(U32), instruction.type )
+					;
+				U32	slot = hash & mask;
+				while( _hashTable[ slot ] ) {
+					slot = (slot + 1) & mask;
+				}
+				_hashTable[ slot ] = value + 1;
+			}
+			return ALL_OK;
+		}
+	};
+
+	struct EditCentroidLess
+	{
+		const BlobProgram &	program;
+		int					axis;
+	public:
+		EditCentroidLess( const BlobProgram& program_, int axis_ ) : program( program_ ), axis( axis_ ) {}
+
+		bool operator () ( const U32 a, const U32 b ) const
+		{
+			const AABBf& bounds_a = program.valueBounds[ program.edits[ a ].value ];
+			const AABBf& bounds_b = program.valueBounds[ program.edits[ b ].value ];
+			return bounds_a.min_corner[axis] + bounds_a.max_corner[axis] < bounds_b.min_corner[axis] + bounds_b.max_corner[axis];
+		}
+	};
+
+	ERet buildBvh_recursive( BlobProgram & program_, const U32 start, const U32 count )
+	{
+		U32 * edit_indices = program_.bvhEditIndices.raw();
+
+		AABBf	bounds = program_.valueBounds[ program_.edits[ edit_indices[ start ] ].value ];
+		AABBf	centroid_bounds = AABBf::make( bounds.center(), bounds.center() );
+		for( U32 i = 1; i < count; i++ )
+		{
+			const AABBf& edit_bounds = program_.valueBounds[ program_.edits[ edit_indices[ start + i ] ].value ];
+			bounds = AABBf::getUnion( bounds, edit_bounds );
+			centroid_bounds = AABBf::getUnion( centroid_bounds, AABBf::make( edit_bounds.center(), edit_bounds.center() ) );
+		}
+
+		const U32 node_index = program_.bvhNodes.num();
+		ProgramBvhNode	new_node;
+		new_node.bounds = bounds;
+		new_node.count = count;
+		new_node.start = start;
+
+		if( count <= MAX_EDITS_PER_LEAF ) {
+			return program_.bvhNodes.add( new_node );
+		}
+
+		new_node.count = 0;
+		mxDO(program_.bvhNodes.add( new_node ));
+
+		// split at the median of the centroids along the longest axis
+		const V3f centroid_extent = centroid_bounds.size();
+		const int axis = ( centroid_extent.x > centroid_extent.y )
+			? ( centroid_extent.x > centroid_extent.z ? 0 : 2 )
+			: ( centroid_extent.y > centroid_extent.z ? 1 : 2 )
+			;
+
+		const U32 left_count = count / 2;
+		std::nth_element(
+			edit_indices + start,
+			edit_indices + start + left_count,
+			edit_indices + start + count,
+			EditCentroidLess( program_, axis )
+			);
+
+		mxDO(buildBvh_recursive( program_, start, left_count ));
+
+		// the node array could have been reallocated
+		program_.bvhNodes[ node_index ].start = program_.bvhNodes.num();
+
+		mxDO(buildBvh_recursive( program_, start + left_count, count - left_count ));
+
+		return ALL_OK;
+	}
+}//namespace
+
+BlobProgram::BlobProgram( AllocatorI & allocator )
+	: instructions( allocator )
+	, valueBounds( allocator )
+	, valueCacheSlots( allocator )
+	, params( allocator )
+	, edits( allocator )
+	, globalEdits( allocator )
+	, bvhNodes( allocator )
+	, bvhEditIndices( allocator )
+{
+	baseValue = 0;
+	numCacheSlots = 0;
+}
+
+ERet compileBlobProgram(
+						const Node* root,
+						BlobProgram &program_,
+						AllocatorI & scratchpad
+						)
+{
+	program_.instructions.RemoveAll();
+	program_.valueBounds.RemoveAll();
+	program_.valueCacheSlots.RemoveAll();
+	program_.params.RemoveAll();
+	program_.edits.RemoveAll();
+	program_.globalEdits.RemoveAll();
+	program_.bvhNodes.RemoveAll();
+	program_.bvhEditIndices.RemoveAll();
+	program_.numCacheSlots = 0;
+
+	// Walk down the chain of edits (e.g. Union( Difference( Union( base, A ), B ), C )).
+	// The chain can be arbitrarily long, so it's traversed without recursion.
+	DynamicArray< const Node* >	chain( scratchpad );
+
+	const Node* node = root;
+	while( node->type < NT_FIRST_PRIM_TYPE )
+	{
+		mxDO(chain.add( node ));
+
+		const Node* left_operand = node->binary.left_operand;
+		const Node* right_operand = node->binary.right_operand;
+
+		// the first operand of a difference is always the shape being edited,
+		// the operands of commutative operators can be swapped
+		const bool continue_on_the_right = ( node->type != NT_DIFFERENCE )
+			&& left_operand->type >= NT_FIRST_PRIM_TYPE
+			&& right_operand->type < NT_FIRST_PRIM_TYPE
+			;
+
+		node = continue_on_the_right ? right_operand : left_operand;
+	}
+
+	BlobProgramBuilder	builder( program_, scratchpad );
+	mxDO(builder.initialize( chain.num() * 2 + 1 ));
+
+	mxDO(builder.compileValue_recursive( node, program_.baseValue ));
+
+	// the operators of the chain are applied bottom-up
+	AABBf	result_bounds = program_.valueBounds[ program_.baseValue ];
+	mxDO(program_.edits.reserve( chain.num() ));
+
+	for( U32 i = chain.num(); i-- > 0; )
+	{
+		const Node* chain_node = chain[i];
+		const Node* edited_shape = ( i + 1 < chain.num() ) ? chain[i + 1] : node;
+		const Node* operand = ( chain_node->binary.left_operand == edited_shape )
+			? chain_node->binary.right_operand
+			: chain_node->binary.left_operand
+			;
+
+		ProgramEdit	edit;
+		edit.type = chain_node->type;
+		mxDO(builder.compileValue_recursive( operand, edit.value ));
+
+		const AABBf& edit_bounds = program_.valueBounds[ edit.value ];
+		switch( edit.type )
+		{
+		case NT_UNION:
+			result_bounds = AABBf::getUnion( result_bounds, edit_bounds );
+			break;
+		case NT_DIFFERENCE:
+			break;
+		case NT_INTERSECTION:
+			result_bounds = AABBf::getIntersection( result_bounds, edit_bounds );
+			break;
+			mxDEFAULT_UNREACHABLE(;);
+		}
+		edit.resultBounds = result_bounds;
+
+		mxDO(program_.edits.add( edit ));
+	}
+
+	// Values used more than once (instanced brushes) are cached during evaluation.
+	// Primitives are cheaper to evaluate than to copy.
+	const U32 num_values = program_.instructions.num();
+
+	DynamicArray< U32 >	use_counts( scratchpad );
+	mxDO(use_counts.setNum( num_values ));
+	Arrays::setAll( use_counts, 0u );
+
+	mxUINT_LOOP_i( num_values )
+	{
+		const ProgramInstruction& instruction = program_.instructions[i];
+		if( instruction.type < NT_FIRST_PRIM_TYPE ) {
+			use_counts[ instruction.operands[0] ]++;
+			use_counts[ instruction.operands[1] ]++;
+		}
+	}
+	mxUINT_LOOP_i( program_.edits.num() ) {
+		use_counts[ program_.edits[i].value ]++;
+	}
+
+	mxDO(program_.valueCacheSlots.setNum( num_values ));
+	mxUINT_LOOP_i( num_values )
+	{
+		const bool is_shared = use_counts[i] > 1 && program_.instructions[i].type < NT_FIRST_PRIM_TYPE;
+		program_.valueCacheSlots[i] = is_shared ? program_.numCacheSlots++ : NO_CACHE_SLOT;
+	}
+
+	// Unions and differences with shapes which don't intersect the region don't change the result, so they can be culled.
+	// Intersections and unbounded shapes are always evaluated.
+	mxUINT_LOOP_i( program_.edits.num() )
+	{
+		const ProgramEdit& edit = program_.edits[i];
+		if( edit.type == NT_INTERSECTION || !isBounded( program_.valueBounds[ edit.value ] ) ) {
+			mxDO(program_.globalEdits.add( i ));
+		} else {
+			mxDO(program_.bvhEditIndices.add( i ));
+		}
+	}
+
+	if( program_.bvhEditIndices.num() )
+	{
+		mxDO(program_.bvhNodes.reserve( getNumBatches( program_.bvhEditIndices.num(), MAX_EDITS_PER_LEAF ) * 2 ));
+		mxDO(buildBvh_recursive( program_, 0, program_.bvhEditIndices.num() ));
+	}
+
+	return ALL_OK;
+}
+
+BlobProgramContext::BlobProgramContext( AllocatorI & allocator )
+	: selectedEdits( allocator )
+	, cachedValues( allocator )
+	, cacheStamps( allocator )
+{
+	currentStamp = 0;
+}
+
+ERet BlobProgramContext::initialize( const BlobProgram& program )
+{
+	mxDO(selectedEdits.reserve( program.edits.num() ));
+	mxDO(cachedValues.setNum( program.numCacheSlots ));
+	mxDO(cacheStamps.setNum( program.numCacheSlots ));
+	Arrays::setAll( cacheStamps, 0u );
+	currentStamp = 0;
+	return ALL_OK;
+}
+
+ERet selectEdits(
+				 const BlobProgram& program,
+				 const AABBf& bounding_box,
+				 BlobProgramContext & context
+				 )
+{
+	context.selectedEdits.RemoveAll();
+
+	if( program.bvhNodes.num() )
+	{
+		U32	stack[ MAX_BVH_DEPTH ];
+		U32	stack_size = 0;
+		stack[ stack_size++ ] = 0;
+
+		while( stack_size )
+		{
+			const U32 node_index = stack[ --stack_size ];
+			const ProgramBvhNode& node = program.bvhNodes[ node_index ];
+
+			if( !node.bounds.intersects( bounding_box ) ) {
+				continue;
+			}
+
+			if( node.count )
+			{
+				for( U32 i = 0; i < node.count; i++ )
+				{
+					const U32 edit_index = program.bvhEditIndices[ node.start + i ];
+					if( program.valueBounds[ program.edits[ edit_index ].value ].intersects( bounding_box ) ) {
+						mxDO(context.selectedEdits.add( edit_index ));
+					}
+				}
+			}
+			else
+			{
+				mxASSERT( stack_size + 2 <= MAX_BVH_DEPTH );
+				stack[ stack_size++ ] = node.start;
+				stack[ stack_size++ ] = node_index + 1;
+			}
+		}
+	}
+
+	mxUINT_LOOP_i( program.globalEdits.num() ) {
+		mxDO(context.selectedEdits.add( program.globalEdits[i] ));
+	}
+
+	// the edits must be applied in the original order
+	std::sort( context.selectedEdits.raw(), context.selectedEdits.raw() + context.selectedEdits.num() );
+
+	return ALL_OK;
+}
+
+/*
+-----------------------------------------------------------------------------
+	UNIT TESTS
+-----------------------------------------------------------------------------
+*/
+#if MX_DEVELOPER
+
+namespace
+{
+	/// A big sculpted terrain: a slab with lots of added and carved brushes,
+	/// some brushes are placed several times (the same nodes are referenced from several edits).
+	Node* makeSculptedWorld( Node * nodes_, const float size, const U32 number_of_edits, NwRandom & rng )
+	{
+		U32	num_nodes = 0;
+
+		Node* root = &nodes_[ num_nodes++ ];
+		root->type = NT_BOX;
+		root->box.center = CV3f( size * 0.5f, size * 0.5f, 8.0f );
+		root->box.extent = CV3f( size * 0.5f, size * 0.5f, 8.0f );
+		root->box.material_id = 1;
+
+		// the most recently created brushes
+		Node *	recent_brushes[ 64 ];
+		U32		num_created_brushes = 0;
+
+		for( U32 i = 0; i < number_of_edits; i++ )
+		{
+			Node* brush = nil;
+			NodeType operation = ( rng.RandomInt( 9 ) < 7 ) ? NT_UNION : NT_DIFFERENCE;
+
+			if( i == number_of_edits / 2 )
+			{
+				// flatten everything above the given height
+				brush = &nodes_[ num_nodes++ ];
+				brush->type = NT_BOX;
+				brush->box.center = CV3f( size * 0.5f, size * 0.5f, 10.0f );
+				brush->box.extent = CV3f( size * 0.5f + 1.0f, size * 0.5f + 1.0f, 12.0f );
+				brush->box.material_id = 0;
+				operation = NT_INTERSECTION;
+			}
+			else if( num_created_brushes && rng.RandomInt( 9 ) == 0 )
+			{
+				// place an existing brush again
+				const U32 num_recent_brushes = smallest( num_created_brushes, (U32) mxCOUNT_OF(recent_brushes) );
+				brush = recent_brushes[ rng.RandomInt( num_recent_brushes - 1 ) ];
+			}
+			else
+			{
+				const V3f position = CV3f(
+					rng.GetRandomFloatInRange( 0, size ),
+					rng.GetRandomFloatInRange( 0, size ),
+					rng.GetRandomFloatInRange( 8.0f, 24.0f )
+					);
+				const float radius = rng.GetRandomFloatInRange( 1.0f, 4.0f );
+				const U32 material_id = ( operation == NT_UNION ) ? 2 + (i % 5) : 0;
+				const int kind = rng.RandomInt( 3 );
+
+				brush = &nodes_[ num_nodes++ ];
+				brush->type = NT_SPHERE;
+				brush->sphere.center = position;
+				brush->sphere.radius = radius;
+				brush->sphere.material_id = material_id;
+
+				if( kind == 1 )
+				{
+					brush->type = NT_BOX;
+					brush->box.center = position;
+					brush->box.extent = CV3f( radius, radius * 0.5f, radius * 0.75f );
+					brush->box.material_id = material_id;
+				}
+				else if( kind >= 2 )
+				{
+					// a composite brush: a sphere with a box
+					Node* box = &nodes_[ num_nodes++ ];
+					box->type = NT_BOX;
+					box->box.center = position + CV3f( radius, 0, 0 );
+					box->box.extent = CV3f( radius * 0.5f );
+					box->box.material_id = material_id;
+
+					Node* composite = &nodes_[ num_nodes++ ];
+					composite->type = NT_UNION;
+					composite->binary.left_operand = brush;
+					composite->binary.right_operand = box;
+					brush = composite;
+				}
+
+				recent_brushes[ num_created_brushes++ % mxCOUNT_OF(recent_brushes) ] = brush;
+			}
+
+			Node* new_root = &nodes_[ num_nodes++ ];
+			new_root->type = operation;
+			new_root->binary.left_operand = root;
+			new_root->binary.right_operand = brush;
+			root = new_root;
+		}
+
+		return root;
+	}
+
+	void getBlockPoints( const V3f& origin, const F32 step, const U32 block[3], V3f_SoA & positions_, AABBf & bounds_ )
+	{
+		U32	point_index = 0;
+		for( U32 z = 0; z < 4; z++ ) {
+			for( U32 y = 0; y < 4; y++ ) {
+				for( U32 x = 0; x < 4; x++ ) {
+					positions_.xs[ point_index ] = origin.x + (block[0] * 4 + x) * step;
+					positions_.ys[ point_index ] = origin.y + (block[1] * 4 + y) * step;
+					positions_.zs[ point_index ] = origin.z + (block[2] * 4 + z) * step;
+					point_index++;
+				}
+			}
+		}
+		bounds_ = AABBf::make(
+			CV3f( positions_.xs[0], positions_.ys[0], positions_.zs[0] ),
+			CV3f( positions_.xs[MAX_POINTS-1], positions_.ys[MAX_POINTS-1], positions_.zs[MAX_POINTS-1] )
+			);
+	}
+
+	ERet benchmarkBlobProgram(
+		AllocatorI & scratchpad
+		, const U32 number_of_edits
+		, const U32 resolution
+		)
+	{
+		// the density of edits stays the same
+		const float size = 64.0f * mmSqrt( number_of_edits / 1000.0f );
+
+		// the evaluated window doesn't depend on the world size
+		const float window_size = 32.0f;
+		const V3f window_origin = CV3f( size * 0.5f - window_size * 0.5f, size * 0.5f - window_size * 0.5f, 0.0f );
+		const F32 step = window_size / resolution;
+		const U32 blocks_per_axis = resolution / 4;
+		const U32 num_blocks = blocks_per_axis * blocks_per_axis * blocks_per_axis;
+		const U32 num_points = num_blocks * MAX_POINTS;
+
+		// each edit adds at most three brush nodes and an operator
+		const U32 max_nodes = number_of_edits * 4 + 1;
+
+		Node *	nodes;
+		mxTRY_ALLOC_SCOPED( nodes, max_nodes, scratchpad );
+
+		NwRandom	rng( 12345 );
+		const Node* root = makeSculptedWorld( nodes, size, number_of_edits, rng );
+
+		ScopedTimer	timer;
+
+		BlobProgram	program( scratchpad );
+		mxDO(compileBlobProgram( root, program, scratchpad ));
+
+		const U64 compile_usec = timer.ElapsedMicroseconds();
+
+		BlobProgramContext	context( scratchpad );
+		mxDO(context.initialize( program ));
+
+		F32 *	distances;
+		mxTRY_ALLOC_SCOPED( distances, num_points, scratchpad );
+		U32 *	materials;
+		mxTRY_ALLOC_SCOPED( materials, num_points, scratchpad );
+
+		const EEvaluatorISA isa = getBestEvaluatorISA();
+
+		U64	total_selected_edits = 0;
+
+		timer.Reset();
+
+		for( U32 block_index = 0; block_index < num_blocks; block_index++ )
+		{
+			const U32 block[3] = {
+				block_index % blocks_per_axis,
+				(block_index / blocks_per_axis) % blocks_per_axis,
+				block_index / (blocks_per_axis * blocks_per_axis)
+			};
+			V3f_SoA	positions;
+			AABBf	block_bounds;
+			getBlockPoints( window_origin, step, block, positions, block_bounds );
+
+			Array_of_F32	block_distances;
+			Array_of_I32	block_materials;
+			mxDO(evaluateProgram( program, context, block_bounds, MAX_POINTS, positions, block_distances, block_materials, isa ));
+
+			memcpy( distances + block_index * MAX_POINTS, block_distances, sizeof(block_distances) );
+			memcpy( materials + block_index * MAX_POINTS, block_materials, sizeof(block_materials) );
+
+			total_selected_edits += context.selectedEdits.num();
+		}
+
+		const U64 program_usec = timer.ElapsedMicroseconds();
+
+		ptPRINT("BlobProgram with %u edits: %u values, %u cached values, %u BVH nodes, compiled in %.2f ms, %s:",
+			number_of_edits, program.instructions.num(), program.numCacheSlots, program.bvhNodes.num(), compile_usec * 1e-3f, getEvaluatorISAName( isa ));
+		ptPRINT("	%u^3 points: %.2f Mpoints/sec, average number of selected edits: %.1f",
+			resolution, program_usec ? float(num_points) / program_usec : 0.0f, float(total_selected_edits) / num_blocks);
+
+		// compare with the BlobTreeSoA if it isn't too big for the (recursive) compiler
+		if( number_of_edits <= 1000 )
+		{
+			BlobTreeSoA	tree( scratchpad );
+			BlobTreeCompiler	compiler( scratchpad );
+			mxDO(compiler.compile( root, tree ));
+
+			U32	num_mismatches = 0;
+
+			timer.Reset();
+
+			for( U32 block_index = 0; block_index < num_blocks; block_index++ )
+			{
+				const U32 block[3] = {
+					block_index % blocks_per_axis,
+					(block_index / blocks_per_axis) % blocks_per_axis,
+					block_index / (blocks_per_axis * blocks_per_axis)
+				};
+				V3f_SoA	positions;
+				AABBf	block_bounds;
+				getBlockPoints( window_origin, step, block, positions, block_bounds );
+
+				Array_of_F32	block_distances;
+				Array_of_I32	block_materials;
+				evaluateWide( tree, block_bounds, MAX_POINTS, positions, block_distances, block_materials, isa );
+
+				mxUINT_LOOP_i( MAX_POINTS ) {
+					num_mismatches += ( block_distances[i] != distances[ block_index * MAX_POINTS + i ] )
+						|| ( block_materials[i] != materials[ block_index * MAX_POINTS + i ] );
+				}
+			}
+
+			const U64 tree_usec = timer.ElapsedMicroseconds();
+
+			ptPRINT("	BlobTreeSoA with %u nodes: %.2f Mpoints/sec (the program is %.2fx faster), mismatches: %u",
+				tree.numOps + tree.numPrims, tree_usec ? float(num_points) / tree_usec : 0.0f,
+				program_usec ? float(tree_usec) / program_usec : 0.0f, num_mismatches);
+
+			mxENSURE( num_mismatches == 0, ERR_UNKNOWN_ERROR, "BlobProgram gives different results" );
+		}
+
+		return ALL_OK;
+	}
+}//namespace
+
+ERet Benchmark_BlobProgram(
+	AllocatorI & scratchpad
+	, const U32 resolution
+	)
+{
+	mxASSERT( resolution >= 4 && resolution % 4 == 0 );
+
+	const U32 edit_counts[] = { 1000, 10000, 100000 };
+	mxUINT_LOOP_i( mxCOUNT_OF(edit_counts) ) {
+		mxDO(benchmarkBlobProgram( scratchpad, edit_counts[i], resolution ));
+	}
+	return ALL_OK;
+}
+
+#endif // MX_DEVELOPER
+
+}//namespace implicit
@@ -0,0 +1,131 @@
+// Flat IR for BlobTrees with lots of edits (e.g. made by players).
+#pragma once
+
+#include <Utility/Implicit/Evaluator.h>
+
+namespace implicit {
+
+/// Computes a new value (a virtual register) from the parameters of a primitive or from two earlier values.
+/// Values are numbered in the order of instructions, so the operands of an instruction always precede it.
+struct ProgramInstruction
+{
+	U32		type;		//!< NodeType
+	U32		operands[2];	//!< the values combined by an operator or the first parameter and the number of parameters of a primitive
+};
+
+/// A CSG operation applied to the result of all previous edits.
+struct ProgramEdit
+{
+	U32		type;	//!< NT_UNION, NT_DIFFERENCE or NT_INTERSECTION
+	U32		value;	//!< the shape of the edit
+	AABBf	resultBounds;	//!< the bounds of the result after this edit (used for culling intersections)
+};
+
+/// A node of the BVH over edit bounds, the first child goes right after its parent.
+struct ProgramBvhNode
+{
+	AABBf	bounds;
+	U32		count;	//!< the number of edits in the leaf, 0 for internal nodes
+	U32		start;	//!< the first index in 'bvhEditIndices' for leaves or the index of the second child for internal nodes
+};
+
+/// The tree is split into a base shape and a list of edits applied to it.
+/// Identical subtrees (e.g. instanced brushes) are compiled into the same values and evaluated once per region.
+/// The BVH over edit bounds finds the edits which can affect the region,
+/// unions and differences with shapes which are far away don't change the result.
+/// Evaluating a program gives the same results as evaluate() with the BlobTreeSoA compiled from the same tree.
+struct BlobProgram : NonCopyable
+{
+	DynamicArray< ProgramInstruction >	instructions;
+	DynamicArray< AABBf >	valueBounds;	//!< the bounding box of each value (computed as in BlobTreeSoA)
+	DynamicArray< U32 >		valueCacheSlots;	//!< the cache slot of each value which is used more than once or ~0
+	DynamicArray< SIMDf >	params;	//!< parameters of primitives (in the same layout as in BlobTreeSoA)
+
+	U32						baseValue;	//!< the shape before applying the edits
+	DynamicArray< ProgramEdit >	edits;	//!< in the order of application
+
+	/// intersections affect all points and are always applied
+	DynamicArray< U32 >		globalEdits;
+
+	/// the BVH over the bounds of the union and difference edits
+	DynamicArray< ProgramBvhNode >	bvhNodes;
+	DynamicArray< U32 >		bvhEditIndices;
+
+	U32		numCacheSlots;
+
+public:
+	BlobProgram( AllocatorI & allocator );
+};
+
+/// Converts the tree into the program.
+/// The tree can be a DAG: subtrees referenced from several nodes are compiled only once.
+ERet compileBlobProgram(
+						const Node* root,
+						BlobProgram &program_,
+						AllocatorI & scratchpad
+						);
+
+/// The result of a shared value, computed only once per evaluated region.
+struct CachedValue
+{
+	Array_of_F32	distances;
+	Array_of_I32	materials;
+};
+
+/// Scratch memory for evaluating programs, each thread should have its own context.
+struct BlobProgramContext : NonCopyable
+{
+	DynamicArray< U32 >		selectedEdits;
+
+	/// the results of values used more than once
+	DynamicArray< CachedValue >	cachedValues;
+	DynamicArray< U32 >		cacheStamps;	//!< the cached result is valid if the stamp equals 'currentStamp'
+	U32		currentStamp;
+
+public:
+	BlobProgramContext( AllocatorI & allocator );
+
+	ERet initialize( const BlobProgram& program );
+};
+
+/// Finds the edits which can affect the points inside the bounding box,
+/// writes their indices in the order of application into 'context.selectedEdits'.
+ERet selectEdits(
+				 const BlobProgram& program,
+				 const AABBf& bounding_box,
+				 BlobProgramContext & context
+				 );
+
+/// The same as evaluateWide(), but only the edits near the bounding box are evaluated.
+ERet evaluateProgram(
+					 const BlobProgram& program,
+					 BlobProgramContext & context,
+					 const AABBf& bounding_box,	//!< region of interest
+					 const UINT number_of_points,
+					 const V3f_SoA& positions_,
+					 Array_of_F32 &distances_,
+					 Array_of_I32 &materials_,
+					 const EEvaluatorISA isa
+					 );
+
+}//namespace implicit
+
+/*
+-----------------------------------------------------------------------------
+	UNIT TESTS
+-----------------------------------------------------------------------------
+*/
+
+#if MX_DEVELOPER
+
+namespace implicit
+{
+	/// Compiles trees with 1k, 10k and 100k edits and measures the number of points evaluated per second,
+	/// checks that the results are the same as with evaluateWide() on the smallest tree.
+	ERet Benchmark_BlobProgram(
+		AllocatorI & scratchpad
+		, const U32 resolution = 64	//!< the evaluated grid has resolution^3 points
+		);
+}//namespace implicit
+
+#endif // MX_DEVELOPER
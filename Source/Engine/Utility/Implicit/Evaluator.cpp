@@ -78,7 +78,7 @@ SIMDf vec3_length( const SIMDf& Xs, const SIMDf& Ys, const SIMDf& Zs )
 }
 
 BlobTreeCompiler::BlobTreeCompiler( AllocatorI & scratchpad )
-: _nodes( scratchpad ), _leaves( scratchpad )
+: _nodes( scratchpad ), _leaves( scratchpad ), _stackDepths( scratchpad )
 {
 }
 
@@ -129,6 +129,112 @@ static void analyzeBlobTree_recursive(
 	}
 }
 
+/// Writes the parameters of the primitive in the layout expected by the evaluators and computes its bounds.
+U32 compilePrimitive( const Node& node, SIMDf params_[MAX_PRIMITIVE_PARAMS], AABBf &bounds_ )
+{
+	switch( node.type )
+	{
+	case NT_PLANE:
+		{
+			bounds_ = AABBf::make( CV3f(-HUGE_VAL), CV3f(+HUGE_VAL) );
+			params_[0] = Vector4_Set( node.plane.normal_and_distance );
+			params_[1] = _mm_castsi128_ps(REPLICATE_I32( node.plane.material_id ));
+			return 2;
+		}
+
+	case NT_SPHERE:
+		{
+			bounds_ = AABBf::fromSphere( node.sphere.center, node.sphere.radius );
+			params_[0] = Vector4_Set( node.sphere.center, node.sphere.radius );
+			params_[1] = _mm_castsi128_ps(REPLICATE_I32( node.sphere.material_id ));
+			return 2;
+		}
+
+	case NT_BOX:
+		{
+			bounds_ = AABBf::make( node.box.center - node.box.extent, node.box.center + node.box.extent );
+
+			//HACK:
+			//params_[0] = Vector4_Set( node.box.center, node.box.material_id );
+			__m128i	tmp;
+			tmp.m128i_i32[0] = FloatU32(node.box.center.x);
+			tmp.m128i_i32[1] = FloatU32(node.box.center.y);
+			tmp.m128i_i32[2] = FloatU32(node.box.center.z);
+			tmp.m128i_i32[3] = node.box.material_id;
+			params_[0] = _mm_castsi128_ps(tmp);
+
+			params_[1] = Vector4_Set( node.box.extent, 0 );
+			return 2;
+		}
+
+	case NT_INF_CYLINDER:
+		{
+			const CV3f cylAabbMin(
+				node.inf_cylinder.origin.x - node.inf_cylinder.radius,
+				node.inf_cylinder.origin.y - node.inf_cylinder.radius,
+				-HUGE_VAL
+				);
+			const CV3f cylAabbMax(
+				node.inf_cylinder.origin.x + node.inf_cylinder.radius,
+				node.inf_cylinder.origin.y + node.inf_cylinder.radius,
+				+HUGE_VAL
+				);
+			bounds_ = AABBf::make( cylAabbMin, cylAabbMax );
+			params_[0] = Vector4_Set( node.inf_cylinder.origin, node.inf_cylinder.radius );
+			params_[1] = _mm_castsi128_ps(REPLICATE_I32( node.inf_cylinder.material_id ));
+			return 2;
+		}
+
+	case NT_TORUS:
+		{
+			const float torus_outer_radius = node.torus.big_radius + node.torus.small_radius;
+
+			const CV3f torusAabbMin(
+				node.torus.center.x - torus_outer_radius,
+				node.torus.center.y - torus_outer_radius,
+				node.torus.center.z - node.torus.small_radius
+				);
+			const CV3f torusAabbMax(
+				node.torus.center.x + torus_outer_radius,
+				node.torus.center.y + torus_outer_radius,
+				node.torus.center.z + node.torus.small_radius
+				);
+			bounds_ = AABBf::make( torusAabbMin, torusAabbMax );
+
+			//HACK:
+			//params_[0] = Vector4_Set( node.torus.center, node.torus.material_id );
+			__m128i	tmp;
+			tmp.m128i_i32[0] = FloatU32(node.torus.center.x);
+			tmp.m128i_i32[1] = FloatU32(node.torus.center.y);
+			tmp.m128i_i32[2] = FloatU32(node.torus.center.z);
+			tmp.m128i_i32[3] = node.torus.material_id;
+			params_[0] = _mm_castsi128_ps(tmp);
+
+			params_[1] = Vector4_Set( node.torus.big_radius, node.torus.small_radius, 0, 0 );
+			return 2;
+		}
+
+	case NT_SINE_WAVE:
+		{
+			mxTODO("calc precise bounds");
+			bounds_ = AABBf::make( CV3f(-HUGE_VAL), CV3f(+HUGE_VAL) );
+			params_[0] = Vector4_Set( node.sine_wave.coord_scale, node.sine_wave.material_id );
+			return 1;
+		}
+
+	case NT_GYROID:
+		{
+			mxTODO("calc precise bounds");
+			bounds_ = AABBf::make( CV3f(-HUGE_VAL), CV3f(+HUGE_VAL) );
+			params_[0] = Vector4_Set( node.gyroid.coord_scale, node.gyroid.material_id );
+			return 1;
+		}
+
+		mxDEFAULT_UNREACHABLE(;);
+	}//switch
+	return 0;
+}
+
 static NodeIndex linearizeBlobTree_recursive(
 										const BlobTreeAnalysisResult& tree_info,
 										const Node* node,
@@ -143,10 +249,11 @@ static NodeIndex linearizeBlobTree_recursive(
 
 		const NodeIndex leftChildIdx = linearizeBlobTree_recursive( tree_info, node->binary.left_operand, output_ );
 		const NodeIndex rightChildIdx = linearizeBlobTree_recursive( tree_info, node->binary.right_operand, output_ );
+		output_.subtreeSizes[ nodeOpIdx ] = output_.last_index - nodeOpIdx;
 		const AABBf& left_child_bounds = output_.aabbs[ leftChildIdx ];
 		const AABBf& right_child_bounds = output_.aabbs[ rightChildIdx ];
 		
-		output_.types[ nodeOpIdx ] = BlobTreeSoA::PackOp( node->type, 0, leftChildIdx, rightChildIdx );
+		output_.types[ nodeOpIdx ] = BlobTreeSoA::PackOp( node->type, 0 );
 
 		switch( node->type )
 		{
@@ -175,110 +282,75 @@ static NodeIndex linearizeBlobTree_recursive(
 		const U32 parameter_idx = output_.numPrimParams;
 
 		output_.types[ primitive_index ] = BlobTreeSoA::PackPrimitive( node->type, parameter_idx );
+		output_.subtreeSizes[ primitive_index ] = 1;
 
-		switch( node->type )
-		{
-		case NT_PLANE:
-			{
-				output_.aabbs[ primitive_index ] = AABBf::make( CV3f(-HUGE_VAL), CV3f(+HUGE_VAL) );
-				output_.params[ parameter_idx + 0 ] = Vector4_Set( node->plane.normal_and_distance );
-				output_.params[ parameter_idx + 1 ] = _mm_castsi128_ps(REPLICATE_I32( node->plane.material_id ));
-				output_.numPrimParams += 2;
-			} break;
+		const U32 num_params = compilePrimitive( *node, output_.params + parameter_idx, output_.aabbs[ primitive_index ] );
+		output_.numPrimParams += num_params;
 
-		case NT_SPHERE:
-			{
-				output_.aabbs[ primitive_index ] = AABBf::fromSphere( node->sphere.center, node->sphere.radius );
-				output_.params[ parameter_idx + 0 ] = Vector4_Set( node->sphere.center, node->sphere.radius );
-				output_.params[ parameter_idx + 1 ] = _mm_castsi128_ps(REPLICATE_I32( node->sphere.material_id ));
-				output_.numPrimParams += 2;
-			} break;
+		return primitive_index;
+	}
+}
 
-		case NT_BOX:
-			{
-				output_.aabbs[ primitive_index ] = AABBf::make( node->box.center - node->box.extent, node->box.center + node->box.extent );
+/// Calculates the number of stack slots needed to evaluate each subtree (the Sethi-Ullman number).
+static void calcStackDepths( const BlobTreeSoA& tree, U32 * stack_depths_ )
+{
+	// in pre-order the operands always go after the operator
+	const U32 num_nodes = tree.numOps + tree.numPrims;
+	for( U32 node_index = num_nodes; node_index-- > 0; )
+	{
+		const NodeType nodeType = NodeType( tree.types[ node_index ] & NODE_TYPE_MASK );
+		if( nodeType >= NT_FIRST_PRIM_TYPE ) {
+			stack_depths_[ node_index ] = 1;
+			continue;
+		}
 
-				//HACK:
-				//output_.params[ parameter_idx + 0 ] = Vector4_Set( node->box.center, node->box.material_id );
-				__m128i	tmp;
-				tmp.m128i_i32[0] = FloatU32(node->box.center.x);
-				tmp.m128i_i32[1] = FloatU32(node->box.center.y);
-				tmp.m128i_i32[2] = FloatU32(node->box.center.z);
-				tmp.m128i_i32[3] = node->box.material_id;
-				output_.params[ parameter_idx + 0 ] = _mm_castsi128_ps(tmp);
+		NodeIndex	leftChildIdx, rightChildIdx;
+		tree.getOperands( node_index, leftChildIdx, rightChildIdx );
 
-				output_.params[ parameter_idx + 1 ] = Vector4_Set( node->box.extent, 0 );
-				output_.numPrimParams += 2;
-			} break;
+		const U32 left_depth = stack_depths_[ leftChildIdx ];
+		const U32 right_depth = stack_depths_[ rightChildIdx ];
 
-		case NT_INF_CYLINDER:
-			{
-				const CV3f cylAabbMin(
-					node->inf_cylinder.origin.x - node->inf_cylinder.radius,
-					node->inf_cylinder.origin.y - node->inf_cylinder.radius,
-					-HUGE_VAL
-					);
-				const CV3f cylAabbMax(
-					node->inf_cylinder.origin.x + node->inf_cylinder.radius,
-					node->inf_cylinder.origin.y + node->inf_cylinder.radius,
-					+HUGE_VAL
-					);
-				output_.aabbs[ primitive_index ] = AABBf::make( cylAabbMin, cylAabbMax );
-				output_.params[ parameter_idx + 0 ] = Vector4_Set( node->inf_cylinder.origin, node->inf_cylinder.radius );
-				output_.params[ parameter_idx + 1 ] = _mm_castsi128_ps(REPLICATE_I32( node->inf_cylinder.material_id ));
-				output_.numPrimParams += 2;
-			} break;
+		if( nodeType == NT_DIFFERENCE ) {
+			// not commutative - the left operand is always evaluated first
+			stack_depths_[ node_index ] = largest( left_depth, right_depth + 1 );
+		} else {
+			// the deeper operand is evaluated first
+			stack_depths_[ node_index ] = ( left_depth == right_depth ) ? left_depth + 1 : largest( left_depth, right_depth );
+		}
+	}
+}
 
-		case NT_TORUS:
-			{
-				const float torus_outer_radius = node->torus.big_radius + node->torus.small_radius;
-
-				const CV3f torusAabbMin(
-					node->torus.center.x - torus_outer_radius,
-					node->torus.center.y - torus_outer_radius,
-					node->torus.center.z - node->torus.small_radius
-					);
-				const CV3f torusAabbMax(
-					node->torus.center.x + torus_outer_radius,
-					node->torus.center.y + torus_outer_radius,
-					node->torus.center.z + node->torus.small_radius
-					);
-				output_.aabbs[ primitive_index ] = AABBf::make( torusAabbMin, torusAabbMax );
-
-				//HACK:
-				//output_.params[ parameter_idx + 0 ] = Vector4_Set( node->torus.center, node->torus.material_id );
-				__m128i	tmp;
-				tmp.m128i_i32[0] = FloatU32(node->torus.center.x);
-				tmp.m128i_i32[1] = FloatU32(node->torus.center.y);
-				tmp.m128i_i32[2] = FloatU32(node->torus.center.z);
-				tmp.m128i_i32[3] = node->torus.material_id;
-				output_.params[ parameter_idx + 0 ] = _mm_castsi128_ps(tmp);
-
-				output_.params[ parameter_idx + 1 ] = Vector4_Set( node->torus.big_radius, node->torus.small_radius, 0, 0 );
-				output_.numPrimParams += 2;
-			} break;
+static void buildPostOrder_recursive(
+									const BlobTreeSoA& tree,
+									const U32* stack_depths,
+									const NodeIndex node_index,
+									NodeIndex * post_order_,
+									U32 & post_order_length_
+									)
+{
+	const U32 typeAndFlags = tree.types[ node_index ];
+	const NodeType nodeType = NodeType( typeAndFlags & NODE_TYPE_MASK );
 
-		case NT_SINE_WAVE:
-			{
-				mxTODO("calc precise bounds");
-				output_.aabbs[ primitive_index ] = AABBf::make( CV3f(-HUGE_VAL), CV3f(+HUGE_VAL) );
-				output_.params[ parameter_idx ] = Vector4_Set( node->sine_wave.coord_scale, node->sine_wave.material_id );
-				output_.numPrimParams += 1;
-			} break;
+	if( nodeType < NT_FIRST_PRIM_TYPE )
+	{
+		NodeIndex	leftChildIdx, rightChildIdx;
+		tree.getOperands( node_index, leftChildIdx, rightChildIdx );
 
-		case NT_GYROID:
-			{
-				mxTODO("calc precise bounds");
-				output_.aabbs[ primitive_index ] = AABBf::make( CV3f(-HUGE_VAL), CV3f(+HUGE_VAL) );
-				output_.params[ parameter_idx ] = Vector4_Set( node->gyroid.coord_scale, node->gyroid.material_id );
-				output_.numPrimParams += 1;
-			} break;
+		NodeIndex	first_operand = leftChildIdx;
+		NodeIndex	second_operand = rightChildIdx;
 
-			mxDEFAULT_UNREACHABLE(;);
-		}//switch
+		// union and intersection are commutative, so evaluate the deeper subtree first to keep the stack shallow
+		if( nodeType != NT_DIFFERENCE
+			&& stack_depths[ rightChildIdx ] > stack_depths[ leftChildIdx ] )
+		{
+			TSwap( first_operand, second_operand );
+		}
 
-		return primitive_index;
+		buildPostOrder_recursive( tree, stack_depths, first_operand, post_order_, post_order_length_ );
+		buildPostOrder_recursive( tree, stack_depths, second_operand, post_order_, post_order_length_ );
 	}
+
+	post_order_[ post_order_length_++ ] = node_index;
 }
 
 ERet BlobTreeCompiler::compile(
@@ -295,12 +367,16 @@ ERet BlobTreeCompiler::compile(
 	const size_t size_of_types = sizeof(output_.types[0]) * numOpsAndPrims;
 	const size_t size_of_aabbs = sizeof(output_.aabbs[0]) * numOpsAndPrims;
 	const size_t size_of_params = sizeof(output_.params[0]) * total_num_params;
+	const size_t size_of_post_order = sizeof(output_.postOrder[0]) * numOpsAndPrims;
+	const size_t size_of_subtree_sizes = sizeof(output_.subtreeSizes[0]) * numOpsAndPrims;
 
 	const size_t aligned_offset_of_types = 0;
 	const size_t aligned_offset_of_aabbs = SIMD_ALIGN( size_of_types );
 	const size_t aligned_offset_of_params = aligned_offset_of_aabbs + SIMD_ALIGN( size_of_aabbs );
+	const size_t aligned_offset_of_post_order = aligned_offset_of_params + SIMD_ALIGN( size_of_params );
+	const size_t aligned_offset_of_subtree_sizes = aligned_offset_of_post_order + SIMD_ALIGN( size_of_post_order );
 
-	const size_t total_mem_to_alloc = aligned_offset_of_params + SIMD_ALIGN( size_of_params );
+	const size_t total_mem_to_alloc = aligned_offset_of_subtree_sizes + SIMD_ALIGN( size_of_subtree_sizes );
 
 	mxDO(output_.storage.setNum( total_mem_to_alloc ));
 
@@ -309,6 +385,8 @@ ERet BlobTreeCompiler::compile(
 	output_.types = (U32*) mxAddByteOffset( mem_buf_start, aligned_offset_of_types );
 	output_.aabbs = (AABBf*) mxAddByteOffset( mem_buf_start, aligned_offset_of_aabbs );
 	output_.params = (SIMDf*) mxAddByteOffset( mem_buf_start, aligned_offset_of_params );
+	output_.postOrder = (NodeIndex*) mxAddByteOffset( mem_buf_start, aligned_offset_of_post_order );
+	output_.subtreeSizes = (U32*) mxAddByteOffset( mem_buf_start, aligned_offset_of_subtree_sizes );
 	output_.numOps = 0;
 	output_.numPrims = 0;
 	output_.numOpParams = 0;
@@ -318,6 +396,14 @@ ERet BlobTreeCompiler::compile(
 	linearizeBlobTree_recursive( treeInfo, root, output_ );
 	//updateBoundingBoxes_recursive( treeInfo, root, output_ );
 
+	mxDO(_stackDepths.setNum( numOpsAndPrims ));
+	calcStackDepths( output_, _stackDepths.raw() );
+	output_.maxStackDepth = _stackDepths[0];
+
+	U32	post_order_length = 0;
+	buildPostOrder_recursive( output_, _stackDepths.raw(), 0, output_.postOrder, post_order_length );
+	mxASSERT( post_order_length == numOpsAndPrims );
+
 	return ALL_OK;
 }
 
@@ -396,8 +482,8 @@ void evaluate_r(
 		if( isOperator )
 		{
 			//const bool isBinaryOp = true;
-			U32	opParamIdx, leftChildIdx, rightChildIdx;
-			BlobTreeSoA::UnpackOperator( typeAndFlags, opParamIdx, leftChildIdx, rightChildIdx );
+			NodeIndex	leftChildIdx, rightChildIdx;
+			tree.getOperands( current_node, leftChildIdx, rightChildIdx );
 
 			SIMDf_Array left_child_distances, left_child_materials;
 			SIMDf_Array right_child_distances, right_child_materials;
@@ -718,8 +804,8 @@ static void debugDraw_r(
 	if( isOperator )
 	{
 		//const bool isBinaryOp = true;
-		U32	opParamIdx, leftChildIdx, rightChildIdx;
-		BlobTreeSoA::UnpackOperator( typeAndFlags, opParamIdx, leftChildIdx, rightChildIdx );
+		NodeIndex	leftChildIdx, rightChildIdx;
+		tree.getOperands( current_node, leftChildIdx, rightChildIdx );
 
 		debugDraw_r( tree, leftChildIdx, bounding_box, dbg_view );
 		debugDraw_r( tree, rightChildIdx, bounding_box, dbg_view );
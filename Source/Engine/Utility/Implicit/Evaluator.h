@@ -58,9 +58,10 @@ typedef AABBf	AABB;
 
 const U32 NODE_TYPE_MASK = 0x1F;
 
-typedef U32 NodeIndex;
+/// the node type is stored in the lowest bits and the index of the first parameter in the remaining bits
+const U32 NODE_PARAMS_SHIFT = 5;
 
-const NodeIndex NODE_INDEX_MASK = (1u << 9u) - 1u;
+typedef U32 NodeIndex;
 
 struct BlobTreeSoA {
 	///
@@ -81,6 +82,17 @@ struct BlobTreeSoA {
 	U32		numPrimParams;
 
 	UINT	last_index;
+
+	/// Node indices in post-order (children before their parents) for non-recursive evaluation with a stack.
+	/// The operands of unions and intersections are ordered so that the stack stays shallow.
+	NodeIndex *	postOrder;
+
+	/// the number of nodes in the subtree of each node, the subtree occupies [node, node + size) in pre-order
+	U32 *	subtreeSizes;
+
+	/// the maximum number of intermediate results on the stack when evaluating nodes in post-order
+	U32		maxStackDepth;
+
 	NwBlob	storage;	// owns dynamically allocated data
 
 	float	user_param;	// for debugging
@@ -127,27 +139,35 @@ struct BlobTreeSoA {
 
 	BlobTreeSoA( AllocatorI & allocator ) : storage( allocator ) {}
 
-	static U32 PackOp( const NodeType opType_, const U32 opParamIdx_, const NodeIndex leftChildIdx_, const NodeIndex rightChildIdx_ ) {
-		return (rightChildIdx_ << 23) | (leftChildIdx_ << 14) | (opParamIdx_ << 5) | opType_;
+	static U32 PackOp( const NodeType opType_, const U32 opParamIdx_ ) {
+		return (opParamIdx_ << NODE_PARAMS_SHIFT) | opType_;
 	}
-	static mxFORCEINLINE void UnpackOperator( U32 opCode_, U32 &opParamIdx_, NodeIndex &leftChildIdx_, NodeIndex &rightChildIdx_ ) {
-		opParamIdx_ = (opCode_ >> 6) & NODE_INDEX_MASK;
-		leftChildIdx_ = (opCode_ >> 14) & NODE_INDEX_MASK;
-		rightChildIdx_ = (opCode_ >> 23) & NODE_INDEX_MASK;
+	/// Nodes are stored in pre-order: the left operand goes right after the operator, followed by the right operand.
+	mxFORCEINLINE void getOperands( const NodeIndex op_index_, NodeIndex &leftChildIdx_, NodeIndex &rightChildIdx_ ) const {
+		leftChildIdx_ = op_index_ + 1;
+		rightChildIdx_ = leftChildIdx_ + subtreeSizes[ leftChildIdx_ ];
 	}
 
 	static U32 PackPrimitive( const NodeType opType_, const U32 opParamIdx_ ) {
-		return (opParamIdx_ << 5) | opType_;
+		return (opParamIdx_ << NODE_PARAMS_SHIFT) | opType_;
 	}
 	static mxFORCEINLINE void unpackPrimitive( U32 primitive_id_, U32 &first_parameter_index_ ) {
-		first_parameter_index_ = (primitive_id_ >> 5) & 65535;
+		first_parameter_index_ = primitive_id_ >> NODE_PARAMS_SHIFT;
 	}
 };
 
+/// the maximum number of parameters of a primitive
+enum { MAX_PRIMITIVE_PARAMS = 2 };
+
+/// Writes the parameters of the primitive (in the layout expected by the evaluators) and computes its bounds.
+/// Returns the number of written parameters.
+U32 compilePrimitive( const Node& node, SIMDf params_[MAX_PRIMITIVE_PARAMS], AABBf &bounds_ );
+
 class BlobTreeCompiler
 {
 	DynamicArray< Node* >	_nodes;
 	DynamicArray< Node* >	_leaves;
+	DynamicArray< U32 >		_stackDepths;
 
 public:
 	BlobTreeCompiler( AllocatorI & scratchpad );
@@ -198,6 +218,99 @@ void evaluate(
 			  Array_of_I32 &materials_
 			  );
 
+/*
+=======================================================================
+	Wide evaluation (SSE4/AVX2/AVX-512)
+=======================================================================
+*/
+
+/// Instruction sets supported by evaluateWide().
+enum EEvaluatorISA
+{
+	EvaluatorISA_SSE4,		//!< 4 points per instruction
+	EvaluatorISA_AVX2,		//!< 8 points per instruction
+	EvaluatorISA_AVX512,	//!< 16 points per instruction
+	EvaluatorISA_COUNT
+};
+
+/// Returns true if both the compiler and the CPU (checked via CPUID) support the instruction set.
+bool isEvaluatorISASupported( const EEvaluatorISA isa );
+
+/// Returns the widest supported instruction set, the result is cached.
+EEvaluatorISA getBestEvaluatorISA();
+
+const char* getEvaluatorISAName( const EEvaluatorISA isa );
+
+/// The same as evaluate(), but runs over the post-order sequence of nodes without recursion
+/// and processes 4, 8 or 16 points at once depending on the instruction set.
+/// Subtrees whose bounds don't intersect the bounding box are skipped.
+void evaluateWide(
+				  const BlobTreeSoA& tree,
+				  const AABBf& bounding_box,	//!< region of interest
+				  const UINT number_of_points,
+				  const V3f_SoA& positions_,
+				  Array_of_F32 &distances_,
+				  Array_of_I32 &materials_,
+				  const EEvaluatorISA isa
+				  );
+
+/*
+=======================================================================
+	Tape pruning with interval arithmetic
+=======================================================================
+*/
+
+/// A tape is a sequence of instructions for a stack machine which computes the BlobTree inside some region.
+/// The tape of a region is derived from the tape of the parent region by bounding each node's distances with intervals
+/// and removing operands which cannot affect the result (e.g. a sphere which is always farther than the other operand of a union).
+typedef U32 TapeInstruction;
+
+enum ETapeOpCode
+{
+	TapeOp_EvaluateNode,	//!< primitives push their values, operators combine the two topmost values
+	TapeOp_PushEmpty,		//!< push empty space (the subtree is culled)
+	TapeOp_Negate,			//!< negate the topmost distances and clear materials (remains of a difference)
+	TapeOp_Solidify,		//!< set materials to 1 where distances <= 0 (remains of an intersection)
+};
+
+const U32 TAPE_OPCODE_SHIFT = 28;
+const U32 TAPE_NODE_INDEX_MASK = (1u << TAPE_OPCODE_SHIFT) - 1u;
+
+mxFORCEINLINE TapeInstruction makeTapeInstruction( const ETapeOpCode op_code, const NodeIndex node_index = 0 ) {
+	return (op_code << TAPE_OPCODE_SHIFT) | node_index;
+}
+
+/// Writes the nodes in post-order into the tape, the tape must have room for (numOps + numPrims) instructions.
+/// Returns the length of the tape.
+U32 initializeTape(
+				   const BlobTreeSoA& tree,
+				   TapeInstruction * tape_
+				   );
+
+/// Creates the tape for the region from the tape of the enclosing region (or from the initial tape).
+/// Evaluating the new tape inside the region gives the same results as evaluate() with this region as the bounding box.
+/// Returns the length of the new tape, which is never longer than the parent tape.
+U32 refineTape(
+			   const BlobTreeSoA& tree,
+			   const TapeInstruction* parent_tape,
+			   const U32 parent_tape_length,
+			   const AABBf& region,
+			   TapeInstruction * tape_	//!< can be the same as the parent tape
+			   );
+
+/// Computes distances and materials for points inside the region the tape was created for.
+void evaluateTape(
+				  const BlobTreeSoA& tree,
+				  const TapeInstruction* tape,
+				  const U32 tape_length,
+				  const AABBf& region,	//!< the region of the tape, used if the tree is too deep for evaluating the tape
+				  const UINT number_of_points,
+				  const V3f_SoA& positions_,
+				  Array_of_F32 &distances_,
+				  Array_of_I32 &materials_,
+				  const EEvaluatorISA isa
+				  );
+
 void debugDrawBoundingBoxes(
 			  const BlobTreeSoA& tree,
 			  const AABBf& bounding_box,
@@ -232,3 +345,31 @@ void projectVerticesOntoSurface(
 						);
 
 }//namespace implicit
+
+/*
+-----------------------------------------------------------------------------
+	UNIT TESTS
+-----------------------------------------------------------------------------
+*/
+
+#if MX_DEVELOPER
+
+namespace implicit
+{
+	/// Evaluates several test trees on a dense grid with evaluate() and evaluateWide() (for each supported instruction set),
+	/// checks that the results are the same and prints the number of points evaluated per second.
+	ERet Benchmark_EvaluateWide(
+		AllocatorI & scratchpad
+		, const U32 resolution = 128	//!< the grid has resolution^3 points
+		);
+
+	/// Evaluates a tree with hundreds of edits with and without tape pruning (subdividing the grid like an octree)
+	/// and checks that the results are the same.
+	ERet Benchmark_TapePruning(
+		AllocatorI & scratchpad
+		, const U32 resolution = 128	//!< the grid has resolution^3 points, must be a power of two
+		, const U32 number_of_edits = 200
+		);
+}//namespace implicit
+
+#endif // MX_DEVELOPER
@@ -0,0 +1,1098 @@
+// Non-recursive BlobTree evaluation templated on the SIMD width (SSE4, AVX2, AVX-512).
+#include "Base/Base.h"
+#pragma hdrstop
+#include <immintrin.h>
+#include <Core/Util/ScopedTimer.h>
+#include <Implicit/Evaluator.h>
+#include <Implicit/BlobProgram.h>
+
+/// MSVC allows using AVX intrinsics without /arch:AVX, other compilers need the target to be enabled.
+#if defined(__AVX2__) || (defined(_MSC_VER) && _MSC_VER >= 1700)
+	#define IMPLICIT_WITH_AVX2		(1)
+#else
+	#define IMPLICIT_WITH_AVX2		(0)
+#endif
+
+#if defined(__AVX512F__) || (defined(_MSC_VER) && _MSC_VER >= 1911)
+	#define IMPLICIT_WITH_AVX512	(1)
+#else
+	#define IMPLICIT_WITH_AVX512	(0)
+#endif
+
+namespace implicit {
+
+/// the same values as in Evaluator.cpp
+#define INFINITE_DISTANCE	(FLT_MAX)
+#define EMPTY_MATERIAL_ID	(0)
+
+namespace
+{
+	/// the maximum number of intermediate results, deeper trees are evaluated recursively
+	enum { MAX_EVAL_STACK_DEPTH = 32 };
+
+	/// the maximum number of nodes, bigger trees are evaluated recursively (BlobProgram should be used for them)
+	enum { MAX_TREE_NODES = 4096 };
+
+	/// marks post-order positions which are not the first node of a culled subtree
+	const U16 NOT_CULLED = 0xFFFF;
+
+	/// Intermediate results of the stack machine.
+	/// The final result ends up at the bottom of the stack, so the output arrays are used as the first slot.
+	struct OperandStack
+	{
+		F32 *	distances[ MAX_EVAL_STACK_DEPTH ];
+		U32 *	materials[ MAX_EVAL_STACK_DEPTH ];
+		U32		size;
+
+		Array_of_F32	distances_storage[ MAX_EVAL_STACK_DEPTH - 1 ];
+		Array_of_I32	materials_storage[ MAX_EVAL_STACK_DEPTH - 1 ];
+
+	public:
+		OperandStack( F32 * output_distances_, U32 * output_materials_, const U32 max_depth )
+		{
+			mxASSERT( max_depth <= MAX_EVAL_STACK_DEPTH );
+			distances[0] = output_distances_;
+			materials[0] = output_materials_;
+			for( U32 i = 1; i < max_depth; i++ ) {
+				distances[i] = distances_storage[ i - 1 ];
+				materials[i] = materials_storage[ i - 1 ];
+			}
+			size = 0;
+		}
+	};
+
+	/*
+	-----------------------------------------------------------------------------
+		SIMD backends.
+		All backends perform the same operations in the same order
+		(no FMA, no approximations), so that they give the same results as evaluate().
+	-----------------------------------------------------------------------------
+	*/
+
+	struct Packet_SSE4
+	{
+		typedef __m128	F;
+		typedef __m128i	I;
+		typedef __m128	Mask;
+		enum { WIDTH = 4 };
+
+		static mxFORCEINLINE F Splat( const F32 x ) { return _mm_set1_ps( x ); }
+		static mxFORCEINLINE F Load( const F32* p ) { return _mm_loadu_ps( p ); }
+		static mxFORCEINLINE void Store( F32* p, const F& v ) { _mm_storeu_ps( p, v ); }
+
+		static mxFORCEINLINE F Add( const F& a, const F& b ) { return _mm_add_ps( a, b ); }
+		static mxFORCEINLINE F Sub( const F& a, const F& b ) { return _mm_sub_ps( a, b ); }
+		static mxFORCEINLINE F Mul( const F& a, const F& b ) { return _mm_mul_ps( a, b ); }
+		static mxFORCEINLINE F Min( const F& a, const F& b ) { return _mm_min_ps( a, b ); }
+		static mxFORCEINLINE F Max( const F& a, const F& b ) { return _mm_max_ps( a, b ); }
+		static mxFORCEINLINE F Sqrt( const F& a ) { return _mm_sqrt_ps( a ); }
+		static mxFORCEINLINE F Abs( const F& a ) { return _mm_and_ps( a, _mm_castsi128_ps( _mm_set1_epi32( 0x7FFFFFFF ) ) ); }
+		static mxFORCEINLINE F Negate( const F& a ) { return _mm_xor_ps( a, _mm_set1_ps( -0.0f ) ); }
+		static mxFORCEINLINE Mask CmpLE( const F& a, const F& b ) { return _mm_cmple_ps( a, b ); }
+
+		static mxFORCEINLINE I SplatI( const U32 x ) { return _mm_set1_epi32( x ); }
+		static mxFORCEINLINE I LoadI( const U32* p ) { return _mm_loadu_si128( (const __m128i*) p ); }
+		static mxFORCEINLINE void StoreI( U32* p, const I& v ) { _mm_storeu_si128( (__m128i*) p, v ); }
+		static mxFORCEINLINE I MaxI( const I& a, const I& b ) { return _mm_max_epi32( a, b ); }
+		/// returns (mask ? a : b)
+		static mxFORCEINLINE I SelectI( const Mask& mask, const I& a, const I& b ) {
+			return _mm_castps_si128( _mm_blendv_ps( _mm_castsi128_ps( b ), _mm_castsi128_ps( a ), mask ) );
+		}
+	};
+
+#if IMPLICIT_WITH_AVX2
+
+	struct Packet_AVX2
+	{
+		typedef __m256	F;
+		typedef __m256i	I;
+		typedef __m256	Mask;
+		enum { WIDTH = 8 };
+
+		static mxFORCEINLINE F Splat( const F32 x ) { return _mm256_set1_ps( x ); }
+		static mxFORCEINLINE F Load( const F32* p ) { return _mm256_loadu_ps( p ); }
+		static mxFORCEINLINE void Store( F32* p, const F& v ) { _mm256_storeu_ps( p, v ); }
+
+		static mxFORCEINLINE F Add( const F& a, const F& b ) { return _mm256_add_ps( a, b ); }
+		static mxFORCEINLINE F Sub( const F& a, const F& b ) { return _mm256_sub_ps( a, b ); }
+		static mxFORCEINLINE F Mul( const F& a, const F& b ) { return _mm256_mul_ps( a, b ); }
+		static mxFORCEINLINE F Min( const F& a, const F& b ) { return _mm256_min_ps( a, b ); }
+		static mxFORCEINLINE F Max( const F& a, const F& b ) { return _mm256_max_ps( a, b ); }
+		static mxFORCEINLINE F Sqrt( const F& a ) { return _mm256_sqrt_ps( a ); }
+		static mxFORCEINLINE F Abs( const F& a ) { return _mm256_and_ps( a, _mm256_castsi256_ps( _mm256_set1_epi32( 0x7FFFFFFF ) ) ); }
+		static mxFORCEINLINE F Negate( const F& a ) { return _mm256_xor_ps( a, _mm256_set1_ps( -0.0f ) ); }
+		static mxFORCEINLINE Mask CmpLE( const F& a, const F& b ) { return _mm256_cmp_ps( a, b, _CMP_LE_OS ); }
+
+		static mxFORCEINLINE I SplatI( const U32 x ) { return _mm256_set1_epi32( x ); }
+		static mxFORCEINLINE I LoadI( const U32* p ) { return _mm256_loadu_si256( (const __m256i*) p ); }
+		static mxFORCEINLINE void StoreI( U32* p, const I& v ) { _mm256_storeu_si256( (__m256i*) p, v ); }
+		static mxFORCEINLINE I MaxI( const I& a, const I& b ) { return _mm256_max_epi32( a, b ); }
+		static mxFORCEINLINE I SelectI( const Mask& mask, const I& a, const I& b ) {
+			return _mm256_castps_si256( _mm256_blendv_ps( _mm256_castsi256_ps( b ), _mm256_castsi256_ps( a ), mask ) );
+		}
+	};
+
+#endif // IMPLICIT_WITH_AVX2
+
+#if IMPLICIT_WITH_AVX512
+
+	/// uses only AVX-512F instructions (bitwise float ops need AVX-512DQ, so they are done on integers)
+	struct Packet_AVX512
+	{
+		typedef __m512		F;
+		typedef __m512i		I;
+		typedef __mmask16	Mask;
+		enum { WIDTH = 16 };
+
+		static mxFORCEINLINE F Splat( const F32 x ) { return _mm512_set1_ps( x ); }
+		static mxFORCEINLINE F Load( const F32* p ) { return _mm512_loadu_ps( p ); }
+		static mxFORCEINLINE void Store( F32* p, const F& v ) { _mm512_storeu_ps( p, v ); }
+
+		static mxFORCEINLINE F Add( const F& a, const F& b ) { return _mm512_add_ps( a, b ); }
+		static mxFORCEINLINE F Sub( const F& a, const F& b ) { return _mm512_sub_ps( a, b ); }
+		static mxFORCEINLINE F Mul( const F& a, const F& b ) { return _mm512_mul_ps( a, b ); }
+		static mxFORCEINLINE F Min( const F& a, const F& b ) { return _mm512_min_ps( a, b ); }
+		static mxFORCEINLINE F Max( const F& a, const F& b ) { return _mm512_max_ps( a, b ); }
+		static mxFORCEINLINE F Sqrt( const F& a ) { return _mm512_sqrt_ps( a ); }
+		static mxFORCEINLINE F Abs( const F& a ) {
+			return _mm512_castsi512_ps( _mm512_and_si512( _mm512_castps_si512( a ), _mm512_set1_epi32( 0x7FFFFFFF ) ) );
+		}
+		static mxFORCEINLINE F Negate( const F& a ) {
+			return _mm512_castsi512_ps( _mm512_xor_si512( _mm512_castps_si512( a ), _mm512_set1_epi32( 0x80000000 ) ) );
+		}
+		static mxFORCEINLINE Mask CmpLE( const F& a, const F& b ) { return _mm512_cmp_ps_mask( a, b, _CMP_LE_OS ); }
+
+		static mxFORCEINLINE I SplatI( const U32 x ) { return _mm512_set1_epi32( x ); }
+		static mxFORCEINLINE I LoadI( const U32* p ) { return _mm512_loadu_si512( p ); }
+		static mxFORCEINLINE void StoreI( U32* p, const I& v ) { _mm512_storeu_si512( p, v ); }
+		static mxFORCEINLINE I MaxI( const I& a, const I& b ) { return _mm512_max_epi32( a, b ); }
+		static mxFORCEINLINE I SelectI( const Mask& mask, const I& a, const I& b ) { return _mm512_mask_blend_epi32( mask, b, a ); }
+	};
+
+#endif // IMPLICIT_WITH_AVX512
+
+	/*
+	-----------------------------------------------------------------------------
+		Width-generic evaluator.
+	-----------------------------------------------------------------------------
+	*/
+
+	template< class PACKET >
+	struct WideEvaluator
+	{
+		typedef typename PACKET::F		F;
+		typedef typename PACKET::I		I;
+		typedef typename PACKET::Mask	Mask;
+
+		static mxFORCEINLINE F Length2( const F& xs, const F& ys )
+		{
+			return PACKET::Sqrt( PACKET::Add( PACKET::Mul( xs, xs ), PACKET::Mul( ys, ys ) ) );
+		}
+
+		static mxFORCEINLINE F Length3( const F& xs, const F& ys, const F& zs )
+		{
+			return PACKET::Sqrt( PACKET::Add( PACKET::Add( PACKET::Mul( xs, xs ), PACKET::Mul( ys, ys ) ), PACKET::Mul( zs, zs ) ) );
+		}
+
+		/// stores the distances and sets the materials of the points inside the primitive
+		static mxFORCEINLINE void StoreLeafResult(
+			const F& distances, const I& primitive_material,
+			F32 * distances_, U32 * materials_
+			)
+		{
+			PACKET::Store( distances_, distances );
+			const Mask inside = PACKET::CmpLE( distances, PACKET::Splat( 0 ) );
+			PACKET::StoreI( materials_, PACKET::SelectI( inside, primitive_material, PACKET::SplatI( EMPTY_MATERIAL_ID ) ) );
+		}
+
+		static void EvaluatePrimitive(
+			const SIMDf* params,
+			const NodeType node_type,
+			const U32 first_parameter_index,
+			const UINT number_of_packets,
+			const V3f_SoA& positions,
+			F32 * distances_,
+			U32 * materials_
+			)
+		{
+			const F32* param0 = (const F32*) &params[ first_parameter_index ];
+			const U32* param0_as_ints = (const U32*) param0;
+
+			switch( node_type )
+			{
+			case NT_PLANE:
+				{
+					const F plane_normal_x = PACKET::Splat( param0[0] );
+					const F plane_normal_y = PACKET::Splat( param0[1] );
+					const F plane_normal_z = PACKET::Splat( param0[2] );
+					const F plane_d = PACKET::Splat( param0[3] );
+					const I primitive_material = PACKET::SplatI( ((const U32*) &params[ first_parameter_index + 1 ])[0] );
+
+					mxUINT_LOOP_i( number_of_packets )
+					{
+						const UINT offset = i * PACKET::WIDTH;
+						const F tmp0 = PACKET::Add( PACKET::Mul( plane_normal_x, PACKET::Load( positions.xs + offset ) ), PACKET::Mul( plane_normal_y, PACKET::Load( positions.ys + offset ) ) );
+						const F tmp1 = PACKET::Add( PACKET::Mul( plane_normal_z, PACKET::Load( positions.zs + offset ) ), plane_d );
+						StoreLeafResult( PACKET::Add( tmp0, tmp1 ), primitive_material, distances_ + offset, materials_ + offset );
+					}
+				} break;
+
+			case NT_SPHERE:
+				{
+					const F sphere_center_x = PACKET::Splat( param0[0] );
+					const F sphere_center_y = PACKET::Splat( param0[1] );
+					const F sphere_center_z = PACKET::Splat( param0[2] );
+					const F sphere_radius = PACKET::Splat( param0[3] );
+					const I primitive_material = PACKET::SplatI( ((const U32*) &params[ first_parameter_index + 1 ])[0] );
+
+					mxUINT_LOOP_i( number_of_packets )
+					{
+						const UINT offset = i * PACKET::WIDTH;
+						const F local_pos_x = PACKET::Sub( PACKET::Load( positions.xs + offset ), sphere_center_x );
+						const F local_pos_y = PACKET::Sub( PACKET::Load( positions.ys + offset ), sphere_center_y );
+						const F local_pos_z = PACKET::Sub( PACKET::Load( positions.zs + offset ), sphere_center_z );
+						const F distances = PACKET::Sub( Length3( local_pos_x, local_pos_y, local_pos_z ), sphere_radius );
+						StoreLeafResult( distances, primitive_material, distances_ + offset, materials_ + offset );
+					}
+				} break;
+
+			case NT_BOX:
+				{
+					const F box_center_x = PACKET::Splat( param0[0] );
+					const F box_center_y = PACKET::Splat( param0[1] );
+					const F box_center_z = PACKET::Splat( param0[2] );
+					const I primitive_material = PACKET::SplatI( param0_as_ints[3] );
+
+					const F32* param1 = (const F32*) &params[ first_parameter_index + 1 ];
+					const F box_extent_x = PACKET::Splat( param1[0] );
+					const F box_extent_y = PACKET::Splat( param1[1] );
+					const F box_extent_z = PACKET::Splat( param1[2] );
+
+					const F zero = PACKET::Splat( 0 );
+
+					mxUINT_LOOP_i( number_of_packets )
+					{
+						const UINT offset = i * PACKET::WIDTH;
+						const F d_x = PACKET::Sub( PACKET::Abs( PACKET::Sub( PACKET::Load( positions.xs + offset ), box_center_x ) ), box_extent_x );
+						const F d_y = PACKET::Sub( PACKET::Abs( PACKET::Sub( PACKET::Load( positions.ys + offset ), box_center_y ) ), box_extent_y );
+						const F d_z = PACKET::Sub( PACKET::Abs( PACKET::Sub( PACKET::Load( positions.zs + offset ), box_center_z ) ), box_extent_z );
+
+						// length(max(d, 0)) + vmax(min(d, 0))
+						const F lengths = Length3( PACKET::Max( d_x, zero ), PACKET::Max( d_y, zero ), PACKET::Max( d_z, zero ) );
+						const F vmax = PACKET::Max( PACKET::Min( d_x, zero ), PACKET::Max( PACKET::Min( d_y, zero ), PACKET::Min( d_z, zero ) ) );
+
+						StoreLeafResult( PACKET::Add( lengths, vmax ), primitive_material, distances_ + offset, materials_ + offset );
+					}
+				} break;
+
+			case NT_INF_CYLINDER:
+				{
+					const F cyl_center_x = PACKET::Splat( param0[0] );
+					const F cyl_center_y = PACKET::Splat( param0[1] );
+					const F cyl_radius = PACKET::Splat( param0[3] );
+					const I primitive_material = PACKET::SplatI( ((const U32*) &params[ first_parameter_index + 1 ])[0] );
+
+					mxUINT_LOOP_i( number_of_packets )
+					{
+						const UINT offset = i * PACKET::WIDTH;
+						const F local_pos_x = PACKET::Sub( PACKET::Load( positions.xs + offset ), cyl_center_x );
+						const F local_pos_y = PACKET::Sub( PACKET::Load( positions.ys + offset ), cyl_center_y );
+						const F distances = PACKET::Sub( Length2( local_pos_x, local_pos_y ), cyl_radius );
+						StoreLeafResult( distances, primitive_material, distances_ + offset, materials_ + offset );
+					}
+				} break;
+
+			case NT_TORUS:
+				{
+					const F torus_center_x = PACKET::Splat( param0[0] );
+					const F torus_center_y = PACKET::Splat( param0[1] );
+					const F torus_center_z = PACKET::Splat( param0[2] );
+					const I primitive_material = PACKET::SplatI( param0_as_ints[3] );
+
+					const F32* param1 = (const F32*) &params[ first_parameter_index + 1 ];
+					const F torus_outer_radius = PACKET::Splat( param1[0] );
+					const F torus_inner_radius = PACKET::Splat( param1[1] );
+
+					mxUINT_LOOP_i( number_of_packets )
+					{
+						const UINT offset = i * PACKET::WIDTH;
+						const F local_pos_x = PACKET::Sub( PACKET::Load( positions.xs + offset ), torus_center_x );
+						const F local_pos_y = PACKET::Sub( PACKET::Load( positions.ys + offset ), torus_center_y );
+						const F local_pos_z = PACKET::Sub( PACKET::Load( positions.zs + offset ), torus_center_z );
+
+						const F tmp1 = PACKET::Sub( Length2( local_pos_x, local_pos_y ), torus_outer_radius );
+						const F distances = PACKET::Sub( Length2( tmp1, local_pos_z ), torus_inner_radius );
+						StoreLeafResult( distances, primitive_material, distances_ + offset, materials_ + offset );
+					}
+				} break;
+
+			// no vectorized sin/cos yet, the same scalar code as in evaluate() is used
+
+			case NT_SINE_WAVE:
+				{
+					const F32 x_scale = param0[0];
+					const F32 y_scale = param0[1];
+					const F32 z_scale = param0[2];
+
+					const UINT number_of_points = number_of_packets * PACKET::WIDTH;
+					mxUINT_LOOP_i( number_of_points )
+					{
+						const float x = positions.xs[i] * x_scale;
+						const float y = positions.ys[i] * y_scale;
+						const float z = positions.zs[i] * z_scale;
+						const float height = sinf( sqrtf( squaref(x) + squaref(y) ) );
+						distances_[i] = z - height;
+						materials_[i] = distances_[i] <= 0 ? 1 : 0;
+					}
+				} break;
+
+			case NT_GYROID:
+				{
+					const F32 x_scale = param0[0];
+					const F32 y_scale = param0[1];
+					const F32 z_scale = param0[2];
+
+					const UINT number_of_points = number_of_packets * PACKET::WIDTH;
+					mxUINT_LOOP_i( number_of_points )
+					{
+						float sx, cx, sy, cy, sz, cz;
+						mmSinCos( positions.xs[i] * x_scale, sx, cx );
+						mmSinCos( positions.ys[i] * y_scale, sy, cy );
+						mmSinCos( positions.zs[i] * z_scale, sz, cz );
+						distances_[i] = 2.0 * (cx * sy + cy * sz + cz * sx);
+						materials_[i] = distances_[i] <= 0 ? 1 : 0;
+					}
+				} break;
+
+				mxDEFAULT_UNREACHABLE(;);
+			}//switch
+		}
+
+		/// combines two operands, the result is written over the first one
+		static void EvaluateOperator(
+			const NodeType node_type,
+			const UINT number_of_packets,
+			F32 * first_distances_, U32 * first_materials_,
+			const F32 * second_distances, const U32 * second_materials
+			)
+		{
+			const F zero = PACKET::Splat( 0 );
+			const I empty_material = PACKET::SplatI( EMPTY_MATERIAL_ID );
+
+			switch( node_type )
+			{
+			case NT_UNION:
+				mxUINT_LOOP_i( number_of_packets ) {
+					const UINT offset = i * PACKET::WIDTH;
+					PACKET::Store( first_distances_ + offset, PACKET::Min( PACKET::Load( first_distances_ + offset ), PACKET::Load( second_distances + offset ) ) );
+					PACKET::StoreI( first_materials_ + offset, PACKET::MaxI( PACKET::LoadI( first_materials_ + offset ), PACKET::LoadI( second_materials + offset ) ) );
+				}
+				break;
+
+			case NT_DIFFERENCE:
+				mxUINT_LOOP_i( number_of_packets ) {
+					const UINT offset = i * PACKET::WIDTH;
+					const F distances = PACKET::Max( PACKET::Load( first_distances_ + offset ), PACKET::Negate( PACKET::Load( second_distances + offset ) ) );
+					PACKET::Store( first_distances_ + offset, distances );
+					const Mask inside = PACKET::CmpLE( distances, zero );
+					PACKET::StoreI( first_materials_ + offset, PACKET::SelectI( inside, PACKET::LoadI( first_materials_ + offset ), empty_material ) );
+				}
+				break;
+
+			case NT_INTERSECTION:
+				{
+					const I default_material = PACKET::SplatI( 1 );
+					mxUINT_LOOP_i( number_of_packets ) {
+						const UINT offset = i * PACKET::WIDTH;
+						const F distances = PACKET::Max( PACKET::Load( first_distances_ + offset ), PACKET::Load( second_distances + offset ) );
+						PACKET::Store( first_distances_ + offset, distances );
+						const Mask inside = PACKET::CmpLE( distances, zero );
+						PACKET::StoreI( first_materials_ + offset, PACKET::SelectI( inside, default_material, empty_material ) );
+					}
+				} break;
+
+				mxDEFAULT_UNREACHABLE(;);
+			}
+		}
+
+		static void StoreEmpty( const UINT number_of_packets, F32 * distances_, U32 * materials_ )
+		{
+			const F infinite_distance = PACKET::Splat( INFINITE_DISTANCE );
+			const I empty_material = PACKET::SplatI( EMPTY_MATERIAL_ID );
+			mxUINT_LOOP_i( number_of_packets ) {
+				PACKET::Store( distances_ + i * PACKET::WIDTH, infinite_distance );
+				PACKET::StoreI( materials_ + i * PACKET::WIDTH, empty_material );
+			}
+		}
+
+		static void PushEmpty( const UINT number_of_packets, OperandStack & stack )
+		{
+			StoreEmpty( number_of_packets, stack.distances[ stack.size ], stack.materials[ stack.size ] );
+			stack.size++;
+		}
+
+		static mxFORCEINLINE void EvaluateNode(
+			const BlobTreeSoA& tree,
+			const NodeIndex node_index,
+			const UINT number_of_packets,
+			const V3f_SoA& positions,
+			OperandStack & stack
+			)
+		{
+			const U32 type_and_flags = tree.types[ node_index ];
+			const NodeType node_type = NodeType( type_and_flags & NODE_TYPE_MASK );
+
+			if( node_type < NT_FIRST_PRIM_TYPE )
+			{
+				mxASSERT( stack.size >= 2 );
+				stack.size--;
+				EvaluateOperator(
+					node_type, number_of_packets,
+					stack.distances[ stack.size - 1 ], stack.materials[ stack.size - 1 ],
+					stack.distances[ stack.size ], stack.materials[ stack.size ]
+				);
+			}
+			else
+			{
+				U32	first_parameter_index;
+				BlobTreeSoA::unpackPrimitive( type_and_flags, first_parameter_index );
+
+				EvaluatePrimitive(
+					tree.params, node_type, first_parameter_index, number_of_packets, positions,
+					stack.distances[ stack.size ], stack.materials[ stack.size ]
+				);
+				stack.size++;
+			}
+		}
+
+		/// the remaining operand of a difference which is always inside the subtracted shape
+		static void Negate( const UINT number_of_packets, OperandStack & stack )
+		{
+			mxASSERT( stack.size >= 1 );
+			F32 * distances_ = stack.distances[ stack.size - 1 ];
+			U32 * materials_ = stack.materials[ stack.size - 1 ];
+			const I empty_material = PACKET::SplatI( EMPTY_MATERIAL_ID );
+			mxUINT_LOOP_i( number_of_packets ) {
+				const UINT offset = i * PACKET::WIDTH;
+				PACKET::Store( distances_ + offset, PACKET::Negate( PACKET::Load( distances_ + offset ) ) );
+				PACKET::StoreI( materials_ + offset, empty_material );
+			}
+		}
+
+		/// the remaining operand of an intersection which is always farther than the other one
+		static void Solidify( const UINT number_of_packets, OperandStack & stack )
+		{
+			mxASSERT( stack.size >= 1 );
+			F32 * distances_ = stack.distances[ stack.size - 1 ];
+			U32 * materials_ = stack.materials[ stack.size - 1 ];
+			const F zero = PACKET::Splat( 0 );
+			const I default_material = PACKET::SplatI( 1 );
+			const I empty_material = PACKET::SplatI( EMPTY_MATERIAL_ID );
+			mxUINT_LOOP_i( number_of_packets ) {
+				const UINT offset = i * PACKET::WIDTH;
+				const Mask inside = PACKET::CmpLE( PACKET::Load( distances_ + offset ), zero );
+				PACKET::StoreI( materials_ + offset, PACKET::SelectI( inside, default_material, empty_material ) );
+			}
+		}
+
+		static void Evaluate(
+			const BlobTreeSoA& tree,
+			const AABBf& bounding_box,
+			const UINT number_of_points,
+			const V3f_SoA& positions,
+			Array_of_F32 &distances_,
+			Array_of_I32 &materials_
+			)
+		{
+			mxSTATIC_ASSERT( MAX_POINTS % PACKET::WIDTH == 0 );
+			const UINT number_of_packets = getNumBatches( number_of_points, PACKET::WIDTH );
+
+			const U32 num_nodes = tree.numOps + tree.numPrims;
+			mxASSERT( num_nodes <= MAX_TREE_NODES );
+			mxASSERT( tree.maxStackDepth <= MAX_EVAL_STACK_DEPTH );
+
+			// Cull subtrees. The reversed post-order visits each node before its descendants
+			// and the subtree of the node at position i occupies positions [i - subtree size + 1, i],
+			// so culled subtrees can be skipped in both passes.
+			// culled_subtree_end[i] is the position of the root of the culled subtree starting at i.
+			U16	culled_subtree_end[ MAX_TREE_NODES ];
+			for( int i = num_nodes - 1; i >= 0; )
+			{
+				const NodeIndex node_index = tree.postOrder[ i ];
+				if( tree.aabbs[ node_index ].intersects( bounding_box ) ) {
+					culled_subtree_end[ i-- ] = NOT_CULLED;
+				} else {
+					const int subtree_start = i - (int) tree.subtreeSizes[ node_index ] + 1;
+					culled_subtree_end[ subtree_start ] = i;
+					i = subtree_start - 1;
+				}
+			}
+
+			// Evaluate nodes in post-order: leaves push their results, binary operators pop two operands and push the result.
+			OperandStack	stack( distances_, materials_, tree.maxStackDepth );
+
+			for( U32 i = 0; i < num_nodes; i++ )
+			{
+				if( culled_subtree_end[ i ] != NOT_CULLED ) {
+					PushEmpty( number_of_packets, stack );
+					i = culled_subtree_end[ i ];
+					continue;
+				}
+				EvaluateNode( tree, tree.postOrder[ i ], number_of_packets, positions, stack );
+			}
+
+			mxASSERT( stack.size == 1 );
+		}
+
+		static void EvaluateTape(
+			const BlobTreeSoA& tree,
+			const TapeInstruction* tape,
+			const U32 tape_length,
+			const UINT number_of_points,
+			const V3f_SoA& positions,
+			Array_of_F32 &distances_,
+			Array_of_I32 &materials_
+			)
+		{
+			const UINT number_of_packets = getNumBatches( number_of_points, PACKET::WIDTH );
+
+			OperandStack	stack( distances_, materials_, tree.maxStackDepth );
+
+			for( U32 i = 0; i < tape_length; i++ )
+			{
+				const TapeInstruction instruction = tape[ i ];
+				switch( instruction >> TAPE_OPCODE_SHIFT )
+				{
+				case TapeOp_EvaluateNode:
+					EvaluateNode( tree, instruction & TAPE_NODE_INDEX_MASK, number_of_packets, positions, stack );
+					break;
+
+				case TapeOp_PushEmpty:
+					PushEmpty( number_of_packets, stack );
+					break;
+
+				case TapeOp_Negate:
+					Negate( number_of_packets, stack );
+					break;
+
+				case TapeOp_Solidify:
+					Solidify( number_of_packets, stack );
+					break;
+
+					mxDEFAULT_UNREACHABLE(;);
+				}
+			}
+
+			mxASSERT( stack.size == 1 );
+		}
+
+		/// Computes the value of the program (and all values it depends on) for the points inside the bounding box.
+		/// Shared values are computed only once per region.
+		static void EvaluateValue(
+			const BlobProgram& program,
+			BlobProgramContext & context,
+			const U32 value,
+			const AABBf& bounding_box,
+			const UINT number_of_packets,
+			const V3f_SoA& positions,
+			F32 * distances_,
+			U32 * materials_
+			)
+		{
+			if( !program.valueBounds[ value ].intersects( bounding_box ) ) {
+				StoreEmpty( number_of_packets, distances_, materials_ );
+				return;
+			}
+
+			const U32 number_of_points = number_of_packets * PACKET::WIDTH;
+
+			const U32 cache_slot = program.valueCacheSlots[ value ];
+			if( cache_slot != ~0u && context.cacheStamps[ cache_slot ] == context.currentStamp )
+			{
+				const CachedValue& cached = context.cachedValues[ cache_slot ];
+				memcpy( distances_, cached.distances, number_of_points * sizeof(distances_[0]) );
+				memcpy( materials_, cached.materials, number_of_points * sizeof(materials_[0]) );
+				return;
+			}
+
+			const ProgramInstruction& instruction = program.instructions[ value ];
+			const NodeType node_type = NodeType( instruction.type );
+
+			if( node_type < NT_FIRST_PRIM_TYPE )
+			{
+				Array_of_F32	second_distances;
+				Array_of_I32	second_materials;
+				EvaluateValue( program, context, instruction.operands[0], bounding_box, number_of_packets, positions, distances_, materials_ );
+				EvaluateValue( program, context, instruction.operands[1], bounding_box, number_of_packets, positions, second_distances, second_materials );
+				EvaluateOperator( node_type, number_of_packets, distances_, materials_, second_distances, second_materials );
+			}
+			else
+			{
+				EvaluatePrimitive( program.params.raw(), node_type, instruction.operands[0], number_of_packets, positions, distances_, materials_ );
+			}
+
+			if( cache_slot != ~0u )
+			{
+				CachedValue & cached = context.cachedValues[ cache_slot ];
+				memcpy( cached.distances, distances_, number_of_points * sizeof(distances_[0]) );
+				memcpy( cached.materials, materials_, number_of_points * sizeof(materials_[0]) );
+				context.cacheStamps[ cache_slot ] = context.currentStamp;
+			}
+		}
+
+		/// evaluates the base shape and applies the selected edits to it
+		static void EvaluateProgram(
+			const BlobProgram& program,
+			BlobProgramContext & context,
+			const AABBf& bounding_box,
+			const UINT number_of_points,
+			const V3f_SoA& positions,
+			Array_of_F32 &distances_,
+			Array_of_I32 &materials_
+			)
+		{
+			const UINT number_of_packets = getNumBatches( number_of_points, PACKET::WIDTH );
+
+			EvaluateValue( program, context, program.baseValue, bounding_box, number_of_packets, positions, distances_, materials_ );
+
+			Array_of_F32	edit_distances;
+			Array_of_I32	edit_materials;
+
+			const U32 num_selected_edits = context.selectedEdits.num();
+			for( U32 i = 0; i < num_selected_edits; i++ )
+			{
+				const ProgramEdit& edit = program.edits[ context.selectedEdits[i] ];
+
+				// the space outside an intersection is empty regardless of the previous edits
+				if( !edit.resultBounds.intersects( bounding_box ) ) {
+					StoreEmpty( number_of_packets, distances_, materials_ );
+					continue;
+				}
+
+				EvaluateValue( program, context, edit.value, bounding_box, number_of_packets, positions, edit_distances, edit_materials );
+				EvaluateOperator( NodeType( edit.type ), number_of_packets, distances_, materials_, edit_distances, edit_materials );
+			}
+		}
+	};
+
+}//namespace
+
+bool isEvaluatorISASupported( const EEvaluatorISA isa )
+{
+	PtSystemInfo	sysInfo;
+	mxGetSystemInfo( sysInfo );
+
+	switch( isa )
+	{
+	case EvaluatorISA_SSE4:
+		return sysInfo.cpu.has_SSE_4_1;
+
+	case EvaluatorISA_AVX2:
+		return IMPLICIT_WITH_AVX2 && sysInfo.cpu.has_AVX2;
+
+	case EvaluatorISA_AVX512:
+		return IMPLICIT_WITH_AVX512 && sysInfo.cpu.has_AVX512F;
+
+	default:
+		return false;
+	}
+}
+
+EEvaluatorISA getBestEvaluatorISA()
+{
+	static int s_best_isa = -1;
+	if( s_best_isa < 0 )
+	{
+		s_best_isa = EvaluatorISA_SSE4;
+		if( isEvaluatorISASupported( EvaluatorISA_AVX2 ) ) {
+			s_best_isa = EvaluatorISA_AVX2;
+		}
+		if( isEvaluatorISASupported( EvaluatorISA_AVX512 ) ) {
+			s_best_isa = EvaluatorISA_AVX512;
+		}
+	}
+	return (EEvaluatorISA) s_best_isa;
+}
+
+const char* getEvaluatorISAName( const EEvaluatorISA isa )
+{
+	switch( isa )
+	{
+	case EvaluatorISA_SSE4:		return "SSE4";
+	case EvaluatorISA_AVX2:		return "AVX2";
+	case EvaluatorISA_AVX512:	return "AVX-512";
+	default:					return "?";
+	}
+}
+
+void evaluateWide(
+				  const BlobTreeSoA& tree,
+				  const AABBf& bounding_box,
+				  const UINT number_of_points,
+				  const V3f_SoA& positions_,
+				  Array_of_F32 &distances_,
+				  Array_of_I32 &materials_,
+				  const EEvaluatorISA isa
+				  )
+{
+	mxASSERT( number_of_points <= MAX_POINTS );
+
+	// fall back to the recursive evaluator if the tree is too big or too deep
+	if( tree.numOps + tree.numPrims > MAX_TREE_NODES || tree.maxStackDepth > MAX_EVAL_STACK_DEPTH ) {
+		evaluate( tree, bounding_box, number_of_points, positions_, distances_, materials_ );
+		return;
+	}
+
+	switch( isa )
+	{
+#if IMPLICIT_WITH_AVX512
+	case EvaluatorISA_AVX512:
+		WideEvaluator< Packet_AVX512 >::Evaluate( tree, bounding_box, number_of_points, positions_, distances_, materials_ );
+		break;
+#endif
+#if IMPLICIT_WITH_AVX2
+	case EvaluatorISA_AVX2:
+		WideEvaluator< Packet_AVX2 >::Evaluate( tree, bounding_box, number_of_points, positions_, distances_, materials_ );
+		break;
+#endif
+	default:
+		WideEvaluator< Packet_SSE4 >::Evaluate( tree, bounding_box, number_of_points, positions_, distances_, materials_ );
+		break;
+	}
+}
+
+void evaluateTape(
+				  const BlobTreeSoA& tree,
+				  const TapeInstruction* tape,
+				  const U32 tape_length,
+				  const AABBf& region,
+				  const UINT number_of_points,
+				  const V3f_SoA& positions_,
+				  Array_of_F32 &distances_,
+				  Array_of_I32 &materials_,
+				  const EEvaluatorISA isa
+				  )
+{
+	mxASSERT( number_of_points <= MAX_POINTS );
+
+	if( tree.maxStackDepth > MAX_EVAL_STACK_DEPTH ) {
+		evaluate( tree, region, number_of_points, positions_, distances_, materials_ );
+		return;
+	}
+
+	switch( isa )
+	{
+#if IMPLICIT_WITH_AVX512
+	case EvaluatorISA_AVX512:
+		WideEvaluator< Packet_AVX512 >::EvaluateTape( tree, tape, tape_length, number_of_points, positions_, distances_, materials_ );
+		break;
+#endif
+#if IMPLICIT_WITH_AVX2
+	case EvaluatorISA_AVX2:
+		WideEvaluator< Packet_AVX2 >::EvaluateTape( tree, tape, tape_length, number_of_points, positions_, distances_, materials_ );
+		break;
+#endif
+	default:
+		WideEvaluator< Packet_SSE4 >::EvaluateTape( tree, tape, tape_length, number_of_points, positions_, distances_, materials_ );
+		break;
+	}
+}
+
+ERet evaluateProgram(
+					 const BlobProgram& program,
+					 BlobProgramContext & context,
+					 const AABBf& bounding_box,
+					 const UINT number_of_points,
+					 const V3f_SoA& positions_,
+					 Array_of_F32 &distances_,
+					 Array_of_I32 &materials_,
+					 const EEvaluatorISA isa
+					 )
+{
+	mxASSERT( number_of_points <= MAX_POINTS );
+	mxASSERT( context.cacheStamps.num() == program.numCacheSlots );
+
+	mxDO(selectEdits( program, bounding_box, context ));
+
+	// invalidate the shared values computed for the previous region
+	if( ++context.currentStamp == 0 ) {
+		Arrays::setAll( context.cacheStamps, 0u );
+		context.currentStamp = 1;
+	}
+
+	switch( isa )
+	{
+#if IMPLICIT_WITH_AVX512
+	case EvaluatorISA_AVX512:
+		WideEvaluator< Packet_AVX512 >::EvaluateProgram( program, context, bounding_box, number_of_points, positions_, distances_, materials_ );
+		break;
+#endif
+#if IMPLICIT_WITH_AVX2
+	case EvaluatorISA_AVX2:
+		WideEvaluator< Packet_AVX2 >::EvaluateProgram( program, context, bounding_box, number_of_points, positions_, distances_, materials_ );
+		break;
+#endif
+	default:
+		WideEvaluator< Packet_SSE4 >::EvaluateProgram( program, context, bounding_box, number_of_points, positions_, distances_, materials_ );
+		break;
+	}
+
+	return ALL_OK;
+}
+
+/*
+-----------------------------------------------------------------------------
+	UNIT TESTS
+-----------------------------------------------------------------------------
+*/
+#if MX_DEVELOPER
+
+namespace
+{
+	struct TestTreeBuilder
+	{
+		Node	nodes[ 256 ];
+		U32		num_nodes;
+
+	public:
+		TestTreeBuilder() { num_nodes = 0; }
+
+		Node* newNode( NodeType type )
+		{
+			mxASSERT( num_nodes < mxCOUNT_OF(nodes) );
+			Node* node = &nodes[ num_nodes++ ];
+			node->type = type;
+			return node;
+		}
+		Node* op( NodeType type, Node* left, Node* right )
+		{
+			Node* node = newNode( type );
+			node->binary.left_operand = left;
+			node->binary.right_operand = right;
+			return node;
+		}
+		Node* sphere( const V3f& center, float radius, U32 material )
+		{
+			Node* node = newNode( NT_SPHERE );
+			node->sphere.center = center;
+			node->sphere.radius = radius;
+			node->sphere.material_id = material;
+			return node;
+		}
+		Node* box( const V3f& center, const V3f& extent, U32 material )
+		{
+			Node* node = newNode( NT_BOX );
+			node->box.center = center;
+			node->box.extent = extent;
+			node->box.material_id = material;
+			return node;
+		}
+	};
+
+	/// a terrain-like scene which uses all primitive types and operators
+	Node* makeTestScene( TestTreeBuilder & builder, const float size )
+	{
+		Node* ground = builder.newNode( NT_PLANE );
+		ground->plane.normal_and_distance = V4f::set( 0, 0, 1, -size * 0.2f );
+		ground->plane.material_id = 2;
+
+		Node* cylinder = builder.newNode( NT_INF_CYLINDER );
+		cylinder->inf_cylinder.origin = CV3f( size * 0.5f, size * 0.5f, 0 );
+		cylinder->inf_cylinder.radius = size * 0.1f;
+		cylinder->inf_cylinder.material_id = 3;
+
+		Node* torus = builder.newNode( NT_TORUS );
+		torus->torus.center = CV3f( size * 0.3f, size * 0.7f, size * 0.4f );
+		torus->torus.big_radius = size * 0.15f;
+		torus->torus.small_radius = size * 0.05f;
+		torus->torus.material_id = 4;
+
+		Node* gyroid = builder.newNode( NT_GYROID );
+		gyroid->gyroid.coord_scale = CV3f( 0.3f );
+		gyroid->gyroid.material_id = 5;
+
+		Node* porous_sphere = builder.op( NT_INTERSECTION, builder.sphere( CV3f( size * 0.7f, size * 0.3f, size * 0.5f ), size * 0.2f, 6 ), gyroid );
+		Node* box_with_hole = builder.op( NT_DIFFERENCE, builder.box( CV3f( size * 0.5f ), CV3f( size * 0.3f, size * 0.2f, size * 0.25f ), 7 ), cylinder );
+
+		return builder.op( NT_UNION,
+			builder.op( NT_UNION, ground, box_with_hole ),
+			builder.op( NT_UNION, torus, porous_sphere )
+			);
+	}
+
+	/// a balanced union of many small spheres (only cheap primitives and lots of culling)
+	Node* makeSpheresTree( TestTreeBuilder & builder, const float size, const U32 spheres_per_axis )
+	{
+		Node*	level[ 64 ];
+		U32		count = 0;
+		const float step = size / spheres_per_axis;
+		for( U32 iY = 0; iY < spheres_per_axis; iY++ ) {
+			for( U32 iX = 0; iX < spheres_per_axis; iX++ ) {
+				const V3f center = CV3f( (iX + 0.5f) * step, (iY + 0.5f) * step, size * 0.5f );
+				level[ count ] = builder.sphere( center, step * 0.45f, 1 + (count % 7) );
+				count++;
+			}
+		}
+		while( count > 1 ) {
+			U32 next_count = 0;
+			for( U32 i = 0; i + 1 < count; i += 2 ) {
+				level[ next_count++ ] = builder.op( NT_UNION, level[i], level[i + 1] );
+			}
+			if( count & 1 ) {
+				level[ next_count++ ] = level[ count - 1 ];
+			}
+			count = next_count;
+		}
+		return level[0];
+	}
+
+	/// a right-leaning chain of unions of carved boxes (as written by hand in scripts)
+	Node* makeChainTree( TestTreeBuilder & builder, const float size, const U32 length )
+	{
+		Node* root = nil;
+		for( U32 i = 0; i < length; i++ )
+		{
+			const float t = (i + 0.5f) / length;
+			Node* carved_box = builder.op( NT_DIFFERENCE,
+				builder.box( CV3f( size * t, size * 0.5f, size * 0.3f ), CV3f( size * 0.04f, size * 0.3f, size * 0.2f ), 1 + (i % 5) ),
+				builder.sphere( CV3f( size * t, size * 0.5f, size * 0.5f ), size * 0.05f, 0 )
+				);
+			root = root ? builder.op( NT_UNION, carved_box, root ) : carved_box;
+		}
+		return root;
+	}
+
+	/// Evaluates the grid in blocks of 4x4x4 points (as the voxel engine does), returns the time in microseconds.
+	U64 evaluateGrid(
+		const BlobTreeSoA& tree
+		, const float size
+		, const U32 resolution
+		, const int isa	//!< -1 = use the recursive evaluate()
+		, F32 * distances_
+		, U32 * materials_
+		)
+	{
+		const float step = size / resolution;
+		const U32 blocks_per_axis = resolution / 4;
+
+		ScopedTimer	timer;
+
+		U32	output_offset = 0;
+		for( U32 bZ = 0; bZ < blocks_per_axis; bZ++ ) {
+			for( U32 bY = 0; bY < blocks_per_axis; bY++ ) {
+				for( U32 bX = 0; bX < blocks_per_axis; bX++ )
+				{
+					V3f_SoA	positions;
+					U32	point_index = 0;
+					for( U32 z = 0; z < 4; z++ ) {
+						for( U32 y = 0; y < 4; y++ ) {
+							for( U32 x = 0; x < 4; x++ ) {
+								positions.xs[ point_index ] = (bX * 4 + x) * step;
+								positions.ys[ point_index ] = (bY * 4 + y) * step;
+								positions.zs[ point_index ] = (bZ * 4 + z) * step;
+								point_index++;
+							}
+						}
+					}
+
+					const AABBf block_bounds = AABBf::make(
+						CV3f( bX * 4 * step, bY * 4 * step, bZ * 4 * step ),
+						CV3f( (bX * 4 + 3) * step, (bY * 4 + 3) * step, (bZ * 4 + 3) * step )
+						);
+
+					Array_of_F32	distances;
+					Array_of_I32	materials;
+					if( isa < 0 ) {
+						evaluate( tree, block_bounds, MAX_POINTS, positions, distances, materials );
+					} else {
+						evaluateWide( tree, block_bounds, MAX_POINTS, positions, distances, materials, (EEvaluatorISA) isa );
+					}
+
+					memcpy( distances_ + output_offset, distances, sizeof(distances) );
+					memcpy( materials_ + output_offset, materials, sizeof(materials) );
+					output_offset += MAX_POINTS;
+				}
+			}
+		}
+
+		return timer.ElapsedMicroseconds();
+	}
+}//namespace
+
+ERet Benchmark_EvaluateWide(
+	AllocatorI & scratchpad
+	, const U32 resolution
+	)
+{
+	mxASSERT( resolution >= 4 && resolution % 4 == 0 );
+
+	const float size = 100.0f;
+	const U32 num_points = resolution * resolution * resolution;
+
+	F32 *	reference_distances;
+	mxTRY_ALLOC_SCOPED( reference_distances, num_points, scratchpad );
+	U32 *	reference_materials;
+	mxTRY_ALLOC_SCOPED( reference_materials, num_points, scratchpad );
+
+	F32 *	distances;
+	mxTRY_ALLOC_SCOPED( distances, num_points, scratchpad );
+	U32 *	materials;
+	mxTRY_ALLOC_SCOPED( materials, num_points, scratchpad );
+
+	struct TestTree {
+		const char *	name;
+		Node *			root;
+	};
+
+	TestTreeBuilder	builder;
+	const TestTree test_trees[] = {
+		{ "scene", makeTestScene( builder, size ) },
+		{ "spheres", makeSpheresTree( builder, size, 8 ) },
+		{ "chain", makeChainTree( builder, size, 24 ) },
+	};
+
+	for( U32 iTree = 0; iTree < mxCOUNT_OF(test_trees); iTree++ )
+	{
+		BlobTreeSoA	tree( scratchpad );
+		BlobTreeCompiler	compiler( scratchpad );
+		mxDO(compiler.compile( test_trees[ iTree ].root, tree ));
+
+		const U64 reference_usec = evaluateGrid( tree, size, resolution, -1, reference_distances, reference_materials );
+
+		ptPRINT("BlobTree '%s': %u nodes, stack depth: %u, %u^3 points: recursive SSE: %.2f Mpoints/sec",
+			test_trees[ iTree ].name, tree.numOps + tree.numPrims, tree.maxStackDepth, resolution,
+			reference_usec ? float(num_points) / reference_usec : 0.0f
+			);
+
+		for( int isa = 0; isa < EvaluatorISA_COUNT; isa++ )
+		{
+			if( !isEvaluatorISASupported( (EEvaluatorISA) isa ) ) {
+				ptPRINT("	%s: not supported", getEvaluatorISAName( (EEvaluatorISA) isa ));
+				continue;
+			}
+
+			const U64 usec = evaluateGrid( tree, size, resolution, isa, distances, materials );
+
+			U32	num_mismatches = 0;
+			for( U32 i = 0; i < num_points; i++ ) {
+				num_mismatches += ( distances[i] != reference_distances[i] ) || ( materials[i] != reference_materials[i] );
+			}
+
+			ptPRINT("	%s: %.2f Mpoints/sec (%.2fx), mismatches: %u",
+				getEvaluatorISAName( (EEvaluatorISA) isa ),
+				usec ? float(num_points) / usec : 0.0f,
+				usec ? float(reference_usec) / usec : 0.0f,
+				num_mismatches
+				);
+
+			mxENSURE( num_mismatches == 0, ERR_UNKNOWN_ERROR,
+				"%s evaluator differs from the recursive one", getEvaluatorISAName( (EEvaluatorISA) isa ) );
+		}
+	}
+
+	return ALL_OK;
+}
+
+#endif // MX_DEVELOPER
+
+}//namespace implicit
@@ -0,0 +1,644 @@
+// Region-specific BlobTree tapes pruned with interval arithmetic.
+/*
+References:
+
+Massively Parallel Rendering of Complex Closed-Form Implicit Surfaces [2020]
+https://www.mattkeeter.com/research/mpr/
+
+Interval Arithmetic and Recursive Subdivision for Implicit Functions and Constructive Solid Geometry [1992]
+http://www.cs.cornell.edu/~dcb/papers/duff92.pdf
+*/
+#include "Base/Base.h"
+#pragma hdrstop
+#include <Base/Math/Random.h>
+#include <Core/Util/ScopedTimer.h>
+#include <Implicit/Evaluator.h>
+
+namespace implicit {
+
+namespace
+{
+	/// the same value as in Evaluator.cpp
+	const F32 INFINITE_DISTANCE = FLT_MAX;
+
+	/// Bounds of the distances of a tape operand inside the region.
+	struct Operand
+	{
+		F32		lo;
+		F32		hi;
+		U32		tape_start;	//!< the first instruction of the operand in the output tape
+		bool	is_empty;	//!< the operand is culled (its distances are INFINITE_DISTANCE and materials are empty)
+	};
+
+	/// the maximum stack depth of trees which can be pruned
+	enum { MAX_OPERANDS = 256 };
+
+	/// Covers the rounding errors of the SIMD evaluator which uses single precision.
+	mxFORCEINLINE void widenInterval( F64 & lo_, F64 & hi_, const F64 magnitude )
+	{
+		const F64 epsilon = 1e-5 * ( 1.0 + magnitude + largest( fabs( lo_ ), fabs( hi_ ) ) );
+		lo_ -= epsilon;
+		hi_ += epsilon;
+	}
+
+	/// Returns the bounds of the primitive's distances for all points inside the region (ignoring culling).
+	void calcPrimitiveBounds(
+		const BlobTreeSoA& tree,
+		const NodeType node_type,
+		const U32 type_and_flags,
+		const AABBf& region,
+		F32 &lo_, F32 &hi_
+		)
+	{
+		U32	first_parameter_index;
+		BlobTreeSoA::unpackPrimitive( type_and_flags, first_parameter_index );
+
+		const F32* param0 = (const F32*) &tree.params[ first_parameter_index ];
+		const F32* param1 = (const F32*) &tree.params[ first_parameter_index + 1 ];
+
+		const F64 center[3] = {
+			( F64(region.min_corner.x) + F64(region.max_corner.x) ) * 0.5,
+			( F64(region.min_corner.y) + F64(region.max_corner.y) ) * 0.5,
+			( F64(region.min_corner.z) + F64(region.max_corner.z) ) * 0.5,
+		};
+		const F64 extent[3] = {
+			( F64(region.max_corner.x) - F64(region.min_corner.x) ) * 0.5,
+			( F64(region.max_corner.y) - F64(region.min_corner.y) ) * 0.5,
+			( F64(region.max_corner.z) - F64(region.min_corner.z) ) * 0.5,
+		};
+		// distance fields of the primitives are 1-Lipschitz (except for the plane with a non-unit normal, sine wave and gyroid)
+		const F64 half_diagonal = sqrt( extent[0]*extent[0] + extent[1]*extent[1] + extent[2]*extent[2] );
+
+		const F64 magnitude = largest( largest( fabs(center[0]), fabs(center[1]) ), fabs(center[2]) ) + half_diagonal;
+
+		F64	lo, hi;
+
+		switch( node_type )
+		{
+		case NT_PLANE:
+			{
+				const F64 value_at_center = param0[0] * center[0] + param0[1] * center[1] + param0[2] * center[2] + param0[3];
+				const F64 radius = fabs(param0[0]) * extent[0] + fabs(param0[1]) * extent[1] + fabs(param0[2]) * extent[2];
+				lo = value_at_center - radius;
+				hi = value_at_center + radius;
+			} break;
+
+		case NT_SPHERE:
+			{
+				// the nearest and the farthest points of the region
+				F64	nearest_squared = 0, farthest_squared = 0;
+				for( int axis = 0; axis < 3; axis++ ) {
+					const F64 d = fabs( center[axis] - param0[axis] );
+					const F64 nearest = largest( d - extent[axis], 0.0 );
+					const F64 farthest = d + extent[axis];
+					nearest_squared += nearest * nearest;
+					farthest_squared += farthest * farthest;
+				}
+				lo = sqrt( nearest_squared ) - param0[3];
+				hi = sqrt( farthest_squared ) - param0[3];
+			} break;
+
+		case NT_BOX:
+			{
+				F64	outside_squared = 0, inside = -DBL_MAX;
+				for( int axis = 0; axis < 3; axis++ ) {
+					const F64 d = fabs( center[axis] - param0[axis] ) - param1[axis];
+					const F64 outside = largest( d, 0.0 );
+					outside_squared += outside * outside;
+					inside = largest( inside, smallest( d, 0.0 ) );
+				}
+				const F64 value_at_center = sqrt( outside_squared ) + inside;
+				lo = value_at_center - half_diagonal;
+				hi = value_at_center + half_diagonal;
+			} break;
+
+		case NT_INF_CYLINDER:
+			{
+				const F64 dx = center[0] - param0[0];
+				const F64 dy = center[1] - param0[1];
+				const F64 value_at_center = sqrt( dx*dx + dy*dy ) - param0[3];
+				lo = value_at_center - half_diagonal;
+				hi = value_at_center + half_diagonal;
+			} break;
+
+		case NT_TORUS:
+			{
+				const F64 dx = center[0] - param0[0];
+				const F64 dy = center[1] - param0[1];
+				const F64 dz = center[2] - param0[2];
+				const F64 q = sqrt( dx*dx + dy*dy ) - param1[0];
+				const F64 value_at_center = sqrt( q*q + dz*dz ) - param1[1];
+				lo = value_at_center - half_diagonal;
+				hi = value_at_center + half_diagonal;
+			} break;
+
+		case NT_SINE_WAVE:
+			{
+				// z * scale_z - sin(...)
+				const F64 z0 = region.min_corner.z * F64(param0[2]);
+				const F64 z1 = region.max_corner.z * F64(param0[2]);
+				lo = smallest( z0, z1 ) - 1.0;
+				hi = largest( z0, z1 ) + 1.0;
+			} break;
+
+		case NT_GYROID:
+			// 2 * (cos(x) * sin(y) + cos(y) * sin(z) + cos(z) * sin(x))
+			lo = -6.0;
+			hi = +6.0;
+			break;
+
+			mxDEFAULT_UNREACHABLE(;);
+		}//switch
+
+		widenInterval( lo, hi, magnitude );
+
+		lo_ = (F32) lo;
+		hi_ = (F32) hi;
+	}
+
+	/// Replaces the operand on top of the stack with empty space.
+	mxFORCEINLINE void replaceWithEmpty( Operand & operand_, TapeInstruction * tape_, U32 & tape_length_ )
+	{
+		tape_length_ = operand_.tape_start;
+		tape_[ tape_length_++ ] = makeTapeInstruction( TapeOp_PushEmpty );
+		operand_.lo = INFINITE_DISTANCE;
+		operand_.hi = INFINITE_DISTANCE;
+		operand_.is_empty = true;
+	}
+
+	/// Keeps the first operand (the second operand is at the end of the tape).
+	mxFORCEINLINE void keepFirstOperand( const Operand& second, U32 & tape_length_ )
+	{
+		tape_length_ = second.tape_start;
+	}
+
+	/// Moves the second operand in place of the first one.
+	mxFORCEINLINE void keepSecondOperand( Operand & first_, const Operand& second, TapeInstruction * tape_, U32 & tape_length_ )
+	{
+		const U32 second_length = tape_length_ - second.tape_start;
+		memmove( tape_ + first_.tape_start, tape_ + second.tape_start, second_length * sizeof(tape_[0]) );
+		tape_length_ = first_.tape_start + second_length;
+		first_.lo = second.lo;
+		first_.hi = second.hi;
+		first_.is_empty = second.is_empty;
+	}
+
+}//namespace
+
+U32 initializeTape(
+				   const BlobTreeSoA& tree,
+				   TapeInstruction * tape_
+				   )
+{
+	const U32 num_nodes = tree.numOps + tree.numPrims;
+	for( U32 i = 0; i < num_nodes; i++ ) {
+		tape_[i] = makeTapeInstruction( TapeOp_EvaluateNode, tree.postOrder[i] );
+	}
+	return num_nodes;
+}
+
+/*
+The operands of the parent tape are bounded with intervals.
+A node whose bounding box doesn't intersect the region is culled (as in evaluate()),
+and if it doesn't contain the region, it can be culled inside sub-regions,
+so its upper bound is INFINITE_DISTANCE.
+
+Materials are non-zero only where distances <= 0, so
+an operand of a union which is always positive and farther than the other operand can be removed,
+an intersection only depends on the farther operand,
+and a difference with a subtracted shape which is always farther than the first operand
+only depends on the first operand.
+*/
+U32 refineTape(
+			   const BlobTreeSoA& tree,
+			   const TapeInstruction* parent_tape,
+			   const U32 parent_tape_length,
+			   const AABBf& region,
+			   TapeInstruction * tape_
+			   )
+{
+	// the stack is never deeper than in the original tree
+	if( tree.maxStackDepth > MAX_OPERANDS ) {
+		memmove( tape_, parent_tape, parent_tape_length * sizeof(tape_[0]) );
+		return parent_tape_length;
+	}
+
+	Operand	stack[ MAX_OPERANDS ];
+	U32		stack_size = 0;
+
+	U32	tape_length = 0;
+
+	// Every instruction emits at most one instruction, so the tape can be refined in place.
+	for( U32 i = 0; i < parent_tape_length; i++ )
+	{
+		const TapeInstruction instruction = parent_tape[ i ];
+
+		switch( instruction >> TAPE_OPCODE_SHIFT )
+		{
+		case TapeOp_PushEmpty:
+			{
+				mxASSERT( stack_size < MAX_OPERANDS );
+				Operand & operand = stack[ stack_size++ ];
+				operand.tape_start = tape_length;
+				replaceWithEmpty( operand, tape_, tape_length );
+			} break;
+
+		case TapeOp_Negate:
+			{
+				mxASSERT( stack_size >= 1 );
+				Operand & operand = stack[ stack_size - 1 ];
+				const F32 lo = operand.lo;
+				operand.lo = -operand.hi;
+				operand.hi = -lo;
+				operand.is_empty = false;
+				tape_[ tape_length++ ] = instruction;
+			} break;
+
+		case TapeOp_Solidify:
+			{
+				mxASSERT( stack_size >= 1 );
+				// empty space stays empty
+				if( !stack[ stack_size - 1 ].is_empty ) {
+					tape_[ tape_length++ ] = instruction;
+				}
+			} break;
+
+		case TapeOp_EvaluateNode:
+			{
+				const NodeIndex node_index = instruction & TAPE_NODE_INDEX_MASK;
+				const AABBf& node_bounds = tree.aabbs[ node_index ];
+				const U32 type_and_flags = tree.types[ node_index ];
+				const NodeType node_type = NodeType( type_and_flags & NODE_TYPE_MASK );
+
+				const bool is_culled = !node_bounds.intersects( region );
+
+				if( node_type >= NT_FIRST_PRIM_TYPE )
+				{
+					mxASSERT( stack_size < MAX_OPERANDS );
+					Operand & operand = stack[ stack_size++ ];
+					operand.tape_start = tape_length;
+
+					if( is_culled ) {
+						replaceWithEmpty( operand, tape_, tape_length );
+						continue;
+					}
+
+					calcPrimitiveBounds( tree, node_type, type_and_flags, region, operand.lo, operand.hi );
+					operand.is_empty = false;
+					tape_[ tape_length++ ] = instruction;
+				}
+				else
+				{
+					mxASSERT( stack_size >= 2 );
+					const Operand second = stack[ --stack_size ];
+					Operand & first = stack[ stack_size - 1 ];
+
+					if( is_culled ) {
+						replaceWithEmpty( first, tape_, tape_length );
+						continue;
+					}
+
+					switch( node_type )
+					{
+					case NT_UNION:
+						if( first.is_empty && second.is_empty ) {
+							replaceWithEmpty( first, tape_, tape_length );
+						} else if( second.is_empty || ( second.lo > 0 && first.hi < second.lo ) ) {
+							keepFirstOperand( second, tape_length );
+						} else if( first.is_empty || ( first.lo > 0 && second.hi < first.lo ) ) {
+							keepSecondOperand( first, second, tape_, tape_length );
+						} else {
+							first.lo = smallest( first.lo, second.lo );
+							first.hi = smallest( first.hi, second.hi );
+							tape_[ tape_length++ ] = instruction;
+						}
+						break;
+
+					case NT_DIFFERENCE:
+						if( first.is_empty ) {
+							replaceWithEmpty( first, tape_, tape_length );
+						} else if( second.is_empty || first.lo > -second.lo ) {
+							keepFirstOperand( second, tape_length );
+						} else if( second.hi < 0 && first.hi < -second.hi ) {
+							// always inside the subtracted shape which is closer than the first operand's surface
+							keepSecondOperand( first, second, tape_, tape_length );
+							const F32 lo = first.lo;
+							first.lo = -first.hi;
+							first.hi = -lo;
+							tape_[ tape_length++ ] = makeTapeInstruction( TapeOp_Negate );
+						} else {
+							const F32 lo = largest( first.lo, -second.hi );
+							const F32 hi = largest( first.hi, -second.lo );
+							first.lo = lo;
+							first.hi = hi;
+							tape_[ tape_length++ ] = instruction;
+						}
+						break;
+
+					case NT_INTERSECTION:
+						if( first.is_empty || second.is_empty ) {
+							replaceWithEmpty( first, tape_, tape_length );
+						} else if( first.lo > second.hi ) {
+							keepFirstOperand( second, tape_length );
+							tape_[ tape_length++ ] = makeTapeInstruction( TapeOp_Solidify );
+						} else if( second.lo > first.hi ) {
+							keepSecondOperand( first, second, tape_, tape_length );
+							tape_[ tape_length++ ] = makeTapeInstruction( TapeOp_Solidify );
+						} else {
+							first.lo = largest( first.lo, second.lo );
+							first.hi = largest( first.hi, second.hi );
+							tape_[ tape_length++ ] = instruction;
+						}
+						break;
+
+						mxDEFAULT_UNREACHABLE(;);
+					}
+				}
+
+				// the node can be culled inside sub-regions
+				Operand & result = stack[ stack_size - 1 ];
+				if( !result.is_empty && !node_bounds.contains( region ) ) {
+					result.hi = INFINITE_DISTANCE;
+				}
+			} break;
+
+			mxDEFAULT_UNREACHABLE(;);
+		}
+	}
+
+	mxASSERT( stack_size == 1 );
+	mxASSERT( tape_length <= parent_tape_length );
+	return tape_length;
+}
+
+/*
+-----------------------------------------------------------------------------
+	UNIT TESTS
+-----------------------------------------------------------------------------
+*/
+#if MX_DEVELOPER
+
+namespace
+{
+	/// Incrementally sculpted terrain: a slab with lots of added and carved shapes.
+	Node* makeSculptedTree( Node * nodes_, const float size, const U32 number_of_edits, NwRandom & rng )
+	{
+		U32	num_nodes = 0;
+
+		Node* root = &nodes_[ num_nodes++ ];
+		root->type = NT_BOX;
+		root->box.center = CV3f( size * 0.5f, size * 0.5f, size * 0.15f );
+		root->box.extent = CV3f( size * 0.5f, size * 0.5f, size * 0.15f );
+		root->box.material_id = 1;
+
+		for( U32 i = 0; i < number_of_edits; i++ )
+		{
+			const V3f position = CV3f(
+				rng.GetRandomFloatInRange( 0, size ),
+				rng.GetRandomFloatInRange( 0, size ),
+				rng.GetRandomFloatInRange( size * 0.1f, size * 0.5f )
+				);
+			const float radius = rng.GetRandomFloatInRange( size * 0.02f, size * 0.08f );
+			const int kind = rng.RandomInt( 9 );
+
+			Node* edit = &nodes_[ num_nodes++ ];
+			NodeType operation = NT_UNION;
+
+			if( kind < 4 ) {
+				edit->type = NT_SPHERE;
+				edit->sphere.center = position;
+				edit->sphere.radius = radius;
+				edit->sphere.material_id = 2 + (i % 5);
+			} else if( kind < 7 ) {
+				edit->type = NT_SPHERE;
+				edit->sphere.center = position;
+				edit->sphere.radius = radius;
+				edit->sphere.material_id = 0;
+				operation = NT_DIFFERENCE;
+			} else if( kind < 9 ) {
+				edit->type = NT_BOX;
+				edit->box.center = position;
+				edit->box.extent = CV3f( radius, radius * 0.5f, radius * 0.75f );
+				edit->box.material_id = 2 + (i % 5);
+			} else {
+				edit->type = NT_TORUS;
+				edit->torus.center = position;
+				edit->torus.big_radius = radius;
+				edit->torus.small_radius = radius * 0.25f;
+				edit->torus.material_id = 2 + (i % 5);
+			}
+
+			Node* new_root = &nodes_[ num_nodes++ ];
+			new_root->type = operation;
+			new_root->binary.left_operand = root;
+			new_root->binary.right_operand = edit;
+			root = new_root;
+		}
+
+		return root;
+	}
+
+	struct TapeBenchmarkContext
+	{
+		const BlobTreeSoA *	tree;
+		EEvaluatorISA		isa;
+		F32		step;	//!< the distance between grid points
+		U32		blocks_per_axis;	//!< the grid is split into blocks of 4x4x4 points
+
+		TapeInstruction *	tapes;	//!< the tape of each subdivision level
+		U32		max_tape_length;
+
+		F32 *	distances;
+		U32 *	materials;
+
+		U64		total_leaf_tape_length;
+	};
+
+	/// the bounds of the points in the blocks [min_block, min_block + num_blocks)
+	const AABBf getBlockBounds( const F32 step, const U32 min_block[3], const U32 num_blocks )
+	{
+		return AABBf::make(
+			CV3f( min_block[0] * 4 * step, min_block[1] * 4 * step, min_block[2] * 4 * step ),
+			CV3f( ((min_block[0] + num_blocks) * 4 - 1) * step, ((min_block[1] + num_blocks) * 4 - 1) * step, ((min_block[2] + num_blocks) * 4 - 1) * step )
+			);
+	}
+
+	void getBlockPoints( const F32 step, const U32 block[3], V3f_SoA & positions_ )
+	{
+		U32	point_index = 0;
+		for( U32 z = 0; z < 4; z++ ) {
+			for( U32 y = 0; y < 4; y++ ) {
+				for( U32 x = 0; x < 4; x++ ) {
+					positions_.xs[ point_index ] = (block[0] * 4 + x) * step;
+					positions_.ys[ point_index ] = (block[1] * 4 + y) * step;
+					positions_.zs[ point_index ] = (block[2] * 4 + z) * step;
+					point_index++;
+				}
+			}
+		}
+	}
+
+	U32 getBlockOffset( const TapeBenchmarkContext& context, const U32 block[3] )
+	{
+		return ( (block[2] * context.blocks_per_axis + block[1]) * context.blocks_per_axis + block[0] ) * MAX_POINTS;
+	}
+
+	void evaluateWithTapes_recursive(
+		TapeBenchmarkContext & context
+		, const U32 level
+		, const U32 min_block[3]
+		, const U32 num_blocks
+		)
+	{
+		const TapeInstruction* parent_tape = context.tapes + context.max_tape_length * level;
+		TapeInstruction * tape = context.tapes + context.max_tape_length * (level + 1);
+
+		const AABBf region = getBlockBounds( context.step, min_block, num_blocks );
+
+		// the tape length of the parent is stored in the first slot of the level
+		const U32 tape_length = refineTape( *context.tree, parent_tape + 1, parent_tape[0], region, tape + 1 );
+		tape[0] = tape_length;
+
+		if( num_blocks == 1 )
+		{
+			V3f_SoA	positions;
+			getBlockPoints( context.step, min_block, positions );
+
+			Array_of_F32	distances;
+			Array_of_I32	materials;
+			evaluateTape( *context.tree, tape + 1, tape_length, region, MAX_POINTS, positions, distances, materials, context.isa );
+
+			const U32 output_offset = getBlockOffset( context, min_block );
+			memcpy( context.distances + output_offset, distances, sizeof(distances) );
+			memcpy( context.materials + output_offset, materials, sizeof(materials) );
+
+			context.total_leaf_tape_length += tape_length;
+			return;
+		}
+
+		const U32 half_size = num_blocks / 2;
+		for( U32 child = 0; child < 8; child++ )
+		{
+			const U32 child_min_block[3] = {
+				min_block[0] + ((child & 1) ? half_size : 0),
+				min_block[1] + ((child & 2) ? half_size : 0),
+				min_block[2] + ((child & 4) ? half_size : 0),
+			};
+			evaluateWithTapes_recursive( context, level + 1, child_min_block, half_size );
+		}
+	}
+}//namespace
+
+ERet Benchmark_TapePruning(
+	AllocatorI & scratchpad
+	, const U32 resolution
+	, const U32 number_of_edits
+	)
+{
+	mxASSERT( resolution >= 4 && IsPowerOfTwo( resolution ) );
+
+	// each edit adds a primitive and an operator
+	const U32 max_nodes = number_of_edits * 2 + 1;
+
+	const float size = 100.0f;
+	const U32 blocks_per_axis = resolution / 4;
+	const U32 num_points = resolution * resolution * resolution;
+
+	Node *	nodes;
+	mxTRY_ALLOC_SCOPED( nodes, max_nodes, scratchpad );
+
+	NwRandom	rng( 12345 );
+	const Node* root = makeSculptedTree( nodes, size, number_of_edits, rng );
+
+	BlobTreeSoA	tree( scratchpad );
+	BlobTreeCompiler	compiler( scratchpad );
+	mxDO(compiler.compile( root, tree ));
+
+	const U32 num_nodes = tree.numOps + tree.numPrims;
+
+	F32 *	reference_distances;
+	mxTRY_ALLOC_SCOPED( reference_distances, num_points, scratchpad );
+	U32 *	reference_materials;
+	mxTRY_ALLOC_SCOPED( reference_materials, num_points, scratchpad );
+
+	F32 *	distances;
+	mxTRY_ALLOC_SCOPED( distances, num_points, scratchpad );
+	U32 *	materials;
+	mxTRY_ALLOC_SCOPED( materials, num_points, scratchpad );
+
+	const U32 num_levels = Log2OfPowerOfTwo( blocks_per_axis ) + 1;
+
+	// the first slot of each level holds the length of the tape
+	TapeInstruction *	tapes;
+	mxTRY_ALLOC_SCOPED( tapes, (num_nodes + 1) * (num_levels + 1), scratchpad );
+
+	TapeBenchmarkContext	context;
+	context.tree = &tree;
+	context.isa = getBestEvaluatorISA();
+	context.step = size / resolution;
+	context.blocks_per_axis = blocks_per_axis;
+	context.tapes = tapes;
+	context.max_tape_length = num_nodes + 1;
+	context.distances = distances;
+	context.materials = materials;
+	context.total_leaf_tape_length = 0;
+
+	ScopedTimer	timer;
+
+	// evaluate each block with the whole tree
+	for( U32 bZ = 0; bZ < blocks_per_axis; bZ++ ) {
+		for( U32 bY = 0; bY < blocks_per_axis; bY++ ) {
+			for( U32 bX = 0; bX < blocks_per_axis; bX++ )
+			{
+				const U32 block[3] = { bX, bY, bZ };
+
+				V3f_SoA	positions;
+				getBlockPoints( context.step, block, positions );
+
+				Array_of_F32	block_distances;
+				Array_of_I32	block_materials;
+				evaluateWide( tree, getBlockBounds( context.step, block, 1 ), MAX_POINTS, positions, block_distances, block_materials, context.isa );
+
+				const U32 output_offset = getBlockOffset( context, block );
+				memcpy( reference_distances + output_offset, block_distances, sizeof(block_distances) );
+				memcpy( reference_materials + output_offset, block_materials, sizeof(block_materials) );
+			}
+		}
+	}
+
+	const U64 reference_usec = timer.ElapsedMicroseconds();
+
+	timer.Reset();
+
+	// subdivide the grid and evaluate each block with the tape of its octree cell
+	tapes[0] = initializeTape( tree, tapes + 1 );
+
+	const U32 root_block[3] = { 0, 0, 0 };
+	evaluateWithTapes_recursive( context, 0, root_block, blocks_per_axis );
+
+	const U64 pruned_usec = timer.ElapsedMicroseconds();
+
+	U32	num_mismatches = 0;
+	for( U32 i = 0; i < num_points; i++ ) {
+		num_mismatches += ( distances[i] != reference_distances[i] ) || ( materials[i] != reference_materials[i] );
+	}
+
+	const U32 num_blocks = blocks_per_axis * blocks_per_axis * blocks_per_axis;
+
+	ptPRINT("BlobTree with %u edits: %u nodes, %u^3 points, %s:", number_of_edits, num_nodes, resolution, getEvaluatorISAName( context.isa ));
+	ptPRINT("	full tree: %.2f Mpoints/sec", reference_usec ? float(num_points) / reference_usec : 0.0f);
+	ptPRINT("	pruned tapes: %.2f Mpoints/sec (%.2fx), average tape length: %.1f, mismatches: %u",
+		pruned_usec ? float(num_points) / pruned_usec : 0.0f,
+		pruned_usec ? float(reference_usec) / pruned_usec : 0.0f,
+		float(context.total_leaf_tape_length) / num_blocks,
+		num_mismatches
+		);
+
+	mxENSURE( num_mismatches == 0, ERR_UNKNOWN_ERROR, "pruned tapes give different results" );
+
+	return ALL_OK;
+}
+
+#endif // MX_DEVELOPER
+
+}//namespace implicit
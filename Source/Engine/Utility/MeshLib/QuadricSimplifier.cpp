@@ -0,0 +1,1072 @@
+// Quadric-error edge-collapse simplifier producing a chain of LODs.
+#include <Base/Base.h>
+#pragma hdrstop
+
+#include <algorithm>	// std::sort, std::push_heap
+
+#include <Core/Util/ScopedTimer.h>
+#include <MeshLib/QuadricSimplifier.h>
+
+namespace Meshok
+{
+
+namespace
+{
+	struct VertexLess
+	{
+		const QuadricSimplifier::Input &	input;
+
+		VertexLess( const QuadricSimplifier::Input& input )
+			: input( input )
+		{}
+
+		bool operator () ( const U32 a, const U32 b ) const
+		{
+			const V3f& pa = input.positions[a];
+			const V3f& pb = input.positions[b];
+			if( pa.x != pb.x ) return pa.x < pb.x;
+			if( pa.y != pb.y ) return pa.y < pb.y;
+			if( pa.z != pb.z ) return pa.z < pb.z;
+
+			const F32* attribs_a = input.attributes + a * input.attribute_stride;
+			const F32* attribs_b = input.attributes + b * input.attribute_stride;
+			for( U32 i = 0; i < input.num_attributes; i++ ) {
+				if( attribs_a[i] != attribs_b[i] ) return attribs_a[i] < attribs_b[i];
+			}
+
+			// the copies of a wedge along hard edges are adjacent
+			if( input.normals )
+			{
+				const V3f& na = input.normals[a];
+				const V3f& nb = input.normals[b];
+				if( na.x != nb.x ) return na.x < nb.x;
+				if( na.y != nb.y ) return na.y < nb.y;
+				if( na.z != nb.z ) return na.z < nb.z;
+			}
+			return false;
+		}
+	};
+
+	static bool HaveSameAttributes( const QuadricSimplifier::Input& input, const U32 a, const U32 b )
+	{
+		const F32* attribs_a = input.attributes + a * input.attribute_stride;
+		const F32* attribs_b = input.attributes + b * input.attribute_stride;
+		for( U32 i = 0; i < input.num_attributes; i++ ) {
+			if( attribs_a[i] != attribs_b[i] ) return false;
+		}
+		return true;
+	}
+
+	struct EdgeEntry
+	{
+		U64	key;	//!< (min node, max node)
+		U32	triangle;
+	public:
+		bool operator < ( const EdgeEntry& other ) const { return key < other.key; }
+	};
+
+	static mxFORCEINLINE
+	int FindTriangleCornerWithNode( const UInt3& triangle, const U32* vertex_nodes, const U32 node )
+	{
+		if( vertex_nodes[ triangle.x ] == node ) return 0;
+		if( vertex_nodes[ triangle.y ] == node ) return 1;
+		if( vertex_nodes[ triangle.z ] == node ) return 2;
+		return -1;
+	}
+}//namespace
+
+QuadricSimplifier::QuadricSimplifier( AllocatorI & allocator )
+	: _nodes( allocator )
+	, _vertex_nodes( allocator )
+	, _vertex_remap( allocator )
+	, _sorted_vertices( allocator )
+	, _wedge_ranges( allocator )
+	, _triangles( allocator )
+	, _triangle_removed( allocator )
+	, _refs( allocator )
+	, _heap( allocator )
+{
+	_attributes = nil;
+	_num_attributes = 0;
+	_attribute_stride = 0;
+	_normals = nil;
+	_num_live_triangles = 0;
+	mxZERO_OUT(_stats);
+}
+
+ERet QuadricSimplifier::GenerateLodChain(
+	const Input& input
+	, const Settings& settings
+	, MeshLodChain &lod_chain_
+	)
+{
+	mxENSURE( input.positions && input.num_vertices && input.indices && input.num_indices % 3 == 0,
+		ERR_INVALID_PARAMETER, "" );
+	mxENSURE( !input.num_attributes || (input.attributes && input.attribute_stride >= input.num_attributes),
+		ERR_INVALID_PARAMETER, "" );
+	mxENSURE( settings.num_lods > 0 && settings.num_lods <= MeshLodChain::MAX_LODS,
+		ERR_INVALID_PARAMETER, "" );
+
+	mxZERO_OUT(_stats);
+	_attributes = input.attributes;
+	_num_attributes = input.num_attributes;
+	_attribute_stride = input.attribute_stride;
+	_normals = input.normals;
+
+	mxDO(WeldVertices( input ));
+	mxDO(SetupTopology( input, settings ));
+
+	// LOD 0 is the source mesh
+	lod_chain_.num_lods = 0;
+	lod_chain_.indices.RemoveAll();
+	mxDO(lod_chain_.indices.reserve( input.num_indices * 2 ));
+	mxDO(lod_chain_.indices.setNum( input.num_indices ));
+	memcpy( lod_chain_.indices.raw(), input.indices, input.num_indices * sizeof(input.indices[0]) );
+
+	lod_chain_.lods[0].first_index = 0;
+	lod_chain_.lods[0].num_indices = input.num_indices;
+	lod_chain_.lods[0].error = 0;
+	lod_chain_.num_lods = 1;
+
+	// initialize the heap
+	_heap.RemoveAll();
+	mxDO(_heap.reserve( _nodes.num() * 2 ));
+	for( U32 node_index = 0; node_index < _nodes.num(); node_index++ )
+	{
+		Collapse	collapse;
+		if( FindBestCollapse( node_index, settings, collapse ) )
+		{
+			HeapEntry	entry;
+			entry.cost = (F32) collapse.cost;
+			entry.node = node_index;
+			entry.version = _nodes[ node_index ].version;
+			mxDO(_heap.add( entry ));
+		}
+	}
+	std::make_heap( _heap.raw(), _heap.raw() + _heap.num() );
+
+	// the costs are squared (normalized) distances
+	const REAL max_cost = REAL(settings.max_error) * REAL(settings.max_error);
+	REAL current_cost = 0;
+
+	U32 prev_lod_triangles = input.num_indices / 3;
+	bool can_simplify_further = true;
+
+	for( U32 lod = 1; lod < settings.num_lods && can_simplify_further; lod++ )
+	{
+		const U32 target_triangles = largest( settings.min_triangles, U32( prev_lod_triangles * settings.triangle_reduction ) );
+
+		while( _num_live_triangles > target_triangles )
+		{
+			if( !_heap.num() ) {
+				can_simplify_further = false;
+				break;
+			}
+
+			std::pop_heap( _heap.raw(), _heap.raw() + _heap.num() );
+			const HeapEntry entry = _heap.PopLastValue();
+
+			const Node& node = _nodes[ entry.node ];
+			if( node.removed || node.version != entry.version ) {
+				continue;	// stale entry
+			}
+
+			if( entry.cost > max_cost ) {
+				can_simplify_further = false;
+				break;
+			}
+
+			// the cost could have changed if the neighbors of the neighbors were modified
+			Collapse	collapse;
+			if( !FindBestCollapse( entry.node, settings, collapse ) ) {
+				_stats.num_rejected_collapses++;
+				continue;
+			}
+			if( collapse.cost > entry.cost * 1.0001f + 1e-12f )
+			{
+				HeapEntry	updated_entry = entry;
+				updated_entry.cost = (F32) collapse.cost;
+				mxDO(_heap.add( updated_entry ));
+				std::push_heap( _heap.raw(), _heap.raw() + _heap.num() );
+				continue;
+			}
+
+			mxDO(PerformCollapse( entry.node, collapse ));
+			current_cost = largest( current_cost, collapse.cost );
+
+			mxDO(UpdateCollapseCandidates( collapse.target_node, settings ));
+		}
+
+		if( _num_live_triangles >= prev_lod_triangles ) {
+			break;	// no progress
+		}
+
+		mxDO(EmitLod( (F32) sqrt( current_cost ), lod_chain_ ));
+		prev_lod_triangles = _num_live_triangles;
+	}
+
+	return ALL_OK;
+}
+
+ERet QuadricSimplifier::WeldVertices( const Input& input )
+{
+	const U32 num_vertices = input.num_vertices;
+
+	mxDO(_vertex_nodes.setNum( num_vertices ));
+	mxDO(_vertex_remap.setNum( num_vertices ));
+	mxDO(_wedge_ranges.setNum( num_vertices ));
+
+	// sort the vertices by position, attributes and normals
+	DynamicArray< U32 > &	sorted_vertices = _sorted_vertices;
+	mxDO(sorted_vertices.setNum( num_vertices ));
+	for( U32 i = 0; i < num_vertices; i++ ) {
+		sorted_vertices[i] = i;
+	}
+	std::sort( sorted_vertices.raw(), sorted_vertices.raw() + num_vertices, VertexLess( input ) );
+
+	// normalize positions into [0..1] to make errors independent of the mesh size
+	AABBf	bounds;
+	bounds.clear();
+	for( U32 i = 0; i < num_vertices; i++ ) {
+		bounds.addPoint( input.positions[i] );
+	}
+	const V3f bounds_size = bounds.size();
+	const F32 max_extent = largest( largest( bounds_size.x, bounds_size.y ), bounds_size.z );
+	const F32 inverse_extent = ( max_extent > 0 ) ? 1.0f / max_extent : 1.0f;
+
+	_nodes.RemoveAll();
+
+	U32 i = 0;
+	while( i < num_vertices )
+	{
+		const U32 first_vertex = sorted_vertices[i];
+		const V3f& position = input.positions[ first_vertex ];
+
+		const U32 node_index = _nodes.num();
+		Node	new_node;
+		new_node.Q = QuadricT( 0 );
+		new_node.area = 0;
+		new_node.position = ( position - bounds.min_corner ) * inverse_extent;
+		new_node.first_ref = 0;
+		new_node.num_refs = 0;
+		new_node.version = 0;
+		new_node.kind = Vertex_Interior;
+		new_node.removed = false;
+		mxDO(_nodes.add( new_node ));
+
+		// group vertices with the same position into one node and
+		// vertices with the same attributes into one wedge (ignoring normals, i.e. welding hard edges)
+		U32 num_wedges = 0;
+		U32 wedge_vertex = ~0u;
+		for( ; i < num_vertices; i++ )
+		{
+			const U32 vertex = sorted_vertices[i];
+			if( !(input.positions[ vertex ] == position) ) {
+				break;
+			}
+			if( !num_wedges || !HaveSameAttributes( input, vertex, wedge_vertex ) ) {
+				wedge_vertex = vertex;
+				num_wedges++;
+				_wedge_ranges[ wedge_vertex ] = UInt2( i, 0 );
+			}
+			_vertex_nodes[ vertex ] = node_index;
+			_vertex_remap[ vertex ] = wedge_vertex;
+			_wedge_ranges[ wedge_vertex ].y++;
+		}
+
+		// attribute seams cannot be simplified without creating cracks
+		if( num_wedges > 1 ) {
+			_nodes[ node_index ].kind = Vertex_Locked;
+		}
+	}
+
+	return ALL_OK;
+}
+
+ERet QuadricSimplifier::SetupTopology( const Input& input, const Settings& settings )
+{
+	const U32 num_input_triangles = input.num_indices / 3;
+	const U32* vertex_nodes = _vertex_nodes.raw();
+
+	// copy non-degenerate triangles
+	_triangles.RemoveAll();
+	mxDO(_triangles.reserve( num_input_triangles ));
+
+	for( U32 iTri = 0; iTri < num_input_triangles; iTri++ )
+	{
+		const U32 i0 = input.indices[ iTri*3 + 0 ];
+		const U32 i1 = input.indices[ iTri*3 + 1 ];
+		const U32 i2 = input.indices[ iTri*3 + 2 ];
+		mxENSURE( i0 < input.num_vertices && i1 < input.num_vertices && i2 < input.num_vertices,
+			ERR_INVALID_PARAMETER, "triangle %u: index out of range", iTri );
+
+		const U32 n0 = vertex_nodes[ i0 ];
+		const U32 n1 = vertex_nodes[ i1 ];
+		const U32 n2 = vertex_nodes[ i2 ];
+		if( n0 == n1 || n1 == n2 || n2 == n0 ) {
+			continue;
+		}
+
+		mxDO(_triangles.add( UInt3( _vertex_remap[ i0 ], _vertex_remap[ i1 ], _vertex_remap[ i2 ] ) ));
+	}
+
+	const U32 num_triangles = _triangles.num();
+	_num_live_triangles = num_triangles;
+
+	mxDO(_triangle_removed.setNum( num_triangles ));
+	memset( _triangle_removed.raw(), 0, num_triangles );
+
+	// build node -> triangle references;
+	// collapses append updated lists at the end, so reserve some space for them
+	_refs.RemoveAll();
+	mxDO(_refs.reserve( num_triangles * 3 * 2 ));
+	mxDO(_refs.setNum( num_triangles * 3 ));
+
+	for( U32 iTri = 0; iTri < num_triangles; iTri++ )
+	{
+		const UInt3& tri = _triangles[ iTri ];
+		_nodes[ vertex_nodes[ tri.x ] ].num_refs++;
+		_nodes[ vertex_nodes[ tri.y ] ].num_refs++;
+		_nodes[ vertex_nodes[ tri.z ] ].num_refs++;
+	}
+
+	U32 offset = 0;
+	for( U32 iNode = 0; iNode < _nodes.num(); iNode++ )
+	{
+		Node & node = _nodes[ iNode ];
+		node.first_ref = offset;
+		offset += node.num_refs;
+		node.num_refs = 0;
+	}
+
+	for( U32 iTri = 0; iTri < num_triangles; iTri++ )
+	{
+		const UInt3& tri = _triangles[ iTri ];
+		for( UINT k = 0; k < 3; k++ )
+		{
+			Node & node = _nodes[ vertex_nodes[ tri[k] ] ];
+			_refs[ node.first_ref + node.num_refs++ ] = iTri;
+		}
+	}
+
+	// accumulate area-weighted plane quadrics
+	for( U32 iTri = 0; iTri < num_triangles; iTri++ )
+	{
+		const UInt3& tri = _triangles[ iTri ];
+		Node & node0 = _nodes[ vertex_nodes[ tri.x ] ];
+		Node & node1 = _nodes[ vertex_nodes[ tri.y ] ];
+		Node & node2 = _nodes[ vertex_nodes[ tri.z ] ];
+
+		V3f normal = V3_Cross( node1.position - node0.position, node2.position - node0.position );
+		F32 double_area;
+		normal = V3_Normalized( normal, double_area );
+		if( double_area <= 0 ) {
+			continue;
+		}
+
+		// Q = area * p * p^T
+		const REAL sqrt_weight = sqrt( REAL(double_area) * 0.5 );
+		const QuadricT plane_quadric(
+			normal.x * sqrt_weight,
+			normal.y * sqrt_weight,
+			normal.z * sqrt_weight,
+			-V3_Dot( normal, node0.position ) * sqrt_weight
+			);
+		node0.Q += plane_quadric;
+		node1.Q += plane_quadric;
+		node2.Q += plane_quadric;
+
+		node0.area += double_area * 0.5f;
+		node1.area += double_area * 0.5f;
+		node2.area += double_area * 0.5f;
+	}
+
+	// find open boundaries and non-manifold edges
+	{
+		DynamicArray< EdgeEntry >	edges( _nodes.allocator() );
+		mxDO(edges.setNum( num_triangles * 3 ));
+
+		for( U32 iTri = 0; iTri < num_triangles; iTri++ )
+		{
+			const UInt3& tri = _triangles[ iTri ];
+			for( UINT k = 0; k < 3; k++ )
+			{
+				const U32 a = vertex_nodes[ tri[k] ];
+				const U32 b = vertex_nodes[ tri[(k + 1) % 3] ];
+				EdgeEntry & edge = edges[ iTri*3 + k ];
+				edge.key = ( U64( smallest( a, b ) ) << 32 ) | largest( a, b );
+				edge.triangle = iTri;
+			}
+		}
+
+		std::sort( edges.raw(), edges.raw() + edges.num() );
+
+		U32 i = 0;
+		while( i < edges.num() )
+		{
+			U32 end = i + 1;
+			while( end < edges.num() && edges[ end ].key == edges[ i ].key ) {
+				end++;
+			}
+
+			const U32 count = end - i;
+			Node & node_a = _nodes[ U32( edges[i].key >> 32 ) ];
+			Node & node_b = _nodes[ U32( edges[i].key ) ];
+
+			if( count == 1 )
+			{
+				if( node_a.kind == Vertex_Interior ) node_a.kind = Vertex_Boundary;
+				if( node_b.kind == Vertex_Interior ) node_b.kind = Vertex_Boundary;
+
+				// add the constraint plane through the edge, perpendicular to the triangle
+				const UInt3& tri = _triangles[ edges[i].triangle ];
+				const V3f& p0 = _nodes[ vertex_nodes[ tri.x ] ].position;
+				const V3f& p1 = _nodes[ vertex_nodes[ tri.y ] ].position;
+				const V3f& p2 = _nodes[ vertex_nodes[ tri.z ] ].position;
+
+				const V3f edge_dir = node_b.position - node_a.position;
+				const V3f face_normal = V3_Cross( p1 - p0, p2 - p0 );
+
+				F32 unused_length;
+				const V3f constraint_normal = V3_Normalized( V3_Cross( edge_dir, face_normal ), unused_length );
+
+				const REAL sqrt_weight = sqrt( REAL(settings.boundary_weight) * V3_Dot( edge_dir, edge_dir ) );
+				const QuadricT constraint_quadric(
+					constraint_normal.x * sqrt_weight,
+					constraint_normal.y * sqrt_weight,
+					constraint_normal.z * sqrt_weight,
+					-V3_Dot( constraint_normal, node_a.position ) * sqrt_weight
+					);
+				node_a.Q += constraint_quadric;
+				node_b.Q += constraint_quadric;
+			}
+			else if( count > 2 )
+			{
+				node_a.kind = Vertex_Locked;
+				node_b.kind = Vertex_Locked;
+			}
+
+			i = end;
+		}
+	}
+
+	for( U32 iNode = 0; iNode < _nodes.num(); iNode++ )
+	{
+		const Node& node = _nodes[ iNode ];
+		_stats.num_locked_vertices += ( node.kind == Vertex_Locked );
+		_stats.num_boundary_vertices += ( node.kind == Vertex_Boundary );
+	}
+
+	return ALL_OK;
+}
+
+bool QuadricSimplifier::FindBestCollapse(
+	const U32 node_index
+	, const Settings& settings
+	, Collapse &collapse_
+	) const
+{
+	const Node& node = _nodes[ node_index ];
+	if( node.removed || node.kind == Vertex_Locked ) {
+		return false;
+	}
+
+	const U32* vertex_nodes = _vertex_nodes.raw();
+	const U32* refs = _refs.raw() + node.first_ref;
+
+	// gather the neighbors and the triangles around the vertex
+	RingNode	ring[ MAX_RING_SIZE ];
+	U32			ring_size = 0;
+
+	FanTriangle	fan[ MAX_RING_SIZE ];
+	U32			fan_size = 0;
+
+	U32			collapsed_vertex = ~0u;
+
+	for( U32 iRef = 0; iRef < node.num_refs; iRef++ )
+	{
+		const U32 iTri = refs[ iRef ];
+		if( _triangle_removed[ iTri ] ) {
+			continue;
+		}
+		if( fan_size == MAX_RING_SIZE ) {
+			return false;
+		}
+
+		const UInt3& tri = _triangles[ iTri ];
+		const int corner = FindTriangleCornerWithNode( tri, vertex_nodes, node_index );
+		mxASSERT( corner >= 0 );
+		collapsed_vertex = tri[ corner ];
+
+		FanTriangle & fan_triangle = fan[ fan_size++ ];
+
+		for( UINT k = 0; k < 2; k++ )
+		{
+			const U32 vertex = tri[ (corner + 1 + k) % 3 ];
+			const U32 neighbor = vertex_nodes[ vertex ];
+			fan_triangle.nodes[k] = neighbor;
+
+			U32 iRing = 0;
+			while( iRing < ring_size && ring[ iRing ].node != neighbor ) {
+				iRing++;
+			}
+			if( iRing == ring_size )
+			{
+				if( ring_size == MAX_RING_SIZE ) {
+					return false;
+				}
+				ring[ iRing ].node = neighbor;
+				ring[ iRing ].vertex = vertex;
+				ring[ iRing ].num_shared_triangles = 0;
+				ring[ iRing ].consistent = true;
+				ring_size++;
+			}
+			ring[ iRing ].num_shared_triangles++;
+			ring[ iRing ].consistent &= ( ring[ iRing ].vertex == vertex );
+		}
+
+		const V3f& p1 = _nodes[ fan_triangle.nodes[0] ].position;
+		const V3f& p2 = _nodes[ fan_triangle.nodes[1] ].position;
+		fan_triangle.normal = V3_Cross( p1 - node.position, p2 - node.position );
+	}
+
+	if( !ring_size ) {
+		return false;
+	}
+
+	const F32* collapsed_attributes = _attributes + collapsed_vertex * _attribute_stride;
+
+	// compute the costs first, the topological checks are more expensive
+	REAL	costs[ MAX_RING_SIZE ];
+
+	for( U32 iRing = 0; iRing < ring_size; iRing++ )
+	{
+		const RingNode& candidate = ring[ iRing ];
+		const Node& target = _nodes[ candidate.node ];
+
+		costs[ iRing ] = BIG_NUMBER;
+
+		if( !candidate.consistent ) {
+			continue;
+		}
+
+		// boundary vertices can only slide along the boundary
+		if( node.kind == Vertex_Boundary )
+		{
+			if( candidate.num_shared_triangles != 1 || target.kind == Vertex_Interior ) {
+				continue;
+			}
+		}
+		else if( candidate.num_shared_triangles != 2 ) {
+			continue;
+		}
+
+		// the vertex is moved onto the target, so the error is measured at the target's position;
+		// dividing by the area gives the mean squared distance to the original planes
+		QuadricT Q = node.Q;
+		Q += target.Q;
+
+		const REAL area = largest( node.area + target.area, REAL(1e-12) );
+		REAL cost = Q.ComputeVertexError( target.position.x, target.position.y, target.position.z ) / area;
+		cost = largest( cost, REAL(0) );
+
+		if( _num_attributes )
+		{
+			const F32* target_attributes = _attributes + candidate.vertex * _attribute_stride;
+			REAL attribute_error = 0;
+			for( U32 i = 0; i < _num_attributes; i++ ) {
+				const REAL delta = collapsed_attributes[i] - target_attributes[i];
+				attribute_error += delta * delta;
+			}
+			cost += attribute_error * settings.attribute_weight;
+		}
+
+		costs[ iRing ] = cost;
+	}
+
+	// check the candidates in the order of increasing cost
+	for(;;)
+	{
+		U32 iBest = 0;
+		for( U32 iRing = 1; iRing < ring_size; iRing++ ) {
+			if( costs[ iRing ] < costs[ iBest ] ) {
+				iBest = iRing;
+			}
+		}
+		if( costs[ iBest ] >= BIG_NUMBER ) {
+			return false;
+		}
+
+		if( IsCollapseValid( node_index, ring, ring_size, iBest, fan, fan_size ) )
+		{
+			collapse_.cost = costs[ iBest ];
+			collapse_.target_node = ring[ iBest ].node;
+			collapse_.target_vertex = ring[ iBest ].vertex;
+			return true;
+		}
+
+		costs[ iBest ] = BIG_NUMBER;
+	}
+}
+
+bool QuadricSimplifier::IsCollapseValid(
+	const U32 node_index
+	, const RingNode* ring
+	, const U32 ring_size
+	, const U32 candidate_index
+	, const FanTriangle* fan
+	, const U32 fan_size
+	) const
+{
+	const U32* vertex_nodes = _vertex_nodes.raw();
+	const RingNode& candidate = ring[ candidate_index ];
+	const Node& target = _nodes[ candidate.node ];
+
+	// reject collapses which flip or degenerate the remaining triangles
+	for( U32 iFan = 0; iFan < fan_size; iFan++ )
+	{
+		const FanTriangle& fan_triangle = fan[ iFan ];
+		if( fan_triangle.nodes[0] == candidate.node || fan_triangle.nodes[1] == candidate.node ) {
+			continue;	// will be removed
+		}
+
+		const V3f& p1 = _nodes[ fan_triangle.nodes[0] ].position;
+		const V3f& p2 = _nodes[ fan_triangle.nodes[1] ].position;
+		const V3f new_normal = V3_Cross( p1 - target.position, p2 - target.position );
+
+		const F32 new_normal_length_sq = V3_Dot( new_normal, new_normal );
+		const F32 old_normal_length_sq = V3_Dot( fan_triangle.normal, fan_triangle.normal );
+
+		if( V3_Dot( fan_triangle.normal, new_normal ) <= 0
+			|| new_normal_length_sq <= old_normal_length_sq * 1e-6f )
+		{
+			return false;
+		}
+	}
+
+	// the link condition: the common neighbors must be exactly the opposite vertices of the shared triangles,
+	// otherwise the collapse would create non-manifold edges
+	U32 num_common_neighbors = 0;
+	U32 counted_mask[ (MAX_RING_SIZE + 31) / 32 ] = { 0 };
+
+	const U32* target_refs = _refs.raw() + target.first_ref;
+	for( U32 iRef = 0; iRef < target.num_refs; iRef++ )
+	{
+		const U32 iTri = target_refs[ iRef ];
+		if( _triangle_removed[ iTri ] ) {
+			continue;
+		}
+		const UInt3& tri = _triangles[ iTri ];
+		for( UINT k = 0; k < 3; k++ )
+		{
+			const U32 neighbor = vertex_nodes[ tri[k] ];
+			for( U32 j = 0; j < ring_size; j++ )
+			{
+				if( ring[j].node == neighbor && !( counted_mask[ j / 32 ] & BIT( j % 32 ) ) ) {
+					counted_mask[ j / 32 ] |= BIT( j % 32 );
+					num_common_neighbors++;
+				}
+			}
+		}
+	}
+
+	// the target itself was counted, too
+	return num_common_neighbors - 1 == candidate.num_shared_triangles;
+}
+
+ERet QuadricSimplifier::PerformCollapse( const U32 node_index, const Collapse& collapse )
+{
+	const U32* vertex_nodes = _vertex_nodes.raw();
+
+	Node & node = _nodes[ node_index ];
+	Node & target = _nodes[ collapse.target_node ];
+
+	target.Q += node.Q;
+	target.area += node.area;
+	node.removed = true;
+
+	// the target's new list of triangles: its own triangles and the collapsed vertex' triangles
+	const U32 new_first_ref = _refs.num();
+
+	for( U32 iRef = 0; iRef < target.num_refs; iRef++ )
+	{
+		const U32 iTri = _refs[ target.first_ref + iRef ];
+		if( !_triangle_removed[ iTri ] ) {
+			mxDO(_refs.add( iTri ));
+		}
+	}
+
+	for( U32 iRef = 0; iRef < node.num_refs; iRef++ )
+	{
+		const U32 iTri = _refs[ node.first_ref + iRef ];
+		if( _triangle_removed[ iTri ] ) {
+			continue;
+		}
+
+		UInt3 & tri = _triangles[ iTri ];
+		if( FindTriangleCornerWithNode( tri, vertex_nodes, collapse.target_node ) >= 0 )
+		{
+			// the triangle becomes degenerate
+			_triangle_removed[ iTri ] = true;
+			_num_live_triangles--;
+			continue;
+		}
+
+		const int corner = FindTriangleCornerWithNode( tri, vertex_nodes, node_index );
+		tri[ corner ] = collapse.target_vertex;
+		mxDO(_refs.add( iTri ));
+	}
+
+	// reload, the array could have been reallocated
+	Node & updated_target = _nodes[ collapse.target_node ];
+	updated_target.first_ref = new_first_ref;
+	updated_target.num_refs = _refs.num() - new_first_ref;
+
+	_stats.num_collapses++;
+
+	return ALL_OK;
+}
+
+ERet QuadricSimplifier::UpdateCollapseCandidates( const U32 node_index, const Settings& settings )
+{
+	const U32* vertex_nodes = _vertex_nodes.raw();
+
+	// the node and its neighbors (without duplicates)
+	U32	nodes_to_update[ MAX_RING_SIZE + 1 ];
+	U32	num_nodes_to_update = 0;
+	nodes_to_update[ num_nodes_to_update++ ] = node_index;
+
+	const Node& node = _nodes[ node_index ];
+	for( U32 iRef = 0; iRef < node.num_refs; iRef++ )
+	{
+		const U32 iTri = _refs[ node.first_ref + iRef ];
+		if( _triangle_removed[ iTri ] ) {
+			continue;
+		}
+		const UInt3& tri = _triangles[ iTri ];
+		for( UINT k = 0; k < 3; k++ )
+		{
+			const U32 neighbor = vertex_nodes[ tri[k] ];
+
+			U32 i = 0;
+			while( i < num_nodes_to_update && nodes_to_update[i] != neighbor ) {
+				i++;
+			}
+			if( i == num_nodes_to_update && num_nodes_to_update < mxCOUNT_OF(nodes_to_update) ) {
+				nodes_to_update[ num_nodes_to_update++ ] = neighbor;
+			}
+		}
+	}
+
+	for( U32 i = 0; i < num_nodes_to_update; i++ )
+	{
+		const U32 index = nodes_to_update[i];
+		Node & node_to_update = _nodes[ index ];
+
+		// invalidate old heap entries
+		node_to_update.version++;
+
+		Collapse	collapse;
+		if( FindBestCollapse( index, settings, collapse ) )
+		{
+			HeapEntry	entry;
+			entry.cost = (F32) collapse.cost;
+			entry.node = index;
+			entry.version = node_to_update.version;
+			mxDO(_heap.add( entry ));
+			std::push_heap( _heap.raw(), _heap.raw() + _heap.num() );
+		}
+	}
+
+	return ALL_OK;
+}
+
+ERet QuadricSimplifier::EmitLod( const F32 error, MeshLodChain &lod_chain_ ) const
+{
+	mxASSERT( lod_chain_.num_lods < MeshLodChain::MAX_LODS );
+
+	MeshLodChain::Lod & lod = lod_chain_.lods[ lod_chain_.num_lods++ ];
+	lod.first_index = lod_chain_.indices.num();
+	lod.num_indices = _num_live_triangles * 3;
+	lod.error = error;
+
+	mxDO(lod_chain_.indices.setNum( lod.first_index + lod.num_indices ));
+	U32 *dst_indices = lod_chain_.indices.raw() + lod.first_index;
+
+	for( U32 iTri = 0; iTri < _triangles.num(); iTri++ )
+	{
+		if( !_triangle_removed[ iTri ] )
+		{
+			const UInt3& tri = _triangles[ iTri ];
+			if( _normals )
+			{
+				// split the welded hard edges again
+				const V3f& p0 = _nodes[ _vertex_nodes[ tri.x ] ].position;
+				const V3f& p1 = _nodes[ _vertex_nodes[ tri.y ] ].position;
+				const V3f& p2 = _nodes[ _vertex_nodes[ tri.z ] ].position;
+				const V3f face_normal = V3_Cross( p1 - p0, p2 - p0 );
+
+				*dst_indices++ = SelectVertexByNormal( tri.x, face_normal );
+				*dst_indices++ = SelectVertexByNormal( tri.y, face_normal );
+				*dst_indices++ = SelectVertexByNormal( tri.z, face_normal );
+			}
+			else
+			{
+				*dst_indices++ = tri.x;
+				*dst_indices++ = tri.y;
+				*dst_indices++ = tri.z;
+			}
+		}
+	}
+
+	return ALL_OK;
+}
+
+U32 QuadricSimplifier::SelectVertexByNormal( const U32 wedge_vertex, const V3f& face_normal ) const
+{
+	const UInt2 wedge_range = _wedge_ranges[ wedge_vertex ];
+	const U32* copies = _sorted_vertices.raw() + wedge_range.x;
+
+	U32 best_vertex = wedge_vertex;
+	F32 best_dot = -BIG_NUMBER;
+	for( U32 i = 0; i < wedge_range.y; i++ )
+	{
+		const F32 dot = V3_Dot( _normals[ copies[i] ], face_normal );
+		if( dot > best_dot ) {
+			best_dot = dot;
+			best_vertex = copies[i];
+		}
+	}
+	return best_vertex;
+}
+
+}//namespace Meshok
+
+
+/*
+-----------------------------------------------------------------------------
+	UNIT TESTS
+-----------------------------------------------------------------------------
+*/
+
+#if MX_DEVELOPER
+
+namespace Meshok
+{
+
+namespace
+{
+	/// A tessellated cube with separate vertices (and normals) for each face:
+	/// the simplifier must not lock the hard edges and each LOD triangle must use the normals of its face.
+	static ERet testHardEdges( AllocatorI & allocator )
+	{
+		enum { FACE_GRID_SIZE = 16 };
+		const U32 vertices_per_face = ( FACE_GRID_SIZE + 1 ) * ( FACE_GRID_SIZE + 1 );
+
+		DynamicArray< V3f >	positions( allocator );
+		DynamicArray< V3f >	normals( allocator );
+		DynamicArray< U32 >	indices( allocator );
+		mxDO(positions.setNum( vertices_per_face * 6 ));
+		mxDO(normals.setNum( vertices_per_face * 6 ));
+		mxDO(indices.setNum( FACE_GRID_SIZE * FACE_GRID_SIZE * 6 * 6 ));
+
+		U32 *dst_indices = indices.raw();
+
+		for( U32 face = 0; face < 6; face++ )
+		{
+			// the face normal and two tangent axes forming a right-handed basis
+			const U32 axis = face / 2;
+			const F32 sign = ( face & 1 ) ? -1.0f : +1.0f;
+
+			V3f	normal = CV3f(0);
+			normal[ axis ] = sign;
+			V3f	tangent = CV3f(0);
+			tangent[ ( axis + 1 ) % 3 ] = 1;
+			const V3f bitangent = V3_Cross( normal, tangent );
+
+			const U32 first_vertex = face * vertices_per_face;
+
+			for( U32 y = 0; y <= FACE_GRID_SIZE; y++ )
+			{
+				for( U32 x = 0; x <= FACE_GRID_SIZE; x++ )
+				{
+					// integer coordinates, so that the vertices on the cube's edges have exactly the same positions
+					const F32 u = F32( int( x * 2 ) - FACE_GRID_SIZE );
+					const F32 v = F32( int( y * 2 ) - FACE_GRID_SIZE );
+					const U32 i = first_vertex + y * ( FACE_GRID_SIZE + 1 ) + x;
+					positions[i] = normal * F32(FACE_GRID_SIZE) + tangent * u + bitangent * v;
+					normals[i] = normal;
+				}
+			}
+
+			for( U32 y = 0; y < FACE_GRID_SIZE; y++ )
+			{
+				for( U32 x = 0; x < FACE_GRID_SIZE; x++ )
+				{
+					const U32 i00 = first_vertex + y * ( FACE_GRID_SIZE + 1 ) + x;
+					const U32 i10 = i00 + 1;
+					const U32 i01 = i00 + FACE_GRID_SIZE + 1;
+					const U32 i11 = i01 + 1;
+					*dst_indices++ = i00;	*dst_indices++ = i10;	*dst_indices++ = i11;
+					*dst_indices++ = i00;	*dst_indices++ = i11;	*dst_indices++ = i01;
+				}
+			}
+		}
+
+		QuadricSimplifier::Input	input;
+		input.positions = positions.raw();
+		input.num_vertices = positions.num();
+		input.indices = indices.raw();
+		input.num_indices = indices.num();
+		input.normals = normals.raw();
+
+		QuadricSimplifier::Settings	settings;
+		settings.num_lods = 5;
+		settings.triangle_reduction = 0.25f;
+		settings.min_triangles = 12;
+
+		QuadricSimplifier	simplifier( allocator );
+		MeshLodChain		lod_chain( allocator );
+		mxDO(simplifier.GenerateLodChain( input, settings, lod_chain ));
+
+		const QuadricSimplifier::Stats& stats = simplifier.GetStats();
+		mxENSURE( stats.num_locked_vertices == 0 && stats.num_boundary_vertices == 0,
+			ERR_UNKNOWN_ERROR, "the hard edges must be welded: %u locked, %u boundary verts",
+			stats.num_locked_vertices, stats.num_boundary_vertices );
+
+		// the flat faces can be simplified down to two triangles each
+		const MeshLodChain::Lod& last_lod = lod_chain.lods[ lod_chain.num_lods - 1 ];
+		mxENSURE( lod_chain.num_lods == settings.num_lods && last_lod.num_indices == settings.min_triangles * 3,
+			ERR_UNKNOWN_ERROR, "the cube has been simplified to %u triangles", last_lod.num_indices / 3 );
+
+		for( U32 iLod = 1; iLod < lod_chain.num_lods; iLod++ )
+		{
+			const MeshLodChain::Lod& lod = lod_chain.lods[ iLod ];
+			const U32* lod_indices = lod_chain.GetLodIndices( iLod );
+
+			for( U32 i = 0; i < lod.num_indices; i += 3 )
+			{
+				const V3f& p0 = positions[ lod_indices[i+0] ];
+				const V3f& p1 = positions[ lod_indices[i+1] ];
+				const V3f& p2 = positions[ lod_indices[i+2] ];
+				const V3f face_normal = V3_Normalized( V3_Cross( p1 - p0, p2 - p0 ) );
+
+				for( UINT k = 0; k < 3; k++ ) {
+					mxENSURE( V3_Dot( normals[ lod_indices[i+k] ], face_normal ) > 0.999f,
+						ERR_UNKNOWN_ERROR, "LOD %u, triangle %u: the hard edge has been smoothed", iLod, i / 3 );
+				}
+			}
+		}
+
+		ptPRINT("QuadricSimplifier: cube with hard edges: %u -> %u triangles in %u LODs",
+			input.num_indices / 3, last_lod.num_indices / 3, lod_chain.num_lods
+			);
+
+		return ALL_OK;
+	}
+}//namespace
+
+ERet Benchmark_QuadricSimplifier(
+	AllocatorI & allocator
+	, const U32 num_triangles
+	)
+{
+	mxDO(testHardEdges( allocator ));
+
+	// a bumpy grid with UVs
+	const U32 grid_size = largest( U32( mmSqrt( num_triangles / 2.0f ) ), 2u );
+	const U32 num_vertices = ( grid_size + 1 ) * ( grid_size + 1 );
+
+	DynamicArray< V3f >	positions( allocator );
+	DynamicArray< V2f >	uvs( allocator );
+	DynamicArray< U32 >	indices( allocator );
+	mxDO(positions.setNum( num_vertices ));
+	mxDO(uvs.setNum( num_vertices ));
+	mxDO(indices.setNum( grid_size * grid_size * 6 ));
+
+	for( U32 y = 0; y <= grid_size; y++ )
+	{
+		for( U32 x = 0; x <= grid_size; x++ )
+		{
+			const F32 u = F32(x) / grid_size;
+			const F32 v = F32(y) / grid_size;
+			const U32 i = y * ( grid_size + 1 ) + x;
+			positions[i] = V3_Set( u, v, 0.05f * mmSin( u * 12.0f ) * mmCos( v * 9.0f ) );
+			uvs[i] = V2_Set( u, v );
+		}
+	}
+
+	U32 *dst_indices = indices.raw();
+	for( U32 y = 0; y < grid_size; y++ )
+	{
+		for( U32 x = 0; x < grid_size; x++ )
+		{
+			const U32 i00 = y * ( grid_size + 1 ) + x;
+			const U32 i10 = i00 + 1;
+			const U32 i01 = i00 + grid_size + 1;
+			const U32 i11 = i01 + 1;
+			*dst_indices++ = i00;	*dst_indices++ = i10;	*dst_indices++ = i11;
+			*dst_indices++ = i00;	*dst_indices++ = i11;	*dst_indices++ = i01;
+		}
+	}
+
+	QuadricSimplifier::Input	input;
+	input.positions = positions.raw();
+	input.num_vertices = num_vertices;
+	input.indices = indices.raw();
+	input.num_indices = indices.num();
+	input.attributes = (F32*) uvs.raw();
+	input.num_attributes = 2;
+	input.attribute_stride = 2;
+
+	QuadricSimplifier::Settings	settings;
+	settings.num_lods = 6;
+
+	QuadricSimplifier	simplifier( allocator );
+	MeshLodChain		lod_chain( allocator );
+
+	ScopedTimer	timer;
+	mxDO(simplifier.GenerateLodChain( input, settings, lod_chain ));
+	const U32 elapsed_msec = timer.ElapsedMilliseconds();
+
+	const QuadricSimplifier::Stats& stats = simplifier.GetStats();
+	ptPRINT("QuadricSimplifier: %u triangles -> %u LODs in %u msec (%u collapses, %u rejected, %u boundary verts)",
+		input.num_indices / 3, lod_chain.num_lods, elapsed_msec,
+		stats.num_collapses, stats.num_rejected_collapses, stats.num_boundary_vertices
+		);
+
+	mxENSURE( lod_chain.num_lods == settings.num_lods, ERR_UNKNOWN_ERROR, "" );
+
+	for( U32 iLod = 0; iLod < lod_chain.num_lods; iLod++ )
+	{
+		const MeshLodChain::Lod& lod = lod_chain.lods[ iLod ];
+		ptPRINT("LOD %u: %u triangles, error = %f", iLod, lod.num_indices / 3, lod.error);
+
+		if( iLod ) {
+			mxENSURE( lod.num_indices < lod_chain.lods[ iLod - 1 ].num_indices, ERR_UNKNOWN_ERROR, "" );
+		}
+
+		// the LODs must reference the source vertices and the borders of the grid must be preserved
+		AABBf	lod_bounds;
+		lod_bounds.clear();
+
+		const U32* lod_indices = lod_chain.GetLodIndices( iLod );
+		for( U32 i = 0; i < lod.num_indices; i++ ) {
+			mxENSURE( lod_indices[i] < num_vertices, ERR_UNKNOWN_ERROR, "" );
+			lod_bounds.addPoint( positions[ lod_indices[i] ] );
+		}
+		mxENSURE( lod_bounds.min_corner.x == 0 && lod_bounds.min_corner.y == 0
+			&& lod_bounds.max_corner.x == 1 && lod_bounds.max_corner.y == 1,
+			ERR_UNKNOWN_ERROR, "LOD %u: the boundary has not been preserved", iLod );
+	}
+
+	return ALL_OK;
+}
+
+}//namespace Meshok
+
+#endif // MX_DEVELOPER
+
+//--------------------------------------------------------------//
+//				End Of File.									//
+//--------------------------------------------------------------//
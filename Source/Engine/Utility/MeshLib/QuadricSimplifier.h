@@ -0,0 +1,256 @@
+// Quadric-error edge-collapse simplifier producing a chain of LODs.
+#pragma once
+
+#include <Utility/Meshok/Quadrics.h>
+
+
+namespace Meshok
+{
+
+/// Index buffers of all LODs, sharing the vertex buffer of the source mesh.
+struct MeshLodChain
+{
+	enum { MAX_LODS = 8 };
+
+	struct Lod
+	{
+		U32	first_index;	//!< offset into 'indices'
+		U32	num_indices;
+		F32	error;			//!< max. geometric deviation, relative to the mesh size
+	};
+
+	Lod					lods[ MAX_LODS ];	//!< lods[0] is the source mesh
+	U32					num_lods;
+	DynamicArray< U32 >	indices;	//!< triangle lists of all LODs
+
+public:
+	MeshLodChain( AllocatorI & allocator )
+		: indices( allocator )
+	{
+		num_lods = 0;
+	}
+
+	const U32* GetLodIndices( const U32 lod ) const { return indices.raw() + lods[ lod ].first_index; }
+};
+
+mxBIBREF("Garland, M. and Heckbert, P. S. 1997. Surface simplification using quadric error metrics.");
+mxBIBREF("Hoppe, H. 1999. New quadric metric for simplifying meshes with appearance attributes.");
+///
+/// Heap-driven edge-collapse simplifier.
+/// Vertices are only ever moved onto their neighbors (half-edge collapses),
+/// so all LODs reference the original vertices and can share the vertex buffer;
+/// the LODs are emitted in a single pass as the mesh is being decimated.
+///
+/// Open boundaries are preserved by constraint quadrics and can only collapse along themselves,
+/// attribute seams (vertices with the same position, but different attributes) and non-manifold vertices are locked.
+/// Hard edges (vertices which differ only in their normals) are welded, so that they can be simplified,
+/// and are split again when emitting the LODs.
+///
+class QuadricSimplifier: NonCopyable
+{
+public:
+	struct Input
+	{
+		const V3f *	positions;
+		U32			num_vertices;
+
+		const U32 *	indices;	//!< triangle list
+		U32			num_indices;
+
+		/// [optional] per-vertex attributes (e.g. normals and UVs),
+		/// differences in attributes add to the collapse cost
+		const F32 *	attributes;
+		U32			num_attributes;		//!< per vertex
+		U32			attribute_stride;	//!< in floats
+
+		/// [optional] per-vertex normals, should not be passed as attributes:
+		/// vertices which differ only in their normals are welded before simplification
+		/// and each LOD triangle uses the copies whose normals are closest to its face normal
+		const V3f *	normals;
+	public:
+		Input()
+		{
+			mxZERO_OUT(*this);
+		}
+	};
+
+	struct Settings
+	{
+		/// the number of LODs, including the source mesh
+		U32		num_lods;
+
+		/// each LOD has (approximately) this fraction of triangles of the previous LOD
+		F32		triangle_reduction;
+
+		/// stop simplifying when the number of triangles is below this value
+		U32		min_triangles;
+
+		/// stop simplifying when the geometric error exceeds this value (relative to the mesh size)
+		F32		max_error;
+
+		/// the weight of the constraint planes along open boundaries
+		F32		boundary_weight;
+
+		/// the weight of squared attribute differences
+		F32		attribute_weight;
+
+	public:
+		Settings()
+		{
+			num_lods = 4;
+			triangle_reduction = 0.5f;
+			min_triangles = 64;
+			max_error = BIG_NUMBER;
+			boundary_weight = 10.0f;
+			attribute_weight = 1e-3f;
+		}
+	};
+
+	struct Stats
+	{
+		U32	num_collapses;
+		U32	num_rejected_collapses;	//!< popped from the heap, but could not be performed
+		U32	num_locked_vertices;
+		U32	num_boundary_vertices;
+	};
+
+public:
+	QuadricSimplifier( AllocatorI & allocator );
+
+	ERet GenerateLodChain(
+		const Input& input
+		, const Settings& settings
+		, MeshLodChain &lod_chain_
+		);
+
+	const Stats& GetStats() const { return _stats; }
+
+private:
+	typedef double REAL;
+	typedef Quadric< REAL > QuadricT;
+
+	enum EVertexKind
+	{
+		Vertex_Interior,	//!< can collapse into any neighbor
+		Vertex_Boundary,	//!< can only collapse along an open boundary
+		Vertex_Locked,		//!< attribute seam or non-manifold vertex, cannot move
+	};
+
+	/// vertices with the same position (i.e. all wedges of a position) map to one node
+	struct Node
+	{
+		QuadricT	Q;
+		REAL		area;		//!< the total area of the triangles accumulated into the quadric
+		V3f			position;	//!< normalized into [0..1]
+		U32			first_ref;	//!< the first triangle in '_refs'
+		U32			num_refs;	//!< the number of triangles referencing this node (including removed ones)
+		U32			version;	//!< incremented when the neighborhood changes, used to invalidate heap entries
+		U8			kind;		//!< EVertexKind
+		U8			removed;
+	};
+
+	struct Collapse
+	{
+		REAL	cost;
+		U32		target_node;
+		U32		target_vertex;	//!< the wedge of the target node which replaces the collapsed vertex
+	};
+
+	/// vertices with more neighbors are not simplified
+	enum { MAX_RING_SIZE = 64 };
+
+	/// a neighbor of the vertex being collapsed
+	struct RingNode
+	{
+		U32	node;
+		U32	vertex;				//!< the wedge of the node used by the triangles around the collapsed vertex
+		U32	num_shared_triangles;
+		U32	consistent;			//!< all shared triangles use the same wedge
+	};
+
+	/// a triangle around the vertex being collapsed
+	struct FanTriangle
+	{
+		V3f	normal;		//!< unnormalized
+		U32	nodes[2];	//!< the other two corners
+	};
+
+	struct HeapEntry
+	{
+		F32		cost;
+		U32		node;
+		U32		version;
+	public:
+		/// for building a min-heap with std::push_heap()
+		bool operator < ( const HeapEntry& other ) const { return cost > other.cost; }
+	};
+
+private:
+	ERet WeldVertices( const Input& input );
+	ERet SetupTopology( const Input& input, const Settings& settings );
+
+	bool FindBestCollapse( const U32 node_index, const Settings& settings, Collapse &collapse_ ) const;
+
+	bool IsCollapseValid(
+		const U32 node_index
+		, const RingNode* ring
+		, const U32 ring_size
+		, const U32 candidate_index
+		, const FanTriangle* fan
+		, const U32 fan_size
+		) const;
+
+	ERet PerformCollapse( const U32 node_index, const Collapse& collapse );
+
+	ERet UpdateCollapseCandidates( const U32 node_index, const Settings& settings );
+
+	ERet EmitLod( const F32 error, MeshLodChain &lod_chain_ ) const;
+
+	U32 SelectVertexByNormal( const U32 wedge_vertex, const V3f& face_normal ) const;
+
+private:
+	DynamicArray< Node >		_nodes;
+	DynamicArray< U32 >			_vertex_nodes;	//!< vertex -> node
+	DynamicArray< U32 >			_vertex_remap;	//!< vertex -> the first vertex with the same position and attributes
+	DynamicArray< U32 >			_sorted_vertices;	//!< sorted by position, attributes and normals
+	DynamicArray< UInt2 >		_wedge_ranges;	//!< the first vertex -> (offset, count) of all its copies in '_sorted_vertices'
+	DynamicArray< UInt3 >		_triangles;		//!< vertex indices, updated after each collapse
+	DynamicArray< U8 >			_triangle_removed;
+	DynamicArray< U32 >			_refs;			//!< node -> triangles
+	DynamicArray< HeapEntry >	_heap;
+
+	const F32 *	_attributes;
+	U32			_num_attributes;
+	U32			_attribute_stride;
+	const V3f *	_normals;
+
+	U32			_num_live_triangles;
+
+	Stats		_stats;
+};
+
+}//namespace Meshok
+
+
+/*
+-----------------------------------------------------------------------------
+	UNIT TESTS
+-----------------------------------------------------------------------------
+*/
+
+#if MX_DEVELOPER
+
+namespace Meshok
+{
+	/// Simplifies a cube with hard edges and a bumpy, tessellated grid with UVs and prints timings.
+	ERet Benchmark_QuadricSimplifier(
+		AllocatorI & allocator
+		, const U32 num_triangles = 1000000
+		);
+}//namespace Meshok
+
+#endif // MX_DEVELOPER
+
+//--------------------------------------------------------------//
+//				End Of File.									//
+//--------------------------------------------------------------//
@@ -0,0 +1,84 @@
+// SIMD helpers shared by batched (SoA) evaluation paths.
+#pragma once
+
+/*
+-----------------------------------------------------------------------------
+	SIMD width selection.
+	8-wide AVX is used if the compiler targets AVX (/arch:AVX, -mavx),
+	otherwise we fall back to 4-wide SSE4.1 (the engine's baseline).
+-----------------------------------------------------------------------------
+*/
+#if defined(__AVX__)
+	#define nwMESHOK_SIMD_USE_AVX	(1)
+#else
+	#define nwMESHOK_SIMD_USE_AVX	(0)
+#endif
+
+namespace Meshok
+{
+namespace SIMD
+{
+
+#if nwMESHOK_SIMD_USE_AVX
+
+	typedef __m256	VecF;
+	enum { LANES = 8 };
+
+	#define VF_LOAD( P )		_mm256_loadu_ps( (P) )
+	#define VF_STORE( P, V )	_mm256_storeu_ps( (P), (V) )
+	#define VF_SET( X )			_mm256_set1_ps( (X) )
+	#define VF_ADD( A, B )		_mm256_add_ps( (A), (B) )
+	#define VF_SUB( A, B )		_mm256_sub_ps( (A), (B) )
+	#define VF_MUL( A, B )		_mm256_mul_ps( (A), (B) )
+	#define VF_DIV( A, B )		_mm256_div_ps( (A), (B) )
+	#define VF_MIN( A, B )		_mm256_min_ps( (A), (B) )
+	#define VF_MAX( A, B )		_mm256_max_ps( (A), (B) )
+	#define VF_SQRT( A )		_mm256_sqrt_ps( (A) )
+	#define VF_FLOOR( A )		_mm256_floor_ps( (A) )
+	#define VF_AND( A, B )		_mm256_and_ps( (A), (B) )
+	#define VF_OR( A, B )		_mm256_or_ps( (A), (B) )
+	#define VF_XOR( A, B )		_mm256_xor_ps( (A), (B) )
+	#define VF_ANDNOT( A, B )	_mm256_andnot_ps( (A), (B) )
+	#define VF_CMPEQ( A, B )	_mm256_cmp_ps( (A), (B), _CMP_EQ_OQ )
+	#define VF_CMPGE( A, B )	_mm256_cmp_ps( (A), (B), _CMP_GE_OQ )
+	#define VF_CMPLT( A, B )	_mm256_cmp_ps( (A), (B), _CMP_LT_OQ )
+	#define VF_SELECT( MASK, A, B )	_mm256_blendv_ps( (B), (A), (MASK) )
+
+#else
+
+	typedef __m128	VecF;
+	enum { LANES = 4 };
+
+	#define VF_LOAD( P )		_mm_loadu_ps( (P) )
+	#define VF_STORE( P, V )	_mm_storeu_ps( (P), (V) )
+	#define VF_SET( X )			_mm_set1_ps( (X) )
+	#define VF_ADD( A, B )		_mm_add_ps( (A), (B) )
+	#define VF_SUB( A, B )		_mm_sub_ps( (A), (B) )
+	#define VF_MUL( A, B )		_mm_mul_ps( (A), (B) )
+	#define VF_DIV( A, B )		_mm_div_ps( (A), (B) )
+	#define VF_MIN( A, B )		_mm_min_ps( (A), (B) )
+	#define VF_MAX( A, B )		_mm_max_ps( (A), (B) )
+	#define VF_SQRT( A )		_mm_sqrt_ps( (A) )
+	#define VF_FLOOR( A )		_mm_floor_ps( (A) )
+	#define VF_AND( A, B )		_mm_and_ps( (A), (B) )
+	#define VF_OR( A, B )		_mm_or_ps( (A), (B) )
+	#define VF_XOR( A, B )		_mm_xor_ps( (A), (B) )
+	#define VF_ANDNOT( A, B )	_mm_andnot_ps( (A), (B) )
+	#define VF_CMPEQ( A, B )	_mm_cmpeq_ps( (A), (B) )
+	#define VF_CMPGE( A, B )	_mm_cmpge_ps( (A), (B) )
+	#define VF_CMPLT( A, B )	_mm_cmplt_ps( (A), (B) )
+	#define VF_SELECT( MASK, A, B )	_mm_blendv_ps( (B), (A), (MASK) )
+
+#endif
+
+}//namespace SIMD
+}//namespace Meshok
+
+#define VF_SIGN_MASK		VF_SET( -0.0f )
+#define VF_ABS( A )			VF_ANDNOT( VF_SIGN_MASK, (A) )
+#define VF_NEGATE( A )		VF_XOR( (A), VF_SIGN_MASK )
+#define VF_MADD( A, B, C )	VF_ADD( VF_MUL( (A), (B) ), (C) )
+
+//--------------------------------------------------------------//
+//				End Of File.									//
+//--------------------------------------------------------------//
@@ -0,0 +1,558 @@
+// Linear (pointerless) octree stored as a sorted array of Morton keys.
+#include "stdafx.h"
+#pragma hdrstop
+
+#include <algorithm>	// std::sort
+
+#include <Meshok/LinearOctree.h>
+
+namespace VX
+{
+
+LinearOctree::LinearOctree( AllocatorI & allocator )
+	: _keys( allocator )
+{
+}
+
+void LinearOctree::Clear()
+{
+	_keys.RemoveAll();
+}
+
+ERet LinearOctree::Build(
+	F_ClassifyCell* classify_cell
+	, void* user_data
+	, const U32 max_depth
+	)
+{
+	mxASSERT_PTR(classify_cell);
+	mxENSURE( max_depth <= MAX_DEPTH, ERR_INVALID_PARAMETER, "max depth must not exceed %u", MAX_DEPTH );
+
+	_keys.RemoveAll();
+
+	// depth-first traversal with an explicit stack;
+	// children are pushed in reverse order so that the leaves are emitted in increasing Morton order
+	struct CellToVisit
+	{
+		Morton32	code;
+		U32			level;
+	};
+	CellToVisit	stack[ 1 + (NUM_OCTANTS - 1) * MAX_DEPTH ];
+	U32			stack_top = 0;
+
+	stack[ stack_top ].code = 0;
+	stack[ stack_top ].level = 0;
+	++stack_top;
+
+	while( stack_top )
+	{
+		const CellToVisit cell = stack[ --stack_top ];
+
+		const ECellAction action = (*classify_cell)(
+			Morton32_Decode( cell.code ),
+			GetCellSize( cell.level ),
+			cell.level,
+			user_data
+			);
+
+		if( action == Cell_Discard ) {
+			continue;
+		}
+
+		if( action == Cell_Keep || cell.level >= max_depth ) {
+			mxDO(_keys.add( MakeKeyFromMortonCode( cell.code, cell.level ) ));
+			continue;
+		}
+
+		const U32 child_level = cell.level + 1;
+		const U32 child_span = GetMortonSpan( child_level );
+		for( int octant = NUM_OCTANTS - 1; octant >= 0; octant-- )
+		{
+			stack[ stack_top ].code = cell.code + octant * child_span;
+			stack[ stack_top ].level = child_level;
+			++stack_top;
+		}
+	}
+
+	return ALL_OK;
+}
+
+ERet LinearOctree::BuildFromLeaves(
+	const LinearOctreeKey* leaf_keys
+	, const U32 num_leaves
+	)
+{
+	mxDO(_keys.setNum( num_leaves ));
+	if( !num_leaves ) {
+		return ALL_OK;
+	}
+	memcpy( _keys.raw(), leaf_keys, num_leaves * sizeof(leaf_keys[0]) );
+
+	std::sort( _keys.raw(), _keys.raw() + num_leaves );
+
+	// validate: the leaves must not overlap
+	for( U32 i = 0; i < num_leaves; i++ )
+	{
+		const LinearOctreeKey key = _keys[i];
+		const U32 level = GetLevel( key );
+		const Morton32 code = GetMortonCode( key );
+		const U32 span = GetMortonSpan( level );
+
+		mxENSURE( level <= MAX_DEPTH && code < MORTON_CODE_LIMIT && (code & (span - 1)) == 0,
+			ERR_INVALID_PARAMETER, "invalid leaf key: 0x%X", key );
+
+		if( i + 1 < num_leaves ) {
+			mxENSURE( code + span <= GetMortonCode( _keys[i + 1] ),
+				ERR_INVALID_PARAMETER, "overlapping leaves: 0x%X and 0x%X", key, _keys[i + 1] );
+		}
+	}
+
+	return ALL_OK;
+}
+
+U32 LinearOctree::FirstLeafNotBelow( const Morton32 code, const U32 start, const U32 end ) const
+{
+	const LinearOctreeKey* keys = _keys.raw();
+	const LinearOctreeKey search_key = MakeKeyFromMortonCode( code, 0 );
+
+	U32 lo = start;
+	U32 hi = end;
+	while( lo < hi )
+	{
+		const U32 mid = (lo + hi) / 2;
+		if( keys[ mid ] < search_key ) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	return lo;
+}
+
+U32 LinearOctree::FindLeafContainingMortonCode( const Morton32 point_code ) const
+{
+	if( point_code >= MORTON_CODE_LIMIT ) {
+		return NIL_INDEX;
+	}
+
+	// the containing leaf (if any) is the last leaf whose Morton code is not greater than the point's code:
+	// any leaf in between would overlap the containing leaf
+	const U32 next = FirstLeafNotBelow( point_code + 1, 0, _keys.num() );
+	if( next == 0 ) {
+		return NIL_INDEX;
+	}
+
+	const U32 leaf_index = next - 1;
+	return CellContainsMortonCode( _keys[ leaf_index ], point_code ) ? leaf_index : NIL_INDEX;
+}
+
+U32 LinearOctree::FindLeafContainingPoint( const UInt3& point ) const
+{
+	if( point.x >= RESOLUTION || point.y >= RESOLUTION || point.z >= RESOLUTION ) {
+		return NIL_INDEX;
+	}
+	return FindLeafContainingMortonCode( Morton32_Encode( point.x, point.y, point.z ) );
+}
+
+void LinearOctree::FindLeavesContainingPoints(
+	const UInt3* points
+	, const U32 num_points
+	, U32 *leaf_indices_
+	) const
+{
+	const U32 num_leaves = _keys.num();
+	U32 last_leaf_index = NIL_INDEX;
+
+	for( U32 i = 0; i < num_points; i++ )
+	{
+		const UInt3& point = points[i];
+
+		if( point.x >= RESOLUTION || point.y >= RESOLUTION || point.z >= RESOLUTION ) {
+			leaf_indices_[i] = NIL_INDEX;
+			continue;
+		}
+
+		const Morton32 point_code = Morton32_Encode( point.x, point.y, point.z );
+
+		// neighboring points usually fall into the same or the next leaf
+		if( last_leaf_index != NIL_INDEX )
+		{
+			if( CellContainsMortonCode( _keys[ last_leaf_index ], point_code ) ) {
+				leaf_indices_[i] = last_leaf_index;
+				continue;
+			}
+			if( last_leaf_index + 1 < num_leaves
+				&& CellContainsMortonCode( _keys[ last_leaf_index + 1 ], point_code ) )
+			{
+				leaf_indices_[i] = ++last_leaf_index;
+				continue;
+			}
+		}
+
+		const U32 leaf_index = FindLeafContainingMortonCode( point_code );
+		leaf_indices_[i] = leaf_index;
+		if( leaf_index != NIL_INDEX ) {
+			last_leaf_index = leaf_index;
+		}
+	}
+}
+
+U32 LinearOctree::FindFaceNeighbor(
+	const U32 leaf_index
+	, const CubeFace::Enum face
+	) const
+{
+	const LinearOctreeKey key = _keys[ leaf_index ];
+	const Morton32 code = GetMortonCode( key );
+	const U32 axis = face / 2;
+	const bool is_positive_face = ( face & 1 );
+
+	// step from the leaf's minimal corner to the adjacent finest cell;
+	// overflow/underflow sets the bits above MORTON_CODE_LIMIT
+	const Morton32 neighbor_code = is_positive_face
+		? Morton32_Add( code, Morton32_SpreadBits3( GetCellSize( GetLevel( key ) ) ) << axis )
+		: Morton32_Sub( code, Morton32_SpreadBits3( 1 ) << axis )
+		;
+
+	return FindLeafContainingMortonCode( neighbor_code );
+}
+
+void LinearOctree::GetLeavesInsideCell(
+	const LinearOctreeKey cell_key
+	, U32 &first_
+	, U32 &end_
+	) const
+{
+	const Morton32 code = GetMortonCode( cell_key );
+	const U32 span = GetMortonSpan( GetLevel( cell_key ) );
+	const U32 num_leaves = _keys.num();
+
+	first_ = FirstLeafNotBelow( code, 0, num_leaves );
+	end_ = FirstLeafNotBelow( code + span, first_, num_leaves );
+
+	if( first_ == end_ )
+	{
+		// no leaves start inside the cell - the cell may lie inside a bigger leaf
+		const U32 leaf_index = FindLeafContainingMortonCode( code );
+		if( leaf_index != NIL_INDEX ) {
+			first_ = leaf_index;
+			end_ = leaf_index + 1;
+		}
+	}
+}
+
+ERet LinearOctree::FindLeavesOverlappingBox(
+	const UInt3& box_min
+	, const UInt3& box_max
+	, DynamicArray< U32 > &leaf_indices_
+	) const
+{
+	const UInt3 clamped_max(
+		smallest( box_max.x, (U32)RESOLUTION ),
+		smallest( box_max.y, (U32)RESOLUTION ),
+		smallest( box_max.z, (U32)RESOLUTION )
+		);
+	if( box_min.x >= clamped_max.x || box_min.y >= clamped_max.y || box_min.z >= clamped_max.z ) {
+		return ALL_OK;
+	}
+
+	return GatherLeavesOverlappingBox_R(
+		0, 0,
+		0, _keys.num(),
+		box_min, clamped_max,
+		leaf_indices_
+		);
+}
+
+ERet LinearOctree::GatherLeavesOverlappingBox_R(
+	const Morton32 cell_code
+	, const U32 level
+	, const U32 first
+	, const U32 end
+	, const UInt3& box_min
+	, const UInt3& box_max
+	, DynamicArray< U32 > &leaf_indices_
+	) const
+{
+	if( first == end ) {
+		return ALL_OK;
+	}
+
+	const UInt3 cell_min = Morton32_Decode( cell_code );
+	const U32 cell_size = GetCellSize( level );
+
+	if( cell_min.x >= box_max.x || cell_min.x + cell_size <= box_min.x ||
+		cell_min.y >= box_max.y || cell_min.y + cell_size <= box_min.y ||
+		cell_min.z >= box_max.z || cell_min.z + cell_size <= box_min.z )
+	{
+		return ALL_OK;
+	}
+
+	const bool cell_is_inside_box =
+		cell_min.x >= box_min.x && cell_min.x + cell_size <= box_max.x &&
+		cell_min.y >= box_min.y && cell_min.y + cell_size <= box_max.y &&
+		cell_min.z >= box_min.z && cell_min.z + cell_size <= box_max.z
+		;
+
+	// the cell is the leaf itself
+	if( cell_is_inside_box || GetLevel( _keys[ first ] ) <= level )
+	{
+		for( U32 i = first; i < end; i++ ) {
+			mxDO(leaf_indices_.add( i ));
+		}
+		return ALL_OK;
+	}
+
+	// split the range of leaves between the children
+	const U32 child_level = level + 1;
+	const U32 child_span = GetMortonSpan( child_level );
+
+	U32 child_first = first;
+	for( UINT octant = 0; octant < NUM_OCTANTS; octant++ )
+	{
+		const Morton32 child_code = cell_code + octant * child_span;
+		const U32 child_end = ( octant == NUM_OCTANTS - 1 )
+			? end
+			: FirstLeafNotBelow( child_code + child_span, child_first, end )
+			;
+
+		mxDO(GatherLeavesOverlappingBox_R(
+			child_code, child_level,
+			child_first, child_end,
+			box_min, box_max,
+			leaf_indices_
+			));
+
+		child_first = child_end;
+	}
+
+	return ALL_OK;
+}
+
+}//namespace VX
+
+
+/*
+-----------------------------------------------------------------------------
+	UNIT TESTS
+-----------------------------------------------------------------------------
+*/
+
+#if MX_DEVELOPER
+
+#include <Base/Math/Random.h>
+
+namespace VX
+{
+
+namespace
+{
+	struct TestSphere
+	{
+		int	center;
+		int	radius;
+	};
+
+	// keeps the cells inside the sphere, subdivides the cells intersecting its surface
+	static LinearOctree::ECellAction ClassifyCell_Sphere(
+		const UInt3& corner
+		, const U32 size
+		, const U32 level
+		, void* user_data
+		)
+	{
+		const TestSphere& sphere = *(TestSphere*) user_data;
+
+		int min_dist_sq = 0;
+		int max_dist_sq = 0;
+		for( int axis = 0; axis < 3; axis++ )
+		{
+			const int lo = (int)corner[axis] - sphere.center;
+			const int hi = lo + (int)size;
+			const int nearest = ( lo > 0 ) ? lo : ( hi < 0 ) ? hi : 0;
+			min_dist_sq += nearest * nearest;
+			max_dist_sq += largest( lo * lo, hi * hi );
+		}
+
+		const int radius_sq = sphere.radius * sphere.radius;
+		if( min_dist_sq >= radius_sq ) {
+			return LinearOctree::Cell_Discard;
+		}
+		if( max_dist_sq <= radius_sq ) {
+			return LinearOctree::Cell_Keep;
+		}
+		return LinearOctree::Cell_Split;
+	}
+
+	static bool LeafContainsPoint( const LinearOctreeKey key, const UInt3& point )
+	{
+		const UInt3 corner = LinearOctree::GetCorner( key );
+		const U32 size = LinearOctree::GetCellSize( LinearOctree::GetLevel( key ) );
+		return point.x - corner.x < size && point.y - corner.y < size && point.z - corner.z < size;
+	}
+
+	static U32 FindLeafContainingPoint_BruteForce( const LinearOctree& octree, const UInt3& point )
+	{
+		for( U32 i = 0; i < octree.NumLeaves(); i++ ) {
+			if( LeafContainsPoint( octree.GetLeafKey(i), point ) ) {
+				return i;
+			}
+		}
+		return LinearOctree::NIL_INDEX;
+	}
+
+	static UInt3 GetRandomPoint( NwRandom & rng, const U32 range )
+	{
+		return UInt3(
+			(rng.RandomInt() * NwRandom::MAX_RAND + rng.RandomInt()) % range,
+			(rng.RandomInt() * NwRandom::MAX_RAND + rng.RandomInt()) % range,
+			(rng.RandomInt() * NwRandom::MAX_RAND + rng.RandomInt()) % range
+			);
+	}
+}//namespace
+
+ERet UnitTest_LinearOctree( AllocatorI & scratch )
+{
+	LinearOctree	octree( scratch );
+
+	TestSphere	sphere;
+	sphere.center = LinearOctree::RESOLUTION / 2;
+	sphere.radius = 150;
+
+	mxDO(octree.Build( &ClassifyCell_Sphere, &sphere, 7 ));
+
+	const U32 num_leaves = octree.NumLeaves();
+	mxENSURE( num_leaves > 0, ERR_UNKNOWN_ERROR, "" );
+
+	// the leaves must be sorted and disjoint
+	for( U32 i = 1; i < num_leaves; i++ )
+	{
+		const LinearOctreeKey prev = octree.GetLeafKey( i - 1 );
+		const LinearOctreeKey curr = octree.GetLeafKey( i );
+		mxENSURE( LinearOctree::GetMortonCode( prev ) + LinearOctree::GetMortonSpan( LinearOctree::GetLevel( prev ) )
+			<= LinearOctree::GetMortonCode( curr ), ERR_UNKNOWN_ERROR, "leaves %u and %u overlap", i - 1, i );
+	}
+
+	// rebuilding from shuffled leaves must give the same octree
+	{
+		DynamicArray< LinearOctreeKey >	shuffled( scratch );
+		mxDO(shuffled.setNum( num_leaves ));
+		for( U32 i = 0; i < num_leaves; i++ ) {
+			shuffled[i] = octree.GetLeafKey( num_leaves - 1 - i );
+		}
+
+		LinearOctree	rebuilt( scratch );
+		mxDO(rebuilt.BuildFromLeaves( shuffled.raw(), num_leaves ));
+		mxENSURE( rebuilt.NumLeaves() == num_leaves
+			&& 0 == memcmp( rebuilt.GetKeys(), octree.GetKeys(), num_leaves * sizeof(LinearOctreeKey) ),
+			ERR_UNKNOWN_ERROR, "" );
+
+		// overlapping leaves must be rejected
+		shuffled.add( LinearOctree::GetParentKey( octree.GetLeafKey( num_leaves / 2 ) ) );
+		mxENSURE( rebuilt.BuildFromLeaves( shuffled.raw(), shuffled.num() ) != ALL_OK, ERR_UNKNOWN_ERROR, "" );
+	}
+
+	NwRandom	rng( 12345 );
+
+	// point location
+	enum { NUM_TEST_POINTS = 1024 };
+	UInt3	points[ NUM_TEST_POINTS ];
+	U32		batch_results[ NUM_TEST_POINTS ];
+
+	for( U32 i = 0; i < NUM_TEST_POINTS; i++ ) {
+		points[i] = GetRandomPoint( rng, LinearOctree::RESOLUTION + 8 );	// some points are outside
+	}
+	octree.FindLeavesContainingPoints( points, NUM_TEST_POINTS, batch_results );
+
+	for( U32 i = 0; i < NUM_TEST_POINTS; i++ )
+	{
+		const U32 expected = FindLeafContainingPoint_BruteForce( octree, points[i] );
+		mxENSURE( octree.FindLeafContainingPoint( points[i] ) == expected, ERR_UNKNOWN_ERROR, "point location failed" );
+		mxENSURE( batch_results[i] == expected, ERR_UNKNOWN_ERROR, "batch point location failed" );
+	}
+
+	// face neighbors
+	for( U32 i = 0; i < num_leaves; i += 37 )
+	{
+		const LinearOctreeKey key = octree.GetLeafKey( i );
+		const UInt3 corner = LinearOctree::GetCorner( key );
+		const U32 size = LinearOctree::GetCellSize( LinearOctree::GetLevel( key ) );
+
+		for( int face = 0; face < CubeFace::Count; face++ )
+		{
+			const U32 axis = face / 2;
+			UInt3 adjacent = corner;
+			adjacent[axis] = ( face & 1 ) ? corner[axis] + size : corner[axis] - 1;	// wraps around at the border
+
+			const U32 expected = FindLeafContainingPoint_BruteForce( octree, adjacent );
+			mxENSURE( octree.FindFaceNeighbor( i, (CubeFace::Enum) face ) == expected, ERR_UNKNOWN_ERROR, "neighbor search failed" );
+		}
+	}
+
+	// range queries
+	DynamicArray< U32 >	found( scratch );
+	DynamicArray< U32 >	expected( scratch );
+
+	for( U32 iBox = 0; iBox < 64; iBox++ )
+	{
+		const UInt3 a = GetRandomPoint( rng, LinearOctree::RESOLUTION );
+		const UInt3 b = GetRandomPoint( rng, LinearOctree::RESOLUTION );
+		const UInt3 box_min( smallest( a.x, b.x ), smallest( a.y, b.y ), smallest( a.z, b.z ) );
+		const UInt3 box_max( largest( a.x, b.x ) + 1, largest( a.y, b.y ) + 1, largest( a.z, b.z ) + 1 );
+
+		found.RemoveAll();
+		mxDO(octree.FindLeavesOverlappingBox( box_min, box_max, found ));
+
+		expected.RemoveAll();
+		for( U32 i = 0; i < num_leaves; i++ )
+		{
+			const LinearOctreeKey key = octree.GetLeafKey( i );
+			const UInt3 corner = LinearOctree::GetCorner( key );
+			const U32 size = LinearOctree::GetCellSize( LinearOctree::GetLevel( key ) );
+			if( corner.x < box_max.x && corner.x + size > box_min.x &&
+				corner.y < box_max.y && corner.y + size > box_min.y &&
+				corner.z < box_max.z && corner.z + size > box_min.z )
+			{
+				mxDO(expected.add( i ));
+			}
+		}
+
+		mxENSURE( found.num() == expected.num()
+			&& 0 == memcmp( found.raw(), expected.raw(), found.num() * sizeof(U32) ),
+			ERR_UNKNOWN_ERROR, "box query failed" );
+	}
+
+	// the leaves inside the cell must be the same as the leaves overlapping the cell's box
+	for( U32 i = 0; i < num_leaves; i += 101 )
+	{
+		const LinearOctreeKey parent_key = LinearOctree::GetParentKey( octree.GetLeafKey( i ) );
+		const UInt3 corner = LinearOctree::GetCorner( parent_key );
+		const U32 size = LinearOctree::GetCellSize( LinearOctree::GetLevel( parent_key ) );
+
+		U32 first, end;
+		octree.GetLeavesInsideCell( parent_key, first, end );
+
+		found.RemoveAll();
+		mxDO(octree.FindLeavesOverlappingBox( corner, UInt3( corner.x + size, corner.y + size, corner.z + size ), found ));
+
+		mxENSURE( found.num() == end - first && found[0] == first, ERR_UNKNOWN_ERROR, "" );
+
+		for( UINT octant = 0; octant < 8; octant++ ) {
+			const LinearOctreeKey child_key = LinearOctree::GetChildKey( parent_key, octant );
+			mxENSURE( LinearOctree::GetParentKey( child_key ) == parent_key, ERR_UNKNOWN_ERROR, "" );
+		}
+	}
+
+	ptPRINT("UnitTest_LinearOctree: %u leaves, %u bytes: OK",
+		num_leaves, (U32)octree.GetMemoryUsage());
+
+	return ALL_OK;
+}
+
+}//namespace VX
+
+#endif // MX_DEVELOPER
+
+//--------------------------------------------------------------//
+//				End Of File.									//
+//--------------------------------------------------------------//
@@ -0,0 +1,212 @@
+// Linear (pointerless) octree stored as a sorted array of Morton keys.
+#pragma once
+
+#include <Base/Math/Geometry/CubeGeometry.h>	// CubeFace
+#include <Utility/Meshok/Morton.h>
+
+
+namespace VX
+{
+
+/// A cell's key: the Morton code of the cell's minimal corner (in the finest cells) and the cell's level.
+/// Sorting the keys gives the depth-first (Z-order) traversal of the octree.
+typedef U32 LinearOctreeKey;
+
+///
+/// Linear octree: only the leaves are stored, as a sorted array of 32-bit keys
+/// (4 bytes per node, no child pointers, no explicit internal nodes).
+/// Internal nodes are implicit: the leaves of any cell occupy a contiguous range of the array.
+/// User data (e.g. dual contouring vertices) is kept in parallel arrays indexed by the leaf index,
+/// so that cells close in space are close in memory.
+///
+mxBIBREF("Irene Gargantini. An effective way to represent quadtrees. Commun. ACM 25, 12 (1982)");
+mxBIBREF("https://geidav.wordpress.com/2014/08/18/advanced-octrees-2-node-representations/");
+class LinearOctree: NonCopyable
+{
+public:
+	enum
+	{
+		/// the number of low bits storing the cell's level
+		LEVEL_BITS = 4,
+		LEVEL_MASK = (1u << LEVEL_BITS) - 1,
+
+		/// 9 levels * 3 bits + 4 bits of level = 31 bits
+		MAX_DEPTH = 9,
+
+		/// the octree's side length, in the finest cells
+		RESOLUTION = (1u << MAX_DEPTH),	// 512
+
+		/// Morton codes of all points inside the octree are less than this value
+		MORTON_CODE_LIMIT = (1u << (3 * MAX_DEPTH)),
+	};
+	mxSTATIC_ASSERT( 3 * MAX_DEPTH + LEVEL_BITS <= 32 );
+	mxSTATIC_ASSERT( MAX_DEPTH <= LEVEL_MASK );
+
+	static const U32 NIL_INDEX = ~0u;
+
+	/// what to do with the cell during building
+	enum ECellAction
+	{
+		Cell_Discard,	//!< the cell is empty and is not stored
+		Cell_Keep,		//!< the cell becomes a leaf
+		Cell_Split,		//!< subdivide the cell (it's kept as a leaf at the maximum depth)
+	};
+
+	/// corner and size are in the finest cells
+	typedef ECellAction F_ClassifyCell(
+		const UInt3& corner
+		, const U32 size
+		, const U32 level
+		, void* user_data
+		);
+
+public:
+	LinearOctree( AllocatorI & allocator );
+
+	/// Builds the octree top-down; the leaves are emitted in Z-order, no sorting is needed.
+	ERet Build(
+		F_ClassifyCell* classify_cell
+		, void* user_data
+		, const U32 max_depth = MAX_DEPTH
+		);
+
+	/// Builds the octree from unordered, non-overlapping leaves.
+	ERet BuildFromLeaves(
+		const LinearOctreeKey* leaf_keys
+		, const U32 num_leaves
+		);
+
+	void Clear();
+
+	mxFORCEINLINE U32 NumLeaves() const { return _keys.num(); }
+	mxFORCEINLINE const LinearOctreeKey* GetKeys() const { return _keys.raw(); }
+	mxFORCEINLINE LinearOctreeKey GetLeafKey( const U32 leaf_index ) const { return _keys[ leaf_index ]; }
+
+	size_t GetMemoryUsage() const { return _keys.allocatedMemorySize(); }
+
+public:	// Queries (all coordinates are in the finest cells).
+
+	/// O(log n). Returns NIL_INDEX if the point is outside the octree or in a discarded cell.
+	U32 FindLeafContainingPoint( const UInt3& point ) const;
+
+	U32 FindLeafContainingMortonCode( const Morton32 point_code ) const;
+
+	/// Locates many points at once; coherent (e.g. Z-ordered) points are much faster,
+	/// because the last found leaf is tested before searching.
+	void FindLeavesContainingPoints(
+		const UInt3* points
+		, const U32 num_points
+		, U32 *leaf_indices_	//!< NIL_INDEX for points outside the octree
+		) const;
+
+	/// Returns the leaf adjacent to the given leaf across the given face, computed with dilated integer arithmetic.
+	/// If the neighbors are smaller than the leaf, returns the one touching the leaf's minimal corner
+	/// (use GetLeavesInsideCell() or FindLeavesOverlappingBox() to get all of them).
+	/// Returns NIL_INDEX at the octree's border or if the neighboring cell was discarded.
+	U32 FindFaceNeighbor(
+		const U32 leaf_index
+		, const CubeFace::Enum face
+		) const;
+
+	/// Returns the range of leaves [first, end) inside the given cell
+	/// (or the single leaf containing the cell).
+	void GetLeavesInsideCell(
+		const LinearOctreeKey cell_key
+		, U32 &first_
+		, U32 &end_
+		) const;
+
+	/// Appends indices of all leaves overlapping the box [box_min, box_max) in Z-order.
+	ERet FindLeavesOverlappingBox(
+		const UInt3& box_min
+		, const UInt3& box_max	//!< exclusive
+		, DynamicArray< U32 > &leaf_indices_
+		) const;
+
+public:	// Key arithmetic.
+
+	/// corner must be aligned to the cell size
+	static mxFORCEINLINE LinearOctreeKey MakeKey( const UInt3& corner, const U32 level )
+	{
+		mxASSERT( level <= MAX_DEPTH );
+		mxASSERT( corner.x % GetCellSize( level ) == 0 );
+		mxASSERT( corner.y % GetCellSize( level ) == 0 );
+		mxASSERT( corner.z % GetCellSize( level ) == 0 );
+		return ( Morton32_Encode( corner.x, corner.y, corner.z ) << LEVEL_BITS ) | level;
+	}
+	static mxFORCEINLINE LinearOctreeKey MakeKeyFromMortonCode( const Morton32 code, const U32 level )
+	{
+		return ( code << LEVEL_BITS ) | level;
+	}
+
+	static mxFORCEINLINE U32 GetLevel( const LinearOctreeKey key ) { return key & LEVEL_MASK; }
+	static mxFORCEINLINE Morton32 GetMortonCode( const LinearOctreeKey key ) { return key >> LEVEL_BITS; }
+	static mxFORCEINLINE UInt3 GetCorner( const LinearOctreeKey key ) { return Morton32_Decode( GetMortonCode( key ) ); }
+
+	/// the cell's side length, in the finest cells
+	static mxFORCEINLINE U32 GetCellSize( const U32 level ) { return RESOLUTION >> level; }
+
+	/// the number of the finest cells inside the cell (i.e. the range of Morton codes covered by the cell)
+	static mxFORCEINLINE U32 GetMortonSpan( const U32 level ) { return 1u << ( 3 * (MAX_DEPTH - level) ); }
+
+	static mxFORCEINLINE LinearOctreeKey GetParentKey( const LinearOctreeKey key )
+	{
+		const U32 level = GetLevel( key );
+		mxASSERT( level > 0 );
+		const Morton32 parent_code = GetMortonCode( key ) & ~( GetMortonSpan( level - 1 ) - 1 );
+		return MakeKeyFromMortonCode( parent_code, level - 1 );
+	}
+	static mxFORCEINLINE LinearOctreeKey GetChildKey( const LinearOctreeKey key, const UINT octant )
+	{
+		const U32 level = GetLevel( key );
+		mxASSERT( level < MAX_DEPTH && octant < NUM_OCTANTS );
+		// octant bits (MASK_POS_X|Y|Z) match the interleaving order of Morton codes
+		return MakeKeyFromMortonCode( GetMortonCode( key ) + octant * GetMortonSpan( level + 1 ), level + 1 );
+	}
+
+	static mxFORCEINLINE bool CellContainsMortonCode( const LinearOctreeKey key, const Morton32 point_code )
+	{
+		return point_code - GetMortonCode( key ) < GetMortonSpan( GetLevel( key ) );	// unsigned wrap-around handles the lower bound
+	}
+
+private:
+	/// returns the index of the first leaf whose Morton code is not less than the given one (binary search)
+	U32 FirstLeafNotBelow( const Morton32 code, const U32 start, const U32 end ) const;
+
+	ERet GatherLeavesOverlappingBox_R(
+		const Morton32 cell_code
+		, const U32 level
+		, const U32 first
+		, const U32 end
+		, const UInt3& box_min
+		, const UInt3& box_max
+		, DynamicArray< U32 > &leaf_indices_
+		) const;
+
+private:
+	enum { NUM_OCTANTS = 8 };
+	DynamicArray< LinearOctreeKey >	_keys;	//!< sorted in increasing order
+};
+
+}//namespace VX
+
+
+/*
+-----------------------------------------------------------------------------
+	UNIT TESTS
+-----------------------------------------------------------------------------
+*/
+
+#if MX_DEVELOPER
+
+namespace VX
+{
+	/// Builds a linear octree around a sphere and checks queries against brute force.
+	ERet UnitTest_LinearOctree( AllocatorI & scratch );
+}//namespace VX
+
+#endif // MX_DEVELOPER
+
+//--------------------------------------------------------------//
+//				End Of File.									//
+//--------------------------------------------------------------//
@@ -0,0 +1,669 @@
+#include "stdafx.h"
+#pragma hdrstop
+
+#include <algorithm>	// std::sort()
+
+#include <Base/Math/Random.h>
+#include <Core/Util/ScopedTimer.h>
+#include <Rendering/Public/Core/MeshClusterCulling.h>
+
+#include <Meshok/MeshletBuilder.h>
+
+
+namespace Meshok
+{
+
+/// back-face culling is disabled if the normals deviate from the cone axis by more than ~84 degrees
+static const F32 MIN_CONE_AXIS_DOT = 0.1f;
+
+/// preferring triangles whose vertices have few remaining triangles avoids leaving holes
+/// and gives rounder, fuller clusters
+static const F32 LIVE_TRIANGLE_WEIGHT = 0.15f;
+
+/// the cutoff value which never passes the back-face test
+static const F32 DISABLED_CONE_CUTOFF = 2.0f;
+
+static mxFORCEINLINE V3f TriangleNormal( const V3f& a, const V3f& b, const V3f& c )
+{
+	return V3_Cross( b - a, c - a );
+}
+
+static ERet AddCluster(
+	const U32* indices
+	, const U32 first_triangle
+	, const U32 triangle_count
+	, const U32 vertex_count
+	, const V3f* positions
+	, const U32 base_index
+	, const U32 submesh_index
+	, DynamicArray< Rendering::MeshCluster > &clusters_
+	)
+{
+	Rendering::MeshCluster	cluster;
+	cluster.start_index = base_index + first_triangle * 3;
+	cluster.index_count = triangle_count * 3;
+	cluster.vertex_count = vertex_count;
+	cluster.submesh_index = submesh_index;
+	ComputeMeshClusterBounds( indices + first_triangle * 3, cluster.index_count, positions, cluster );
+	return clusters_.add( cluster );
+}
+
+ERet BuildMeshClusters(
+	U32 *dst_indices_
+	, const U32* src_indices
+	, const U32 index_count
+	, const V3f* positions
+	, const U32 vertex_count
+	, const MeshClusterSettings& settings
+	, AllocatorI & scratchpad
+	, DynamicArray< Rendering::MeshCluster > &clusters_
+	, const U32 base_index
+	, const U32 submesh_index
+	)
+{
+	mxASSERT( index_count % 3 == 0 );
+	mxASSERT( dst_indices_ != src_indices );
+	mxENSURE( settings.max_vertices >= 3 && settings.max_vertices <= MAX_UINT16, ERR_INVALID_PARAMETER, "" );
+	mxENSURE( settings.max_triangles >= 1, ERR_INVALID_PARAMETER, "" );
+
+	const U32 triangle_count = index_count / 3;
+	if( !triangle_count ) {
+		return ALL_OK;
+	}
+
+	// vertex -> not yet emitted triangles; emitted triangles are swapped to the end of each list
+	DynamicArray< U32 >	live_triangle_counts( scratchpad );
+	DynamicArray< U32 >	adjacency_offsets( scratchpad );
+	DynamicArray< U32 >	adjacency( scratchpad );
+	mxDO(live_triangle_counts.setNum( vertex_count ));
+	mxDO(adjacency_offsets.setNum( vertex_count ));
+	mxDO(adjacency.setNum( index_count ));
+
+	live_triangle_counts.setAll( 0 );
+	for( U32 i = 0; i < index_count; i++ ) {
+		mxASSERT( src_indices[i] < vertex_count );
+		live_triangle_counts[ src_indices[i] ]++;
+	}
+	{
+		U32 offset = 0;
+		for( U32 v = 0; v < vertex_count; v++ ) {
+			adjacency_offsets[v] = offset;
+			offset += live_triangle_counts[v];
+		}
+		live_triangle_counts.setAll( 0 );
+		for( U32 i = 0; i < index_count; i++ ) {
+			const U32 v = src_indices[i];
+			adjacency[ adjacency_offsets[v] + live_triangle_counts[v]++ ] = i / 3;
+		}
+	}
+
+	// unit normals (zero for degenerate triangles)
+	DynamicArray< V3f >	triangle_normals( scratchpad );
+	mxDO(triangle_normals.setNum( triangle_count ));
+	for( U32 t = 0; t < triangle_count; t++ )
+	{
+		const U32* tri = src_indices + t * 3;
+		const V3f normal = TriangleNormal( positions[ tri[0] ], positions[ tri[1] ], positions[ tri[2] ] );
+		const F32 length = V3_Length( normal );
+		triangle_normals[t] = ( length > 0 ) ? normal / length : CV3f(0);
+	}
+
+	DynamicArray< U8 >	triangle_emitted( scratchpad );
+	mxDO(triangle_emitted.setNum( triangle_count ));
+	triangle_emitted.setAll( 0 );
+
+	// the cluster which last referenced the vertex (1-based)
+	DynamicArray< U32 >	vertex_cluster_stamps( scratchpad );
+	mxDO(vertex_cluster_stamps.setNum( vertex_count ));
+	vertex_cluster_stamps.setAll( 0 );
+
+	// the vertices of the current (or the last finished) cluster
+	DynamicArray< U32 >	cluster_vertices( scratchpad );
+	mxDO(cluster_vertices.reserve( settings.max_vertices ));
+
+	U32	cluster_stamp = 1;
+	U32	cluster_first_triangle = 0;
+	U32	cluster_triangle_count = 0;
+	V3f	cluster_normal_sum = CV3f(0);
+
+	U32	output_triangle = 0;
+	U32	input_cursor = 0;	// for starting new clusters if there are no adjacent triangles
+
+	while( output_triangle < triangle_count )
+	{
+		U32	best_triangle = ~0u;
+
+		if( cluster_triangle_count )
+		{
+			// find the adjacent triangle which adds the fewest new vertices and deviates least from the cluster's normal
+			const V3f cluster_normal = V3_Normalized( cluster_normal_sum );
+
+			F32	best_score = BIG_NUMBER;
+
+			for( U32 i = 0; i < cluster_vertices.num(); i++ )
+			{
+				const U32 v = cluster_vertices[i];
+				const U32* vertex_triangles = adjacency.raw() + adjacency_offsets[v];
+				const U32 num_live_triangles = live_triangle_counts[v];
+
+				for( U32 j = 0; j < num_live_triangles; j++ )
+				{
+					const U32 t = vertex_triangles[j];
+					const U32* tri = src_indices + t * 3;
+
+					const U32 num_new_vertices
+						= ( vertex_cluster_stamps[ tri[0] ] != cluster_stamp )
+						+ ( vertex_cluster_stamps[ tri[1] ] != cluster_stamp )
+						+ ( vertex_cluster_stamps[ tri[2] ] != cluster_stamp )
+						;
+					if( cluster_vertices.num() + num_new_vertices > settings.max_vertices ) {
+						continue;
+					}
+
+					const U32 num_live_neighbors
+						= live_triangle_counts[ tri[0] ]
+						+ live_triangle_counts[ tri[1] ]
+						+ live_triangle_counts[ tri[2] ]
+						;
+
+					const F32 score = F32( num_new_vertices )
+						+ settings.cone_weight * ( 1.0f - V3_Dot( triangle_normals[t], cluster_normal ) )
+						+ LIVE_TRIANGLE_WEIGHT * F32( num_live_neighbors )
+						;
+					if( score < best_score ) {
+						best_score = score;
+						best_triangle = t;
+					}
+				}
+			}
+
+			if( best_triangle == ~0u )
+			{
+				// the cluster cannot grow anymore
+				mxDO(AddCluster(
+					dst_indices_, cluster_first_triangle, cluster_triangle_count, cluster_vertices.num()
+					, positions, base_index, submesh_index, clusters_
+					));
+
+				cluster_stamp++;
+				cluster_first_triangle = output_triangle;
+				cluster_triangle_count = 0;
+				cluster_normal_sum = CV3f(0);
+			}
+		}
+
+		if( best_triangle == ~0u )
+		{
+			// start a new cluster next to the previous one to keep the clusters spatially coherent
+			for( U32 i = 0; i < cluster_vertices.num() && best_triangle == ~0u; i++ )
+			{
+				const U32 v = cluster_vertices[i];
+				if( live_triangle_counts[v] ) {
+					best_triangle = adjacency[ adjacency_offsets[v] ];
+				}
+			}
+
+			if( best_triangle == ~0u )
+			{
+				while( triangle_emitted[ input_cursor ] ) {
+					input_cursor++;
+				}
+				best_triangle = input_cursor;
+			}
+
+			cluster_vertices.RemoveAll();
+		}
+
+		// add the triangle to the cluster
+		const U32* tri = src_indices + best_triangle * 3;
+		for( UINT k = 0; k < 3; k++ )
+		{
+			const U32 v = tri[k];
+			dst_indices_[ output_triangle * 3 + k ] = v;
+
+			if( vertex_cluster_stamps[v] != cluster_stamp ) {
+				vertex_cluster_stamps[v] = cluster_stamp;
+				mxDO(cluster_vertices.add( v ));
+			}
+
+			// remove the triangle from the vertex's list of live triangles
+			U32* vertex_triangles = adjacency.raw() + adjacency_offsets[v];
+			const U32 num_live_triangles = live_triangle_counts[v];
+			for( U32 j = 0; j < num_live_triangles; j++ )
+			{
+				if( vertex_triangles[j] == best_triangle ) {
+					TSwap( vertex_triangles[j], vertex_triangles[ num_live_triangles - 1 ] );
+					live_triangle_counts[v]--;
+					break;
+				}
+			}
+		}
+
+		triangle_emitted[ best_triangle ] = 1;
+		cluster_normal_sum += triangle_normals[ best_triangle ];
+		cluster_triangle_count++;
+		output_triangle++;
+
+		if( cluster_triangle_count == settings.max_triangles || output_triangle == triangle_count )
+		{
+			mxDO(AddCluster(
+				dst_indices_, cluster_first_triangle, cluster_triangle_count, cluster_vertices.num()
+				, positions, base_index, submesh_index, clusters_
+				));
+
+			cluster_stamp++;
+			cluster_first_triangle = output_triangle;
+			cluster_triangle_count = 0;
+			cluster_normal_sum = CV3f(0);
+		}
+	}
+
+	return ALL_OK;
+}
+
+void ComputeMeshClusterBounds(
+	const U32* indices
+	, const U32 index_count
+	, const V3f* positions
+	, Rendering::MeshCluster &cluster_
+	)
+{
+	mxASSERT( index_count % 3 == 0 );
+
+	cluster_.center = CV3f(0);
+	cluster_.radius = 0;
+	cluster_.cone_apex = CV3f(0);
+	cluster_.cone_axis = CV3f(0);
+	cluster_.cone_cutoff = DISABLED_CONE_CUTOFF;
+
+	if( !index_count ) {
+		return;
+	}
+
+	// Ritter's bounding sphere: start with the two most distant points along some direction and grow
+
+	const V3f& first = positions[ indices[0] ];
+
+	V3f		a = first;
+	F32		max_distance_sq = 0;
+	for( U32 i = 0; i < index_count; i++ ) {
+		const V3f& p = positions[ indices[i] ];
+		const F32 distance_sq = V3_LengthSquared( p - first );
+		if( distance_sq > max_distance_sq ) {
+			max_distance_sq = distance_sq;
+			a = p;
+		}
+	}
+
+	V3f		b = a;
+	max_distance_sq = 0;
+	for( U32 i = 0; i < index_count; i++ ) {
+		const V3f& p = positions[ indices[i] ];
+		const F32 distance_sq = V3_LengthSquared( p - a );
+		if( distance_sq > max_distance_sq ) {
+			max_distance_sq = distance_sq;
+			b = p;
+		}
+	}
+
+	V3f		center = ( a + b ) * 0.5f;
+	F32		radius = mmSqrt( max_distance_sq ) * 0.5f;
+
+	for( U32 i = 0; i < index_count; i++ )
+	{
+		const V3f& p = positions[ indices[i] ];
+		const F32 distance = V3_Length( p - center );
+		if( distance > radius )
+		{
+			const F32 new_radius = ( radius + distance ) * 0.5f;
+			center += ( p - center ) * ( ( new_radius - radius ) / distance );
+			radius = new_radius;
+		}
+	}
+
+	cluster_.center = center;
+	cluster_.radius = radius;
+
+	// normal cone
+
+	const U32 triangle_count = index_count / 3;
+
+	V3f		normal_sum = CV3f(0);
+	for( U32 t = 0; t < triangle_count; t++ )
+	{
+		const U32* tri = indices + t * 3;
+		const V3f normal = TriangleNormal( positions[ tri[0] ], positions[ tri[1] ], positions[ tri[2] ] );
+		const F32 length = V3_Length( normal );
+		if( length > 0 ) {
+			normal_sum += normal / length;
+		}
+	}
+
+	F32 axis_length;
+	const V3f axis = V3_Normalized( normal_sum, axis_length );
+	if( axis_length <= 0 ) {
+		return;	// all triangles are degenerate or the normals cancel out
+	}
+
+	F32		min_dot = 1.0f;
+	for( U32 t = 0; t < triangle_count; t++ )
+	{
+		const U32* tri = indices + t * 3;
+		const V3f normal = TriangleNormal( positions[ tri[0] ], positions[ tri[1] ], positions[ tri[2] ] );
+		const F32 length = V3_Length( normal );
+		if( length > 0 ) {
+			min_dot = smallest( min_dot, V3_Dot( normal, axis ) / length );
+		}
+	}
+
+	cluster_.cone_axis = axis;
+	cluster_.cone_apex = center;
+
+	if( min_dot <= MIN_CONE_AXIS_DOT ) {
+		return;	// the normals are too divergent for back-face culling
+	}
+
+	// the apex lies on the axis behind all the triangles' planes
+	F32		max_t = 0;
+	for( U32 t = 0; t < triangle_count; t++ )
+	{
+		const U32* tri = indices + t * 3;
+		const V3f& p0 = positions[ tri[0] ];
+		const V3f normal = TriangleNormal( p0, positions[ tri[1] ], positions[ tri[2] ] );
+		const F32 dn = V3_Dot( axis, normal );
+		if( dn > 0 ) {
+			// intersect the ray (center - axis * t) with the triangle's plane
+			const F32 dc = V3_Dot( center - p0, normal );
+			max_t = largest( max_t, dc / dn );
+		}
+	}
+
+	cluster_.cone_apex = center - axis * max_t;
+	// the cluster is back-facing if the view direction is within (90 - half_angle) degrees of the axis
+	cluster_.cone_cutoff = mmSqrt( 1.0f - min_dot * min_dot );
+}
+
+}//namespace Meshok
+
+
+/*
+-----------------------------------------------------------------------------
+	UNIT TESTS
+-----------------------------------------------------------------------------
+*/
+
+#if MX_DEVELOPER
+
+namespace Meshok
+{
+
+namespace
+{
+	/// appends a UV-sphere to the mesh
+	ERet AppendSphere(
+		const V3f& center
+		, const F32 radius
+		, const U32 rings
+		, const U32 segments
+		, DynamicArray< V3f > &positions_
+		, DynamicArray< U32 > &indices_
+		)
+	{
+		const U32 base_vertex = positions_.num();
+
+		for( U32 r = 0; r <= rings; r++ )
+		{
+			const F32 theta = mxPI * F32(r) / F32(rings);
+			for( U32 s = 0; s < segments; s++ )
+			{
+				const F32 phi = mxTWO_PI * F32(s) / F32(segments);
+				const V3f direction = CV3f(
+					mmSin( theta ) * mmCos( phi ),
+					mmSin( theta ) * mmSin( phi ),
+					mmCos( theta )
+					);
+				mxDO(positions_.add( center + direction * radius ));
+			}
+		}
+
+		for( U32 r = 0; r < rings; r++ )
+		{
+			for( U32 s = 0; s < segments; s++ )
+			{
+				const U32 v00 = base_vertex + r * segments + s;
+				const U32 v10 = base_vertex + r * segments + (s + 1) % segments;
+				const U32 v01 = v00 + segments;
+				const U32 v11 = v10 + segments;
+				// outward-facing: cross(b - a, c - a) points away from the center
+				mxDO(indices_.add( v00 )); mxDO(indices_.add( v01 )); mxDO(indices_.add( v11 ));
+				mxDO(indices_.add( v00 )); mxDO(indices_.add( v11 )); mxDO(indices_.add( v10 ));
+			}
+		}
+		return ALL_OK;
+	}
+
+	/// random point in [-extent, extent]^3
+	V3f RandomPoint( NwRandom & rng, const F32 extent )
+	{
+		const F32 scale = 2.0f * extent / F32( NwRandom::MAX_RAND );
+		return CV3f(
+			F32( rng.RandomInt() ) * scale - extent,
+			F32( rng.RandomInt() ) * scale - extent,
+			F32( rng.RandomInt() ) * scale - extent
+			);
+	}
+
+	ERet CheckClusters(
+		const DynamicArray< V3f >& positions
+		, const DynamicArray< U32 >& src_indices
+		, const DynamicArray< U32 >& dst_indices
+		, const DynamicArray< Rendering::MeshCluster >& clusters
+		, const MeshClusterSettings& settings
+		, AllocatorI & scratchpad
+		)
+	{
+		// the clusters must cover all triangles without gaps
+		U32 next_index = 0;
+		for( U32 i = 0; i < clusters.num(); i++ )
+		{
+			const Rendering::MeshCluster& cluster = clusters[i];
+			mxENSURE( cluster.start_index == next_index, ERR_UNKNOWN_ERROR, "" );
+			mxENSURE( cluster.index_count > 0 && cluster.index_count <= settings.max_triangles * 3, ERR_UNKNOWN_ERROR, "" );
+			mxENSURE( cluster.vertex_count <= settings.max_vertices, ERR_UNKNOWN_ERROR, "" );
+			next_index += cluster.index_count;
+		}
+		mxENSURE( next_index == src_indices.num(), ERR_UNKNOWN_ERROR, "" );
+
+		// each triangle must be emitted exactly once (triangles of the sample meshes are unique)
+		DynamicArray< U64 >	src_keys( scratchpad );
+		DynamicArray< U64 >	dst_keys( scratchpad );
+		mxDO(src_keys.setNum( src_indices.num() / 3 ));
+		mxDO(dst_keys.setNum( src_indices.num() / 3 ));
+		for( U32 t = 0; t < src_keys.num(); t++ )
+		{
+			const U32* s = src_indices.raw() + t * 3;
+			const U32* d = dst_indices.raw() + t * 3;
+			src_keys[t] = ( U64( s[0] ) << 42 ) | ( U64( s[1] ) << 21 ) | U64( s[2] );
+			dst_keys[t] = ( U64( d[0] ) << 42 ) | ( U64( d[1] ) << 21 ) | U64( d[2] );
+		}
+		std::sort( src_keys.raw(), src_keys.raw() + src_keys.num() );
+		std::sort( dst_keys.raw(), dst_keys.raw() + dst_keys.num() );
+		mxENSURE( 0 == memcmp( src_keys.raw(), dst_keys.raw(), src_keys.rawSize() ), ERR_UNKNOWN_ERROR, "" );
+
+		// the bounds must be conservative
+		NwRandom	rng( 777 );
+
+		for( U32 i = 0; i < clusters.num(); i++ )
+		{
+			const Rendering::MeshCluster& cluster = clusters[i];
+			const U32* indices = dst_indices.raw() + cluster.start_index;
+
+			U32	unique_vertices = 0;
+			for( U32 j = 0; j < cluster.index_count; j++ )
+			{
+				const V3f& p = positions[ indices[j] ];
+				mxENSURE( V3_Length( p - cluster.center ) <= cluster.radius * 1.001f + 1e-5f, ERR_UNKNOWN_ERROR, "" );
+
+				bool seen = false;
+				for( U32 k = 0; k < j; k++ ) {
+					seen |= ( indices[k] == indices[j] );
+				}
+				unique_vertices += !seen;
+			}
+			mxENSURE( unique_vertices == cluster.vertex_count, ERR_UNKNOWN_ERROR, "" );
+
+			for( UINT iEye = 0; iEye < 16; iEye++ )
+			{
+				const V3f eye = RandomPoint( rng, 4.0f );
+				if( !Rendering::IsMeshClusterBackFacing( cluster, eye ) ) {
+					continue;
+				}
+				// all triangles must be back-facing
+				for( U32 j = 0; j < cluster.index_count; j += 3 )
+				{
+					const V3f& a = positions[ indices[j+0] ];
+					const V3f normal = TriangleNormal( a, positions[ indices[j+1] ], positions[ indices[j+2] ] );
+					mxENSURE( V3_Dot( normal, eye - a ) <= 1e-5f, ERR_UNKNOWN_ERROR, "cluster %u is not back-facing", i );
+				}
+			}
+		}
+
+		return ALL_OK;
+	}
+
+}//namespace
+
+ERet UnitTest_MeshClusters( AllocatorI & scratchpad )
+{
+	DynamicArray< V3f >	positions( scratchpad );
+	DynamicArray< U32 >	indices( scratchpad );
+
+	mxDO(AppendSphere( CV3f(0), 1.0f, 32, 64, positions, indices ));
+	mxDO(AppendSphere( CV3f(1.5f, 0, 0), 0.5f, 8, 16, positions, indices ));
+
+	const U32 index_count = indices.num();
+
+	DynamicArray< U32 >	clustered_indices( scratchpad );
+	mxDO(clustered_indices.setNum( index_count ));
+
+	MeshClusterSettings	settings;
+	for( UINT iTest = 0; iTest < 2; iTest++ )
+	{
+		DynamicArray< Rendering::MeshCluster >	clusters( scratchpad );
+		mxDO(BuildMeshClusters(
+			clustered_indices.raw(), indices.raw(), index_count
+			, positions.raw(), positions.num()
+			, settings, scratchpad, clusters
+			));
+		mxDO(CheckClusters( positions, indices, clustered_indices, clusters, settings, scratchpad ));
+
+		U32 num_cullable = 0;
+		for( U32 i = 0; i < clusters.num(); i++ ) {
+			num_cullable += ( clusters[i].cone_cutoff <= 1.0f );
+		}
+		ptPRINT("%u tris, max %u verts / %u tris: %u clusters (%.1f tris on avg), %u with normal cones",
+			index_count / 3, settings.max_vertices, settings.max_triangles,
+			clusters.num(), F32( index_count / 3 ) / clusters.num(), num_cullable
+			);
+
+		// small clusters
+		settings.max_vertices = 16;
+		settings.max_triangles = 20;
+	}
+
+	return ALL_OK;
+}
+
+ERet Benchmark_MeshClusterCulling(
+	AllocatorI & scratchpad
+	, const U32 num_triangles
+	)
+{
+	// a dense grid of spheres, 2 * 64 * 128 = 16K triangles each
+	const U32 rings = 64;
+	const U32 segments = 128;
+	const U32 triangles_per_sphere = rings * segments * 2;
+	const U32 spheres_per_side = largest( 1u, U32( powf( F32( num_triangles / triangles_per_sphere ), 1.0f / 3.0f ) + 0.5f ) );
+	const F32 scene_extent = F32( spheres_per_side ) * 3.0f;
+
+	DynamicArray< V3f >	positions( scratchpad );
+	DynamicArray< U32 >	indices( scratchpad );
+
+	for( U32 z = 0; z < spheres_per_side; z++ ) {
+		for( U32 y = 0; y < spheres_per_side; y++ ) {
+			for( U32 x = 0; x < spheres_per_side; x++ ) {
+				const V3f center = CV3f( F32(x), F32(y), F32(z) ) * 3.0f - CV3f( scene_extent * 0.5f );
+				mxDO(AppendSphere( center, 1.0f, rings, segments, positions, indices ));
+			}
+		}
+	}
+
+	const U32 index_count = indices.num();
+
+	DynamicArray< U32 >	clustered_indices( scratchpad );
+	mxDO(clustered_indices.setNum( index_count ));
+
+	DynamicArray< Rendering::MeshCluster >	clusters( scratchpad );
+
+	ScopedTimer	timer;
+	mxDO(BuildMeshClusters(
+		clustered_indices.raw(), indices.raw(), index_count
+		, positions.raw(), positions.num()
+		, MeshClusterSettings(), scratchpad, clusters
+		));
+	const U32 build_msec = timer.ElapsedMilliseconds();
+
+	DynamicArray< U32 >	visible_clusters( scratchpad );
+	mxDO(visible_clusters.setNum( clusters.num() ));
+
+	// cameras inside the scene looking in random directions
+	enum { NUM_VIEWS = 256 };
+	NwRandom	rng( 12345 );
+
+	Rendering::MeshClusterCullingStats	stats;
+	mxZERO_OUT(stats);
+
+	U64	num_visible_triangles = 0;
+
+	timer.Reset();
+	for( UINT iView = 0; iView < NUM_VIEWS; iView++ )
+	{
+		const V3f eye = RandomPoint( rng, scene_extent * 0.5f );
+		const V3f forward = V3_Normalized( RandomPoint( rng, 1.0f ) + CV3f( 1e-3f, 0, 0 ) );
+		const V3f right = V3_Normalized( V3_Cross( forward, fabsf( forward.z ) < 0.99f ? CV3f(0,0,1) : CV3f(1,0,0) ) );
+		const V3f up = V3_Cross( right, forward );
+
+		ViewFrustum	frustum;
+		frustum.extractFrustumPlanes_Generic( eye, right, forward, up, mxPI / 4, 16.0f / 9.0f, 0.1f, scene_extent * 2.0f );
+
+		const U32 num_visible = Rendering::CullMeshClusters(
+			clusters.raw(), clusters.num(), frustum, eye, visible_clusters.raw(), &stats
+			);
+
+		for( U32 i = 0; i < num_visible; i++ ) {
+			num_visible_triangles += clusters[ visible_clusters[i] ].index_count / 3;
+		}
+	}
+	const U32 cull_msec = timer.ElapsedMilliseconds();
+
+	ptPRINT("Mesh clusters: %u tris, %u clusters, built in %u msec",
+		index_count / 3, clusters.num(), build_msec
+		);
+	ptPRINT("Culling: %u views in %u msec (%.3f msec per view, %.1f M clusters/sec), outside frustum: %.1f%%, back-facing: %.1f%%, visible tris: %.1f%%",
+		NUM_VIEWS, cull_msec, F32( cull_msec ) / NUM_VIEWS,
+		F32( stats.num_tested ) / largest( F32( cull_msec ), 1.0f ) * 1e-3f,
+		100.0f * stats.num_outside_frustum / stats.num_tested,
+		100.0f * stats.num_backfacing / stats.num_tested,
+		100.0f * F32( num_visible_triangles ) / ( F32( index_count / 3 ) * NUM_VIEWS )
+		);
+
+	return ALL_OK;
+}
+
+}//namespace Meshok
+
+#endif // MX_DEVELOPER
+
+//--------------------------------------------------------------//
+//				End Of File.									//
+//--------------------------------------------------------------//
@@ -0,0 +1,82 @@
+// Splits triangle meshes into small clusters (meshlets) with culling data.
+#pragma once
+
+#include <Rendering/Public/Core/Mesh.h>	// Rendering::MeshCluster
+
+
+namespace Meshok
+{
+	struct MeshClusterSettings
+	{
+		/// limits suitable for mesh shaders
+		U32		max_vertices;	// <= 64K
+		U32		max_triangles;
+
+		/// how much to prefer triangles facing the same direction over sharing more vertices
+		/// (higher values give tighter normal cones, but more clusters)
+		F32		cone_weight;
+
+	public:
+		MeshClusterSettings()
+		{
+			max_vertices = 64;
+			max_triangles = 124;
+			cone_weight = 0.5f;
+		}
+	};
+
+	mxBIBREF("Arseny Kapoulkine. meshoptimizer, clusterizer.cpp");
+	/// Greedily grows clusters from adjacent triangles, preferring those which add the fewest new vertices.
+	/// Reorders the triangles so that each cluster occupies a contiguous range of indices
+	/// (the vertex buffer is not changed). The input should be optimized for the vertex cache first,
+	/// because new clusters are started in the input order.
+	ERet BuildMeshClusters(
+		U32 *dst_indices_
+		, const U32* src_indices
+		, const U32 index_count
+		, const V3f* positions
+		, const U32 vertex_count
+		, const MeshClusterSettings& settings
+		, AllocatorI & scratchpad
+		, DynamicArray< Rendering::MeshCluster > &clusters_	//!< new clusters are appended
+		, const U32 base_index = 0	//!< added to the start indices of new clusters
+		, const U32 submesh_index = 0
+		);
+
+	/// Computes the bounding sphere and the normal cone of the given triangles.
+	void ComputeMeshClusterBounds(
+		const U32* indices
+		, const U32 index_count
+		, const V3f* positions
+		, Rendering::MeshCluster &cluster_
+		);
+
+}//namespace Meshok
+
+
+/*
+-----------------------------------------------------------------------------
+	UNIT TESTS
+-----------------------------------------------------------------------------
+*/
+
+#if MX_DEVELOPER
+
+namespace Meshok
+{
+	/// Checks the cluster limits, that no triangles are lost
+	/// and that the bounds are conservative (by testing random eye positions).
+	ERet UnitTest_MeshClusters( AllocatorI & scratchpad );
+
+	/// Builds clusters for a dense grid of tessellated spheres and culls them from many viewpoints.
+	ERet Benchmark_MeshClusterCulling(
+		AllocatorI & scratchpad
+		, const U32 num_triangles = 4000000
+		);
+}//namespace Meshok
+
+#endif // MX_DEVELOPER
+
+//--------------------------------------------------------------//
+//				End Of File.									//
+//--------------------------------------------------------------//
@@ -0,0 +1,414 @@
+// Batched (SoA) QEF solving: several cells per SIMD register.
+#include "stdafx.h"
+#pragma hdrstop
+
+#include <Core/Util/ScopedTimer.h>
+
+#include <Meshok/Meshok.h>
+#include <Meshok/Quadrics.h>
+
+#include <Meshok/BatchSIMD.h>
+
+namespace
+{
+	using Meshok::SIMD::VecF;
+	using Meshok::SIMD::LANES;
+
+	/// must be the same as in svd2, so that the batched solver returns the same results
+	enum { NUM_JACOBI_SWEEPS = 5 };
+	const F32 PSEUDO_INVERSE_THRESHOLD = 0.1f;
+
+	/// Computes the Jacobi rotation which zeroes a_pq.
+	/// The same as svd2::givens_coeffs_sym(), but without branches.
+	mxFORCEINLINE void VF_GivensCoeffsSym(
+		const VecF& a_pp, const VecF& a_pq, const VecF& a_qq
+		, VecF &c_, VecF &s_
+		)
+	{
+		const VecF zero = VF_SET( 0.0f );
+		const VecF one = VF_SET( 1.0f );
+
+		const VecF a_pq_is_zero = VF_CMPEQ( a_pq, zero );
+		const VecF safe_a_pq = VF_SELECT( a_pq_is_zero, one, a_pq );
+
+		const VecF tau = VF_DIV( VF_SUB( a_qq, a_pp ), VF_ADD( safe_a_pq, safe_a_pq ) );
+		const VecF stt = VF_SQRT( VF_MADD( tau, tau, one ) );
+		const VecF tan = VF_DIV( one, VF_SELECT( VF_CMPGE( tau, zero ), VF_ADD( tau, stt ), VF_SUB( tau, stt ) ) );
+		const VecF c = VF_DIV( one, VF_SQRT( VF_MADD( tan, tan, one ) ) );
+		const VecF s = VF_MUL( tan, c );
+
+		c_ = VF_SELECT( a_pq_is_zero, one, c );
+		s_ = VF_SELECT( a_pq_is_zero, zero, s );
+	}
+
+	mxFORCEINLINE void VF_Rotate( VecF &x_, VecF &y_, const VecF& c, const VecF& s )
+	{
+		const VecF u = x_;
+		const VecF v = y_;
+		x_ = VF_SUB( VF_MUL( c, u ), VF_MUL( s, v ) );
+		y_ = VF_MADD( s, u, VF_MUL( c, v ) );
+	}
+
+	/// one Jacobi rotation in the (a,b) plane, see svd2::svd_rotate()
+	template< int a, int b >
+	mxFORCEINLINE void VF_JacobiRotate( VecF vtav[3][3], VecF v[3][3] )
+	{
+		VecF c, s;
+		VF_GivensCoeffsSym( vtav[a][a], vtav[a][b], vtav[b][b], c, s );
+
+		// rotate the diagonal
+		const VecF cc = VF_MUL( c, c );
+		const VecF ss = VF_MUL( s, s );
+		const VecF mx = VF_MUL( VF_MUL( VF_SET( 2.0f ), VF_MUL( c, s ) ), vtav[a][b] );
+		const VecF u = vtav[a][a];
+		const VecF w = vtav[b][b];
+		vtav[a][a] = VF_ADD( VF_SUB( VF_MUL( cc, u ), mx ), VF_MUL( ss, w ) );
+		vtav[b][b] = VF_ADD( VF_ADD( VF_MUL( ss, u ), mx ), VF_MUL( cc, w ) );
+
+		// rotate the remaining off-diagonal elements of the upper triangle
+		VF_Rotate( vtav[0][3-b], vtav[1-a][2], c, s );
+
+		vtav[a][b] = VF_SET( 0.0f );
+
+		// accumulate the rotation into the columns of V
+		VF_Rotate( v[0][a], v[0][b], c, s );
+		VF_Rotate( v[1][a], v[1][b], c, s );
+		VF_Rotate( v[2][a], v[2][b], c, s );
+	}
+
+	/// see svd2::svd_invdet()
+	mxFORCEINLINE VecF VF_InvDet( const VecF& x )
+	{
+		const VecF tolerance = VF_SET( PSEUDO_INVERSE_THRESHOLD );
+		const VecF rcp = VF_DIV( VF_SET( 1.0f ), x );
+		const VecF is_singular = VF_OR( VF_CMPLT( VF_ABS( x ), tolerance ), VF_CMPLT( VF_ABS( rcp ), tolerance ) );
+		return VF_ANDNOT( is_singular, rcp );
+	}
+
+	mxFORCEINLINE VecF VF_IsNonZero( const VecF& x )
+	{
+		return VF_ANDNOT( VF_CMPEQ( x, VF_SET( 0.0f ) ), VF_SET( 1.0f ) );
+	}
+
+	/// Solves LANES cells starting at the given index.
+	mxFORCEINLINE void SolveQEFs( F32 * const * streams, const U32 first_cell )
+	{
+		const VecF zero = VF_SET( 0.0f );
+		const VecF one = VF_SET( 1.0f );
+
+		const VecF ata00 = VF_LOAD( streams[ QEF_Batch::ATA_00 ] + first_cell );
+		const VecF ata01 = VF_LOAD( streams[ QEF_Batch::ATA_01 ] + first_cell );
+		const VecF ata02 = VF_LOAD( streams[ QEF_Batch::ATA_02 ] + first_cell );
+		const VecF ata11 = VF_LOAD( streams[ QEF_Batch::ATA_11 ] + first_cell );
+		const VecF ata12 = VF_LOAD( streams[ QEF_Batch::ATA_12 ] + first_cell );
+		const VecF ata22 = VF_LOAD( streams[ QEF_Batch::ATA_22 ] + first_cell );
+
+		const VecF atb_x = VF_LOAD( streams[ QEF_Batch::ATB_X ] + first_cell );
+		const VecF atb_y = VF_LOAD( streams[ QEF_Batch::ATB_Y ] + first_cell );
+		const VecF atb_z = VF_LOAD( streams[ QEF_Batch::ATB_Z ] + first_cell );
+
+		// empty cells (and the padding) get the origin instead of NaNs
+		const VecF inv_num_points = VF_DIV( one, VF_MAX( VF_LOAD( streams[ QEF_Batch::NUM_POINTS ] + first_cell ), one ) );
+		const VecF mass_x = VF_MUL( VF_LOAD( streams[ QEF_Batch::POINT_SUM_X ] + first_cell ), inv_num_points );
+		const VecF mass_y = VF_MUL( VF_LOAD( streams[ QEF_Batch::POINT_SUM_Y ] + first_cell ), inv_num_points );
+		const VecF mass_z = VF_MUL( VF_LOAD( streams[ QEF_Batch::POINT_SUM_Z ] + first_cell ), inv_num_points );
+
+		// solve relative to the mass point: b = Atb - AtA * masspoint
+		const VecF b_x = VF_SUB( atb_x, VF_MADD( ata00, mass_x, VF_MADD( ata01, mass_y, VF_MUL( ata02, mass_z ) ) ) );
+		const VecF b_y = VF_SUB( atb_y, VF_MADD( ata01, mass_x, VF_MADD( ata11, mass_y, VF_MUL( ata12, mass_z ) ) ) );
+		const VecF b_z = VF_SUB( atb_z, VF_MADD( ata02, mass_x, VF_MADD( ata12, mass_y, VF_MUL( ata22, mass_z ) ) ) );
+
+		// symmetric eigen-decomposition AtA = V * diag(sigma) * V^T,
+		// only the upper triangle of vtav is used
+		VecF vtav[3][3] = {
+			{ ata00, ata01, ata02 },
+			{ zero,  ata11, ata12 },
+			{ zero,  zero,  ata22 },
+		};
+		VecF v[3][3] = {
+			{ one,  zero, zero },
+			{ zero, one,  zero },
+			{ zero, zero, one  },
+		};
+
+		for( int i = 0; i < NUM_JACOBI_SWEEPS; i++ )
+		{
+			VF_JacobiRotate< 0, 1 >( vtav, v );
+			VF_JacobiRotate< 0, 2 >( vtav, v );
+			VF_JacobiRotate< 1, 2 >( vtav, v );
+		}
+
+		const VecF d0 = VF_InvDet( vtav[0][0] );
+		const VecF d1 = VF_InvDet( vtav[1][1] );
+		const VecF d2 = VF_InvDet( vtav[2][2] );
+
+		// x = pinv(AtA) * b = V * diag(d) * V^T * b
+		const VecF t0 = VF_MUL( d0, VF_MADD( v[0][0], b_x, VF_MADD( v[1][0], b_y, VF_MUL( v[2][0], b_z ) ) ) );
+		const VecF t1 = VF_MUL( d1, VF_MADD( v[0][1], b_x, VF_MADD( v[1][1], b_y, VF_MUL( v[2][1], b_z ) ) ) );
+		const VecF t2 = VF_MUL( d2, VF_MADD( v[0][2], b_x, VF_MADD( v[1][2], b_y, VF_MUL( v[2][2], b_z ) ) ) );
+
+		const VecF x = VF_MADD( v[0][0], t0, VF_MADD( v[0][1], t1, VF_MUL( v[0][2], t2 ) ) );
+		const VecF y = VF_MADD( v[1][0], t0, VF_MADD( v[1][1], t1, VF_MUL( v[1][2], t2 ) ) );
+		const VecF z = VF_MADD( v[2][0], t0, VF_MADD( v[2][1], t1, VF_MUL( v[2][2], t2 ) ) );
+
+		// the error is computed exactly as in svd2::qef_solve(): |Atb - AtA * x|^2
+		const VecF r_x = VF_SUB( atb_x, VF_MADD( ata00, x, VF_MADD( ata01, y, VF_MUL( ata02, z ) ) ) );
+		const VecF r_y = VF_SUB( atb_y, VF_MADD( ata01, x, VF_MADD( ata11, y, VF_MUL( ata12, z ) ) ) );
+		const VecF r_z = VF_SUB( atb_z, VF_MADD( ata02, x, VF_MADD( ata12, y, VF_MUL( ata22, z ) ) ) );
+		const VecF error = VF_MADD( r_x, r_x, VF_MADD( r_y, r_y, VF_MUL( r_z, r_z ) ) );
+
+		// feature = max(rank - 1, 0)
+		const VecF rank = VF_ADD( VF_IsNonZero( d0 ), VF_ADD( VF_IsNonZero( d1 ), VF_IsNonZero( d2 ) ) );
+		const VecF feature = VF_MAX( VF_SUB( rank, one ), zero );
+
+		VF_STORE( streams[ QEF_Batch::POSITION_X ] + first_cell, VF_ADD( x, mass_x ) );
+		VF_STORE( streams[ QEF_Batch::POSITION_Y ] + first_cell, VF_ADD( y, mass_y ) );
+		VF_STORE( streams[ QEF_Batch::POSITION_Z ] + first_cell, VF_ADD( z, mass_z ) );
+		VF_STORE( streams[ QEF_Batch::QEF_ERROR ] + first_cell, error );
+		VF_STORE( streams[ QEF_Batch::FEATURE ] + first_cell, feature );
+	}
+
+}//namespace
+
+QEF_Batch::QEF_Batch( AllocatorI & allocator )
+	: _streams( allocator )
+{
+	_num_cells = 0;
+	_stream_stride = 0;
+}
+
+ERet QEF_Batch::Reset( const U32 num_cells )
+{
+	_num_cells = num_cells;
+	_stream_stride = tbALIGN( num_cells, LANES );
+	mxDO(_streams.setNum( _stream_stride * NUM_STREAMS ));
+	_streams.setAll( 0.0f );
+	return ALL_OK;
+}
+
+void QEF_Batch::AddPoint( const U32 cell_index, const V3f& position, const V3f& normal )
+{
+	mxASSERT( cell_index < _num_cells );
+	F32 * const base = _streams.raw() + cell_index;
+	const U32 stride = _stream_stride;
+
+	base[ ATA_00 * stride ] += normal.x * normal.x;
+	base[ ATA_01 * stride ] += normal.x * normal.y;
+	base[ ATA_02 * stride ] += normal.x * normal.z;
+	base[ ATA_11 * stride ] += normal.y * normal.y;
+	base[ ATA_12 * stride ] += normal.y * normal.z;
+	base[ ATA_22 * stride ] += normal.z * normal.z;
+
+	const F32 b = V3_Dot( position, normal );
+	base[ ATB_X * stride ] += normal.x * b;
+	base[ ATB_Y * stride ] += normal.y * b;
+	base[ ATB_Z * stride ] += normal.z * b;
+
+	base[ POINT_SUM_X * stride ] += position.x;
+	base[ POINT_SUM_Y * stride ] += position.y;
+	base[ POINT_SUM_Z * stride ] += position.z;
+	base[ NUM_POINTS * stride ] += 1.0f;
+}
+
+void QEF_Batch::AddSample( const U32 cell_index, const VX::HermiteDataSample& sample )
+{
+	for( int i = 0; i < sample.num_points; i++ )
+	{
+		this->AddPoint( cell_index, sample.positions[i], sample.normals[i] );
+	}
+}
+
+void QEF_Batch::SolveAll()
+{
+	this->Solve( 0, _num_cells );
+}
+
+void QEF_Batch::Solve( const U32 first_cell, const U32 num_cells )
+{
+	mxASSERT( first_cell % LANES == 0 );
+	mxASSERT( first_cell + num_cells <= _num_cells );
+
+	F32 * streams[ NUM_STREAMS ];
+	for( int i = 0; i < NUM_STREAMS; i++ ) {
+		streams[i] = this->GetStream( (EStream) i );
+	}
+
+	// the streams are padded, so the last partially filled register can be processed as usual
+	const U32 end_cell = first_cell + num_cells;
+	for( U32 cell_index = first_cell; cell_index < end_cell; cell_index += LANES )
+	{
+		SolveQEFs( streams, cell_index );
+	}
+}
+
+V3f QEF_Batch::GetPosition( const U32 cell_index ) const
+{
+	mxASSERT( cell_index < _num_cells );
+	return CV3f(
+		GetStream( POSITION_X )[ cell_index ],
+		GetStream( POSITION_Y )[ cell_index ],
+		GetStream( POSITION_Z )[ cell_index ]
+	);
+}
+
+/*
+-----------------------------------------------------------------------------
+	UNIT TESTS
+-----------------------------------------------------------------------------
+*/
+#if MX_DEVELOPER
+
+namespace
+{
+	/// Generates intersection points of random planes with a cell of unit size,
+	/// including flat cells, creases and corners.
+	void GenerateRandomHermiteSample( NwRandom & rng, VX::HermiteDataSample &sample_ )
+	{
+		const int num_planes = 1 + rng.RandomInt() % 3;
+		V3f	plane_normals[3];
+		V3f	plane_points[3];
+		for( int iPlane = 0; iPlane < num_planes; iPlane++ )
+		{
+			V3f	normal;
+			do {
+				normal = CV3f(
+					rng.GetRandomFloatInRange( -1, +1 ),
+					rng.GetRandomFloatInRange( -1, +1 ),
+					rng.GetRandomFloatInRange( -1, +1 )
+				);
+			} while( V3_LengthSquared( normal ) < 1e-2f );
+			plane_normals[ iPlane ] = V3_Normalized( normal );
+			plane_points[ iPlane ] = CV3f(
+				rng.GetRandomFloatInRange( 0.2f, 0.8f ),
+				rng.GetRandomFloatInRange( 0.2f, 0.8f ),
+				rng.GetRandomFloatInRange( 0.2f, 0.8f )
+			);
+		}
+
+		sample_.num_points = 2 + rng.RandomInt() % ( VX::HermiteDataSample::MAX_POINTS - 1 );
+		for( int i = 0; i < sample_.num_points; i++ )
+		{
+			const int iPlane = i % num_planes;
+			// a random point on the plane
+			const V3f n = plane_normals[ iPlane ];
+			V3f offset = CV3f(
+				rng.GetRandomFloatInRange( -0.5f, +0.5f ),
+				rng.GetRandomFloatInRange( -0.5f, +0.5f ),
+				rng.GetRandomFloatInRange( -0.5f, +0.5f )
+			);
+			offset -= n * V3_Dot( offset, n );
+			sample_.positions[i] = plane_points[ iPlane ] + offset;
+			sample_.normals[i] = n;
+		}
+	}
+}//namespace
+
+ERet UnitTest_QEF_Batch( AllocatorI & scratchpad )
+{
+	// not a multiple of the SIMD width to test the padding
+	const U32 num_cells = 10001;
+
+	QEF_Solver::Input *	inputs;
+	mxTRY_ALLOC_SCOPED( inputs, num_cells, scratchpad );
+
+	QEF_Batch	batch( scratchpad );
+	mxDO(batch.Reset( num_cells ));
+
+	NwRandom	rng( 12345 );
+	for( U32 i = 0; i < num_cells; i++ )
+	{
+		new( &inputs[i] ) QEF_Solver::Input();
+		GenerateRandomHermiteSample( rng, inputs[i] );
+		batch.AddSample( i, inputs[i] );
+	}
+
+	batch.SolveAll();
+
+	QEF_Solver_SVD2	reference_solver;
+
+	U32	num_feature_mismatches = 0;
+	F32	max_position_error = 0;
+	for( U32 i = 0; i < num_cells; i++ )
+	{
+		QEF_Solver::Output	reference;
+		reference_solver.Solve( inputs[i], reference );
+
+		const V3f position = batch.GetPosition( i );
+		const F32 position_error = V3_Length( position - reference.position );
+		max_position_error = maxf( max_position_error, position_error );
+
+		num_feature_mismatches += ( batch.GetFeature( i ) != reference.feature );
+
+		mxENSURE( position_error < 1e-3f, ERR_UNKNOWN_ERROR,
+			"cell %u: batched QEF position differs from SVD2 by %f", i, position_error );
+	}
+
+	ptPRINT("QEF batch: %u cells, max position error: %g, feature mismatches: %u\n",
+		num_cells, max_position_error, num_feature_mismatches);
+
+	// singular values close to the pseudo-inverse threshold may be rounded differently
+	mxENSURE( num_feature_mismatches <= num_cells / 1000, ERR_UNKNOWN_ERROR,
+		"too many feature type mismatches: %u", num_feature_mismatches );
+
+	return ALL_OK;
+}
+
+ERet Benchmark_QEF_Batch(
+	AllocatorI & scratchpad
+	, const U32 num_cells
+	)
+{
+	mxASSERT(num_cells > 0);
+
+	QEF_Solver::Input *	inputs;
+	mxTRY_ALLOC_SCOPED( inputs, num_cells, scratchpad );
+
+	NwRandom	rng( 12345 );
+	for( U32 i = 0; i < num_cells; i++ )
+	{
+		new( &inputs[i] ) QEF_Solver::Input();
+		GenerateRandomHermiteSample( rng, inputs[i] );
+	}
+
+	QEF_Batch	batch( scratchpad );
+	mxDO(batch.Reset( num_cells ));
+
+	// both paths include accumulating the QEFs from the Hermite data
+
+	ScopedTimer	timer;
+
+	QEF_Solver_SVD2	reference_solver;
+	F32	checksum = 0;
+	for( U32 i = 0; i < num_cells; i++ )
+	{
+		QEF_Solver::Output	output;
+		reference_solver.Solve( inputs[i], output );
+		checksum += output.error;
+	}
+	const U32 scalar_msec = timer.ElapsedMilliseconds();
+
+	timer.Reset();
+	for( U32 i = 0; i < num_cells; i++ )
+	{
+		batch.AddSample( i, inputs[i] );
+	}
+	const U32 accumulate_msec = timer.ElapsedMilliseconds();
+
+	timer.Reset();
+	batch.SolveAll();
+	const U32 solve_msec = timer.ElapsedMilliseconds();
+
+	const U32 batched_msec = accumulate_msec + solve_msec;
+
+	ptPRINT("QEF batch: %u cells, %u-wide SIMD: SVD2: %u msec (%.2f Mcells/sec), batched: %u msec (%.2f Mcells/sec), solve only: %u msec (%.2f Mcells/sec) (checksum: %f)\n",
+		num_cells, (U32)LANES,
+		scalar_msec, scalar_msec ? (num_cells / 1000.0f) / scalar_msec : 0.0f,
+		batched_msec, batched_msec ? (num_cells / 1000.0f) / batched_msec : 0.0f,
+		solve_msec, solve_msec ? (num_cells / 1000.0f) / solve_msec : 0.0f,
+		checksum
+		);
+
+	return ALL_OK;
+}
+
+#endif // MX_DEVELOPER
@@ -277,6 +277,90 @@ struct QEF_Solver_SVD2 : QEF_Solver
 	virtual void Solve( const Input& input, Output &output ) const override;
 };
 
+/*
+=======================================================================
+	Batched QEF solving
+=======================================================================
+*/
+
+///
+/// Accumulated QEFs of many cells in SoA layout (one array per component),
+/// solved several cells at once - one cell per SIMD lane (see BatchSIMD.h).
+/// Gives the same results as QEF_Solver_SVD2 (Jacobi eigen-decomposition of AtA
+/// with the same sweeps and pseudo-inverse threshold), but without a virtual call per cell.
+///
+class QEF_Batch: NonCopyable
+{
+public:
+	enum EStream
+	{
+		// inputs: the upper triangle of AtA, Atb, the sum of intersection points and their number
+		ATA_00, ATA_01, ATA_02, ATA_11, ATA_12, ATA_22,
+		ATB_X, ATB_Y, ATB_Z,
+		POINT_SUM_X, POINT_SUM_Y, POINT_SUM_Z, NUM_POINTS,
+
+		// outputs
+		POSITION_X, POSITION_Y, POSITION_Z,
+		QEF_ERROR,
+		FEATURE,	//!< EFeatureType, stored as a float
+
+		NUM_STREAMS
+	};
+
+public:
+	QEF_Batch( AllocatorI & allocator );
+
+	/// Allocates and clears the streams.
+	ERet Reset( const U32 num_cells );
+
+	mxFORCEINLINE U32 NumCells() const { return _num_cells; }
+
+	/// Accumulates a plane (intersection point and normal) into the cell's QEF.
+	void AddPoint( const U32 cell_index, const V3f& position, const V3f& normal );
+
+	/// Accumulates all intersection points of the cell.
+	void AddSample( const U32 cell_index, const VX::HermiteDataSample& sample );
+
+	/// Solves all cells, the results are written into the output streams.
+	void SolveAll();
+
+	/// Solves the cells in [first_cell, first_cell + num_cells), e.g. for splitting the work among threads.
+	/// \note first_cell must be a multiple of Meshok::SIMD::LANES.
+	void Solve( const U32 first_cell, const U32 num_cells );
+
+	mxFORCEINLINE F32* GetStream( const EStream stream ) { return _streams.raw() + stream * _stream_stride; }
+	mxFORCEINLINE const F32* GetStream( const EStream stream ) const { return _streams.raw() + stream * _stream_stride; }
+
+	V3f GetPosition( const U32 cell_index ) const;
+	F32 GetError( const U32 cell_index ) const { return GetStream( QEF_ERROR )[ cell_index ]; }
+	EFeatureType GetFeature( const U32 cell_index ) const { return (EFeatureType) (int) GetStream( FEATURE )[ cell_index ]; }
+
+private:
+	DynamicArray< F32 >	_streams;	//!< NUM_STREAMS arrays of _stream_stride floats
+	U32					_num_cells;
+	U32					_stream_stride;	//!< padded to the SIMD width
+};
+
+/*
+-----------------------------------------------------------------------------
+	UNIT TESTS
+-----------------------------------------------------------------------------
+*/
+
+#if MX_DEVELOPER
+
+/// Solves random Hermite data samples with QEF_Batch and QEF_Solver_SVD2
+/// and checks that the positions and feature types match.
+ERet UnitTest_QEF_Batch( AllocatorI & scratchpad );
+
+/// Prints the number of cells solved per second by QEF_Solver_SVD2 and QEF_Batch.
+ERet Benchmark_QEF_Batch(
+	AllocatorI & scratchpad
+	, const U32 num_cells = 1000000
+	);
+
+#endif // MX_DEVELOPER
+
 //--------------------------------------------------------------//
 //				End Of File.									//
 //--------------------------------------------------------------//
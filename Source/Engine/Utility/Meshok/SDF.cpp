@@ -8,6 +8,8 @@
 #include <algorithm>	// std::swap
 
 #include <Base/Template/Containers/Blob.h>
+#include <Core/Tasking/TaskSchedulerInterface.h>
+#include <Core/Util/ScopedTimer.h>
 #include <Meshok/Meshok.h>
 #include <Meshok/SDF.h>
 
@@ -584,6 +586,13 @@ namespace CSG
 		return result;
 	}
 
+	F32 Intersection::DistanceTo( const V3f& _position ) const
+	{
+		const F32 dA = A->DistanceTo(_position);
+		const F32 dB = B->DistanceTo(_position);
+		return maxf( dA, dB );
+	}
+
 }//namespace CSG
 
 }//namespace SDF
@@ -834,6 +843,274 @@ void RayTraceImage(
 	}
 }
 
+namespace
+{
+	/// state shared by all tile jobs of RayTraceImage_Tiled()
+	struct TiledRayTracer
+	{
+		const Isosurface *	surface;
+		float *		image;
+		U32			size_x;
+		U32			size_y;
+		U32			tile_size;
+		U32			num_tiles_x;
+
+		V3f			ray_from;
+		V3f			top_left;	//!< the point on the image plane for pixel (0,0)
+		V3f			delta_x;
+		V3f			delta_y;
+		V3f			forward;
+		F32			far_plane;
+
+		/// the bounding sphere of the scene (for culling tiles)
+		V3f			bounds_center;
+		F32			bounds_radius;
+		bool		has_bounds;
+
+	public:
+		V3f GetRayTarget( U32 iX, U32 iY ) const
+		{
+			return top_left + delta_x * (float)iX + delta_y * (float)iY;
+		}
+
+		/// returns true if the rays of the tile cannot hit anything inside the scene bounds
+		bool IsTileOutsideBounds( const V3f corner_dirs[4], const V3f& axis ) const
+		{
+			if( !has_bounds ) {
+				return false;
+			}
+
+			const V3f center_relative_to_eye = bounds_center - ray_from;
+
+			// the image plane bounds all rays (they end there)
+			const F32 depth = V3_Dot( center_relative_to_eye, forward );
+			if( depth - bounds_radius > far_plane || depth + bounds_radius < 0 ) {
+				return true;
+			}
+
+			// side planes of the tile frustum pass through the eye
+			for( UINT i = 0; i < 4; i++ )
+			{
+				V3f plane_normal = V3_Cross( corner_dirs[i], corner_dirs[ (i + 1) % 4 ] );
+				const F32 length = V3_Length( plane_normal );
+				if( length < 1e-6f ) {
+					continue;	// degenerate tile (e.g. a single column of pixels)
+				}
+				plane_normal /= length;
+				if( V3_Dot( plane_normal, axis ) > 0 ) {
+					plane_normal = -plane_normal;	// make it point outside the frustum
+				}
+				if( V3_Dot( plane_normal, center_relative_to_eye ) > bounds_radius ) {
+					return true;
+				}
+			}
+
+			return false;
+		}
+
+		void RenderTile( const U32 tile_index ) const;
+	};
+
+	/// The same as CastRay_SphereTracing(), but starts from the given distance along the ray.
+	bool CastRay_SphereTracingFrom(
+		const SDF::Isosurface* _SDF,
+		const V3f& _start,
+		const V3f& _rayDir,
+		const F32 _length,
+		const F32 _startTime,
+		F32 &_time01
+		)
+	{
+#define LOCAL_EPSILON 1e-4f
+
+		enum { MAX_STEPS = 32 };	// prevent infinite looping
+
+		F32 currentTime = _startTime;
+		for( U32 iteration = 0; iteration < MAX_STEPS; iteration++ )
+		{
+			if( currentTime > _length ) {
+				return false;
+			}
+			const V3f currentPoint = _start + _rayDir * currentTime;
+			const F32 distance = _SDF->DistanceTo( currentPoint );
+			if( distance < LOCAL_EPSILON ) {
+				break;	// including cases when distance < 0 (i.e. the ray starts inside solid)
+			}
+			currentTime += distance;
+		}
+
+#undef LOCAL_EPSILON
+
+		_time01 = currentTime / _length;
+
+		return true;
+	}
+
+	mxBIBREF("Cone Tracing: John Amanatides. Ray Tracing with Cones. SIGGRAPH 1984");
+	mxBIBREF("Cone Marching: Mandelbox Distance Estimation, http://www.fulcrum-demo.org/wp-content/uploads/2012/04/Cone_Marching_Mandelbox_by_Seven_Fulcrum_LongVersion.pdf");
+	void TiledRayTracer::RenderTile( const U32 tile_index ) const
+	{
+		const U32 tile_x = tile_index % num_tiles_x;
+		const U32 tile_y = tile_index / num_tiles_x;
+
+		const U32 startX = tile_x * tile_size;
+		const U32 startY = tile_y * tile_size;
+		const U32 endX = smallest( startX + tile_size, size_x );
+		const U32 endY = smallest( startY + tile_size, size_y );
+
+		// the rays through the corner pixels enclose all rays of the tile
+		const V3f corner_dirs[4] = {
+			V3_Normalized( GetRayTarget( startX, startY ) - ray_from ),
+			V3_Normalized( GetRayTarget( endX - 1, startY ) - ray_from ),
+			V3_Normalized( GetRayTarget( endX - 1, endY - 1 ) - ray_from ),
+			V3_Normalized( GetRayTarget( startX, endY - 1 ) - ray_from ),
+		};
+		const V3f axis = V3_Normalized( corner_dirs[0] + corner_dirs[1] + corner_dirs[2] + corner_dirs[3] );
+
+		if( IsTileOutsideBounds( corner_dirs, axis ) )
+		{
+			for( U32 iY = startY; iY < endY; iY++ ) {
+				for( U32 iX = startX; iX < endX; iX++ ) {
+					image[ iY * size_x + iX ] = 0.0f;	// miss
+				}
+			}
+			return;
+		}
+
+		// March a cone enclosing all rays of the tile.
+		// The sphere of radius 'distance' around a point on the axis is empty;
+		// we can advance while it contains the cone's cross section.
+		F32 cos_half_angle = 1.0f;
+		for( UINT i = 0; i < 4; i++ ) {
+			cos_half_angle = minf( cos_half_angle, V3_Dot( corner_dirs[i], axis ) );
+		}
+		const F32 tan_half_angle = sqrtf( maxf( 1.0f - squaref( cos_half_angle ), 0.0f ) ) / cos_half_angle;
+
+		enum { MAX_CONE_STEPS = 32 };
+		const F32 max_depth = far_plane / V3_Dot( axis, forward );	// where the axis pierces the image plane
+
+		F32 cone_depth = 0;	// along the cone axis
+		for( U32 iteration = 0; iteration < MAX_CONE_STEPS && cone_depth < max_depth; iteration++ )
+		{
+			const F32 distance = surface->DistanceTo( ray_from + axis * cone_depth );
+			const F32 cone_radius = cone_depth * tan_half_angle;
+			const F32 free_space = distance - cone_radius;
+			if( free_space < cone_radius * 0.1f + 1e-4f ) {
+				break;	// the cone is too wide or touches the surface - continue per pixel
+			}
+			// all points of the rays in the next slab are within 'distance' of the current point
+			cone_depth += free_space / (1.0f + tan_half_angle);
+		}
+
+		// sphere trace each pixel, starting from the depth reached by the cone
+		for( U32 iY = startY; iY < endY; iY++ )
+		{
+			float * dst = image + iY * size_x;
+			for( U32 iX = startX; iX < endX; iX++ )
+			{
+				F32 length;
+				const V3f ray_dir = V3_Normalized( GetRayTarget( iX, iY ) - ray_from, length );
+				const F32 start_time = cone_depth / V3_Dot( ray_dir, axis );
+
+				float time = 1.0f;
+				CastRay_SphereTracingFrom( surface, ray_from, ray_dir, length, start_time, time );
+				dst[ iX ] = 1.0f - time;
+			}
+		}
+	}
+
+	class RayTraceTilesJob: NonCopyable
+	{
+		const TiledRayTracer& _tracer;
+
+	public:
+		RayTraceTilesJob( const TiledRayTracer& tracer )
+			: _tracer( tracer )
+		{
+		}
+
+		ERet Run( const NwThreadContext& context, int start, int end )
+		{
+			for( int tile_index = start; tile_index < end; tile_index++ )
+			{
+				_tracer.RenderTile( tile_index );
+			}
+			return ALL_OK;
+		}
+	};
+
+}//namespace
+
+void RayTraceImage_Tiled(
+	const Isosurface* _surface,
+	const V3f& camera_position_in_world_space,
+	const V3f& _cameraForward,
+	const V3f& _cameraRight,
+	const V3f& _cameraUp,
+	const F32 _farPlane,
+	const F32 _halfFoVy,
+	const F32 _aspect,
+	const U32 _sizeX,
+	const U32 _sizeY,
+	float* _imagePtr,
+	NwJobSchedulerI & _jobScheduler,
+	const AABBf* _sceneBounds,
+	const U32 _tileSize
+)
+{
+	mxASSERT_PTR(_surface);
+	mxASSERT(V3_IsNormalized(_cameraForward));
+	mxASSERT(V3_IsNormalized(_cameraRight));
+	mxASSERT(V3_IsNormalized(_cameraUp));
+	mxASSERT(_farPlane > 0);
+	mxASSERT(_halfFoVy > 0);
+	mxASSERT(_aspect > 0);
+	mxASSERT(_sizeX > 0);
+	mxASSERT(_sizeY > 0);
+	mxASSERT(_tileSize > 0);
+
+	// set up the image plane exactly as RayTraceImage() does
+	const float imagePlaneH = _farPlane * tanf(_halfFoVy);	// half-height of the image plane
+	const float imagePlaneW = imagePlaneH * _aspect;	// half-width of the image plane
+
+	const V3f cRightScaled = _cameraRight * imagePlaneW;
+	const V3f cUpScaled = _cameraUp * -imagePlaneH;	// (-1) because screen Y-axis goes UP, while image Y goes down
+
+	TiledRayTracer	tracer;
+	tracer.surface = _surface;
+	tracer.image = _imagePtr;
+	tracer.size_x = _sizeX;
+	tracer.size_y = _sizeY;
+	tracer.tile_size = _tileSize;
+	tracer.num_tiles_x = (_sizeX + _tileSize - 1) / _tileSize;
+
+	tracer.ray_from = camera_position_in_world_space;
+	tracer.top_left = -cRightScaled - cUpScaled + (_cameraForward * _farPlane) + camera_position_in_world_space;
+	tracer.delta_x = cRightScaled * (2.0f / (float)_sizeX);
+	tracer.delta_y = cUpScaled * (2.0f / (float)_sizeY);
+	tracer.forward = _cameraForward;
+	tracer.far_plane = _farPlane;
+
+	const AABBf scene_bounds = _sceneBounds ? *_sceneBounds : _surface->GetLocalBounds();
+	tracer.has_bounds = scene_bounds.IsValid();
+	tracer.bounds_center = scene_bounds.center();
+	tracer.bounds_radius = V3_Length( scene_bounds.size() ) * 0.5f;
+
+	const U32 num_tiles_y = (_sizeY + _tileSize - 1) / _tileSize;
+	const U32 num_tiles = tracer.num_tiles_x * num_tiles_y;
+
+	JobID	h_job_render_tiles;
+	nwCREATE_JOB(h_job_render_tiles
+		, _jobScheduler
+		, -1, num_tiles
+		, JobPriority_High
+		, RayTraceTilesJob
+		, tracer
+		);
+
+	_jobScheduler.waitFor( h_job_render_tiles );
+}
+
 /*
 @todo: Try some isosurface equations for testing from "Appendix A: Reference Implicits",
 "Fast Ray Tracing of Arbitrary Implicit Surfaces with Interval and Affine Arithmetic"(2009)
@@ -1816,6 +2093,7 @@ U32 SDF_Sampler::SampleHermiteData(
 ) const
 {
 	V3f corners[8];	// cell corners in world space
+	F32 distances[8];	// signed distances at the cell corners
 	UINT signMask = 0;
 	for( UINT iCorner = 0; iCorner < 8; iCorner++ )
 	{
@@ -1824,8 +2102,9 @@ U32 SDF_Sampler::SampleHermiteData(
 		const int iCornerZ = ( iCorner & MASK_POS_Z ) ? iCellZ+1 : iCellZ;
 		const V3f cornerXYZ = V3f::set( iCornerX, iCornerY, iCornerZ );
 		const V3f cellCorner = m_offset + V3_Multiply( cornerXYZ, m_cellSize );
-mxTEMP
-		const bool cornerIsInside = m_isosurface.IsInside( cellCorner );
+
+		distances[iCorner] = m_isosurface.DistanceTo( cellCorner );
+		const bool cornerIsInside = ( distances[iCorner] < 0 );
 		signMask |= (cornerIsInside << iCorner);
 
 		corners[iCorner] = cellCorner;
@@ -1837,38 +2116,254 @@ mxTEMP
 
 	int numWritten = 0;
 
-UNDONE;
-	//U32 edgeMask = CUBE_ACTIVE_EDGES[ signMask ];
-	//while( edgeMask )
-	//{
-	//	U32	iEdge;
-	//	edgeMask = TakeNextTrailingBit32( edgeMask, &iEdge );
-
-	//	const UINT iCornerA = CUBE_EDGE[iEdge][0];
-	//	const UINT iCornerB = CUBE_EDGE[iEdge][1];
-
-	//	const V3f& cornerA = corners[iCornerA];
-	//	const V3f& cornerB = corners[iCornerB];
-
-	//	F32 intersectionTime;
-	//	const bool intersects = m_isosurface.IntersectsLine(
-	//		cornerA, cornerB,
-	//		intersectionTime, _sample.normals[ numWritten ]
-	//	);
-	//	mxASSERT(intersects);
-	//	if( intersects ) {
-	//		_sample.positions[ numWritten ] = cornerA + (cornerB - cornerA) * intersectionTime;
-	//		numWritten++;
-	//	}
-	//}
+	for( UINT iEdge = 0; iEdge < CubeEdgeCount; iEdge++ )
+	{
+		ECubeCorner iCornerA, iCornerB;
+		Cube_Endpoints_from_Edge( (ECubeEdge) iEdge, iCornerA, iCornerB );
+
+		if( !vxIS_ACTIVE_EDGE( signMask, iCornerA, iCornerB ) ) {
+			continue;
+		}
+
+		const EAxis edgeAxis = EAxis_from_CubeEdge( iEdge );
+
+		F32 distance;
+		V3f normal;
+		getEdgeIntersectionFromValues(
+			( iCornerA & MASK_POS_X ) ? iCellX+1 : iCellX,
+			( iCornerA & MASK_POS_Y ) ? iCellY+1 : iCellY,
+			( iCornerA & MASK_POS_Z ) ? iCellZ+1 : iCellZ,
+			edgeAxis,
+			distances[iCornerA], distances[iCornerB],
+			distance, normal
+			);
+
+		V3f intersectionPoint = corners[iCornerA];
+		intersectionPoint[ edgeAxis ] += distance;
+
+		_sample.positions[ numWritten ] = intersectionPoint;
+		_sample.normals[ numWritten ] = normal;
+		_sample.edge_remap[ iEdge ] = numWritten;
+		numWritten++;
+	}
 
 	_sample.num_points = numWritten;
 
 	return signMask;
 }
 
+bool SDF_Sampler::getEdgeIntersection(
+	int iCellX, int iCellY, int iCellZ
+	, const EAxis edgeAxis
+	, float &distance_
+	, V3f &normal_
+) const
+{
+	const V3f startCorner = m_offset + V3_Multiply( V3f::set( iCellX, iCellY, iCellZ ), m_cellSize );
+	V3f endCorner = startCorner;
+	endCorner[ edgeAxis ] += m_cellSize[ edgeAxis ];
+
+	return this->getEdgeIntersectionFromValues(
+		iCellX, iCellY, iCellZ,
+		edgeAxis,
+		m_isosurface.DistanceTo( startCorner ), m_isosurface.DistanceTo( endCorner ),
+		distance_, normal_
+		);
+}
+
+void SDF_Sampler::SampleCornerValues(
+	const Int3& min_corner
+	, const Int3& size
+	, F32 *values_
+	, F32 *scratch_
+) const
+{
+	const UINT count = size.x * size.y * size.z;
+
+	// SoA positions of the corners
+	F32 * xs = scratch_;
+	F32 * ys = scratch_ + count;
+	F32 * zs = scratch_ + count * 2;
+
+	UINT index = 0;
+	for( int iZ = 0; iZ < size.z; iZ++ )
+	{
+		for( int iY = 0; iY < size.y; iY++ )
+		{
+			for( int iX = 0; iX < size.x; iX++ )
+			{
+				// computed exactly as in SampleHermiteData()
+				const V3f cornerXYZ = V3f::set( min_corner.x + iX, min_corner.y + iY, min_corner.z + iZ );
+				const V3f cellCorner = m_offset + V3_Multiply( cornerXYZ, m_cellSize );
+				xs[ index ] = cellCorner.x;
+				ys[ index ] = cellCorner.y;
+				zs[ index ] = cellCorner.z;
+				index++;
+			}
+		}
+	}
+
+	m_isosurface.DistanceToBatch( xs, ys, zs, values_, count );
+}
+
+bool SDF_Sampler::getEdgeIntersectionFromValues(
+	int iCellX, int iCellY, int iCellZ
+	, const EAxis edgeAxis
+	, const F32 startValue
+	, const F32 endValue
+	, float &distance_
+	, V3f &normal_
+) const
+{
+	if( (startValue < 0) == (endValue < 0) ) {
+		return false;
+	}
+
+	// the zero crossing of the linearly interpolated distance
+	const F32 time = clampf( startValue / (startValue - endValue), 0.0f, 1.0f );
+
+	V3f intersectionPoint = m_offset + V3_Multiply( V3f::set( iCellX, iCellY, iCellZ ), m_cellSize );
+	distance_ = time * m_cellSize[ edgeAxis ];
+	intersectionPoint[ edgeAxis ] += distance_;
+
+	normal_ = m_isosurface.NormalAt( intersectionPoint );
+	return true;
+}
+
 }//namespace VX
 
+
+/*
+-----------------------------------------------------------------------------
+	UNIT TESTS
+-----------------------------------------------------------------------------
+*/
+#if MX_DEVELOPER
+
+namespace SDF
+{
+namespace
+{
+	ERet CompareRayTracers(
+		const char* scene_name
+		, const Isosurface* scene
+		, const AABBf& view_bounds	//!< for placing the camera
+		, const AABBf* cull_bounds
+		, NwJobSchedulerI & job_scheduler
+		, float * reference_image
+		, float * tiled_image
+		, const U32 image_width
+		, const U32 image_height
+		)
+	{
+		const U32 num_pixels = image_width * image_height;
+
+		// look at the scene from a corner
+		const V3f scene_center = view_bounds.center();
+		const V3f camera_position = view_bounds.max_corner + view_bounds.size() * 0.25f;
+		const V3f camera_forward = V3_Normalized( scene_center - camera_position );
+		const V3f camera_right = V3_Normalized( V3_Cross( camera_forward, V3_UP ) );
+		const V3f camera_up = V3_Cross( camera_right, camera_forward );
+		const F32 far_plane = V3_Length( view_bounds.size() ) * 2.0f;
+		const F32 aspect = float(image_width) / float(image_height);
+
+		ScopedTimer	timer;
+
+		RayTraceImage( scene
+			, camera_position, camera_forward, camera_right, camera_up
+			, far_plane, DEG2RAD(30), aspect
+			, image_width, image_height
+			, reference_image
+			);
+		const U32 reference_msec = timer.ElapsedMilliseconds();
+
+		timer.Reset();
+		RayTraceImage_Tiled( scene
+			, camera_position, camera_forward, camera_right, camera_up
+			, far_plane, DEG2RAD(30), aspect
+			, image_width, image_height
+			, tiled_image
+			, job_scheduler
+			, cull_bounds
+			);
+		const U32 tiled_msec = timer.ElapsedMilliseconds();
+
+		// Both renderers give up after a fixed number of steps,
+		// so rays grazing the surface can differ (cone stepping saves steps for them).
+		F32	max_difference = 0;
+		U32	num_different_pixels = 0;
+		for( U32 i = 0; i < num_pixels; i++ )
+		{
+			const F32 difference = mmAbs( reference_image[i] - tiled_image[i] );
+			max_difference = maxf( max_difference, difference );
+			num_different_pixels += ( difference > 1e-2f );
+		}
+
+		ptPRINT("RayTraceImage(%s, %ux%u): single-threaded: %u msec, tiled: %u msec (x%.2f), max diff: %f, different pixels: %.2f%%\n",
+			scene_name, image_width, image_height,
+			reference_msec, tiled_msec, float(reference_msec) / largest( tiled_msec, 1u ),
+			max_difference, num_different_pixels * 100.0f / num_pixels
+			);
+
+		return ALL_OK;
+	}
+}//namespace
+
+ERet Benchmark_RayTraceImage_Tiled(
+	NwJobSchedulerI & job_scheduler
+	, AllocatorI & allocator
+	, const U32 image_width
+	, const U32 image_height
+	)
+{
+	const U32 num_pixels = image_width * image_height;
+
+	float *	reference_image;
+	mxTRY_ALLOC_SCOPED( reference_image, num_pixels, allocator );
+
+	float *	tiled_image;
+	mxTRY_ALLOC_SCOPED( tiled_image, num_pixels, allocator );
+
+	const V3f scene_size = CV3f(100.0f);
+
+	// the test scenes are centered around (-sceneSize * 0.3)
+	const V3f scene_center = -scene_size * 0.3f;
+	const AABBf view_bounds = AABBf::fromSphere( scene_center, scene_size.x * 0.5f );
+
+	// unbounded (has a ground plane) - only cone stepping helps
+	mxDO(CompareRayTracers( "test scene"
+		, Testing::GetTestScene( scene_size )
+		, view_bounds
+		, nil
+		, job_scheduler
+		, reference_image, tiled_image
+		, image_width, image_height
+		));
+
+	// a small object in the middle of the screen - most tiles are culled
+	Torus	torus;
+	torus.center = scene_center;
+	torus.diameter = scene_size.x * 0.2f;
+	torus.thickness = scene_size.x * 0.05f;
+
+	const AABBf torus_bounds = AABBf::fromSphere( torus.center, torus.diameter + torus.thickness );
+
+	mxDO(CompareRayTracers( "torus"
+		, &torus
+		, view_bounds
+		, &torus_bounds
+		, job_scheduler
+		, reference_image, tiled_image
+		, image_width, image_height
+		));
+
+	return ALL_OK;
+}
+
+}//namespace SDF
+
+#endif // MX_DEVELOPER
+
 /*
 
 An Implicit Surface Polygonizer, by Jules Bloomenthal [1994]
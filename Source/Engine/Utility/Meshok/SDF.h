@@ -4,6 +4,8 @@
 #include <Base/Template/Containers/Array/TInplaceArray.h>
 #include <Utility/Meshok/Volumes.h>
 
+class NwJobSchedulerI;
+
 
 namespace SDF
 {
@@ -58,6 +60,15 @@ namespace SDF
 		/// The distance is positive if the point is outside the solid and negative, if inside.
 		virtual F32 DistanceTo( const V3f& _point ) const = 0;
 
+		/// Computes distances for many points at once (SoA layout, no alignment requirements).
+		/// Amortizes the cost of virtual calls and allows SIMD evaluation (see SDF_Batch.cpp).
+		/// The default implementation calls DistanceTo() for each point.
+		virtual void DistanceToBatch(
+			const F32* xs, const F32* ys, const F32* zs,
+			F32 *distances_,
+			const UINT count
+		) const;
+
 		/// Is the given point inside or outside w.r.t. the implicit function?
 		/// The result should be the same as (scalar_distance < 0), but it can be implemented more efficiently.
 		virtual bool IsInside( const V3f& _point ) const
@@ -129,6 +140,7 @@ namespace SDF
 		virtual V3f NormalAt( const V3f& _point ) const override;
 
 		virtual Sample SampleAt( const V3f& _point ) const override;
+		virtual void DistanceToBatch( const F32* xs, const F32* ys, const F32* zs, F32 *distances_, const UINT count ) const override;
 
 		virtual bool IntersectsLine(
 			const V3f& _start, const V3f& _end,
@@ -164,6 +176,7 @@ namespace SDF
 		{
 			return this->UnsignedDistanceTo( _point ) - thickness;
 		}
+		virtual void DistanceToBatch( const F32* xs, const F32* ys, const F32* zs, F32 *distances_, const UINT count ) const override;
 		virtual V3f NormalAt( const V3f& _point ) const override
 		{
 			const V3f& N = Plane_GetNormal( plane );
@@ -200,6 +213,7 @@ namespace SDF
 		{
 			return DistanceBetween( center, _point ) - radius;
 		}
+		virtual void DistanceToBatch( const F32* xs, const F32* ys, const F32* zs, F32 *distances_, const UINT count ) const override;
 		virtual V3f NormalAt( const V3f& _point ) const override
 		{
 			return V3_Normalized( _point - center );
@@ -245,6 +259,7 @@ namespace SDF
 		{
 			return radius - DistanceBetween( center, _point );
 		}
+		virtual void DistanceToBatch( const F32* xs, const F32* ys, const F32* zs, F32 *distances_, const UINT count ) const override;
 		virtual V3f NormalAt( const V3f& _point ) const override
 		{
 			return V3_Normalized( center - _point );
@@ -278,6 +293,7 @@ namespace SDF
 		}
 		virtual bool IsInside( const V3f& _point ) const;
 		virtual float DistanceTo( const V3f& _point ) const override;
+		virtual void DistanceToBatch( const F32* xs, const F32* ys, const F32* zs, F32 *distances_, const UINT count ) const override;
 
 		virtual AABBf GetLocalBounds() const override
 		{
@@ -297,6 +313,7 @@ namespace SDF
 		}
 		virtual bool IsInside( const V3f& _point ) const;
 		virtual float DistanceTo( const V3f& _point ) const override;
+		virtual void DistanceToBatch( const F32* xs, const F32* ys, const F32* zs, F32 *distances_, const UINT count ) const override;
 		mxBUG("wrong:")
 		//virtual V3f NormalAt( const V3f& _point ) const override;
 		//virtual Sample SampleAt( const V3f& _point ) const override;
@@ -324,6 +341,7 @@ namespace SDF
 			mxBIBREF("Interactive Modeling with Distance Fields, Tim-Christopher Reiner [2010], 3.4.5 Cylinder, Eq.3.5, P.22");
 			return mmAbs(distance) - radius;
 		}
+		virtual void DistanceToBatch( const F32* xs, const F32* ys, const F32* zs, F32 *distances_, const UINT count ) const override;
 		virtual V3f NormalAt( const V3f& _point ) const override
 		{
 			const V3f closest_point_on_axis = Ray_ClosestPoint( ray_origin, ray_direction, _point );
@@ -366,6 +384,7 @@ namespace SDF
 			mxBIBREF("Interactive Modeling with Distance Fields, Tim-Christopher Reiner [2010], 3.4.5 Cylinder, Eq.3.5, P.22");
 			return maxf( mmAbs(distance_to_axis) - radius, distance_to_cap );
 		}
+		virtual void DistanceToBatch( const F32* xs, const F32* ys, const F32* zs, F32 *distances_, const UINT count ) const override;
 	};
 
 	struct Torus : Isosurface
@@ -389,6 +408,7 @@ namespace SDF
 			);
 			return V2_Length(q) - thickness;
 		}
+		virtual void DistanceToBatch( const F32* xs, const F32* ys, const F32* zs, F32 *distances_, const UINT count ) const override;
 	};
 
 	/// Infinite cone
@@ -537,6 +557,7 @@ namespace SDF
 			mmSinCos( scaled.z, sz, cz );
 			return 2.0 * (cx * sy + cy * sz + cz * sx);
 		}
+		virtual void DistanceToBatch( const F32* xs, const F32* ys, const F32* zs, F32 *distances_, const UINT count ) const override;
 	};
 
 	/// http://0fps.net/2012/07/07/meshing-minecraft-part-2/
@@ -772,6 +793,7 @@ namespace SDF
 			const V3f localPosition = M44_TransformPoint( worldToLocal, _point );
 			return O->DistanceTo( localPosition );
 		}
+		virtual void DistanceToBatch( const F32* xs, const F32* ys, const F32* zs, F32 *distances_, const UINT count ) const override;
 		virtual V3f NormalAt( const V3f& _point ) const override
 		{
 			const V3f localPosition = M44_TransformPoint( worldToLocal, _point );
@@ -790,6 +812,7 @@ namespace SDF
 		{
 		public:
 			virtual F32 DistanceTo( const V3f& _point ) const override;
+			virtual void DistanceToBatch( const F32* xs, const F32* ys, const F32* zs, F32 *distances_, const UINT count ) const override;
 			virtual Sample SampleAt( const V3f& _point ) const override;
 		};
 
@@ -800,6 +823,7 @@ namespace SDF
 		public:
 			virtual bool IsInside( const V3f& _point ) const override;
 			virtual F32 DistanceTo( const V3f& _point ) const override;
+			virtual void DistanceToBatch( const F32* xs, const F32* ys, const F32* zs, F32 *distances_, const UINT count ) const override;
 			virtual Sample SampleAt( const V3f& _point ) const override;
 		};
 
@@ -810,6 +834,7 @@ namespace SDF
 		public:
 			virtual bool IsInside( const V3f& _point ) const override;
 			virtual F32 DistanceTo( const V3f& _point ) const override;
+			virtual void DistanceToBatch( const F32* xs, const F32* ys, const F32* zs, F32 *distances_, const UINT count ) const override;
 			virtual Sample SampleAt( const V3f& _point ) const override;
 
 			//virtual bool DirectedDistance(
@@ -825,6 +850,7 @@ namespace SDF
 		{
 		public:
 			virtual F32 DistanceTo( const V3f& _point ) const override;
+			virtual void DistanceToBatch( const F32* xs, const F32* ys, const F32* zs, F32 *distances_, const UINT count ) const override;
 			virtual Sample SampleAt( const V3f& _point ) const override;
 		};
 
@@ -834,6 +860,7 @@ namespace SDF
 		{
 		public:
 			virtual F32 DistanceTo( const V3f& _point ) const override;
+			virtual void DistanceToBatch( const F32* xs, const F32* ys, const F32* zs, F32 *distances_, const UINT count ) const override;
 			//virtual Sample SampleAt( const V3f& _point ) const override;
 		};
 
@@ -854,6 +881,7 @@ namespace SDF
 			{
 				return A->DistanceTo(_point) * blendA + B->DistanceTo(_point) * blendB;
 			}
+			virtual void DistanceToBatch( const F32* xs, const F32* ys, const F32* zs, F32 *distances_, const UINT count ) const override;
 		};
 
 		struct CSG_AddOffset : UnaryOperation
@@ -868,6 +896,7 @@ namespace SDF
 			{
 				return O->DistanceTo(_point) + offset;
 			}
+			virtual void DistanceToBatch( const F32* xs, const F32* ys, const F32* zs, F32 *distances_, const UINT count ) const override;
 		};
 
 		struct Offset : UnaryOperation
@@ -882,6 +911,7 @@ namespace SDF
 			{
 				return O->DistanceTo( _point + offset );
 			}
+			virtual void DistanceToBatch( const F32* xs, const F32* ys, const F32* zs, F32 *distances_, const UINT count ) const override;
 		};
 		struct RotateZ : UnaryOperation
 		{
@@ -917,6 +947,7 @@ namespace SDF
 			{
 				return O->DistanceTo( M33_Transform( matrix, _point ) );
 			}
+			virtual void DistanceToBatch( const F32* xs, const F32* ys, const F32* zs, F32 *distances_, const UINT count ) const override;
 		};
 
 
@@ -1024,6 +1055,27 @@ namespace SDF
 		U32 _endY = ~0		// last vertical line
 	);
 
+	/// Multithreaded version of RayTraceImage(): renders the image in square tiles on the job system.
+	/// Tiles whose rays cannot reach the scene bounds are skipped.
+	/// Each tile first marches a cone enclosing all of its rays (cone stepping),
+	/// so that pixels start sphere tracing from the shared conservative depth.
+	void RayTraceImage_Tiled(
+		const Isosurface* _surface,
+		const V3f& camera_position_in_world_space,
+		const V3f& _cameraForward,
+		const V3f& _cameraRight,
+		const V3f& _cameraUp,
+		const F32 _farPlane,
+		const F32 _halfFoVy,// half of vertical field of view, in radians
+		const F32 _aspect,	// aspect ratio = image_width / image_height
+		const U32 _sizeX,	// image width in pixels
+		const U32 _sizeY,	// image height in pixels
+		float* _imagePtr,	// pointer to image data
+		NwJobSchedulerI & _jobScheduler,
+		const AABBf* _sceneBounds = nil,	// for culling tiles; the surface's local bounds are used if nil
+		const U32 _tileSize = 16
+	);
+
 	namespace Testing
 	{
 		const Isosurface* GetTestScene( const V3f& sceneSize );
@@ -1035,6 +1087,7 @@ namespace VX
 {
 
 /// NOTE: I don't recommend its usage because of redundant calculations when building an octree (12 edges for octrees vs 3 edges on a uniform grid)
+/// (SampleHermiteGrid() samples each corner and each edge of a uniform grid only once).
 class SDF_Sampler : public AVolumeSampler
 {
 	const SDF::Isosurface &	m_isosurface;
@@ -1058,6 +1111,31 @@ public:
 		HermiteDataSample & _sample
 	) const override;
 
+	virtual bool getEdgeIntersection(
+		int iCellX, int iCellY, int iCellZ
+		, const EAxis edgeAxis
+		, float &distance_
+		, V3f &normal_
+	) const override;
+
+	/// computes the distances with DistanceToBatch()
+	virtual void SampleCornerValues(
+		const Int3& min_corner
+		, const Int3& size
+		, F32 *values_
+		, F32 *scratch_
+	) const override;
+
+	/// interpolates the distances at the ends of the edge
+	virtual bool getEdgeIntersectionFromValues(
+		int iCellX, int iCellY, int iCellZ
+		, const EAxis edgeAxis
+		, const F32 startValue
+		, const F32 endValue
+		, float &distance_
+		, V3f &normal_
+	) const override;
+
 	//bool IsInside_NonVirtual(
 	//	int iCellX, int iCellY, int iCellZ
 	//) const;
@@ -1065,6 +1143,36 @@ public:
 
 }//namespace VX
 
+
+/*
+-----------------------------------------------------------------------------
+	UNIT TESTS
+-----------------------------------------------------------------------------
+*/
+
+#if MX_DEVELOPER
+
+namespace SDF
+{
+	/// Evaluates a composite scene on a dense grid with DistanceTo() and DistanceToBatch(),
+	/// prints timings and checks that both paths return the same distances.
+	ERet Benchmark_DistanceToBatch(
+		AllocatorI & allocator
+		, const U32 resolution = 128	//!< the grid has resolution^3 samples
+		);
+
+	/// Renders Testing::GetTestScene() with RayTraceImage() and RayTraceImage_Tiled(),
+	/// prints timings and the difference between the images.
+	ERet Benchmark_RayTraceImage_Tiled(
+		NwJobSchedulerI & job_scheduler
+		, AllocatorI & allocator
+		, const U32 image_width = 1920
+		, const U32 image_height = 1080
+		);
+}//namespace SDF
+
+#endif // MX_DEVELOPER
+
 //--------------------------------------------------------------//
 //				End Of File.									//
 //--------------------------------------------------------------//
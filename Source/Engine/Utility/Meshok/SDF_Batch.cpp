@@ -0,0 +1,752 @@
+// Batched (SoA) distance evaluation for SDF primitives and CSG operations.
+#include "stdafx.h"
+#pragma hdrstop
+
+#include <Core/Util/ScopedTimer.h>
+
+#include <Meshok/Meshok.h>
+#include <Meshok/SDF.h>
+
+#include <Meshok/BatchSIMD.h>
+
+namespace SDF
+{
+namespace
+{
+	using Meshok::SIMD::VecF;
+	using Meshok::SIMD::LANES;
+
+	/// combinators process points in chunks of this size to keep temporaries on the stack
+	enum { CHUNK_SIZE = 64 };
+	mxSTATIC_ASSERT( CHUNK_SIZE % LANES == 0 );
+
+	mxFORCEINLINE VecF VF_Length3( const VecF& x, const VecF& y, const VecF& z )
+	{
+		return VF_SQRT( VF_MADD( x, x, VF_MADD( y, y, VF_MUL( z, z ) ) ) );
+	}
+
+	mxFORCEINLINE VecF VF_Max3( const VecF& a, const VecF& b, const VecF& c )
+	{
+		return VF_MAX( VF_MAX( a, b ), c );
+	}
+
+	/// Computes sines and cosines with ~1e-7 precision for |x| < 8192.
+	/// Uses only floating-point ops so that it works with plain AVX (no AVX2 integer ops).
+	mxBIBREF("Cephes Math Library, sinf.c, cosf.c");
+	mxFORCEINLINE void VF_SinCos( const VecF& x, VecF &s_, VecF &c_ )
+	{
+		const VecF sign_of_x = VF_AND( x, VF_SIGN_MASK );
+		const VecF abs_x = VF_ABS( x );
+
+		// octant index, rounded up to the even number
+		VecF j = VF_FLOOR( VF_MUL( abs_x, VF_SET( 1.27323954473516f ) ) );	// 4 / PI
+		j = VF_ADD( j, VF_AND( VF_CMPEQ( VF_SUB( j, VF_MUL( VF_FLOOR( VF_MUL( j, VF_SET( 0.5f ) ) ), VF_SET( 2.0f ) ) ), VF_SET( 1.0f ) ), VF_SET( 1.0f ) ) );
+
+		// extended precision modular arithmetic: r = abs_x - j * PI/4, r in [-PI/4..+PI/4]
+		VecF r = VF_MADD( j, VF_SET( -0.78515625f ), abs_x );
+		r = VF_MADD( j, VF_SET( -2.4187564849853515625e-4f ), r );
+		r = VF_MADD( j, VF_SET( -3.77489497744594108e-8f ), r );
+
+		// quadrant in {0,2,4,6}
+		const VecF q = VF_SUB( j, VF_MUL( VF_FLOOR( VF_MUL( j, VF_SET( 0.125f ) ) ), VF_SET( 8.0f ) ) );
+
+		const VecF z = VF_MUL( r, r );
+
+		VecF poly_cos = VF_SET( 2.443315711809948e-5f );
+		poly_cos = VF_MADD( poly_cos, z, VF_SET( -1.388731625493765e-3f ) );
+		poly_cos = VF_MADD( poly_cos, z, VF_SET( 4.166664568298827e-2f ) );
+		poly_cos = VF_MUL( VF_MUL( poly_cos, z ), z );
+		poly_cos = VF_SUB( poly_cos, VF_MUL( z, VF_SET( 0.5f ) ) );
+		poly_cos = VF_ADD( poly_cos, VF_SET( 1.0f ) );
+
+		VecF poly_sin = VF_SET( -1.9515295891e-4f );
+		poly_sin = VF_MADD( poly_sin, z, VF_SET( 8.3321608736e-3f ) );
+		poly_sin = VF_MADD( poly_sin, z, VF_SET( -1.6666654611e-1f ) );
+		poly_sin = VF_MADD( VF_MUL( poly_sin, z ), r, r );
+
+		// q=0: ( sin, cos); q=2: ( cos,-sin); q=4: (-sin,-cos); q=6: (-cos, sin)
+		const VecF q_mod_4 = VF_SUB( q, VF_MUL( VF_FLOOR( VF_MUL( q, VF_SET( 0.25f ) ) ), VF_SET( 4.0f ) ) );
+		const VecF swap_mask = VF_CMPEQ( q_mod_4, VF_SET( 2.0f ) );
+		const VecF negate_sin = VF_AND( VF_CMPGE( q, VF_SET( 4.0f ) ), VF_SIGN_MASK );
+		const VecF negate_cos = VF_AND( VF_OR( VF_CMPEQ( q, VF_SET( 2.0f ) ), VF_CMPEQ( q, VF_SET( 4.0f ) ) ), VF_SIGN_MASK );
+
+		const VecF s = VF_SELECT( swap_mask, poly_cos, poly_sin );
+		const VecF c = VF_SELECT( swap_mask, poly_sin, poly_cos );
+
+		s_ = VF_XOR( s, VF_XOR( negate_sin, sign_of_x ) );	// sin(-x) = -sin(x)
+		c_ = VF_XOR( c, negate_cos );						// cos(-x) = cos(x)
+	}
+
+	/// Applies the kernel to all points; the last (incomplete) SIMD vector is padded.
+	/// KERNEL must have "VecF operator() ( const VecF& x, const VecF& y, const VecF& z ) const".
+	template< class KERNEL >
+	void ProcessPoints(
+		const KERNEL& kernel,
+		const F32* xs, const F32* ys, const F32* zs,
+		F32 *distances_,
+		const UINT count
+		)
+	{
+		UINT i = 0;
+		for( ; i + LANES <= count; i += LANES )
+		{
+			VF_STORE( distances_ + i, kernel( VF_LOAD( xs + i ), VF_LOAD( ys + i ), VF_LOAD( zs + i ) ) );
+		}
+
+		const UINT remaining = count - i;
+		if( remaining )
+		{
+			F32	tx[LANES], ty[LANES], tz[LANES], td[LANES];
+			for( UINT k = 0; k < LANES; k++ )
+			{
+				// replicate the last point to avoid garbage (NaNs/denormals) in unused lanes
+				const UINT src = i + smallest( k, remaining - 1 );
+				tx[k] = xs[ src ];
+				ty[k] = ys[ src ];
+				tz[k] = zs[ src ];
+			}
+			VF_STORE( td, kernel( VF_LOAD( tx ), VF_LOAD( ty ), VF_LOAD( tz ) ) );
+			for( UINT k = 0; k < remaining; k++ ) {
+				distances_[ i + k ] = td[ k ];
+			}
+		}
+	}
+
+	/// Combines two arrays of distances in-place: a = op( a, b ).
+	/// OP must have "VecF operator() ( const VecF& a, const VecF& b ) const".
+	template< class OP >
+	void CombineDistances(
+		const OP& op,
+		F32 *a_,
+		const F32* b,
+		const UINT count
+		)
+	{
+		UINT i = 0;
+		for( ; i + LANES <= count; i += LANES )
+		{
+			VF_STORE( a_ + i, op( VF_LOAD( a_ + i ), VF_LOAD( b + i ) ) );
+		}
+		for( ; i < count; i++ )
+		{
+			F32	ta[LANES] = {0}, tb[LANES] = {0};
+			ta[0] = a_[i];
+			tb[0] = b[i];
+			VF_STORE( ta, op( VF_LOAD( ta ), VF_LOAD( tb ) ) );
+			a_[i] = ta[0];
+		}
+	}
+
+	/// Evaluates a binary CSG operation in chunks: out = op( A(p), B(p) ).
+	template< class OP >
+	void EvaluateBinaryOperation(
+		const OP& op,
+		const Isosurface* A, const Isosurface* B,
+		const F32* xs, const F32* ys, const F32* zs,
+		F32 *distances_,
+		const UINT count
+		)
+	{
+		F32	temp[ CHUNK_SIZE ];
+
+		for( UINT start = 0; start < count; start += CHUNK_SIZE )
+		{
+			const UINT num = smallest( count - start, (UINT)CHUNK_SIZE );
+			A->DistanceToBatch( xs + start, ys + start, zs + start, distances_ + start, num );
+			B->DistanceToBatch( xs + start, ys + start, zs + start, temp, num );
+			CombineDistances( op, distances_ + start, temp, num );
+		}
+	}
+
+	//
+	// primitive kernels
+	//
+
+	struct PlaneKernel
+	{
+		VecF	nx, ny, nz, d;
+	public:
+		PlaneKernel( const V4f& plane )
+		{
+			nx = VF_SET( plane.x );
+			ny = VF_SET( plane.y );
+			nz = VF_SET( plane.z );
+			d = VF_SET( plane.w );
+		}
+		mxFORCEINLINE VecF operator() ( const VecF& x, const VecF& y, const VecF& z ) const
+		{
+			return VF_MADD( nx, x, VF_MADD( ny, y, VF_MADD( nz, z, d ) ) );
+		}
+	};
+
+	struct SlabKernel
+	{
+		PlaneKernel	plane;
+		VecF		thickness;
+	public:
+		SlabKernel( const V4f& _plane, F32 _thickness )
+			: plane( _plane )
+		{
+			thickness = VF_SET( _thickness );
+		}
+		mxFORCEINLINE VecF operator() ( const VecF& x, const VecF& y, const VecF& z ) const
+		{
+			return VF_SUB( VF_ABS( plane( x, y, z ) ), thickness );
+		}
+	};
+
+	struct SphereKernel
+	{
+		VecF	cx, cy, cz, radius;
+		VecF	sign;	//!< -0 to invert the sphere
+	public:
+		SphereKernel( const V3f& center, F32 _radius, bool inverted )
+		{
+			cx = VF_SET( center.x );
+			cy = VF_SET( center.y );
+			cz = VF_SET( center.z );
+			radius = VF_SET( _radius );
+			sign = VF_SET( inverted ? -0.0f : 0.0f );
+		}
+		mxFORCEINLINE VecF operator() ( const VecF& x, const VecF& y, const VecF& z ) const
+		{
+			const VecF length = VF_Length3( VF_SUB( x, cx ), VF_SUB( y, cy ), VF_SUB( z, cz ) );
+			return VF_XOR( VF_SUB( length, radius ), sign );
+		}
+	};
+
+	/// Chebyshev distance to an axis-aligned box
+	struct BoxKernel
+	{
+		VecF	cx, cy, cz;
+		VecF	ex, ey, ez;
+	public:
+		BoxKernel( const V3f& center, const V3f& extent )
+		{
+			cx = VF_SET( center.x );
+			cy = VF_SET( center.y );
+			cz = VF_SET( center.z );
+			ex = VF_SET( extent.x );
+			ey = VF_SET( extent.y );
+			ez = VF_SET( extent.z );
+		}
+		mxFORCEINLINE VecF operator() ( const VecF& x, const VecF& y, const VecF& z ) const
+		{
+			return VF_Max3(
+				VF_SUB( VF_ABS( VF_SUB( x, cx ) ), ex ),
+				VF_SUB( VF_ABS( VF_SUB( y, cy ) ), ey ),
+				VF_SUB( VF_ABS( VF_SUB( z, cz ) ), ez )
+				);
+		}
+	};
+
+	struct CylinderKernel
+	{
+		VecF	ox, oy, oz;
+		VecF	dx, dy, dz;
+		VecF	radius;
+		VecF	height;	//!< +INF for infinite cylinders
+	public:
+		CylinderKernel( const V3f& origin, const V3f& direction, F32 _radius, F32 _height )
+		{
+			mxASSERT(V3_IsNormalized(direction));
+			ox = VF_SET( origin.x );
+			oy = VF_SET( origin.y );
+			oz = VF_SET( origin.z );
+			dx = VF_SET( direction.x );
+			dy = VF_SET( direction.y );
+			dz = VF_SET( direction.z );
+			radius = VF_SET( _radius );
+			height = VF_SET( _height );
+		}
+		mxFORCEINLINE VecF operator() ( const VecF& x, const VecF& y, const VecF& z ) const
+		{
+			const VecF rx = VF_SUB( x, ox );
+			const VecF ry = VF_SUB( y, oy );
+			const VecF rz = VF_SUB( z, oz );
+			// project onto the axis, see Ray_ClosestPoint()
+			const VecF t = VF_MADD( rx, dx, VF_MADD( ry, dy, VF_MUL( rz, dz ) ) );
+			const VecF distance_to_axis = VF_Length3(
+				VF_SUB( rx, VF_MUL( dx, t ) ),
+				VF_SUB( ry, VF_MUL( dy, t ) ),
+				VF_SUB( rz, VF_MUL( dz, t ) )
+				);
+			// the cap distance is measured along Z, as in Cylinder::DistanceTo()
+			const VecF distance_to_cap = VF_SUB( VF_ABS( rz ), height );
+			return VF_MAX( VF_SUB( distance_to_axis, radius ), distance_to_cap );
+		}
+	};
+
+	struct TorusKernel
+	{
+		VecF	cx, cy, cz;
+		VecF	diameter, thickness;
+	public:
+		TorusKernel( const V3f& center, F32 _diameter, F32 _thickness )
+		{
+			cx = VF_SET( center.x );
+			cy = VF_SET( center.y );
+			cz = VF_SET( center.z );
+			diameter = VF_SET( _diameter );
+			thickness = VF_SET( _thickness );
+		}
+		mxFORCEINLINE VecF operator() ( const VecF& x, const VecF& y, const VecF& z ) const
+		{
+			const VecF px = VF_SUB( x, cx );
+			const VecF py = VF_SUB( y, cy );
+			const VecF pz = VF_SUB( z, cz );
+			const VecF qx = VF_SUB( VF_SQRT( VF_MADD( px, px, VF_MUL( py, py ) ) ), diameter );
+			return VF_SUB( VF_SQRT( VF_MADD( qx, qx, VF_MUL( pz, pz ) ) ), thickness );
+		}
+	};
+
+	struct GyroidKernel
+	{
+		VecF	sx, sy, sz;
+	public:
+		GyroidKernel( const V3f& scale )
+		{
+			sx = VF_SET( scale.x );
+			sy = VF_SET( scale.y );
+			sz = VF_SET( scale.z );
+		}
+		mxFORCEINLINE VecF operator() ( const VecF& x, const VecF& y, const VecF& z ) const
+		{
+			VecF sin_x, cos_x, sin_y, cos_y, sin_z, cos_z;
+			VF_SinCos( VF_MUL( x, sx ), sin_x, cos_x );
+			VF_SinCos( VF_MUL( y, sy ), sin_y, cos_y );
+			VF_SinCos( VF_MUL( z, sz ), sin_z, cos_z );
+			const VecF sum = VF_MADD( cos_x, sin_y, VF_MADD( cos_y, sin_z, VF_MUL( cos_z, sin_x ) ) );
+			return VF_ADD( sum, sum );
+		}
+	};
+
+	//
+	// CSG operators
+	//
+
+	struct MinOp
+	{
+		mxFORCEINLINE VecF operator() ( const VecF& a, const VecF& b ) const
+		{
+			return VF_MIN( a, b );
+		}
+	};
+	struct MaxOp
+	{
+		mxFORCEINLINE VecF operator() ( const VecF& a, const VecF& b ) const
+		{
+			return VF_MAX( a, b );
+		}
+	};
+	struct SubtractOp
+	{
+		mxFORCEINLINE VecF operator() ( const VecF& a, const VecF& b ) const
+		{
+			return VF_MAX( a, VF_NEGATE( b ) );
+		}
+	};
+	struct BlendOp
+	{
+		VecF	weightA, weightB;
+	public:
+		BlendOp( F32 _weightA, F32 _weightB )
+		{
+			weightA = VF_SET( _weightA );
+			weightB = VF_SET( _weightB );
+		}
+		mxFORCEINLINE VecF operator() ( const VecF& a, const VecF& b ) const
+		{
+			return VF_MADD( a, weightA, VF_MUL( b, weightB ) );
+		}
+	};
+
+	/// Transforms positions into the local space of the operand and evaluates it in chunks.
+	/// TRANSFORM must have "void operator() ( const F32* xs, const F32* ys, const F32* zs, F32 *local_xs, F32 *local_ys, F32 *local_zs, UINT count ) const".
+	template< class TRANSFORM >
+	void EvaluateInLocalSpace(
+		const TRANSFORM& transform,
+		const Isosurface* O,
+		const F32* xs, const F32* ys, const F32* zs,
+		F32 *distances_,
+		const UINT count
+		)
+	{
+		F32	local_xs[ CHUNK_SIZE ];
+		F32	local_ys[ CHUNK_SIZE ];
+		F32	local_zs[ CHUNK_SIZE ];
+
+		for( UINT start = 0; start < count; start += CHUNK_SIZE )
+		{
+			const UINT num = smallest( count - start, (UINT)CHUNK_SIZE );
+			transform( xs + start, ys + start, zs + start, local_xs, local_ys, local_zs, num );
+			O->DistanceToBatch( local_xs, local_ys, local_zs, distances_ + start, num );
+		}
+	}
+
+	/// p' = p * M (rows 0..2 are axes, row 3 is translation)
+	struct AffineTransform
+	{
+		VecF	m[4][3];
+	public:
+		AffineTransform( const V3f& r0, const V3f& r1, const V3f& r2, const V3f& r3 )
+		{
+			const V3f* rows[4] = { &r0, &r1, &r2, &r3 };
+			for( int i = 0; i < 4; i++ ) {
+				m[i][0] = VF_SET( rows[i]->x );
+				m[i][1] = VF_SET( rows[i]->y );
+				m[i][2] = VF_SET( rows[i]->z );
+			}
+		}
+		void operator() (
+			const F32* xs, const F32* ys, const F32* zs,
+			F32 *local_xs, F32 *local_ys, F32 *local_zs,
+			const UINT count
+			) const
+		{
+			// CHUNK_SIZE is a multiple of LANES, so it's safe to process whole vectors
+			for( UINT i = 0; i < count; i += LANES )
+			{
+				const UINT remaining = count - i;
+				VecF x, y, z;
+				if( remaining >= LANES ) {
+					x = VF_LOAD( xs + i );
+					y = VF_LOAD( ys + i );
+					z = VF_LOAD( zs + i );
+				} else {
+					F32	tx[LANES] = {0}, ty[LANES] = {0}, tz[LANES] = {0};
+					for( UINT k = 0; k < remaining; k++ ) {
+						tx[k] = xs[ i + k ];
+						ty[k] = ys[ i + k ];
+						tz[k] = zs[ i + k ];
+					}
+					x = VF_LOAD( tx );
+					y = VF_LOAD( ty );
+					z = VF_LOAD( tz );
+				}
+				VF_STORE( local_xs + i, VF_MADD( m[0][0], x, VF_MADD( m[1][0], y, VF_MADD( m[2][0], z, m[3][0] ) ) ) );
+				VF_STORE( local_ys + i, VF_MADD( m[0][1], x, VF_MADD( m[1][1], y, VF_MADD( m[2][1], z, m[3][1] ) ) ) );
+				VF_STORE( local_zs + i, VF_MADD( m[0][2], x, VF_MADD( m[1][2], y, VF_MADD( m[2][2], z, m[3][2] ) ) ) );
+			}
+		}
+	};
+
+}//namespace
+
+/*
+-----------------------------------------------------------------------------
+	Isosurface
+-----------------------------------------------------------------------------
+*/
+void Isosurface::DistanceToBatch(
+	const F32* xs, const F32* ys, const F32* zs,
+	F32 *distances_,
+	const UINT count
+) const
+{
+	for( UINT i = 0; i < count; i++ )
+	{
+		distances_[i] = this->DistanceTo( V3_Set( xs[i], ys[i], zs[i] ) );
+	}
+}
+
+/*
+-----------------------------------------------------------------------------
+	Primitives
+-----------------------------------------------------------------------------
+*/
+void HalfSpace::DistanceToBatch( const F32* xs, const F32* ys, const F32* zs, F32 *distances_, const UINT count ) const
+{
+	ProcessPoints( PlaneKernel( plane ), xs, ys, zs, distances_, count );
+}
+
+void Slab::DistanceToBatch( const F32* xs, const F32* ys, const F32* zs, F32 *distances_, const UINT count ) const
+{
+	ProcessPoints( SlabKernel( plane, thickness ), xs, ys, zs, distances_, count );
+}
+
+void Sphere::DistanceToBatch( const F32* xs, const F32* ys, const F32* zs, F32 *distances_, const UINT count ) const
+{
+	ProcessPoints( SphereKernel( center, radius, false ), xs, ys, zs, distances_, count );
+}
+
+void InvertedSphere::DistanceToBatch( const F32* xs, const F32* ys, const F32* zs, F32 *distances_, const UINT count ) const
+{
+	ProcessPoints( SphereKernel( center, radius, true ), xs, ys, zs, distances_, count );
+}
+
+void Cube::DistanceToBatch( const F32* xs, const F32* ys, const F32* zs, F32 *distances_, const UINT count ) const
+{
+	ProcessPoints( BoxKernel( center, V3_SetAll( extent ) ), xs, ys, zs, distances_, count );
+}
+
+void Box::DistanceToBatch( const F32* xs, const F32* ys, const F32* zs, F32 *distances_, const UINT count ) const
+{
+	ProcessPoints( BoxKernel( center, extent ), xs, ys, zs, distances_, count );
+}
+
+void InfiniteCylinder::DistanceToBatch( const F32* xs, const F32* ys, const F32* zs, F32 *distances_, const UINT count ) const
+{
+	ProcessPoints( CylinderKernel( ray_origin, ray_direction, radius, BIG_NUMBER ), xs, ys, zs, distances_, count );
+}
+
+void Cylinder::DistanceToBatch( const F32* xs, const F32* ys, const F32* zs, F32 *distances_, const UINT count ) const
+{
+	ProcessPoints( CylinderKernel( ray_origin, ray_direction, radius, height ), xs, ys, zs, distances_, count );
+}
+
+void Torus::DistanceToBatch( const F32* xs, const F32* ys, const F32* zs, F32 *distances_, const UINT count ) const
+{
+	ProcessPoints( TorusKernel( center, diameter, thickness ), xs, ys, zs, distances_, count );
+}
+
+void Gyroid::DistanceToBatch( const F32* xs, const F32* ys, const F32* zs, F32 *distances_, const UINT count ) const
+{
+	ProcessPoints( GyroidKernel( scale ), xs, ys, zs, distances_, count );
+}
+
+void Transform::DistanceToBatch( const F32* xs, const F32* ys, const F32* zs, F32 *distances_, const UINT count ) const
+{
+	const AffineTransform	transform(
+		V4_As_V3( worldToLocal.v0 ),
+		V4_As_V3( worldToLocal.v1 ),
+		V4_As_V3( worldToLocal.v2 ),
+		V4_As_V3( worldToLocal.v3 )
+		);
+	EvaluateInLocalSpace( transform, O, xs, ys, zs, distances_, count );
+}
+
+/*
+-----------------------------------------------------------------------------
+	CSG
+-----------------------------------------------------------------------------
+*/
+namespace CSG
+{
+	void Negation::DistanceToBatch( const F32* xs, const F32* ys, const F32* zs, F32 *distances_, const UINT count ) const
+	{
+		O->DistanceToBatch( xs, ys, zs, distances_, count );
+		for( UINT i = 0; i < count; i++ ) {
+			distances_[i] = -distances_[i];
+		}
+	}
+
+	void Union::DistanceToBatch( const F32* xs, const F32* ys, const F32* zs, F32 *distances_, const UINT count ) const
+	{
+		EvaluateBinaryOperation( MinOp(), A, B, xs, ys, zs, distances_, count );
+	}
+
+	void Difference::DistanceToBatch( const F32* xs, const F32* ys, const F32* zs, F32 *distances_, const UINT count ) const
+	{
+		EvaluateBinaryOperation( SubtractOp(), A, B, xs, ys, zs, distances_, count );
+	}
+
+	void UnionMulti::DistanceToBatch( const F32* xs, const F32* ys, const F32* zs, F32 *distances_, const UINT count ) const
+	{
+		const UINT num_arguments = this->arguments.num();
+		if( !num_arguments )
+		{
+			for( UINT i = 0; i < count; i++ ) {
+				distances_[i] = BIG_NUMBER;
+			}
+			return;
+		}
+
+		F32	temp[ CHUNK_SIZE ];
+
+		for( UINT start = 0; start < count; start += CHUNK_SIZE )
+		{
+			const UINT num = smallest( count - start, (UINT)CHUNK_SIZE );
+
+			this->arguments[0]->DistanceToBatch( xs + start, ys + start, zs + start, distances_ + start, num );
+
+			for( UINT iArg = 1; iArg < num_arguments; iArg++ )
+			{
+				this->arguments[ iArg ]->DistanceToBatch( xs + start, ys + start, zs + start, temp, num );
+				CombineDistances( MinOp(), distances_ + start, temp, num );
+			}
+		}
+	}
+
+	void Intersection::DistanceToBatch( const F32* xs, const F32* ys, const F32* zs, F32 *distances_, const UINT count ) const
+	{
+		EvaluateBinaryOperation( MaxOp(), A, B, xs, ys, zs, distances_, count );
+	}
+
+	void Blend::DistanceToBatch( const F32* xs, const F32* ys, const F32* zs, F32 *distances_, const UINT count ) const
+	{
+		EvaluateBinaryOperation( BlendOp( blendA, blendB ), A, B, xs, ys, zs, distances_, count );
+	}
+
+	void CSG_AddOffset::DistanceToBatch( const F32* xs, const F32* ys, const F32* zs, F32 *distances_, const UINT count ) const
+	{
+		O->DistanceToBatch( xs, ys, zs, distances_, count );
+		for( UINT i = 0; i < count; i++ ) {
+			distances_[i] += offset;
+		}
+	}
+
+	void Offset::DistanceToBatch( const F32* xs, const F32* ys, const F32* zs, F32 *distances_, const UINT count ) const
+	{
+		const AffineTransform	translation(
+			V3_Set( 1, 0, 0 ),
+			V3_Set( 0, 1, 0 ),
+			V3_Set( 0, 0, 1 ),
+			offset
+			);
+		EvaluateInLocalSpace( translation, O, xs, ys, zs, distances_, count );
+	}
+
+	void CSG_Rotate::DistanceToBatch( const F32* xs, const F32* ys, const F32* zs, F32 *distances_, const UINT count ) const
+	{
+		const AffineTransform	rotation(
+			matrix.r0,
+			matrix.r1,
+			matrix.r2,
+			V3_Zero()
+			);
+		EvaluateInLocalSpace( rotation, O, xs, ys, zs, distances_, count );
+	}
+
+}//namespace CSG
+
+}//namespace SDF
+
+
+/*
+-----------------------------------------------------------------------------
+	UNIT TESTS
+-----------------------------------------------------------------------------
+*/
+#if MX_DEVELOPER
+
+namespace SDF
+{
+
+ERet Benchmark_DistanceToBatch(
+	AllocatorI & allocator
+	, const U32 resolution
+	)
+{
+	mxASSERT(resolution > 0);
+
+	// build a composite scene which exercises all batched primitives and operators
+	const F32 scene_size = 100.0f;
+
+	Sphere	sphere;
+	sphere.center = V3_SetAll( scene_size * 0.5f );
+	sphere.radius = scene_size * 0.3f;
+
+	Box		box;
+	box.center = V3_SetAll( scene_size * 0.5f );
+	box.extent = V3_Set( 0.4f, 0.25f, 0.2f ) * scene_size;
+
+	Cylinder	cylinder;
+	cylinder.ray_origin = V3_SetAll( scene_size * 0.5f );
+	cylinder.ray_direction = V3_Normalized( V3_Set( 0.3f, 0.1f, 1.0f ) );
+	cylinder.radius = scene_size * 0.1f;
+	cylinder.height = scene_size * 0.45f;
+
+	Torus	torus;
+	torus.center = V3_Set( 0.5f, 0.5f, 0.8f ) * scene_size;
+	torus.diameter = scene_size * 0.3f;
+	torus.thickness = scene_size * 0.05f;
+
+	Gyroid	gyroid;
+	gyroid.scale = V3_SetAll( 0.2f );
+
+	HalfSpace	ground;
+	ground.plane = V4f::set( V3_UP, -scene_size * 0.1f );
+
+	CSG::Difference	box_minus_cylinder;
+	box_minus_cylinder.A = &box;
+	box_minus_cylinder.B = &cylinder;
+
+	CSG::Intersection	porous_sphere;
+	porous_sphere.A = &sphere;
+	porous_sphere.B = &gyroid;
+
+	CSG::Offset	shifted_torus;
+	shifted_torus.O = &torus;
+	shifted_torus.offset = V3_Set( 0, 0, -scene_size * 0.1f );
+
+	CSG::UnionMulti	scene;
+	scene.arguments.add( &box_minus_cylinder );
+	scene.arguments.add( &porous_sphere );
+	scene.arguments.add( &shifted_torus );
+	scene.arguments.add( &ground );
+
+	//
+	const U32 num_samples = resolution * resolution * resolution;
+	const F32 step = scene_size / resolution;
+
+	F32 *	reference_distances;
+	mxTRY_ALLOC_SCOPED( reference_distances, num_samples, allocator );
+
+	F32 *	batched_distances;
+	mxTRY_ALLOC_SCOPED( batched_distances, num_samples, allocator );
+
+	// one row of samples along X per batch call
+	F32 *	row_xs;
+	mxTRY_ALLOC_SCOPED( row_xs, resolution, allocator );
+	F32 *	row_ys;
+	mxTRY_ALLOC_SCOPED( row_ys, resolution, allocator );
+	F32 *	row_zs;
+	mxTRY_ALLOC_SCOPED( row_zs, resolution, allocator );
+
+	for( U32 iX = 0; iX < resolution; iX++ ) {
+		row_xs[ iX ] = iX * step;
+	}
+
+	ScopedTimer	timer;
+
+	for( U32 iZ = 0; iZ < resolution; iZ++ )
+	{
+		for( U32 iY = 0; iY < resolution; iY++ )
+		{
+			F32 * dst = reference_distances + (iZ * resolution + iY) * resolution;
+			for( U32 iX = 0; iX < resolution; iX++ )
+			{
+				dst[ iX ] = scene.DistanceTo( V3_Set( row_xs[ iX ], iY * step, iZ * step ) );
+			}
+		}
+	}
+	const U32 scalar_msec = timer.ElapsedMilliseconds();
+
+	timer.Reset();
+	for( U32 iZ = 0; iZ < resolution; iZ++ )
+	{
+		for( U32 iY = 0; iY < resolution; iY++ )
+		{
+			for( U32 iX = 0; iX < resolution; iX++ ) {
+				row_ys[ iX ] = iY * step;
+				row_zs[ iX ] = iZ * step;
+			}
+			F32 * dst = batched_distances + (iZ * resolution + iY) * resolution;
+			scene.DistanceToBatch( row_xs, row_ys, row_zs, dst, resolution );
+		}
+	}
+	const U32 batched_msec = timer.ElapsedMilliseconds();
+
+	F32	max_error = 0;
+	for( U32 i = 0; i < num_samples; i++ )
+	{
+		max_error = maxf( max_error, mmAbs( reference_distances[i] - batched_distances[i] ) );
+	}
+
+	ptPRINT("SDF batch: %u^3 samples, %u-wide SIMD: scalar: %u msec, batched: %u msec (%.2f Msamples/sec), max error: %f\n",
+		resolution, (U32)LANES,
+		scalar_msec, batched_msec,
+		batched_msec ? (num_samples / 1000.0f) / batched_msec : 0.0f,
+		max_error
+		);
+
+	// the gyroid's sin/cos approximation is the only source of differences
+	mxENSURE( max_error < 1e-3f, ERR_UNKNOWN_ERROR, "batched SDF evaluation differs from the scalar one" );
+
+	return ALL_OK;
+}
+
+}//namespace SDF
+
+#endif // MX_DEVELOPER
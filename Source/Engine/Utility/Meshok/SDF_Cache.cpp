@@ -0,0 +1,435 @@
+// Sparse brick-pool cache of signed distance fields.
+#include "stdafx.h"
+#pragma hdrstop
+
+#include <Core/Util/ScopedTimer.h>
+#include <Meshok/SDF.h>
+#include <Meshok/SDF_Cache.h>
+
+namespace SDF
+{
+
+namespace
+{
+	static mxFORCEINLINE
+	BrickCache::QDist QuantizeDistance( const F32 distance, const F32 inverse_narrow_band )
+	{
+		const F32 normalized = clampf( distance * inverse_narrow_band, -1.0f, +1.0f );
+		return (BrickCache::QDist) mmFloorToInt( normalized * 32767.0f + 0.5f );
+	}
+
+	static mxFORCEINLINE
+	F32 GetBrickSample( const BrickCache::Brick& brick, const UINT x, const UINT y, const UINT z )
+	{
+		return brick.samples[ x + (y + z * BrickCache::BRICK_SAMPLES) * BrickCache::BRICK_SAMPLES ];
+	}
+}//namespace
+
+BrickCache::BrickCache( AllocatorI & allocator )
+	: _cells( allocator )
+	, _pool( allocator )
+{
+	_source = nil;
+	_bounds.clear();
+	_inverse_voxel_size = CV3f(0);
+	_voxel_size = 0;
+	_narrow_band = 0;
+	_inverse_narrow_band = 0;
+	_grid_size = UInt3(0,0,0);
+	_num_bricks_used = 0;
+	mxZERO_OUT(_stats);
+	_num_lookups = 0;
+	_num_cache_misses = 0;
+}
+
+BrickCache::~BrickCache()
+{
+	mxASSERT2(!_source, "Shutdown() must be called");
+}
+
+ERet BrickCache::Initialize(
+	const Isosurface* source
+	, const AABBf& bounds
+	, const Settings& settings
+	)
+{
+	mxASSERT_PTR(source);
+	mxASSERT(settings.voxel_size > 0);
+	mxASSERT(settings.max_bricks > 0);
+
+	_source = source;
+	_bounds = bounds;
+	_voxel_size = settings.voxel_size;
+	_inverse_voxel_size = CV3f( 1.0f / settings.voxel_size );
+
+	const F32 brick_size = BRICK_CELLS * settings.voxel_size;
+	_narrow_band = ( settings.narrow_band > 0 )
+		? settings.narrow_band
+		: brick_size * mxSQRT_3 * 2.0f
+		;
+	_inverse_narrow_band = 1.0f / _narrow_band;
+
+	const V3f bounds_size = bounds.size();
+	_grid_size.x = largest( (U32) ceilf( bounds_size.x / brick_size ), 1u );
+	_grid_size.y = largest( (U32) ceilf( bounds_size.y / brick_size ), 1u );
+	_grid_size.z = largest( (U32) ceilf( bounds_size.z / brick_size ), 1u );
+
+	mxDO(_cells.setCountExactly( _grid_size.x * _grid_size.y * _grid_size.z ));
+
+	// the pool is allocated only once, because other threads can read bricks without locking
+	mxDO(_pool.setCountExactly( settings.max_bricks ));
+
+	mxENSURE(_fill_lock.Initialize(), ERR_UNKNOWN_ERROR, "");
+
+	this->Invalidate();
+
+	return ALL_OK;
+}
+
+void BrickCache::Shutdown()
+{
+	_fill_lock.Shutdown();
+	_cells.clear();
+	_pool.clear();
+	_source = nil;
+}
+
+void BrickCache::Invalidate()
+{
+	for( UINT i = 0; i < _cells.num(); i++ )
+	{
+		_cells[i].brick_index = BRICK_NOT_FILLED;
+		_cells[i].coarse_distance = 0;
+	}
+	_num_bricks_used = 0;
+	mxZERO_OUT(_stats);
+	_num_lookups = 0;
+	_num_cache_misses = 0;
+}
+
+void BrickCache::InvalidateRegion( const AABBf& region )
+{
+	// NOTE: the freed bricks are not reused until Invalidate() is called,
+	// so the cells which overflowed the pool will overflow again
+	const F32 inverse_brick_size = 1.0f / ( BRICK_CELLS * _voxel_size );
+	const V3f local_min = ( region.min_corner - _bounds.min_corner ) * inverse_brick_size;
+	const V3f local_max = ( region.max_corner - _bounds.min_corner ) * inverse_brick_size;
+
+	const int min_x = largest( mmFloorToInt( local_min.x ), 0 );
+	const int min_y = largest( mmFloorToInt( local_min.y ), 0 );
+	const int min_z = largest( mmFloorToInt( local_min.z ), 0 );
+	const int max_x = smallest( mmFloorToInt( local_max.x ), (int)_grid_size.x - 1 );
+	const int max_y = smallest( mmFloorToInt( local_max.y ), (int)_grid_size.y - 1 );
+	const int max_z = smallest( mmFloorToInt( local_max.z ), (int)_grid_size.z - 1 );
+
+	SpinWait::Lock	scoped_lock( _fill_lock );
+
+	for( int z = min_z; z <= max_z; z++ ) {
+		for( int y = min_y; y <= max_y; y++ ) {
+			for( int x = min_x; x <= max_x; x++ ) {
+				_cells[ this->GetCellIndex( UInt3(x, y, z) ) ].brick_index = BRICK_NOT_FILLED;
+			}
+		}
+	}
+}
+
+void BrickCache::BakeRegion( const AABBf& region )
+{
+	const F32 inverse_brick_size = 1.0f / ( BRICK_CELLS * _voxel_size );
+	const V3f local_min = ( region.min_corner - _bounds.min_corner ) * inverse_brick_size;
+	const V3f local_max = ( region.max_corner - _bounds.min_corner ) * inverse_brick_size;
+
+	const int min_x = largest( mmFloorToInt( local_min.x ), 0 );
+	const int min_y = largest( mmFloorToInt( local_min.y ), 0 );
+	const int min_z = largest( mmFloorToInt( local_min.z ), 0 );
+	const int max_x = smallest( mmFloorToInt( local_max.x ), (int)_grid_size.x - 1 );
+	const int max_y = smallest( mmFloorToInt( local_max.y ), (int)_grid_size.y - 1 );
+	const int max_z = smallest( mmFloorToInt( local_max.z ), (int)_grid_size.z - 1 );
+
+	for( int z = min_z; z <= max_z; z++ ) {
+		for( int y = min_y; y <= max_y; y++ ) {
+			for( int x = min_x; x <= max_x; x++ ) {
+				this->GetFilledCell( UInt3(x, y, z) );
+			}
+		}
+	}
+}
+
+const BrickCache::Stats BrickCache::GetStats() const
+{
+	Stats	result = _stats;
+	result.num_bricks_filled = _num_bricks_used;
+	result.num_lookups = AtomicLoad( _num_lookups );
+	result.num_cache_misses = AtomicLoad( _num_cache_misses );
+	return result;
+}
+
+AABBf BrickCache::GetLocalBounds() const
+{
+	return _source->GetLocalBounds();
+}
+
+const BrickCache::BrickCell& BrickCache::GetFilledCell( const UInt3& brick_coords ) const
+{
+	BrickCell & cell = _cells[ this->GetCellIndex( brick_coords ) ];
+
+	if( cell.brick_index == BRICK_NOT_FILLED )
+	{
+		SpinWait::Lock	scoped_lock( _fill_lock );
+
+		// another thread could have filled the brick while we were waiting
+		if( cell.brick_index == BRICK_NOT_FILLED ) {
+			this->FillCell_Locked( cell, brick_coords );
+		}
+	}
+
+	// don't read brick samples before the brick index
+	_ReadWriteBarrier();
+
+	return cell;
+}
+
+void BrickCache::FillCell_Locked( BrickCell & cell, const UInt3& brick_coords ) const
+{
+	const F32 brick_size = BRICK_CELLS * _voxel_size;
+	const F32 brick_half_diagonal = brick_size * mxSQRT_3 * 0.5f;
+
+	const V3f brick_min_corner = _bounds.min_corner + V3f::fromXYZ( brick_coords ) * brick_size;
+	const V3f brick_center = brick_min_corner + CV3f( brick_size * 0.5f );
+
+	// Check if the surface can pass through the brick.
+	// Distance fields are 1-Lipschitz: |d(p) - d(c)| <= |p - c|.
+	const F32 center_distance = _source->DistanceTo( brick_center );
+
+	cell.coarse_distance = center_distance;
+
+	if( mmAbs( center_distance ) > brick_half_diagonal + _narrow_band )
+	{
+		_WriteBarrier();
+		cell.brick_index = BRICK_EMPTY;
+		++_stats.num_empty_cells;
+		return;
+	}
+
+	if( _num_bricks_used >= _pool.num() )
+	{
+		// out of memory - mark the cell so that lookups don't take the lock again
+		_WriteBarrier();
+		cell.brick_index = BRICK_OVERFLOW;
+		return;
+	}
+
+	const U32 new_brick_index = _num_bricks_used;
+	Brick & brick = _pool[ new_brick_index ];
+
+	UINT sample_index = 0;
+	for( UINT z = 0; z < BRICK_SAMPLES; z++ )
+	{
+		for( UINT y = 0; y < BRICK_SAMPLES; y++ )
+		{
+			for( UINT x = 0; x < BRICK_SAMPLES; x++ )
+			{
+				const V3f sample_pos = brick_min_corner + CV3f( x, y, z ) * _voxel_size;
+				const F32 distance = _source->DistanceTo( sample_pos );
+				brick.samples[ sample_index++ ] = QuantizeDistance( distance, _inverse_narrow_band );
+			}
+		}
+	}
+
+	// make sure the brick is written before other threads can see its index
+	_WriteBarrier();
+
+	cell.brick_index = new_brick_index;
+	++_num_bricks_used;
+}
+
+F32 BrickCache::DistanceTo( const V3f& _point ) const
+{
+	AtomicIncrement( &_num_lookups );
+
+	if( !_bounds.containsPoint( _point ) )
+	{
+		AtomicIncrement( &_num_cache_misses );
+		return _source->DistanceTo( _point );
+	}
+
+	// position in voxels, relative to the min corner of the cache
+	const V3f local_pos = V3_Multiply( _point - _bounds.min_corner, _inverse_voxel_size );
+
+	const UInt3 max_voxel_coords(
+		_grid_size.x * BRICK_CELLS - 1,
+		_grid_size.y * BRICK_CELLS - 1,
+		_grid_size.z * BRICK_CELLS - 1
+		);
+	const UInt3 voxel_coords(
+		smallest( (U32) local_pos.x, max_voxel_coords.x ),
+		smallest( (U32) local_pos.y, max_voxel_coords.y ),
+		smallest( (U32) local_pos.z, max_voxel_coords.z )
+		);
+
+	const UInt3 brick_coords(
+		voxel_coords.x / BRICK_CELLS,
+		voxel_coords.y / BRICK_CELLS,
+		voxel_coords.z / BRICK_CELLS
+		);
+
+	const BrickCell& cell = this->GetFilledCell( brick_coords );
+	const U32 brick_index = cell.brick_index;
+
+	if( brick_index == BRICK_EMPTY )
+	{
+		// conservative bound, the sign is constant in the whole brick
+		const F32 brick_size = BRICK_CELLS * _voxel_size;
+		const V3f brick_center = _bounds.min_corner
+			+ V3f::fromXYZ( brick_coords ) * brick_size
+			+ CV3f( brick_size * 0.5f )
+			;
+		const F32 distance_to_center = V3_Length( _point - brick_center );
+		const F32 bound = mmAbs( cell.coarse_distance ) - distance_to_center;
+		return ( cell.coarse_distance > 0 ) ? bound : -bound;
+	}
+
+	if( brick_index == BRICK_OVERFLOW )
+	{
+		AtomicIncrement( &_num_cache_misses );
+		return _source->DistanceTo( _point );
+	}
+
+	const Brick& brick = _pool[ brick_index ];
+
+	// the cell inside the brick and the fractional position within the cell
+	const UINT x0 = voxel_coords.x - brick_coords.x * BRICK_CELLS;
+	const UINT y0 = voxel_coords.y - brick_coords.y * BRICK_CELLS;
+	const UINT z0 = voxel_coords.z - brick_coords.z * BRICK_CELLS;
+
+	const F32 tx = clampf( local_pos.x - voxel_coords.x, 0, 1 );
+	const F32 ty = clampf( local_pos.y - voxel_coords.y, 0, 1 );
+	const F32 tz = clampf( local_pos.z - voxel_coords.z, 0, 1 );
+
+	// trilinear interpolation
+	const F32 d000 = GetBrickSample( brick, x0  , y0  , z0   );
+	const F32 d100 = GetBrickSample( brick, x0+1, y0  , z0   );
+	const F32 d010 = GetBrickSample( brick, x0  , y0+1, z0   );
+	const F32 d110 = GetBrickSample( brick, x0+1, y0+1, z0   );
+	const F32 d001 = GetBrickSample( brick, x0  , y0  , z0+1 );
+	const F32 d101 = GetBrickSample( brick, x0+1, y0  , z0+1 );
+	const F32 d011 = GetBrickSample( brick, x0  , y0+1, z0+1 );
+	const F32 d111 = GetBrickSample( brick, x0+1, y0+1, z0+1 );
+
+	const F32 d00 = d000 + (d100 - d000) * tx;
+	const F32 d10 = d010 + (d110 - d010) * tx;
+	const F32 d01 = d001 + (d101 - d001) * tx;
+	const F32 d11 = d011 + (d111 - d011) * tx;
+
+	const F32 d0 = d00 + (d10 - d00) * ty;
+	const F32 d1 = d01 + (d11 - d01) * ty;
+
+	const F32 quantized_distance = d0 + (d1 - d0) * tz;
+
+	return quantized_distance * ( _narrow_band / 32767.0f );
+}
+
+}//namespace SDF
+
+
+/*
+-----------------------------------------------------------------------------
+	UNIT TESTS
+-----------------------------------------------------------------------------
+*/
+#if MX_DEVELOPER
+
+namespace SDF
+{
+
+ERet Benchmark_BrickCache(
+	const Isosurface* scene
+	, const AABBf& scene_bounds
+	, AllocatorI & allocator
+	, const U32 image_width
+	, const U32 image_height
+	)
+{
+	const U32 num_pixels = image_width * image_height;
+
+	float *	reference_image;
+	mxTRY_ALLOC_SCOPED( reference_image, num_pixels, allocator );
+
+	float *	cached_image;
+	mxTRY_ALLOC_SCOPED( cached_image, num_pixels, allocator );
+
+	// look at the scene from a corner
+	const V3f scene_center = scene_bounds.center();
+	const V3f camera_position = scene_bounds.max_corner + scene_bounds.size() * 0.25f;
+	const V3f camera_forward = V3_Normalized( scene_center - camera_position );
+	const V3f camera_right = V3_Normalized( V3_Cross( camera_forward, V3_UP ) );
+	const V3f camera_up = V3_Cross( camera_right, camera_forward );
+	const F32 far_plane = V3_Length( scene_bounds.size() ) * 2.0f;
+
+	//
+	BrickCache::Settings	settings;
+	settings.voxel_size = V3_Length( scene_bounds.size() ) / 512.0f;
+	settings.max_bricks = 64*1024;	// 64 MiB
+
+	BrickCache	cache( allocator );
+	mxDO(cache.Initialize( scene, scene_bounds, settings ));
+
+	ScopedTimer	timer;
+
+	RayTraceImage( scene
+		, camera_position, camera_forward, camera_right, camera_up
+		, far_plane, DEG2RAD(45), float(image_width) / float(image_height)
+		, image_width, image_height
+		, reference_image
+		);
+	const U32 reference_msec = timer.ElapsedMilliseconds();
+
+	// the first pass fills the bricks
+	timer.Reset();
+	RayTraceImage( &cache
+		, camera_position, camera_forward, camera_right, camera_up
+		, far_plane, DEG2RAD(45), float(image_width) / float(image_height)
+		, image_width, image_height
+		, cached_image
+		);
+	const U32 cold_cache_msec = timer.ElapsedMilliseconds();
+
+	// the second pass only reads the bricks
+	timer.Reset();
+	RayTraceImage( &cache
+		, camera_position, camera_forward, camera_right, camera_up
+		, far_plane, DEG2RAD(45), float(image_width) / float(image_height)
+		, image_width, image_height
+		, cached_image
+		);
+	const U32 warm_cache_msec = timer.ElapsedMilliseconds();
+
+	// compare hit times
+	F32	max_error = 0;
+	F32	sum_error = 0;
+	for( U32 i = 0; i < num_pixels; i++ )
+	{
+		const F32 error = mmAbs( reference_image[i] - cached_image[i] );
+		max_error = maxf( max_error, error );
+		sum_error += error;
+	}
+
+	const BrickCache::Stats stats = cache.GetStats();
+
+	ptPRINT("SDF brick cache: %ux%u image: direct: %u msec, cold cache: %u msec, warm cache: %u msec;"
+		" %u bricks (%u KiB), %u empty cells, %u misses; avg error: %f, max error: %f",
+		image_width, image_height,
+		reference_msec, cold_cache_msec, warm_cache_msec,
+		stats.num_bricks_filled, stats.num_bricks_filled * sizeof(BrickCache::Brick) / mxKIBIBYTE,
+		stats.num_empty_cells, stats.num_cache_misses,
+		sum_error / num_pixels, max_error
+		);
+
+	cache.Shutdown();
+
+	return ALL_OK;
+}
+
+}//namespace SDF
+
+#endif // MX_DEVELOPER
@@ -0,0 +1,170 @@
+// Sparse brick-pool cache of signed distance fields.
+#pragma once
+
+#include <Utility/Meshok/SDF.h>
+
+
+namespace SDF
+{
+	/// Bakes any Isosurface into a sparse pool of bricks with quantized distances
+	/// inside a narrow band around the surface.
+	/// Bricks are filled lazily on first access; distances are reconstructed with trilinear interpolation.
+	/// Composite SDFs are expensive to evaluate, so repeated meshing and ray marching
+	/// over the same region becomes memory-bound instead of compute-bound.
+	///
+	/// Trilinear reconstruction is not a lower bound: near edges, corners and concave features
+	/// the returned distances can overestimate the distances of the source isosurface
+	/// by up to the voxel diagonal (voxel_size * sqrt(3)) plus the quantization error,
+	/// so sphere tracing through the cache must stop at that distance from the surface (or shorten its steps).
+	/// Lazy brick filling is thread-safe; the pool memory is allocated once and never moves.
+	class BrickCache : public Isosurface
+	{
+	public:
+		/// samples per brick side; neighboring bricks share one layer of samples
+		/// so that trilinear lookups never cross brick boundaries
+		enum { BRICK_SAMPLES = 8 };
+		enum { BRICK_CELLS = BRICK_SAMPLES - 1 };
+		enum { SAMPLES_PER_BRICK = BRICK_SAMPLES * BRICK_SAMPLES * BRICK_SAMPLES };
+
+		/// quantized distances, [-1..+1] maps to [-narrow_band..+narrow_band]
+		typedef I16 QDist;
+
+		struct Brick
+		{
+			QDist	samples[ SAMPLES_PER_BRICK ];	// X-major: x + y*8 + z*64
+		};
+		ASSERT_SIZEOF(Brick, 1024);
+
+		struct Settings
+		{
+			/// the distance between neighboring samples, in world units
+			F32		voxel_size;
+
+			/// distances are stored only within [-narrow_band .. +narrow_band]
+			/// and are clamped to this range; 0 = 2 * brick diagonal
+			F32		narrow_band;
+
+			/// the maximum number of resident bricks (limits memory usage: 1 KiB per brick)
+			U32		max_bricks;
+
+		public:
+			Settings()
+			{
+				voxel_size = 1;
+				narrow_band = 0;
+				max_bricks = 16*1024;
+			}
+		};
+
+		struct Stats
+		{
+			U32	num_bricks_filled;	//!< resident bricks
+			U32	num_empty_cells;	//!< brick cells entirely outside the narrow band
+			U32	num_lookups;
+			U32	num_cache_misses;	//!< lookups falling back to the source isosurface (outside bounds/pool exhausted)
+		};
+
+	public:
+		BrickCache( AllocatorI & allocator );
+		~BrickCache();
+
+		ERet Initialize(
+			const Isosurface* source
+			, const AABBf& bounds	//!< the cached region
+			, const Settings& settings = Settings()
+			);
+		void Shutdown();
+
+		/// Fills all bricks overlapping the given box (e.g. before multithreaded meshing).
+		void BakeRegion( const AABBf& region );
+
+		/// Discards all bricks (e.g. after the source SDF has been edited).
+		void Invalidate();
+
+		/// Discards the bricks overlapping the given box.
+		void InvalidateRegion( const AABBf& region );
+
+		const Stats GetStats() const;
+
+	public:	// Isosurface
+		virtual F32 DistanceTo( const V3f& _point ) const override;
+		virtual AABBf GetLocalBounds() const override;
+
+	private:
+		/// 'top-level' grid cell
+		struct BrickCell
+		{
+			/// index into the brick pool or one of the special values
+			U32	brick_index;
+
+			/// if the cell is outside the narrow band:
+			/// conservative distance bound (signed) valid in the whole cell
+			F32	coarse_distance;
+		};
+
+		enum
+		{
+			/// the brick has not been evaluated yet
+			BRICK_NOT_FILLED = ~0u,
+
+			/// the brick is too far from the surface - use 'coarse_distance'
+			BRICK_EMPTY = ~1u,
+
+			/// the pool was exhausted - evaluate the source isosurface directly (without locking)
+			BRICK_OVERFLOW = ~2u,
+		};
+
+		const BrickCell& GetFilledCell( const UInt3& brick_coords ) const;
+		void FillCell_Locked( BrickCell & cell, const UInt3& brick_coords ) const;
+
+		UINT GetCellIndex( const UInt3& brick_coords ) const
+		{
+			return brick_coords.x + (brick_coords.y + brick_coords.z * _grid_size.y) * _grid_size.x;
+		}
+
+	private:
+		const Isosurface *		_source;
+		AABBf					_bounds;
+		V3f						_inverse_voxel_size;
+		F32						_voxel_size;
+		F32						_narrow_band;
+		F32						_inverse_narrow_band;
+		UInt3					_grid_size;	//!< in bricks
+
+		mutable DynamicArray< BrickCell >	_cells;
+		mutable DynamicArray< Brick >		_pool;	//!< preallocated, never grows
+		mutable U32							_num_bricks_used;
+		mutable SpinWait					_fill_lock;
+
+		mutable Stats			_stats;	//!< updated under _fill_lock
+
+		// updated by DistanceTo() from any thread
+		mutable AtomicInt		_num_lookups;
+		mutable AtomicInt		_num_cache_misses;
+	};
+
+}//namespace SDF
+
+
+/*
+-----------------------------------------------------------------------------
+	UNIT TESTS
+-----------------------------------------------------------------------------
+*/
+
+#if MX_DEVELOPER
+
+namespace SDF
+{
+	/// Ray traces the given scene twice through the cache and once directly,
+	/// measures the speedup and the maximum distance error.
+	ERet Benchmark_BrickCache(
+		const Isosurface* scene
+		, const AABBf& scene_bounds
+		, AllocatorI & allocator
+		, const U32 image_width = 256
+		, const U32 image_height = 256
+		);
+}//namespace SDF
+
+#endif // MX_DEVELOPER
@@ -14,6 +14,7 @@ namespace Meshok
 		unsigned int hits, misses;
 		float hit_percent, miss_percent;
 		float acmr; //!< average cache miss ratio = transformed vertices / triangle count
+		float atvr; //!< average transformed vertex ratio = transformed vertices / vertex count, 1.0 is optimal
 	};
 
 	template< typename INDEX_TYPE >
@@ -51,6 +52,7 @@ namespace Meshok
 		_result.miss_percent = 100 * static_cast<float>(_result.misses) / _indexCount;
 
 		_result.acmr = static_cast<float>(_result.misses) / (_indexCount / 3);
+		_result.atvr = static_cast<float>(_result.misses) / _vertexount;
 
 		return ALL_OK;
 	}
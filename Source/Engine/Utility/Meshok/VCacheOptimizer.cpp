@@ -0,0 +1,857 @@
+#include "stdafx.h"
+#pragma hdrstop
+
+#include <algorithm>	// std::sort()
+
+#include <Base/Math/Random.h>
+#include <Meshok/VCacheOptimizer.h>
+
+
+namespace Meshok
+{
+
+namespace
+{
+	/// vertex -> triangles
+	struct TriangleAdjacency
+	{
+		DynamicArray< U32 >	counts;
+		DynamicArray< U32 >	offsets;
+		DynamicArray< U32 >	triangles;
+	public:
+		TriangleAdjacency( AllocatorI & allocator )
+			: counts( allocator ), offsets( allocator ), triangles( allocator )
+		{}
+
+		ERet Build( const U32* indices, const U32 index_count, const U32 vertex_count )
+		{
+			mxDO(counts.setNum( vertex_count ));
+			mxDO(offsets.setNum( vertex_count ));
+			mxDO(triangles.setNum( index_count ));
+
+			counts.setAll( 0 );
+			for( U32 i = 0; i < index_count; i++ ) {
+				mxASSERT( indices[i] < vertex_count );
+				counts[ indices[i] ]++;
+			}
+
+			U32 offset = 0;
+			for( U32 v = 0; v < vertex_count; v++ ) {
+				offsets[v] = offset;
+				offset += counts[v];
+			}
+
+			// use the counts as write cursors and restore them afterwards
+			counts.setAll( 0 );
+			for( U32 i = 0; i < index_count; i++ ) {
+				const U32 v = indices[i];
+				triangles[ offsets[v] + counts[v]++ ] = i / 3;
+			}
+			return ALL_OK;
+		}
+	};
+
+	namespace Forsyth
+	{
+		/// the size of the modelled LRU cache, the algorithm is not sensitive to it
+		enum { CACHE_SIZE = 32 };
+		enum { MAX_VALENCE = 32 };	// for precomputed valence scores
+
+		const float LAST_TRIANGLE_SCORE = 0.75f;
+		const float CACHE_DECAY_POWER = 1.5f;
+		const float VALENCE_BOOST_SCALE = 2.0f;
+		const float VALENCE_BOOST_POWER = 0.5f;
+
+		struct ScoreTables
+		{
+			float	cache[ CACHE_SIZE ];
+			float	valence[ MAX_VALENCE ];
+		public:
+			ScoreTables()
+			{
+				for( int i = 0; i < CACHE_SIZE; i++ )
+				{
+					if( i < 3 ) {
+						// the vertices of the last triangle get a fixed score,
+						// so that the algorithm doesn't prefer using them for the next triangle
+						cache[i] = LAST_TRIANGLE_SCORE;
+					} else {
+						const float scaler = 1.0f / ( CACHE_SIZE - 3 );
+						cache[i] = powf( 1.0f - ( i - 3 ) * scaler, CACHE_DECAY_POWER );
+					}
+				}
+				valence[0] = 0;
+				for( int i = 1; i < MAX_VALENCE; i++ ) {
+					valence[i] = VALENCE_BOOST_SCALE * powf( float(i), -VALENCE_BOOST_POWER );
+				}
+			}
+
+			float VertexScore( const int cache_position, const U32 remaining_triangles ) const
+			{
+				if( !remaining_triangles ) {
+					return -1.0f;	// no triangles left, never used again
+				}
+				float score = ( cache_position >= 0 ) ? cache[ cache_position ] : 0.0f;
+				// boost the vertices with few remaining triangles to get rid of lone triangles
+				score += ( remaining_triangles < MAX_VALENCE )
+					? valence[ remaining_triangles ]
+					: VALENCE_BOOST_SCALE * powf( float(remaining_triangles), -VALENCE_BOOST_POWER )
+					;
+				return score;
+			}
+		};
+	}//namespace Forsyth
+
+}//namespace
+
+ERet OptimizeVertexCache_Forsyth(
+	U32 *dst_indices_
+	, const U32* src_indices
+	, const U32 index_count
+	, const U32 vertex_count
+	, AllocatorI & scratchpad
+	)
+{
+	mxASSERT( index_count % 3 == 0 );
+	mxASSERT( dst_indices_ != src_indices );
+
+	const U32 triangle_count = index_count / 3;
+	if( !triangle_count ) {
+		return ALL_OK;
+	}
+
+	static const Forsyth::ScoreTables s_scores;
+
+	TriangleAdjacency	adjacency( scratchpad );
+	mxDO(adjacency.Build( src_indices, index_count, vertex_count ));
+
+	// the number of not yet emitted triangles is kept in 'adjacency.counts',
+	// emitted triangles are swapped to the end of each vertex's list
+
+	DynamicArray< float >	vertex_scores( scratchpad );
+	DynamicArray< int >		cache_positions( scratchpad );
+	mxDO(vertex_scores.setNum( vertex_count ));
+	mxDO(cache_positions.setNum( vertex_count ));
+
+	DynamicArray< float >	triangle_scores( scratchpad );
+	DynamicArray< U8 >		triangle_emitted( scratchpad );
+	mxDO(triangle_scores.setNum( triangle_count ));
+	mxDO(triangle_emitted.setNum( triangle_count ));
+	triangle_emitted.setAll( 0 );
+
+	for( U32 v = 0; v < vertex_count; v++ )
+	{
+		cache_positions[v] = -1;
+		vertex_scores[v] = s_scores.VertexScore( -1, adjacency.counts[v] );
+	}
+
+	U32 best_triangle = 0;
+	float best_score = -1.0f;
+
+	for( U32 t = 0; t < triangle_count; t++ )
+	{
+		const U32* tri = src_indices + t * 3;
+		const float score = vertex_scores[ tri[0] ] + vertex_scores[ tri[1] ] + vertex_scores[ tri[2] ];
+		triangle_scores[t] = score;
+		if( score > best_score ) {
+			best_score = score;
+			best_triangle = t;
+		}
+	}
+
+	// +3 for the vertices pushed out of the cache by the new triangle
+	U32	cache[ Forsyth::CACHE_SIZE + 3 ];
+	U32	new_cache[ Forsyth::CACHE_SIZE + 3 ];
+	U32	cache_count = 0;
+
+	U32	next_unemitted_triangle = 0;	// for finding a new triangle if the cache is empty
+
+	for( U32 output_triangle = 0; output_triangle < triangle_count; output_triangle++ )
+	{
+		if( best_triangle == ~0u )
+		{
+			// the neighborhood of the cache is exhausted - take any remaining triangle
+			while( triangle_emitted[ next_unemitted_triangle ] ) {
+				next_unemitted_triangle++;
+			}
+			best_triangle = next_unemitted_triangle;
+		}
+
+		const U32* tri = src_indices + best_triangle * 3;
+		dst_indices_[ output_triangle*3 + 0 ] = tri[0];
+		dst_indices_[ output_triangle*3 + 1 ] = tri[1];
+		dst_indices_[ output_triangle*3 + 2 ] = tri[2];
+		triangle_emitted[ best_triangle ] = 1;
+
+		// remove the triangle from the adjacency lists of its vertices
+		for( UINT k = 0; k < 3; k++ )
+		{
+			const U32 v = tri[k];
+			U32* vertex_triangles = adjacency.triangles.raw() + adjacency.offsets[v];
+			const U32 remaining = adjacency.counts[v];
+			for( U32 i = 0; i < remaining; i++ )
+			{
+				if( vertex_triangles[i] == best_triangle ) {
+					TSwap( vertex_triangles[i], vertex_triangles[ remaining - 1 ] );
+					break;
+				}
+			}
+			adjacency.counts[v]--;
+		}
+
+		// push the triangle's vertices to the front of the LRU cache
+		U32 new_cache_count = 0;
+		new_cache[ new_cache_count++ ] = tri[0];
+		new_cache[ new_cache_count++ ] = tri[1];
+		new_cache[ new_cache_count++ ] = tri[2];
+		for( U32 i = 0; i < cache_count; i++ )
+		{
+			const U32 v = cache[i];
+			if( v != tri[0] && v != tri[1] && v != tri[2] ) {
+				new_cache[ new_cache_count++ ] = v;
+			}
+		}
+
+		// update the scores of the vertices in the cache (and of those which were pushed out of it)
+		best_triangle = ~0u;
+		best_score = -1.0f;
+
+		for( U32 i = 0; i < new_cache_count; i++ )
+		{
+			const U32 v = new_cache[i];
+			const int cache_position = ( i < Forsyth::CACHE_SIZE ) ? int(i) : -1;
+			cache_positions[v] = cache_position;
+
+			const float new_score = s_scores.VertexScore( cache_position, adjacency.counts[v] );
+			const float score_delta = new_score - vertex_scores[v];
+			vertex_scores[v] = new_score;
+
+			const U32* vertex_triangles = adjacency.triangles.raw() + adjacency.offsets[v];
+			const U32 remaining = adjacency.counts[v];
+			for( U32 j = 0; j < remaining; j++ )
+			{
+				const U32 t = vertex_triangles[j];
+				const float score = triangle_scores[t] + score_delta;
+				triangle_scores[t] = score;
+				if( score > best_score ) {
+					best_score = score;
+					best_triangle = t;
+				}
+			}
+		}
+
+		cache_count = smallest( new_cache_count, (U32)Forsyth::CACHE_SIZE );
+		memcpy( cache, new_cache, cache_count * sizeof(cache[0]) );
+	}
+
+	return ALL_OK;
+}
+
+ERet OptimizeVertexCache_Tipsify(
+	U32 *dst_indices_
+	, const U32* src_indices
+	, const U32 index_count
+	, const U32 vertex_count
+	, const U32 cache_size
+	, AllocatorI & scratchpad
+	, DynamicArray< U32 > *hard_boundaries_
+	)
+{
+	mxASSERT( index_count % 3 == 0 );
+	mxASSERT( dst_indices_ != src_indices );
+	mxASSERT( cache_size >= 3 );
+
+	const U32 triangle_count = index_count / 3;
+	if( !triangle_count ) {
+		return ALL_OK;
+	}
+
+	TriangleAdjacency	adjacency( scratchpad );
+	mxDO(adjacency.Build( src_indices, index_count, vertex_count ));
+
+	// the number of not yet emitted triangles using each vertex
+	DynamicArray< U32 >	live_triangles( scratchpad );
+	mxDO(live_triangles.setNum( vertex_count ));
+	memcpy( live_triangles.raw(), adjacency.counts.raw(), vertex_count * sizeof(U32) );
+
+	DynamicArray< U32 >	cache_time_stamps( scratchpad );
+	mxDO(cache_time_stamps.setNum( vertex_count ));
+	cache_time_stamps.setAll( 0 );
+
+	DynamicArray< U8 >	triangle_emitted( scratchpad );
+	mxDO(triangle_emitted.setNum( triangle_count ));
+	triangle_emitted.setAll( 0 );
+
+	// recently referenced vertices for fallback
+	DynamicArray< U32 >	dead_end_stack( scratchpad );
+	mxDO(dead_end_stack.reserve( index_count ));
+
+	// the vertices of the triangles emitted around the current fanning vertex
+	DynamicArray< U32 >	candidates( scratchpad );
+
+	// start with the first referenced vertex, so that the first hard cluster is never empty
+	U32	current_vertex = 0;
+	while( !live_triangles[ current_vertex ] ) {
+		current_vertex++;
+	}
+
+	U32	time_stamp = cache_size + 1;
+	U32	input_cursor = current_vertex + 1;	// the next vertex to try when the dead-end stack is empty
+	U32	output_triangle = 0;
+
+	if( hard_boundaries_ ) {
+		mxDO(hard_boundaries_->add( 0 ));
+	}
+
+	while( current_vertex != ~0u )
+	{
+		candidates.RemoveAll();
+
+		// emit all remaining triangles around the fanning vertex
+		const U32* vertex_triangles = adjacency.triangles.raw() + adjacency.offsets[ current_vertex ];
+		const U32 num_vertex_triangles = adjacency.counts[ current_vertex ];
+
+		for( U32 i = 0; i < num_vertex_triangles; i++ )
+		{
+			const U32 t = vertex_triangles[i];
+			if( triangle_emitted[t] ) {
+				continue;
+			}
+
+			const U32* tri = src_indices + t * 3;
+			for( UINT k = 0; k < 3; k++ )
+			{
+				const U32 v = tri[k];
+				dst_indices_[ output_triangle*3 + k ] = v;
+
+				mxDO(dead_end_stack.add( v ));
+				mxDO(candidates.add( v ));
+
+				live_triangles[v]--;
+
+				if( time_stamp - cache_time_stamps[v] > cache_size ) {
+					cache_time_stamps[v] = time_stamp++;	// cache miss
+				}
+			}
+
+			triangle_emitted[t] = 1;
+			output_triangle++;
+		}
+
+		// select the next fanning vertex: the one which will still be in the cache after emitting its triangles
+		U32 next_vertex = ~0u;
+		int best_priority = -1;
+
+		for( U32 i = 0; i < candidates.num(); i++ )
+		{
+			const U32 v = candidates[i];
+			if( live_triangles[v] )
+			{
+				int priority = 0;
+				const U32 age = time_stamp - cache_time_stamps[v];
+				// each triangle adds at most two new vertices into the cache
+				if( age + 2 * live_triangles[v] <= cache_size ) {
+					priority = int( age );
+				}
+				if( priority > best_priority ) {
+					best_priority = priority;
+					next_vertex = v;
+				}
+			}
+		}
+
+		if( next_vertex == ~0u )
+		{
+			// a dead end: try the recently referenced vertices first
+			while( dead_end_stack.num() )
+			{
+				const U32 v = dead_end_stack.PopLastValue();
+				if( live_triangles[v] ) {
+					next_vertex = v;
+					break;
+				}
+			}
+
+			if( next_vertex == ~0u )
+			{
+				// a non-local jump: continue with the next vertex in the input order
+				while( input_cursor < vertex_count )
+				{
+					const U32 v = input_cursor++;
+					if( live_triangles[v] ) {
+						next_vertex = v;
+						break;
+					}
+				}
+
+				if( hard_boundaries_ && next_vertex != ~0u ) {
+					mxDO(hard_boundaries_->add( output_triangle ));
+				}
+			}
+		}
+
+		current_vertex = next_vertex;
+	}
+
+	mxASSERT( output_triangle == triangle_count );
+	return ALL_OK;
+}
+
+namespace
+{
+	/// a contiguous range of triangles rendered together
+	struct TriangleCluster
+	{
+		F32	sort_key;	//!< the higher the key, the more likely the cluster occludes others
+		U32	first_triangle;
+		U32	num_triangles;
+	public:
+		bool operator < ( const TriangleCluster& other ) const
+		{
+			return ( sort_key > other.sort_key )
+				|| ( sort_key == other.sort_key && first_triangle < other.first_triangle )
+				;
+		}
+	};
+
+	/// Splits the hard clusters produced by Tipsify into smaller ones
+	/// at positions where the ACMR of the prefix doesn't exceed 'threshold' times the ACMR of the whole cluster.
+	ERet SplitClusters(
+		const U32* indices
+		, const U32 triangle_count
+		, const U32 vertex_count
+		, const DynamicArray< U32 >& hard_boundaries
+		, const U32 cache_size
+		, const F32 threshold
+		, AllocatorI & scratchpad
+		, DynamicArray< TriangleCluster > &clusters_
+		)
+	{
+		DynamicArray< U32 >	cache_time_stamps( scratchpad );
+		mxDO(cache_time_stamps.setNum( vertex_count ));
+
+		for( U32 hard_cluster = 0; hard_cluster < hard_boundaries.num(); hard_cluster++ )
+		{
+			const U32 start = hard_boundaries[ hard_cluster ];
+			const U32 end = ( hard_cluster + 1 < hard_boundaries.num() ) ? hard_boundaries[ hard_cluster + 1 ] : triangle_count;
+			mxASSERT( start < end );
+
+			// measure the ACMR of the whole hard cluster, starting with a cold cache
+			cache_time_stamps.setAll( 0 );
+			U32 time_stamp = cache_size + 1;
+			U32 cluster_misses = 0;
+
+			for( U32 i = start * 3; i < end * 3; i++ )
+			{
+				const U32 v = indices[i];
+				if( time_stamp - cache_time_stamps[v] > cache_size ) {
+					cache_time_stamps[v] = time_stamp++;
+					cluster_misses++;
+				}
+			}
+
+			const F32 cluster_acmr = F32( cluster_misses ) / F32( end - start );
+			const F32 max_acmr = cluster_acmr * threshold;
+
+			// simulate the cache again and start a new soft cluster as soon as its ACMR is low enough
+			cache_time_stamps.setAll( 0 );
+			time_stamp = cache_size + 1;
+
+			U32 cluster_start = start;
+			U32 misses = 0;
+
+			for( U32 t = start; t < end; t++ )
+			{
+				for( UINT k = 0; k < 3; k++ )
+				{
+					const U32 v = indices[ t*3 + k ];
+					if( time_stamp - cache_time_stamps[v] > cache_size ) {
+						cache_time_stamps[v] = time_stamp++;
+						misses++;
+					}
+				}
+
+				const U32 num_triangles = t + 1 - cluster_start;
+				if( t + 1 < end && F32( misses ) <= max_acmr * F32( num_triangles ) )
+				{
+					const TriangleCluster cluster = { 0, cluster_start, num_triangles };
+					mxDO(clusters_.add( cluster ));
+
+					// the new cluster starts with a cold cache
+					cluster_start = t + 1;
+					misses = 0;
+					time_stamp += cache_size + 1;
+				}
+			}
+
+			const TriangleCluster last_cluster = { 0, cluster_start, end - cluster_start };
+			mxDO(clusters_.add( last_cluster ));
+		}
+
+		return ALL_OK;
+	}
+
+}//namespace
+
+ERet OptimizeVertexCacheAndOverdraw(
+	U32 *dst_indices_
+	, const U32* src_indices
+	, const U32 index_count
+	, const V3f* positions
+	, const U32 vertex_count
+	, const U32 cache_size
+	, const F32 threshold
+	, AllocatorI & scratchpad
+	)
+{
+	mxASSERT( index_count % 3 == 0 );
+	mxASSERT( dst_indices_ != src_indices );
+
+	const U32 triangle_count = index_count / 3;
+	if( !triangle_count ) {
+		return ALL_OK;
+	}
+
+	DynamicArray< U32 >	tipsified( scratchpad );
+	mxDO(tipsified.setNum( index_count ));
+
+	DynamicArray< U32 >	hard_boundaries( scratchpad );
+	mxDO(OptimizeVertexCache_Tipsify(
+		tipsified.raw(), src_indices, index_count, vertex_count, cache_size, scratchpad, &hard_boundaries
+		));
+
+	DynamicArray< TriangleCluster >	clusters( scratchpad );
+	mxDO(SplitClusters(
+		tipsified.raw(), triangle_count, vertex_count, hard_boundaries, cache_size, threshold, scratchpad, clusters
+		));
+
+	// compute the mesh centroid (area-weighted)
+	V3f		mesh_centroid = CV3f(0);
+	F32		mesh_area = 0;
+
+	for( U32 t = 0; t < triangle_count; t++ )
+	{
+		const V3f& a = positions[ tipsified[ t*3 + 0 ] ];
+		const V3f& b = positions[ tipsified[ t*3 + 1 ] ];
+		const V3f& c = positions[ tipsified[ t*3 + 2 ] ];
+		const F32 area = V3_Length( V3_Cross( b - a, c - a ) );
+		mesh_centroid += ( a + b + c ) * area;
+		mesh_area += area;
+	}
+	mesh_centroid = ( mesh_area > 0 ) ? mesh_centroid / ( mesh_area * 3.0f ) : CV3f(0);
+
+	// clusters facing away from the centroid are likely to occlude other clusters and should be drawn first
+	for( U32 i = 0; i < clusters.num(); i++ )
+	{
+		TriangleCluster & cluster = clusters[i];
+
+		V3f		cluster_centroid = CV3f(0);
+		V3f		cluster_normal = CV3f(0);	// area-weighted
+		F32		cluster_area = 0;
+
+		for( U32 t = cluster.first_triangle; t < cluster.first_triangle + cluster.num_triangles; t++ )
+		{
+			const V3f& a = positions[ tipsified[ t*3 + 0 ] ];
+			const V3f& b = positions[ tipsified[ t*3 + 1 ] ];
+			const V3f& c = positions[ tipsified[ t*3 + 2 ] ];
+			const V3f normal = V3_Cross( b - a, c - a );
+			const F32 area = V3_Length( normal );
+			cluster_centroid += ( a + b + c ) * area;
+			cluster_normal += normal;
+			cluster_area += area;
+		}
+
+		if( cluster_area > 0 )
+		{
+			cluster_centroid /= ( cluster_area * 3.0f );
+			F32 normal_length;
+			cluster_normal = V3_Normalized( cluster_normal, normal_length );
+			cluster.sort_key = ( normal_length > 0 ) ? V3_Dot( cluster_centroid - mesh_centroid, cluster_normal ) : 0;
+		}
+	}
+
+	std::sort( clusters.begin(), clusters.end() );
+
+	U32 output_triangle = 0;
+	for( U32 i = 0; i < clusters.num(); i++ )
+	{
+		const TriangleCluster& cluster = clusters[i];
+		memcpy( dst_indices_ + output_triangle * 3
+			, tipsified.raw() + cluster.first_triangle * 3
+			, cluster.num_triangles * 3 * sizeof(U32)
+			);
+		output_triangle += cluster.num_triangles;
+	}
+	mxASSERT( output_triangle == triangle_count );
+
+	return ALL_OK;
+}
+
+U32 OptimizeVertexFetch(
+	U32 *old_to_new_
+	, U32 *indices_
+	, const U32 index_count
+	, const U32 vertex_count
+	)
+{
+	for( U32 v = 0; v < vertex_count; v++ ) {
+		old_to_new_[v] = ~0u;
+	}
+
+	U32 next_vertex = 0;
+	for( U32 i = 0; i < index_count; i++ )
+	{
+		const U32 old_index = indices_[i];
+		mxASSERT( old_index < vertex_count );
+		if( old_to_new_[ old_index ] == ~0u ) {
+			old_to_new_[ old_index ] = next_vertex++;
+		}
+		indices_[i] = old_to_new_[ old_index ];
+	}
+	return next_vertex;
+}
+
+}//namespace Meshok
+
+
+/*
+-----------------------------------------------------------------------------
+	UNIT TESTS
+-----------------------------------------------------------------------------
+*/
+
+#if MX_DEVELOPER
+
+namespace Meshok
+{
+
+namespace
+{
+	struct SampleMesh
+	{
+		DynamicArray< V3f >	positions;
+		DynamicArray< U32 >	indices;
+	public:
+		SampleMesh( AllocatorI & allocator )
+			: positions( allocator ), indices( allocator )
+		{}
+	};
+
+	/// a regular grid with randomly shuffled triangles - the worst case for the vertex cache
+	ERet CreateShuffledGrid( const U32 size, SampleMesh &mesh_ )
+	{
+		mxDO(mesh_.positions.setNum( (size + 1) * (size + 1) ));
+		for( U32 y = 0; y <= size; y++ ) {
+			for( U32 x = 0; x <= size; x++ ) {
+				mesh_.positions[ y * (size + 1) + x ] = CV3f( F32(x), F32(y), 0 );
+			}
+		}
+
+		mxDO(mesh_.indices.setNum( size * size * 6 ));
+		U32* idx = mesh_.indices.raw();
+		for( U32 y = 0; y < size; y++ ) {
+			for( U32 x = 0; x < size; x++ ) {
+				const U32 v00 = y * (size + 1) + x;
+				const U32 v10 = v00 + 1;
+				const U32 v01 = v00 + (size + 1);
+				const U32 v11 = v01 + 1;
+				*idx++ = v00; *idx++ = v10; *idx++ = v11;
+				*idx++ = v00; *idx++ = v11; *idx++ = v01;
+			}
+		}
+
+		NwRandom	rng( 12345 );
+		UInt3* triangles = (UInt3*) mesh_.indices.raw();
+		const U32 triangle_count = mesh_.indices.num() / 3;
+		for( U32 i = triangle_count - 1; i > 0; i-- ) {
+			const U32 j = ( ( rng.RandomInt() << 15 ) | rng.RandomInt() ) % ( i + 1 );
+			TSwap( triangles[i], triangles[j] );
+		}
+		return ALL_OK;
+	}
+
+	/// a closed UV-sphere, for testing overdraw optimization
+	ERet CreateSphere( const U32 rings, const U32 segments, SampleMesh &mesh_ )
+	{
+		mxDO(mesh_.positions.setNum( (rings + 1) * segments ));
+		for( U32 r = 0; r <= rings; r++ )
+		{
+			const F32 theta = mxPI * F32(r) / F32(rings);
+			for( U32 s = 0; s < segments; s++ )
+			{
+				const F32 phi = mxTWO_PI * F32(s) / F32(segments);
+				mesh_.positions[ r * segments + s ] = CV3f(
+					mmSin( theta ) * mmCos( phi ),
+					mmSin( theta ) * mmSin( phi ),
+					mmCos( theta )
+					);
+			}
+		}
+
+		mxDO(mesh_.indices.reserve( rings * segments * 6 ));
+		for( U32 r = 0; r < rings; r++ ) {
+			for( U32 s = 0; s < segments; s++ ) {
+				const U32 v00 = r * segments + s;
+				const U32 v10 = r * segments + (s + 1) % segments;
+				const U32 v01 = v00 + segments;
+				const U32 v11 = v10 + segments;
+				mxDO(mesh_.indices.add( v00 )); mxDO(mesh_.indices.add( v01 )); mxDO(mesh_.indices.add( v11 ));
+				mxDO(mesh_.indices.add( v00 )); mxDO(mesh_.indices.add( v11 )); mxDO(mesh_.indices.add( v10 ));
+			}
+		}
+		return ALL_OK;
+	}
+
+	/// rotates the triangle so that the smallest index goes first, preserving the winding
+	UInt3 CanonicalTriangle( const U32* tri )
+	{
+		if( tri[1] < tri[0] && tri[1] < tri[2] ) {
+			return UInt3( tri[1], tri[2], tri[0] );
+		}
+		if( tri[2] < tri[0] && tri[2] < tri[1] ) {
+			return UInt3( tri[2], tri[0], tri[1] );
+		}
+		return UInt3( tri[0], tri[1], tri[2] );
+	}
+
+	bool LessTriangle( const UInt3& a, const UInt3& b )
+	{
+		if( a.x != b.x ) return a.x < b.x;
+		if( a.y != b.y ) return a.y < b.y;
+		return a.z < b.z;
+	}
+
+	/// checks that both index buffers contain the same triangles with the same winding
+	ERet CheckSameTriangles( const U32* a, const U32* b, const U32 index_count, AllocatorI & scratchpad )
+	{
+		const U32 triangle_count = index_count / 3;
+
+		DynamicArray< UInt3 >	sorted_a( scratchpad );
+		DynamicArray< UInt3 >	sorted_b( scratchpad );
+		mxDO(sorted_a.setNum( triangle_count ));
+		mxDO(sorted_b.setNum( triangle_count ));
+
+		for( U32 t = 0; t < triangle_count; t++ ) {
+			sorted_a[t] = CanonicalTriangle( a + t*3 );
+			sorted_b[t] = CanonicalTriangle( b + t*3 );
+		}
+		std::sort( sorted_a.begin(), sorted_a.end(), LessTriangle );
+		std::sort( sorted_b.begin(), sorted_b.end(), LessTriangle );
+
+		for( U32 t = 0; t < triangle_count; t++ ) {
+			mxENSURE( sorted_a[t] == sorted_b[t], ERR_UNKNOWN_ERROR, "triangle %u was lost during reordering", t );
+		}
+		return ALL_OK;
+	}
+
+	ERet TestSampleMesh( const char* name, const SampleMesh& mesh, AllocatorI & scratchpad )
+	{
+		const U32 index_count = mesh.indices.num();
+		const U32 vertex_count = mesh.positions.num();
+		const U32 cache_size = DEFAULT_VCACHE_SIZE;
+
+		PostTransformCacheStatistics	original;
+		mxDO(analyzePostTransformImpl( mesh.indices.raw(), index_count, vertex_count, cache_size, scratchpad, original ));
+
+		DynamicArray< U32 >	optimized( scratchpad );
+		mxDO(optimized.setNum( index_count ));
+
+		PostTransformCacheStatistics	stats;
+
+		// Forsyth
+		mxDO(OptimizeVertexCache_Forsyth( optimized.raw(), mesh.indices.raw(), index_count, vertex_count, scratchpad ));
+		mxDO(CheckSameTriangles( mesh.indices.raw(), optimized.raw(), index_count, scratchpad ));
+		mxDO(analyzePostTransformImpl( optimized.raw(), index_count, vertex_count, cache_size, scratchpad, stats ));
+		ptPRINT("%s: Forsyth: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f", name, original.acmr, stats.acmr, original.atvr, stats.atvr);
+		mxENSURE( stats.acmr < original.acmr, ERR_UNKNOWN_ERROR, "" );
+
+		// Tipsify
+		mxDO(OptimizeVertexCache_Tipsify( optimized.raw(), mesh.indices.raw(), index_count, vertex_count, cache_size, scratchpad ));
+		mxDO(CheckSameTriangles( mesh.indices.raw(), optimized.raw(), index_count, scratchpad ));
+		mxDO(analyzePostTransformImpl( optimized.raw(), index_count, vertex_count, cache_size, scratchpad, stats ));
+		ptPRINT("%s: Tipsify: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f", name, original.acmr, stats.acmr, original.atvr, stats.atvr);
+		mxENSURE( stats.acmr < original.acmr, ERR_UNKNOWN_ERROR, "" );
+
+		const F32 tipsify_acmr = stats.acmr;
+
+		// Tipsify + overdraw
+		const F32 threshold = 1.05f;
+		mxDO(OptimizeVertexCacheAndOverdraw(
+			optimized.raw(), mesh.indices.raw(), index_count, mesh.positions.raw(), vertex_count, cache_size, threshold, scratchpad
+			));
+		mxDO(CheckSameTriangles( mesh.indices.raw(), optimized.raw(), index_count, scratchpad ));
+		mxDO(analyzePostTransformImpl( optimized.raw(), index_count, vertex_count, cache_size, scratchpad, stats ));
+		ptPRINT("%s: Tipsify + overdraw: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f", name, original.acmr, stats.acmr, original.atvr, stats.atvr);
+		mxENSURE( stats.acmr < original.acmr, ERR_UNKNOWN_ERROR, "" );
+		// each cluster starts with a cold cache, so the ACMR can only grow a bit more than the threshold
+		mxENSURE( stats.acmr <= tipsify_acmr * threshold * 1.1f, ERR_UNKNOWN_ERROR, "" );
+
+		// vertex fetch: vertices must be referenced in increasing order
+		DynamicArray< U32 >	remapped( scratchpad );
+		mxDO(remapped.setNum( index_count ));
+		memcpy( remapped.raw(), optimized.raw(), index_count * sizeof(U32) );
+
+		DynamicArray< U32 >	old_to_new( scratchpad );
+		mxDO(old_to_new.setNum( vertex_count ));
+		const U32 new_vertex_count = OptimizeVertexFetch( old_to_new.raw(), remapped.raw(), index_count, vertex_count );
+		mxENSURE( new_vertex_count <= vertex_count, ERR_UNKNOWN_ERROR, "" );
+
+		U32 max_index_so_far = 0;
+		for( U32 i = 0; i < index_count; i++ )
+		{
+			mxENSURE( remapped[i] <= max_index_so_far, ERR_UNKNOWN_ERROR, "vertices must be in the order of first use" );
+			if( remapped[i] == max_index_so_far ) {
+				max_index_so_far++;
+			}
+			mxENSURE( old_to_new[ optimized[i] ] == remapped[i], ERR_UNKNOWN_ERROR, "" );
+		}
+		mxENSURE( max_index_so_far == new_vertex_count, ERR_UNKNOWN_ERROR, "" );
+
+		DynamicArray< V3f >	positions( scratchpad );
+		mxDO(positions.setNum( vertex_count ));
+		memcpy( positions.raw(), mesh.positions.raw(), vertex_count * sizeof(V3f) );
+		mxDO(RemapVertexStream( positions, old_to_new.raw(), new_vertex_count, scratchpad ));
+		for( U32 i = 0; i < index_count; i++ ) {
+			mxENSURE( positions[ remapped[i] ] == mesh.positions[ optimized[i] ], ERR_UNKNOWN_ERROR, "" );
+		}
+
+		return ALL_OK;
+	}
+
+}//namespace
+
+ERet UnitTest_VertexCacheOptimization( AllocatorI & scratchpad )
+{
+	{
+		SampleMesh	grid( scratchpad );
+		mxDO(CreateShuffledGrid( 64, grid ));
+		mxDO(TestSampleMesh( "shuffled grid", grid, scratchpad ));
+	}
+	{
+		SampleMesh	sphere( scratchpad );
+		mxDO(CreateSphere( 48, 96, sphere ));
+		mxDO(TestSampleMesh( "sphere", sphere, scratchpad ));
+	}
+	{
+		// the first vertices are not referenced by any triangle
+		SampleMesh	grid( scratchpad );
+		mxDO(CreateShuffledGrid( 64, grid ));
+		const U32 num_unused_vertices = 3;
+		for( U32 i = 0; i < num_unused_vertices; i++ ) {
+			grid.positions.InsertAt( 0 ) = CV3f(0);
+		}
+		for( U32 i = 0; i < grid.indices.num(); i++ ) {
+			grid.indices[i] += num_unused_vertices;
+		}
+		mxDO(TestSampleMesh( "grid with unused vertices", grid, scratchpad ));
+	}
+	return ALL_OK;
+}
+
+}//namespace Meshok
+
+#endif // MX_DEVELOPER
+
+//--------------------------------------------------------------//
+//				End Of File.									//
+//--------------------------------------------------------------//
@@ -0,0 +1,106 @@
+// Index and vertex reordering for the post-transform vertex cache, overdraw and vertex fetch.
+#pragma once
+
+#include <Utility/Meshok/VCacheAnalyzer.h>
+
+namespace Meshok
+{
+	/// the size of the FIFO cache used for optimization and analysis
+	enum { DEFAULT_VCACHE_SIZE = 16 };
+
+	mxBIBREF("Tom Forsyth. Linear-Speed Vertex Cache Optimisation, 2006");
+	/// Greedy triangle reordering, doesn't depend on the exact cache size and usually gives the best ACMR.
+	ERet OptimizeVertexCache_Forsyth(
+		U32 *dst_indices_
+		, const U32* src_indices
+		, const U32 index_count
+		, const U32 vertex_count
+		, AllocatorI & scratchpad
+		);
+
+	mxBIBREF("Pedro V. Sander, Diego Nehab, Joshua Barczak. Fast Triangle Reordering for Vertex Locality and Reduced Overdraw, SIGGRAPH 2007");
+	/// Tipsify: fans around vertices, faster than Forsyth's algorithm.
+	ERet OptimizeVertexCache_Tipsify(
+		U32 *dst_indices_
+		, const U32* src_indices
+		, const U32 index_count
+		, const U32 vertex_count
+		, const U32 cache_size
+		, AllocatorI & scratchpad
+		, DynamicArray< U32 > *hard_boundaries_ = nil	//!< [optional] the first triangles of clusters separated by non-local jumps
+		);
+
+	/// Runs Tipsify, splits the result into clusters which keep the ACMR within 'threshold' times the original one,
+	/// and sorts the clusters so that outer, front-facing clusters are rendered first.
+	ERet OptimizeVertexCacheAndOverdraw(
+		U32 *dst_indices_
+		, const U32* src_indices
+		, const U32 index_count
+		, const V3f* positions
+		, const U32 vertex_count
+		, const U32 cache_size
+		, const F32 threshold	//!< e.g. 1.05 allows the ACMR to grow by 5%
+		, AllocatorI & scratchpad
+		);
+
+	/// Renumbers the vertices in the order of first use and rewrites the indices.
+	/// Unreferenced vertices are mapped to ~0. Returns the number of referenced vertices.
+	U32 OptimizeVertexFetch(
+		U32 *old_to_new_
+		, U32 *indices_
+		, const U32 index_count
+		, const U32 vertex_count
+		);
+
+	/// Applies the remap table returned by OptimizeVertexFetch() to a vertex stream.
+	template< typename TYPE >
+	ERet RemapVertexStream(
+		DynamicArray< TYPE > &stream_
+		, const U32* old_to_new
+		, const U32 new_vertex_count
+		, AllocatorI & scratchpad
+		)
+	{
+		const U32 old_vertex_count = stream_.num();
+		if( !old_vertex_count ) {
+			return ALL_OK;
+		}
+
+		DynamicArray< TYPE >	old_stream( scratchpad );
+		mxDO(old_stream.setNum( old_vertex_count ));
+		for( U32 i = 0; i < old_vertex_count; i++ ) {
+			old_stream[i] = stream_[i];
+		}
+
+		mxDO(stream_.setNum( new_vertex_count ));
+		for( U32 i = 0; i < old_vertex_count; i++ ) {
+			if( old_to_new[i] != ~0u ) {
+				stream_[ old_to_new[i] ] = old_stream[i];
+			}
+		}
+		return ALL_OK;
+	}
+
+}//namespace Meshok
+
+
+/*
+-----------------------------------------------------------------------------
+	UNIT TESTS
+-----------------------------------------------------------------------------
+*/
+
+#if MX_DEVELOPER
+
+namespace Meshok
+{
+	/// Runs the optimizers over procedural sample meshes,
+	/// checks that no triangles are lost and that ACMR improves.
+	ERet UnitTest_VertexCacheOptimization( AllocatorI & scratchpad );
+}//namespace Meshok
+
+#endif // MX_DEVELOPER
+
+//--------------------------------------------------------------//
+//				End Of File.									//
+//--------------------------------------------------------------//
@@ -0,0 +1,369 @@
+// Parallel sampling of Hermite data on uniform grids.
+#include "stdafx.h"
+#pragma hdrstop
+
+#include <Core/Tasking/TaskSchedulerInterface.h>
+#include <Core/Util/ScopedTimer.h>
+#include <Meshok/SDF.h>
+#include <Meshok/VolumeSampling.h>
+
+namespace VX
+{
+
+HermiteGrid::HermiteGrid( AllocatorI & allocator )
+	: cornerSigns( allocator )
+	, edges( allocator )
+{
+	numCells = Int3( 0 );
+}
+
+ERet HermiteGrid::Initialize( const Int3& num_cells )
+{
+	mxASSERT( num_cells.x > 0 && num_cells.y > 0 && num_cells.z > 0 );
+
+	numCells = num_cells;
+
+	const U32 numCorners = ( num_cells.x + 1 ) * ( num_cells.y + 1 ) * ( num_cells.z + 1 );
+	mxDO(cornerSigns.setNum( numCorners ));
+	mxDO(edges.setNum( numCorners * 3 ));
+
+	return ALL_OK;
+}
+
+U32 HermiteGrid::getCellSigns( int iCellX, int iCellY, int iCellZ ) const
+{
+	U32 signMask = 0;
+	for( UINT iCorner = 0; iCorner < 8; iCorner++ )
+	{
+		const int iCornerX = ( iCorner & MASK_POS_X ) ? iCellX+1 : iCellX;
+		const int iCornerY = ( iCorner & MASK_POS_Y ) ? iCellY+1 : iCellY;
+		const int iCornerZ = ( iCorner & MASK_POS_Z ) ? iCellZ+1 : iCellZ;
+		signMask |= ( cornerSigns[ getCornerIndex( iCornerX, iCornerY, iCornerZ ) ] << iCorner );
+	}
+	return signMask;
+}
+
+U32 HermiteGrid::getCellHermiteData(
+	int iCellX, int iCellY, int iCellZ
+	, const V3f& gridOrigin
+	, const V3f& cellSize
+	, HermiteDataSample & _sample
+	) const
+{
+	const U32 signMask = this->getCellSigns( iCellX, iCellY, iCellZ );
+	if( vxIS_ZERO_OR_0xFF(signMask) )
+	{
+		return signMask;
+	}
+
+	int numWritten = 0;
+
+	for( UINT iEdge = 0; iEdge < CubeEdgeCount; iEdge++ )
+	{
+		ECubeCorner iCornerA, iCornerB;
+		Cube_Endpoints_from_Edge( (ECubeEdge) iEdge, iCornerA, iCornerB );
+
+		if( !vxIS_ACTIVE_EDGE( signMask, iCornerA, iCornerB ) ) {
+			_sample.edge_remap[ iEdge ] = ~0;
+			continue;
+		}
+
+		const EAxis edgeAxis = EAxis_from_CubeEdge( iEdge );
+
+		const int iCornerX = ( iCornerA & MASK_POS_X ) ? iCellX+1 : iCellX;
+		const int iCornerY = ( iCornerA & MASK_POS_Y ) ? iCellY+1 : iCellY;
+		const int iCornerZ = ( iCornerA & MASK_POS_Z ) ? iCellZ+1 : iCellZ;
+
+		const Edge& edge = edges[ getEdgeIndex( getCornerIndex( iCornerX, iCornerY, iCornerZ ), edgeAxis ) ];
+
+		V3f intersectionPoint = gridOrigin + V3_Multiply( V3f::set( iCornerX, iCornerY, iCornerZ ), cellSize );
+		intersectionPoint[ edgeAxis ] += edge.distance;
+
+		_sample.positions[ numWritten ] = intersectionPoint;
+		_sample.normals[ numWritten ] = edge.normal;
+		_sample.edge_remap[ iEdge ] = numWritten;
+		numWritten++;
+	}
+
+	_sample.num_points = numWritten;
+
+	return signMask;
+}
+
+namespace
+{
+	/// state shared by all brick jobs of SampleHermiteGrid()
+	struct HermiteGridSampler
+	{
+		const AVolumeSampler *	volume;
+		HermiteGrid *	grid;
+		Int3	numBricks;
+		int		brickSize;
+
+	public:
+		/// the number of corners along each side of a brick, incl. the corners shared with the next brick
+		U32 maxCornersPerBrick() const
+		{
+			const U32 brickCorners = brickSize + 1;
+			return brickCorners * brickCorners * brickCorners;
+		}
+
+		void SampleBrick(
+			const int brickIndex
+			, F32 * values	//!< maxCornersPerBrick()
+			, F32 * scratch	//!< 3 * maxCornersPerBrick()
+			) const
+		{
+			const Int3& numCells = grid->numCells;
+
+			const Int3 brickXYZ(
+				brickIndex % numBricks.x,
+				( brickIndex / numBricks.x ) % numBricks.y,
+				brickIndex / ( numBricks.x * numBricks.y )
+				);
+
+			const Int3 cellMin(
+				brickXYZ.x * brickSize,
+				brickXYZ.y * brickSize,
+				brickXYZ.z * brickSize
+				);
+			const Int3 cellEnd(
+				smallest( cellMin.x + brickSize, numCells.x ),
+				smallest( cellMin.y + brickSize, numCells.y ),
+				smallest( cellMin.z + brickSize, numCells.z )
+				);
+
+			// the corners of all cells in the brick
+			const Int3 numCorners(
+				cellEnd.x - cellMin.x + 1,
+				cellEnd.y - cellMin.y + 1,
+				cellEnd.z - cellMin.z + 1
+				);
+
+			volume->SampleCornerValues( cellMin, numCorners, values, scratch );
+
+			// the brick owns the corners at its minimal faces,
+			// the corners at its maximal faces belong to the next brick (if any)
+			const Int3 numOwnedCorners(
+				( cellEnd.x == numCells.x ) ? numCorners.x : numCorners.x - 1,
+				( cellEnd.y == numCells.y ) ? numCorners.y : numCorners.y - 1,
+				( cellEnd.z == numCells.z ) ? numCorners.z : numCorners.z - 1
+				);
+
+			const int strides[3] = { 1, numCorners.x, numCorners.x * numCorners.y };
+
+			for( int iZ = 0; iZ < numOwnedCorners.z; iZ++ )
+			{
+				for( int iY = 0; iY < numOwnedCorners.y; iY++ )
+				{
+					const U32 firstCornerIndex = grid->getCornerIndex( cellMin.x, cellMin.y + iY, cellMin.z + iZ );
+					const F32* rowValues = values + ( iZ * numCorners.y + iY ) * numCorners.x;
+
+					for( int iX = 0; iX < numOwnedCorners.x; iX++ )
+					{
+						const F32 value = rowValues[ iX ];
+						const bool isInside = ( value < 0 );
+
+						const U32 cornerIndex = firstCornerIndex + iX;
+						grid->cornerSigns[ cornerIndex ] = isInside;
+
+						const int localXYZ[3] = { iX, iY, iZ };
+						const int numCornersXYZ[3] = { numCorners.x, numCorners.y, numCorners.z };
+
+						for( UINT iAxis = 0; iAxis < 3; iAxis++ )
+						{
+							// the edge must end inside the brick
+							if( localXYZ[ iAxis ] + 1 >= numCornersXYZ[ iAxis ] ) {
+								continue;
+							}
+
+							const F32 endValue = rowValues[ iX + strides[ iAxis ] ];
+							if( isInside == ( endValue < 0 ) ) {
+								continue;
+							}
+
+							HermiteGrid::Edge &edge = grid->edges[ HermiteGrid::getEdgeIndex( cornerIndex, (EAxis) iAxis ) ];
+							volume->getEdgeIntersectionFromValues(
+								cellMin.x + iX, cellMin.y + iY, cellMin.z + iZ,
+								(EAxis) iAxis,
+								value, endValue,
+								edge.distance, edge.normal
+								);
+						}
+					}
+				}
+			}
+		}
+	};
+
+	class SampleBricksJob: NonCopyable
+	{
+		const HermiteGridSampler& _sampler;
+
+	public:
+		SampleBricksJob( const HermiteGridSampler& sampler )
+			: _sampler( sampler )
+		{
+		}
+
+		ERet Run( const NwThreadContext& context, int start, int end )
+		{
+			AllocatorI &	local_scratchpad = *context.heap;	// thread-local allocator
+
+			const U32 maxCorners = _sampler.maxCornersPerBrick();
+
+			// SoA scratch buffers, reused for all bricks in the range
+			F32 *	values;
+			mxTRY_ALLOC_SCOPED( values, maxCorners, local_scratchpad );
+			F32 *	scratch;
+			mxTRY_ALLOC_SCOPED( scratch, maxCorners * 3, local_scratchpad );
+
+			for( int brickIndex = start; brickIndex < end; brickIndex++ )
+			{
+				_sampler.SampleBrick( brickIndex, values, scratch );
+			}
+			return ALL_OK;
+		}
+	};
+
+}//namespace
+
+ERet SampleHermiteGrid(
+	const AVolumeSampler& _volume
+	, const Int3& num_cells
+	, HermiteGrid &grid_
+	, NwJobSchedulerI & _jobScheduler
+	, const U32 brickSize
+	)
+{
+	mxASSERT( brickSize > 0 );
+
+	mxDO(grid_.Initialize( num_cells ));
+
+	HermiteGridSampler	sampler;
+	sampler.volume = &_volume;
+	sampler.grid = &grid_;
+	sampler.brickSize = brickSize;
+	sampler.numBricks = Int3(
+		( num_cells.x + brickSize - 1 ) / brickSize,
+		( num_cells.y + brickSize - 1 ) / brickSize,
+		( num_cells.z + brickSize - 1 ) / brickSize
+		);
+
+	const U32 numBricks = sampler.numBricks.x * sampler.numBricks.y * sampler.numBricks.z;
+
+	JobID	h_job_sample_bricks;
+	nwCREATE_JOB(h_job_sample_bricks
+		, _jobScheduler
+		, -1, numBricks
+		, JobPriority_High
+		, SampleBricksJob
+		, sampler
+		);
+
+	_jobScheduler.waitFor( h_job_sample_bricks );
+
+	return ALL_OK;
+}
+
+}//namespace VX
+
+/*
+-----------------------------------------------------------------------------
+	UNIT TESTS
+-----------------------------------------------------------------------------
+*/
+#if MX_DEVELOPER
+
+namespace VX
+{
+
+ERet Benchmark_SampleHermiteGrid(
+	NwJobSchedulerI & job_scheduler
+	, AllocatorI & allocator
+	, const U32 resolution
+	)
+{
+	const V3f scene_size = CV3f(100.0f);
+
+	// the test scenes are centered around (-sceneSize * 0.3)
+	const V3f scene_center = -scene_size * 0.3f;
+	const AABBf bounds = AABBf::fromSphere( scene_center, scene_size.x * 0.5f );
+
+	const Int3 num_cells( resolution );
+
+	const SDF::Isosurface* scene = SDF::Testing::GetTestScene( scene_size );
+	const SDF_Sampler	sampler( *scene, bounds, num_cells );
+
+	const V3f cell_size = V3_Divide( bounds.size(), V3f::fromXYZ( num_cells ) );
+
+	// the per-cell path: each cell samples its 8 corners and 12 edges
+	ScopedTimer	timer;
+
+	U32	num_active_cells = 0;
+	for( int iCellZ = 0; iCellZ < num_cells.z; iCellZ++ )
+	{
+		for( int iCellY = 0; iCellY < num_cells.y; iCellY++ )
+		{
+			for( int iCellX = 0; iCellX < num_cells.x; iCellX++ )
+			{
+				HermiteDataSample	sample;
+				const U32 signMask = sampler.SampleHermiteData( iCellX, iCellY, iCellZ, sample );
+				num_active_cells += vxNONTRIVIAL_CELL( signMask );
+			}
+		}
+	}
+	const U32 per_cell_msec = timer.ElapsedMilliseconds();
+
+	timer.Reset();
+	HermiteGrid	grid( allocator );
+	mxDO(SampleHermiteGrid( sampler, num_cells, grid, job_scheduler ));
+	const U32 bricks_msec = timer.ElapsedMilliseconds();
+
+	// compare the results cell by cell
+	U32	num_mismatching_cells = 0;
+	F32	max_position_error = 0;
+
+	for( int iCellZ = 0; iCellZ < num_cells.z; iCellZ++ )
+	{
+		for( int iCellY = 0; iCellY < num_cells.y; iCellY++ )
+		{
+			for( int iCellX = 0; iCellX < num_cells.x; iCellX++ )
+			{
+				HermiteDataSample	reference;
+				const U32 referenceSigns = sampler.SampleHermiteData( iCellX, iCellY, iCellZ, reference );
+
+				HermiteDataSample	sample;
+				const U32 signMask = grid.getCellHermiteData( iCellX, iCellY, iCellZ, bounds.min_corner, cell_size, sample );
+
+				// the batched SDF evaluation can flip the signs of corners lying exactly on the surface
+				if( signMask != referenceSigns ) {
+					num_mismatching_cells++;
+					continue;
+				}
+
+				for( int i = 0; i < sample.num_points; i++ ) {
+					max_position_error = maxf( max_position_error, V3_Length( sample.positions[i] - reference.positions[i] ) );
+				}
+			}
+		}
+	}
+
+	ptPRINT("Hermite grid: %u^3 cells, %u active: per-cell: %u msec, bricks: %u msec (%.2fx), mismatching cells: %u, max position error: %f",
+		resolution, num_active_cells,
+		per_cell_msec, bricks_msec,
+		bricks_msec ? float(per_cell_msec) / bricks_msec : 0.0f,
+		num_mismatching_cells, max_position_error
+		);
+
+	mxENSURE( num_mismatching_cells * 1000 <= num_active_cells, ERR_UNKNOWN_ERROR,
+		"%u cells have different signs", num_mismatching_cells );
+	mxENSURE( max_position_error < V3_Length( cell_size ) * 1e-2f, ERR_UNKNOWN_ERROR,
+		"the intersections differ by %f", max_position_error );
+
+	return ALL_OK;
+}
+
+}//namespace VX
+
+#endif // MX_DEVELOPER
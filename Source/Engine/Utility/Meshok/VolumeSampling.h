@@ -0,0 +1,94 @@
+// Parallel sampling of Hermite data on uniform grids.
+#pragma once
+
+#include <Utility/Meshok/Volumes.h>
+
+class NwJobSchedulerI;
+
+
+namespace VX
+{
+
+/// Hermite data on a uniform grid of cells.
+/// Each corner and each edge of the grid is stored only once
+/// (unlike HermiteDataSample, where the 4 cells around an edge compute the same intersection).
+struct HermiteGrid : NonCopyable
+{
+	/// the intersection of the surface with a grid edge
+	struct Edge
+	{
+		F32	distance;	//!< directed distance from the start corner along the positive axis direction
+		V3f	normal;		//!< unit normal to the surface
+	};
+
+	Int3	numCells;
+
+	/// the signs at the grid corners: 1 if inside, (numCells + 1) corners along each axis, X-major
+	DynamicArray< U8 >		cornerSigns;
+
+	/// 3 edges starting at each corner: along the X, Y and Z axes (see getEdgeIndex()),
+	/// valid only if the signs at the ends of the edge are different
+	DynamicArray< Edge >	edges;
+
+public:
+	HermiteGrid( AllocatorI & allocator );
+
+	ERet Initialize( const Int3& num_cells );
+
+	U32 getCornerIndex( int iCornerX, int iCornerY, int iCornerZ ) const
+	{
+		return ( iCornerZ * ( numCells.y + 1 ) + iCornerY ) * ( numCells.x + 1 ) + iCornerX;
+	}
+
+	static U32 getEdgeIndex( const U32 cornerIndex, const EAxis edgeAxis )
+	{
+		return cornerIndex * 3 + edgeAxis;
+	}
+
+	/// Returns the signs at the cell's corners (Z-order), the same as AVolumeSampler::SampleHermiteData().
+	U32 getCellSigns( int iCellX, int iCellY, int iCellZ ) const;
+
+	/// Returns the same data as AVolumeSampler::SampleHermiteData(),
+	/// the positions are computed as the cell's minimal corner + distance along each active edge.
+	U32 getCellHermiteData(
+		int iCellX, int iCellY, int iCellZ
+		, const V3f& gridOrigin	//!< the position of the corner (0,0,0)
+		, const V3f& cellSize
+		, HermiteDataSample & _sample
+		) const;
+};
+
+/// Splits the grid into bricks of cells and samples them on worker threads:
+/// the corners of each brick are sampled at once into thread-local scratch memory (see AVolumeSampler::SampleCornerValues()),
+/// then the intersections are computed only on the active edges (see AVolumeSampler::getEdgeIntersectionFromValues()).
+/// The corners on the faces between bricks are sampled twice, all other corners and edges are sampled once.
+ERet SampleHermiteGrid(
+	const AVolumeSampler& _volume	//!< must be thread-safe
+	, const Int3& num_cells
+	, HermiteGrid &grid_
+	, NwJobSchedulerI & _jobScheduler
+	, const U32 brickSize = 16	//!< the number of cells along each side of a brick
+	);
+
+}//namespace VX
+
+/*
+-----------------------------------------------------------------------------
+	UNIT TESTS
+-----------------------------------------------------------------------------
+*/
+
+#if MX_DEVELOPER
+
+namespace VX
+{
+	/// Samples an SDF test scene cell by cell with SDF_Sampler::SampleHermiteData() and with SampleHermiteGrid(),
+	/// prints timings and checks that both paths find the same active cells and intersections.
+	ERet Benchmark_SampleHermiteGrid(
+		NwJobSchedulerI & job_scheduler
+		, AllocatorI & allocator
+		, const U32 resolution = 64	//!< the grid has resolution^3 cells
+		);
+}//namespace VX
+
+#endif // MX_DEVELOPER
@@ -24,6 +24,26 @@
 namespace VX
 {
 
+void AVolumeSampler::SampleCornerValues(
+	const Int3& min_corner
+	, const Int3& size
+	, F32 *values_
+	, F32 *scratch_
+) const
+{
+	for( int iZ = 0; iZ < size.z; iZ++ )
+	{
+		for( int iY = 0; iY < size.y; iY++ )
+		{
+			for( int iX = 0; iX < size.x; iX++ )
+			{
+				const bool isInside = this->IsInside( min_corner.x + iX, min_corner.y + iY, min_corner.z + iZ );
+				*values_++ = isInside ? -1.0f : +1.0f;
+			}
+		}
+	}
+}
+
 /// @todo: vectorize and use branchless DDA?: https://www.shadertoy.com/user/fb39ca4/sort=popular&from=0&num=8
 VoxelGridIterator::VoxelGridIterator(
 	/// the start position of the ray
@@ -421,6 +421,31 @@ struct AVolumeSampler
 		return false;
 	}
 
+public:	// Batched sampling (see SampleHermiteGrid()).
+
+	/// Samples a box of grid corners at once: [min_corner, min_corner + size), in X-major order.
+	/// The values must be negative inside the volume and positive outside (e.g. signed distances).
+	/// The default implementation returns -1 or +1 using IsInside().
+	virtual void SampleCornerValues(
+		const Int3& min_corner
+		, const Int3& size
+		, F32 *values_	//!< size.x * size.y * size.z values
+		, F32 *scratch_	//!< 3 * size.x * size.y * size.z floats, e.g. for SoA positions
+	) const;
+
+	/// The same as getEdgeIntersection(), but can use the values (from SampleCornerValues()) at the ends of the edge.
+	virtual bool getEdgeIntersectionFromValues(
+		int iCellX, int iCellY, int iCellZ	//!< the start corner of the edge
+		, const EAxis edgeAxis
+		, const F32 startValue
+		, const F32 endValue
+		, float &distance_
+		, V3f &normal_
+	) const
+	{
+		return this->getEdgeIntersection( iCellX, iCellY, iCellZ, edgeAxis, distance_, normal_ );
+	}
+
 	//virtual bool NeedsSubdivision(
 	//	int iCellX, int iCellY, int iCellZ
 	//) const
@@ -12,6 +12,7 @@
 
 #include <Rendering/Public/Globals.h>	// LargePosition, NwCameraView
 #include <ProcGen/Noise/NwNoiseFunctions.h>
+#include <ProcGen/Noise/NwChunkNoiseCache.h>
 #include <Planets/PlanetsCommon.h>
 #include <Planets/Noise.h>	// HybridMultiFractal
 #include <VoxelsSupport/VoxelTerrainRenderer.h>
@@ -23,28 +24,7 @@
 #include "experimental/game_experimental.h"
 
 
-//struct ProcGenWorldStats
-//{
-//	int		num_noise_octaves_per_LoD[ VX5::ChunkID::NUM_LODs ];
-//
-//public:
-//	ProcGenWorldStats()
-//	{
-//		mxZERO_OUT(*this);
-//	}
-//};
-//
-//class ChunkNoiseCache: NwNonCopyable
-//{
-//public:
-//
-//	struct ChunkNoise
-//	{
-//		//
-//	};
-//
-//public:
-//	ChunkNoiseCache()
-//	{
-//	}
-//};
+/// caches the coarse noise octaves of parent chunks for their children,
+/// keeps per-LoD statistics of octaves saved
+typedef Noise::NwChunkNoiseCache ChunkNoiseCache;
+typedef Noise::NwChunkNoiseStats ProcGenWorldStats;
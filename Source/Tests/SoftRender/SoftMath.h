@@ -5,6 +5,10 @@
 	#include <smmintrin.h>
 #endif // SOFT_RENDER_USE_SSE
 
+#if SOFT_RENDER_USE_AVX
+	#include <immintrin.h>
+#endif // SOFT_RENDER_USE_AVX
+
 
 
 enum { SSE_REG_WIDTH = 4 };
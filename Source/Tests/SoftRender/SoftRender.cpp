@@ -223,6 +223,8 @@ void SoftRenderer::Stats::Reset()
 	numTrianglesRendered = 0;
 	numVertices = 0;
 	numIndices = 0;
+	numTilesRasterized = 0;
+	numBinsRasterized = 0;
 }
 
 const char* ECullMode_To_Chars( ECullMode cullMode )
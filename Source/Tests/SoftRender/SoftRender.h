@@ -16,6 +16,13 @@ class ThreadPool;
 // use SIMD instructions
 #define SOFT_RENDER_USE_SSE		(1)
 
+// use AVX2 for rasterizing tiles (eight pixels at a time)
+#if defined(__AVX2__)
+	#define SOFT_RENDER_USE_AVX		(1)
+#else
+	#define SOFT_RENDER_USE_AVX		(0)
+#endif
+
 // use multiple threads
 #define SOFT_RENDER_ASYNC_JOBS	(1)
 
@@ -25,8 +32,9 @@ class ThreadPool;
 // 1 - transform,clip and rasterize triangles immediately, without buffering.
 #define SOFT_RENDER_USE_IMMEDIATE_RASTERIZATION		(0)
 
-enum { SOFT_RENDER_MAX_WINDOW_WIDTH = 2048 };
-enum { SOFT_RENDER_MAX_WINDOW_HEIGHT = 1024 };
+// enough for 4K (3840 x 2160)
+enum { SOFT_RENDER_MAX_WINDOW_WIDTH = 4096 };
+enum { SOFT_RENDER_MAX_WINDOW_HEIGHT = 2304 };
 
 
 //-------------------------------------------------------------------
@@ -310,6 +318,9 @@ namespace SoftRenderer
 		UINT	numVertices;
 		UINT	numIndices;
 
+		UINT	numTilesRasterized;
+		UINT	numBinsRasterized;	// non-empty bins
+
 	public:
 		void Reset();
 	};
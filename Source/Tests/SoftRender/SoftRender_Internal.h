@@ -154,7 +154,8 @@ mxALIGN_BY_CACHE_LINE struct XTriangle
 	INT32	FPY[3];
  
 	// Cached half edge constants
-	INT32	C1, C2, C3;
+	// (64-bit, because products of 28.4 coordinates overflow 32 bits at 4K resolutions)
+	INT64	C1, C2, C3;
 
 	// Cached screen space bounding box
 	INT32	minX, maxX, minY, maxY;
@@ -26,30 +26,75 @@ float Dbg_Touch__m128( float* address )
 }
 #endif // SOFT_RENDER_DEBUG
 
-static inline
-srTile& AllocateTile( srTileRenderer* renderer )
+srBinningJob::srBinningJob()
+{
+	renderer = nil;
+	indices = nil;
+	numTriangles = 0;
+
+	maxFaces = TRIANGLES_PER_BINNING_JOB * MAX_FACES_PER_CLIPPED_TRIANGLE;
+	faces = (XTriangle*) mxAlloc( maxFaces * sizeof faces[0] );
+	numFaces = 0;
+
+	maxTiles = 2048;
+	tiles = (srTile*) mxAlloc( maxTiles * sizeof tiles[0] );
+	numTiles = 0;
+
+	binOffsets = nil;
+}
+
+srBinningJob::~srBinningJob()
 {
-	const UINT currCapacity = renderer->m_maxTiles;
-	Assert(IsPowerOfTwo(currCapacity));
+	mxFree( faces );
+	mxFree( tiles );
+	mxFree( binOffsets );
+	faces = nil;
+	tiles = nil;
+	binOffsets = nil;
+}
 
-	const UINT newTileIndex = (renderer->m_numTiles++) & (currCapacity-1);//avoid checking for overflow
-	Assert( newTileIndex < currCapacity );
+FORCEINLINE
+srTile& srBinningJob::AllocateTile()
+{
+	if( numTiles == maxTiles )
+	{
+		// grow the tile buffer (only this job's thread touches it)
+		const UINT newMaxTiles = maxTiles * 2;
+		srTile* newTiles = (srTile*) mxAlloc( newMaxTiles * sizeof tiles[0] );
+		MemCopy( newTiles, tiles, numTiles * sizeof tiles[0] );
+		mxFree( tiles );
+		tiles = newTiles;
+		maxTiles = newMaxTiles;
+	}
+	return tiles[ numTiles++ ];
+}
+
+FORCEINLINE
+XTriangle& srBinningJob::AllocateFace( UINT &newFaceIndex )
+{
+	// the face buffer is big enough even if all triangles are clipped into the maximum number of pieces
+	Assert( numFaces < maxFaces );
+	newFaceIndex = numFaces++;
+	return faces[ newFaceIndex ];
+}
 
-	srTile & newTile = renderer->m_tiles[ newTileIndex ];
-	return newTile;
+// The edge function values at the tile corner are computed in 64 bits and clamped,
+// so that they can be stepped in 32 bits within the tile without changing sign.
+static FORCEINLINE
+INT32 ClampEdgeValue( const INT64 value )
+{
+	const INT64 EDGE_VALUE_LIMIT = (1 << 29);
+	return (INT32) ( value > EDGE_VALUE_LIMIT ? EDGE_VALUE_LIMIT : ( value < -EDGE_VALUE_LIMIT ? -EDGE_VALUE_LIMIT : value ) );
 }
 
 static inline
-void RasterizeFullyCoveredTile( const srTile& tile, const SoftRenderContext& context, srTileRenderer* renderer )
+void RasterizeFullyCoveredTile( const srTile& tile, const XTriangle& face, const SoftRenderContext& context )
 {
 	//Assert( tile.bFullyCovered );
 
 	const int W = context.W;	// viewport width
 	//const int H = context.H;	// viewport height
 
-	const UINT iFace = tile.iFace;
-	const XTriangle& face = renderer->m_transformedFaces[ iFace ];
-
 	const F32 fX1 = face.v1.P.x;
 	const F32 fX2 = face.v2.P.x;
 	const F32 fX3 = face.v3.P.x;
@@ -73,13 +118,59 @@ void RasterizeFullyCoveredTile( const srTile& tile, const SoftRenderContext& con
 	const UINT iBlockX = tile.GetX();
 	const UINT iBlockY = tile.GetY();
 
+	SoftPixel *	colorBufferStart = context.colorBuffer + iBlockY * W;	// color buffer
+	ZBufElem *	depthBufferStart = context.depthBuffer + iBlockY * W;	// depth buffer
+
+#if SOFT_RENDER_USE_AVX
+
+	const __m256 qf76543210 = _mm256_set_ps( 7.0f, 6.0f, 5.0f, 4.0f, 3.0f, 2.0f, 1.0f, 0.0f );
+	const __m256 qf255x8 = _mm256_set1_ps( 255.0f );
+	const __m256 qfvZx = _mm256_set1_ps( face.vZ.x );
+
+	for( UINT iY = iBlockY; iY < iBlockY + TILE_SIZE_Y; iY++ )
+	{
+		for( UINT iX = iBlockX; iX < iBlockX + TILE_SIZE_X; iX += AVX_REG_WIDTH )
+		{
+			F32* depth = (depthBufferStart + iX);
+			__m256i* dest = (__m256i*) (colorBufferStart + iX);
+
+			const __m256 qfOldDepth = _mm256_loadu_ps( depth );
+
+			// interpolate depth
+			const F32 fX = (F32)iX - fX1;
+			const F32 fY = (F32)iY - fY1;
+			const __m256 qfZ0 = _mm256_set1_ps( fZ1 + face.vZ.x * fX + face.vZ.y * fY );
+			const __m256 qfZ = _mm256_add_ps( qfZ0, _mm256_mul_ps( qfvZx, qf76543210 ) );
+
+			// perform depth testing
+			const __m256 qfDepthMask = _mm256_cmp_ps( qfZ, qfOldDepth, _CMP_LE_OQ );
+			if( !_mm256_movemask_ps( qfDepthMask ) ) {
+				continue;	// occluded
+			}
+
+			_mm256_storeu_ps( depth, _mm256_blendv_ps( qfOldDepth, qfZ, qfDepthMask ) );
+
+			// convert depth to color
+			const __m256i qiTmp = _mm256_cvtps_epi32( _mm256_min_ps( _mm256_mul_ps( qfZ, qf255x8 ), qf255x8 ) );
+			const __m256i qiNewColor = _mm256_or_si256(
+				_mm256_or_si256( _mm256_slli_epi32( qiTmp, 16 ), _mm256_slli_epi32( qiTmp, 8 ) ),
+				qiTmp
+			);
+
+			const __m256 qfOldColor = _mm256_castsi256_ps( _mm256_loadu_si256( dest ) );
+			_mm256_storeu_si256( dest, _mm256_castps_si256( _mm256_blendv_ps( qfOldColor, _mm256_castsi256_ps( qiNewColor ), qfDepthMask ) ) );
+		}//for x
+
+		colorBufferStart += W;
+		depthBufferStart += W;
+	}//for y
+
+#else
+
 	const __m128 qf3210 = _mm_set_ps( 3.0f, 2.0f, 1.0f, 0.0f );
 	//const __m128 qf4444 = _mm_set_ps1( 4.0f );
 	static const __m128 qf255x4 = _mm_set_ps1( 255.0f );
 
-	SoftPixel *	colorBufferStart = context.colorBuffer + iBlockY * W;	// color buffer
-	ZBufElem *	depthBufferStart = context.depthBuffer + iBlockY * W;	// depth buffer
-
 	for( UINT iY = iBlockY; iY < iBlockY + TILE_SIZE_Y; iY++ )
 	{
 		for( UINT iX = iBlockX; iX < iBlockX + TILE_SIZE_X; iX += SSE_REG_WIDTH )
@@ -152,22 +243,19 @@ void RasterizeFullyCoveredTile( const srTile& tile, const SoftRenderContext& con
 		depthBufferStart += W;
 	}//for y
 
+#endif // SOFT_RENDER_USE_AVX
+
 	//SoftRenderer::Dbg_BlockRasterizer_DrawFullyCoveredRect( context, iBlockX, iBlockY, TILE_SIZE_X, TILE_SIZE_Y );
 }
 
 static inline
-void RasterizePartiallyCoveredTile( const srTile& tile, const SoftRenderContext& context, srTileRenderer* renderer )
+void RasterizePartiallyCoveredTile( const srTile& tile, const XTriangle& face, const SoftRenderContext& context )
 {
 	//Assert( !tile.bFullyCovered );
 
 	const int W = context.W;	// viewport width
 	const int H = context.H;	// viewport height
 
-	const UINT iFace = tile.iFace;
-	Assert( iFace < renderer->m_nTransformedTris );
-
-	const XTriangle& face = renderer->m_transformedFaces[ iFace ];
-
 	const UINT iBlockX = tile.GetX();
 	const UINT iBlockY = tile.GetY();
 
@@ -216,9 +304,9 @@ void RasterizePartiallyCoveredTile( const srTile& tile, const SoftRenderContext&
 
 	// Half-edge constants in 28.4
 
-	const INT32 C1 = face.C1;
-	const INT32 C2 = face.C2;
-	const INT32 C3 = face.C3;
+	const INT64 C1 = face.C1;
+	const INT64 C2 = face.C2;
+	const INT64 C3 = face.C3;
 
 
 	const INT32 nMinX = face.minX;
@@ -240,9 +328,92 @@ void RasterizePartiallyCoveredTile( const srTile& tile, const SoftRenderContext&
 	const UINT FBlockY1 = (iBlockY + (TILE_SIZE_Y - 1)) << FP_SHIFT;
 
 	// in 28.4
-	INT32 CY1 = C1 + DeltaX12 * FBlockY0 - DeltaY12 * FBlockX0;
-	INT32 CY2 = C2 + DeltaX23 * FBlockY0 - DeltaY23 * FBlockX0;
-	INT32 CY3 = C3 + DeltaX31 * FBlockY0 - DeltaY31 * FBlockX0;
+	INT32 CY1 = ClampEdgeValue( C1 + (INT64)DeltaX12 * FBlockY0 - (INT64)DeltaY12 * FBlockX0 );
+	INT32 CY2 = ClampEdgeValue( C2 + (INT64)DeltaX23 * FBlockY0 - (INT64)DeltaY23 * FBlockX0 );
+	INT32 CY3 = ClampEdgeValue( C3 + (INT64)DeltaX31 * FBlockY0 - (INT64)DeltaY31 * FBlockX0 );
+
+#if SOFT_RENDER_USE_AVX
+
+	// edge functions, eight pixels at a time
+
+	const __m256 qf76543210 = _mm256_set_ps( 7.0f, 6.0f, 5.0f, 4.0f, 3.0f, 2.0f, 1.0f, 0.0f );
+	const __m256 qf255x8 = _mm256_set1_ps( 255.0f );
+	const __m256 qfvZx = _mm256_set1_ps( face.vZ.x );
+
+	const __m256i qi76543210 = _mm256_set_epi32( 7, 6, 5, 4, 3, 2, 1, 0 );
+	const __m256i qiOffsetDY12 = _mm256_mullo_epi32( _mm256_set1_epi32( FDY12 ), qi76543210 );
+	const __m256i qiOffsetDY23 = _mm256_mullo_epi32( _mm256_set1_epi32( FDY23 ), qi76543210 );
+	const __m256i qiOffsetDY31 = _mm256_mullo_epi32( _mm256_set1_epi32( FDY31 ), qi76543210 );
+
+	const __m256i qiFDY12_8 = _mm256_set1_epi32( FDY12 * AVX_REG_WIDTH );
+	const __m256i qiFDY23_8 = _mm256_set1_epi32( FDY23 * AVX_REG_WIDTH );
+	const __m256i qiFDY31_8 = _mm256_set1_epi32( FDY31 * AVX_REG_WIDTH );
+
+	const __m256i qiZero = _mm256_setzero_si256();
+
+	for( UINT iY = iBlockY; iY < iBlockY + TILE_SIZE_Y; iY++ )
+	{
+		__m256i qiCX1 = _mm256_sub_epi32( _mm256_set1_epi32( CY1 ), qiOffsetDY12 );
+		__m256i qiCX2 = _mm256_sub_epi32( _mm256_set1_epi32( CY2 ), qiOffsetDY23 );
+		__m256i qiCX3 = _mm256_sub_epi32( _mm256_set1_epi32( CY3 ), qiOffsetDY31 );
+
+		for( UINT iX = iBlockX; iX < iBlockX + TILE_SIZE_X; iX += AVX_REG_WIDTH )
+		{
+			const __m256i qiEdgeMask = _mm256_and_si256(
+				_mm256_cmpgt_epi32( qiCX1, qiZero ),
+				_mm256_and_si256( _mm256_cmpgt_epi32( qiCX2, qiZero ), _mm256_cmpgt_epi32( qiCX3, qiZero ) )
+			);
+
+			qiCX1 = _mm256_sub_epi32( qiCX1, qiFDY12_8 );
+			qiCX2 = _mm256_sub_epi32( qiCX2, qiFDY23_8 );
+			qiCX3 = _mm256_sub_epi32( qiCX3, qiFDY31_8 );
+
+			if( _mm256_testz_si256( qiEdgeMask, qiEdgeMask ) ) {
+				continue;	// outside the triangle
+			}
+
+			F32* depth = (zbuffer + iX);
+			__m256i* dest = (__m256i*) (pixels + iX);
+
+			const __m256 qfOldDepth = _mm256_loadu_ps( depth );
+
+			// interpolate depth
+			const F32 fX = (F32)iX - fX1;
+			const F32 fY = (F32)iY - fY1;
+			const __m256 qfZ0 = _mm256_set1_ps( fZ1 + face.vZ.x * fX + face.vZ.y * fY );
+			const __m256 qfZ = _mm256_add_ps( qfZ0, _mm256_mul_ps( qfvZx, qf76543210 ) );
+
+			// perform depth testing
+			const __m256 qfColorMask = _mm256_and_ps(
+				_mm256_cmp_ps( qfZ, qfOldDepth, _CMP_LE_OQ ),
+				_mm256_castsi256_ps( qiEdgeMask )
+			);
+			if( !_mm256_movemask_ps( qfColorMask ) ) {
+				continue;	// occluded
+			}
+
+			_mm256_storeu_ps( depth, _mm256_blendv_ps( qfOldDepth, qfZ, qfColorMask ) );
+
+			// convert depth to color
+			const __m256i qiTmp = _mm256_cvtps_epi32( _mm256_min_ps( _mm256_mul_ps( qfZ, qf255x8 ), qf255x8 ) );
+			const __m256i qiNewColor = _mm256_or_si256(
+				_mm256_or_si256( _mm256_slli_epi32( qiTmp, 16 ), _mm256_slli_epi32( qiTmp, 8 ) ),
+				qiTmp
+			);
+
+			const __m256 qfOldColor = _mm256_castsi256_ps( _mm256_loadu_si256( dest ) );
+			_mm256_storeu_si256( dest, _mm256_castps_si256( _mm256_blendv_ps( qfOldColor, _mm256_castsi256_ps( qiNewColor ), qfColorMask ) ) );
+		}//for x
+
+		CY1 += FDX12;
+		CY2 += FDX23;
+		CY3 += FDX31;
+
+		pixels += W;
+		zbuffer += W;
+	}//for y
+
+#else
 
 	const __m128 qf3210 = _mm_set_ps( 3.0f, 2.0f, 1.0f, 0.0f );
 	//const __m128 qf4444 = _mm_set_ps1( 4.0f );
@@ -353,6 +524,8 @@ L_Skip_This_Quad:
 		zbuffer += W;
 	}//for y
 
+#endif // SOFT_RENDER_USE_AVX
+
 	//SoftRenderer::Dbg_BlockRasterizer_DrawPartiallyCoveredRect( context, iBlockX, iBlockY, TILE_SIZE_X, TILE_SIZE_Y );
 }
 
@@ -374,13 +547,11 @@ void F_ProcessTriangle(
 	const int W = context.W;	// viewport width
 	const int H = context.H;	// viewport height
 
-	srTileRenderer* renderer = c_cast(srTileRenderer*) context.userPointer;
+	// called from a binning job
+	srBinningJob* job = c_cast(srBinningJob*) context.userPointer;
 
-	Assert( renderer->m_nTransformedTris < FACE_BUFFER_SIZE );
-
-	const UINT newFaceIndex = (renderer->m_nTransformedTris++) & (FACE_BUFFER_SIZE-1);//avoid checking for overflow
-
-	XTriangle & face = renderer->m_transformedFaces[ newFaceIndex ];
+	UINT newFaceIndex;
+	XTriangle & face = job->AllocateFace( newFaceIndex );
 
 	face.v1 = v1;
 	face.v2 = v2;
@@ -482,9 +653,9 @@ void F_ProcessTriangle(
 
 
 	// Half-edge constants in 28.4
-	INT32 C1 = DeltaY12 * X1 - DeltaX12 * Y1;
-	INT32 C2 = DeltaY23 * X2 - DeltaX23 * Y2;
-	INT32 C3 = DeltaY31 * X3 - DeltaX31 * Y3;
+	INT64 C1 = (INT64)DeltaY12 * X1 - (INT64)DeltaX12 * Y1;
+	INT64 C2 = (INT64)DeltaY23 * X2 - (INT64)DeltaX23 * Y2;
+	INT64 C3 = (INT64)DeltaY31 * X3 - (INT64)DeltaX31 * Y3;
 
 	// correct for top-left fill convention
 	if( DeltaY12 < 0 || (DeltaY12 == 0 && DeltaX12 > 0) ) {
@@ -543,33 +714,34 @@ void F_ProcessTriangle(
 
 			// Evaluate half-space functions in the 4 corners of the block
 
-			const UINT a00 = 1-INT32_SIGN_BIT_SET( C1 + DeltaX12 * FBlockY0 - DeltaY12 * FBlockX0 );
-			const UINT a10 = 1-INT32_SIGN_BIT_SET( C1 + DeltaX12 * FBlockY0 - DeltaY12 * FBlockX1 );
-			const UINT a01 = 1-INT32_SIGN_BIT_SET( C1 + DeltaX12 * FBlockY1 - DeltaY12 * FBlockX0 );
-			const UINT a11 = 1-INT32_SIGN_BIT_SET( C1 + DeltaX12 * FBlockY1 - DeltaY12 * FBlockX1 );
+			const UINT a00 = ( C1 + (INT64)DeltaX12 * FBlockY0 - (INT64)DeltaY12 * FBlockX0 ) >= 0;
+			const UINT a10 = ( C1 + (INT64)DeltaX12 * FBlockY0 - (INT64)DeltaY12 * FBlockX1 ) >= 0;
+			const UINT a01 = ( C1 + (INT64)DeltaX12 * FBlockY1 - (INT64)DeltaY12 * FBlockX0 ) >= 0;
+			const UINT a11 = ( C1 + (INT64)DeltaX12 * FBlockY1 - (INT64)DeltaY12 * FBlockX1 ) >= 0;
 			const UINT a = (a00 << 0) | (a10 << 1) | (a01 << 2) | (a11 << 3);	// compose 4-bit mask for all four corners
 			if( !a ) {
 				continue;// Skip block when outside an edge => outside the triangle
 			}
-			const UINT b00 = 1-INT32_SIGN_BIT_SET( C2 + DeltaX23 * FBlockY0 - DeltaY23 * FBlockX0 );
-			const UINT b10 = 1-INT32_SIGN_BIT_SET( C2 + DeltaX23 * FBlockY0 - DeltaY23 * FBlockX1 );
-			const UINT b01 = 1-INT32_SIGN_BIT_SET( C2 + DeltaX23 * FBlockY1 - DeltaY23 * FBlockX0 );
-			const UINT b11 = 1-INT32_SIGN_BIT_SET( C2 + DeltaX23 * FBlockY1 - DeltaY23 * FBlockX1 );
+			const UINT b00 = ( C2 + (INT64)DeltaX23 * FBlockY0 - (INT64)DeltaY23 * FBlockX0 ) >= 0;
+			const UINT b10 = ( C2 + (INT64)DeltaX23 * FBlockY0 - (INT64)DeltaY23 * FBlockX1 ) >= 0;
+			const UINT b01 = ( C2 + (INT64)DeltaX23 * FBlockY1 - (INT64)DeltaY23 * FBlockX0 ) >= 0;
+			const UINT b11 = ( C2 + (INT64)DeltaX23 * FBlockY1 - (INT64)DeltaY23 * FBlockX1 ) >= 0;
 			const UINT b = (b00 << 0) | (b10 << 1) | (b01 << 2) | (b11 << 3);	// compose 4-bit mask for all four corners
 			if( !b ) {
 				continue;// Skip block when outside an edge => outside the triangle
 			}
-			const UINT c00 = 1-INT32_SIGN_BIT_SET( C3 + DeltaX31 * FBlockY0 - DeltaY31 * FBlockX0 );
-			const UINT c10 = 1-INT32_SIGN_BIT_SET( C3 + DeltaX31 * FBlockY0 - DeltaY31 * FBlockX1 );
-			const UINT c01 = 1-INT32_SIGN_BIT_SET( C3 + DeltaX31 * FBlockY1 - DeltaY31 * FBlockX0 );
-			const UINT c11 = 1-INT32_SIGN_BIT_SET( C3 + DeltaX31 * FBlockY1 - DeltaY31 * FBlockX1 );
+			const UINT c00 = ( C3 + (INT64)DeltaX31 * FBlockY0 - (INT64)DeltaY31 * FBlockX0 ) >= 0;
+			const UINT c10 = ( C3 + (INT64)DeltaX31 * FBlockY0 - (INT64)DeltaY31 * FBlockX1 ) >= 0;
+			const UINT c01 = ( C3 + (INT64)DeltaX31 * FBlockY1 - (INT64)DeltaY31 * FBlockX0 ) >= 0;
+			const UINT c11 = ( C3 + (INT64)DeltaX31 * FBlockY1 - (INT64)DeltaY31 * FBlockX1 ) >= 0;
 			const UINT c = (c00 << 0) | (c10 << 1) | (c01 << 2) | (c11 << 3);	// compose 4-bit mask for all four corners
 			if( !c ) {
 				continue;// Skip block when outside an edge => outside the triangle
 			}
 
-			srTile& newTile = AllocateTile( renderer );
+			srTile& newTile = job->AllocateTile();
 			newTile.iFace = newFaceIndex;
+			newTile.iJob = job - job->renderer->m_binningJobs;
 			newTile.SetX( iBlockX );
 			newTile.SetY( iBlockY );
 
@@ -597,15 +769,28 @@ srTileRenderer::srTileRenderer( UINT width, UINT height )
 	m_cullMode = ECullMode::Cull_CCW;
 	m_fillMode = EFillMode::Fill_Solid;
 
-	DBGOUT("srTileRenderer(): size of face buffer: %u KiB\n", sizeof m_transformedFaces /mxKIBIBYTE);
+	m_numBinsX = ( width + BIN_SIZE_X - 1 ) / BIN_SIZE_X;
+	m_numBinsY = ( height + BIN_SIZE_Y - 1 ) / BIN_SIZE_Y;
 
-	m_nTransformedTris = 0;
+	const UINT numBins = this->NumBins();
 
-	m_maxTiles = 2048;
-	m_tiles = (srTile*) mxAlloc( m_maxTiles * sizeof m_tiles[0] );
-	m_sortedTiles = (srTile*) mxAlloc( m_maxTiles * sizeof m_sortedTiles[0] );
-	m_numTiles = 0;
-	//m_numFullyCoveredTiles = 0;
+	m_binStart = (UINT*) mxAlloc( (numBins + 1) * sizeof m_binStart[0] );
+	MemSet( m_binStart, 0, (numBins + 1) * sizeof m_binStart[0] );
+
+	for( UINT iJob = 0; iJob < MAX_BINNING_JOBS; iJob++ )
+	{
+		srBinningJob& job = m_binningJobs[ iJob ];
+		job.renderer = this;
+		job.binOffsets = (UINT*) mxAlloc( numBins * sizeof job.binOffsets[0] );
+		MemSet( job.binOffsets, 0, numBins * sizeof job.binOffsets[0] );
+	}
+	m_numBinningJobs = 0;
+
+	m_maxBinnedTiles = 8192;
+	m_binnedTiles = (srTile*) mxAlloc( m_maxBinnedTiles * sizeof m_binnedTiles[0] );
+
+	DBGOUT("srTileRenderer(): %u x %u bins, size of face buffers: %u KiB\n",
+		m_numBinsX, m_numBinsY, MAX_BINNING_JOBS * m_binningJobs[0].maxFaces * sizeof(XTriangle) /mxKIBIBYTE);
 
 	//-----------------------------------------------------------------
 
@@ -639,15 +824,15 @@ srTileRenderer::srTileRenderer( UINT width, UINT height )
 
 srTileRenderer::~srTileRenderer()
 {
-	DBGOUT("~srTileRenderer(): %u tiles (%u KiB)\n",
-		m_maxTiles, m_maxTiles*sizeof m_tiles[0] /mxKIBIBYTE);
-
-	mxFree( m_tiles );
-	mxFree( m_sortedTiles );
-	m_tiles = nil;
-	m_numTiles = 0;
-	//m_numFullyCoveredTiles = 0;
-	m_maxTiles = 0;
+	DBGOUT("~srTileRenderer(): %u binned tiles (%u KiB)\n",
+		m_maxBinnedTiles, m_maxBinnedTiles*sizeof m_binnedTiles[0] /mxKIBIBYTE);
+
+	mxFree( m_binnedTiles );
+	mxFree( m_binStart );
+	m_binnedTiles = nil;
+	m_binStart = nil;
+	m_maxBinnedTiles = 0;
+	m_numBinningJobs = 0;
 }
 
 void srTileRenderer::SetWorldMatrix( const M44f& newWorldMatrix )
@@ -715,7 +900,7 @@ void srTileRenderer::DrawTriangles( SoftFrameBuffer& frameBuffer, const SVertex*
 	renderContext.pixelShader = m_pixelShader;
 	renderContext.colorBuffer = frameBuffer.m_colorBuffer;
 	renderContext.depthBuffer = frameBuffer.m_depthBuffer;
-	renderContext.userPointer = this;
+	renderContext.userPointer = nil;	// set to the binning job
 
 	renderContext.W = frameBuffer.m_viewportWidth;
 	renderContext.H = frameBuffer.m_viewportHeight;
@@ -729,12 +914,14 @@ void srTileRenderer::DrawTriangles( SoftFrameBuffer& frameBuffer, const SVertex*
 
 	//DBGOUT( "\nBEGIN: srTileRenderer::DrawTriangles: %u faces\n", numFaces );
 
-	// Break this up into batches
+	// Break this up into batches (each batch is split between the binning jobs)
+	enum { MAX_TRIANGLES_PER_BATCH = TRIANGLES_PER_BINNING_JOB * MAX_BINNING_JOBS };
+
 	UINT trianglesSoFar = 0;
-	while( trianglesSoFar + FACE_BUFFER_SIZE < numFaces )
+	while( trianglesSoFar + MAX_TRIANGLES_PER_BATCH < numFaces )
 	{
-		this->ProcessTriangles( vertices, numVertices, indices + trianglesSoFar*3, FACE_BUFFER_SIZE, renderContext );
-		trianglesSoFar += FACE_BUFFER_SIZE;
+		this->ProcessTriangles( vertices, numVertices, indices + trianglesSoFar*3, MAX_TRIANGLES_PER_BATCH, renderContext );
+		trianglesSoFar += MAX_TRIANGLES_PER_BATCH;
 	}
 
 	// Handle the last set of indices, if there are any
@@ -749,57 +936,114 @@ void srTileRenderer::DrawTriangles( SoftFrameBuffer& frameBuffer, const SVertex*
 	SoftRenderer::stats.numTrianglesRendered += numFaces;
 }
 
-static const ARGB32 THREAD_COLORS[8] =
+// Transforms, clips and sets up triangles and counts their tiles in each bin.
+struct BinTrianglesJob : AsyncJob
 {
-	ARGB8_RED,
-	ARGB8_GREEN,
-	ARGB8_BLUE,
-	ARGB8_YELLOW,
-	ARGB8_WHITE,
-	ARGB8_WHITE,
-	ARGB8_WHITE,
-	ARGB8_WHITE,
+	srBinningJob*	m_job;
+	F_RenderTriangles*	m_processTriangles;
+	F_RenderSingleTriangle*	m_drawTriangle;
+	const SVertex*	m_vertices;
+	UINT	m_numVertices;
+
+public:
+	BinTrianglesJob()
+	{
+		m_job = nil;
+		m_processTriangles = nil;
+		m_drawTriangle = nil;
+		m_vertices = nil;
+		m_numVertices = 0;
+	}
+	virtual void Run( const AsyncJob::Context& context ) override
+	{
+		srBinningJob& job = *m_job;
+
+		(*m_processTriangles)( m_drawTriangle, m_vertices, m_numVertices, job.indices, job.numTriangles*3, job.context );
+
+		const srTileRenderer& renderer = *job.renderer;
+		const UINT numBinsX = renderer.m_numBinsX;
+
+		MemSet( job.binOffsets, 0, renderer.NumBins() * sizeof job.binOffsets[0] );
+
+		for( UINT iTile = 0; iTile < job.numTiles; iTile++ )
+		{
+			const srTile& tile = job.tiles[ iTile ];
+			const UINT iBin = (tile.GetY() / BIN_SIZE_Y) * numBinsX + (tile.GetX() / BIN_SIZE_X);
+			Assert( iBin < renderer.NumBins() );
+			job.binOffsets[ iBin ]++;
+		}
+	}
 };
 
-struct RasterizeTilesJob : AsyncJob
+// Copies the tiles of a single binning job into their bins.
+struct ScatterTilesJob : AsyncJob
+{
+	srBinningJob*	m_job;
+	srTile*	m_binnedTiles;
+
+public:
+	ScatterTilesJob()
+	{
+		m_job = nil;
+		m_binnedTiles = nil;
+	}
+	virtual void Run( const AsyncJob::Context& context ) override
+	{
+		srBinningJob& job = *m_job;
+		const UINT numBinsX = job.renderer->m_numBinsX;
+
+		// binOffsets were turned into write positions by the prefix sum
+		for( UINT iTile = 0; iTile < job.numTiles; iTile++ )
+		{
+			const srTile& tile = job.tiles[ iTile ];
+			const UINT iBin = (tile.GetY() / BIN_SIZE_Y) * numBinsX + (tile.GetX() / BIN_SIZE_X);
+			m_binnedTiles[ job.binOffsets[ iBin ]++ ] = tile;
+		}
+	}
+};
+
+// Rasterizes the tiles of several bins in submission order.
+// Bins don't overlap, so no synchronization is needed.
+struct RasterizeBinsJob : AsyncJob
 {
 	const SoftRenderContext* m_context;
-	srTileRenderer*	m_renderer;
-	srTile*	m_tiles;
-	UINT	m_firstTile;
-	UINT	m_numTiles;
+	const srTileRenderer*	m_renderer;
+	const UINT*	m_binIndices;	// non-empty bins
+	UINT	m_numBins;
 
 public:
-	RasterizeTilesJob()
+	RasterizeBinsJob()
 	{
 		m_context = nil;
 		m_renderer = nil;
-		m_tiles = nil;
-		m_firstTile = 0;
-		m_numTiles = 0;
+		m_binIndices = nil;
+		m_numBins = 0;
 	}
 	virtual void Run( const AsyncJob::Context& context ) override
 	{
 		const SoftRenderContext& drawContext = *m_context;
-		const UINT lastTile = m_firstTile+m_numTiles;
-		for( UINT iTile = m_firstTile; iTile < lastTile; iTile++ )
+		const srTileRenderer& renderer = *m_renderer;
+
+		for( UINT i = 0; i < m_numBins; i++ )
 		{
-			const srTile& tile = m_tiles[ iTile ];
-			if( tile.bFullyCovered )
-			{
-				RasterizeFullyCoveredTile( tile, drawContext, m_renderer );
-			}
-			else
+			const UINT iBin = m_binIndices[ i ];
+			const UINT firstTile = renderer.m_binStart[ iBin ];
+			const UINT lastTile = renderer.m_binStart[ iBin + 1 ];
+
+			for( UINT iTile = firstTile; iTile < lastTile; iTile++ )
 			{
-				RasterizePartiallyCoveredTile( tile, drawContext, m_renderer );
-			}
+				const srTile& tile = renderer.m_binnedTiles[ iTile ];
+				const XTriangle& face = renderer.GetFace( tile );
 
-#if 0
-			const UINT threadNum = context.threadNumber;
-			const UINT colorIndex = smallest( threadNum, NUMBER_OF(THREAD_COLORS)-1 );
-			const ARGB32 color = THREAD_COLORS[ colorIndex ];
-			DbgDrawRect( drawContext, color, tile.GetX(), tile.GetY(), TILE_SIZE_X, TILE_SIZE_Y );
-#endif
+				if( tile.bFullyCovered )
+				{
+					RasterizeFullyCoveredTile( tile, face, drawContext );
+				}
+				else
+				{
+					RasterizePartiallyCoveredTile( tile, face, drawContext );
+				}
+			}
 		}
 	}
 };
@@ -808,172 +1052,249 @@ void srTileRenderer::ProcessTriangles( const SVertex* vertices, UINT numVertices
 {
 	mxPROFILE_SCOPE("srTileRenderer :: Process Triangles");
 
-	Assert(numTriangles <= FACE_BUFFER_SIZE);
-
+	Assert(numTriangles <= TRIANGLES_PER_BINNING_JOB * MAX_BINNING_JOBS);
 
-	F_RenderSingleTriangle* drawTriangleFunction = m_ftblDrawTriangle[m_fillMode];
+	if( m_fillMode == Fill_Wireframe )
+	{
+		// wireframe triangles are drawn immediately, without binning
+		(*m_ftblProcessTriangles[m_fillMode][m_cullMode])( m_ftblDrawTriangle[m_fillMode], vertices, numVertices, indices, numTriangles*3, context );
+		return;
+	}
 
-	(*m_ftblProcessTriangles[m_fillMode][m_cullMode])( drawTriangleFunction, vertices, numVertices, indices, numTriangles*3, context );
+	this->BinTriangles( vertices, numVertices, indices, numTriangles, context );
 
+	this->ScatterTilesIntoBins();
 
-	const UINT oldMaxTiles = m_maxTiles;
-	const UINT totalNumTiles = smallest(m_numTiles,oldMaxTiles);
+	const UINT totalNumTiles = m_binStart[ this->NumBins() ];
 
 	if( totalNumTiles )
 	{
-		mxPROFILE_SCOPE("srTileRenderer :: Rasterize Tiles");
+		this->RasterizeBins( context );
 
+		if( SOFT_RENDER_DEBUG && SoftRenderer::bDbg_DrawBlockBounds )
+		{
+			for( UINT iTile = 0; iTile < totalNumTiles; iTile++ )
+			{
+				const srTile& tile = m_binnedTiles[ iTile ];
 
+				if( tile.bFullyCovered )
+				{
+					Dbg_BlockRasterizer_DrawFullyCoveredRect( context, tile.GetX(), tile.GetY(), TILE_SIZE_X, TILE_SIZE_Y );
+				}
+				else
+				{
+					Dbg_BlockRasterizer_DrawPartiallyCoveredRect( context, tile.GetX(), tile.GetY(), TILE_SIZE_X, TILE_SIZE_Y );
+				}
+			}
+		}
+	}
 
-		if( bDbg_EnableThreading )
-		{
-			ThreadPool& threads = GetThreadPool();
+	for( UINT iJob = 0; iJob < m_numBinningJobs; iJob++ )
+	{
+		m_binningJobs[ iJob ].numFaces = 0;
+		m_binningJobs[ iJob ].numTiles = 0;
+	}
+	m_numBinningJobs = 0;
+}
 
-			//const UINT numThreads = threads.NumThreads();
+void srTileRenderer::BinTriangles( const SVertex* vertices, UINT numVertices, const SIndex* indices, UINT numTriangles, const SoftRenderContext& context )
+{
+	mxPROFILE_SCOPE("srTileRenderer :: Bin Triangles");
 
+	m_numBinningJobs = (numTriangles + TRIANGLES_PER_BINNING_JOB - 1) / TRIANGLES_PER_BINNING_JOB;
+	Assert( m_numBinningJobs <= MAX_BINNING_JOBS );
 
-			enum { MAX_RASTERIZER_JOBS = 256 };
+	BinTrianglesJob	binTrianglesJobs[MAX_BINNING_JOBS];
 
-			RasterizeTilesJob	rasterizeTilesJobs[MAX_RASTERIZER_JOBS];
+	for( UINT iJob = 0; iJob < m_numBinningJobs; iJob++ )
+	{
+		srBinningJob& job = m_binningJobs[ iJob ];
+
+		const UINT firstTriangle = iJob * TRIANGLES_PER_BINNING_JOB;
+
+		job.context = context;
+		job.context.userPointer = &job;
+		job.indices = indices + firstTriangle*3;
+		job.numTriangles = smallest( numTriangles - firstTriangle, TRIANGLES_PER_BINNING_JOB );
+		job.numFaces = 0;
+		job.numTiles = 0;
+
+		BinTrianglesJob& binTrianglesJob = binTrianglesJobs[ iJob ];
+		binTrianglesJob.m_job = &job;
+		binTrianglesJob.m_processTriangles = m_ftblProcessTriangles[m_fillMode][m_cullMode];
+		binTrianglesJob.m_drawTriangle = m_ftblDrawTriangle[m_fillMode];
+		binTrianglesJob.m_vertices = vertices;
+		binTrianglesJob.m_numVertices = numVertices;
+	}
 
-			//enum { TILES_PER_JOB = 512 };
-			enum { TILES_PER_JOB = 128 };
-			//enum { TILES_PER_JOB = 64 };
+	if( bDbg_EnableThreading && m_numBinningJobs > 1 )
+	{
+		ThreadPool& threads = GetThreadPool();
 
-			UINT numJobs = totalNumTiles/TILES_PER_JOB;
-			Assert(numJobs < MAX_RASTERIZER_JOBS);
-			numJobs = smallest(numJobs,MAX_RASTERIZER_JOBS);
+		for( UINT iJob = 0; iJob < m_numBinningJobs; iJob++ )
+		{
+			threads.EnqueueJob( &binTrianglesJobs[ iJob ] );
+		}
 
-			for( UINT iJob = 0; iJob < numJobs; iJob++ )
-			{
-				RasterizeTilesJob& job = rasterizeTilesJobs[ iJob ];
+		threads.RunAllJobs();
+	}
+	else
+	{
+		AsyncJob::Context	jobContext;
+		jobContext.threadNumber = 0;
 
-				job.m_context = &context;
-				job.m_renderer = this;
-				job.m_tiles = m_tiles;
-				job.m_firstTile = iJob*TILES_PER_JOB;
-				job.m_numTiles = TILES_PER_JOB;
+		for( UINT iJob = 0; iJob < m_numBinningJobs; iJob++ )
+		{
+			binTrianglesJobs[ iJob ].Run( jobContext );
+		}
+	}
+}
 
-				threads.EnqueueJob( &job );
-			}
+void srTileRenderer::ScatterTilesIntoBins()
+{
+	mxPROFILE_SCOPE("srTileRenderer :: Scatter Tiles");
 
-			RasterizeTilesJob	lastJob;
+	const UINT numBins = this->NumBins();
 
-			const UINT tilesLeft = totalNumTiles - numJobs*TILES_PER_JOB;
-			if( tilesLeft )
-			{
-				lastJob.m_context = &context;
-				lastJob.m_renderer = this;
-				lastJob.m_tiles = m_tiles;
-				lastJob.m_firstTile = numJobs*TILES_PER_JOB;
-				lastJob.m_numTiles = tilesLeft;
+	// prefix sum: bins in screen order, tiles of each bin in submission (job) order
 
-				threads.EnqueueJob( &lastJob );
-			}
+	UINT totalNumTiles = 0;
 
-			threads.RunAllJobs();
+	for( UINT iBin = 0; iBin < numBins; iBin++ )
+	{
+		m_binStart[ iBin ] = totalNumTiles;
 
-			DBGOUT( "srTileRenderer::ProcessTriangles: %u faces, %u tiles (%u jobs)\n",
-				m_nTransformedTris, m_numTiles, numJobs );
-		}
-		else
+		for( UINT iJob = 0; iJob < m_numBinningJobs; iJob++ )
 		{
-			UINT numFullyCovered = 0;
+			UINT & binOffset = m_binningJobs[ iJob ].binOffsets[ iBin ];
+			const UINT numTilesInBin = binOffset;
+			binOffset = totalNumTiles;
+			totalNumTiles += numTilesInBin;
+		}
+	}
 
-			for( UINT iTile = 0; iTile < totalNumTiles; iTile++ )
-			{
-				const srTile& tile = m_tiles[ iTile ];
+	m_binStart[ numBins ] = totalNumTiles;
 
-				numFullyCovered += tile.bFullyCovered;	// increment or do nothing
-			}
+	// resize the tile buffer if needed
 
-			const UINT numPartiallyCovered = totalNumTiles - numFullyCovered;
+	if( totalNumTiles > m_maxBinnedTiles )
+	{
+		const UINT oldMaxTiles = m_maxBinnedTiles;
 
-			DBGOUT( "srTileRenderer::ProcessTriangles: %u faces, %u tiles (%u fully covered, %u partially covered)\n",
-				m_nTransformedTris, m_numTiles, numFullyCovered, numPartiallyCovered );
+		m_maxBinnedTiles = NextPowerOfTwo( totalNumTiles );
 
-			struct cmp_tiles_predicate
-			{
-				mxSTATIC_ASSERT( sizeof srTile == sizeof UINT32 );
+		mxFree( m_binnedTiles );
+		m_binnedTiles = (srTile*) mxAlloc( m_maxBinnedTiles * sizeof m_binnedTiles[0] );
 
-				FORCEINLINE UINT32 operator() ( const srTile& o ) const
-				{
-					//return *(UINT32*)&o;
-					return o.sort;
-				}
-			};
+		DBGOUT("!!! Resizing tile buffer from %u to %u (%u KiB)\n",
+			oldMaxTiles,m_maxBinnedTiles,m_maxBinnedTiles*sizeof m_binnedTiles[0] /mxKIBIBYTE);
+	}
 
-			cmp_tiles_predicate	predicate;
-			radix_sort_3pass( m_tiles, m_sortedTiles, totalNumTiles, predicate );
-			//radix_sort_4pass( m_tiles, m_sortedTiles, totalNumTiles, predicate );
+	if( !totalNumTiles ) {
+		return;
+	}
 
-			for( UINT iTile = 0; iTile < numPartiallyCovered; iTile++ )
-			{
-				const srTile& tile = m_sortedTiles[ iTile ];
+	ScatterTilesJob	scatterTilesJobs[MAX_BINNING_JOBS];
 
-				Assert( !tile.bFullyCovered );
-				RasterizePartiallyCoveredTile( tile, context, this );
-			}
-			for( UINT iTile = numPartiallyCovered; iTile < totalNumTiles; iTile++ )
-			{
-				const srTile& tile = m_sortedTiles[ iTile ];
+	for( UINT iJob = 0; iJob < m_numBinningJobs; iJob++ )
+	{
+		scatterTilesJobs[ iJob ].m_job = &m_binningJobs[ iJob ];
+		scatterTilesJobs[ iJob ].m_binnedTiles = m_binnedTiles;
+	}
 
-				Assert( tile.bFullyCovered );
-				RasterizeFullyCoveredTile( tile, context, this );
-			}
-		}//serial
+	if( bDbg_EnableThreading && m_numBinningJobs > 1 )
+	{
+		ThreadPool& threads = GetThreadPool();
 
+		for( UINT iJob = 0; iJob < m_numBinningJobs; iJob++ )
+		{
+			threads.EnqueueJob( &scatterTilesJobs[ iJob ] );
+		}
 
+		threads.RunAllJobs();
+	}
+	else
+	{
+		AsyncJob::Context	jobContext;
+		jobContext.threadNumber = 0;
 
+		for( UINT iJob = 0; iJob < m_numBinningJobs; iJob++ )
+		{
+			scatterTilesJobs[ iJob ].Run( jobContext );
+		}
+	}
+}
 
+void srTileRenderer::RasterizeBins( const SoftRenderContext& context )
+{
+	mxPROFILE_SCOPE("srTileRenderer :: Rasterize Bins");
 
-		if( SOFT_RENDER_DEBUG && SoftRenderer::bDbg_DrawBlockBounds )
-		{
-			//for( UINT iFace = 0; iFace < numTriangles; iFace++ )
-			//{
-			//	const XTriangle& face = m_transformedFaces[ iFace ];
+	enum { MAX_RASTERIZER_JOBS = 256 };
 
-			//	Dbg_BlockRasterizer_DrawBoundingRect( context, face.minX, face.minY, face.maxX-face.minX, face.maxY-face.minY );
-			//}
+	// collect non-empty bins
 
-			for( UINT iTile = 0; iTile < totalNumTiles; iTile++ )
-			{
-				const srTile& tile = m_tiles[ iTile ];
+	const UINT numBins = this->NumBins();
 
-				if( tile.bFullyCovered )
-				{
-					Dbg_BlockRasterizer_DrawFullyCoveredRect( context, tile.GetX(), tile.GetY(), TILE_SIZE_X, TILE_SIZE_Y );
-				}
-				else
-				{
-					Dbg_BlockRasterizer_DrawPartiallyCoveredRect( context, tile.GetX(), tile.GetY(), TILE_SIZE_X, TILE_SIZE_Y );
-				}
-			}
+	enum {
+		MAX_BINS = ((SOFT_RENDER_MAX_WINDOW_WIDTH + BIN_SIZE_X - 1) / BIN_SIZE_X)
+				* ((SOFT_RENDER_MAX_WINDOW_HEIGHT + BIN_SIZE_Y - 1) / BIN_SIZE_Y)
+	};
+	Assert( numBins <= MAX_BINS );
+
+	UINT	nonEmptyBins[MAX_BINS];
+	UINT numNonEmptyBins = 0;
+
+	for( UINT iBin = 0; iBin < numBins; iBin++ )
+	{
+		if( m_binStart[ iBin + 1 ] > m_binStart[ iBin ] )
+		{
+			nonEmptyBins[ numNonEmptyBins++ ] = iBin;
 		}
+	}
 
+	const UINT totalNumTiles = m_binStart[ numBins ];
 
-		// resize buffers if needed
+	SoftRenderer::stats.numTilesRasterized += totalNumTiles;
+	SoftRenderer::stats.numBinsRasterized += numNonEmptyBins;
 
-		if( m_numTiles > oldMaxTiles )
-		{
-			m_maxTiles = NextPowerOfTwo( totalNumTiles );
+	RasterizeBinsJob	rasterizeBinsJobs[MAX_RASTERIZER_JOBS];
 
-			mxFree( m_tiles );
-			mxFree( m_sortedTiles );
+	// bins with only a few tiles are grouped together
+	const UINT binsPerJob = (numNonEmptyBins + MAX_RASTERIZER_JOBS - 1) / MAX_RASTERIZER_JOBS;
+	const UINT numJobs = (numNonEmptyBins + binsPerJob - 1) / binsPerJob;
 
-			m_tiles = (srTile*) mxAlloc( m_maxTiles * sizeof m_tiles[0] );
-			m_sortedTiles = (srTile*) mxAlloc( m_maxTiles * sizeof m_sortedTiles[0] );
+	for( UINT iJob = 0; iJob < numJobs; iJob++ )
+	{
+		const UINT firstBin = iJob * binsPerJob;
+
+		RasterizeBinsJob& job = rasterizeBinsJobs[ iJob ];
+		job.m_context = &context;
+		job.m_renderer = this;
+		job.m_binIndices = nonEmptyBins + firstBin;
+		job.m_numBins = smallest( numNonEmptyBins - firstBin, binsPerJob );
+	}
 
-			//MemCopy( m_sortedTiles, m_tiles, totalNumTiles * sizeof m_tiles[0] );
+	if( bDbg_EnableThreading )
+	{
+		ThreadPool& threads = GetThreadPool();
 
-			DBGOUT("!!! Resizing tile buffer from %u to %u (%u KiB)\n",
-				oldMaxTiles,m_maxTiles,m_maxTiles*sizeof m_tiles[0] /mxKIBIBYTE);
+		for( UINT iJob = 0; iJob < numJobs; iJob++ )
+		{
+			threads.EnqueueJob( &rasterizeBinsJobs[ iJob ] );
 		}
 
-		m_numTiles = 0;
-	}//if( totalNumTiles )
+		threads.RunAllJobs();
+	}
+	else
+	{
+		AsyncJob::Context	jobContext;
+		jobContext.threadNumber = 0;
 
-	m_nTransformedTris = 0;
+		for( UINT iJob = 0; iJob < numJobs; iJob++ )
+		{
+			rasterizeBinsJobs[ iJob ].Run( jobContext );
+		}
+	}
 }
 
 }//namespace SoftRenderer
@@ -21,73 +21,80 @@ enum { TILE_SIZE_Y = 8 };	//<= must be a power of two
 // (4 bits of sub-pixel precision, enough for a 2048x2048 color buffer)
 enum { FP_SHIFT = 4 };
 
-#if 1
-	union srTile
+// Screen-space tiles are grouped into bins (sort-middle rasterization):
+// each bin is rasterized by a single thread, so no locking is needed.
+enum { BIN_SIZE_X = TILE_SIZE_X * 8 };	// 128 pixels
+enum { BIN_SIZE_Y = TILE_SIZE_Y * 8 };	// 64 pixels
+
+// the number of input triangles transformed, set up and binned by one job
+enum { TRIANGLES_PER_BINNING_JOB = 256 };
+enum { MAX_BINNING_JOBS = 64 };
+
+// each triangle can be split by the clipping planes into a maximum of (3 + NUM_CLIP_PLANES - 2) sub-triangles
+enum { MAX_FACES_PER_CLIPPED_TRIANGLE = NUM_CLIP_PLANES + 1 };
+
+struct srTile
+{
+	UINT16		iFace;	// triangle index within the binning job
+	UINT8		iJob;	// the binning job which set up the triangle
+	UINT8		bFullyCovered;	// 1 - fully covered, 0 - partially covered
+	UINT16		iX;		// realX = iX * TILE_SIZE_X
+	UINT16		iY;		// realY = iY * TILE_SIZE_Y
+
+public:
+	FORCEINLINE void SetX( UINT x )
 	{
-		UINT32		sort;
-		// NOTE: field order is important! (for radix sort)
-		struct {
-			// Visual C++, Win7-64, x86-64
-			BITFIELD	iFace : 12;	// triangle index
-			BITFIELD	iX : 9;		// realX = iX * TILE_SIZE_X
-			BITFIELD	iY : 10;	// realY = iY * TILE_SIZE_Y
-			BITFIELD	bFullyCovered : 1;	// 1 - fully covered, 0 - partially covered
-		};
-
-	public:
-		FORCEINLINE void SetX( UINT x )
-		{
-			Assert( x % TILE_SIZE_X == 0 );
-			iX = x / TILE_SIZE_X;
-		}
-		FORCEINLINE void SetY( UINT y )
-		{
-			Assert( y % TILE_SIZE_Y == 0 );
-			iY = y / TILE_SIZE_Y;
-		}
-		FORCEINLINE UINT GetX() const
-		{
-			return iX * TILE_SIZE_X;
-		}
-		FORCEINLINE UINT GetY() const
-		{
-			return iY * TILE_SIZE_Y;
-		}
-	};
-	mxSTATIC_ASSERT( sizeof srTile == sizeof UINT32 );
-	mxSTATIC_ASSERT( SOFT_RENDER_MAX_WINDOW_WIDTH <= 2048 );
-	mxSTATIC_ASSERT( SOFT_RENDER_MAX_WINDOW_HEIGHT <= 1024 );
-#else
-	struct srTile
+		Assert( x % TILE_SIZE_X == 0 );
+		iX = x / TILE_SIZE_X;
+	}
+	FORCEINLINE void SetY( UINT y )
 	{
-		UINT16		iFace;	// triangle index
-		UINT16		iX;
-		UINT16		iY;
-		UINT16		bFullyCovered;
-
-	public:
-		FORCEINLINE void SetX( UINT x )
-		{
-			iX = x;
-		}
-		FORCEINLINE void SetY( UINT y )
-		{
-			iY = y;
-		}
-		FORCEINLINE UINT GetX() const
-		{
-			return iX;
-		}
-		FORCEINLINE UINT GetY() const
-		{
-			return iY;
-		}
-	};
-	mxSTATIC_ASSERT( sizeof srTile == sizeof UINT64 );
-	mxSTATIC_ASSERT( SOFT_RENDER_MAX_WINDOW_WIDTH <= MAX_UINT16 );
-	mxSTATIC_ASSERT( SOFT_RENDER_MAX_WINDOW_HEIGHT <= MAX_UINT16 );
-#endif
+		Assert( y % TILE_SIZE_Y == 0 );
+		iY = y / TILE_SIZE_Y;
+	}
+	FORCEINLINE UINT GetX() const
+	{
+		return iX * TILE_SIZE_X;
+	}
+	FORCEINLINE UINT GetY() const
+	{
+		return iY * TILE_SIZE_Y;
+	}
+};
+mxSTATIC_ASSERT( sizeof srTile == sizeof UINT64 );
+mxSTATIC_ASSERT( MAX_BINNING_JOBS <= MAX_UINT8 );
+mxSTATIC_ASSERT( TRIANGLES_PER_BINNING_JOB * MAX_FACES_PER_CLIPPED_TRIANGLE <= MAX_UINT16 );
+
+
+class srTileRenderer;
+
+// Transforms, clips and sets up a range of input triangles
+// and bins their tiles; owns the resulting triangles and tiles.
+struct srBinningJob
+{
+	srTileRenderer *	renderer;
+	SoftRenderContext	context;	// context.userPointer points to this job
+
+	const SIndex *	indices;
+	UINT			numTriangles;
+
+	XTriangle *		faces;		// set up triangles
+	UINT			numFaces;
+	UINT			maxFaces;
+
+	srTile *		tiles;		// grows in powers of two
+	UINT			numTiles;
+	UINT			maxTiles;
+
+	UINT *			binOffsets;	// the number of tiles in each bin, then where to scatter them
+
+public:
+	srBinningJob();
+	~srBinningJob();
 
+	srTile& AllocateTile();
+	XTriangle& AllocateFace( UINT &newFaceIndex );
+};
 
 struct Fragment
 {
@@ -121,16 +128,19 @@ public_internal:
 	F_RenderSingleTriangle *	m_ftblDrawTriangle[Fill_MAX];
 
 
-	//TStaticList< XVertex, MAX_BATCHED_VERTICES >	m_batchedVertices;
-	mxPREALIGN(16) XTriangle	m_transformedFaces[FACE_BUFFER_SIZE];
-	UINT					m_nTransformedTris;
+	// Sort-middle pipeline:
+	// 1) the binning jobs transform, clip and set up triangles and sort their tiles into screen bins;
+	// 2) the tiles of all jobs are scattered into m_binnedTiles, bin by bin, keeping the submission order;
+	// 3) the bins are rasterized in parallel.
+	srBinningJob			m_binningJobs[MAX_BINNING_JOBS];
+	UINT					m_numBinningJobs;
 
-	srTile *				m_tiles;	// grows in powers of two
-	UINT					m_numTiles;	// current number of tiles
-	//UINT					m_numFullyCoveredTiles;	// number of trivially accepted tiles
-	UINT					m_maxTiles;	// number of dynamically allocated tiles
+	UINT					m_numBinsX;
+	UINT					m_numBinsY;
+	UINT *					m_binStart;	// [numBins + 1] the first tile of each bin in m_binnedTiles
 
-	srTile *				m_sortedTiles;	// grows in powers of two
+	srTile *				m_binnedTiles;	// grows in powers of two
+	UINT					m_maxBinnedTiles;
 
 public:
 	srTileRenderer( UINT width, UINT height );
@@ -150,8 +160,21 @@ public:
 
 	void DrawTriangles( SoftFrameBuffer& frameBuffer, const SVertex* vertices, UINT numVertices, const SIndex* indices, UINT numIndices ) override;
 
+	FORCEINLINE UINT NumBins() const { return m_numBinsX * m_numBinsY; }
+
+	FORCEINLINE const XTriangle& GetFace( const srTile& tile ) const
+	{
+		Assert( tile.iJob < m_numBinningJobs );
+		Assert( tile.iFace < m_binningJobs[ tile.iJob ].numFaces );
+		return m_binningJobs[ tile.iJob ].faces[ tile.iFace ];
+	}
+
 private:
 	void ProcessTriangles( const SVertex* vertices, UINT numVertices, const SIndex* indices, UINT numTriangles, const SoftRenderContext& context );
+
+	void BinTriangles( const SVertex* vertices, UINT numVertices, const SIndex* indices, UINT numTriangles, const SoftRenderContext& context );
+	void ScatterTilesIntoBins();
+	void RasterizeBins( const SoftRenderContext& context );
 };
 
 }//namespace SoftRenderer
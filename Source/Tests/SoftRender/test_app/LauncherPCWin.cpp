@@ -224,6 +224,10 @@ class MyApp : public AClientViewport
 
 	FPSTracker<>	m_fpsCounter;
 
+	enum { NUM_BENCHMARK_RESOLUTIONS = 3 };
+	F32		m_benchmarkFPS[ NUM_BENCHMARK_RESOLUTIONS ];
+	bool	m_hasBenchmarkResults;
+
 public:
 	MyApp()
 	{
@@ -235,6 +239,7 @@ public:
 		m_showStats = true;
 		m_showHelp = true;
 		m_visibleModels = 0;
+		m_hasBenchmarkResults = false;
 	}
 	~MyApp()
 	{
@@ -373,6 +378,10 @@ public:	//=-- AClientViewport
 		{
 			SoftRenderer::bDbg_EnableThreading ^= 1;
 		}
+		if( key == EKeyCode::Key_F5 )
+		{
+			this->RunBenchmark();
+		}
 
 		if( key == EKeyCode::Key_U )
 		{
@@ -396,11 +405,9 @@ public:	//=-- AClientViewport
 		m_camera.OnMouseMove( args.mouseDeltaX, args.mouseDeltaY );
 	}
 
-	virtual void Draw() override
+	// renders the reference scene with the current camera into the current SoftRenderer target
+	void RenderScene( const F32 aspectRatio )
 	{
-		mxPROFILE_SCOPE("Draw:");
-
-		const F32 aspectRatio = (F32)m_screen->GetWidth() / m_screen->GetHeight();
 		m_camera.SetAspectRatio( aspectRatio );
 
 		const rxView& view = m_camera.GetView();
@@ -498,6 +505,92 @@ public:	//=-- AClientViewport
 			//SoftRenderer::DrawLine2D(0,0,500,500,ARGB8_GREEN);
 		}
 		SoftRenderer::EndFrame();
+	}
+
+	// Renders the reference scene with a fixed camera and animation time
+	// into offscreen buffers at 720p, 1080p and 4K and measures frames per second.
+	void RunBenchmark()
+	{
+		enum { NUM_WARMUP_FRAMES = 10 };
+		enum { NUM_FRAMES = 100 };
+
+		static const UINT RESOLUTIONS[ NUM_BENCHMARK_RESOLUTIONS ][2] =
+		{
+			{ 1280, 720 },
+			{ 1920, 1080 },
+			{ 3840, 2160 },
+		};
+
+		const SCamera savedCamera = m_camera;
+		const FLOAT savedAngle = m_angle;
+
+		this->ResetCamera();
+		m_angle = 0.5f;
+
+		SoftRenderer::Shutdown();
+
+		for( UINT iResolution = 0; iResolution < NUM_BENCHMARK_RESOLUTIONS; iResolution++ )
+		{
+			const UINT width = RESOLUTIONS[ iResolution ][0];
+			const UINT height = RESOLUTIONS[ iResolution ][1];
+
+			SoftPixel* pixels = (SoftPixel*) mxAlloc( width * height * sizeof pixels[0] );
+
+			SoftRenderer::InitArgs	initArgs;
+			initArgs.width = width;
+			initArgs.height = height;
+			initArgs.rgba = pixels;
+
+			SoftRenderer::Initialize( initArgs );
+
+			const F32 aspectRatio = (F32)width / height;
+
+			for( UINT iFrame = 0; iFrame < NUM_WARMUP_FRAMES; iFrame++ )
+			{
+				this->RenderScene( aspectRatio );
+			}
+
+			ScopedTimer	timer;
+			for( UINT iFrame = 0; iFrame < NUM_FRAMES; iFrame++ )
+			{
+				this->RenderScene( aspectRatio );
+			}
+			const U64 elapsedMicroseconds = largest( timer.ElapsedMicroseconds(), (U64)1 );
+
+			m_benchmarkFPS[ iResolution ] = (F32) ( NUM_FRAMES * 1e6 / elapsedMicroseconds );
+
+			DBGOUT("Benchmark: %ux%u: %.2f FPS (%.3f ms per frame, %u triangles, %u tiles in %u bins, threading %s)\n",
+				width, height, m_benchmarkFPS[ iResolution ], elapsedMicroseconds * 1e-3f / NUM_FRAMES,
+				SoftRenderer::stats.numTrianglesRendered,
+				SoftRenderer::stats.numTilesRasterized, SoftRenderer::stats.numBinsRasterized,
+				SoftRenderer::bDbg_EnableThreading ? "enabled" : "disabled");
+
+			SoftRenderer::Shutdown();
+
+			mxFree( pixels );
+		}
+
+		m_hasBenchmarkResults = true;
+
+		m_camera = savedCamera;
+		m_angle = savedAngle;
+
+		// restore the window's render target
+		SoftRenderer::InitArgs	initArgs;
+		initArgs.width = m_screen->GetWidth();
+		initArgs.height = m_screen->GetHeight();
+		initArgs.rgba = (SoftPixel*)m_screen->GetPixels();
+
+		SoftRenderer::Initialize( initArgs );
+	}
+
+	virtual void Draw() override
+	{
+		mxPROFILE_SCOPE("Draw:");
+
+		const F32 aspectRatio = (F32)m_screen->GetWidth() / m_screen->GetHeight();
+
+		this->RenderScene( aspectRatio );
 
 
 		const SoftRenderer::Settings& realSettings = SoftRenderer::CurrentSettings();
@@ -530,6 +623,16 @@ public:	//=-- AClientViewport
 
 			mxSPRINTF_ANSI( text, "Indices: %u", SoftRenderer::stats.numIndices );
 			m_screen->DrawText(10,y+=15,text,RGBAf::BLUE.ToFloatPtr());
+
+			mxSPRINTF_ANSI( text, "Tiles: %u (%u bins)", SoftRenderer::stats.numTilesRasterized, SoftRenderer::stats.numBinsRasterized );
+			m_screen->DrawText(10,y+=15,text,RGBAf::BLUE.ToFloatPtr());
+
+			if( m_hasBenchmarkResults )
+			{
+				mxSPRINTF_ANSI( text, "Benchmark FPS: 720p: %.1f, 1080p: %.1f, 4K: %.1f",
+					m_benchmarkFPS[0], m_benchmarkFPS[1], m_benchmarkFPS[2] );
+				m_screen->DrawText(10,y+=15,text,RGBAf::RED.ToFloatPtr());
+			}
 		}
 		if( m_showHelp && m_screen.IsValid() )
 		{
@@ -557,6 +660,9 @@ public:	//=-- AClientViewport
 			mxSPRINTF_ANSI( text, "T - threading (%s)", SoftRenderer::bDbg_EnableThreading ? "enabled" : "disabled" );
 			m_screen->DrawText(10,y+=15,text,RGBAf::GREEN.ToFloatPtr());
 
+			mxSPRINTF_ANSI( text, "F5 - run benchmark (720p, 1080p, 4K)" );
+			m_screen->DrawText(10,y+=15,text,RGBAf::GREEN.ToFloatPtr());
+
 			mxSPRINTF_ANSI( text, "Using %s", SOFT_RENDER_USE_HALFSPACE_RASTERIZER ? "halfspaces" : "scanlines" );
 			m_screen->DrawText(10,y+=15,text,RGBAf::GREEN.ToFloatPtr());
 		}
@@ -2,17 +2,28 @@
 #pragma hdrstop
 
 
-extern ERet gameEntryPoint();
+/// run_developer_tests - run the engine unit tests and benchmarks instead of the game
+extern ERet gameEntryPoint( const bool run_developer_tests );
 
-int main(int /*argc*/, char** /*argv*/)
+int main(int argc, char** argv)
 {
 	//runUnitTests_M44f();
 
 	//
 	NwSetupMemorySystem	setupMemory;
 
+	bool run_developer_tests = false;
+#if MX_DEVELOPER
+	for( int i = 1; i < argc; i++ )
+	{
+		if( !strcmp( argv[i], "-run_tests" ) ) {
+			run_developer_tests = true;
+		}
+	}
+#endif // MX_DEVELOPER
+
 	//
-	ERet ret = gameEntryPoint();
+	ERet ret = gameEntryPoint( run_developer_tests );
 
 	return (ret == ALL_OK) ? 0 : -1;
 }
@@ -34,6 +34,7 @@
 #include <Voxels/private/base/math/vx_cube_geometry.h>
 
 #include "app.h"
+#include "app_developer_tests.h"
 #include "app_states/game_states.h"
 #include "experimental/rccpp.h"
 #include "rendering/renderer_data.h"
@@ -583,7 +584,7 @@ ERet LoadUserGameSettingsFile(MyGameUserSettings &game_user_settings_)
 
 
 
-ERet gameEntryPoint()
+ERet gameEntryPoint( const bool run_developer_tests )
 {
 #if 0
 	//signed char a = -2;
@@ -620,6 +621,15 @@ ERet gameEntryPoint()
 	game_user_settings.window.name = MY_GAME_NAME;
 	engine_launch_config.window = game_user_settings.window;
 
+	ERet developer_tests_result = ALL_OK;
+
+#if MX_DEVELOPER
+	// must be run before the graphics system is initialized
+	if( run_developer_tests ) {
+		developer_tests_result = DeveloperTests::RunBeforeEngineInit();
+	}
+#endif // MX_DEVELOPER
+
 	//
 	mxDO(g_engine.Initialize(
 		engine_launch_config
@@ -661,9 +671,20 @@ ERet gameEntryPoint()
 		lse->StartCoroutine(script, "Count");
 #endif
 
-		//
-		NwSimpleGameLoop	game_loop;
-		WindowsDriver::run( &game, &game_loop );
+#if MX_DEVELOPER
+		if( run_developer_tests )
+		{
+			const ERet result = DeveloperTests::Run( game );
+			if( mxSUCCEDED(developer_tests_result) ) {
+				developer_tests_result = result;
+			}
+		}
+		else
+#endif // MX_DEVELOPER
+		{
+			NwSimpleGameLoop	game_loop;
+			WindowsDriver::run( &game, &game_loop );
+		}
 
 		// save settings before shutting down, because Shutdown() may fail in render doc (D3D Debug RunTime)
 		game.SaveSettingsToFiles();
@@ -675,5 +696,5 @@ ERet gameEntryPoint()
 	//
 	g_engine.Shutdown();
 
-	return ALL_OK;
+	return developer_tests_result;
 }
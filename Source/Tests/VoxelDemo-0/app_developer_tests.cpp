@@ -0,0 +1,226 @@
+#include "stdafx.h"
+#pragma hdrstop
+
+#if MX_DEVELOPER
+
+#include <Base/Math/Quaternion.h>	// UnitTest_Quaternions()
+#include <Core/Tasking/TaskSchedulerInterface.h>
+#include <GPU/Public/graphics_device.h>	// NGpu::UnitTest_NullBackend()
+
+#include <Engine/WindowsDriver.h>
+#include <Engine/Private/EngineGlobals.h>
+
+#include <Physics/Collision/TbQuantizedBIH.h>
+
+#include <ProcGen/Noise/NwNoiseGrid.h>
+#include <ProcGen/Noise/NwChunkNoiseCache.h>
+
+#include <Rendering/Public/Core/Mesh.h>
+#include <Rendering/Public/Scene/MeshInstance.h>
+#include <Rendering/Public/Scene/SpatialDatabase.h>
+#include <Rendering/Public/Scene/OcclusionBuffer.h>
+#include <Rendering/Private/SceneRendering.h>
+#include <Rendering/Private/Modules/Animation/AnimatedModel.h>
+#include <Rendering/Private/Modules/Particles/ParticleSimulation.h>
+#include <Rendering/Private/Modules/VoxelGI/vxgi_brick_pool.h>
+
+#include <Utility/Meshok/Quadrics.h>
+#include <Utility/Meshok/VCacheOptimizer.h>
+#include <Utility/Meshok/MeshletBuilder.h>
+#include <Utility/Meshok/LinearOctree.h>
+#include <Utility/Meshok/SDF.h>
+#include <Utility/Meshok/SDF_Cache.h>
+#include <Utility/Meshok/VolumeSampling.h>
+#include <Utility/MeshLib/QuadricSimplifier.h>
+#include <Utility/Implicit/Evaluator.h>
+#include <Utility/Implicit/BlobProgram.h>
+
+#include "app.h"
+#include "app_developer_tests.h"
+
+
+namespace DeveloperTests
+{
+namespace
+{
+	/// Logs the result of each test and remembers the first error.
+	struct TestResults
+	{
+		ERet	first_error;
+		U32		num_passed;
+		U32		num_failed;
+
+	public:
+		TestResults()
+		{
+			first_error = ALL_OK;
+			num_passed = 0;
+			num_failed = 0;
+		}
+
+		void Add( const ERet result, const char* test_name )
+		{
+			if( mxSUCCEDED(result) )
+			{
+				ptPRINT("[PASSED] %s", test_name);
+				++num_passed;
+			}
+			else
+			{
+				ptERROR("[FAILED] %s: '%s'", test_name, EReturnCode_To_Chars( result ));
+				++num_failed;
+
+				if( mxSUCCEDED(first_error) ) {
+					first_error = result;
+				}
+			}
+		}
+
+		ERet Finish() const
+		{
+			ptPRINT("Developer tests: %u passed, %u failed.", num_passed, num_failed);
+			return first_error;
+		}
+	};
+
+	#define RUN_DEVELOPER_TEST( RESULTS, EXPRESSION )\
+		(RESULTS).Add( (EXPRESSION), #EXPRESSION )
+
+
+	ERet runInstancedSubmissionBenchmark( MyApp & app, const char* mesh_name )
+	{
+		TResPtr< Rendering::NwMesh >	mesh( MakeAssetID( mesh_name ) );
+		mxDO(mesh.Load( &app.runtime_clump ));
+
+		// loads the default materials of the mesh
+		Rendering::MeshInstance	mesh_instance;
+		mxDO(mesh_instance.setupFromMesh( mesh._ptr, app.runtime_clump ));
+
+		Rendering::NwCameraView	camera_view;
+		camera_view.near_clip = NEngine::g_settings.rendering.camera_near_clip;
+		camera_view.far_clip = NEngine::g_settings.rendering.camera_far_clip;
+
+		const UInt2 window_size = WindowsDriver::getWindowSize();
+		camera_view.screen_width = window_size.x;
+		camera_view.screen_height = window_size.y;
+		camera_view.aspect_ratio = (float) window_size.x / (float) window_size.y;
+		camera_view.recomputeDerivedMatrices();
+
+		return Rendering::Benchmark_InstancedSubmission(
+			*mesh._ptr
+			, Arrays::GetSpan( mesh_instance.materials )
+			, camera_view
+			, MemoryHeaps::global()
+			);
+	}
+
+	void runAnimationBenchmarks(
+		MyApp & app
+		, const char* skinned_mesh_name
+		, const char* animation_name
+		, NwJobSchedulerI & job_scheduler
+		, TestResults & results
+		)
+	{
+		TResPtr< Rendering::NwSkinnedMesh >	skinned_mesh( MakeAssetID( skinned_mesh_name ) );
+
+		const ERet load_result = skinned_mesh.Load( &app.runtime_clump );
+		results.Add( load_result, "loading the skinned mesh for the animation benchmarks" );
+
+		if( mxFAILED(load_result) ) {
+			return;
+		}
+
+		const NameHash32 anim_name_hash = GetDynamicStringHash( animation_name );
+
+		RUN_DEVELOPER_TEST( results, Rendering::NwAnimatedModel_::Benchmark_AnimationUpdate(
+			skinned_mesh, anim_name_hash, app.runtime_clump, job_scheduler
+			) );
+		RUN_DEVELOPER_TEST( results, Rendering::NwAnimatedModel_::Benchmark_SharedPoses(
+			skinned_mesh, anim_name_hash, app.runtime_clump, job_scheduler
+			) );
+	}
+
+}//namespace
+
+ERet RunBeforeEngineInit()
+{
+	TestResults	results;
+
+	UnitTest_Quaternions();	// asserts on failure
+
+	RUN_DEVELOPER_TEST( results, NGpu::UnitTest_NullBackend() );
+
+	return results.Finish();
+}
+
+ERet Run( MyApp & app )
+{
+	NwJobSchedulerI & job_scheduler = NwJobScheduler_Parallel::s_instance;
+	AllocatorI & allocator = MemoryHeaps::global();
+
+	TestResults	results;
+
+	// Meshes
+	RUN_DEVELOPER_TEST( results, Meshok::UnitTest_VertexCacheOptimization( allocator ) );
+	RUN_DEVELOPER_TEST( results, Meshok::UnitTest_MeshClusters( allocator ) );
+	RUN_DEVELOPER_TEST( results, Meshok::Benchmark_MeshClusterCulling( allocator ) );
+	RUN_DEVELOPER_TEST( results, Meshok::Benchmark_QuadricSimplifier( allocator ) );
+
+	// Volumes & isosurfaces
+	RUN_DEVELOPER_TEST( results, UnitTest_QEF_Batch( allocator ) );
+	RUN_DEVELOPER_TEST( results, Benchmark_QEF_Batch( allocator ) );
+	RUN_DEVELOPER_TEST( results, VX::UnitTest_LinearOctree( allocator ) );
+	RUN_DEVELOPER_TEST( results, VX::Benchmark_SampleHermiteGrid( job_scheduler, allocator ) );
+
+	RUN_DEVELOPER_TEST( results, SDF::Benchmark_DistanceToBatch( allocator ) );
+	RUN_DEVELOPER_TEST( results, SDF::Benchmark_RayTraceImage_Tiled( job_scheduler, allocator ) );
+	{
+		const V3f scene_size = CV3f(100);
+		const V3f scene_center = -scene_size * 0.3f;
+		const SDF::Isosurface* test_scene = SDF::Testing::GetTestScene( scene_size );
+
+		RUN_DEVELOPER_TEST( results, SDF::Benchmark_BrickCache(
+			test_scene, AABBf::fromSphere( scene_center, scene_size.x * 0.5f ), allocator
+			) );
+	}
+
+	RUN_DEVELOPER_TEST( results, implicit::Benchmark_EvaluateWide( allocator ) );
+	RUN_DEVELOPER_TEST( results, implicit::Benchmark_TapePruning( allocator ) );
+	RUN_DEVELOPER_TEST( results, implicit::Benchmark_BlobProgram( allocator ) );
+
+	// Procedural generation
+	RUN_DEVELOPER_TEST( results, Noise::Benchmark_NoiseGrid( allocator ) );
+	RUN_DEVELOPER_TEST( results, Noise::Benchmark_ChunkNoiseCache( allocator ) );
+
+	// Physics
+	RUN_DEVELOPER_TEST( results, Benchmark_BIH_CharacterSweepsOverTerrain( allocator ) );
+
+	// Rendering
+	RUN_DEVELOPER_TEST( results, Rendering::Benchmark_SpatialDatabase( job_scheduler, allocator ) );
+	RUN_DEVELOPER_TEST( results, Rendering::Benchmark_OcclusionCulling( job_scheduler, allocator ) );
+	RUN_DEVELOPER_TEST( results, Rendering::Benchmark_ParallelCommandRecording( job_scheduler, allocator ) );
+	RUN_DEVELOPER_TEST( results, Rendering::VXGI::Benchmark_BrickPoolChurn( job_scheduler ) );
+	RUN_DEVELOPER_TEST( results, Rendering::NwParticleSimulation_::Benchmark_ParticleSimulation( job_scheduler ) );
+
+	// the benchmarks below need assets
+	const MyAppSettings& settings = app.settings;
+
+	if( settings.dev_test_mesh.num() ) {
+		RUN_DEVELOPER_TEST( results, runInstancedSubmissionBenchmark( app, settings.dev_test_mesh.c_str() ) );
+	} else {
+		ptWARN("Skipping the instanced submission benchmark: 'dev_test_mesh' is not set.");
+	}
+
+	if( settings.dev_test_skinned_mesh.num() && settings.dev_test_animation.num() ) {
+		runAnimationBenchmarks( app, settings.dev_test_skinned_mesh.c_str(), settings.dev_test_animation.c_str(), job_scheduler, results );
+	} else {
+		ptWARN("Skipping the animation benchmarks: 'dev_test_skinned_mesh' or 'dev_test_animation' is not set.");
+	}
+
+	return results.Finish();
+}
+
+}//namespace DeveloperTests
+
+#endif // MX_DEVELOPER
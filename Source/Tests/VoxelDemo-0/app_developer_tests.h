@@ -0,0 +1,21 @@
+// Runs the engine unit tests and benchmarks (start the game with '-run_tests').
+#pragma once
+
+#if MX_DEVELOPER
+
+class MyApp;
+
+namespace DeveloperTests
+{
+	/// Runs the tests which must be run before the engine is initialized
+	/// (e.g. the null graphics back-end test initializes and shuts down the graphics system).
+	ERet RunBeforeEngineInit();
+
+	/// Runs all unit tests and benchmarks, logs the results and continues after a failure.
+	/// The tests which need assets are run only if the corresponding 'dev_test_*' settings are set.
+	/// Returns the first error.
+	ERet Run( MyApp & app );
+
+}//namespace DeveloperTests
+
+#endif // MX_DEVELOPER
@@ -308,6 +308,9 @@ mxBEGIN_REFLECTION(MyAppSettings)
 	mxMEMBER_FIELD( ui_show_debug_text ),
 
 	mxMEMBER_FIELD(dev_show_engine_settings),
+	mxMEMBER_FIELD(dev_test_mesh),
+	mxMEMBER_FIELD(dev_test_skinned_mesh),
+	mxMEMBER_FIELD(dev_test_animation),
 
 	mxMEMBER_FIELD( sun_light ),
 	mxMEMBER_FIELD( draw_skybox ),
@@ -386,6 +386,11 @@ struct MyAppSettings: CStruct
 	//Engine settings
 	bool	dev_show_engine_settings;
 
+	// assets for the developer tests ('-run_tests'), the tests are skipped if not set
+	String64	dev_test_mesh;			//!< for Benchmark_InstancedSubmission()
+	String64	dev_test_skinned_mesh;	//!< for the animation benchmarks
+	String64	dev_test_animation;		//!< looped animation of dev_test_skinned_mesh
+
 
 public:	//=== Rendering
 	// Sky
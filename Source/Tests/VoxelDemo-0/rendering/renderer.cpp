@@ -53,6 +53,7 @@ ERet MyGameRenderer::Initialize(
 		_data
 		, allocator
 		, MyGameRendererData
+		, allocator
 		));
 
 
@@ -72,6 +73,9 @@ ERet MyGameRenderer::Initialize(
 	mxDO(_data->irradiance_field.Initialize( renderer_settings.ddgi ));
 #endif
 
+	//
+	mxDO(_data->occlusion_buffer.Initialize( Rendering::NwOcclusionBufferSettings() ));
+
 	//
 	_data->_gizmo_renderer.BuildGeometry();
 
@@ -89,6 +93,9 @@ void MyGameRenderer::Shutdown()
 	_data->voxel_grids.Shutdown();
 #endif
 
+	//
+	_data->occlusion_buffer.Shutdown();
+
 	//
 	Rendering::Globals::Shutdown();
 
@@ -295,10 +302,31 @@ void MyGameRenderer::_DrawWorld(
 
 	{
 		const ViewFrustum	view_frustum = scene_view.BuildViewFrustum();
+
+		Rendering::NwOcclusionBuffer &	occlusion_buffer = _data->occlusion_buffer;
+		occlusion_buffer.BeginFrame( scene_view.view_projection_matrix );
+
+#if GAME_CFG_WITH_VOXEL_GI
+		// the fully solid leaves of the voxel BVH are the occluders
+		const Rendering::VXGI::VoxelBVH& voxel_BVH = *_data->voxel_grids.voxel_BVH;
+		for( UINT i = 0; i < voxel_BVH._leaf_item_handle_tbl._num_alive_items; i++ )
+		{
+			const Rendering::VXGI::VoxelBVH::BvhLeafItem& bvh_leaf_item = voxel_BVH._leaf_items[i];
+			const AABBf leaf_aabb = bvh_leaf_item.bbox.ToAabbMinMax();
+
+			if( bvh_leaf_item.IsFullySolid() && view_frustum.IntersectsAABB( leaf_aabb ) ) {
+				occlusion_buffer.AddOccluderBox( leaf_aabb );
+			}
+		}
+#endif // GAME_CFG_WITH_VOXEL_GI
+
+		occlusion_buffer.RasterizeOccluders( NwJobScheduler_Parallel::s_instance );
+
 		mxOPTIMIZE("jobify");
-		(*world.spatial_database).GetEntitiesIntersectingViewFrustum(
+		(*world.spatial_database).GetEntitiesVisibleFromView(
 			visible_entities
 			, view_frustum
+			, occlusion_buffer
 			);
 	}
 
@@ -13,6 +13,8 @@
 
 #include "compile_config.h"
 
+#include <Rendering/Public/Scene/OcclusionBuffer.h>
+
 #if GAME_CFG_WITH_VOXEL_GI
 #include <Rendering/Private/Modules/VoxelGI/_vxgi_system.h>
 #include <Rendering/Private/Modules/VoxelGI/IrradianceField.h>
@@ -24,6 +26,9 @@ struct MyGameRendererData: NonCopyable
 	// Rendering
 	Rendering::NwCameraView		scene_view;
 
+	/// the fully solid voxel chunks are rasterized as occluders
+	Rendering::NwOcclusionBuffer	occlusion_buffer;
+
 
 #if GAME_CFG_WITH_VOXEL_GI
 	//
@@ -38,4 +43,10 @@ struct MyGameRendererData: NonCopyable
 	TPtr< NwClump >		_scene_clump;
 
 	bool	_is_drawing_debug_lines;
+
+public:
+	MyGameRendererData( AllocatorI & allocator )
+		: occlusion_buffer( allocator )
+	{
+	}
 };
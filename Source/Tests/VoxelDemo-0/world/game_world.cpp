@@ -51,7 +51,7 @@ ERet MyWorld::Initialize(
 	_scene_clump = scene_clump;
 
 	//
-	spatial_database = Rendering::SpatialDatabaseI::CreateSimpleDatabase( _allocator );
+	spatial_database = Rendering::SpatialDatabaseI::CreateHierarchicalDatabase( _allocator );
 
 	//
 #if GAME_CFG_WITH_PHYSICS
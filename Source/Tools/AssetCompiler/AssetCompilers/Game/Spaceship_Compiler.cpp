@@ -17,6 +17,7 @@
 #include <Developer/Mesh/MeshImporter.h>
 
 #include <Utility/MeshLib/Simplification.h>
+#include <Utility/MeshLib/QuadricSimplifier.h>
 
 #include <AssetCompiler/AssetCompilers/Graphics/MeshCompiler.h>
 #include <AssetCompiler/AssetCompilers/Game/Spaceship_Compiler.h>
@@ -413,6 +414,34 @@ namespace
 		U32 target_num_indices = num_src_indices;
 		const float target_error = BIG_NUMBER;
 
+		// generate all LODs in one pass, they index into the source vertices
+		Meshok::MeshLodChain	lod_chain(scratch_allocator);
+		{
+			Meshok::QuadricSimplifier::Input	simplifier_input;
+			simplifier_input.positions = src_mesh.positions.raw();
+			simplifier_input.num_vertices = src_mesh.positions.num();
+			simplifier_input.indices = src_mesh.indices.raw();
+			simplifier_input.num_indices = src_mesh.indices.num();
+
+			// hard edges are welded and restored in the LODs
+			if(src_mesh.normals.num() == src_mesh.positions.num())
+			{
+				simplifier_input.normals = src_mesh.normals.raw();
+			}
+
+			Meshok::QuadricSimplifier::Settings	simplifier_settings;
+			simplifier_settings.num_lods = MAX_MESH_LODS;
+			simplifier_settings.triangle_reduction = 0.5f;
+			simplifier_settings.min_triangles = 100 / 3;
+
+			Meshok::QuadricSimplifier	simplifier(scratch_allocator);
+			mxDO(simplifier.GenerateLodChain(
+				simplifier_input
+				, simplifier_settings
+				, lod_chain
+				));
+		}
+
 		//
 		U32	prev_index_count = num_src_indices;
 
@@ -424,27 +453,16 @@ namespace
 			//
 			float resulting_error = 0;
 
-			// Start with the original high-resolution mesh.
+			// Take the LOD generated from the original high-resolution mesh.
 			{
-				const size_t num_simplified_indices = meshopt_simplify(
-					simplified_indices._data
-
-					, src_mesh.indices._data
-					, src_mesh.indices._count
+				const UINT lod_index = smallest(iLOD, lod_chain.num_lods - 1);
+				const Meshok::MeshLodChain::Lod& lod = lod_chain.lods[ lod_index ];
 
-					, (const float*)src_mesh.positions._data
-					, src_mesh.positions._count
-					, sizeof(src_mesh.positions[0])
-
-					, target_num_indices
-					, target_error
-					, &resulting_error
-					);
-
-				//
 				mxDO(simplified_indices.setNum(
-					num_simplified_indices
+					lod.num_indices
 					));
+				memcpy(simplified_indices._data, lod_chain.GetLodIndices(lod_index), lod.num_indices * sizeof(U32));
+
 				mxDO(Arrays::Copy(tmp_mesh.indices, simplified_indices));
 			}
 
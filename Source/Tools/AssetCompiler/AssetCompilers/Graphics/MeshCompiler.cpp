@@ -14,6 +14,9 @@
 #include <Rendering/Public/Globals.h>
 #include <Rendering/Public/Core/VertexFormats.h>
 #include <Rendering/Public/Core/Mesh.h>
+#include <Utility/Meshok/VCacheOptimizer.h>
+#include <Utility/Meshok/MeshletBuilder.h>
+#include <Utility/MeshLib/QuadricSimplifier.h>
 
 #include <AssetCompiler/AssetMetadata.h>
 
@@ -37,6 +40,252 @@ const TbMetaClass* MeshCompiler::getOutputAssetClass() const
 	return &Rendering::NwMesh::metaClass();
 }
 
+namespace
+{
+	/// Replaces the triangles of each submesh with its simplified version (see MeshImportSettings::lod_index).
+	/// The LODs reference the original vertices, the unused ones are removed by OptimizeSubmeshes() (if enabled).
+	ERet SimplifySubmeshes(
+		TcModel & model
+		, const Meshok::MeshImportSettings& mesh_import_settings
+		, AllocatorI & scratchpad
+		)
+	{
+		for( U32 submesh_index = 0; submesh_index < model.meshes.num(); submesh_index++ )
+		{
+			TcTriMesh & submesh = *model.meshes[ submesh_index ];
+
+			const U32 vertex_count = submesh.positions.num();
+			if( !submesh.indices.num() ) {
+				continue;
+			}
+
+			Meshok::QuadricSimplifier::Input	simplifier_input;
+			simplifier_input.positions = submesh.positions.raw();
+			simplifier_input.num_vertices = vertex_count;
+			simplifier_input.indices = submesh.indices.raw();
+			simplifier_input.num_indices = submesh.indices.num();
+
+			// UV seams are preserved
+			if( submesh.texCoords.num() == vertex_count )
+			{
+				simplifier_input.attributes = (const F32*) submesh.texCoords.raw();
+				simplifier_input.num_attributes = 2;
+				simplifier_input.attribute_stride = 2;
+			}
+
+			// hard edges are welded and restored in the LODs
+			if( submesh.normals.num() == vertex_count ) {
+				simplifier_input.normals = submesh.normals.raw();
+			}
+
+			Meshok::QuadricSimplifier::Settings	simplifier_settings;
+			simplifier_settings.num_lods = smallest( mesh_import_settings.lod_index + 1, (U32) Meshok::MeshLodChain::MAX_LODS );
+			simplifier_settings.triangle_reduction = mesh_import_settings.lod_triangle_reduction;
+
+			Meshok::MeshLodChain		lod_chain( scratchpad );
+			Meshok::QuadricSimplifier	simplifier( scratchpad );
+			mxDO(simplifier.GenerateLodChain(
+				simplifier_input
+				, simplifier_settings
+				, lod_chain
+				));
+
+			// the mesh may be too small to be simplified further
+			const U32 lod_index = lod_chain.num_lods - 1;
+			const Meshok::MeshLodChain::Lod& lod = lod_chain.lods[ lod_index ];
+
+			ptPRINT("Submesh %u ('%s'): LOD %u: %u -> %u tris, error: %f",
+				submesh_index, submesh.name.c_str(), lod_index,
+				submesh.indices.num() / 3, lod.num_indices / 3, lod.error
+				);
+
+			mxDO(submesh.indices.setNum( lod.num_indices ));
+			memcpy( submesh.indices.raw(), lod_chain.GetLodIndices( lod_index ), lod.num_indices * sizeof(U32) );
+		}
+
+		return ALL_OK;
+	}
+
+	/// Reorders the triangles of each submesh for the post-transform vertex cache (and to reduce overdraw),
+	/// then reorders the vertices in the order of first use for better vertex fetch locality.
+	ERet OptimizeSubmeshes(
+		TcModel & model
+		, const Meshok::EVertexCacheOptimization optimization
+		, AllocatorI & scratchpad
+		)
+	{
+		const U32 cache_size = Meshok::DEFAULT_VCACHE_SIZE;
+
+		for( U32 submesh_index = 0; submesh_index < model.meshes.num(); submesh_index++ )
+		{
+			TcTriMesh & submesh = *model.meshes[ submesh_index ];
+
+			const U32 index_count = submesh.indices.num();
+			const U32 vertex_count = submesh.positions.num();
+			if( !index_count ) {
+				continue;
+			}
+
+			Meshok::PostTransformCacheStatistics	stats_before;
+			mxDO(Meshok::analyzePostTransformImpl(
+				submesh.indices.raw(), index_count, vertex_count, cache_size, scratchpad, stats_before
+				));
+
+			DynamicArray< U32 >	optimized_indices( scratchpad );
+			mxDO(optimized_indices.setNum( index_count ));
+
+			switch( optimization )
+			{
+			case Meshok::VCO_Tipsify:
+				mxDO(Meshok::OptimizeVertexCache_Tipsify(
+					optimized_indices.raw(), submesh.indices.raw(), index_count, vertex_count, cache_size, scratchpad
+					));
+				break;
+
+			case Meshok::VCO_Forsyth:
+				mxDO(Meshok::OptimizeVertexCache_Forsyth(
+					optimized_indices.raw(), submesh.indices.raw(), index_count, vertex_count, scratchpad
+					));
+				break;
+
+			default:
+				// allow the ACMR to grow by 5% for drawing outer clusters first
+				mxDO(Meshok::OptimizeVertexCacheAndOverdraw(
+					optimized_indices.raw(), submesh.indices.raw(), index_count
+					, submesh.positions.raw(), vertex_count
+					, cache_size, 1.05f, scratchpad
+					));
+				break;
+			}
+
+			// renumber the vertices in the order of first use and remap all vertex streams
+			DynamicArray< U32 >	old_to_new( scratchpad );
+			mxDO(old_to_new.setNum( vertex_count ));
+
+			const U32 new_vertex_count = Meshok::OptimizeVertexFetch(
+				old_to_new.raw(), optimized_indices.raw(), index_count, vertex_count
+				);
+
+			mxDO(Meshok::RemapVertexStream( submesh.positions, old_to_new.raw(), new_vertex_count, scratchpad ));
+			mxDO(Meshok::RemapVertexStream( submesh.texCoords, old_to_new.raw(), new_vertex_count, scratchpad ));
+			mxDO(Meshok::RemapVertexStream( submesh.tangents, old_to_new.raw(), new_vertex_count, scratchpad ));
+			mxDO(Meshok::RemapVertexStream( submesh.binormals, old_to_new.raw(), new_vertex_count, scratchpad ));
+			mxDO(Meshok::RemapVertexStream( submesh.normals, old_to_new.raw(), new_vertex_count, scratchpad ));
+			mxDO(Meshok::RemapVertexStream( submesh.colors, old_to_new.raw(), new_vertex_count, scratchpad ));
+			mxDO(Meshok::RemapVertexStream( submesh.weights, old_to_new.raw(), new_vertex_count, scratchpad ));
+
+			memcpy( submesh.indices.raw(), optimized_indices.raw(), index_count * sizeof(U32) );
+
+			Meshok::PostTransformCacheStatistics	stats_after;
+			mxDO(Meshok::analyzePostTransformImpl(
+				submesh.indices.raw(), index_count, new_vertex_count, cache_size, scratchpad, stats_after
+				));
+
+			ptPRINT("Submesh %u ('%s'): %u tris, %u -> %u verts, ACMR: %.3f -> %.3f, ATVR: %.3f -> %.3f",
+				submesh_index, submesh.name.c_str(), index_count / 3, vertex_count, new_vertex_count,
+				stats_before.acmr, stats_after.acmr, stats_before.atvr, stats_after.atvr
+				);
+		}
+
+		return ALL_OK;
+	}
+
+	/// Splits each submesh into clusters for culling;
+	/// the triangles are reordered so that each cluster occupies a contiguous range of indices.
+	ERet BuildSubmeshClusters(
+		TcModel & model
+		, AllocatorI & scratchpad
+		, DynamicArray< Rendering::MeshCluster > &clusters_
+		)
+	{
+		const Meshok::MeshClusterSettings	settings;
+
+		for( U32 submesh_index = 0; submesh_index < model.meshes.num(); submesh_index++ )
+		{
+			TcTriMesh & submesh = *model.meshes[ submesh_index ];
+
+			const U32 index_count = submesh.indices.num();
+
+			DynamicArray< U32 >	clustered_indices( scratchpad );
+			mxDO(clustered_indices.setNum( index_count ));
+
+			// start indices are relative to the submesh, they are fixed up after merging the submeshes
+			mxDO(Meshok::BuildMeshClusters(
+				clustered_indices.raw(), submesh.indices.raw(), index_count
+				, submesh.positions.raw(), submesh.positions.num()
+				, settings, scratchpad, clusters_
+				, 0, submesh_index
+				));
+
+			memcpy( submesh.indices.raw(), clustered_indices.raw(), index_count * sizeof(U32) );
+		}
+
+		ptPRINT("Built %u clusters", clusters_.num());
+		return ALL_OK;
+	}
+
+	void MakeClusterIndicesRelativeToMesh(
+		DynamicArray< Rendering::MeshCluster > &clusters_
+		, const TbRawMeshData& raw_mesh_data
+		)
+	{
+		for( U32 i = 0; i < clusters_.num(); i++ )
+		{
+			Rendering::MeshCluster &cluster = clusters_[i];
+			cluster.start_index += raw_mesh_data.parts[ cluster.submesh_index ].start_index;
+		}
+	}
+
+	/// Runs the optional processing stages enabled in the import settings on each submesh
+	/// (simplification, vertex cache optimization, clustering) and merges the submeshes.
+	ERet ProcessAndMergeSubmeshes(
+		TcModel & model
+		, const Meshok::MeshImportSettings& mesh_import_settings
+		, AllocatorI & scratchpad
+		, TbRawMeshData &raw_mesh_data_
+		, DynamicArray< Rendering::MeshCluster > &clusters_
+		)
+	{
+		if( mesh_import_settings.lod_index > 0 )
+		{
+			mxDO(SimplifySubmeshes(
+				model
+				, mesh_import_settings
+				, scratchpad
+				));
+		}
+
+		if( mesh_import_settings.vertex_cache_optimization != Meshok::VCO_None )
+		{
+			mxDO(OptimizeSubmeshes(
+				model
+				, mesh_import_settings.vertex_cache_optimization
+				, scratchpad
+				));
+		}
+
+		if( mesh_import_settings.build_clusters )
+		{
+			mxDO(BuildSubmeshClusters(
+				model
+				, scratchpad
+				, clusters_
+				));
+		}
+
+		mxDO(MeshLib::CompileMesh(
+			model
+			, *mesh_import_settings.vertex_format
+			, raw_mesh_data_
+			));
+
+		MakeClusterIndicesRelativeToMesh( clusters_, raw_mesh_data_ );
+
+		return ALL_OK;
+	}
+
+}//namespace
+
 ERet MeshCompiler::CompileAsset(
 	const AssetCompilerInputs& inputs,
 	AssetCompilerOutputs &outputs
@@ -72,10 +321,13 @@ ERet MeshCompiler::CompileAsset(
 
 	//
 	TbRawMeshData	raw_mesh_data;
-	mxDO(MeshLib::CompileMesh(
+	DynamicArray< Rendering::MeshCluster >	clusters( scratchpad );
+	mxDO(ProcessAndMergeSubmeshes(
 		imported_model
-		, *mesh_import_settings.vertex_format
+		, mesh_import_settings
+		, scratchpad
 		, raw_mesh_data
+		, clusters
 		));
 
 	//
@@ -84,6 +336,8 @@ ERet MeshCompiler::CompileAsset(
 		NwBlobWriter(outputs.object_data)
 		, raw_mesh_data
 		, scratchpad
+		, clusters.raw()
+		, clusters.num()
 		));
 #else
 	ptBREAK;
@@ -123,10 +377,13 @@ ERet MeshCompiler::CompileMeshAsset(
 
 	//
 	TbRawMeshData	raw_mesh_data;
-	mxDO(MeshLib::CompileMesh(
+	DynamicArray< Rendering::MeshCluster >	clusters( scratchpad );
+	mxDO(ProcessAndMergeSubmeshes(
 		imported_model_
-		, *mesh_import_settings.vertex_format
+		, mesh_import_settings
+		, scratchpad
 		, raw_mesh_data
+		, clusters
 		));
 
 	//
@@ -134,6 +391,8 @@ ERet MeshCompiler::CompileMeshAsset(
 		NwBlobWriter(outputs.object_data)
 		, raw_mesh_data
 		, scratchpad
+		, clusters.raw()
+		, clusters.num()
 		));
 
 	return ALL_OK;